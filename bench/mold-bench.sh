@@ -0,0 +1,150 @@
+#!/bin/bash
+#
+# This script generates synthetic object files and links them with mold
+# in several representative modes, so that link-time regressions can be
+# tracked from build to build. The results, including per-phase timer
+# records in the --perf=trace format, are written as a single JSON file.
+#
+# Usage: mold-bench.sh [path/to/mold]
+#
+# The size of the inputs can be configured with the following
+# environment variables:
+#
+#   BENCH_OBJS     the number of object files (default: 200)
+#   BENCH_FUNCS    the number of functions, and therefore text sections,
+#                  per object file (default: 200)
+#   BENCH_CALLS    the number of calls, and therefore relocations, per
+#                  function (default: 4)
+#   BENCH_STRINGS  the number of string literals per object file. Half of
+#                  them are shared by all files so that string merging
+#                  has something to do (default: 200)
+#   BENCH_DEBUG    the -g level passed to the compiler; 0 disables debug
+#                  info (default: 2)
+#   BENCH_RUNS     the number of times each mode is run (default: 3)
+#   BENCH_OUT      the output file (default: mold-bench.json)
+#   BENCH_DIR      the directory for generated files (default: a
+#                  temporary directory which is removed at exit)
+#   CC             the compiler driver (default: cc)
+
+set -e
+
+mold=$(realpath "${1:-./mold}")
+[ -x "$mold" ] || { echo "$mold: not found" >&2; exit 1; }
+
+objs=${BENCH_OBJS:-200}
+funcs=${BENCH_FUNCS:-200}
+calls=${BENCH_CALLS:-4}
+strings=${BENCH_STRINGS:-200}
+debug=${BENCH_DEBUG:-2}
+runs=${BENCH_RUNS:-3}
+out=$(realpath -m "${BENCH_OUT:-mold-bench.json}")
+cc=${CC:-cc}
+
+if [ -n "$BENCH_DIR" ]; then
+  dir=$BENCH_DIR
+  mkdir -p $dir
+else
+  dir=$(mktemp -d)
+  trap "rm -rf $dir" EXIT
+fi
+
+mkdir -p $dir/bin $dir/src $dir/obj
+ln -sf $mold $dir/bin/ld
+
+# Generate sources. A quarter of functions have the same body in all
+# files, so that --icf can fold them.
+echo "generating $objs x $funcs functions..." >&2
+
+gen() {
+  local i=$1
+  {
+    echo 'extern int puts(const char *);'
+    for ((j = 0; j < funcs; j++)); do
+      echo "int f${i}_$j(int);"
+    done
+    for ((k = 0; k < strings; k++)); do
+      if ((k % 2 == 0)); then
+        echo "const char *s${i}_$k = \"shared string $k\";"
+      else
+        echo "const char *s${i}_$k = \"string $k of file $i\";"
+      fi
+    done
+    for ((j = 0; j < funcs; j++)); do
+      echo "int f${i}_$j(int x) {"
+      if ((j % 4 == 0)); then
+        echo "  return x * 3 + 1;"
+      else
+        for ((c = 0; c < calls; c++)); do
+          local callee=$(( (j + c * 7 + 1) % funcs ))
+          echo "  x += f${i}_$callee(x >> $c);"
+        done
+        echo "  puts(s${i}_$(( j % strings )));"
+        echo "  return x;"
+      fi
+      echo "}"
+    done
+  } > $dir/src/$i.c
+}
+
+for ((i = 0; i < objs; i++)); do
+  gen $i &
+  (( (i + 1) % $(nproc) == 0 )) && wait
+done
+wait
+
+echo 'int main() { return 0; }' > $dir/src/main.c
+
+echo "compiling..." >&2
+ls $dir/src | sed 's/\.c$//' |
+  xargs -P $(nproc) -I{} $cc -c -O1 -fPIC -ffunction-sections \
+    -fdata-sections -g$debug -o $dir/obj/{}.o $dir/src/{}.c
+
+# Link in each mode
+modes=(
+  "default:"
+  "gc-sections:-Wl,--gc-sections"
+  "icf:-Wl,--icf=all"
+  "compress-debug-sections:-Wl,--compress-debug-sections=zlib"
+  "gdb-index:-Wl,--gdb-index"
+  "shared:-shared"
+)
+
+{
+  echo '{'
+  echo "  \"version\": \"$($mold --version)\","
+  echo "  \"scale\": {\"objs\": $objs, \"funcs\": $funcs, \"calls\": $calls," \
+       "\"strings\": $strings, \"debug\": $debug},"
+  echo '  "results": ['
+} > $out
+
+first=1
+for mode in "${modes[@]}"; do
+  name=${mode%%:*}
+  flags=${mode#*:}
+  echo "linking ($name)..." >&2
+
+  times=()
+  for ((r = 0; r < runs; r++)); do
+    start=$(date +%s%N)
+    $cc -B$dir/bin -o $dir/out $dir/obj/*.o $flags \
+      -Wl,--perf=trace:$dir/trace.json > /dev/null
+    end=$(date +%s%N)
+    times+=($(( (end - start) / 1000000 )))
+  done
+
+  [ $first = 1 ] || echo '    ,' >> $out
+  first=0
+
+  {
+    echo "    {\"mode\": \"$name\", \"flags\": \"$flags\"," \
+         "\"wall_ms\": [$(IFS=,; echo "${times[*]}")]," \
+         "\"size\": $(stat -c %s $dir/out),"
+    echo -n '     "trace": '
+    cat $dir/trace.json
+    echo '    }'
+  } >> $out
+done
+
+echo '  ]' >> $out
+echo '}' >> $out
+echo "wrote $out" >&2
@@ -0,0 +1,125 @@
+#!/bin/bash
+#
+# This script replays a link captured by `--repro` to measure mold on
+# exactly the same inputs and command line. It extracts a repro archive
+# to a tmpfs, runs the link several times for each given thread count,
+# and prints the median and the standard deviation of the wall clock
+# time of each `--perf` phase.
+#
+# Usage: mold-replay.sh path/to/mold path/to/output.repro.tar[.zst]
+#
+# The following environment variables control the measurement:
+#
+#   REPLAY_RUNS     the number of runs for each thread count (default: 5)
+#   REPLAY_THREADS  a comma-separated list of thread counts (default:
+#                   the number of cores)
+#   REPLAY_ARGS     extra linker options appended to the command line,
+#                   e.g. a proposed new option to compare against
+#   REPLAY_TMPDIR   the directory to extract the archive to. It should
+#                   be on a tmpfs so that disk I/O doesn't add noise
+#                   (default: /dev/shm)
+#
+# The link output is written to `replay.out` in the extracted tree
+# instead of the original output path, which usually doesn't exist in
+# the archive.
+
+set -e
+
+[ $# = 2 ] || { echo "Usage: $0 path/to/mold path/to/repro.tar[.zst]" >&2; exit 1; }
+
+mold=$(realpath "$1")
+repro=$(realpath "$2")
+[ -x "$mold" ] || { echo "$mold: not found" >&2; exit 1; }
+[ -f "$repro" ] || { echo "$repro: not found" >&2; exit 1; }
+
+runs=${REPLAY_RUNS:-5}
+threads=${REPLAY_THREADS:-$(nproc)}
+
+dir=$(mktemp -d -p "${REPLAY_TMPDIR:-/dev/shm}")
+trap "rm -rf $dir" EXIT
+
+echo "extracting $repro..." >&2
+case "$repro" in
+*.zst)
+  zstd -dc "$repro" | tar -C $dir -xf - ;;
+*)
+  tar -C $dir -xf "$repro" ;;
+esac
+
+# The archive contains a single top-level directory with response.txt.
+# The response file starts with -C and --chroot, so that paths in the
+# original command line are resolved within that directory.
+response=$(echo $dir/*/response.txt)
+[ -f "$response" ] || { echo "$repro: response.txt not found" >&2; exit 1; }
+root=$(dirname "$response")
+
+echo "mold:    $($mold --version)" >&2
+echo "archive: $(cat $root/version.txt)" >&2
+
+# Each run writes the --perf table to a file. The table starts with a
+# header line, and each row has one value per header column followed by
+# an indented phase name. The number of columns depends on the options
+# and the system, so the "Real" column (the wall clock time in seconds)
+# and the start of the phase name are located by the header.
+for t in ${threads//,/ }; do
+  for ((r = 0; r < runs; r++)); do
+    echo "linking with $t threads ($((r + 1))/$runs)..." >&2
+    (cd $root && $mold @response.txt -o /replay.out --no-fork --perf \
+       --threads=$t $REPLAY_ARGS > $dir/perf.$t.$r.txt)
+  done
+done
+
+printf '%8s %12s %12s %8s  %s\n' Threads 'Median(ms)' 'Stddev(ms)' Runs Phase
+
+for t in ${threads//,/ }; do
+  cat $dir/perf.$t.*.txt | awk -v threads=$t '
+    $NF == "Name" {
+      ncols = NF - 1
+      real = 0
+      for (f = 1; f <= ncols; f++)
+        if ($f == "Real")
+          real = f
+      if (!real) {
+        print "--perf output has no Real column" > "/dev/stderr"
+        exit 1
+      }
+      next
+    }
+
+    ncols {
+      name = $0
+      for (f = 0; f < ncols; f++)
+        sub(/^ *[^ ]+/, "", name)
+      sub(/^  /, "", name)
+      if (!(name in count))
+        order[n++] = name
+      times[name, count[name]++] = $real * 1000
+    }
+
+    END {
+      for (i = 0; i < n; i++) {
+        name = order[i]
+        k = count[name]
+
+        # Sort the samples to take the median.
+        for (a = 0; a < k; a++)
+          v[a] = times[name, a]
+        for (a = 1; a < k; a++)
+          for (b = a; b > 0 && v[b - 1] > v[b]; b--) {
+            x = v[b]; v[b] = v[b - 1]; v[b - 1] = x
+          }
+        median = (k % 2) ? v[int(k / 2)] : (v[k / 2 - 1] + v[k / 2]) / 2
+
+        sum = 0
+        for (a = 0; a < k; a++)
+          sum += v[a]
+        mean = sum / k
+        sq = 0
+        for (a = 0; a < k; a++)
+          sq += (v[a] - mean) ^ 2
+        stddev = (k > 1) ? sqrt(sq / (k - 1)) : 0
+
+        printf "%8d %12.3f %12.3f %8d  %s\n", threads, median, stddev, k, name
+      }
+    }'
+done
@@ -75,12 +75,14 @@ struct ArHdr {
   }
 };
 
+// Returns pairs of a member pathname and the file offset of the member
+// header in a given thin archive. Member files are not opened.
 template <typename Context>
-std::vector<MappedFile *>
-read_thin_archive_members(Context &ctx, MappedFile *mf) {
+std::vector<std::pair<std::string, u64>>
+read_thin_archive_paths(Context &ctx, MappedFile *mf) {
   u8 *begin = mf->data;
   u8 *data = begin + 8;
-  std::vector<MappedFile *> vec;
+  std::vector<std::pair<std::string, u64>> vec;
   std::string_view strtab;
 
   while (data < begin + mf->size) {
@@ -114,15 +116,30 @@ read_thin_archive_members(Context &ctx, MappedFile *mf) {
     if (name == "__.SYMDEF" || name == "__.SYMDEF SORTED")
       continue;
 
-    std::string path = name.starts_with('/') ?
-      name : (path_dirname(mf->name) / name).string();
-    vec.push_back(must_open_file(ctx, path));
-    vec.back()->thin_parent = mf;
+    vec.push_back({name.starts_with('/') ?
+                   name : (path_dirname(mf->name) / name).string(),
+                   (u64)(data - begin)});
     data = body;
   }
   return vec;
 }
 
+template <typename Context>
+std::vector<MappedFile *>
+read_thin_archive_members(Context &ctx, MappedFile *mf) {
+  std::vector<std::pair<std::string, u64>> paths =
+    read_thin_archive_paths(ctx, mf);
+
+  // Members of a thin archive are separate files. A thin archive may
+  // refer to tens of thousands of them, so open them in parallel.
+  std::vector<MappedFile *> vec(paths.size());
+  tbb::parallel_for((i64)0, (i64)paths.size(), [&](i64 i) {
+    vec[i] = must_open_file(ctx, paths[i].first);
+    vec[i]->thin_parent = mf;
+  });
+  return vec;
+}
+
 template <typename Context>
 std::vector<MappedFile *> read_fat_archive_members(Context &ctx, MappedFile *mf) {
   u8 *begin = mf->data;
@@ -161,6 +178,64 @@ std::vector<MappedFile *> read_fat_archive_members(Context &ctx, MappedFile *mf)
   return vec;
 }
 
+// Reads the archive symbol table (the "/" or "/SYM64/" member created by
+// `ar s`) and returns pairs of a symbol name and the file offset of the
+// header of the member defining that symbol. A thin archive has the same
+// symbol table, with offsets pointing to member headers in the thin
+// archive itself. If an archive file doesn't have a symbol table in the
+// SysV format, returns an empty vector.
+template <typename Context>
+std::vector<std::pair<std::string_view, u64>>
+read_archive_symtab(Context &ctx, MappedFile *mf) {
+  std::string_view str = mf->get_contents();
+  if (mf->size < 8 + sizeof(ArHdr) ||
+      (!str.starts_with("!<arch>\n") && !str.starts_with("!<thin>\n")))
+    return {};
+
+  ArHdr &hdr = *(ArHdr *)(mf->data + 8);
+  u8 *body = mf->data + 8 + sizeof(hdr);
+  u64 size = atol(hdr.ar_size);
+  u8 *end = body + size;
+
+  if (!hdr.is_symtab() || end > mf->data + mf->size)
+    return {};
+
+  auto read = [&](u8 *&p) -> u64 {
+    if (hdr.starts_with("/SYM64/ ")) {
+      u64 val = *(ub64 *)p;
+      p += 8;
+      return val;
+    }
+    u64 val = *(ub32 *)p;
+    p += 4;
+    return val;
+  };
+
+  i64 wordsize = hdr.starts_with("/SYM64/ ") ? 8 : 4;
+  if (size < wordsize)
+    Fatal(ctx) << mf->name << ": corrupted archive symbol table";
+
+  u8 *p = body;
+  u64 num_syms = read(p);
+  if (num_syms > (size - wordsize) / wordsize)
+    Fatal(ctx) << mf->name << ": corrupted archive symbol table";
+
+  u8 *names = p + num_syms * wordsize;
+  std::vector<std::pair<std::string_view, u64>> vec;
+  vec.reserve(num_syms);
+
+  for (u64 i = 0; i < num_syms; i++) {
+    u64 offset = read(p);
+    u8 *nul = (u8 *)memchr(names, '\0', end - names);
+    if (!nul)
+      Fatal(ctx) << mf->name << ": corrupted archive symbol table";
+
+    vec.push_back({{(char *)names, (size_t)(nul - names)}, offset});
+    names = nul + 1;
+  }
+  return vec;
+}
+
 template <typename Context>
 std::vector<MappedFile *> read_archive_members(Context &ctx, MappedFile *mf) {
   std::string_view str = mf->get_contents();
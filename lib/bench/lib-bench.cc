@@ -0,0 +1,326 @@
+// This file contains microbenchmarks for the performance-critical data
+// structures and routines in lib/, so that a change to one of them can
+// be measured in isolation without linking a large program.
+//
+// Build and run it as follows:
+//
+//   cmake --build build --target mold-lib-bench
+//   ./build/mold-lib-bench [--filter=REGEX] [--min-time=SECONDS]
+//
+// Each benchmark is repeated until it has run for at least the minimum
+// time (0.5 seconds by default), and the mean time per iteration is
+// reported. Most benchmarks are run with 1, 2, 4, ... threads up to the
+// number of available cores.
+
+#include "../common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <regex>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <thread>
+
+namespace mold {
+
+static std::optional<std::regex> filter;
+static double min_time = 0.5;
+
+static std::vector<i64> get_thread_counts() {
+  i64 max = std::thread::hardware_concurrency();
+  std::vector<i64> vec;
+  for (i64 i = 1; i < max; i *= 2)
+    vec.push_back(i);
+  vec.push_back(max);
+  return vec;
+}
+
+// Run `fn` repeatedly with a given number of threads and print the result.
+// `items` and `bytes` are the amount of work done by each call of `fn`
+// and are used to print throughput.
+static void run(std::string name, i64 threads, i64 items, i64 bytes,
+                std::function<void()> fn) {
+  name += "/threads:" + std::to_string(threads);
+  if (filter && !std::regex_search(name, *filter))
+    return;
+
+  tbb::global_control gc(tbb::global_control::max_allowed_parallelism,
+                         threads);
+
+  using Clock = std::chrono::steady_clock;
+  i64 iters = 0;
+  double elapsed = 0;
+
+  while (iters == 0 || elapsed < min_time) {
+    Clock::time_point start = Clock::now();
+    fn();
+    elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+    iters++;
+  }
+
+  double per_iter = elapsed / iters;
+  printf("%-56s %12.0f ns %8lld iters", name.c_str(), per_iter * 1e9,
+         (long long)iters);
+  if (items)
+    printf(" %10.2fM items/s", items / per_iter / 1e6);
+  if (bytes)
+    printf(" %10.2f MB/s", bytes / per_iter / 1e6);
+  printf("\n");
+  fflush(stdout);
+}
+
+// Returns `n` strings that look like the contents of .debug_str, i.e.
+// mangled names and type names of various lengths.
+static std::vector<std::string> make_strings(i64 n, std::string prefix) {
+  static const char *templates[] = {
+    "_ZN4llvm%lld6detail14PassConceptIdEE",
+    "std::vector<int, std::allocator<int> >::iterator_%lld",
+    "__gnu_cxx::__normal_iterator<const char *, std::basic_string<char, "
+    "std::char_traits<char>, std::allocator<char> > >::operator++_%lld",
+    "v%lld",
+    "_ZNSt6vectorIiSaIiEE%lld9push_backERKi"
+  };
+
+  std::vector<std::string> vec(n);
+  tbb::parallel_for((i64)0, n, [&](i64 i) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), templates[i % std::size(templates)],
+             (long long)i);
+    vec[i] = prefix + buf;
+  });
+  return vec;
+}
+
+// Key distributions. In .debug_str, a small number of strings (common
+// type and member names) appear in almost every object file while most
+// others appear only a few times, so the number of duplicates follows a
+// power-law distribution.
+enum Dist { UNIQUE, SKEWED };
+
+static std::vector<i64> make_key_indices(i64 n, i64 ndistinct, Dist dist) {
+  std::vector<i64> vec(n);
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> uniform;
+
+  for (i64 i = 0; i < n; i++) {
+    if (dist == UNIQUE)
+      vec[i] = i % ndistinct;
+    else
+      vec[i] = std::pow(uniform(rng), 3) * ndistinct;
+  }
+
+  std::shuffle(vec.begin(), vec.end(), rng);
+  return vec;
+}
+
+static void bench_concurrent_map() {
+  constexpr i64 nkeys = 4 * 1024 * 1024;
+
+  for (Dist dist : {UNIQUE, SKEWED}) {
+    i64 ndistinct = (dist == UNIQUE) ? nkeys : nkeys / 16;
+    std::vector<std::string> strings = make_strings(ndistinct, "");
+    std::vector<i64> indices = make_key_indices(nkeys, ndistinct, dist);
+
+    std::vector<std::string_view> keys(nkeys);
+    std::vector<u64> hashes(nkeys);
+    tbb::parallel_for((i64)0, nkeys, [&](i64 i) {
+      keys[i] = strings[indices[i]];
+      hashes[i] = hash_string(keys[i]);
+    });
+
+    // A load factor above 1 means the estimated size is too small, in
+    // which case some keys don't fit and are stored to the overflow lists.
+    for (double load_factor : {0.25, 0.5, 0.75, 1.5}) {
+      for (i64 threads : get_thread_counts()) {
+        char name[100];
+        snprintf(name, sizeof(name), "ConcurrentMap/%s/load:%.2f",
+                 (dist == UNIQUE) ? "unique" : "skewed", load_factor);
+
+        run(name, threads, nkeys, 0, [&] {
+          ConcurrentMap<u32> map(ndistinct / load_factor);
+          tbb::parallel_for((i64)0, nkeys, [&](i64 i) {
+            map.insert(keys[i], hashes[i], 0);
+          });
+        });
+      }
+    }
+
+    for (i64 threads : get_thread_counts()) {
+      std::string name = "ShardedMap/";
+      name += (dist == UNIQUE) ? "unique" : "skewed";
+
+      run(name, threads, nkeys, 0, [&] {
+        ShardedMap<u32> map;
+        tbb::parallel_for((i64)0, nkeys, [&](i64 i) {
+          map.insert(keys[i], hashes[i], 0);
+        });
+      });
+    }
+  }
+}
+
+static void bench_hyperloglog() {
+  constexpr i64 n = 16 * 1024 * 1024;
+  std::vector<u64> hashes(n);
+  tbb::parallel_for((i64)0, n, [&](i64 i) {
+    hashes[i] = hash_string(std::to_string(i % (n / 4)));
+  });
+
+  for (i64 threads : get_thread_counts()) {
+    // All threads update a single estimator.
+    run("HyperLogLog/shared", threads, n, 0, [&] {
+      HyperLogLog estimator;
+      tbb::parallel_for((i64)0, n, [&](i64 i) {
+        estimator.insert(hashes[i]);
+      });
+      assert(estimator.get_cardinality() > 0);
+    });
+
+    // Each task updates its own estimator and merges it at the end, which
+    // is what we do in gdb-index.cc.
+    run("HyperLogLog/merge", threads, n, 0, [&] {
+      HyperLogLog estimator;
+      tbb::parallel_for((i64)0, n / 65536, [&](i64 i) {
+        HyperLogLog e;
+        for (i64 j = i * 65536; j < (i + 1) * 65536; j++)
+          e.insert(hashes[j]);
+        estimator.merge(e);
+      });
+      assert(estimator.get_cardinality() > 0);
+    });
+  }
+}
+
+static void bench_multi_glob() {
+  constexpr i64 nsyms = 1024 * 1024;
+  std::vector<std::string> syms = make_strings(nsyms, "");
+
+  // Patterns as they typically appear in version scripts and
+  // --dynamic-list files.
+  auto make_glob = [](i64 npats, bool complex) {
+    std::unique_ptr<MultiGlob> glob(new MultiGlob);
+    for (i64 i = 0; i < npats; i++) {
+      std::string s = std::to_string(i * 7919 % nsyms);
+      switch (i % 3) {
+      case 0:
+        glob->add("*" + s + "6detail*", i);
+        break;
+      case 1:
+        glob->add("std::vector<int, std::allocator<int> >::iterator_" + s, i);
+        break;
+      default:
+        glob->add(complex ? "_ZNSt6*" + s + "9push_back*" : "v" + s + "*", i);
+        break;
+      }
+    }
+    return glob;
+  };
+
+  for (i64 npats : {10, 1000}) {
+    for (bool complex : {false, true}) {
+      for (i64 threads : get_thread_counts()) {
+        std::string name = "MultiGlob/patterns:" + std::to_string(npats) +
+                           (complex ? "/complex" : "/simple");
+
+        // MultiGlob compiles patterns on first use, so we keep the same
+        // object across iterations and compile it before measuring.
+        std::unique_ptr<MultiGlob> glob = make_glob(npats, complex);
+        glob->find("");
+
+        run(name, threads, nsyms, 0, [&] {
+          tbb::parallel_for((i64)0, nsyms, [&](i64 i) {
+            glob->find(syms[i]);
+          });
+        });
+      }
+    }
+  }
+}
+
+// Returns a buffer whose contents are as compressible as typical debug
+// info sections.
+static std::vector<u8> make_debug_info(i64 size) {
+  std::vector<std::string> strings = make_strings(size / 64, "");
+  std::vector<u8> buf;
+  buf.reserve(size);
+
+  std::mt19937_64 rng(42);
+  while (buf.size() < size) {
+    std::string &s = strings[rng() % strings.size()];
+    buf.insert(buf.end(), s.c_str(), s.c_str() + s.size() + 1);
+    for (i64 i = 0; i < 8; i++)
+      buf.push_back(rng() % 16);
+  }
+
+  buf.resize(size);
+  return buf;
+}
+
+static void bench_compress() {
+  constexpr i64 size = 64 * 1024 * 1024;
+  std::vector<u8> buf = make_debug_info(size);
+
+  for (i64 threads : get_thread_counts()) {
+    run("ZlibCompressor", threads, 0, size, [&] {
+      ZlibCompressor c(buf.data(), size);
+      std::vector<u8> out(c.compressed_size);
+      c.write_to(out.data());
+    });
+
+    run("ZstdCompressor", threads, 0, size, [&] {
+      ZstdCompressor c(buf.data(), size);
+      std::vector<u8> out(c.compressed_size);
+      c.write_to(out.data());
+    });
+  }
+}
+
+static void bench_crc32() {
+  constexpr i64 size = 256 * 1024 * 1024;
+  std::vector<u8> buf(size);
+  get_random_bytes(buf.data(), 1024 * 1024);
+  for (i64 i = 1; i < size / (1024 * 1024); i++)
+    memcpy(buf.data() + i * 1024 * 1024, buf.data(), 1024 * 1024);
+
+  for (i64 threads : get_thread_counts()) {
+    run("compute_crc32", threads, 0, size, [&] {
+      compute_crc32(0, buf.data(), size);
+    });
+  }
+
+  constexpr i64 n = 1024 * 1024;
+  run("crc32_solve", 1, n, 0, [&] {
+    for (i64 i = 0; i < n; i++)
+      crc32_solve(i, ~i);
+  });
+}
+
+static int main(int argc, char **argv) {
+  for (i64 i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg.starts_with("--filter=")) {
+      filter = std::regex(std::string(arg.substr(9)));
+    } else if (arg.starts_with("--min-time=")) {
+      min_time = std::stod(std::string(arg.substr(11)));
+    } else {
+      fprintf(stderr, "usage: %s [--filter=REGEX] [--min-time=SECONDS]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  bench_concurrent_map();
+  bench_hyperloglog();
+  bench_multi_glob();
+  bench_compress();
+  bench_crc32();
+  return 0;
+}
+
+} // namespace mold
+
+int main(int argc, char **argv) {
+  return mold::main(argc, argv);
+}
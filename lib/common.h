@@ -11,8 +11,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fcntl.h>
 #include <filesystem>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <optional>
@@ -25,6 +27,7 @@
 #include <tbb/concurrent_vector.h>
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <unordered_map>
 #include <vector>
 
 #ifdef _WIN32
@@ -47,17 +50,6 @@ inline uint64_t hash_string(std::string_view str) {
   return XXH3_64bits(str.data(), str.size());
 }
 
-class HashCmp {
-public:
-  static size_t hash(const std::string_view &k) {
-    return hash_string(k);
-  }
-
-  static bool equal(const std::string_view &k1, const std::string_view &k2) {
-    return k1 == k2;
-  }
-};
-
 namespace mold {
 
 using namespace std::literals::string_literals;
@@ -185,6 +177,7 @@ public:
       return;
 
     out.emplace(std::cerr);
+    ctx.has_warning = true;
 
     if (ctx.arg.fatal_warnings) {
       *out << (ctx.arg.color_diagnostics ? error_color : error_mono);
@@ -255,6 +248,20 @@ struct Atomic : std::atomic<T> {
 //
 
 void set_mimalloc_options();
+i64 get_mimalloc_commit();
+i64 get_mimalloc_peak_commit();
+void release_free_memory();
+
+//
+// mapped-file-unix.cc
+//
+
+// Spreads the pages of an untouched anonymous mapping over all NUMA
+// nodes. Otherwise, a page is allocated on the node of the thread that
+// touches it first. For a large buffer shared by all threads, such as a
+// hash table, that makes threads on the other nodes slow. This is a no-op
+// unless the machine has two or more NUMA nodes.
+void interleave_memory(void *addr, i64 size);
 
 //
 // perf.cc
@@ -275,13 +282,14 @@ public:
     return *this;
   }
 
-  Counter &operator+=(int delta) {
+  Counter &operator+=(i64 delta) {
     if (enabled) [[unlikely]]
       values.local() += delta;
     return *this;
   }
 
   static void print();
+  static void reset();
 
   static inline bool enabled = false;
 
@@ -294,12 +302,34 @@ private:
   static inline std::vector<Counter *> instances;
 };
 
+inline i64 now_nsec() {
+  return (i64)std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+// Cycles, instructions, LLC misses and dTLB misses
+static constexpr i64 NUM_HW_COUNTERS = 4;
+
+bool enable_hw_counters();
+void enable_thread_utilization();
+
+// Even without --perf, we keep the most recent timer events in a small
+// ring buffer. It is printed to stderr when mold crashes or receives
+// SIGUSR1, so that we can see what a slow or stuck link is doing
+// without rerunning it.
+i64 begin_trace_event(std::string_view name);
+void end_trace_event(i64 seq);
+void print_trace_events();
+
 // Timer and TimeRecord records elapsed time (wall clock time)
 // used by each pass of the linker.
 struct TimerRecord {
   TimerRecord(std::string name, TimerRecord *parent = nullptr);
   void stop();
 
+  // Set if --perf or --perf=trace is given. Otherwise, Timer doesn't
+  // create TimerRecords at all.
+  static inline bool enabled = false;
+
   std::string name;
   TimerRecord *parent;
   tbb::concurrent_vector<TimerRecord *> children;
@@ -307,32 +337,58 @@ struct TimerRecord {
   i64 end;
   i64 user;
   i64 sys;
+  i64 maxrss = 0;
+  i64 rss_growth = 0;
+  i64 minflt = 0;
+  i64 majflt = 0;
+  i64 commit = 0;
+  std::array<i64, NUM_HW_COUNTERS> hw = {};
+  i64 tid = 0;
+  i64 tbb_thread = -1;
+  i64 busy = 0;
+  i64 serial = 0;
   bool stopped = false;
 };
 
 void
 print_timer_records(tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &);
 
+void write_timer_trace(tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &,
+                       std::ostream &out);
+
+std::string json_escape(std::string_view str);
+
 template <typename Context>
 class Timer {
 public:
-  Timer(Context &ctx, std::string name, Timer *parent = nullptr) {
-    record = new TimerRecord(name, parent ? parent->record : nullptr);
-    ctx.timer_records.push_back(std::unique_ptr<TimerRecord>(record));
+  Timer(Context &ctx, std::string_view name, Timer *parent = nullptr) {
+    seq = begin_trace_event(name);
+
+    if (TimerRecord::enabled) [[unlikely]] {
+      record = new TimerRecord(std::string(name),
+                               parent ? parent->record : nullptr);
+      ctx.timer_records.push_back(std::unique_ptr<TimerRecord>(record));
+    }
   }
 
   Timer(const Timer &) = delete;
 
   ~Timer() {
-    record->stop();
+    stop();
   }
 
   void stop() {
-    record->stop();
+    if (seq == -1)
+      return;
+    end_trace_event(seq);
+    seq = -1;
+    if (record)
+      record->stop();
   }
 
 private:
-  TimerRecord *record;
+  TimerRecord *record = nullptr;
+  i64 seq = -1;
 };
 
 //
@@ -352,6 +408,57 @@ private:
   std::vector<u8> vec;
 };
 
+//
+// Bump allocator
+//
+
+// BumpAllocator hands out memory from large blocks owned by each thread,
+// so that we don't call `new` for each of many small objects such as
+// linker-synthesized strings. Objects are never freed individually; all
+// memory is released when the allocator is destroyed.
+class BumpAllocator {
+public:
+  u8 *allocate(i64 size) {
+    // A large object gets its own block.
+    if (size > BLOCK_SIZE / 4) {
+      u8 *buf = new u8[size];
+      large_blocks.emplace_back(buf);
+      allocated_size += size;
+      return buf;
+    }
+
+    Arena &arena = arenas.local();
+    if (arena.end - arena.cur < size) {
+      arena.cur = new u8[BLOCK_SIZE];
+      arena.end = arena.cur + BLOCK_SIZE;
+      arena.blocks.emplace_back(arena.cur);
+      allocated_size += BLOCK_SIZE;
+    }
+
+    u8 *buf = arena.cur;
+    arena.cur += size;
+    return buf;
+  }
+
+  // Returns the number of bytes of blocks we have allocated so far.
+  i64 get_allocated_size() const {
+    return allocated_size;
+  }
+
+private:
+  static constexpr i64 BLOCK_SIZE = 64 * 1024;
+
+  struct Arena {
+    std::vector<std::unique_ptr<u8[]>> blocks;
+    u8 *cur = nullptr;
+    u8 *end = nullptr;
+  };
+
+  tbb::enumerable_thread_specific<Arena> arenas;
+  tbb::concurrent_vector<std::unique_ptr<u8[]>> large_blocks;
+  Atomic<i64> allocated_size = 0;
+};
+
 //
 // Utility functions
 //
@@ -539,15 +646,44 @@ static inline void pause() {
 #endif
 }
 
+//
+// Bump allocator
+//
+
+// Allocates memory from a thread-local bump allocator. Memory returned
+// by this function is never freed, so it should be used only for small
+// objects that live until the end of the process, such as the ones we
+// create for each input section. Allocation is much cheaper than
+// malloc(), and deallocation is free.
+inline void *arena_alloc(size_t size, size_t align = alignof(std::max_align_t)) {
+  constexpr size_t CHUNK_SIZE = 256 * 1024;
+  thread_local u8 *cur = nullptr;
+  thread_local u8 *end = nullptr;
+
+  if (size > CHUNK_SIZE / 4)
+    return ::operator new(size, std::align_val_t(align));
+
+  u8 *p = (u8 *)align_to((uintptr_t)cur, align);
+  if (!cur || p + size > end) {
+    cur = (u8 *)malloc(CHUNK_SIZE);
+    end = cur + CHUNK_SIZE;
+    p = (u8 *)align_to((uintptr_t)cur, align);
+  }
+
+  cur = p + size;
+  return p;
+}
+
 //
 // Concurrent Map
 //
 
 // This is an implementation of a fast concurrent hash map. Unlike
-// ordinary hash tables, this impl just aborts if it becomes full.
-// So you need to give a correct estimation of the final size before
-// using it. We use this hash map to uniquify pieces of data in
-// mergeable sections.
+// ordinary hash tables, this impl doesn't grow, so you need to give a
+// reasonable estimation of the final size before using it. If the
+// estimation was too low, keys that don't fit into the table are stored
+// to a slow, mutex-protected overflow list of each shard. We use this
+// hash map to uniquify pieces of data in mergeable sections.
 //
 // We've implemented this ourselves because the performance of
 // conrurent hash map is critical for our linker.
@@ -572,13 +708,25 @@ public:
 
   // In order to avoid unnecessary cache-line false sharing, we want
   // to make this object to be aligned to a reasonably large
-  // power-of-two address.
-  struct alignas(32) Entry {
+  // power-of-two address. An exception is an 8-byte value, for which
+  // rounding the entry up from 24 to 32 bytes would waste a quarter
+  // of the table.
+  //
+  // `tag` is a few bits of the key's hash value. We compare it before
+  // comparing keys so that we don't have to touch key bytes, which are
+  // likely to be not in cache, on a mismatch. It occupies what would
+  // otherwise be padding between `keylen` and `value`.
+  struct alignas(sizeof(T) == 8 ? 8 : 32) Entry {
     Atomic<const char *> key;
     u32 keylen;
+    u32 tag;
     T value;
   };
 
+  static u32 get_tag(u64 hash) {
+    return hash ^ (hash >> 32);
+  }
+
   void resize(i64 nbuckets) {
     assert(!entries);
     this->nbuckets = std::max<i64>(MIN_NBUCKETS, bit_ceil(nbuckets));
@@ -592,7 +740,10 @@ public:
 #else
     entries = (Entry *)mmap(nullptr, bufsize, PROT_READ | PROT_WRITE,
                             MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    interleave_memory(entries, bufsize);
 #endif
+
+    overflow.reset(new Overflow[NUM_SHARDS]);
   }
 
   std::pair<T *, bool> insert(std::string_view key, u64 hash, const T &val) {
@@ -600,6 +751,11 @@ public:
 
     u64 begin = hash & (nbuckets - 1);
     u64 mask = nbuckets / NUM_SHARDS - 1;
+    u32 tag = get_tag(hash);
+
+    auto equals = [&](Entry &ent, const char *ptr) {
+      return ent.tag == tag && key == std::string_view(ptr, ent.keylen);
+    };
 
     for (i64 i = 0; i < MAX_RETRY; i++) {
       u64 idx = (begin & ~mask) | ((begin + i) & mask);
@@ -609,7 +765,7 @@ public:
       // on my Zen4 machine, so do it.
       if (const char *ptr = ent.key.load(std::memory_order_acquire);
           ptr != nullptr && ptr != (char *)-1) {
-        if (key == std::string_view(ptr, ent.keylen))
+        if (equals(ent, ptr))
           return {&ent.value, false};
         continue;
       }
@@ -624,6 +780,7 @@ public:
       if (claimed) {
         new (&ent.value) T(val);
         ent.keylen = key.size();
+        ent.tag = tag;
         ent.key.store(key.data(), std::memory_order_release);
         return {&ent.value, true};
       }
@@ -636,21 +793,47 @@ public:
 
       // If the same key is already present, this is the slot we are
       // looking for.
-      if (key == std::string_view(ptr, ent.keylen))
+      if (equals(ent, ptr))
         return {&ent.value, false};
     }
 
-    std::cerr << "ConcurrentMap is full\n";
-    abort();
+    return insert_overflow(key, (begin & ~mask) / (mask + 1), tag, val);
+  }
+
+  // Calls `fn` for each occupied entry in a given shard in an
+  // unspecified order.
+  void for_each_entry(i64 shard_idx, auto fn) {
+    if (nbuckets == 0)
+      return;
+
+    i64 shard_size = nbuckets / NUM_SHARDS;
+    for (i64 i = shard_size * shard_idx; i < shard_size * (shard_idx + 1); i++)
+      if (entries[i].key)
+        fn(entries[i]);
+
+    for (Entry &ent : overflow[shard_idx].entries)
+      fn(ent);
   }
 
   i64 get_idx(T *value) const {
-    uintptr_t addr = (uintptr_t)value - (uintptr_t)value % sizeof(Entry);
-    return (Entry *)addr - entries;
+    uintptr_t offset = (uintptr_t)value - (uintptr_t)entries;
+    return offset / sizeof(Entry);
   }
 
   // Return a list of map entries sorted in a deterministic order.
   std::vector<Entry *> get_sorted_entries(i64 shard_idx) {
+    return get_sorted_entries(shard_idx, [](Entry *a, Entry *b) {
+      if (a->keylen != b->keylen)
+        return a->keylen < b->keylen;
+      return memcmp(a->key, b->key, a->keylen) < 0;
+    });
+  }
+
+  // Same as above but with a custom order. `less` must be a total
+  // order for the result to be deterministic. Sorting by a value
+  // recorded in `T` is faster than comparing keys because it doesn't
+  // touch key bytes, which are likely to be cold.
+  std::vector<Entry *> get_sorted_entries(i64 shard_idx, auto less) {
     if (nbuckets == 0)
       return {};
 
@@ -658,37 +841,59 @@ public:
     i64 begin = shard_idx * shard_size;
     i64 end = begin + shard_size;
 
-    i64 sz = 0;
-    for (i64 i = begin; i < end; i++)
-      if (entries[i].key)
-        sz++;
-
-    std::vector<Entry *> vec;
-    vec.reserve(sz);
+    // If the shard has overflowed, which keys are in the table depends
+    // on the order of insertion. Sort the entire shard in that case to
+    // keep the output deterministic.
+    if (!overflow[shard_idx].entries.empty()) {
+      std::vector<Entry *> vec;
+      for_each_entry(shard_idx, [&](Entry &ent) { vec.push_back(&ent); });
+      std::sort(vec.begin(), vec.end(), less);
+      return vec;
+    }
 
     // Since the shard is circular, we need to handle the last entries
     // as if they were next to the first entries.
-    while (entries[end - 1].key)
-      vec.push_back(entries + --end);
+    i64 wrap = end;
+    while (wrap > begin && entries[wrap - 1].key)
+      wrap--;
+
+    // Entries contiguous in the buckets are sorted as a group. A large
+    // shard is split at empty buckets into pieces which are processed in
+    // parallel. Since no group spans two pieces, the result doesn't
+    // depend on how the shard is split.
+    std::vector<i64> bounds = {begin};
+    for (i64 i = begin + PIECE_SIZE; i < wrap; i += PIECE_SIZE) {
+      i64 j = std::max(i, bounds.back());
+      while (j < wrap && entries[j].key)
+        j++;
+      if (j < wrap && j != bounds.back())
+        bounds.push_back(j);
+    }
+    bounds.push_back(wrap);
 
-    // Find entries contiguous in the buckets and sort them.
-    i64 last = 0;
-    for (i64 i = begin; i < end;) {
-      while (i < end && entries[i].key)
-        vec.push_back(entries + i++);
+    std::vector<std::vector<Entry *>> pieces(bounds.size() - 1);
 
-      std::sort(vec.begin() + last, vec.end(), [](Entry *a, Entry *b) {
-        if (a->keylen != b->keylen)
-          return a->keylen < b->keylen;
-        return memcmp(a->key, b->key, a->keylen) < 0;
-      });
+    tbb::parallel_for((i64)0, (i64)pieces.size(), [&](i64 k) {
+      std::vector<Entry *> &vec = pieces[k];
+      if (k == 0)
+        for (i64 i = end - 1; i >= wrap; i--)
+          vec.push_back(entries + i);
 
-      last = vec.size();
+      i64 last = 0;
+      for (i64 i = bounds[k]; i < bounds[k + 1];) {
+        while (i < bounds[k + 1] && entries[i].key)
+          vec.push_back(entries + i++);
 
-      while (i < end && !entries[i].key)
-        i++;
-    }
-    return vec;
+        std::sort(vec.begin() + last, vec.end(), less);
+
+        last = vec.size();
+
+        while (i < bounds[k + 1] && !entries[i].key)
+          i++;
+      }
+      std::sort(vec.begin() + last, vec.end(), less);
+    });
+    return flatten(pieces);
   }
 
   std::vector<Entry *> get_sorted_entries_all() {
@@ -701,10 +906,140 @@ public:
 
   static constexpr i64 MIN_NBUCKETS = 2048;
   static constexpr i64 NUM_SHARDS = 16;
+  static constexpr i64 PIECE_SIZE = 1 << 16;
   static constexpr i64 MAX_RETRY = 128;
 
   Entry *entries = nullptr;
   u64 nbuckets = 0;
+
+private:
+  struct Overflow {
+    std::mutex mu;
+    std::deque<Entry> entries;
+    std::unordered_map<std::string_view, Entry *> map;
+  };
+
+  std::pair<T *, bool>
+  insert_overflow(std::string_view key, i64 shard_idx, u32 tag, const T &val) {
+    Overflow &o = overflow[shard_idx];
+    std::scoped_lock lock(o.mu);
+
+    auto [it, inserted] = o.map.insert({key, nullptr});
+    if (!inserted)
+      return {&it->second->value, false};
+
+    Entry &ent = o.entries.emplace_back(Entry{key.data(), (u32)key.size(), tag, val});
+    it->second = &ent;
+    return {&ent.value, true};
+  }
+
+  std::unique_ptr<Overflow[]> overflow;
+};
+
+// This is a concurrent insert-only hash map for string keys whose final
+// size is not known in advance. We use it for the symbol table, which
+// is accessed from all threads while we are reading input files.
+//
+// The map is split into many shards by the high bits of hash values.
+// Each shard is an open-addressing hash table of pointers protected by
+// its own lock. Because a critical section is just a few probes and the
+// number of shards is much larger than the number of threads, lock
+// contention is rare. Values are allocated in a deque for each shard,
+// so their addresses never change once they are inserted.
+template <typename T>
+class ShardedMap {
+public:
+  ShardedMap() : shards(new Shard[NUM_SHARDS]) {}
+
+  std::pair<T *, bool> insert(std::string_view key, u64 hash, const T &val) {
+    Shard &shard = shards[hash >> (64 - SHARD_BITS)];
+    std::scoped_lock lock(shard.mu);
+
+    if (shard.size * 4 >= shard.slots.size() * 3)
+      shard.grow();
+
+    u64 mask = shard.slots.size() - 1;
+    for (u64 i = hash & mask;; i = (i + 1) & mask) {
+      Slot &slot = shard.slots[i];
+      if (!slot.value) {
+        T &ent = shard.values.emplace_back(val);
+        slot = {key.data(), (u32)key.size(), hash, &ent};
+        shard.size++;
+        return {&ent, true};
+      }
+
+      if (slot.hash == hash && key == std::string_view(slot.key, slot.keylen))
+        return {slot.value, false};
+    }
+  }
+
+  T *get(std::string_view key, u64 hash) {
+    Shard &shard = shards[hash >> (64 - SHARD_BITS)];
+    std::scoped_lock lock(shard.mu);
+    if (shard.slots.empty())
+      return nullptr;
+
+    u64 mask = shard.slots.size() - 1;
+    for (u64 i = hash & mask;; i = (i + 1) & mask) {
+      Slot &slot = shard.slots[i];
+      if (!slot.value)
+        return nullptr;
+      if (slot.hash == hash && key == std::string_view(slot.key, slot.keylen))
+        return slot.value;
+    }
+  }
+
+  // Returns the number of bytes held by this map. This is for --stats.
+  i64 get_memory_usage() {
+    i64 bytes = sizeof(Shard) * NUM_SHARDS;
+    for (i64 i = 0; i < NUM_SHARDS; i++) {
+      std::scoped_lock lock(shards[i].mu);
+      bytes += shards[i].slots.capacity() * sizeof(Slot) +
+               shards[i].values.size() * sizeof(T);
+    }
+    return bytes;
+  }
+
+  static constexpr i64 SHARD_BITS = 8;
+  static constexpr i64 NUM_SHARDS = 1 << SHARD_BITS;
+
+private:
+  // We keep the entire hash value in a slot rather than a 32-bit tag.
+  // All keys in a shard have the same shard index bits, and keys that
+  // start probing at the same slot have the same slot index bits, so
+  // comparing only those bits wouldn't tell such keys apart.
+  struct Slot {
+    const char *key = nullptr;
+    u32 keylen = 0;
+    u64 hash = 0;
+    T *value = nullptr;
+  };
+
+  struct alignas(64) Shard {
+    void grow() {
+      std::vector<Slot> vec(std::max<i64>(64, slots.size() * 2));
+      u64 mask = vec.size() - 1;
+
+      // We can compute a new slot index from the stored hash value
+      // without rehashing the key.
+      for (Slot &slot : slots) {
+        if (slot.value) {
+          u64 i = slot.hash & mask;
+          while (vec[i].value)
+            i = (i + 1) & mask;
+          vec[i] = slot;
+        }
+      }
+      slots = std::move(vec);
+    }
+
+    std::mutex mu;
+    std::vector<Slot> slots;
+    std::deque<T> values;
+    i64 size = 0;
+  };
+
+  std::unique_ptr<Shard[]> shards;
 };
 
 //
@@ -754,6 +1089,7 @@ class Glob {
 public:
   static std::optional<Glob> compile(std::string_view pat);
   bool match(std::string_view str);
+  std::string_view get_longest_literal() const;
 
 private:
   Glob(std::vector<Element> &&vec) : elements(vec) {}
@@ -777,16 +1113,20 @@ private:
     i64 value = -1;
     TrieNode *suffix_link = nullptr;
     std::unique_ptr<TrieNode> children[256];
+    std::vector<i32> globs;
   };
 
   void compile();
-  void fix_suffix_links(TrieNode &node);
-  void fix_values();
+  void fix_suffix_links(TrieNode &root);
+  void fix_values(TrieNode &root);
   i64 find_aho_corasick(std::string_view str);
+  i64 find_globs(std::string_view str, i64 val);
 
   std::vector<std::string> strings;
   std::unique_ptr<TrieNode> root;
+  std::unique_ptr<TrieNode> literal_root;
   std::vector<std::pair<Glob, i64>> globs;
+  std::vector<i32> unindexed_globs;
   std::once_flag once;
   bool is_compiled = false;
   bool prefix_match = false;
@@ -823,6 +1163,9 @@ std::optional<std::string_view> demangle_rust(std::string_view name);
 
 void acquire_global_lock();
 void release_global_lock();
+i64 acquire_job_tokens(i64 max);
+i64 get_cgroup_cpu_limit();
+i64 get_cgroup_memory_limit();
 
 //
 // crc32.cc
@@ -842,9 +1185,19 @@ public:
   i64 compressed_size = 0;
 };
 
+// Compressors can take input as a sequence of groups instead of a single
+// buffer. A callback is called for each group index and returns the
+// group's uncompressed contents, which may be written to a given scratch
+// buffer. Groups are compressed in parallel, and each scratch buffer is
+// freed as soon as its contents have been compressed, so the entire
+// input doesn't have to be in memory at once.
+using CompressorInput =
+  std::function<std::string_view(i64 idx, std::vector<u8> &buf)>;
+
 class ZlibCompressor : public Compressor {
 public:
-  ZlibCompressor(u8 *buf, i64 size);
+  ZlibCompressor(u8 *buf, i64 size, i64 level = 1);
+  ZlibCompressor(i64 num_groups, CompressorInput input, i64 level = 1);
   void write_to(u8 *buf) override;
 
 private:
@@ -852,13 +1205,19 @@ private:
   u64 checksum = 0;
 };
 
+// If `seek_table` is true, ZstdCompressor appends a seek table in the
+// zstd seekable format, so that consumers can decompress only the
+// frames they need.
 class ZstdCompressor : public Compressor {
 public:
-  ZstdCompressor(u8 *buf, i64 size);
+  ZstdCompressor(u8 *buf, i64 size, i64 level = 3, bool seek_table = false);
+  ZstdCompressor(i64 num_groups, CompressorInput input, i64 level = 3,
+                 bool seek_table = false);
   void write_to(u8 *buf) override;
 
 private:
   std::vector<std::vector<u8>> shards;
+  std::vector<u8> seek_table;
 };
 
 //
@@ -878,6 +1237,14 @@ public:
   ~TarWriter();
   void append(std::string path, std::string_view data);
 
+  // Returns the headers of a member. They are followed by the member's
+  // contents padded to BLOCK_SIZE, and the archive ends with two empty
+  // blocks. This is for those who write a tar file without TarWriter.
+  static std::string
+  encode_header(std::string basedir, std::string path, i64 size);
+
+  static constexpr i64 BLOCK_SIZE = 512;
+
 private:
   TarWriter(FILE *out, std::string basedir) : out(out), basedir(basedir) {}
 
@@ -897,6 +1264,11 @@ public:
   void unmap();
   void close_fd();
   void reopen_fd(const std::string &path);
+  void prefetch();
+  void use_huge_pages();
+  void release();
+  void release(i64 offset, i64 len);
+  i64 get_resident_size();
 
   template <typename Context>
   MappedFile *slice(Context &ctx, std::string name, u64 start, u64 size) {
@@ -942,6 +1314,10 @@ public:
   MappedFile *parent = nullptr;
   MappedFile *thin_parent = nullptr;
 
+  // True if `data` is a buffer owned by the caller of link_in_memory(),
+  // which we must not unmap or release.
+  bool is_borrowed = false;
+
   // For --dependency-file
   bool is_dependency = true;
 
@@ -949,6 +1325,13 @@ public:
   HANDLE fd = INVALID_HANDLE_VALUE;
 #else
   int fd = -1;
+
+  // The identity of the file when it was mapped. use_huge_pages()
+  // reopens the file by name and compares these to make sure that it
+  // has got the same file.
+  u64 dev = 0;
+  u64 ino = 0;
+  i64 mtime = 0;
 #endif
 };
 
@@ -956,6 +1339,20 @@ MappedFile *open_file_impl(const std::string &path, std::string &error);
 
 template <typename Context>
 MappedFile *open_file(Context &ctx, std::string path) {
+  // link_in_memory() may give file contents as buffers.
+  if (ctx.memory_link) {
+    auto it = ctx.memory_link->inputs.find(path);
+    if (it != ctx.memory_link->inputs.end()) {
+      MappedFile *mf = new MappedFile;
+      mf->name = path;
+      mf->data = (u8 *)it->second.data();
+      mf->size = it->second.size();
+      mf->is_borrowed = true;
+      ctx.mf_pool.push_back(std::unique_ptr<MappedFile>(mf));
+      return mf;
+    }
+  }
+
   if (path.starts_with('/') && !ctx.arg.chroot.empty())
     path = ctx.arg.chroot + "/" + path_clean(path);
 
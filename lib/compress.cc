@@ -28,30 +28,44 @@
 
 namespace mold {
 
-static constexpr i64 SHARD_SIZE = 1024 * 1024;
+// Shards are at least 256 KiB so that the compression ratio doesn't
+// suffer too much, and at most 8 MiB so that a huge section is still
+// split into enough shards to keep all cores busy. Between the two, we
+// aim for 64 shards per input so that a small section can be spread
+// over many threads too.
+//
+// The shard size depends only on the input size and not on the number
+// of threads, so that the output is reproducible on any machine.
+static i64 get_shard_size(i64 size) {
+  constexpr i64 MIN_SHARD_SIZE = 256 * 1024;
+  constexpr i64 MAX_SHARD_SIZE = 8 * 1024 * 1024;
+  i64 sz = std::bit_ceil<u64>(align_to(size, 64) / 64);
+  return std::clamp(sz, MIN_SHARD_SIZE, MAX_SHARD_SIZE);
+}
 
 static std::vector<std::string_view> split(std::string_view input) {
   std::vector<std::string_view> shards;
+  i64 shard_size = get_shard_size(input.size());
 
-  while (input.size() >= SHARD_SIZE) {
-    shards.push_back(input.substr(0, SHARD_SIZE));
-    input = input.substr(SHARD_SIZE);
+  while (input.size() >= shard_size) {
+    shards.push_back(input.substr(0, shard_size));
+    input = input.substr(shard_size);
   }
   if (!input.empty())
     shards.push_back(input);
   return shards;
 }
 
-static std::vector<u8> zlib_compress(std::string_view input) {
+static std::vector<u8> zlib_compress(std::string_view input, i64 level) {
   // Initialize zlib stream. Since debug info is generally compressed
-  // pretty well with lower compression levels, we chose compression
-  // level 1.
+  // pretty well with lower compression levels, the default compression
+  // level is 1.
   z_stream strm;
   strm.zalloc = Z_NULL;
   strm.zfree = Z_NULL;
   strm.opaque = Z_NULL;
 
-  CHECK(deflateInit2(&strm, 1, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY));
+  CHECK(deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY));
 
   // Set an input buffer
   strm.avail_in = input.size();
@@ -97,27 +111,64 @@ static std::vector<u8> zlib_compress(std::string_view input) {
   return buf;
 }
 
-ZlibCompressor::ZlibCompressor(u8 *buf, i64 size) {
-  std::string_view input{(char *)buf, (size_t)size};
-  std::vector<std::string_view> inputs = split(input);
-  std::vector<u64> adlers(inputs.size());
-  shards.resize(inputs.size());
+namespace {
+struct Shard {
+  std::vector<u8> data;
+  i64 size = 0;
+  u64 adler = 0;
+};
+}
 
-  // Compress each shard
-  tbb::parallel_for((i64)0, (i64)inputs.size(), [&](i64 i) {
-    adlers[i] = adler32(1, (u8 *)inputs[i].data(), inputs[i].size());
-    shards[i] = zlib_compress(inputs[i]);
+// Materializes each input group, splits it into shards and compresses
+// them. Returns compressed shards in order.
+template <typename Fn>
+static std::vector<Shard>
+compress_groups(i64 num_groups, CompressorInput &input, Fn compress) {
+  std::vector<std::vector<Shard>> groups(num_groups);
+
+  tbb::parallel_for((i64)0, num_groups, [&](i64 i) {
+    std::vector<u8> buf;
+    std::vector<std::string_view> inputs = split(input(i, buf));
+    groups[i].resize(inputs.size());
+
+    tbb::parallel_for((i64)0, (i64)inputs.size(), [&](i64 j) {
+      groups[i][j].size = inputs[j].size();
+      compress(inputs[j], groups[i][j]);
+    });
   });
 
+  std::vector<Shard> vec;
+  for (std::vector<Shard> &group : groups)
+    for (Shard &shard : group)
+      vec.push_back(std::move(shard));
+  return vec;
+}
+
+ZlibCompressor::ZlibCompressor(u8 *buf, i64 size, i64 level)
+  : ZlibCompressor(1, [&](i64, std::vector<u8> &) {
+      return std::string_view{(char *)buf, (size_t)size};
+    }, level) {}
+
+ZlibCompressor::ZlibCompressor(i64 num_groups, CompressorInput input,
+                               i64 level) {
+  // Compress each shard
+  std::vector<Shard> vec =
+    compress_groups(num_groups, input, [&](std::string_view in, Shard &out) {
+      out.adler = adler32(1, (u8 *)in.data(), in.size());
+      out.data = zlib_compress(in, level);
+    });
+
   // Combine checksums
-  checksum = adlers[0];
-  for (i64 i = 1; i < inputs.size(); i++)
-    checksum = adler32_combine(checksum, adlers[i], inputs[i].size());
+  checksum = 1;
+  for (Shard &shard : vec)
+    checksum = adler32_combine(checksum, shard.adler, shard.size);
 
   // Comput the total size
   compressed_size = 8; // the header and the trailer
-  for (std::vector<u8> &shard : shards)
-    compressed_size += shard.size();
+  for (Shard &shard : vec) {
+    compressed_size += shard.data.size();
+    shards.push_back(std::move(shard.data));
+  }
 }
 
 void ZlibCompressor::write_to(u8 *buf) {
@@ -144,31 +195,73 @@ void ZlibCompressor::write_to(u8 *buf) {
   *(ub32 *)(end - 4) = checksum;
 }
 
-static std::vector<u8> zstd_compress(std::string_view input) {
+static std::vector<u8> zstd_compress(std::string_view input, i64 level) {
   std::vector<u8> buf(ZSTD_COMPRESSBOUND(input.size()));
-  constexpr int LEVEL = 3; // compression level; must be between 1 to 22
 
-  size_t sz = ZSTD_compress(buf.data(), buf.size(), input.data(), input.size(),
-                            LEVEL);
+  // At lower levels, zstd's match window is smaller than our larger
+  // shards, so data repeated from far back in the same shard (which is
+  // common in debug info) wouldn't be found. Long distance matching
+  // extends the window to the whole shard. Since the window is bounded
+  // by the shard size, decompressors need no more memory than that.
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+  if (input.size() > 2 * 1024 * 1024)
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+
+  size_t sz = ZSTD_compress2(cctx, buf.data(), buf.size(), input.data(),
+                             input.size());
   assert(!ZSTD_isError(sz));
+  ZSTD_freeCCtx(cctx);
+
   buf.resize(sz);
   buf.shrink_to_fit();
   return buf;
 }
 
-ZstdCompressor::ZstdCompressor(u8 *buf, i64 size) {
-  std::string_view input{(char *)buf, (size_t)size};
-  std::vector<std::string_view> inputs = split(input);
-  shards.resize(inputs.size());
+ZstdCompressor::ZstdCompressor(u8 *buf, i64 size, i64 level, bool seek_table)
+  : ZstdCompressor(1, [&](i64, std::vector<u8> &) {
+      return std::string_view{(char *)buf, (size_t)size};
+    }, level, seek_table) {}
+
+// Each shard is an independent zstd frame. A seek table is a skippable
+// frame at the end that lists the compressed and decompressed sizes of
+// all frames. Decompressors that don't know about it simply skip it.
+//
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+static std::vector<u8> create_seek_table(std::span<Shard> shards) {
+  std::vector<u8> buf(8 + shards.size() * 8 + 9);
+  *(ul32 *)&buf[0] = 0x184d'2a5e;      // skippable frame magic
+  *(ul32 *)&buf[4] = buf.size() - 8;   // frame size
+
+  u8 *p = buf.data() + 8;
+  for (Shard &shard : shards) {
+    *(ul32 *)p = shard.data.size();
+    *(ul32 *)(p + 4) = shard.size;
+    p += 8;
+  }
+
+  *(ul32 *)p = shards.size();
+  p[4] = 0;                            // no checksums
+  *(ul32 *)(p + 5) = 0x8f92'eab1;      // seekable magic
+  return buf;
+}
 
+ZstdCompressor::ZstdCompressor(i64 num_groups, CompressorInput input,
+                               i64 level, bool seek_table) {
   // Compress each shard
-  tbb::parallel_for((i64)0, (i64)inputs.size(), [&](i64 i) {
-    shards[i] = zstd_compress(inputs[i]);
-  });
+  std::vector<Shard> vec =
+    compress_groups(num_groups, input, [&](std::string_view in, Shard &out) {
+      out.data = zstd_compress(in, level);
+    });
 
-  compressed_size = 0;
-  for (std::vector<u8> &shard : shards)
-    compressed_size += shard.size();
+  if (seek_table)
+    this->seek_table = create_seek_table(vec);
+
+  compressed_size = this->seek_table.size();
+  for (Shard &shard : vec) {
+    compressed_size += shard.data.size();
+    shards.push_back(std::move(shard.data));
+  }
 }
 
 void ZstdCompressor::write_to(u8 *buf) {
@@ -180,6 +273,10 @@ void ZstdCompressor::write_to(u8 *buf) {
   tbb::parallel_for((i64)0, (i64)shards.size(), [&](i64 i) {
     memcpy(buf + offsets[i], shards[i].data(), shards[i].size());
   });
+
+  if (!seek_table.empty())
+    memcpy(buf + compressed_size - seek_table.size(), seek_table.data(),
+           seek_table.size());
 }
 
 } // namespace mold
@@ -102,6 +102,15 @@ bool Glob::match(std::string_view str) {
   return do_match(str, elements);
 }
 
+// Returns the longest string that a matching string must contain.
+std::string_view Glob::get_longest_literal() const {
+  std::string_view ret;
+  for (const Element &e : elements)
+    if (e.kind == STRING && ret.size() < e.str.size())
+      ret = e.str;
+  return ret;
+}
+
 bool Glob::do_match(std::string_view str, std::span<Element> elements) {
   while (!elements.empty()) {
     Element &e = elements[0];
@@ -6,12 +6,22 @@
 // error.
 //
 // This file implements a feature that limits the number of concurrent
-// mold processes to just 1 for each user. It is intended to be used as
+// mold processes to N for each user. It is intended to be used as
 // `MOLD_JOBS=1 ninja` or `MOLD_JOBS=1 make -j$(nproc)`.
+//
+// This file also implements a GNU make jobserver client. If mold is
+// invoked by make (or any other build system that speaks the same
+// protocol), it takes as many job tokens as it can without blocking and
+// uses only as many threads as it has tokens.
+//
+// Lastly, this file reads the CPU and memory limits of the cgroup we are
+// in, as build jobs running in containers are often given a fraction of
+// the host's resources.
 
 #include "common.h"
 
 #include <fcntl.h>
+#include <fstream>
 #include <pwd.h>
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -22,29 +32,279 @@ namespace mold {
 
 static int lock_fd = -1;
 
+static std::string get_lock_path() {
+  if (char *dir = getenv("XDG_RUNTIME_DIR"))
+    return dir + "/mold-lock"s;
+  return "/tmp/mold-lock-"s + getpwuid(getuid())->pw_name;
+}
+
+static std::string read_line(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+// Returns the directories of the cgroup this process belongs to and its
+// ancestors for a given cgroup v1 controller or for cgroup v2. A limit
+// set to any of them applies to us.
+static std::vector<std::string> get_cgroup_dirs(std::string_view controller) {
+  std::vector<std::string> dirs;
+  std::ifstream in("/proc/self/cgroup");
+
+  // Each line is in the form of "ID:CONTROLLERS:PATH". ID is 0 and
+  // CONTROLLERS is empty for cgroup v2.
+  for (std::string line; std::getline(in, line);) {
+    size_t pos1 = line.find(':');
+    size_t pos2 = line.find(':', pos1 + 1);
+    if (pos1 == line.npos || pos2 == line.npos)
+      continue;
+
+    std::string controllers = line.substr(pos1 + 1, pos2 - pos1 - 1);
+    std::string path = line.substr(pos2 + 1);
+    std::string root;
+
+    if (line.starts_with("0::")) {
+      root = "/sys/fs/cgroup";
+    } else {
+      bool found = false;
+      std::string_view rest = controllers;
+      while (!rest.empty()) {
+        size_t pos = rest.find(',');
+        found |= (rest.substr(0, pos) == controller);
+        rest = (pos == rest.npos) ? "" : rest.substr(pos + 1);
+      }
+      if (!found)
+        continue;
+      root = "/sys/fs/cgroup/" + controllers;
+    }
+
+    while (path.size() > 1) {
+      dirs.push_back(root + path);
+      path = path.substr(0, path.rfind('/'));
+    }
+    dirs.push_back(root);
+  }
+  return dirs;
+}
+
+// Returns the number of CPUs' worth of time we are allowed to use by
+// cgroup's CPU bandwidth control, or -1 if unlimited. Unlike cpusets,
+// which are reflected to the CPU affinity mask, a CPU quota is not taken
+// into account by TBB, so we would start too many threads that are then
+// throttled by the scheduler.
+i64 get_cgroup_cpu_limit() {
+  i64 limit = -1;
+
+  auto update = [&](i64 quota, i64 period) {
+    if (quota > 0 && period > 0) {
+      i64 n = std::max<i64>(1, (quota + period - 1) / period);
+      limit = (limit == -1) ? n : std::min(limit, n);
+    }
+  };
+
+  // cgroup v2's cpu.max contains "QUOTA PERIOD", where QUOTA may be "max".
+  for (std::string &dir : get_cgroup_dirs("")) {
+    std::string line = read_line(dir + "/cpu.max");
+    if (!line.empty() && !line.starts_with("max"))
+      update(atol(line.c_str()), atol(line.c_str() + line.find(' ') + 1));
+  }
+
+  // cgroup v1 uses -1 as a quota for unlimited.
+  for (std::string &dir : get_cgroup_dirs("cpu"))
+    update(atol(read_line(dir + "/cpu.cfs_quota_us").c_str()),
+           atol(read_line(dir + "/cpu.cfs_period_us").c_str()));
+  return limit;
+}
+
+// Returns the memory limit in bytes, or -1 if unlimited.
+i64 get_cgroup_memory_limit() {
+  i64 limit = -1;
+
+  auto update = [&](const std::string &line) {
+    // cgroup v1 uses a huge number instead of "max" for unlimited.
+    i64 val = atol(line.c_str());
+    if (0 < val && val < (1LL << 60))
+      limit = (limit == -1) ? val : std::min(limit, val);
+  };
+
+  for (std::string &dir : get_cgroup_dirs(""))
+    update(read_line(dir + "/memory.max"));
+  for (std::string &dir : get_cgroup_dirs("memory"))
+    update(read_line(dir + "/memory.limit_in_bytes"));
+  return limit;
+}
+
+// Returns the maximum number of concurrent mold processes, or -1 if
+// unlimited. If MOLD_JOBS is not set but we are in a cgroup with a
+// memory limit, we allow as many processes as the memory allows, so
+// that running many links in parallel in a container doesn't end with
+// the out-of-memory killer.
+static i64 get_max_jobs() {
+  if (char *jobs = getenv("MOLD_JOBS")) {
+    char *end;
+    i64 n = strtol(jobs, &end, 10);
+    if (*end || n <= 0)
+      return -1;
+    return n;
+  }
+
+  constexpr i64 MEMORY_PER_JOB = 4LL * 1024 * 1024 * 1024;
+  i64 limit = get_cgroup_memory_limit();
+  if (limit == -1)
+    return -1;
+  return std::max<i64>(1, limit / MEMORY_PER_JOB);
+}
+
+// MOLD_JOBS=N is implemented with N lock files. We take the first one
+// that is not locked by other mold processes. If all of them are taken,
+// we wait for a while and try again.
 void acquire_global_lock() {
-  char *jobs = getenv("MOLD_JOBS");
-  if (!jobs || jobs != "1"s)
+  i64 n = get_max_jobs();
+  if (n == -1)
     return;
 
-  std::string path;
-  if (char *dir = getenv("XDG_RUNTIME_DIR"))
-    path = dir + "/mold-lock"s;
-  else
-    path = "/tmp/mold-lock-"s + getpwuid(getuid())->pw_name;
+  std::string path = get_lock_path();
 
-  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
-  if (fd == -1)
+  if (n == 1) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1)
+      return;
+
+    if (lockf(fd, F_LOCK, 0) == -1)
+      return;
+    lock_fd = fd;
     return;
+  }
 
-  if (lockf(fd, F_LOCK, 0) == -1)
+  std::vector<int> fds;
+  for (i64 i = 0; i < n; i++) {
+    std::string path2 = (i == 0) ? path : path + "." + std::to_string(i);
+    int fd = open(path2.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (fd != -1)
+      fds.push_back(fd);
+  }
+
+  if (fds.empty())
     return;
-  lock_fd = fd;
+
+  for (;;) {
+    for (int fd : fds) {
+      if (lockf(fd, F_TLOCK, 0) == 0) {
+        lock_fd = fd;
+        for (int fd2 : fds)
+          if (fd2 != fd)
+            close(fd2);
+        return;
+      }
+    }
+    usleep(20'000);
+  }
+}
+
+static int jobserver_rfd = -1;
+static int jobserver_wfd = -1;
+static std::string job_tokens;
+
+static bool is_fifo(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+// Opens the jobserver specified by MAKEFLAGS. GNU make 4.4 or later uses
+// a named pipe (--jobserver-auth=fifo:PATH), and older versions pass a
+// pair of inherited pipe file descriptors (--jobserver-auth=R,W).
+//
+// If the build system didn't intend to pass the file descriptors to us,
+// they may have been closed and reused for other files, so we make sure
+// that they are pipes. Otherwise, we behave as if there's no jobserver.
+//
+// We want to read tokens without blocking. We must not set O_NONBLOCK
+// to a pipe shared with other processes because the flag belongs to the
+// shared file description, so we always open a new file description.
+static bool open_jobserver() {
+  char *env = getenv("MAKEFLAGS");
+  if (!env)
+    return false;
+
+  std::string_view flags = env;
+  std::string_view auth;
+
+  for (std::string_view opt : {"--jobserver-auth="sv, "--jobserver-fds="sv}) {
+    if (size_t pos = flags.rfind(opt); pos != flags.npos) {
+      auth = flags.substr(pos + opt.size());
+      auth = auth.substr(0, auth.find(' '));
+      break;
+    }
+  }
+
+  if (auth.empty())
+    return false;
+
+  if (auth.starts_with("fifo:")) {
+    std::string path(auth.substr(5));
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1)
+      return false;
+    if (!is_fifo(fd)) {
+      close(fd);
+      return false;
+    }
+    jobserver_rfd = jobserver_wfd = fd;
+    return true;
+  }
+
+#ifdef __linux__
+  int rfd, wfd;
+  if (sscanf(std::string(auth).c_str(), "%d,%d", &rfd, &wfd) != 2)
+    return false;
+
+  // The build system may not have passed the file descriptors to us.
+  if (rfd < 0 || wfd < 0 || !is_fifo(rfd) || !is_fifo(wfd))
+    return false;
+
+  std::string path = "/proc/self/fd/" + std::to_string(rfd);
+  int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+  jobserver_rfd = fd;
+  jobserver_wfd = wfd;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Takes up to `max` job tokens from the jobserver without blocking.
+// Returns the number of tokens we got, or -1 if there's no jobserver.
+// Note that a process implicitly owns one job slot without taking a
+// token, so the number of threads we can use is one plus the return
+// value.
+i64 acquire_job_tokens(i64 max) {
+  if (!open_jobserver())
+    return -1;
+
+  while (job_tokens.size() < max) {
+    char c;
+    if (read(jobserver_rfd, &c, 1) != 1)
+      break;
+    job_tokens += c;
+  }
+  return job_tokens.size();
 }
 
+// This function may be called from a signal handler, so it must use
+// only async-signal-safe functions.
 void release_global_lock() {
-  if (lock_fd != -1)
+  if (!job_tokens.empty()) {
+    (void)!!write(jobserver_wfd, job_tokens.data(), job_tokens.size());
+    job_tokens.clear();
+  }
+
+  if (lock_fd != -1) {
     close(lock_fd);
+    lock_fd = -1;
+  }
 }
 
 } // namespace mold
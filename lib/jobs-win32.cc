@@ -1,6 +1,19 @@
+#include "common.h"
+
 namespace mold {
 
 void acquire_global_lock() {}
 void release_global_lock() {}
+i64 acquire_job_tokens(i64 max) { return -1; }
+
+// Windows has no cgroups. Job objects can limit CPU rates and memory,
+// but they are rarely used for build jobs, so we don't look at them.
+i64 get_cgroup_cpu_limit() {
+  return -1;
+}
+
+i64 get_cgroup_memory_limit() {
+  return -1;
+}
 
 } // namespace mold
@@ -1,5 +1,11 @@
 #include "common.h"
 
+#include <fstream>
+
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
 namespace mold {
 
 MappedFile *open_file_impl(const std::string &path, std::string &error) {
@@ -17,10 +23,13 @@ MappedFile *open_file_impl(const std::string &path, std::string &error) {
   MappedFile *mf = new MappedFile;
   mf->name = path;
   mf->size = st.st_size;
+  mf->dev = st.st_dev;
+  mf->ino = st.st_ino;
+  mf->mtime = st.st_mtime;
 
   if (st.st_size > 0) {
-    mf->data = (u8 *)mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
-                          MAP_PRIVATE, fd, 0);
+    mf->data = (u8 *)mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+                          fd, 0);
     if (mf->data == MAP_FAILED)
       error = path + ": mmap failed: " + errno_string();
   }
@@ -30,12 +39,125 @@ MappedFile *open_file_impl(const std::string &path, std::string &error) {
 }
 
 void MappedFile::unmap() {
-  if (size == 0 || parent || !data)
+  if (size == 0 || parent || !data || is_borrowed)
     return;
   munmap(data, size);
   data = nullptr;
 }
 
+// Ask the kernel to start reading the file into the page cache in the
+// background. If the page cache is cold, this is much faster than
+// faulting the file in one page at a time as we parse it.
+void MappedFile::prefetch() {
+  if (size == 0 || parent || !data || is_borrowed)
+    return;
+  madvise(data, size, MADV_WILLNEED);
+}
+
+// Ask the kernel to map this file with 2 MiB pages to reduce TLB misses.
+//
+// A file page can be mapped with a huge page only if its address is
+// congruent to its file offset modulo the huge page size, and mmap(2)
+// doesn't guarantee that. So if the mapping is not aligned, we reserve
+// a slightly larger address range and map the file again at an aligned
+// address in it with MAP_FIXED. This has to be called before anyone
+// takes a pointer into the file.
+void MappedFile::use_huge_pages() {
+#ifdef MADV_HUGEPAGE
+  i64 huge_page_size = 2 * 1024 * 1024;
+  if (size < huge_page_size || parent || !data || is_borrowed)
+    return;
+
+  if ((u64)data % huge_page_size) {
+    i64 fd = ::open(name.c_str(), O_RDONLY);
+    if (fd == -1)
+      return;
+
+    // The file may have been replaced since we mapped it.
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_dev != dev || st.st_ino != ino ||
+        st.st_mtime != mtime || st.st_size != size) {
+      close(fd);
+      return;
+    }
+
+    i64 reserved_size = size + huge_page_size;
+    u8 *reserved = (u8 *)mmap(nullptr, reserved_size, PROT_NONE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                              -1, 0);
+    if (reserved == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+
+    u8 *aligned = (u8 *)align_to((u64)reserved, huge_page_size);
+    void *p = mmap(aligned, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) {
+      munmap(reserved, reserved_size);
+      return;
+    }
+
+    // Give back the unused parts of the reserved range.
+    i64 page_size = sysconf(_SC_PAGESIZE);
+    u8 *tail = (u8 *)align_to((u64)(aligned + size), page_size);
+    if (reserved < aligned)
+      munmap(reserved, aligned - reserved);
+    if (tail < reserved + reserved_size)
+      munmap(tail, reserved + reserved_size - tail);
+
+    munmap(data, size);
+    data = aligned;
+  }
+
+  madvise(data, align_down(size, huge_page_size), MADV_HUGEPAGE);
+#endif
+}
+
+// Drop the pages of this file from our address space. The mapping itself
+// stays valid, and if we touch it again, the pages are read back from the
+// file. Since an archive member may share its first and last pages with
+// its neighbors, we release only pages that are entirely within the file.
+void MappedFile::release() {
+  release(0, size);
+}
+
+// Same as above, but drops only the pages within a given range of the
+// file, as long as the range is entirely within the file.
+void MappedFile::release(i64 offset, i64 len) {
+  if (len <= 0 || !data || is_borrowed || offset < 0 || size < offset + len)
+    return;
+
+  i64 page_size = sysconf(_SC_PAGESIZE);
+  u64 begin = align_to((u64)(data + offset), page_size);
+  u64 end = align_down((u64)(data + offset + len), page_size);
+  if (begin < end)
+    madvise((void *)begin, end - begin, MADV_DONTNEED);
+}
+
+// Returns the number of bytes of this file that are currently in our
+// address space. This is for --stats.
+i64 MappedFile::get_resident_size() {
+  if (size == 0 || parent || !data || is_borrowed)
+    return 0;
+
+  i64 page_size = sysconf(_SC_PAGESIZE);
+  i64 num_pages = align_to(size, page_size) / page_size;
+  std::vector<u8> vec(num_pages);
+#ifdef __APPLE__
+  if (mincore(data, size, (char *)vec.data()) == -1)
+#else
+  if (mincore(data, size, vec.data()) == -1)
+#endif
+    return 0;
+
+  i64 n = 0;
+  for (u8 c : vec)
+    n += (c & 1);
+  return std::min(n * page_size, size);
+}
+
 void MappedFile::close_fd() {
   if (fd == -1)
     return;
@@ -48,4 +170,46 @@ void MappedFile::reopen_fd(const std::string &path) {
     fd = open(path.c_str(), O_RDONLY);
 }
 
+#ifdef __linux__
+// Returns a bitmask of online NUMA nodes. The file contains a list of
+// node ranges such as "0-1,3".
+static u64 get_numa_nodes() {
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string str;
+  if (!std::getline(in, str))
+    return 0;
+
+  u64 mask = 0;
+  for (std::string_view s = str; !s.empty();) {
+    std::string_view range = s.substr(0, s.find(','));
+    s = (range.size() == s.size()) ? "" : s.substr(range.size() + 1);
+
+    size_t pos = range.find('-');
+    i64 lo = std::atoi(std::string(range.substr(0, pos)).c_str());
+    i64 hi = (pos == range.npos) ? lo :
+      std::atoi(std::string(range.substr(pos + 1)).c_str());
+    for (i64 i = lo; i <= hi && i < 64; i++)
+      mask |= 1LL << i;
+  }
+  return mask;
+}
+#endif
+
+void interleave_memory(void *addr, i64 size) {
+#ifdef __linux__
+  // Small buffers are not worth a system call.
+  if (size < 1024 * 1024)
+    return;
+
+  static u64 nodes = get_numa_nodes();
+  if (std::popcount(nodes) < 2)
+    return;
+
+  // We call mbind(2) directly to not depend on libnuma.
+  // 3 is MPOL_INTERLEAVE.
+  unsigned long mask = nodes;
+  syscall(SYS_mbind, addr, size, 3, &mask, sizeof(mask) * 8 + 1, 0);
+#endif
+}
+
 } // namespace mold
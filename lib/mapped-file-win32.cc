@@ -41,7 +41,7 @@ MappedFile *open_file_impl(const std::string &path, std::string &error) {
       return nullptr;
     }
 
-    mf->data = (u8 *)MapViewOfFile(h, FILE_MAP_COPY, 0, 0, size);
+    mf->data = (u8 *)MapViewOfFile(h, FILE_MAP_READ, 0, 0, size);
     CloseHandle(h);
 
     if (!mf->data) {
@@ -54,7 +54,7 @@ MappedFile *open_file_impl(const std::string &path, std::string &error) {
 }
 
 void MappedFile::unmap() {
-  if (size == 0 || parent || !data)
+  if (size == 0 || parent || !data || is_borrowed)
     return;
 
   UnmapViewOfFile(data);
@@ -64,6 +64,18 @@ void MappedFile::unmap() {
   data = nullptr;
 }
 
+void MappedFile::prefetch() {}
+
+void MappedFile::use_huge_pages() {}
+
+void MappedFile::release() {}
+
+void MappedFile::release(i64 offset, i64 len) {}
+
+i64 MappedFile::get_resident_size() {
+  return (parent || !data) ? 0 : size;
+}
+
 void MappedFile::close_fd() {
   if (fd == INVALID_HANDLE_VALUE)
     return;
@@ -78,4 +90,6 @@ void MappedFile::reopen_fd(const std::string &path) {
                      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
 }
 
+void interleave_memory(void *addr, i64 size) {}
+
 } // namespace mold
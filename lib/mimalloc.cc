@@ -1,3 +1,7 @@
+#include "config.h"
+
+#include <cstdint>
+
 // Including mimalloc-new-delete.h overrides new/delete operators.
 // We need it only when we are using mimalloc as a dynamic library.
 #if MOLD_USE_SYSTEM_MIMALLOC
@@ -13,10 +17,41 @@ void set_mimalloc_options() {
   mi_option_disable(mi_option_verbose);
   mi_option_disable(mi_option_show_errors);
 }
+
+// Returns the number of bytes mimalloc has currently committed. This is
+// reported for each phase by --perf.
+int64_t get_mimalloc_commit() {
+  size_t current_commit = 0;
+  mi_process_info(nullptr, nullptr, nullptr, nullptr, nullptr,
+                  &current_commit, nullptr, nullptr);
+  return current_commit;
+}
+
+// Returns the peak number of bytes mimalloc has committed. This is
+// reported by --stats.
+int64_t get_mimalloc_peak_commit() {
+  size_t peak_commit = 0;
+  mi_process_info(nullptr, nullptr, nullptr, nullptr, nullptr,
+                  nullptr, &peak_commit, nullptr);
+  return peak_commit;
+}
+
+// mimalloc keeps freed memory committed for a while so that it can
+// reuse it quickly. We call this at the end of a link phase that freed
+// a lot of memory to return it to the OS, so that memory is available
+// to other processes, e.g., other linker processes running in parallel.
+// Note that this can release only memory freed by the calling thread or
+// by threads that have exited.
+void release_free_memory() {
+  mi_collect(true);
+}
 }
 
 #else
 namespace mold {
 void set_mimalloc_options() {}
+int64_t get_mimalloc_commit() { return 0; }
+int64_t get_mimalloc_peak_commit() { return 0; }
+void release_free_memory() {}
 }
 #endif
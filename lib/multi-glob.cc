@@ -14,8 +14,11 @@
 //
 // Aho-Corasick cannot handle complex patterns such as `*foo*bar*`.
 // We handle such patterns with the Glob class. Glob is relatively
-// slow, but complex patterns are rare in practice, so it should be
-// OK.
+// slow, so we don't want to try every complex pattern for each string.
+// A string that matches a complex pattern must contain the longest
+// literal part of the pattern (e.g. "bar" for `*foo*bar*`), so we build
+// another Aho-Corasick automaton from the literals to find candidate
+// patterns and run Glob only for them.
 
 #include "common.h"
 
@@ -33,9 +36,8 @@ std::optional<i64> MultiGlob::find(std::string_view str) {
     val = find_aho_corasick(str);
 
   // Match against complex glob patterns
-  for (std::pair<Glob, i64> &glob : globs)
-    if (glob.first.match(str))
-      val = std::max(val, glob.second);
+  if (!globs.empty())
+    val = find_globs(str, val);
 
   if (val == -1)
     return {};
@@ -72,6 +74,42 @@ i64 MultiGlob::find_aho_corasick(std::string_view str) {
   return val;
 }
 
+i64 MultiGlob::find_globs(std::string_view str, i64 val) {
+  auto try_glob = [&](i64 i) {
+    if (val < globs[i].second && globs[i].first.match(str))
+      val = globs[i].second;
+  };
+
+  for (i64 i : unindexed_globs)
+    try_glob(i);
+
+  if (!literal_root)
+    return val;
+
+  // Find patterns whose literals appear in a given string
+  std::vector<i32> candidates;
+  TrieNode *node = literal_root.get();
+
+  for (u8 c : str) {
+    for (;;) {
+      if (node->children[c]) {
+        node = node->children[c].get();
+        break;
+      }
+      if (!node->suffix_link)
+        break;
+      node = node->suffix_link;
+    }
+    append(candidates, node->globs);
+  }
+
+  sort(candidates);
+  remove_duplicates(candidates);
+  for (i64 i : candidates)
+    try_glob(i);
+  return val;
+}
+
 static bool is_simple_pattern(std::string_view pat) {
   static std::regex re(R"(\*?[^*[?]+\*?)", std::regex_constants::optimize);
   return std::regex_match(pat.begin(), pat.end(), re);
@@ -100,11 +138,28 @@ bool MultiGlob::add(std::string_view pat, i64 val) {
 
   // Complex glob pattern
   if (!is_simple_pattern(pat)) {
-    if (std::optional<Glob> glob = Glob::compile(pat)) {
-      globs.push_back({std::move(*glob), val});
-      return true;
+    std::optional<Glob> glob = Glob::compile(pat);
+    if (!glob)
+      return false;
+
+    std::string_view lit = glob->get_longest_literal();
+    if (lit.empty()) {
+      unindexed_globs.push_back(globs.size());
+    } else {
+      if (!literal_root)
+        literal_root.reset(new TrieNode);
+      TrieNode *node = literal_root.get();
+
+      for (u8 c : lit) {
+        if (!node->children[c])
+          node->children[c].reset(new TrieNode);
+        node = node->children[c].get();
+      }
+      node->globs.push_back(globs.size());
     }
-    return false;
+
+    globs.push_back({std::move(*glob), val});
+    return true;
   }
 
   // Simple glob pattern
@@ -124,9 +179,14 @@ bool MultiGlob::add(std::string_view pat, i64 val) {
 
 void MultiGlob::compile() {
   is_compiled = true;
+  if (literal_root) {
+    fix_suffix_links(*literal_root);
+    fix_values(*literal_root);
+  }
+
   if (root) {
     fix_suffix_links(*root);
-    fix_values();
+    fix_values(*root);
 
     // If no pattern starts with '*', set prefix_match to true.
     // We'll use this flag for optimization.
@@ -140,35 +200,46 @@ void MultiGlob::compile() {
   }
 }
 
-void MultiGlob::fix_suffix_links(TrieNode &node) {
-  for (i64 i = 0; i < 256; i++) {
-    if (!node.children[i])
-      continue;
+// Suffix links are computed in BFS order because a node's suffix link
+// is derived from the suffix links of shallower nodes, which therefore
+// have to be fixed first.
+void MultiGlob::fix_suffix_links(TrieNode &root) {
+  std::queue<TrieNode *> queue;
+  queue.push(&root);
 
-    TrieNode &child = *node.children[i];
+  do {
+    TrieNode *node = queue.front();
+    queue.pop();
 
-    TrieNode *cur = node.suffix_link;
-    for (;;) {
-      if (!cur) {
-        child.suffix_link = root.get();
-        break;
-      }
+    for (i64 i = 0; i < 256; i++) {
+      if (!node->children[i])
+        continue;
 
-      if (cur->children[i]) {
-        child.suffix_link = cur->children[i].get();
-        break;
+      TrieNode &child = *node->children[i];
+
+      TrieNode *cur = node->suffix_link;
+      for (;;) {
+        if (!cur) {
+          child.suffix_link = &root;
+          break;
+        }
+
+        if (cur->children[i]) {
+          child.suffix_link = cur->children[i].get();
+          break;
+        }
+
+        cur = cur->suffix_link;
       }
 
-      cur = cur->suffix_link;
+      queue.push(&child);
     }
-
-    fix_suffix_links(child);
-  }
+  } while (!queue.empty());
 }
 
-void MultiGlob::fix_values() {
+void MultiGlob::fix_values(TrieNode &root) {
   std::queue<TrieNode *> queue;
-  queue.push(root.get());
+  queue.push(&root);
 
   do {
     TrieNode *node = queue.front();
@@ -178,6 +249,7 @@ void MultiGlob::fix_values() {
       if (!child)
         continue;
       child->value = std::max(child->value, child->suffix_link->value);
+      append(child->globs, child->suffix_link->globs);
       queue.push(child.get());
     }
   } while (!queue.empty());
@@ -3,10 +3,22 @@
 #include <functional>
 #include <iomanip>
 #include <ios>
+#include <map>
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#include <thread>
 
 #ifndef _WIN32
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/syscall.h>
 #endif
 
 namespace mold {
@@ -25,11 +37,31 @@ void Counter::print() {
               << "=" << c->get_value() << "\n";
 }
 
-static i64 now_nsec() {
-  return (i64)std::chrono::steady_clock::now().time_since_epoch().count();
+// Clears all counters for another link in the same process.
+void Counter::reset() {
+  enabled = false;
+  for (Counter *c : instances)
+    c->values.clear();
+}
+
+namespace {
+struct Usage {
+  i64 user = 0;
+  i64 sys = 0;
+  i64 maxrss = 0;
+  i64 minflt = 0;
+  i64 majflt = 0;
+  i64 commit = 0;
+};
 }
 
-static std::pair<i64, i64> get_usage() {
+// Returns resource usage of this process. Note that the peak resident
+// set size never decreases, so the value recorded at the end of a phase
+// is the peak RSS of that phase or of an earlier one.
+static Usage get_usage() {
+  Usage u;
+  u.commit = get_mimalloc_commit();
+
 #ifdef _WIN32
   auto to_nsec = [](FILETIME t) -> i64 {
     return (((u64)t.dwHighDateTime << 32) + (u64)t.dwLowDateTime) * 100;
@@ -37,7 +69,8 @@ static std::pair<i64, i64> get_usage() {
 
   FILETIME creation, exit, kernel, user;
   GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
-  return {to_nsec(user), to_nsec(kernel)};
+  u.user = to_nsec(user);
+  u.sys = to_nsec(kernel);
 #else
   auto to_nsec = [](struct timeval t) -> i64 {
     return (i64)t.tv_sec * 1'000'000'000 + t.tv_usec * 1'000;
@@ -45,14 +78,439 @@ static std::pair<i64, i64> get_usage() {
 
   struct rusage ru;
   getrusage(RUSAGE_SELF, &ru);
-  return {to_nsec(ru.ru_utime), to_nsec(ru.ru_stime)};
+  u.user = to_nsec(ru.ru_utime);
+  u.sys = to_nsec(ru.ru_stime);
+  u.minflt = ru.ru_minflt;
+  u.majflt = ru.ru_majflt;
+#ifdef __APPLE__
+  u.maxrss = ru.ru_maxrss;
+#else
+  u.maxrss = (i64)ru.ru_maxrss * 1024;
+#endif
+#endif
+  return u;
+}
+
+// --perf=hw counts CPU cycles, instructions, last-level cache misses and
+// data TLB misses with perf_event_open(2). Hardware counters are per
+// thread, so we open counters for each thread as it joins the TBB
+// scheduler, and a timer records the sum of the counters of all threads.
+// Like user and system time, the numbers are for the entire process.
+static std::atomic_bool hw_counters_enabled;
+
+#ifdef __linux__
+static std::mutex hw_counters_mu;
+static std::vector<std::array<int, NUM_HW_COUNTERS>> hw_counter_fds;
+
+static std::array<int, NUM_HW_COUNTERS> open_hw_counters() {
+  static constexpr std::pair<u32, u64> events[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+  };
+
+  std::array<int, NUM_HW_COUNTERS> fds;
+  for (i64 i = 0; i < NUM_HW_COUNTERS; i++) {
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = events[i].first;
+    attr.config = events[i].second;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                     PERF_FLAG_FD_CLOEXEC);
+  }
+  return fds;
+}
+
+static void open_thread_hw_counters() {
+  thread_local bool opened = false;
+  if (opened)
+    return;
+  opened = true;
+
+  std::array<int, NUM_HW_COUNTERS> fds = open_hw_counters();
+  std::scoped_lock lock(hw_counters_mu);
+  hw_counter_fds.push_back(fds);
+}
+
+namespace {
+class HwCounterObserver : public tbb::task_scheduler_observer {
+public:
+  HwCounterObserver() { observe(true); }
+  void on_scheduler_entry(bool is_worker) override {
+    open_thread_hw_counters();
+  }
+};
+}
+
+bool enable_hw_counters() {
+  std::array<int, NUM_HW_COUNTERS> fds = open_hw_counters();
+  if (fds[0] == -1)
+    return false;
+
+  for (int fd : fds)
+    if (fd != -1)
+      close(fd);
+
+  open_thread_hw_counters();
+  static HwCounterObserver observer;
+  hw_counters_enabled = true;
+  return true;
+}
+
+static std::array<i64, NUM_HW_COUNTERS> read_hw_counters() {
+  std::array<i64, NUM_HW_COUNTERS> vals = {};
+  if (!hw_counters_enabled)
+    return vals;
+
+  std::scoped_lock lock(hw_counters_mu);
+  for (std::array<int, NUM_HW_COUNTERS> &fds : hw_counter_fds) {
+    for (i64 i = 0; i < NUM_HW_COUNTERS; i++) {
+      u64 val;
+      if (fds[i] != -1 && read(fds[i], &val, sizeof(val)) == sizeof(val))
+        vals[i] += val;
+    }
+  }
+  return vals;
+}
+#else
+bool enable_hw_counters() {
+  return false;
+}
+
+static std::array<i64, NUM_HW_COUNTERS> read_hw_counters() {
+  return {};
+}
+#endif
+
+// Returns an ID of the current thread. On Linux, it's the same number
+// as the one shown by tools such as top or perf.
+static i64 get_thread_id() {
+#ifdef __linux__
+  return syscall(SYS_gettid);
+#else
+  return std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffff'ffff;
+#endif
+}
+
+// The trace ring buffer. Each event is written by a single thread that
+// claimed its slot, and `seq` is updated last so that a reader can tell
+// if a slot contains a complete event. Events are small and fixed-size
+// so that recording one is just a few stores.
+namespace {
+struct TraceEvent {
+  std::atomic<i64> seq = -1;
+  i64 time = 0;
+  i64 start = -1;
+  i64 tid = 0;
+  char name[40] = {};
+};
+}
+
+static constexpr i64 NUM_TRACE_EVENTS = 1024;
+static TraceEvent trace_events[NUM_TRACE_EVENTS];
+static std::atomic<i64> next_trace_seq;
+static i64 trace_origin = now_nsec();
+
+static i64 add_trace_event(std::string_view name, i64 start) {
+  thread_local i64 tid = get_thread_id();
+
+  i64 seq = next_trace_seq.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent &ev = trace_events[seq % NUM_TRACE_EVENTS];
+  ev.seq.store(-1, std::memory_order_relaxed);
+  ev.time = now_nsec();
+  ev.start = start;
+  ev.tid = tid;
+
+  i64 len = std::min<i64>(name.size(), sizeof(ev.name) - 1);
+  memcpy(ev.name, name.data(), len);
+  ev.name[len] = '\0';
+  ev.seq.store(seq, std::memory_order_release);
+  return seq;
+}
+
+i64 begin_trace_event(std::string_view name) {
+  return add_trace_event(name, -1);
+}
+
+// An end event has a copy of the name and the start time of the begin
+// event, unless the ring buffer has wrapped around since then. The slot
+// may be reused while we are copying it, so we check `seq` both before
+// and after reading it.
+void end_trace_event(i64 seq) {
+  TraceEvent &begin = trace_events[seq % NUM_TRACE_EVENTS];
+  if (begin.seq.load(std::memory_order_acquire) != seq) {
+    add_trace_event("?", -1);
+    return;
+  }
+
+  char name[sizeof(begin.name)];
+  i64 start = begin.time;
+  memcpy(name, begin.name, sizeof(name));
+  name[sizeof(name) - 1] = '\0';
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (begin.seq.load(std::memory_order_relaxed) == seq)
+    add_trace_event(name, start);
+  else
+    add_trace_event("?", -1);
+}
+
+// A line buffer for print_trace_events(). snprintf() is not
+// async-signal-safe, so we format numbers by hand.
+namespace {
+class TraceWriter {
+public:
+  void put(std::string_view str) {
+    i64 n = std::min<i64>(str.size(), sizeof(buf) - len);
+    memcpy(buf + len, str.data(), n);
+    len += n;
+  }
+
+  // Writes an integer right-aligned in `width` columns.
+  void put_int(i64 val, i64 width) {
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p = format_uint(end, (val < 0) ? -(u64)val : val);
+    if (val < 0)
+      *--p = '-';
+    pad(p, end, width);
+  }
+
+  // Writes nanoseconds as milliseconds with three fractional digits
+  // right-aligned in `width` columns.
+  void put_msec(i64 nsec, i64 width) {
+    u64 usec = ((nsec < 0) ? -(u64)nsec : nsec) / 1000;
+    char tmp[32];
+    char *end = tmp + sizeof(tmp);
+    char *p = end;
+    for (i64 i = 0; i < 3; i++) {
+      *--p = '0' + usec % 10;
+      usec /= 10;
+    }
+    *--p = '.';
+    p = format_uint(p, usec);
+    if (nsec < 0)
+      *--p = '-';
+    pad(p, end, width);
+  }
+
+  void flush() {
+#ifdef _WIN32
+    (void)!_write(_fileno(stderr), buf, len);
+#else
+    (void)!write(STDERR_FILENO, buf, len);
+#endif
+    len = 0;
+  }
+
+private:
+  static char *format_uint(char *p, u64 val) {
+    do {
+      *--p = '0' + val % 10;
+      val /= 10;
+    } while (val);
+    return p;
+  }
+
+  void pad(char *begin, char *end, i64 width) {
+    for (i64 i = end - begin; i < width; i++)
+      put(" ");
+    put({begin, (size_t)(end - begin)});
+  }
+
+  char buf[200];
+  i64 len = 0;
+};
+}
+
+// This function is called from signal handlers, so it doesn't allocate
+// memory and writes to stderr directly.
+void print_trace_events() {
+  i64 end = next_trace_seq.load(std::memory_order_acquire);
+  i64 begin = std::max<i64>(0, end - NUM_TRACE_EVENTS);
+
+  TraceWriter out;
+  out.put("mold: last ");
+  out.put_int(end - begin, 0);
+  out.put(" timer events (ms since start):\n");
+  out.flush();
+
+  for (i64 i = begin; i < end; i++) {
+    TraceEvent &ev = trace_events[i % NUM_TRACE_EVENTS];
+    if (ev.seq.load(std::memory_order_acquire) != i)
+      continue;
+
+    out.put_msec(ev.time - trace_origin, 10);
+    out.put(" ");
+    out.put_int(ev.tid, 8);
+
+    if (ev.start == -1) {
+      out.put("  begin ");
+      out.put(ev.name);
+    } else {
+      out.put("  end   ");
+      out.put(ev.name);
+      out.put(" (");
+      out.put_msec(ev.time - ev.start, 0);
+      out.put(" ms)");
+    }
+    out.put("\n");
+    out.flush();
+  }
+}
+
+static i64 get_process_id() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return getpid();
 #endif
 }
 
+// --perf=threads records when each TBB worker thread joins and leaves
+// the task arena, so that we can tell how many threads were running
+// during each pass. From that, we compute the total busy time of all
+// threads and the time during which only the main thread was running
+// for each timer. The main thread is always considered busy because it
+// is either running serial code or participating in parallel work.
+//
+// Note that a worker thread that has run out of tasks spins for a while
+// before it leaves the arena, and that time is counted as busy. So the
+// numbers are upper bounds of the actual thread utilization.
+namespace {
+struct BusyInterval {
+  i64 tid;
+  i64 tbb_thread;
+  i64 start;
+  i64 end;
+};
+
+struct WorkerState {
+  i64 tid;
+  i64 tbb_thread = -1;
+  std::atomic<i64> since = -1;
+};
+}
+
+static std::atomic_bool thread_util_enabled;
+static tbb::concurrent_vector<BusyInterval> busy_intervals;
+static tbb::concurrent_vector<std::unique_ptr<WorkerState>> worker_states;
+
+static WorkerState &get_worker_state() {
+  thread_local WorkerState *state;
+  if (!state) {
+    state = new WorkerState{get_thread_id()};
+    worker_states.emplace_back(state);
+  }
+  return *state;
+}
+
+namespace {
+class ThreadUtilObserver : public tbb::task_scheduler_observer {
+public:
+  ThreadUtilObserver() { observe(true); }
+
+  void on_scheduler_entry(bool is_worker) override {
+    if (!is_worker)
+      return;
+    WorkerState &state = get_worker_state();
+    state.tbb_thread = tbb::this_task_arena::current_thread_index();
+    state.since = now_nsec();
+  }
+
+  void on_scheduler_exit(bool is_worker) override {
+    if (!is_worker)
+      return;
+    WorkerState &state = get_worker_state();
+    if (i64 since = state.since.exchange(-1); since != -1)
+      busy_intervals.push_back({state.tid, state.tbb_thread, since,
+                                now_nsec()});
+  }
+};
+}
+
+void enable_thread_utilization() {
+  static ThreadUtilObserver observer;
+  thread_util_enabled = true;
+}
+
+static i64 get_thread_count() {
+  return tbb::global_control::active_value(
+    tbb::global_control::max_allowed_parallelism);
+}
+
+// Fills in `busy` and `serial` of given timer records.
+static void compute_thread_utilization(
+    tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &records) {
+  if (!thread_util_enabled)
+    return;
+
+  // Close the intervals of threads that are still in the arena.
+  i64 now = now_nsec();
+  for (std::unique_ptr<WorkerState> &state : worker_states)
+    if (i64 since = state->since.exchange(-1); since != -1)
+      busy_intervals.push_back({state->tid, state->tbb_thread, since, now});
+
+  // Convert intervals to a sorted list of events. An event is a pair of
+  // a timestamp and +1 or -1 which is the change of the number of
+  // running worker threads at that time.
+  std::vector<std::pair<i64, i64>> events;
+  for (BusyInterval &x : busy_intervals) {
+    events.push_back({x.start, 1});
+    events.push_back({x.end, -1});
+  }
+  sort(events);
+
+  tbb::parallel_for((i64)0, (i64)records.size(), [&](i64 i) {
+    TimerRecord *rec = records[i].get();
+    i64 busy = rec->end - rec->start;
+    i64 serial = 0;
+    i64 running = 0;
+    i64 last = rec->start;
+
+    for (auto [time, delta] : events) {
+      if (rec->end <= time)
+        break;
+      if (rec->start < time) {
+        busy += running * (time - last);
+        if (running == 0)
+          serial += time - last;
+        last = time;
+      }
+      running += delta;
+    }
+
+    busy += running * (rec->end - last);
+    if (running == 0)
+      serial += rec->end - last;
+
+    rec->busy = busy;
+    rec->serial = serial;
+  });
+}
+
 TimerRecord::TimerRecord(std::string name, TimerRecord *parent)
   : name(name), parent(parent) {
   start = now_nsec();
-  std::tie(user, sys) = get_usage();
+
+  Usage u = get_usage();
+  user = u.user;
+  sys = u.sys;
+  maxrss = u.maxrss;
+  minflt = u.minflt;
+  majflt = u.majflt;
+  commit = u.commit;
+  hw = read_hw_counters();
+
+  tid = get_thread_id();
+  tbb_thread = tbb::this_task_arena::current_thread_index();
   if (parent)
     parent->children.push_back(this);
 }
@@ -62,22 +520,53 @@ void TimerRecord::stop() {
     return;
   stopped = true;
 
-  i64 user2;
-  i64 sys2;
-  std::tie(user2, sys2) = get_usage();
-
+  Usage u = get_usage();
   end = now_nsec();
-  user = user2 - user;
-  sys = sys2 - sys;
+  user = u.user - user;
+  sys = u.sys - sys;
+  rss_growth = u.maxrss - maxrss;
+  maxrss = u.maxrss;
+  minflt = u.minflt - minflt;
+  majflt = u.majflt - majflt;
+  commit = u.commit - commit;
+
+  std::array<i64, NUM_HW_COUNTERS> hw2 = read_hw_counters();
+  for (i64 i = 0; i < NUM_HW_COUNTERS; i++)
+    hw[i] = hw2[i] - hw[i];
 }
 
 static void print_rec(TimerRecord &rec, i64 indent) {
-  printf(" % 8.3f % 8.3f % 8.3f  %s%s\n",
+  printf(" % 8.3f % 8.3f % 8.3f % 8lld % 8lld % 8lld % 8lld % 8lld",
          ((double)rec.user / 1'000'000'000),
          ((double)rec.sys / 1'000'000'000),
          (((double)rec.end - rec.start) / 1'000'000'000),
-         std::string(indent * 2, ' ').c_str(),
-         rec.name.c_str());
+         (long long)(rec.maxrss / 1024 / 1024),
+         (long long)(rec.rss_growth / 1024 / 1024),
+         (long long)(rec.commit / 1024 / 1024),
+         (long long)rec.majflt,
+         (long long)rec.minflt);
+
+  // Cycles and instructions are in millions, and misses in thousands.
+  if (hw_counters_enabled)
+    printf(" % 8lld % 8lld % 8.2f % 8lld % 8lld",
+           (long long)(rec.hw[0] / 1'000'000),
+           (long long)(rec.hw[1] / 1'000'000),
+           rec.hw[0] ? (double)rec.hw[1] / rec.hw[0] : 0.0,
+           (long long)(rec.hw[2] / 1000),
+           (long long)(rec.hw[3] / 1000));
+
+  // Busy time of all threads, parallel efficiency (the busy time divided
+  // by the wall clock time multiplied by the number of threads) and the
+  // time during which only the main thread was running.
+  if (thread_util_enabled) {
+    i64 wall = rec.end - rec.start;
+    printf(" % 8.3f % 7.1f%% % 8.3f",
+           ((double)rec.busy / 1'000'000'000),
+           wall ? (double)rec.busy * 100 / wall / get_thread_count() : 0.0,
+           ((double)rec.serial / 1'000'000'000));
+  }
+
+  printf("  %s%s\n", std::string(indent * 2, ' ').c_str(), rec.name.c_str());
 
   sort(rec.children, [](TimerRecord *a, TimerRecord *b) {
     return a->start < b->start;
@@ -87,10 +576,16 @@ static void print_rec(TimerRecord &rec, i64 indent) {
     print_rec(*child, indent + 1);
 }
 
-void print_timer_records(
+static void stop_timer_records(
     tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &records) {
   for (i64 i = records.size() - 1; i >= 0; i--)
     records[i]->stop();
+}
+
+void print_timer_records(
+    tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &records) {
+  stop_timer_records(records);
+  compute_thread_utilization(records);
 
   for (i64 i = 0; i < records.size(); i++) {
     TimerRecord &inner = *records[i];
@@ -107,7 +602,13 @@ void print_timer_records(
     }
   }
 
-  std::cout << "     User   System     Real  Name\n";
+  std::cout << "     User   System     Real   MaxRSS    +RSS  +Commit"
+               "   MajFlt   MinFlt";
+  if (hw_counters_enabled)
+    std::cout << "   Cycles    Insns      IPC  LLCMiss dTLBMiss";
+  if (thread_util_enabled)
+    std::cout << "     Busy    Effic   Serial";
+  std::cout << "  Name\n";
 
   for (std::unique_ptr<TimerRecord> &rec : records)
     if (!rec->parent)
@@ -116,4 +617,107 @@ void print_timer_records(
   std::cout << std::flush;
 }
 
+std::string json_escape(std::string_view str) {
+  std::string buf;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      buf += '\\';
+      buf += c;
+    } else if ((u8)c < 0x20) {
+      char tmp[7];
+      snprintf(tmp, sizeof(tmp), "\\u%04x", (u8)c);
+      buf += tmp;
+    } else {
+      buf += c;
+    }
+  }
+  return buf;
+}
+
+// Writes timer records in the Chrome trace event format, which can be
+// viewed with chrome://tracing or https://ui.perfetto.dev. Unlike the
+// text output of print_timer_records(), it shows which thread ran each
+// timer and when, so it's useful to find serial parts and load
+// imbalance among threads.
+//
+// Note that user and system times and page fault counts are those of
+// the entire process and not of the thread that ran a timer.
+void write_timer_trace(
+    tbb::concurrent_vector<std::unique_ptr<TimerRecord>> &records,
+    std::ostream &out) {
+  stop_timer_records(records);
+  compute_thread_utilization(records);
+
+  i64 origin = INT64_MAX;
+  for (std::unique_ptr<TimerRecord> &rec : records)
+    origin = std::min(origin, rec->start);
+
+  i64 pid = get_process_id();
+  std::map<i64, i64> threads;
+
+  out << "{\"traceEvents\":[\n";
+
+  auto to_usec = [](i64 nsec) { return (double)nsec / 1000; };
+
+  for (i64 i = 0; i < records.size(); i++) {
+    TimerRecord &rec = *records[i];
+    threads[rec.tid] = rec.tbb_thread;
+
+    out << "{\"name\":\"" << json_escape(rec.name) << "\",\"ph\":\"X\""
+        << std::fixed << std::setprecision(3)
+        << ",\"ts\":" << to_usec(rec.start - origin)
+        << ",\"dur\":" << to_usec(rec.end - rec.start)
+        << ",\"pid\":" << pid << ",\"tid\":" << rec.tid
+        << ",\"args\":{\"user_ms\":" << (double)rec.user / 1'000'000
+        << ",\"sys_ms\":" << (double)rec.sys / 1'000'000
+        << ",\"maxrss_mb\":" << rec.maxrss / 1024 / 1024
+        << ",\"rss_growth_mb\":" << rec.rss_growth / 1024 / 1024
+        << ",\"commit_mb\":" << rec.commit / 1024 / 1024
+        << ",\"majflt\":" << rec.majflt << ",\"minflt\":" << rec.minflt;
+
+    if (hw_counters_enabled)
+      out << ",\"cycles\":" << rec.hw[0] << ",\"instructions\":" << rec.hw[1]
+          << ",\"llc_misses\":" << rec.hw[2]
+          << ",\"dtlb_misses\":" << rec.hw[3];
+
+    if (thread_util_enabled) {
+      i64 wall = rec.end - rec.start;
+      out << ",\"busy_ms\":" << (double)rec.busy / 1'000'000
+          << ",\"efficiency\":"
+          << (wall ? (double)rec.busy / wall / get_thread_count() : 0.0)
+          << ",\"serial_ms\":" << (double)rec.serial / 1'000'000;
+    }
+
+    out << ",\"tbb_thread\":" << rec.tbb_thread << "}},\n";
+  }
+
+  // Show when each worker thread was in the task arena
+  if (thread_util_enabled) {
+    for (BusyInterval &x : busy_intervals) {
+      if (x.end <= origin)
+        continue;
+      i64 start = std::max(x.start, origin);
+      threads.insert({x.tid, x.tbb_thread});
+      out << "{\"name\":\"busy\",\"ph\":\"X\""
+          << ",\"ts\":" << to_usec(start - origin)
+          << ",\"dur\":" << to_usec(x.end - start)
+          << ",\"pid\":" << pid << ",\"tid\":" << x.tid << "},\n";
+    }
+  }
+
+  // Give threads readable names
+  for (auto [tid, tbb_thread] : threads) {
+    std::string name = (tbb_thread < 0)
+      ? "thread " + std::to_string(tid)
+      : "tbb thread " + std::to_string(tbb_thread);
+
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << tid << ",\"args\":{\"name\":\"" << name << "\"}},\n";
+  }
+
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+      << ",\"args\":{\"name\":\"mold\"}}\n]}\n";
+  out << std::flush;
+}
+
 } // namespace mold
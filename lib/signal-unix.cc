@@ -20,6 +20,7 @@ std::string errno_string() {
 void cleanup() {
   if (output_tmpfile)
     unlink(output_tmpfile);
+  release_global_lock();
 }
 
 // mold mmap's an output file, and the mmap succeeds even if there's
@@ -47,10 +48,13 @@ static void sighandler(int signo, siginfo_t *info, void *ucontext) {
         info->si_addr < output_buffer_end) {
       const char msg[] = "mold: failed to write to an output file. Disk full?\n";
       (void)!write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    } else {
+      print_trace_events();
     }
     break;
   case SIGABRT: {
     (void)!write(STDERR_FILENO, &sigabrt_msg[0], sigabrt_msg.size());
+    print_trace_events();
     break;
   }
   }
@@ -64,6 +68,12 @@ static void sighandler(int signo, siginfo_t *info, void *ucontext) {
   raise(signo);
 }
 
+// `kill -USR1 <pid>` prints out what a running mold process has been
+// doing recently. Unlike the other handlers, mold keeps running.
+static void sigusr1_handler(int signo) {
+  print_trace_events();
+}
+
 void install_signal_handler() {
   struct sigaction action;
   action.sa_sigaction = sighandler;
@@ -73,6 +83,12 @@ void install_signal_handler() {
   sigaction(SIGSEGV, &action, NULL);
   sigaction(SIGBUS, &action, NULL);
 
+  struct sigaction usr1;
+  usr1.sa_handler = sigusr1_handler;
+  sigemptyset(&usr1.sa_mask);
+  usr1.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &usr1, NULL);
+
   // OneTBB 2021.9.0 has the interface version 12090.
   if (TBB_runtime_interface_version() < 12090) {
     sigabrt_msg = "mold: aborted\n"
@@ -42,6 +42,8 @@ static LONG WINAPI vectored_handler(_EXCEPTION_POINTERS *exception_info) {
     static const char msg[] =
       "mold: stack overflow\n";
     (void)!_write(_fileno(stderr), msg, sizeof(msg) - 1);
+  } else {
+    print_trace_events();
   }
 
   cleanup();
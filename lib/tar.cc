@@ -8,8 +8,6 @@
 
 namespace mold {
 
-static constexpr i64 BLOCK_SIZE = 512;
-
 // A tar file consists of one or more Ustar header followed by data.
 // Each Ustar header represents a single file in an archive.
 //
@@ -38,7 +36,7 @@ struct UstarHeader {
   char pad[12];
 };
 
-static_assert(sizeof(UstarHeader) == BLOCK_SIZE);
+static_assert(sizeof(UstarHeader) == TarWriter::BLOCK_SIZE);
 
 static void finalize(UstarHeader &hdr) {
   memset(hdr.checksum, ' ', sizeof(hdr.checksum));
@@ -81,7 +79,8 @@ TarWriter::~TarWriter() {
   fclose(out);
 }
 
-void TarWriter::append(std::string path, std::string_view data) {
+std::string TarWriter::encode_header(std::string basedir, std::string path,
+                                     i64 size) {
   // Write PAX header
   UstarHeader pax = {};
 
@@ -90,18 +89,26 @@ void TarWriter::append(std::string path, std::string_view data) {
   pax.name[0] = '/';
   pax.typeflag[0] = 'x';
   finalize(pax);
-  fwrite(&pax, sizeof(pax), 1, out);
+
+  std::string buf((char *)&pax, sizeof(pax));
 
   // Write pathname
-  fwrite(attr.data(), attr.size(), 1, out);
-  fseek(out, align_to(ftell(out), BLOCK_SIZE), SEEK_SET);
+  buf += attr;
+  buf.resize(align_to(buf.size(), BLOCK_SIZE));
 
   // Write Ustar header
   UstarHeader ustar = {};
   memcpy(ustar.mode, "0000664", 8);
-  snprintf(ustar.size, sizeof(ustar.size), "%011zo", data.size());
+  snprintf(ustar.size, sizeof(ustar.size), "%011zo", (size_t)size);
   finalize(ustar);
-  fwrite(&ustar, sizeof(ustar), 1, out);
+
+  buf.append((char *)&ustar, sizeof(ustar));
+  return buf;
+}
+
+void TarWriter::append(std::string path, std::string_view data) {
+  std::string hdr = encode_header(basedir, path, data.size());
+  fwrite(hdr.data(), hdr.size(), 1, out);
 
   // Write file contents
   fwrite(data.data(), data.size(), 1, out);
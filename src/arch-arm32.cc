@@ -35,6 +35,7 @@
 
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
+#include <tbb/parallel_scan.h>
 #include <tbb/parallel_sort.h>
 
 namespace mold {
@@ -535,8 +536,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -548,10 +550,11 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) =
+      get_fragment(ctx, rel, get_addend(loc, rel), &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
-    u64 A = frag ? frag_addend : get_addend(*this, rel);
+    u64 A = frag ? frag_addend : get_addend(loc, rel);
 
     switch (rel.r_type) {
     case R_ARM_ABS32:
@@ -731,7 +734,7 @@ void Arm32ExidxSection::remove_duplicate_entries(Context<E> &ctx) {
 
 void Arm32ExidxSection::copy_buf(Context<E> &ctx) {
   std::vector<u8> contents = get_contents(ctx);
-  assert(this->shdr.sh_size = contents.size());
+  assert(this->shdr.sh_size == contents.size());
   write_vector(ctx.buf + this->shdr.sh_offset, contents);
 }
 
@@ -789,30 +792,45 @@ std::vector<u8> Arm32ExidxSection::get_contents(Context<E> &ctx) {
       ent[i].val = 0x7fff'ffff & (ent[i].val + offset);
   });
 
-  std::sort(ent, ent + num_entries, [](const Entry &a, const Entry &b) {
-    return a.addr < b.addr;
+  // We compare values too for entries at the same address so that the
+  // result doesn't depend on the sorting algorithm.
+  tbb::parallel_sort(ent, ent + num_entries,
+                     [](const Entry &a, const Entry &b) {
+    return std::tuple(a.addr, a.val) < std::tuple(b.addr, b.val);
   });
 
   // Remove duplicate adjacent entries. That is, if two adjacent functions
   // have the same compact unwind info or are both CANTUNWIND, we can
-  // merge them into a single address range.
-  auto it = std::unique(ent, ent + num_entries,
-                        [](const Entry &a, const Entry &b) {
-    return a.val == b.val;
-  });
+  // merge them into a single address range. A large program has millions
+  // of entries, so we compute the destination of each remaining entry
+  // with a parallel prefix sum and copy them in a single pass.
+  std::vector<u8> buf2(buf.size());
+  Entry *ent2 = (Entry *)buf2.data();
+
+  auto scan = [&](const tbb::blocked_range<i64> &r, i64 sum, bool is_final) {
+    for (i64 i = r.begin(); i < r.end(); i++) {
+      if (i == 0 || ent[i].val != ent[i - 1].val) {
+        if (is_final)
+          ent2[sum] = ent[i];
+        sum++;
+      }
+    }
+    return sum;
+  };
 
-  num_entries = it - ent;
-  buf.resize(num_entries * sizeof(Entry));
+  num_entries = tbb::parallel_scan(tbb::blocked_range<i64>(0, num_entries),
+                                   (i64)0, scan, std::plus());
+  buf2.resize(num_entries * sizeof(Entry));
 
   // Make addresses relative to themselves.
   tbb::parallel_for((i64)0, num_entries, [&](i64 i) {
     i64 offset = sizeof(Entry) * i;
-    ent[i].addr = 0x7fff'ffff & (ent[i].addr - offset);
-    if (is_relative(ent[i].val))
-      ent[i].val = 0x7fff'ffff & (ent[i].val - offset);
+    ent2[i].addr = 0x7fff'ffff & (ent2[i].addr - offset);
+    if (is_relative(ent2[i].val))
+      ent2[i].val = 0x7fff'ffff & (ent2[i].val - offset);
   });
 
-  return buf;
+  return buf2;
 }
 
 } // namespace mold
@@ -143,6 +143,36 @@ static bool is_add(u8 *loc) {
   return (bits(insn, 31, 20) & 0b1111'1111'1100) == 0b1001'0001'0000;
 }
 
+// An ADR_GOT_PAGE and GOT_LO12_NC relocation pair is used to load a
+// symbol's address from GOT. If the address is a link-time constant, we
+// can rewrite the ADRP+LDR instruction pair to materialize the address
+// without a memory load. This function returns true if rels[i] and
+// rels[i + 1] are such a pair.
+static bool is_relaxable_got_load(Context<E> &ctx, Symbol<E> &sym,
+                                  std::span<const ElfRel<E>> rels, i64 i,
+                                  u8 *loc) {
+  if (!ctx.arg.relax || !sym.is_pcrel_linktime_const(ctx) ||
+      i + 1 == rels.size())
+    return false;
+
+  // ADRP+LDR must be consecutive and use the same register to relax.
+  const ElfRel<E> &rel = rels[i];
+  const ElfRel<E> &rel2 = rels[i + 1];
+  if (rel2.r_type != R_AARCH64_LD64_GOT_LO12_NC ||
+      rel2.r_offset != rel.r_offset + 4 ||
+      rel2.r_sym != rel.r_sym ||
+      rel.r_addend != 0 ||
+      rel2.r_addend != 0 ||
+      !is_adrp(loc) ||
+      !is_ldr(loc + 4))
+    return false;
+
+  u32 rd = bits(*(ul32 *)loc, 4, 0);
+  u32 rn = bits(*(ul32 *)(loc + 4), 9, 5);
+  u32 rt = bits(*(ul32 *)(loc + 4), 4, 0);
+  return rd == rn && rn == rt;
+}
+
 template <>
 void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
   std::span<const ElfRel<E>> rels = get_rels(ctx);
@@ -212,20 +242,31 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       *(ul32 *)loc |= bits(S + A, 63, 48) << 5;
       break;
     case R_AARCH64_ADR_GOT_PAGE:
-      if (sym.has_got(ctx)) {
-        i64 val = page(G + GOT + A) - page(P);
-        check(val, -(1LL << 32), 1LL << 32);
-        write_adrp(loc, val);
+      // We relax a pair even if the symbol has a GOT entry because some
+      // other references need it; the relaxed code doesn't touch GOT.
+      if (is_relaxable_got_load(ctx, sym, rels, i, loc)) {
+        u32 reg = bits(*(ul32 *)loc, 4, 0);
+        i64 val = S + A - P - 4;
+
+        if (sign_extend(val, 20) == val) {
+          // Relax GOT-loading ADRP+LDR to NOP+ADR if the symbol is
+          // within PC ± 1 MiB
+          *(ul32 *)loc = 0xd503'201f;              // nop
+          *(ul32 *)(loc + 4) = 0x1000'0000 | reg; // adr
+          write_adr(loc + 4, val);
+        } else {
+          // Otherwise, relax it to an immediate ADRP+ADD
+          i64 val = page(S + A) - page(P);
+          check(val, -(1LL << 32), 1LL << 32);
+          write_adrp(loc, val);
+          *(ul32 *)(loc + 4) = 0x9100'0000 | (reg << 5) | reg; // ADD
+          *(ul32 *)(loc + 4) |= bits(S + A, 11, 0) << 10;
+        }
+        i++;
       } else {
-        // Relax GOT-loading ADRP+LDR to an immediate ADRP+ADD
-        i64 val = page(S + A) - page(P);
+        i64 val = page(G + GOT + A) - page(P);
         check(val, -(1LL << 32), 1LL << 32);
         write_adrp(loc, val);
-
-        u32 reg = bits(*(ul32 *)loc, 4, 0);
-        *(ul32 *)(loc + 4) = 0x9100'0000 | (reg << 5) | reg; // ADD
-        *(ul32 *)(loc + 4) |= bits(S + A, 11, 0) << 10;
-        i++;
       }
       break;
     case R_AARCH64_ADR_PREL_PG_HI21:
@@ -437,16 +478,32 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
+    u8 *loc = base + rel.r_offset;
+
+    // Fast path for the most common relocations in debug sections
+    if (rel.r_type == R_AARCH64_ABS64 || rel.r_type == R_AARCH64_ABS32) {
+      if (std::optional<u64> val = get_section_sym_value(rel)) {
+        if (rel.r_type == R_AARCH64_ABS64) {
+          *(U64<E> *)loc = *val;
+          continue;
+        }
+        if (*val < (1LL << 32)) {
+          *(U32<E> *)loc = *val;
+          continue;
+        }
+      }
+    }
+
     if (rel.r_type == R_NONE || record_undef_error(ctx, rel))
       continue;
 
     Symbol<E> &sym = *file.symbols[rel.r_sym];
-    u8 *loc = base + rel.r_offset;
 
     auto check = [&](i64 val, i64 lo, i64 hi) {
       if (val < lo || hi <= val)
@@ -457,7 +514,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -505,29 +562,9 @@ void InputSection<E>::scan_relocations(Context<E> &ctx) {
       scan_absrel(ctx, sym, rel);
       break;
     case R_AARCH64_ADR_GOT_PAGE:
-      // An ADR_GOT_PAGE and GOT_LO12_NC relocation pair is used to load a
-      // symbol's address from GOT. If the GOT value is a link-time
-      // constant, we may be able to rewrite the ADRP+LDR instruction pair
-      // with an ADRP+ADD, eliminating a GOT memory load.
-      if (ctx.arg.relax && sym.is_pcrel_linktime_const(ctx) &&
-          i + 1 < rels.size()) {
-        // ADRP+LDR must be consecutive and use the same register to relax.
-        const ElfRel<E> &rel2 = rels[i + 1];
-        if (rel2.r_type == R_AARCH64_LD64_GOT_LO12_NC &&
-            rel2.r_offset == rel.r_offset + 4 &&
-            rel2.r_sym == rel.r_sym &&
-            rel.r_addend == 0 &&
-            rel2.r_addend == 0 &&
-            is_adrp(loc) &&
-            is_ldr(loc + 4)) {
-          u32 rd = bits(*(ul32 *)loc, 4, 0);
-          u32 rn = bits(*(ul32 *)(loc + 4), 9, 5);
-          u32 rt = bits(*(ul32 *)(loc + 4), 4, 0);
-          if (rd == rn && rn == rt) {
-            i++;
-            break;
-          }
-        }
+      if (is_relaxable_got_load(ctx, sym, rels, i, loc)) {
+        i++;
+        break;
       }
       sym.flags |= NEEDS_GOT;
       break;
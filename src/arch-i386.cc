@@ -438,8 +438,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -458,10 +459,11 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) =
+      get_fragment(ctx, rel, get_addend(loc, rel), &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
-    u64 A = frag ? frag_addend : get_addend(*this, rel);
+    u64 A = frag ? frag_addend : get_addend(loc, rel);
     u64 GOT = ctx.got->shdr.sh_addr;
 
     switch (rel.r_type) {
@@ -365,6 +365,7 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       } else {
         // Rewrite pcalau12i + addi.d with pcaddi
         assert(removed_bytes == 4);
+        check_branch(S + A - P, -(1 << 21), 1 << 21);
         *(ul32 *)loc = 0x1800'0000 | get_rd(*(ul32 *)loc); // pcaddi
         write_j20(loc, (S + A - P) >> 2);
         i += 3;
@@ -407,6 +408,7 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       } else {
         // Rewrite pcalau12i + ld.d with pcaddi
         assert(removed_bytes == 4);
+        check_branch(S + A - P, -(1 << 21), 1 << 21);
         *(ul32 *)loc = 0x1800'0000 | get_rd(*(ul32 *)loc); // pcaddi
         write_j20(loc, (S + A - P) >> 2);
         i += 3;
@@ -518,6 +520,7 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       } else {
         // Rewrite PCADDU18I + JIRL to B or BL
         assert(removed_bytes == 4);
+        check_branch(S + A - P, -(1 << 27), 1 << 27);
         if (get_rd(*(ul32 *)(contents.data() + rel.r_offset + 4)) == 0)
           *(ul32 *)loc = 0x5000'0000; // B
         else
@@ -660,8 +663,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -678,7 +682,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -862,9 +866,39 @@ void shrink_section(Context<E> &ctx, InputSection<E> &isec, bool use_rvc) {
   isec.extra.r_deltas.resize(rels.size() + 1);
   i64 delta = 0;
 
+  // In iterative relaxation, we don't undo relaxation done in the
+  // previous pass so that the process converges. However, alignment
+  // padding may have grown since then, and a relaxed instruction may no
+  // longer reach its target. Such relocation is relaxed only as much as
+  // the current layout allows, and it can only shrink less from then on.
+  std::span<i32> prev = isec.extra.prev_r_deltas;
+  std::vector<u8> &caps = isec.extra.relax_caps;
+
+  auto keep_relaxed = [&](i64 i) {
+    if (prev.empty() || rels[i].r_type == R_LARCH_ALIGN)
+      return;
+
+    i64 removed = delta - isec.extra.r_deltas[i];
+    if (!caps.empty() && caps[i] != 0xff) {
+      if (removed > caps[i])
+        delta -= removed - caps[i];
+      else
+        caps[i] = removed;
+      return;
+    }
+
+    if (removed < prev[i + 1] - prev[i]) {
+      if (caps.empty())
+        caps.resize(rels.size(), 0xff);
+      caps[i] = removed;
+    }
+  };
+
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &r = rels[i];
     Symbol<E> &sym = *isec.file.symbols[r.r_sym];
+    if (i > 0)
+      keep_relaxed(i - 1);
     isec.extra.r_deltas[i] = delta;
 
     // A R_LARCH_ALIGN relocation refers to the beginning of a nop
@@ -1004,6 +1038,8 @@ void shrink_section(Context<E> &ctx, InputSection<E> &isec, bool use_rvc) {
     }
   }
 
+  if (!rels.empty())
+    keep_relaxed(rels.size() - 1);
   isec.extra.r_deltas[rels.size()] = delta;
   isec.sh_size -= delta;
 }
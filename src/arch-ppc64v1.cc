@@ -282,8 +282,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -302,7 +303,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -491,9 +492,9 @@ static InputSection<E> *get_opd_section(ObjectFile<E> &file) {
   return nullptr;
 }
 
-static ElfRel<E> *
+static const ElfRel<E> *
 get_relocation_at(Context<E> &ctx, InputSection<E> &isec, i64 offset) {
-  std::span<ElfRel<E>> rels = isec.get_rels(ctx);
+  std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
 
   auto it = std::lower_bound(rels.begin(), rels.end(), offset,
                              [](const ElfRel<E> &r, i64 offset) {
@@ -582,7 +583,7 @@ void ppc64v1_rewrite_opd(Context<E> &ctx) {
       if (u32 ty = sym->get_type(); ty != STT_FUNC && ty != STT_GNU_IFUNC)
         continue;
 
-      ElfRel<E> *rel = get_relocation_at(ctx, *opd, sym->value);
+      const ElfRel<E> *rel = get_relocation_at(ctx, *opd, sym->value);
       if (!rel)
         Fatal(ctx) << *file << ": cannot find a relocation in .opd for "
                    << *sym << " at offset 0x" << std::hex << (u64)sym->value;
@@ -605,7 +606,10 @@ void ppc64v1_rewrite_opd(Context<E> &ctx) {
       if (!isec || !isec->is_alive || isec.get() == opd)
         continue;
 
-      for (ElfRel<E> &r : isec->get_rels(ctx)) {
+      std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
+
+      for (i64 i = 0; i < rels.size(); i++) {
+        const ElfRel<E> &r = rels[i];
         Symbol<E> &sym = *file->symbols[r.r_sym];
         if (sym.get_input_section() != opd)
           continue;
@@ -615,8 +619,9 @@ void ppc64v1_rewrite_opd(Context<E> &ctx) {
           Fatal(ctx) << *isec << ": cannot find a symbol in .opd for " << r
                      << " at offset 0x" << std::hex << (u64)r.r_addend;
 
-        r.r_sym = real_sym->sym_idx;
-        r.r_addend = 0;
+        ElfRel<E> &r2 = isec->get_mutable_rels(ctx)[i];
+        r2.r_sym = real_sym->sym_idx;
+        r2.r_addend = 0;
       }
     }
   });
@@ -182,6 +182,85 @@ static u64 get_local_entry_offset(Context<E> &ctx, Symbol<E> &sym) {
   return 1 << val;
 }
 
+// GCC and Clang load the address of a global variable from a
+// compiler-generated .toc entry using the following instructions.
+//
+//   addis r9, r2, .LC0@toc@ha    # R_PPC64_TOC16_HA
+//   ld    r9, .LC0@toc@l(r9)     # R_PPC64_TOC16_LO_DS
+//
+// If the address of the variable is known to be within TOC ± 2 GiB at
+// link-time, we can compute it directly from r2 instead of loading it
+// from memory.
+//
+//   addis r9, r2, foo@toc@ha
+//   addi  r9, r9, foo@toc@l
+//
+// If the high half of the offset is zero, the first instruction is
+// rewritten to a NOP and r2 is used as the base register instead.
+//
+// We do this only if all references to the .toc entry are such
+// instruction pairs, since other instructions may use the entry's
+// address for other purposes.
+static void scan_toc_ref(Context<E> &ctx, InputSection<E> &isec,
+                         const ElfRel<E> &rel) {
+  std::vector<Atomic<bool>> &vec = isec.file.extra.toc_no_relax;
+  i64 offset = isec.file.symbols[rel.r_sym]->value + rel.r_addend;
+  if (offset < 0 || vec.size() <= offset / 8)
+    return;
+
+  auto is_relaxable = [&] {
+    if (offset % 8)
+      return false;
+
+    u32 insn = *(ul32 *)(isec.contents.data() + rel.r_offset);
+    if (rel.r_type == R_PPC64_TOC16_HA)
+      return (insn & 0xfc1f'0000) == 0x3c02'0000; // addis rX, r2, 0
+    if (rel.r_type == R_PPC64_TOC16_LO_DS)
+      return (insn & 0xfc00'0003) == 0xe800'0000; // ld rY, 0(rX)
+    return false;
+  };
+
+  if (!is_relaxable())
+    vec[offset / 8] = true;
+}
+
+// Returns the TOC-relative address of the variable whose address is
+// in a given .toc entry if the entry can be relaxed.
+static std::optional<i64>
+get_relaxed_toc_value(Context<E> &ctx, InputSection<E> &isec,
+                      const ElfRel<E> &rel) {
+  ObjectFile<E> &file = isec.file;
+  InputSection<E> *toc = file.extra.toc;
+  Symbol<E> &sym = *file.symbols[rel.r_sym];
+
+  if (!ctx.arg.relax || !toc || sym.get_input_section() != toc)
+    return {};
+
+  std::vector<Atomic<bool>> &vec = file.extra.toc_no_relax;
+  i64 offset = sym.value + rel.r_addend;
+  if (offset < 0 || offset % 8 || vec.size() <= offset / 8 || vec[offset / 8])
+    return {};
+
+  std::span<const ElfRel<E>> rels = toc->get_rels(ctx);
+  auto it = std::lower_bound(rels.begin(), rels.end(), offset,
+                             [](const ElfRel<E> &r, i64 val) {
+    return r.r_offset < val;
+  });
+
+  if (it == rels.end() || it->r_offset != offset ||
+      it->r_type != R_PPC64_ADDR64)
+    return {};
+
+  Symbol<E> &sym2 = *file.symbols[it->r_sym];
+  if (!sym2.file || !sym2.is_pcrel_linktime_const(ctx))
+    return {};
+
+  i64 val = sym2.get_addr(ctx) + it->r_addend - ctx.extra.TOC->value;
+  if (sign_extend(val, 31) != val)
+    return {};
+  return val;
+}
+
 template <>
 void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
   std::span<const ElfRel<E>> rels = get_rels(ctx);
@@ -206,13 +285,29 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 
     switch (rel.r_type) {
     case R_PPC64_TOC16_HA:
+      if (std::optional<i64> val = get_relaxed_toc_value(ctx, *this, rel)) {
+        if (ha(*val) == 0)
+          *(ul32 *)loc = 0x6000'0000; // nop
+        else
+          *(ul16 *)loc = ha(*val);
+        break;
+      }
       *(ul16 *)loc = ha(S + A - TOC);
       break;
     case R_PPC64_TOC16_LO:
       *(ul16 *)loc = lo(S + A - TOC);
       break;
-    case R_PPC64_TOC16_DS:
     case R_PPC64_TOC16_LO_DS:
+      if (std::optional<i64> val = get_relaxed_toc_value(ctx, *this, rel)) {
+        // Rewrite `ld rY, 0(rX)` with `addi rY, rX, 0`
+        u32 rt = bits(*(ul32 *)loc, 25, 21);
+        u32 ra = (ha(*val) == 0) ? 2 : bits(*(ul32 *)loc, 20, 16);
+        *(ul32 *)loc = 0x3800'0000 | (rt << 21) | (ra << 16) | lo(*val);
+        break;
+      }
+      *(ul16 *)loc |= (S + A - TOC) & 0xfffc;
+      break;
+    case R_PPC64_TOC16_DS:
       *(ul16 *)loc |= (S + A - TOC) & 0xfffc;
       break;
     case R_PPC64_REL24:
@@ -342,8 +437,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -362,7 +458,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -406,6 +502,10 @@ void InputSection<E>::scan_relocations(Context<E> &ctx) {
     if (sym.is_ifunc())
       sym.flags |= NEEDS_GOT | NEEDS_PLT;
 
+    if (ctx.arg.relax && file.extra.toc &&
+        sym.get_input_section() == file.extra.toc)
+      scan_toc_ref(ctx, *this, rel);
+
     switch (rel.r_type) {
     case R_PPC64_GOT_TPREL16_HA:
     case R_PPC64_GOT_TPREL_PCREL34:
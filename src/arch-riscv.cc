@@ -282,17 +282,23 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       if (sym.esym().is_undef_weak())
         val = 0;
 
+      // A relaxed jump was in range when we shrank sections, but we
+      // check it again just in case because the instructions would
+      // silently truncate an out-of-range displacement.
       if (removed_bytes == 4) {
         // auipc + jalr -> jal
+        check(val, -(1 << 20), 1 << 20);
         *(ul32 *)loc = (rd << 7) | 0b1101111;
         write_jtype(loc, val);
       } else if (removed_bytes == 6 && rd == 0) {
         // auipc + jalr -> c.j
+        check(val, -(1 << 11), 1 << 11);
         *(ul16 *)loc = 0b101'00000000000'01;
         write_cjtype(loc, val);
       } else if (removed_bytes == 6 && rd == 1) {
         // auipc + jalr -> c.jal
         assert(!E::is_64);
+        check(val, -(1 << 11), 1 << 11);
         *(ul16 *)loc = 0b001'00000000000'01;
         write_cjtype(loc, val);
       } else {
@@ -623,8 +629,9 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 }
 
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -636,7 +643,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -835,9 +842,39 @@ void shrink_section(Context<E> &ctx, InputSection<E> &isec, bool use_rvc) {
 
   i64 delta = 0;
 
+  // In iterative relaxation, we don't undo relaxation done in the
+  // previous pass so that the process converges. However, alignment
+  // padding may have grown since then, and a relaxed instruction may no
+  // longer reach its target. Such relocation is relaxed only as much as
+  // the current layout allows, and it can only shrink less from then on.
+  std::span<i32> prev = isec.extra.prev_r_deltas;
+  std::vector<u8> &caps = isec.extra.relax_caps;
+
+  auto keep_relaxed = [&](i64 i) {
+    if (prev.empty() || rels[i].r_type == R_RISCV_ALIGN)
+      return;
+
+    i64 removed = delta - isec.extra.r_deltas[i];
+    if (!caps.empty() && caps[i] != 0xff) {
+      if (removed > caps[i])
+        delta -= removed - caps[i];
+      else
+        caps[i] = removed;
+      return;
+    }
+
+    if (removed < prev[i + 1] - prev[i]) {
+      if (caps.empty())
+        caps.resize(rels.size(), 0xff);
+      caps[i] = removed;
+    }
+  };
+
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &r = rels[i];
     Symbol<E> &sym = *isec.file.symbols[r.r_sym];
+    if (i > 0)
+      keep_relaxed(i - 1);
     isec.extra.r_deltas[i] = delta;
 
     // Handling R_RISCV_ALIGN is mandatory.
@@ -1002,6 +1039,8 @@ void shrink_section(Context<E> &ctx, InputSection<E> &isec, bool use_rvc) {
     }
   }
 
+  if (!rels.empty())
+    keep_relaxed(rels.size() - 1);
   isec.extra.r_deltas[rels.size()] = delta;
   isec.sh_size -= delta;
 }
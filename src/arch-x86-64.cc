@@ -367,6 +367,8 @@ static void relax_ld_to_le(u8 *loc, ElfRel<E> rel, i64 tls_size) {
 template <>
 void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
   std::span<const ElfRel<E>> rels = get_rels(ctx);
+  u64 addr = get_addr();
+  u64 GOT = ctx.gotplt->shdr.sh_addr;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
@@ -395,9 +397,11 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 
     u64 S = sym.get_addr(ctx);
     u64 A = rel.r_addend;
-    u64 P = get_addr() + rel.r_offset;
-    u64 G = sym.get_got_addr(ctx) - ctx.gotplt->shdr.sh_addr;
-    u64 GOT = ctx.gotplt->shdr.sh_addr;
+    u64 P = addr + rel.r_offset;
+
+    // G is computed only for GOT-referencing relocations because it
+    // requires a lookup in the symbol's auxiliary data.
+    auto G = [&] { return sym.get_got_addr(ctx) - GOT; };
 
     switch (rel.r_type) {
     case R_X86_64_8:
@@ -432,10 +436,10 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       *(ul64 *)loc = S + A - P;
       break;
     case R_X86_64_GOT32:
-      write32(G + A);
+      write32(G() + A);
       break;
     case R_X86_64_GOT64:
-      *(ul64 *)loc = G + A;
+      *(ul64 *)loc = G() + A;
       break;
     case R_X86_64_GOTOFF64:
     case R_X86_64_PLTOFF64:
@@ -448,10 +452,10 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
       *(ul64 *)loc = GOT + A - P;
       break;
     case R_X86_64_GOTPCREL:
-      write32s(G + GOT + A - P);
+      write32s(G() + GOT + A - P);
       break;
     case R_X86_64_GOTPCREL64:
-      *(ul64 *)loc = G + GOT + A - P;
+      *(ul64 *)loc = G() + GOT + A - P;
       break;
     case R_X86_64_GOTPCRELX:
       // We always want to relax GOTPCRELX relocs even if --no-relax
@@ -467,7 +471,7 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
           break;
         }
       }
-      write32s(G + GOT + A - P);
+      write32s(G() + GOT + A - P);
       break;
     case R_X86_64_REX_GOTPCRELX:
       if (sym.is_pcrel_linktime_const(ctx)) {
@@ -481,7 +485,7 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
           break;
         }
       }
-      write32s(G + GOT + A - P);
+      write32s(G() + GOT + A - P);
       break;
     case R_X86_64_TLSGD:
       if (sym.has_tlsgd(ctx))
@@ -604,16 +608,32 @@ void InputSection<E>::apply_reloc_alloc(Context<E> &ctx, u8 *base) {
 // Relocations against non-SHF_ALLOC sections are not scanned by
 // scan_relocations.
 template <>
-void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
-  std::span<const ElfRel<E>> rels = get_rels(ctx);
+void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                                           std::span<const ElfRel<E>> rels) {
+  FragmentCache<E> cache;
 
   for (i64 i = 0; i < rels.size(); i++) {
     const ElfRel<E> &rel = rels[i];
+    u8 *loc = base + rel.r_offset;
+
+    // Fast path for the most common relocations in debug sections
+    if (rel.r_type == R_X86_64_64 || rel.r_type == R_X86_64_32) {
+      if (std::optional<u64> val = get_section_sym_value(rel)) {
+        if (rel.r_type == R_X86_64_64) {
+          *(ul64 *)loc = *val;
+          continue;
+        }
+        if (*val < (1LL << 32)) {
+          *(ul32 *)loc = *val;
+          continue;
+        }
+      }
+    }
+
     if (rel.r_type == R_NONE || record_undef_error(ctx, rel))
       continue;
 
     Symbol<E> &sym = *file.symbols[rel.r_sym];
-    u8 *loc = base + rel.r_offset;
 
     auto check = [&](i64 val, i64 lo, i64 hi) {
       if (val < lo || hi <= val)
@@ -634,7 +654,7 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
 
     SectionFragment<E> *frag;
     i64 frag_addend;
-    std::tie(frag, frag_addend) = get_fragment(ctx, rel);
+    std::tie(frag, frag_addend) = get_fragment(ctx, rel, &cache);
 
     u64 S = frag ? frag->get_addr(ctx) : sym.get_addr(ctx);
     u64 A = frag ? frag_addend : (i64)rel.r_addend;
@@ -695,6 +715,109 @@ void InputSection<E>::apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
   }
 }
 
+// Intel CET is a relatively new CPU feature to enhance security by
+// protecting control flow integrity. If the feature is enabled, indirect
+// branches (i.e. branch instructions that take a register instead of an
+// immediate) must land on a "landing pad" instruction, or a CPU-level fault
+// will raise. That prevents an attacker to branch to a middle of a random
+// function, making ROP or JOP much harder to conduct.
+//
+// On x86-64, the landing pad instruction is ENDBR64. That is actually a
+// repurposed NOP instruction to provide binary compatibility with older
+// hardware that doesn't support CET.
+//
+// The problem here is that the compiler always emits a landing pad at the
+// beginning fo a global function because it doesn't know whether or not the
+// function's address is taken in other translation units. As a result, the
+// resulting binary contains more landing pads than necessary.
+//
+// We rewrite a landing pad with a nop if the function's address was not
+// actually taken. We can do what the compiler cannot because we know
+// about all translation units.
+//
+// Before scanning relocations, find_endbr() records the offsets of
+// endbr64s at the beginning of global functions to their input sections.
+// InputSection::scan_relocations() then marks ones referred to by
+// address-taking relocations, and InputSection::write_to() writes nops
+// for the rest while copying section contents.
+static constexpr std::string_view endbr64 = "\xf3\x0f\x1e\xfa";
+
+void find_endbr(Context<E> &ctx) {
+  Timer t(ctx, "find_endbr");
+
+  // We handle only global symbols because the compiler doesn't emit an
+  // endbr64 for a file-scoped function in the first place if its address
+  // is not taken within the file.
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    for (Symbol<E> *sym : file->get_global_syms()) {
+      if (sym->file == file && sym->esym().st_type == STT_FUNC) {
+        if (InputSection<E> *isec = sym->get_input_section();
+            isec && isec->is_alive && isec->output_section &&
+            (isec->shdr().sh_flags & SHF_EXECINSTR) &&
+            sym->value + 4 <= isec->contents.size() &&
+            isec->contents.substr(sym->value).starts_with(endbr64))
+          isec->extra.endbr.push_back({sym->value, false});
+      }
+    }
+
+    for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+      if (isec && !isec->extra.endbr.empty()) {
+        auto &vec = isec->extra.endbr;
+        sort(vec);
+        vec.erase(std::unique(vec.begin(), vec.end(), [](auto &a, auto &b) {
+          return a.first == b.first;
+        }), vec.end());
+      }
+    }
+  });
+}
+
+// Marks an endbr64 at a given offset of isec as needed if it is one of
+// the ones recorded by find_endbr().
+static void keep_endbr(InputSection<E> *isec, i64 offset) {
+  if (!isec || isec->extra.endbr.empty())
+    return;
+
+  // A section folded by --icf=safe-thunks has only one endbr64 at the
+  // beginning.
+  if (isec->icf_thunk && offset != 0)
+    return;
+
+  auto &vec = isec->extra.endbr;
+  auto it = std::partition_point(vec.begin(), vec.end(), [&](auto &x) {
+    return x.first < offset;
+  });
+
+  if (it != vec.end() && it->first == offset)
+    it->second = true;
+}
+
+static void keep_endbr(Symbol<E> &sym, const ElfRel<E> &rel) {
+  if (sym.esym().st_type == STT_SECTION)
+    keep_endbr(sym.get_input_section(), rel.r_addend);
+  else
+    keep_endbr(sym.get_input_section(), sym.value);
+}
+
+// We record addresses of some symbols in the ELF header, .dynamic or in
+// .dynsym. We need to retain endbr64s for such symbols. This needs to be
+// called after the final set of dynamic symbols has been determined.
+void keep_endbr(Context<E> &ctx) {
+  auto keep = [&](Symbol<E> *sym) {
+    if (sym)
+      keep_endbr(sym->get_input_section(), sym->value);
+  };
+
+  keep(ctx.arg.entry);
+  keep(ctx.arg.init);
+  keep(ctx.arg.fini);
+
+  if (ctx.dynsym)
+    for (Symbol<E> *sym : ctx.dynsym->symbols)
+      if (sym && sym->is_exported)
+        keep(sym);
+}
+
 // Linker has to create data structures in an output file to apply
 // some type of relocations. For example, if a relocation refers a GOT
 // or a PLT entry of a symbol, linker has to create an entry in .got
@@ -714,6 +837,9 @@ void InputSection<E>::scan_relocations(Context<E> &ctx) {
     Symbol<E> &sym = *file.symbols[rel.r_sym];
     u8 *loc = (u8 *)(contents.data() + rel.r_offset);
 
+    if (ctx.arg.z_rewrite_endbr && !is_func_call_rel(rel))
+      keep_endbr(sym, rel);
+
     if (sym.is_ifunc())
       sym.flags |= NEEDS_GOT | NEEDS_PLT;
 
@@ -807,95 +933,4 @@ void InputSection<E>::scan_relocations(Context<E> &ctx) {
   }
 }
 
-// Intel CET is a relatively new CPU feature to enhance security by
-// protecting control flow integrity. If the feature is enabled, indirect
-// branches (i.e. branch instructions that take a register instead of an
-// immediate) must land on a "landing pad" instruction, or a CPU-level fault
-// will raise. That prevents an attacker to branch to a middle of a random
-// function, making ROP or JOP much harder to conduct.
-//
-// On x86-64, the landing pad instruction is ENDBR64. That is actually a
-// repurposed NOP instruction to provide binary compatibility with older
-// hardware that doesn't support CET.
-//
-// The problem here is that the compiler always emits a landing pad at the
-// beginning fo a global function because it doesn't know whether or not the
-// function's address is taken in other translation units. As a result, the
-// resulting binary contains more landing pads than necessary.
-//
-// This function rewrites a landing pad with a nop if the function's address
-// was not actually taken. We can do what the compiler cannot because we
-// know about all translation units.
-void rewrite_endbr(Context<E> &ctx) {
-  Timer t(ctx, "rewrite_endbr");
-
-  constexpr u8 endbr64[] = {0xf3, 0x0f, 0x1e, 0xfa};
-  constexpr u8 nop[] = {0x0f, 0x1f, 0x40, 0x00};
-
-  // Rewrite all endbr64 instructions referred to by function symbols with
-  // NOPs. We handle only global symbols because the compiler doesn't emit
-  // an endbr64 for a file-scoped function in the first place if its address
-  // is not taken within the file.
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    for (Symbol<E> *sym : file->get_global_syms()) {
-      if (sym->file == file && sym->esym().st_type == STT_FUNC) {
-        if (InputSection<E> *isec = sym->get_input_section();
-            isec && (isec->shdr().sh_flags & SHF_EXECINSTR)) {
-          if (OutputSection<E> *osec = isec->output_section) {
-            u8 *buf = ctx.buf + osec->shdr.sh_offset + isec->offset + sym->value;
-            if (memcmp(buf, endbr64, 4) == 0)
-              memcpy(buf, nop, 4);
-          }
-        }
-      }
-    }
-  });
-
-  auto write_back = [&](InputSection<E> *isec, i64 offset) {
-    // If isec has an endbr64 at a given offset, copy that instruction to
-    // the output buffer, possibly overwriting a nop written in the above
-    // loop.
-    if (isec && isec->output_section &&
-        (isec->shdr().sh_flags & SHF_EXECINSTR) &&
-        0 <= offset && offset <= isec->contents.size() - 4 &&
-        memcmp(isec->contents.data() + offset, endbr64, 4) == 0)
-      memcpy(ctx.buf + isec->output_section->shdr.sh_offset + isec->offset + offset,
-             endbr64, 4);
-  };
-
-  // Write back endbr64 instructions if they are referred to by address-taking
-  // relocations.
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
-      if (isec && isec->is_alive && (isec->shdr().sh_flags & SHF_ALLOC)) {
-        for (const ElfRel<E> &rel : isec->get_rels(ctx)) {
-          if (!is_func_call_rel(rel)) {
-            Symbol<E> *sym = file->symbols[rel.r_sym];
-            if (sym->esym().st_type == STT_SECTION)
-              write_back(sym->get_input_section(), rel.r_addend);
-            else
-              write_back(sym->get_input_section(), sym->value);
-          }
-        }
-      }
-    }
-  });
-
-  // We record addresses of some symbols in the ELF header, .dynamic or in
-  // .dynsym. We need to retain endbr64s for such symbols.
-  auto keep = [&](Symbol<E> *sym) {
-    if (sym)
-      write_back(sym->get_input_section(), sym->value);
-  };
-
-  keep(ctx.arg.entry);
-  keep(ctx.arg.init);
-  keep(ctx.arg.fini);
-
-  if (ctx.dynsym)
-    for (Symbol<E> *sym : ctx.dynsym->symbols)
-      if (sym && sym->is_exported)
-        keep(sym);
-}
-
 } // namespace mold
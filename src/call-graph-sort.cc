@@ -0,0 +1,264 @@
+// This file implements --call-graph-profile-sort.
+//
+// If a program is compiled with profile-guided optimization, LLVM emits
+// a `.llvm.call-graph-profile` section to each object file. The section
+// describes a weighted call graph; each entry consists of a caller, a
+// callee and the number of times the caller called the callee while the
+// program was being profiled. We use that information to place functions
+// that call each other frequently next to each other, so that the hot
+// part of a program fits in fewer pages and fewer i-cache lines.
+//
+// Since LLVM 13, each entry of the section is just a 64-bit weight. The
+// caller and the callee are given by a pair of R_*_NONE relocations in
+// the relocation section for the profile section; the n'th entry's caller
+// and callee are the (2n)'th and (2n+1)'th relocations' symbols.
+//
+// The ordering algorithm is the one lld uses, which is based on the C3
+// heuristic described in "Optimizing Function Placement for Large-Scale
+// Data-Center Applications" by Ottoni and Maher (CGO 2017).
+//
+// Initially, each input section forms a cluster by itself. We then visit
+// clusters in decreasing order of density (weight per byte) and append
+// each cluster to the cluster of its most likely caller as long as the
+// merged cluster doesn't become too large or too sparse. Finally, the
+// clusters are sorted by density, so that the hottest code comes first.
+
+#include "mold.h"
+
+#include <set>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <unordered_map>
+
+namespace mold {
+
+// We stop merging clusters if it would create a cluster larger than this.
+static constexpr i64 MAX_CLUSTER_SIZE = 1024 * 1024;
+
+// We don't merge two clusters if the density of the merged cluster would
+// be less than 1/MAX_DENSITY_DEGRADATION of the caller's cluster.
+static constexpr i64 MAX_DENSITY_DEGRADATION = 8;
+
+template <typename E>
+struct CallGraphEdge {
+  InputSection<E> *from;
+  InputSection<E> *to;
+  u64 weight;
+};
+
+struct Cluster {
+  double get_density() const {
+    return size ? (double)weight / size : 0;
+  }
+
+  std::vector<i32> members;
+  i64 size = 0;
+  u64 weight = 0;
+  u64 initial_weight = 0;
+  i32 best_pred = -1;
+  u64 best_pred_weight = 0;
+};
+
+// Functions whose relative order is significant are excluded.
+template <typename E>
+static bool is_eligible(InputSection<E> *isec) {
+  if (!isec || !isec->is_alive)
+    return false;
+
+  OutputSection<E> *osec = isec->output_section;
+  return osec && (osec->shdr.sh_flags & SHF_EXECINSTR) &&
+         osec->name != ".init" && osec->name != ".fini";
+}
+
+template <typename E>
+static InputSection<E> *get_section(Symbol<E> *sym) {
+  InputSection<E> *isec = sym->get_input_section();
+  if (isec && isec->icf_removed())
+    isec = isec->leader;
+  return is_eligible(isec) ? isec : nullptr;
+}
+
+template <typename E>
+static std::vector<CallGraphEdge<E>>
+read_call_graph_profile(Context<E> &ctx, ObjectFile<E> &file) {
+  const ElfShdr<E> &shdr = file.elf_sections[file.llvm_cg_profile_idx];
+
+  // Find the relocation section for the profile section. An old-style
+  // profile section without relocations, which is emitted by LLVM 12 or
+  // earlier, is ignored.
+  std::span<ElfRel<E>> rels;
+  for (const ElfShdr<E> &sec : file.elf_sections)
+    if (sec.sh_type == (E::is_rela ? SHT_RELA : SHT_REL) &&
+        sec.sh_info == file.llvm_cg_profile_idx)
+      rels = file.template get_data<ElfRel<E>>(ctx, sec);
+
+  if (rels.empty())
+    return {};
+
+  std::span<U64<E>> weights = file.template get_data<U64<E>>(ctx, shdr);
+  if (rels.size() != weights.size() * 2)
+    Fatal(ctx) << file << ": .llvm.call-graph-profile: invalid relocations";
+
+  std::vector<CallGraphEdge<E>> vec;
+  for (i64 i = 0; i < weights.size(); i++) {
+    u32 from = rels[i * 2].r_sym;
+    u32 to = rels[i * 2 + 1].r_sym;
+    if (from >= file.symbols.size() || to >= file.symbols.size())
+      Fatal(ctx) << file << ": .llvm.call-graph-profile: invalid symbol index";
+
+    InputSection<E> *from_sec = get_section(file.symbols[from]);
+    InputSection<E> *to_sec = get_section(file.symbols[to]);
+
+    // We can reorder sections only within the same output section.
+    // Self-edges don't affect the layout.
+    if (from_sec && to_sec && from_sec != to_sec &&
+        from_sec->output_section == to_sec->output_section)
+      vec.push_back({from_sec, to_sec, weights[i]});
+  }
+  return vec;
+}
+
+template <typename E>
+void sort_sections_by_call_graph_profile(Context<E> &ctx) {
+  Timer t(ctx, "sort_sections_by_call_graph_profile");
+
+  // Read profile sections in parallel.
+  std::vector<std::vector<CallGraphEdge<E>>> per_file(ctx.objs.size());
+
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> *file = ctx.objs[i];
+    if (file->llvm_cg_profile_idx != -1)
+      per_file[i] = read_call_graph_profile(ctx, *file);
+  });
+
+  // Assign a node ID to each section appearing in the call graph.
+  // We visit edges in the command line order to make the output
+  // deterministic.
+  std::unordered_map<InputSection<E> *, i32> node_ids;
+  std::vector<InputSection<E> *> nodes;
+  std::vector<Cluster> clusters;
+
+  auto get_node = [&](InputSection<E> *isec) {
+    auto [it, inserted] = node_ids.insert({isec, nodes.size()});
+    if (inserted) {
+      nodes.push_back(isec);
+      Cluster &c = clusters.emplace_back();
+      c.members.push_back(it->second);
+      c.size = isec->sh_size;
+    }
+    return it->second;
+  };
+
+  std::unordered_map<u64, u64> edge_weights;
+  std::vector<std::pair<i32, i32>> edges;
+
+  for (std::vector<CallGraphEdge<E>> &vec : per_file) {
+    for (CallGraphEdge<E> &e : vec) {
+      i32 from = get_node(e.from);
+      i32 to = get_node(e.to);
+      auto [it, inserted] = edge_weights.insert({((u64)from << 32) | to, 0});
+      if (inserted)
+        edges.push_back({from, to});
+      it->second += e.weight;
+    }
+  }
+
+  if (edges.empty())
+    return;
+
+  // Compute each cluster's weight and its most likely caller.
+  for (std::pair<i32, i32> e : edges) {
+    u64 w = edge_weights[((u64)e.first << 32) | e.second];
+    clusters[e.first].weight += w;
+    clusters[e.second].weight += w;
+    clusters[e.second].initial_weight += w;
+
+    if (clusters[e.second].best_pred_weight < w) {
+      clusters[e.second].best_pred = e.first;
+      clusters[e.second].best_pred_weight = w;
+    }
+  }
+
+  // Visit clusters from the densest one.
+  std::vector<i32> sorted(clusters.size());
+  for (i64 i = 0; i < sorted.size(); i++)
+    sorted[i] = i;
+
+  sort(sorted, [&](i32 a, i32 b) {
+    return clusters[a].get_density() > clusters[b].get_density();
+  });
+
+  std::vector<i32> leaders(clusters.size());
+  for (i64 i = 0; i < leaders.size(); i++)
+    leaders[i] = i;
+
+  auto get_leader = [&](i32 i) {
+    while (leaders[i] != i)
+      i = leaders[i] = leaders[leaders[i]];
+    return i;
+  };
+
+  for (i32 i : sorted) {
+    // clusters[i] hasn't been merged to other cluster yet because
+    // a cluster is merged only when it is visited.
+    Cluster &c = clusters[i];
+
+    // Don't merge if the edge to the caller is too weak.
+    if (c.best_pred == -1 || c.best_pred_weight * 10 <= c.initial_weight)
+      continue;
+
+    i32 pred = get_leader(c.best_pred);
+    if (pred == i)
+      continue;
+
+    Cluster &p = clusters[pred];
+    if (c.size + p.size > MAX_CLUSTER_SIZE)
+      continue;
+
+    double density = (double)(c.weight + p.weight) / (c.size + p.size);
+    if (density < p.get_density() / MAX_DENSITY_DEGRADATION)
+      continue;
+
+    leaders[i] = pred;
+    append(p.members, c.members);
+    p.size += c.size;
+    p.weight += c.weight;
+    c.members.clear();
+  }
+
+  // Sort the resulting clusters by density and assign ranks to sections.
+  std::erase_if(sorted, [&](i32 i) { return clusters[i].members.empty(); });
+
+  sort(sorted, [&](i32 a, i32 b) {
+    return clusters[a].get_density() > clusters[b].get_density();
+  });
+
+  std::unordered_map<InputSection<E> *, i64> ranks;
+  std::set<OutputSection<E> *> osecs;
+
+  for (i32 i : sorted) {
+    for (i32 j : clusters[i].members) {
+      ranks.insert({nodes[j], ranks.size()});
+      osecs.insert(nodes[j]->output_section);
+    }
+  }
+
+  // Profiled sections are placed at the beginning of their output
+  // sections in the rank order. Other sections keep their relative order.
+  auto get_rank = [&](InputSection<E> *isec) {
+    auto it = ranks.find(isec);
+    return (it == ranks.end()) ? INT64_MAX : it->second;
+  };
+
+  tbb::parallel_for_each(osecs, [&](OutputSection<E> *osec) {
+    sort(osec->members, [&](InputSection<E> *a, InputSection<E> *b) {
+      return get_rank(a) < get_rank(b);
+    });
+  });
+}
+
+using E = MOLD_TARGET;
+
+template void sort_sections_by_call_graph_profile(Context<E> &);
+
+} // namespace mold
@@ -6,6 +6,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
 #include <unordered_set>
 
 #if __has_include(<sys/utsname.h>)
@@ -40,7 +41,7 @@ Options:
   -M, --print-map             Write map file to stdout
   -N, --omagic                Do not page align data; do not make text readonly
     --no-omagic
-  -O NUMBER                   Ignored
+  -O NUMBER                   Set optimization level; -O2 or higher enables tail merging of strings
   -S, --strip-debug           Strip .debug_* sections
   -T FILE, --script FILE      Read linker script
   -X, --discard-locals        Discard temporary local symbols
@@ -53,6 +54,7 @@ Options:
   -m TARGET                   Set target
   -o FILE, --output FILE      Set output filename
   -q, --emit-relocs           Leaves relocation sections in the output
+  --emit-relocs=[all,alloc]   Leaves relocation sections for all or only allocated sections
   -r, --relocatable           Generate relocatable output
   -s, --strip-all             Strip .symtab section
   -u SYMBOL, --undefined SYMBOL
@@ -66,6 +68,7 @@ Options:
   --Bsymbolic-non-weak        Bind all but weak symbols locally
   --Bsymbolic-non-weak-functions
                               Bind all but weak function symbols locally
+  --Bsymbolic-auto=FILE       Bind symbols locally unless FILE may interpose them
   --Bno-symbolic              Cancel --Bsymbolic options
   --Map FILE                  Write map file to a given file
   --Tbss=ADDR                 Set address to .bss
@@ -76,16 +79,26 @@ Options:
     --no-apply-dynamic-relocs
   --as-needed                 Only set DT_NEEDED if used
     --no-as-needed
-  --build-id [none,md5,sha1,sha256,fast,uuid,HEXSTRING]
+  --async-debug-file          Write --separate-debug-file concurrently with the main output
+    --no-async-debug-file
+  --build-id [none,md5,sha1,sha256,fast,uuid,inputs,HEXSTRING]
                               Generate build ID
     --no-build-id
+  --call-graph-profile-sort   Sort sections by .llvm.call-graph-profile (default)
+    --no-call-graph-profile-sort
   --chroot DIR                Set a given path to the root directory
   --color-diagnostics=[auto,always,never]
                               Use colors in diagnostics
   --color-diagnostics         Alias for --color-diagnostics=always
-  --compress-debug-sections [none,zlib,zlib-gabi,zstd]
+  --compress-debug-sections [none,zlib,zlib-gabi,zstd][:LEVEL]
                               Compress .debug_* sections
+  --compress-sections GLOB=[none,zlib,zstd][:LEVEL]
+                              Compress non-allocated sections matching GLOB
+  --copy-file-range           Copy large unrelocated sections with copy_file_range(2)
+    --no-copy-file-range
   --dc                        Ignored
+  --debug-names               Create .debug_names for faster debugger startup
+    --no-debug-names
   --dependency-file=FILE      Write Makefile-style dependency rules to FILE
   --defsym=SYMBOL=VALUE       Define a symbol alias
   --demangle                  Demangle C++ symbols in log messages (default)
@@ -96,10 +109,16 @@ Options:
     --disable-new-dtags       Emit DT_RPATH for --rpath
   --execute-only              Make executable segments unreadable
   --dp                        Ignored
+  --dry-run-layout=FILE       Write the output layout to FILE in JSON without
+                              creating an output file
+  --dwp=FILE                  Package split DWARF .dwo files into FILE
   --dynamic-list=FILE         Read a list of dynamic symbols (implies -Bsymbolic)
   --dynamic-list-data         Add data symbols to dynamic symbols
+  --early-writeback           Start writing back each output section as soon as it is written
+    --no-early-writeback
   --eh-frame-hdr              Create .eh_frame_hdr section
     --no-eh-frame-hdr
+  --emit-delta FILE           Write a patch from the previous output to FILE
   --exclude-libs LIB,LIB,..   Mark all symbols in given libraries as hidden
   --export-dynamic-symbol     Put symbols matching glob in the dynamic symbol table
   --export-dynamic-symbol-list=FILE
@@ -112,36 +131,67 @@ Options:
   --gc-sections               Remove unreferenced sections
     --no-gc-sections
   --gdb-index                 Create .gdb_index for faster gdb startup
+  --gnu-hash-bloom-bits NUMBER
+                              Set the number of .gnu.hash bloom filter bits per symbol
+  --group-relocated-data      Place data sections with dynamic relocations together
+    --no-group-relocated-data
   --hash-style [sysv,gnu,both,none]
                               Set hash style
-  --icf=[all,safe,none]       Fold identical code
+  --hot-text-align N          Align sections listed by --hot-text-file to N bytes
+  --hot-text-file FILE        Place sections defining symbols in FILE at the start of .text
+  --huge-page-inputs          Back large input files with transparent huge pages
+    --no-huge-page-inputs
+  --icf=[all,safe,safe-thunks,none]
+                              Fold identical code
     --no-icf
+  --icf-max-rounds N          Stop ICF after N propagation rounds
+  --icf-time-budget MS        Stop ICF after MS milliseconds
   --ignore-data-address-equality
                               Allow merging non-executable sections with --icf
   --image-base ADDR           Set the base address to a given value
   --init SYMBOL               Call SYMBOL at load-time
+  --iterative-relax           Repeat RISC-V and LoongArch relaxation until no more code shrinks
+    --no-iterative-relax
+  --lazy-archive-members      Parse archive members only when referenced
+    --no-lazy-archive-members
+  --lazy-dso-symbols          Add shared library symbols only when referenced
+    --no-lazy-dso-symbols
+  --lto-claim-helpers NUMBER  Read LTO IR objects' symbols in NUMBER helper processes
+  --lto-symbol-cache DIR      Cache symbol tables of LTO IR objects in DIR
+  --mmap-output               Write the output file through mmap(2) (default)
+    --no-mmap-output          Write the output file with pwrite(2)
   --nmagic                    Do not page align sections
     --no-nmagic
   --no-undefined              Report undefined symbols (even with --shared)
   --noinhibit-exec            Create an output file even if errors occur
   --oformat=binary            Omit ELF, section, and program headers
+  --output-cache DIR          Reuse outputs of identical earlier links from DIR
   --pack-dyn-relocs=[relr,none]
                               Pack dynamic relocations
   --package-metadata=STRING   Set a given string to .note.package
   --perf                      Print performance statistics
+  --perf=hw                   Print performance statistics with hardware counters
+  --perf=threads              Print performance statistics with thread utilization
+  --perf=trace:FILE           Write timer records to FILE in Chrome trace format
   --pie, --pic-executable     Create a position-independent executable
     --no-pie, --no-pic-executable
   --pop-state                 Restore the state of flags governing input file handling
+  --prefetch-inputs           Start reading input files in the background
+    --no-prefetch-inputs
   --print-gc-sections         Print removed unreferenced sections
     --no-print-gc-sections
   --print-icf-sections        Print folded identical sections
     --no-print-icf-sections
+  --progress-fd=N             Report progress to file descriptor N as JSON lines
+  --prune-debug-aranges       Remove .debug_aranges entries for removed sections
+    --no-prune-debug-aranges
   --push-state                Save the state of flags governing input file handling
   --quick-exit                Use quick_exit to exit (default)
     --no-quick-exit
   --relax                     Optimize instructions (default)
     --no-relax
-  --repro                     Embed input files in .repro section
+  --repro                     Archive input files in a tar file
+  --repro=zstd                Archive input files in a zstd-compressed tar file
   --require-defined SYMBOL    Require SYMBOL be defined in the final output
   --retain-symbols-file FILE  Keep only symbols listed in FILE
   --reverse-sections          Reverse input sections in the output file
@@ -162,8 +212,15 @@ Options:
                               Reserve the given number of slots in the program header
   --start-lib                 Give following object files in-archive-file semantics
     --end-lib                 End the effect of --start-lib
+  --stable-layout FILE        Keep sections at their addresses in a map file written by an earlier link
   --stats                     Print input statistics
+  --symbol-ordering-file FILE Lay out sections in the order of symbols listed in FILE
+  --input-stats=FILE          Write per-input-file statistics to FILE
   --sysroot DIR               Set the target system root directory
+  --tail-merge-strtab         Share common suffixes of symbol names in .strtab
+    --no-tail-merge-strtab
+  --thinlto-distributor COMMAND
+                              Run ThinLTO backend jobs with COMMAND
   --thread-count COUNT, --threads=COUNT
                               Use COUNT number of threads
   --threads                   Use multiple threads (default)
@@ -179,6 +236,8 @@ Options:
   --warn-common               Warn about common symbols
     --no-warn-common
   --warn-once                 Only warn once for each undefined symbol
+  --warn-symbol-ordering      Warn about unknown symbols in --symbol-ordering-file (default)
+    --no-warn-symbol-ordering
   --warn-shared-textrel       Warn if the output .so needs text relocations
   --warn-textrel              Warn if the output file needs text relocations
   --warn-unresolved-symbols   Report unresolved symbols as warnings
@@ -187,12 +246,18 @@ Options:
   --whole-archive             Include all objects from static archives
     --no-whole-archive
   --wrap SYMBOL               Use a wrapper function for a given symbol
+  --zero-data-to-bss          Place zero-filled data sections into .bss
+    --no-zero-data-to-bss
+  --zstd-seek-table           Append a seek table to zstd-compressed sections
+    --no-zstd-seek-table
   -z defs                     Report undefined symbols (even with --shared)
     -z nodefs
   -z common-page-size=VALUE   Ignored
   -z execstack                Require an executable stack
     -z noexecstack
   -z execstack-if-needed      Make the stack area executable if an input file explicitly requests it
+  -z hugepage-text            Align the executable segment to a 2 MiB huge page boundary
+    -z nohugepage-text
   -z initfirst                Mark DSO to be initialized first at runtime
   -z interpose                Mark object to interpose all DSOs but the executable
   -z keep-text-section-prefix Keep .text.{hot,unknown,unlikely,startup,exit} as separate sections in the final binary
@@ -268,7 +333,21 @@ read_response_file(Context<E> &ctx, std::string_view path, i64 depth) {
     };
 
     auto read_unquoted = [&] {
-      std::string buf;
+      // Most tokens contain no backslashes. We return such a token as a
+      // view into the mapped file instead of copying it.
+      i64 len = 0;
+      while (len < data.size() && !isspace(data[len]) && data[len] != '\\')
+        len++;
+
+      if (len == data.size() || data[len] != '\\') {
+        std::string_view tok = data.substr(0, len);
+        data = data.substr(len);
+        return tok;
+      }
+
+      std::string buf(data.substr(0, len));
+      data = data.substr(len);
+
       while (!data.empty()) {
         if (data[0] == '\\' && data.size() >= 1) {
           buf.append(1, data[1]);
@@ -315,10 +394,71 @@ expand_response_files(Context<E> &ctx, char **argv) {
 }
 
 static i64 get_default_thread_count() {
-  // mold doesn't scale well above 32 threads.
-  int n = tbb::global_control::active_value(
+  i64 n = tbb::global_control::active_value(
     tbb::global_control::max_allowed_parallelism);
-  return std::min(n, 32);
+
+  // In a container, we may be allowed to use only a fraction of the cores.
+  if (i64 limit = get_cgroup_cpu_limit(); limit != -1)
+    n = std::min(n, limit);
+
+  // mold doesn't scale well above 32 threads.
+  return std::min<i64>(n, 32);
+}
+
+// Returns true if the total size of input files is small. Libraries
+// given by -l are searched for in the same way as find_library() does.
+template <typename E>
+static bool is_small_link(Context<E> &ctx, std::span<std::string> args) {
+  constexpr i64 SMALL_LINK_THRESHOLD = 4 * 1024 * 1024;
+  i64 size = 0;
+
+  auto add = [&](const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1)
+      return false;
+    size += st.st_size;
+    return true;
+  };
+
+  auto add_lib = [&](std::string_view name, bool static_) {
+    for (std::string_view dir : ctx.arg.library_paths) {
+      if (name.starts_with(':')) {
+        if (add(std::string(dir) + "/" + std::string(name.substr(1))))
+          return true;
+      } else {
+        std::string stem = std::string(dir) + "/lib" + std::string(name);
+        if ((!static_ && add(stem + ".so")) || add(stem + ".a"))
+          return true;
+      }
+    }
+    return false;
+  };
+
+  std::vector<bool> stack;
+  bool static_ = false;
+
+  for (std::string &arg : args) {
+    if (arg == "--Bstatic") {
+      static_ = true;
+    } else if (arg == "--Bdynamic") {
+      static_ = false;
+    } else if (arg == "--push-state") {
+      stack.push_back(static_);
+    } else if (arg == "--pop-state" && !stack.empty()) {
+      static_ = stack.back();
+      stack.pop_back();
+    } else if (arg.starts_with("-l")) {
+      if (!add_lib(std::string_view(arg).substr(2), static_))
+        return false;
+    } else if (!arg.starts_with('-')) {
+      if (!add(arg))
+        return false;
+    }
+
+    if (SMALL_LINK_THRESHOLD < size)
+      return false;
+  }
+  return true;
 }
 
 static std::string_view string_trim(std::string_view str) {
@@ -333,19 +473,32 @@ static std::string_view string_trim(std::string_view str) {
   return str.substr(0, pos + 1);
 }
 
-static std::vector<std::string> add_dashes(std::string name) {
+// Removes leading dashes from `arg` and returns true if they are valid
+// for an option `name`.
+static bool remove_dashes(std::string_view &arg, std::string_view name) {
   // Single-letter option
-  if (name.size() == 1)
-    return {"-" + name};
+  if (name.size() == 1) {
+    if (!arg.starts_with('-'))
+      return false;
+    arg = arg.substr(1);
+    return true;
+  }
 
   // Multi-letter linker options can be preceded by either a single
   // dash or double dashes except ones starting with "o", which must
   // be preceded by double dashes. For example, "-omagic" is
   // interpreted as "-o magic". If you really want to specify the
   // "omagic" option, you have to pass "--omagic".
-  if (name[0] == 'o')
-    return {"--" + name};
-  return {"-" + name, "--" + name};
+  if (arg.starts_with("--")) {
+    arg = arg.substr(2);
+    return true;
+  }
+
+  if (arg.starts_with('-') && name[0] != 'o') {
+    arg = arg.substr(1);
+    return true;
+  }
+  return false;
 }
 
 template <typename E>
@@ -386,6 +539,34 @@ static char from_hex(char c) {
   return c - 'A' + 10;
 }
 
+// Parses a compression algorithm and an optional level in the form of
+// "zlib", "zstd:19" or "none". A level of -1 means the default.
+template <typename E>
+static std::pair<CompressKind, i64>
+parse_compress_kind(Context<E> &ctx, std::string opt, std::string_view arg) {
+  std::string_view name = arg.substr(0, arg.find(':'));
+  CompressKind kind = COMPRESS_NONE;
+
+  if (name == "zlib" || name == "zlib-gabi")
+    kind = COMPRESS_ZLIB;
+  else if (name == "zstd")
+    kind = COMPRESS_ZSTD;
+  else if (arg == "none")
+    kind = COMPRESS_NONE;
+  else
+    Fatal(ctx) << "invalid --" << opt << " argument: " << arg;
+
+  i64 level = -1;
+  if (name.size() < arg.size()) {
+    level = parse_number(ctx, opt, arg.substr(name.size() + 1));
+    i64 max = (kind == COMPRESS_ZSTD) ? 22 : 9;
+    if (level < 1 || max < level)
+      Fatal(ctx) << "--" << opt << ": compression level must be"
+                 << " between 1 and " << max << ": " << arg;
+  }
+  return {kind, level};
+}
+
 template <typename E>
 static std::vector<u8> parse_hex_build_id(Context<E> &ctx, std::string_view arg) {
   auto flags = std::regex_constants::optimize | std::regex_constants::ECMAScript;
@@ -464,6 +645,90 @@ static void read_retain_symbols_file(Context<E> &ctx, std::string_view path) {
   ctx.arg.retain_symbols_file = std::move(vec);
 }
 
+// Symbol lists generated by profilers can contain millions of symbols,
+// so we intern them into the symbol table in parallel.
+template <typename E>
+static std::vector<Symbol<E> *>
+get_symbols(Context<E> &ctx, std::span<std::string_view> names) {
+  std::vector<Symbol<E> *> vec(names.size());
+  tbb::parallel_for((i64)0, (i64)names.size(), [&](i64 i) {
+    vec[i] = get_symbol(ctx, names[i]);
+  });
+  return vec;
+}
+
+// Reads a file for --symbol-ordering-file. Each line contains a symbol
+// name.
+template <typename E>
+static void read_symbol_ordering_file(Context<E> &ctx, std::string_view path) {
+  MappedFile *mf = must_open_file(ctx, std::string(path));
+  std::string_view data((char *)mf->data, mf->size);
+  std::unordered_set<std::string_view> seen;
+  std::vector<std::string_view> names;
+
+  while (!data.empty()) {
+    size_t pos = data.find('\n');
+    std::string_view name;
+
+    if (pos == data.npos) {
+      name = data;
+      data = "";
+    } else {
+      name = data.substr(0, pos);
+      data = data.substr(pos + 1);
+    }
+
+    // Only the first occurrence of a symbol is significant.
+    name = string_trim(name);
+    if (!name.empty() && seen.insert(name).second)
+      names.push_back(name);
+  }
+
+  ctx.arg.symbol_ordering_file = get_symbols(ctx, std::span(names));
+}
+
+// Reads a file for --hot-text-file. Each line contains a symbol name
+// optionally followed by a sample count, so the output of profilers can
+// be used with little postprocessing. Symbols with zero samples, empty
+// lines and lines starting with `#` are ignored.
+template <typename E>
+static void read_hot_text_file(Context<E> &ctx, std::string_view path) {
+  MappedFile *mf = must_open_file(ctx, std::string(path));
+  std::string_view data((char *)mf->data, mf->size);
+  std::vector<std::string_view> names;
+
+  while (!data.empty()) {
+    size_t pos = data.find('\n');
+    std::string_view line;
+
+    if (pos == data.npos) {
+      line = data;
+      data = "";
+    } else {
+      line = data.substr(0, pos);
+      data = data.substr(pos + 1);
+    }
+
+    line = string_trim(line);
+    if (line.empty() || line.starts_with('#'))
+      continue;
+
+    pos = line.find_first_of(" \t");
+    std::string_view name = line.substr(0, pos);
+
+    if (pos != line.npos) {
+      std::string_view count = string_trim(line.substr(pos));
+      if (count.find_first_not_of("0123456789") != count.npos)
+        Fatal(ctx) << "--hot-text-file: " << path << ": invalid line: " << line;
+      if (count.find_first_not_of('0') == count.npos)
+        continue;
+    }
+    names.push_back(name);
+  }
+
+  ctx.arg.hot_text_file = get_symbols(ctx, std::span(names));
+}
+
 static bool is_file(std::string_view path) {
   struct stat st;
   return stat(std::string(path).c_str(), &st) == 0 &&
@@ -583,6 +848,7 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   bool warn_shared_textrel = false;
   bool error_unresolved_symbols = true;
   std::optional<SeparateCodeKind> z_separate_code;
+  std::optional<bool> fork;
   std::optional<bool> report_undefined;
   std::optional<bool> z_relro;
   std::optional<std::string> separate_debug_file;
@@ -617,68 +883,83 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   //   we write addends to relocated places.
   ctx.arg.apply_dynamic_relocs = !is_sparc<E> && !is_riscv<E>;
 
-  auto read_arg = [&](std::string name) {
-    for (const std::string &opt : add_dashes(name)) {
-      if (args[0] == opt) {
-        if (args.size() == 1)
-          Fatal(ctx) << "option -" << name << ": argument missing";
-        arg = args[1];
-        args = args.subspan(2);
-        return true;
-      }
+  // These functions are called for each option name until one matches,
+  // so they don't allocate memory.
+  auto read_arg = [&](std::string_view name) {
+    std::string_view rest = args[0];
+    if (!remove_dashes(rest, name) || !rest.starts_with(name))
+      return false;
+
+    if (rest.size() == name.size()) {
+      if (args.size() == 1)
+        Fatal(ctx) << "option -" << name << ": argument missing";
+      arg = args[1];
+      args = args.subspan(2);
+      return true;
+    }
 
-      std::string prefix = (name.size() == 1) ? opt : opt + "=";
-      if (args[0].starts_with(prefix)) {
-        arg = args[0].substr(prefix.size());
-        args = args.subspan(1);
-        return true;
-      }
+    if (name.size() == 1) {
+      arg = rest.substr(1);
+      args = args.subspan(1);
+      return true;
+    }
+
+    if (rest[name.size()] == '=') {
+      arg = rest.substr(name.size() + 1);
+      args = args.subspan(1);
+      return true;
     }
     return false;
   };
 
-  auto read_eq = [&](std::string name) {
-    for (const std::string &opt : add_dashes(name)) {
-      if (args[0].starts_with(opt + "=")) {
-        arg = args[0].substr(opt.size() + 1);
-        args = args.subspan(1);
-        return true;
-      }
+  auto read_eq = [&](std::string_view name) {
+    std::string_view rest = args[0];
+    if (remove_dashes(rest, name) && rest.starts_with(name) &&
+        rest.size() > name.size() && rest[name.size()] == '=') {
+      arg = rest.substr(name.size() + 1);
+      args = args.subspan(1);
+      return true;
     }
     return false;
   };
 
-  auto read_flag = [&](std::string name) {
-    for (const std::string &opt : add_dashes(name)) {
-      if (args[0] == opt) {
-        args = args.subspan(1);
-        return true;
-      }
+  auto read_flag = [&](std::string_view name) {
+    std::string_view rest = args[0];
+    if (remove_dashes(rest, name) && rest == name) {
+      args = args.subspan(1);
+      return true;
     }
     return false;
   };
 
-  auto read_z_flag = [&](std::string name) {
+  auto read_z_flag = [&](std::string_view name) {
     if (args.size() >= 2 && args[0] == "-z" && args[1] == name) {
       args = args.subspan(2);
       return true;
     }
 
-    if (!args.empty() && args[0] == "-z" + name) {
+    if (!args.empty() && args[0].starts_with("-z") &&
+        args[0].substr(2) == name) {
       args = args.subspan(1);
       return true;
     }
     return false;
   };
 
-  auto read_z_arg = [&](std::string name) {
-    if (args.size() >= 2 && args[0] == "-z" && args[1].starts_with(name + "=")) {
+  auto read_z_arg = [&](std::string_view name) {
+    auto has_prefix = [&](std::string_view s) {
+      return s.starts_with(name) && s.size() > name.size() &&
+             s[name.size()] == '=';
+    };
+
+    if (args.size() >= 2 && args[0] == "-z" && has_prefix(args[1])) {
       arg = args[1].substr(name.size() + 1);
       args = args.subspan(2);
       return true;
     }
 
-    if (!args.empty() && args[0].starts_with("-z" + name + "=")) {
+    if (!args.empty() && args[0].starts_with("-z") &&
+        has_prefix(args[0].substr(2))) {
       arg = args[0].substr(name.size() + 3);
       args = args.subspan(1);
       return true;
@@ -687,6 +968,14 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   };
 
   while (!args.empty()) {
+    // Most arguments in a large command line are input file paths, so
+    // don't try to match them against all option names.
+    if (!args[0].starts_with('-')) {
+      remaining.push_back(std::string(args[0]));
+      args = args.subspan(1);
+      continue;
+    }
+
     if (read_flag("help")) {
       Out(ctx) << "Usage: " << ctx.cmdline_args[0]
                << " [options] file...\n" << helpmsg;
@@ -771,12 +1060,25 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.Bsymbolic = BSYMBOLIC_NON_WEAK;
     } else if (read_flag("Bsymbolic-non-weak-functions")) {
       ctx.arg.Bsymbolic = BSYMBOLIC_NON_WEAK_FUNCTIONS;
+    } else if (read_arg("Bsymbolic-auto")) {
+      ctx.arg.Bsymbolic = BSYMBOLIC_AUTO;
+      ctx.arg.Bsymbolic_auto.push_back(arg);
     } else if (read_flag("Bno-symbolic")) {
       ctx.arg.Bsymbolic = BSYMBOLIC_NONE;
     } else if (read_arg("exclude-libs")) {
       append(ctx.arg.exclude_libs, split_by_comma_or_colon(arg));
     } else if (read_flag("q") || read_flag("emit-relocs")) {
       ctx.arg.emit_relocs = true;
+      ctx.arg.emit_relocs_alloc = false;
+      ctx.arg.discard_locals = false;
+    } else if (read_eq("emit-relocs")) {
+      if (arg == "all")
+        ctx.arg.emit_relocs_alloc = false;
+      else if (arg == "alloc")
+        ctx.arg.emit_relocs_alloc = true;
+      else
+        Fatal(ctx) << "unknown --emit-relocs argument: " << arg;
+      ctx.arg.emit_relocs = true;
       ctx.arg.discard_locals = false;
     } else if (read_arg("e") || read_arg("entry")) {
       ctx.arg.entry = get_symbol(ctx, arg);
@@ -806,12 +1108,24 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.start_stop = true;
     } else if (read_arg("dependency-file")) {
       ctx.arg.dependency_file = arg;
+    } else if (read_arg("stable-layout")) {
+      ctx.arg.stable_layout = arg;
+    } else if (read_arg("emit-delta")) {
+      ctx.arg.emit_delta = arg;
+    } else if (read_arg("dry-run-layout")) {
+      ctx.arg.dry_run_layout = arg;
+    } else if (read_arg("dwp")) {
+      ctx.arg.dwp = arg;
     } else if (read_arg("defsym")) {
       size_t pos = arg.find('=');
       if (pos == arg.npos || pos == arg.size() - 1)
         Fatal(ctx) << "-defsym: syntax error: " << arg;
       ctx.arg.defsyms.emplace_back(get_symbol(ctx, arg.substr(0, pos)),
                                    parse_defsym_value(ctx, arg.substr(pos + 1)));
+    } else if (read_flag(":lto-claim-helper")) {
+      ctx.arg.lto_claim_helper = true;
+    } else if (read_flag(":thinlto-index-pass")) {
+      ctx.arg.thinlto_index_pass = true;
     } else if (read_flag(":lto-pass2")) {
       ctx.arg.lto_pass2 = true;
     } else if (read_arg(":ignore-ir-file")) {
@@ -824,6 +1138,10 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.detach = true;
     } else if (read_flag("no-detach")) {
       ctx.arg.detach = false;
+    } else if (read_flag("debug-names")) {
+      ctx.arg.debug_names = true;
+    } else if (read_flag("no-debug-names")) {
+      ctx.arg.debug_names = false;
     } else if (read_flag("default-symver")) {
       ctx.arg.default_symver = true;
     } else if (read_flag("noinhibit-exec")) {
@@ -897,6 +1215,10 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.apply_dynamic_relocs = false;
     } else if (read_flag("trace")) {
       ctx.arg.trace = true;
+    } else if (read_flag("early-writeback")) {
+      ctx.arg.early_writeback = true;
+    } else if (read_flag("no-early-writeback")) {
+      ctx.arg.early_writeback = false;
     } else if (read_flag("eh-frame-hdr")) {
       ctx.arg.eh_frame_hdr = true;
     } else if (read_flag("no-eh-frame-hdr")) {
@@ -912,6 +1234,23 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.relax = true;
     } else if (read_flag("no-relax")) {
       ctx.arg.relax = false;
+    } else if (read_flag("iterative-relax")) {
+      ctx.arg.iterative_relax = true;
+    } else if (read_flag("no-iterative-relax")) {
+      ctx.arg.iterative_relax = false;
+    } else if (read_flag("lazy-archive-members")) {
+      ctx.arg.lazy_archive_members = true;
+    } else if (read_flag("no-lazy-archive-members")) {
+      ctx.arg.lazy_archive_members = false;
+    } else if (read_flag("lazy-dso-symbols")) {
+      ctx.arg.lazy_dso_symbols = true;
+    } else if (read_flag("no-lazy-dso-symbols")) {
+      ctx.arg.lazy_dso_symbols = false;
+    } else if (read_arg("gnu-hash-bloom-bits")) {
+      ctx.arg.gnu_hash_bloom_bits = parse_number(ctx, "gnu-hash-bloom-bits", arg);
+      if (ctx.arg.gnu_hash_bloom_bits <= 0)
+        Fatal(ctx) << "--gnu-hash-bloom-bits: expected a positive number, but got "
+                   << arg;
     } else if (read_flag("gdb-index")) {
       ctx.arg.gdb_index = true;
     } else if (read_flag("no-gdb-index")) {
@@ -924,6 +1263,18 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.relocatable_merge_sections = true;
     } else if (read_flag("perf")) {
       ctx.arg.perf = true;
+    } else if (read_eq("perf")) {
+      if (arg == "hw") {
+        ctx.arg.perf = true;
+        ctx.arg.perf_hw = true;
+      } else if (arg == "threads") {
+        ctx.arg.perf = true;
+        ctx.arg.perf_threads = true;
+      } else if (arg.starts_with("trace:") && arg.size() > 6) {
+        ctx.arg.perf_trace = arg.substr(6);
+      } else {
+        Fatal(ctx) << "unknown --perf argument: " << arg;
+      }
     } else if (read_flag("pack-dyn-relocs=relr") ||
                read_z_flag("pack-relative-relocs")) {
       ctx.arg.pack_dyn_relocs_relr = true;
@@ -934,6 +1285,12 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.package_metadata = parse_encoded_package_metadata(ctx, arg);
     } else if (read_arg("package-metadata")) {
       ctx.arg.package_metadata = arg;
+    } else if (read_flag("tail-merge-strtab")) {
+      ctx.arg.tail_merge_strtab = true;
+    } else if (read_flag("no-tail-merge-strtab")) {
+      ctx.arg.tail_merge_strtab = false;
+    } else if (read_arg("input-stats")) {
+      ctx.arg.input_stats = arg;
     } else if (read_flag("stats")) {
       ctx.arg.stats = true;
       Counter::enabled = true;
@@ -964,17 +1321,39 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.enable_new_dtags = false;
     } else if (read_flag("execute-only")) {
       ctx.arg.execute_only = true;
+    } else if (read_flag("call-graph-profile-sort")) {
+      ctx.arg.call_graph_profile_sort = true;
+    } else if (read_flag("no-call-graph-profile-sort")) {
+      ctx.arg.call_graph_profile_sort = false;
+    } else if (read_flag("copy-file-range")) {
+      ctx.arg.copy_file_range = true;
+    } else if (read_flag("no-copy-file-range")) {
+      ctx.arg.copy_file_range = false;
     } else if (read_arg("compress-debug-sections")) {
-      if (arg == "zlib" || arg == "zlib-gabi")
-        ctx.arg.compress_debug_sections = COMPRESS_ZLIB;
-      else if (arg == "zstd")
-        ctx.arg.compress_debug_sections = COMPRESS_ZSTD;
-      else if (arg == "none")
-        ctx.arg.compress_debug_sections = COMPRESS_NONE;
-      else
-        Fatal(ctx) << "invalid --compress-debug-sections argument: " << arg;
+      std::tie(ctx.arg.compress_debug_sections, ctx.arg.compress_debug_level) =
+        parse_compress_kind(ctx, "compress-debug-sections", arg);
+    } else if (read_arg("compress-sections")) {
+      size_t pos = arg.rfind('=');
+      if (pos == arg.npos || pos == 0)
+        Fatal(ctx) << "--compress-sections: invalid argument: " << arg;
+
+      std::optional<Glob> glob = Glob::compile(arg.substr(0, pos));
+      if (!glob)
+        Fatal(ctx) << "--compress-sections: invalid glob pattern: " << arg;
+
+      auto [kind, level] =
+        parse_compress_kind(ctx, "compress-sections", arg.substr(pos + 1));
+      ctx.arg.compress_sections.push_back({*glob, kind, level});
     } else if (read_arg("wrap")) {
       ctx.arg.wrap.insert(arg);
+    } else if (read_flag("zero-data-to-bss")) {
+      ctx.arg.zero_data_to_bss = true;
+    } else if (read_flag("no-zero-data-to-bss")) {
+      ctx.arg.zero_data_to_bss = false;
+    } else if (read_flag("zstd-seek-table")) {
+      ctx.arg.zstd_seek_table = true;
+    } else if (read_flag("no-zstd-seek-table")) {
+      ctx.arg.zstd_seek_table = false;
     } else if (read_flag("omagic") || read_flag("N")) {
       ctx.arg.omagic = true;
       ctx.arg.static_ = true;
@@ -984,6 +1363,19 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       if (arg != "binary")
         Fatal(ctx) << "-oformat: " << arg << " is not supported";
       ctx.arg.oformat_binary = true;
+    } else if (read_arg("hot-text-file")) {
+      read_hot_text_file(ctx, arg);
+    } else if (read_arg("hot-text-align")) {
+      ctx.arg.hot_text_align = parse_number(ctx, "hot-text-align", arg);
+      if (!has_single_bit(ctx.arg.hot_text_align))
+        Fatal(ctx) << "--hot-text-align=" << arg
+                   << ": value must be a power of 2";
+    } else if (read_arg("symbol-ordering-file")) {
+      read_symbol_ordering_file(ctx, arg);
+    } else if (read_flag("warn-symbol-ordering")) {
+      ctx.arg.warn_symbol_ordering = true;
+    } else if (read_flag("no-warn-symbol-ordering")) {
+      ctx.arg.warn_symbol_ordering = false;
     } else if (read_arg("retain-symbols-file")) {
       read_retain_symbols_file(ctx, arg);
     } else if (read_arg("section-align")) {
@@ -1010,6 +1402,12 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.section_start[".text"] = parse_hex(ctx, "Ttext", arg);
     } else if (read_flag("repro")) {
       ctx.arg.repro = true;
+    } else if (read_eq("repro")) {
+      if (arg == "zstd")
+        ctx.arg.repro_zstd = true;
+      else if (arg != "none")
+        Fatal(ctx) << "invalid --repro argument: " << arg;
+      ctx.arg.repro = true;
     } else if (read_z_flag("now")) {
       ctx.arg.z_now = true;
     } else if (read_z_flag("lazy")) {
@@ -1063,6 +1461,10 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.z_keep_text_section_prefix = true;
     } else if (read_z_flag("nokeep-text-section-prefix")) {
       ctx.arg.z_keep_text_section_prefix = false;
+    } else if (read_z_flag("hugepage-text")) {
+      ctx.arg.z_hugepage_text = true;
+    } else if (read_z_flag("nohugepage-text")) {
+      ctx.arg.z_hugepage_text = false;
     } else if (read_z_flag("shstk")) {
       ctx.arg.z_shstk = true;
     } else if (read_z_flag("text")) {
@@ -1079,6 +1481,10 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       separate_debug_file = "";
     } else if (read_flag("no-separate-debug-file")) {
       separate_debug_file.reset();
+    } else if (read_flag("async-debug-file")) {
+      ctx.arg.async_debug_file = true;
+    } else if (read_flag("no-async-debug-file")) {
+      ctx.arg.async_debug_file = false;
     } else if (read_z_flag("separate-loadable-segments")) {
       z_separate_code = SEPARATE_LOADABLE_SEGMENTS;
     } else if (read_z_flag("separate-code")) {
@@ -1109,6 +1515,13 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.z_rewrite_endbr = true;
     } else if (read_z_flag("norewrite-endbr")) {
       ctx.arg.z_rewrite_endbr = false;
+    } else if (read_flag("mmap-output")) {
+      ctx.arg.mmap_output = true;
+    } else if (read_flag("no-mmap-output")) {
+#ifdef _WIN32
+      Fatal(ctx) << "--no-mmap-output is not supported on Windows";
+#endif
+      ctx.arg.mmap_output = false;
     } else if (read_flag("nmagic")) {
       ctx.arg.nmagic = true;
     } else if (read_flag("no-nmagic")) {
@@ -1118,13 +1531,25 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
     } else if (read_flag("no-fatal-warnings")) {
       ctx.arg.fatal_warnings = false;
     } else if (read_flag("fork")) {
-      ctx.arg.fork = true;
+      fork = true;
     } else if (read_flag("no-fork")) {
-      ctx.arg.fork = false;
+      fork = false;
+    } else if (read_flag("group-relocated-data")) {
+      ctx.arg.group_relocated_data = true;
+    } else if (read_flag("no-group-relocated-data")) {
+      ctx.arg.group_relocated_data = false;
     } else if (read_flag("gc-sections")) {
       ctx.arg.gc_sections = true;
     } else if (read_flag("no-gc-sections")) {
       ctx.arg.gc_sections = false;
+    } else if (read_flag("huge-page-inputs")) {
+      ctx.arg.huge_page_inputs = true;
+    } else if (read_flag("no-huge-page-inputs")) {
+      ctx.arg.huge_page_inputs = false;
+    } else if (read_flag("prefetch-inputs")) {
+      ctx.arg.prefetch_inputs = true;
+    } else if (read_flag("no-prefetch-inputs")) {
+      ctx.arg.prefetch_inputs = false;
     } else if (read_flag("print-gc-sections")) {
       ctx.arg.print_gc_sections = true;
     } else if (read_flag("no-print-gc-sections")) {
@@ -1135,13 +1560,22 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
         ctx.arg.icf_all = true;
       } else if (arg == "safe") {
         ctx.arg.icf = true;
+      } else if (arg == "safe-thunks") {
+        ctx.arg.icf = true;
+        ctx.arg.icf_safe_thunks = true;
       } else if (arg == "none") {
         ctx.arg.icf = false;
+        ctx.arg.icf_safe_thunks = false;
       } else {
         Fatal(ctx) << "unknown --icf argument: " << arg;
       }
     } else if (read_flag("no-icf")) {
       ctx.arg.icf = false;
+      ctx.arg.icf_safe_thunks = false;
+    } else if (read_arg("icf-max-rounds")) {
+      ctx.arg.icf_max_rounds = parse_number(ctx, "icf-max-rounds", arg);
+    } else if (read_arg("icf-time-budget")) {
+      ctx.arg.icf_time_budget = parse_number(ctx, "icf-time-budget", arg);
     } else if (read_flag("ignore-data-address-equality")) {
       ctx.arg.ignore_data_address_equality = true;
     } else if (read_arg("image-base")) {
@@ -1158,6 +1592,18 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.quick_exit = false;
     } else if (read_arg("plugin")) {
       ctx.arg.plugin = arg;
+    } else if (read_arg("lto-claim-helpers")) {
+      ctx.arg.lto_claim_helpers = parse_number(ctx, "lto-claim-helpers", arg);
+    } else if (read_arg("lto-symbol-cache")) {
+      ctx.arg.lto_symbol_cache = arg;
+    } else if (read_arg("output-cache")) {
+      ctx.arg.output_cache = arg;
+    } else if (read_arg("progress-fd")) {
+      ctx.arg.progress_fd = parse_number(ctx, "progress-fd", arg);
+    } else if (read_flag("prune-debug-aranges")) {
+      ctx.arg.prune_debug_aranges = true;
+    } else if (read_flag("no-prune-debug-aranges")) {
+      ctx.arg.prune_debug_aranges = false;
     } else if (read_arg("plugin-opt")) {
       ctx.arg.plugin_opt.push_back(std::string(arg));
     } else if (read_flag("lto-cs-profile-generate")) {
@@ -1206,6 +1652,8 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       ctx.arg.plugin_opt.push_back("save-temps");
     } else if (read_flag("thinlto-emit-imports-files")) {
       ctx.arg.plugin_opt.push_back("thinlto-emit-imports-files");
+    } else if (read_arg("thinlto-distributor")) {
+      ctx.arg.thinlto_distributor = arg;
     } else if (read_arg("thinlto-index-only")) {
       ctx.arg.plugin_opt.push_back("thinlto-index-only=" + std::string(arg));
     } else if (read_flag("thinlto-index-only")) {
@@ -1269,6 +1717,9 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
       } else if (arg == "sha256" || arg == "fast") {
         ctx.arg.build_id.kind = BuildId::HASH;
         ctx.arg.build_id.hash_size = 32;
+      } else if (arg == "inputs") {
+        ctx.arg.build_id.kind = BuildId::INPUTS;
+        ctx.arg.build_id.hash_size = 20;
       } else if (arg.starts_with("0x") || arg.starts_with("0X")) {
         ctx.arg.build_id.kind = BuildId::HEX;
         ctx.arg.build_id.value = parse_hex_build_id(ctx, arg);
@@ -1293,6 +1744,7 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
     } else if (read_flag("no-allow-shlib-undefined")) {
       ctx.arg.allow_shlib_undefined = false;
     } else if (read_arg("O")) {
+      ctx.arg.tail_merge_strings = (parse_number(ctx, "O", arg) >= 2);
     } else if (read_flag("EB")) {
     } else if (read_flag("EL")) {
     } else if (read_flag("O0")) {
@@ -1310,7 +1762,6 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
     } else if (read_flag("disable-new-dtags")) {
     } else if (read_flag("nostdlib")) {
     } else if (read_flag("no-add-needed")) {
-    } else if (read_flag("no-call-graph-profile-sort")) {
     } else if (read_flag("no-copy-dt-needed-entries")) {
     } else if (read_arg("sort-section")) {
     } else if (read_flag("sort-common")) {
@@ -1413,8 +1864,16 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
     ctx.arg.discard_all = false;
   }
 
-  if (ctx.arg.relocatable)
+  if (ctx.arg.relocatable) {
     ctx.arg.static_ = true;
+    ctx.arg.emit_relocs_alloc = false;
+  }
+
+  // ICF thunks are implemented only for x86-64. Elsewhere, and if we
+  // have to emit relocations for the original section contents,
+  // --icf=safe-thunks is the same as --icf=safe.
+  if (!is_x86_64<E> || ctx.arg.emit_relocs)
+    ctx.arg.icf_safe_thunks = false;
 
   if (ctx.arg.shuffle_sections == SHUFFLE_SECTIONS_SHUFFLE) {
     if (shuffle_sections_seed)
@@ -1460,11 +1919,24 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   if (!ctx.arg.section_start.empty() && !ctx.arg.section_order.empty())
     Fatal(ctx) << "--section-start may not be used with --section-order";
 
+  // --hot-text-file is ignored if sections are shuffled or reversed, so
+  // --hot-text-align would silently do nothing.
+  if (ctx.arg.hot_text_align &&
+      ctx.arg.shuffle_sections != SHUFFLE_SECTIONS_NONE)
+    Fatal(ctx) << "--hot-text-align may not be used with --shuffle-sections"
+               << " or --reverse-sections";
+
   if (ctx.arg.image_base % ctx.page_size)
     Fatal(ctx) << "-image-base must be a multiple of -max-page-size";
 
+  // For a tiny link, starting worker threads and forking a subprocess
+  // take longer than linking itself, so we do neither by default.
+  bool small = (!fork || ctx.arg.thread_count == 0) &&
+               is_small_link(ctx, remaining);
+  ctx.arg.fork = fork.value_or(!small);
+
   if (ctx.arg.thread_count == 0)
-    ctx.arg.thread_count = get_default_thread_count();
+    ctx.arg.thread_count = small ? 1 : get_default_thread_count();
 
   if (char *env = getenv("MOLD_REPRO"); env && env[0])
     ctx.arg.repro = true;
@@ -1507,6 +1979,9 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   if (ctx.arg.stats || ctx.arg.perf)
     ctx.arg.detach = false;
 
+  if (ctx.arg.perf || !ctx.arg.perf_trace.empty())
+    TimerRecord::enabled = true;
+
   ctx.arg.undefined.push_back(ctx.arg.entry);
 
   for (i64 i = 0; i < ctx.arg.defsyms.size(); i++) {
@@ -1531,7 +2006,11 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
   // However, that mechanism doesn't protect .so files. Therefore, we
   // want to disable this optimization if we are creating a shared
   // object file.
-  ctx.overwrite_output_file = (!ctx.arg.shared && returns_etxtbsy());
+  //
+  // --emit-delta needs the previous contents of the output file, so we
+  // don't overwrite it in that case either.
+  ctx.overwrite_output_file = (!ctx.arg.shared && ctx.arg.emit_delta.empty() &&
+                               returns_etxtbsy());
 
   if (!ctx.arg.chroot.empty()) {
     if (!ctx.arg.Map.empty())
@@ -1539,6 +2018,9 @@ std::vector<std::string> parse_nonpositional_args(Context<E> &ctx) {
 
     if (!ctx.arg.dependency_file.empty())
       ctx.arg.dependency_file = ctx.arg.chroot + "/" + ctx.arg.dependency_file;
+
+    if (!ctx.arg.dry_run_layout.empty())
+      ctx.arg.dry_run_layout = ctx.arg.chroot + "/" + ctx.arg.dry_run_layout;
   }
 
   // Mark GC root symbols
@@ -0,0 +1,723 @@
+// This file implements --dwp, which packages the .dwo files referenced
+// by the output file into a single DWARF package (.dwp) file.
+//
+// With -gsplit-dwarf, a compiler writes most of the debug info for an
+// object file to a separate .dwo file and leaves only a small "skeleton"
+// compunit in the object file. A skeleton compunit has DW_AT_dwo_name
+// and DW_AT_comp_dir attributes which tell us the location of its .dwo
+// file.
+//
+// A .dwp file is essentially a concatenation of .dwo files with two
+// index sections, .debug_cu_index and .debug_tu_index. They are hash
+// tables which map compunit IDs and type unit signatures to their
+// contributions to each debug section. The format is described in
+// Section 7.3.5 of the DWARF 5 spec.
+//
+// Traditionally, a .dwp file is created by a separate tool such as
+// dwp or llvm-dwp after the linker finishes. But the linker knows all
+// .dwo file names as soon as it relocates .debug_info, so we can create
+// a .dwp file in the background while the rest of the output is being
+// written, and we can do that in parallel.
+//
+// When packaging .dwo files, all .debug_str.dwo sections are merged
+// into one, and .debug_str_offsets.dwo sections are rewritten to refer
+// to the merged strings. Duplicate type units are removed. Other
+// sections are simply concatenated.
+//
+// We support only 32-bit DWARF 5 .dwo files.
+
+#include "mold.h"
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <unordered_set>
+
+namespace mold {
+
+// Sections that are copied from .dwo files to a .dwp file, in the
+// order of columns in .debug_cu_index and .debug_tu_index.
+enum {
+  DWO_INFO,
+  DWO_ABBREV,
+  DWO_LINE,
+  DWO_LOCLISTS,
+  DWO_STR_OFFSETS,
+  DWO_MACRO,
+  DWO_RNGLISTS,
+  NUM_DWO_SECTIONS,
+};
+
+static constexpr std::pair<std::string_view, u32> dwo_sections[] = {
+  {".debug_info.dwo", DW_SECT_INFO},
+  {".debug_abbrev.dwo", DW_SECT_ABBREV},
+  {".debug_line.dwo", DW_SECT_LINE},
+  {".debug_loclists.dwo", DW_SECT_LOCLISTS},
+  {".debug_str_offsets.dwo", DW_SECT_STR_OFFSETS},
+  {".debug_macro.dwo", DW_SECT_MACRO},
+  {".debug_rnglists.dwo", DW_SECT_RNGLISTS},
+};
+
+// DWARF 5 unit header of skeleton, split compile and split type units
+template <typename E>
+struct DwoUnitHdr {
+  U32<E> unit_length;
+  U16<E> version;
+  u8 unit_type;
+  u8 address_size;
+  U32<E> abbrev_offset;
+  U64<E> signature;
+};
+
+template <typename E>
+struct DwpIndexHdr {
+  U16<E> version;
+  U16<E> padding;
+  U32<E> section_count;
+  U32<E> unit_count;
+  U32<E> slot_count;
+};
+
+struct DwpString {
+  u32 offset = 0;
+};
+
+struct DwoUnit {
+  u64 signature = 0;
+  i64 offset = 0;
+  i64 size = 0;
+  i64 out_offset = 0;
+  bool is_type = false;
+  bool is_alive = true;
+};
+
+struct DwoFile {
+  std::string path;
+  MappedFile *mf = nullptr;
+  u32 e_flags = 0;
+  std::string_view sections[NUM_DWO_SECTIONS];
+  std::string_view debug_str;
+  std::vector<DwoUnit> units;
+
+  // Offsets and hashes of strings in .debug_str.dwo
+  std::vector<u32> str_offsets;
+  std::vector<u64> str_hashes;
+  std::vector<DwpString *> strs;
+
+  // Offsets and sizes of this file's contributions to the output sections
+  i64 out_offsets[NUM_DWO_SECTIONS] = {};
+  i64 out_sizes[NUM_DWO_SECTIONS] = {};
+};
+
+// Returns the .dwo file path of a given skeleton compunit, or an empty
+// string if it's not a skeleton compunit.
+template <typename E>
+static std::string
+read_dwo_path(Context<E> &ctx, u8 *p, i64 version, i64 abbrev_offset,
+              std::span<u8> debug_abbrev, std::span<u8> debug_str,
+              std::span<u8> debug_line_str, std::span<u8> debug_str_offsets) {
+  // Find the abbreviation record for the first DIE
+  u64 abbrev_code = read_uleb(&p);
+  u8 *abbrev = debug_abbrev.data() + abbrev_offset;
+
+  for (;;) {
+    u64 code = read_uleb(&abbrev);
+    if (code == 0)
+      Fatal(ctx) << "--dwp: .debug_abbrev does not contain"
+                 << " a record for the first .debug_info record";
+
+    read_uleb(&abbrev); // tag
+    abbrev++; // has_children byte
+    if (code == abbrev_code)
+      break;
+
+    for (;;) {
+      u64 name = read_uleb(&abbrev);
+      u64 form = read_uleb(&abbrev);
+      if (name == 0 && form == 0)
+        break;
+      if (form == DW_FORM_implicit_const)
+        read_uleb(&abbrev);
+    }
+  }
+
+  struct Attr {
+    u64 form = 0;
+    u64 val = 0;
+    u8 *ptr = nullptr;
+  };
+
+  Attr dwo_name;
+  Attr comp_dir;
+  u64 str_offsets_base = 8;
+
+  for (;;) {
+    u64 name = read_uleb(&abbrev);
+    u64 form = read_uleb(&abbrev);
+    if (name == 0 && form == 0)
+      break;
+
+    if (form == DW_FORM_implicit_const) {
+      read_uleb(&abbrev);
+      continue;
+    }
+
+    u8 *ptr = p;
+    u64 val = read_scalar<E, U32<E>>(ctx, &p, form);
+
+    switch (name) {
+    case DW_AT_dwo_name:
+    case DW_AT_GNU_dwo_name:
+      dwo_name = {form, val, ptr};
+      break;
+    case DW_AT_comp_dir:
+      comp_dir = {form, val, ptr};
+      break;
+    case DW_AT_str_offsets_base:
+      str_offsets_base = val;
+      break;
+    }
+  }
+
+  if (!dwo_name.ptr)
+    return "";
+
+  if (version < 5)
+    Fatal(ctx) << "--dwp: split DWARF " << version << " is not supported;"
+               << " compile with -gdwarf-5";
+
+  auto get_string = [&](Attr &attr) -> std::string_view {
+    switch (attr.form) {
+    case DW_FORM_string:
+      return (char *)attr.ptr;
+    case DW_FORM_strp:
+      return (char *)&debug_str[attr.val];
+    case DW_FORM_line_strp:
+      return (char *)&debug_line_str[attr.val];
+    case DW_FORM_strx:
+    case DW_FORM_strx1:
+    case DW_FORM_strx2:
+    case DW_FORM_strx3:
+    case DW_FORM_strx4: {
+      u64 offset = *(U32<E> *)&debug_str_offsets[str_offsets_base + attr.val * 4];
+      return (char *)&debug_str[offset];
+    }
+    }
+    Fatal(ctx) << "--dwp: unhandled form for a string attribute: 0x"
+               << std::hex << attr.form;
+  };
+
+  std::string_view path = get_string(dwo_name);
+  if (path.starts_with('/') || !comp_dir.ptr)
+    return std::string(path);
+  return path_clean(std::string(get_string(comp_dir)) + "/" + std::string(path));
+}
+
+// Returns the .dwo file paths of all skeleton compunits in the output
+// .debug_info. We need relocated debug sections to read them.
+template <typename E>
+static std::vector<std::string> get_dwo_paths(Context<E> &ctx) {
+  std::span<u8> debug_info;
+  std::span<u8> debug_abbrev;
+  std::span<u8> debug_str;
+  std::span<u8> debug_line_str;
+  std::span<u8> debug_str_offsets;
+
+  for (Chunk<E> *chunk : ctx.chunks) {
+    std::string_view name = chunk->name;
+    if (name == ".debug_info")
+      debug_info = get_buffer(ctx, chunk);
+    if (name == ".debug_abbrev")
+      debug_abbrev = get_buffer(ctx, chunk);
+    if (name == ".debug_str")
+      debug_str = get_buffer(ctx, chunk);
+    if (name == ".debug_line_str")
+      debug_line_str = get_buffer(ctx, chunk);
+    if (name == ".debug_str_offsets")
+      debug_str_offsets = get_buffer(ctx, chunk);
+  }
+
+  std::vector<std::string> paths;
+  std::unordered_set<std::string> seen;
+
+  u8 *p = debug_info.data();
+  u8 *end = debug_info.data() + debug_info.size();
+
+  while (p < end) {
+    if (*(U32<E> *)p == 0xffff'ffff)
+      Fatal(ctx) << "--dwp: 64-bit DWARF is not supported";
+
+    u64 unit_length = *(U32<E> *)p;
+    u8 *next = p + 4 + unit_length;
+    i64 version = *(U16<E> *)(p + 4);
+    u8 *die;
+    i64 abbrev_offset;
+
+    if (version == 5) {
+      DwoUnitHdr<E> &hdr = *(DwoUnitHdr<E> *)p;
+      if (hdr.unit_type != DW_UT_skeleton) {
+        p = next;
+        continue;
+      }
+      abbrev_offset = hdr.abbrev_offset;
+      die = p + sizeof(hdr);
+    } else {
+      // DWARF 2-4 unit header
+      abbrev_offset = *(U32<E> *)(p + 6);
+      die = p + 11;
+    }
+
+    std::string path =
+      read_dwo_path(ctx, die, version, abbrev_offset, debug_abbrev,
+                    debug_str, debug_line_str, debug_str_offsets);
+
+    if (!path.empty() && seen.insert(path).second)
+      paths.push_back(path);
+    p = next;
+  }
+  return paths;
+}
+
+template <typename E>
+static void read_dwo_file(Context<E> &ctx, DwoFile &file) {
+  file.mf = must_open_file(ctx, file.path);
+  file.mf->is_dependency = false;
+
+  u8 *buf = file.mf->data;
+  if (file.mf->size < sizeof(ElfEhdr<E>) || memcmp(buf, "\177ELF", 4))
+    Fatal(ctx) << file.path << ": --dwp: not an ELF file";
+
+  ElfEhdr<E> &ehdr = *(ElfEhdr<E> *)buf;
+  if (ehdr.e_machine != E::e_machine)
+    Fatal(ctx) << file.path << ": --dwp: incompatible file type";
+  file.e_flags = ehdr.e_flags;
+
+  ElfShdr<E> *shdrs = (ElfShdr<E> *)(buf + ehdr.e_shoff);
+  i64 shnum = ehdr.e_shnum ? (i64)ehdr.e_shnum : (i64)shdrs[0].sh_size;
+  i64 shstrndx = (ehdr.e_shstrndx == SHN_XINDEX)
+    ? (i64)shdrs[0].sh_link : (i64)ehdr.e_shstrndx;
+  char *shstrtab = (char *)buf + shdrs[shstrndx].sh_offset;
+
+  for (i64 i = 1; i < shnum; i++) {
+    ElfShdr<E> &shdr = shdrs[i];
+    std::string_view name = shstrtab + shdr.sh_name;
+    if (!name.starts_with(".debug_"))
+      continue;
+
+    if (name == ".debug_cu_index" || name == ".debug_tu_index")
+      Fatal(ctx) << file.path << ": --dwp: input is already a DWARF package";
+
+    std::string_view *sec = nullptr;
+    if (name == ".debug_str.dwo")
+      sec = &file.debug_str;
+    for (i64 j = 0; j < NUM_DWO_SECTIONS; j++)
+      if (name == dwo_sections[j].first)
+        sec = &file.sections[j];
+
+    if (!sec)
+      continue;
+    if (shdr.sh_flags & SHF_COMPRESSED)
+      Fatal(ctx) << file.path << ": --dwp: compressed section " << name
+                 << " is not supported";
+    *sec = {(char *)buf + shdr.sh_offset, (size_t)shdr.sh_size};
+  }
+
+  // Read unit headers
+  std::string_view info = file.sections[DWO_INFO];
+
+  for (i64 offset = 0; offset < info.size();) {
+    DwoUnitHdr<E> &hdr = *(DwoUnitHdr<E> *)(info.data() + offset);
+    if (hdr.unit_length == 0xffff'ffff)
+      Fatal(ctx) << file.path << ": --dwp: 64-bit DWARF is not supported";
+    if (hdr.version != 5)
+      Fatal(ctx) << file.path << ": --dwp: DWARF version " << hdr.version
+                 << " is not supported";
+
+    i64 size = hdr.unit_length + 4;
+
+    switch (hdr.unit_type) {
+    case DW_UT_split_compile:
+      file.units.push_back({hdr.signature, offset, size});
+      break;
+    case DW_UT_split_type:
+      file.units.push_back({hdr.signature, offset, size, 0, true});
+      break;
+    default:
+      Fatal(ctx) << file.path << ": --dwp: unknown unit type: 0x"
+                 << std::hex << (u32)hdr.unit_type;
+    }
+    offset += size;
+  }
+
+  // Split .debug_str.dwo into null-terminated strings
+  std::string_view str = file.debug_str;
+
+  for (i64 i = 0; i < str.size();) {
+    size_t end = str.find('\0', i);
+    if (end == str.npos)
+      Fatal(ctx) << file.path << ": --dwp: string is not null-terminated";
+
+    file.str_offsets.push_back(i);
+    file.str_hashes.push_back(hash_string(str.substr(i, end + 1 - i)));
+    i = end + 1;
+  }
+}
+
+// Rewrites string offsets in a .debug_str_offsets.dwo contribution so
+// that they refer to the merged .debug_str.dwo.
+template <typename E>
+static void fix_str_offsets(Context<E> &ctx, DwoFile &file, u8 *p, i64 size) {
+  auto get_offset = [&](u32 val) -> u32 {
+    auto it = std::upper_bound(file.str_offsets.begin(),
+                               file.str_offsets.end(), val);
+    if (it == file.str_offsets.begin() || file.debug_str.size() <= val)
+      Fatal(ctx) << file.path << ": --dwp: bad string offset: " << val;
+
+    i64 idx = it - file.str_offsets.begin() - 1;
+    return file.strs[idx]->offset + val - file.str_offsets[idx];
+  };
+
+  u8 *end = p + size;
+
+  while (p < end) {
+    u64 unit_length = *(U32<E> *)p;
+    if (unit_length == 0xffff'ffff)
+      Fatal(ctx) << file.path << ": --dwp: 64-bit DWARF is not supported";
+
+    U32<E> *q = (U32<E> *)(p + 8);
+    U32<E> *q_end = (U32<E> *)(p + 4 + unit_length);
+    for (; q < q_end; q++)
+      *q = get_offset(*q);
+    p += 4 + unit_length;
+  }
+}
+
+// Creates the contents of .debug_cu_index or .debug_tu_index.
+template <typename E>
+static std::vector<u8>
+create_index(std::vector<DwoFile> &files, std::span<i64> columns,
+             bool is_type) {
+  std::vector<std::pair<DwoFile *, DwoUnit *>> rows;
+  for (DwoFile &file : files)
+    for (DwoUnit &unit : file.units)
+      if (unit.is_alive && unit.is_type == is_type)
+        rows.push_back({&file, &unit});
+
+  if (rows.empty())
+    return {};
+
+  i64 nrows = rows.size();
+  i64 ncols = columns.size();
+  i64 nslots = bit_ceil(nrows * 3 / 2 + 1);
+
+  std::vector<u8> buf(sizeof(DwpIndexHdr<E>) + nslots * 12 +
+                      ncols * 4 + nrows * ncols * 8);
+
+  DwpIndexHdr<E> &hdr = *(DwpIndexHdr<E> *)buf.data();
+  hdr.version = 5;
+  hdr.section_count = ncols;
+  hdr.unit_count = nrows;
+  hdr.slot_count = nslots;
+
+  U64<E> *hashes = (U64<E> *)(buf.data() + sizeof(hdr));
+  U32<E> *indices = (U32<E> *)(hashes + nslots);
+  U32<E> *ids = indices + nslots;
+  U32<E> *offsets = ids + ncols;
+  U32<E> *sizes = offsets + nrows * ncols;
+
+  for (i64 i = 0; i < ncols; i++)
+    ids[i] = dwo_sections[columns[i]].second;
+
+  for (i64 i = 0; i < nrows; i++) {
+    auto [file, unit] = rows[i];
+
+    // Insert a signature to the hash table. Row indices are 1-based
+    // because 0 means an empty slot.
+    u64 mask = nslots - 1;
+    u64 h = unit->signature & mask;
+    u64 step = ((unit->signature >> 32) & mask) | 1;
+    while (indices[h])
+      h = (h + step) & mask;
+    hashes[h] = unit->signature;
+    indices[h] = i + 1;
+
+    for (i64 j = 0; j < ncols; j++) {
+      i64 col = columns[j];
+      if (col == DWO_INFO) {
+        offsets[i * ncols + j] = unit->out_offset;
+        sizes[i * ncols + j] = unit->size;
+      } else if (file->out_sizes[col]) {
+        offsets[i * ncols + j] = file->out_offsets[col];
+        sizes[i * ncols + j] = file->out_sizes[col];
+      }
+    }
+  }
+  return buf;
+}
+
+// Creates a relocatable ELF file containing given sections.
+template <typename E>
+static std::vector<u8>
+create_elf_file(Context<E> &ctx, u32 e_flags,
+                std::vector<std::pair<std::string, std::vector<u8>>> &sections) {
+  // Compress sections if requested
+  std::vector<bool> is_compressed(sections.size());
+
+  if (ctx.arg.compress_debug_sections != COMPRESS_NONE) {
+    tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
+      std::vector<u8> &data = sections[i].second;
+      if (data.empty())
+        return;
+
+      i64 level = ctx.arg.compress_debug_level;
+      ElfChdr<E> chdr = {};
+      std::unique_ptr<Compressor> compressor;
+
+      if (ctx.arg.compress_debug_sections == COMPRESS_ZLIB) {
+        chdr.ch_type = ELFCOMPRESS_ZLIB;
+        compressor.reset(new ZlibCompressor(data.data(), data.size(),
+                                            (level == -1) ? 1 : level));
+      } else {
+        chdr.ch_type = ELFCOMPRESS_ZSTD;
+        compressor.reset(new ZstdCompressor(data.data(), data.size(),
+                                            (level == -1) ? 3 : level,
+                                            ctx.arg.zstd_seek_table));
+      }
+
+      chdr.ch_size = data.size();
+      chdr.ch_addralign = 1;
+
+      std::vector<u8> buf(sizeof(chdr) + compressor->compressed_size);
+      memcpy(buf.data(), &chdr, sizeof(chdr));
+      compressor->write_to(buf.data() + sizeof(chdr));
+      data = std::move(buf);
+      is_compressed[i] = true;
+    });
+  }
+
+  // Compute the file layout. Section 0 is the null section, and the
+  // last one is .shstrtab.
+  std::string shstrtab(1, '\0');
+  std::vector<ElfShdr<E>> shdrs(sections.size() + 2);
+  i64 offset = sizeof(ElfEhdr<E>);
+
+  for (i64 i = 0; i < sections.size(); i++) {
+    ElfShdr<E> &shdr = shdrs[i + 1];
+    shdr.sh_name = shstrtab.size();
+    shdr.sh_type = SHT_PROGBITS;
+    if (is_compressed[i])
+      shdr.sh_flags = SHF_COMPRESSED;
+    shdr.sh_offset = offset;
+    shdr.sh_size = sections[i].second.size();
+    shdr.sh_addralign = 1;
+
+    shstrtab += sections[i].first;
+    shstrtab += '\0';
+    offset += shdr.sh_size;
+  }
+
+  ElfShdr<E> &strtab = shdrs.back();
+  strtab.sh_name = shstrtab.size();
+  shstrtab += ".shstrtab";
+  shstrtab += '\0';
+  strtab.sh_type = SHT_STRTAB;
+  strtab.sh_offset = offset;
+  strtab.sh_size = shstrtab.size();
+  strtab.sh_addralign = 1;
+  offset = align_to(offset + shstrtab.size(), sizeof(Word<E>));
+
+  std::vector<u8> buf(offset + shdrs.size() * sizeof(ElfShdr<E>));
+
+  ElfEhdr<E> &ehdr = *(ElfEhdr<E> *)buf.data();
+  memcpy(&ehdr.e_ident, "\177ELF", 4);
+  ehdr.e_ident[EI_CLASS] = E::is_64 ? ELFCLASS64 : ELFCLASS32;
+  ehdr.e_ident[EI_DATA] = E::is_le ? ELFDATA2LSB : ELFDATA2MSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_type = ET_REL;
+  ehdr.e_machine = E::e_machine;
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_flags = e_flags;
+  ehdr.e_ehsize = sizeof(ElfEhdr<E>);
+  ehdr.e_shoff = offset;
+  ehdr.e_shentsize = sizeof(ElfShdr<E>);
+  ehdr.e_shnum = shdrs.size();
+  ehdr.e_shstrndx = shdrs.size() - 1;
+
+  tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
+    std::vector<u8> &data = sections[i].second;
+    if (!data.empty())
+      memcpy(buf.data() + shdrs[i + 1].sh_offset, data.data(), data.size());
+  });
+
+  memcpy(buf.data() + strtab.sh_offset, shstrtab.data(), shstrtab.size());
+  memcpy(buf.data() + offset, shdrs.data(), shdrs.size() * sizeof(ElfShdr<E>));
+  return buf;
+}
+
+template <typename E>
+static std::vector<u8>
+create_dwp(Context<E> &ctx, const std::vector<std::string> &paths) {
+  Timer t(ctx, "create_dwp");
+
+  std::vector<DwoFile> files(paths.size());
+  for (i64 i = 0; i < paths.size(); i++)
+    files[i].path = paths[i];
+
+  tbb::parallel_for_each(files, [&](DwoFile &file) {
+    read_dwo_file(ctx, file);
+  });
+
+  // Remove duplicate type units. Compunits are not supposed to be
+  // duplicated.
+  std::unordered_set<u64> cu_sigs;
+  std::unordered_set<u64> tu_sigs;
+
+  for (DwoFile &file : files) {
+    for (DwoUnit &unit : file.units) {
+      if (unit.is_type)
+        unit.is_alive = tu_sigs.insert(unit.signature).second;
+      else if (!cu_sigs.insert(unit.signature).second)
+        Fatal(ctx) << file.path << ": --dwp: duplicate DWO ID 0x"
+                   << std::hex << unit.signature;
+    }
+  }
+
+  // Merge .debug_str.dwo sections
+  HyperLogLog estimator;
+
+  tbb::parallel_for_each(files, [&](DwoFile &file) {
+    HyperLogLog e;
+    for (u64 hash : file.str_hashes)
+      e.insert(hash);
+    estimator.merge(e);
+  });
+
+  ConcurrentMap<DwpString> map(estimator.get_cardinality() * 3 / 2);
+
+  tbb::parallel_for_each(files, [&](DwoFile &file) {
+    file.strs.resize(file.str_offsets.size());
+    for (i64 i = 0; i < file.str_offsets.size(); i++) {
+      i64 begin = file.str_offsets[i];
+      i64 end = (i + 1 < file.str_offsets.size())
+        ? file.str_offsets[i + 1] : file.debug_str.size();
+      std::string_view str = file.debug_str.substr(begin, end - begin);
+      file.strs[i] = map.insert(str, file.str_hashes[i], {}).first;
+    }
+  });
+
+  // Assign offsets to merged strings in a deterministic order
+  std::vector<ConcurrentMap<DwpString>::Entry *> ents =
+    map.get_sorted_entries_all();
+
+  i64 str_size = 0;
+  for (ConcurrentMap<DwpString>::Entry *ent : ents) {
+    ent->value.offset = str_size;
+    str_size += ent->keylen;
+  }
+
+  // Assign offsets to each file's contributions
+  i64 sizes[NUM_DWO_SECTIONS] = {};
+
+  for (DwoFile &file : files) {
+    for (i64 i = 0; i < NUM_DWO_SECTIONS; i++) {
+      file.out_offsets[i] = sizes[i];
+      if (i == DWO_INFO) {
+        for (DwoUnit &unit : file.units) {
+          if (unit.is_alive) {
+            unit.out_offset = file.out_offsets[i] + file.out_sizes[i];
+            file.out_sizes[i] += unit.size;
+          }
+        }
+      } else {
+        file.out_sizes[i] = file.sections[i].size();
+      }
+      sizes[i] += file.out_sizes[i];
+    }
+  }
+
+  for (i64 i = 0; i < NUM_DWO_SECTIONS; i++)
+    if (sizes[i] > UINT32_MAX)
+      Fatal(ctx) << "--dwp: " << dwo_sections[i].first << " is too large";
+  if (str_size > UINT32_MAX)
+    Fatal(ctx) << "--dwp: .debug_str.dwo is too large";
+
+  // Copy section contents
+  std::vector<std::vector<u8>> bufs(NUM_DWO_SECTIONS);
+  for (i64 i = 0; i < NUM_DWO_SECTIONS; i++)
+    bufs[i].resize(sizes[i]);
+
+  tbb::parallel_for_each(files, [&](DwoFile &file) {
+    for (i64 i = 0; i < NUM_DWO_SECTIONS; i++) {
+      u8 *dst = bufs[i].data() + file.out_offsets[i];
+
+      if (i == DWO_INFO) {
+        for (DwoUnit &unit : file.units)
+          if (unit.is_alive)
+            memcpy(bufs[i].data() + unit.out_offset,
+                   file.sections[i].data() + unit.offset, unit.size);
+      } else if (file.out_sizes[i]) {
+        memcpy(dst, file.sections[i].data(), file.out_sizes[i]);
+      }
+
+      if (i == DWO_STR_OFFSETS)
+        fix_str_offsets(ctx, file, dst, file.out_sizes[i]);
+    }
+  });
+
+  std::vector<u8> debug_str(str_size);
+  tbb::parallel_for((i64)0, (i64)ents.size(), [&](i64 i) {
+    memcpy(debug_str.data() + ents[i]->value.offset, ents[i]->key,
+           ents[i]->keylen);
+  });
+
+  // Create index sections
+  std::vector<i64> columns;
+  for (i64 i = 0; i < NUM_DWO_SECTIONS; i++)
+    if (sizes[i])
+      columns.push_back(i);
+
+  std::vector<std::pair<std::string, std::vector<u8>>> sections;
+  for (i64 i = 0; i < NUM_DWO_SECTIONS; i++)
+    if (sizes[i])
+      sections.push_back({std::string(dwo_sections[i].first),
+                          std::move(bufs[i])});
+
+  if (str_size)
+    sections.push_back({".debug_str.dwo", std::move(debug_str)});
+
+  if (std::vector<u8> buf = create_index<E>(files, columns, false); !buf.empty())
+    sections.push_back({".debug_cu_index", std::move(buf)});
+  if (std::vector<u8> buf = create_index<E>(files, columns, true); !buf.empty())
+    sections.push_back({".debug_tu_index", std::move(buf)});
+
+  return create_elf_file(ctx, files.empty() ? 0 : files[0].e_flags, sections);
+}
+
+// Start creating a .dwp file in the background. This function has to be
+// called after debug sections are relocated because we read skeleton
+// compunits from the output file.
+template <typename E>
+void start_dwp(Context<E> &ctx) {
+  std::vector<std::string> paths = get_dwo_paths(ctx);
+
+  ctx.dwp_tg.run([&ctx, paths = std::move(paths)] {
+    ctx.dwp_contents = create_dwp(ctx, paths);
+  });
+}
+
+template <typename E>
+void write_dwp(Context<E> &ctx) {
+  Timer t(ctx, "write_dwp");
+  ctx.dwp_tg.wait();
+
+  std::unique_ptr<OutputFile<E>> file =
+    OutputFile<E>::open(ctx, ctx.arg.dwp, ctx.dwp_contents.size(), 0666);
+  memcpy(file->buf, ctx.dwp_contents.data(), ctx.dwp_contents.size());
+  file->close(ctx);
+}
+
+using E = MOLD_TARGET;
+
+template void start_dwp(Context<E> &);
+template void write_dwp(Context<E> &);
+
+} // namespace mold
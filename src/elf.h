@@ -80,6 +80,7 @@ enum : u32 {
   SHT_RELR = 19,
   SHT_LOOS = 0x60000000,
   SHT_LLVM_ADDRSIG = 0x6fff4c03,
+  SHT_LLVM_CALL_GRAPH_PROFILE = 0x6fff4c09,
   SHT_GNU_HASH = 0x6ffffff6,
   SHT_GNU_VERDEF = 0x6ffffffd,
   SHT_GNU_VERNEED = 0x6ffffffe,
@@ -189,6 +190,7 @@ enum : u32 {
   PT_GNU_STACK = 0x6474e551,
   PT_GNU_RELRO = 0x6474e552,
   PT_GNU_PROPERTY = 0x6474e553,
+  PT_GNU_SFRAME = 0x6474e554,
   PT_OPENBSD_RANDOMIZE = 0x65a3dbe6,
   PT_ARM_EXIDX = 0x70000001,
   PT_RISCV_ATTRIBUTES = 0x70000003,
@@ -1389,10 +1391,14 @@ enum : u32 {
 enum : u32 {
   DW_AT_low_pc = 0x11,
   DW_AT_high_pc = 0x12,
+  DW_AT_comp_dir = 0x1b,
   DW_AT_producer = 0x25,
   DW_AT_ranges = 0x55,
+  DW_AT_str_offsets_base = 0x72,
   DW_AT_addr_base = 0x73,
   DW_AT_rnglists_base = 0x74,
+  DW_AT_dwo_name = 0x76,
+  DW_AT_GNU_dwo_name = 0x2130,
 };
 
 enum : u32 {
@@ -1402,9 +1408,31 @@ enum : u32 {
 
 enum : u32 {
   DW_UT_compile = 0x01,
+  DW_UT_type = 0x02,
   DW_UT_partial = 0x03,
   DW_UT_skeleton = 0x04,
   DW_UT_split_compile = 0x05,
+  DW_UT_split_type = 0x06,
+};
+
+enum : u32 {
+  DW_IDX_compile_unit = 0x01,
+  DW_IDX_type_unit = 0x02,
+  DW_IDX_die_offset = 0x03,
+  DW_IDX_parent = 0x04,
+  DW_IDX_type_hash = 0x05,
+  DW_IDX_GNU_internal = 0x2000,
+  DW_IDX_GNU_external = 0x2001,
+};
+
+enum : u32 {
+  DW_SECT_INFO = 1,
+  DW_SECT_ABBREV = 3,
+  DW_SECT_LINE = 4,
+  DW_SECT_LOCLISTS = 5,
+  DW_SECT_STR_OFFSETS = 6,
+  DW_SECT_MACRO = 7,
+  DW_SECT_RNGLISTS = 8,
 };
 
 enum : u32 {
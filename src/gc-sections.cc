@@ -32,19 +32,85 @@ static bool should_keep(const InputSection<E> &isec) {
          is_c_identifier(name);
 }
 
+// Liveness bits are kept in compact per-file bitsets indexed by section
+// index instead of in InputSection objects. Marking is a write-heavy
+// operation done concurrently from many threads, so keeping the bits
+// out of InputSection prevents cache lines containing read-mostly
+// section data from bouncing between cores.
 template <typename E>
-static bool mark_section(InputSection<E> *isec) {
-  return isec && isec->is_alive && !isec->is_visited.test_and_set();
+class LiveSet {
+public:
+  LiveSet(Context<E> &ctx) {
+    if (ctx.objs.empty())
+      return;
+
+    min_priority = ctx.objs[0]->priority;
+    i64 max_priority = min_priority;
+    for (ObjectFile<E> *file : ctx.objs) {
+      min_priority = std::min(min_priority, file->priority);
+      max_priority = std::max(max_priority, file->priority);
+    }
+
+    bits.resize(max_priority - min_priority + 1);
+
+    tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+      i64 nwords = align_to(file->sections.size(), 64) / 64;
+      bits[file->priority - min_priority].reset(new Atomic<u64>[nwords]());
+
+      // Dead sections are marked from the beginning so that we never
+      // look into them during the mark phase.
+      for (i64 i = 0; i < file->sections.size(); i++)
+        if (!file->sections[i] || !file->sections[i]->is_alive)
+          set(*file, i);
+    });
+  }
+
+  // Returns true if a given section is newly marked.
+  bool set(InputSection<E> &isec) {
+    return set(isec.file, isec.shndx);
+  }
+
+  bool test(InputSection<E> &isec) const {
+    return get_word(isec.file, isec.shndx) & get_mask(isec.shndx);
+  }
+
+private:
+  bool set(ObjectFile<E> &file, i64 shndx) {
+    Atomic<u64> &word = get_word(file, shndx);
+    u64 mask = get_mask(shndx);
+
+    // Do an optimistic relaxed load first because it is common that
+    // another thread has already marked the same section.
+    if (word & mask)
+      return false;
+    return !((word |= mask) & mask);
+  }
+
+  Atomic<u64> &get_word(ObjectFile<E> &file, i64 shndx) const {
+    return bits[file.priority - min_priority][shndx / 64];
+  }
+
+  static u64 get_mask(i64 shndx) {
+    return 1ULL << (shndx % 64);
+  }
+
+  std::vector<std::unique_ptr<Atomic<u64>[]>> bits;
+  i64 min_priority = 0;
+};
+
+template <typename E>
+static bool mark_section(LiveSet<E> &live, InputSection<E> *isec) {
+  return isec && live.set(*isec);
 }
 
 template <typename E>
 static tbb::concurrent_vector<InputSection<E> *>
-collect_root_set(Context<E> &ctx) {
+collect_root_set(Context<E> &ctx, LiveSet<E> &live) {
   Timer t(ctx, "collect_root_set");
   tbb::concurrent_vector<InputSection<E> *> rootset;
 
   auto enqueue_section = [&](InputSection<E> *isec) {
-    if (mark_section(isec))
+    if (mark_section(live, isec))
       rootset.push_back(isec);
   };
 
@@ -69,7 +135,7 @@ collect_root_set(Context<E> &ctx) {
       // --strip-all linker option.
       u32 flags = isec->shdr().sh_flags;
       if (!(flags & SHF_ALLOC))
-        isec->is_visited = true;
+        live.set(*isec);
 
       if (should_keep(*isec))
         enqueue_section(isec.get());
@@ -96,9 +162,9 @@ collect_root_set(Context<E> &ctx) {
 }
 
 template <typename E>
-static void visit(Context<E> &ctx, InputSection<E> *isec,
+static void visit(Context<E> &ctx, LiveSet<E> &live, InputSection<E> *isec,
                   tbb::feeder<InputSection<E> *> &feeder, i64 depth) {
-  assert(isec->is_visited);
+  assert(live.test(*isec));
 
   // If this is a text section, .eh_frame may contain records
   // describing how to handle exceptions for that function.
@@ -106,54 +172,54 @@ static void visit(Context<E> &ctx, InputSection<E> *isec,
   for (FdeRecord<E> &fde : isec->get_fdes())
     for (const ElfRel<E> &rel : fde.get_rels(isec->file).subspan(1))
       if (Symbol<E> *sym = isec->file.symbols[rel.r_sym])
-        if (mark_section(sym->get_input_section()))
+        if (mark_section(live, sym->get_input_section()))
           feeder.add(sym->get_input_section());
 
-  for (const ElfRel<E> &rel : isec->get_rels(ctx)) {
-    Symbol<E> &sym = *isec->file.symbols[rel.r_sym];
-
-    // Symbol can refer to either a section fragment or an input section.
-    // Mark a fragment as alive.
-    if (SectionFragment<E> *frag = sym.get_frag()) {
+  isec->for_each_ref(ctx, [&](SectionRef<E> ref) {
+    // A relocation can refer to either a section fragment or an input
+    // section. Mark a fragment as alive.
+    if (SectionFragment<E> *frag = ref.get_frag()) {
       frag->is_alive = true;
-      continue;
+      return;
     }
 
     // Mark a section alive. For better performacne, we don't call
     // `feeder.add` too often.
-    if (mark_section(sym.get_input_section())) {
+    InputSection<E> *dst = ref.get_input_section();
+    if (mark_section(live, dst)) {
       if (depth < 3)
-        visit(ctx, sym.get_input_section(), feeder, depth + 1);
+        visit(ctx, live, dst, feeder, depth + 1);
       else
-        feeder.add(sym.get_input_section());
+        feeder.add(dst);
     }
-  }
+  });
 }
 
 // Mark all reachable sections
 template <typename E>
-static void mark(Context<E> &ctx,
+static void mark(Context<E> &ctx, LiveSet<E> &live,
                  tbb::concurrent_vector<InputSection<E> *> &rootset) {
   Timer t(ctx, "mark");
 
   tbb::parallel_for_each(rootset, [&](InputSection<E> *isec,
                                       tbb::feeder<InputSection<E> *> &feeder) {
-    visit(ctx, isec, feeder, 0);
+    visit(ctx, live, isec, feeder, 0);
   });
 }
 
 // Remove unreachable sections
 template <typename E>
-static void sweep(Context<E> &ctx) {
+static void sweep(Context<E> &ctx, LiveSet<E> &live) {
   Timer t(ctx, "sweep");
   static Counter counter("garbage_sections");
 
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
     for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
-      if (isec && isec->is_alive && !isec->is_visited) {
+      if (isec && isec->is_alive && !live.test(*isec)) {
         if (ctx.arg.print_gc_sections)
           Out(ctx) << "removing unused section " << *isec;
         isec->kill();
+        file->num_gc_removed++;
         counter++;
       }
     }
@@ -163,9 +229,11 @@ static void sweep(Context<E> &ctx) {
 template <typename E>
 void gc_sections(Context<E> &ctx) {
   Timer t(ctx, "gc");
-  tbb::concurrent_vector<InputSection<E> *> rootset = collect_root_set(ctx);
-  mark(ctx, rootset);
-  sweep(ctx);
+  LiveSet<E> live(ctx);
+  tbb::concurrent_vector<InputSection<E> *> rootset =
+    collect_root_set(ctx, live);
+  mark(ctx, live, rootset);
+  sweep(ctx, live);
 }
 
 using E = MOLD_TARGET;
@@ -183,8 +183,22 @@ static DwarfKind get_dwarf_kind(Context<E> &ctx, u8 *p) {
   return (hdr.version == 5) ? DWARF5_32 : DWARF2_32;
 }
 
+// Compunits in an object file created by LTO usually share the same
+// abbreviation table. This is a cache from (abbreviation table offset,
+// abbreviation code) to the attribute list of a record so that we don't
+// search the same table for each of such compunits.
+struct AbbrevCacheHash {
+  size_t operator()(const std::pair<u64, u64> &key) const {
+    return combine_hash(key.first, key.second);
+  }
+};
+
+using AbbrevCache =
+  tbb::concurrent_unordered_map<std::pair<u64, u64>, u8 *, AbbrevCacheHash>;
+
 template <typename E, typename CuHdr>
-u8 *find_cu_abbrev(Context<E> &ctx, u8 **p, const CuHdr &hdr) {
+u8 *find_cu_abbrev(Context<E> &ctx, u8 **p, const CuHdr &hdr,
+                   AbbrevCache &cache) {
   if (hdr.address_size != sizeof(Word<E>))
     Fatal(ctx) << "--gdb-index: unsupported address size " << hdr.address_size;
 
@@ -205,6 +219,10 @@ u8 *find_cu_abbrev(Context<E> &ctx, u8 **p, const CuHdr &hdr) {
 
   i64 abbrev_code = read_uleb(p);
 
+  std::pair<u64, u64> key = {hdr.abbrev_offset, abbrev_code};
+  if (auto it = cache.find(key); it != cache.end())
+    return it->second;
+
   // Find a .debug_abbrev record corresponding to the .debug_info record.
   // We assume the .debug_info record at a given offset is of
   // DW_TAG_compile_unit which describes a compunit.
@@ -240,6 +258,7 @@ u8 *find_cu_abbrev(Context<E> &ctx, u8 **p, const CuHdr &hdr) {
   }
 
   abbrev++; // skip has_children byte
+  cache.insert({key, abbrev});
   return abbrev;
 }
 
@@ -394,13 +413,13 @@ read_rnglist_range(std::vector<std::pair<u64, u64>> &vec, u8 *p,
 // from .debug_addr for DWARF5).
 template <typename E, typename CuHdr>
 static std::vector<std::pair<u64, u64>>
-read_address_ranges(Context<E> &ctx, const Compunit &cu) {
+read_address_ranges(Context<E> &ctx, const Compunit &cu, AbbrevCache &cache) {
   // Read .debug_info to find the record at a given offset.
   u8 *p = &ctx.debug_info[0] + cu.offset;
   CuHdr &hdr = *(CuHdr *)p;
   p += sizeof(hdr);
 
-  u8 *abbrev = find_cu_abbrev(ctx, &p, hdr);
+  u8 *abbrev = find_cu_abbrev(ctx, &p, hdr, cache);
 
   // Now, read debug info records.
   struct Record {
@@ -577,39 +596,79 @@ static void read_pubnames(Context<E> &ctx, std::vector<Compunit> &cus,
 }
 
 template <typename E>
-static std::vector<Compunit> read_compunits(Context<E> &ctx) {
-  std::vector<Compunit> cus;
+static void read_names(Context<E> &ctx, std::vector<Compunit> &cus) {
+  // Read symbols from .debug_gnu_pubnames and .debug_gnu_pubtypes.
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    read_pubnames(ctx, cus, *file);
+  });
+
+  // Uniquify elements because GCC 11 seems to emit one record for each
+  // comdat group which results in having a lot of duplicate records.
+  tbb::parallel_for_each(cus, [&](Compunit &cu) {
+    sort(cu.nametypes);
+    remove_duplicates(cu.nametypes);
+  });
+}
+
+// An output .debug_info is a concatenation of input .debug_info
+// sections, and no compunit spans over two input sections. So we can
+// split the output section at the input section boundaries and read
+// compunit headers in each piece in parallel.
+template <typename E>
+static std::vector<std::pair<i64, i64>>
+get_debug_info_shards(Context<E> &ctx, Chunk<E> *chunk) {
+  std::vector<std::pair<i64, i64>> vec;
+  if (OutputSection<E> *osec = chunk->to_osec()) {
+    for (InputSection<E> *isec : osec->members)
+      if (isec->sh_size)
+        vec.emplace_back(isec->offset, isec->offset + isec->sh_size);
+  } else {
+    vec.emplace_back(0, ctx.debug_info.size());
+  }
+  return vec;
+}
+
+template <typename E>
+static std::vector<Compunit>
+read_compunits(Context<E> &ctx, std::span<std::pair<i64, i64>> shards) {
+  std::vector<std::vector<Compunit>> vec(shards.size());
 
   // Read compunits from the output .debug_info section.
-  u8 *begin = &ctx.debug_info[0];
-  u8 *end = begin + ctx.debug_info.size();
+  tbb::parallel_for((i64)0, (i64)shards.size(), [&](i64 i) {
+    u8 *begin = &ctx.debug_info[0];
+    u8 *end = begin + shards[i].second;
+
+    for (u8 *p = begin + shards[i].first; p < end;) {
+      DwarfKind kind = get_dwarf_kind(ctx, p);
+      i64 size;
+      if (kind == DWARF2_32 || kind == DWARF5_32)
+        size = ((CuHdrDwarf2_32<E> *)p)->size + 4;
+      else
+        size = ((CuHdrDwarf2_64<E> *)p)->size + 12;
 
-  for (u8 *p = begin; p < end;) {
-    DwarfKind kind = get_dwarf_kind(ctx, p);
-    i64 size;
-    if (kind == DWARF2_32 || kind == DWARF5_32)
-      size = ((CuHdrDwarf2_32<E> *)p)->size + 4;
-    else
-      size = ((CuHdrDwarf2_64<E> *)p)->size + 12;
+      vec[i].push_back(Compunit{kind, p - begin, size});
+      p += size;
+    }
+  });
 
-    cus.push_back(Compunit{kind, p - begin, size});
-    p += size;
-  }
+  std::vector<Compunit> cus = flatten(vec);
 
   // Read address ranges for each compunit.
+  AbbrevCache cache;
+
   tbb::parallel_for_each(cus, [&](Compunit &cu) {
     switch (cu.kind) {
     case DWARF2_32:
-      cu.ranges = read_address_ranges<E, CuHdrDwarf2_32<E>>(ctx, cu);
+      cu.ranges = read_address_ranges<E, CuHdrDwarf2_32<E>>(ctx, cu, cache);
       break;
     case DWARF5_32:
-      cu.ranges = read_address_ranges<E, CuHdrDwarf5_32<E>>(ctx, cu);
+      cu.ranges = read_address_ranges<E, CuHdrDwarf5_32<E>>(ctx, cu, cache);
       break;
     case DWARF2_64:
-      cu.ranges = read_address_ranges<E, CuHdrDwarf2_64<E>>(ctx, cu);
+      cu.ranges = read_address_ranges<E, CuHdrDwarf2_64<E>>(ctx, cu, cache);
       break;
     case DWARF5_64:
-      cu.ranges = read_address_ranges<E, CuHdrDwarf5_64<E>>(ctx, cu);
+      cu.ranges = read_address_ranges<E, CuHdrDwarf5_64<E>>(ctx, cu, cache);
       break;
     }
 
@@ -619,18 +678,85 @@ static std::vector<Compunit> read_compunits(Context<E> &ctx) {
     });
   });
 
-  // Read symbols from .debug_gnu_pubnames and .debug_gnu_pubtypes.
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    read_pubnames(ctx, cus, *file);
+  read_names(ctx, cus);
+  return cus;
+}
+
+// .gdb_index is usually created from relocated debug sections, but if
+// each input .debug_info contains only one compunit, we can create it
+// from input sections instead. In that case, address ranges of a
+// compunit are computed from the final addresses of the object file's
+// live executable sections rather than from DWARF. This function
+// returns an empty vector if it's not possible.
+template <typename E>
+static std::vector<Compunit> read_input_compunits(Context<E> &ctx) {
+  std::vector<ObjectFile<E> *> files;
+  for (ObjectFile<E> *file : ctx.objs)
+    if (file->debug_info && file->debug_info->is_alive &&
+        !file->debug_info->contents.empty())
+      files.push_back(file);
+
+  sort(files, [](ObjectFile<E> *a, ObjectFile<E> *b) {
+    return a->debug_info->offset < b->debug_info->offset;
   });
 
-  // Uniquify elements because GCC 11 seems to emit one record for each
-  // comdat group which results in having a lot of duplicate records.
-  tbb::parallel_for_each(cus, [&](Compunit &cu) {
-    sort(cu.nametypes);
-    remove_duplicates(cu.nametypes);
+  std::vector<Compunit> cus(files.size());
+  Atomic<bool> ok = true;
+
+  tbb::parallel_for((i64)0, (i64)files.size(), [&](i64 i) {
+    ObjectFile<E> &file = *files[i];
+    InputSection<E> &isec = *file.debug_info;
+
+    // We don't want to uncompress sections that are being copied to
+    // the output file in parallel.
+    if (isec.shdr().sh_flags & SHF_COMPRESSED) {
+      ok = false;
+      return;
+    }
+
+    i64 num_debug_info = 0;
+    for (std::unique_ptr<InputSection<E>> &sec : file.sections)
+      if (sec && sec->is_alive && sec->name() == ".debug_info")
+        num_debug_info++;
+
+    u8 *p = (u8 *)isec.contents.data();
+    DwarfKind kind = get_dwarf_kind(ctx, p);
+    i64 size;
+    if (kind == DWARF2_32 || kind == DWARF5_32)
+      size = ((CuHdrDwarf2_32<E> *)p)->size + 4;
+    else
+      size = ((CuHdrDwarf2_64<E> *)p)->size + 12;
+
+    if (num_debug_info != 1 || size != isec.contents.size()) {
+      ok = false;
+      return;
+    }
+
+    Compunit &cu = cus[i];
+    cu.kind = kind;
+    cu.offset = isec.offset;
+    cu.size = size;
+
+    for (std::unique_ptr<InputSection<E>> &sec : file.sections)
+      if (sec && sec->is_alive && (sec->shdr().sh_flags & SHF_EXECINSTR) &&
+          sec->sh_size)
+        cu.ranges.emplace_back(sec->get_addr(), sec->get_addr() + sec->sh_size);
+
+    // Merge adjacent ranges
+    sort(cu.ranges);
+    i64 j = 0;
+    for (i64 k = 1; k < cu.ranges.size(); k++) {
+      if (cu.ranges[k].first <= cu.ranges[j].second)
+        cu.ranges[j].second = std::max(cu.ranges[j].second, cu.ranges[k].second);
+      else
+        cu.ranges[++j] = cu.ranges[k];
+    }
+    if (!cu.ranges.empty())
+      cu.ranges.resize(j + 1);
   });
 
+  if (!ok)
+    return {};
   return cus;
 }
 
@@ -641,31 +767,10 @@ std::span<u8> get_buffer(Context<E> &ctx, Chunk<E> *chunk) {
   return {ctx.buf + chunk->shdr.sh_offset, (size_t)chunk->shdr.sh_size};
 }
 
+// Creates .gdb_index contents in a given buffer.
 template <typename E>
-void write_gdb_index(Context<E> &ctx) {
-  Timer t(ctx, "write_gdb_index");
-
-  // Find debug info sections
-  for (Chunk<E> *chunk : ctx.chunks) {
-    std::string_view name = chunk->name;
-    if (name == ".debug_info")
-      ctx.debug_info = get_buffer(ctx, chunk);
-    if (name == ".debug_abbrev")
-      ctx.debug_abbrev = get_buffer(ctx, chunk);
-    if (name == ".debug_ranges")
-      ctx.debug_ranges = get_buffer(ctx, chunk);
-    if (name == ".debug_addr")
-      ctx.debug_addr = get_buffer(ctx, chunk);
-    if (name == ".debug_rnglists")
-      ctx.debug_rnglists = get_buffer(ctx, chunk);
-  }
-
-  if (ctx.debug_info.empty())
-    return;
-
-  // Read debug info
-  std::vector<Compunit> cus = read_compunits(ctx);
-
+static void create_gdb_index(Context<E> &ctx, std::vector<Compunit> &cus,
+                             std::vector<u8> &vec) {
   // Uniquify symbols
   HyperLogLog estimator;
 
@@ -683,8 +788,12 @@ void write_gdb_index(Context<E> &ctx) {
     for (NameType &nt : cu.nametypes) {
       MapValue *ent;
       bool inserted;
-      std::tie(ent, inserted) = map.insert(nt.name, nt.hash,
-                                           MapValue{gdb_hash(nt.name)});
+      std::tie(ent, inserted) = map.insert(nt.name, nt.hash, MapValue{});
+
+      // The same name typically appears in many compunits, so we
+      // compute the .gdb_index hash only once for each unique name.
+      if (inserted)
+        ent->gdb_hash = gdb_hash(nt.name);
       ent->count++;
       cu.entries.push_back(ent);
     }
@@ -721,8 +830,8 @@ void write_gdb_index(Context<E> &ctx) {
   i64 bufsize = hdr.const_pool_offset + offset;
 
   // Allocate an output buffer
-  ctx.output_file->buf2.resize(bufsize);
-  u8 *buf = ctx.output_file->buf2.data();
+  vec.resize(bufsize);
+  u8 *buf = vec.data();
 
   // Write a section header
   memcpy(buf, &hdr, sizeof(hdr));
@@ -780,15 +889,880 @@ void write_gdb_index(Context<E> &ctx) {
            ent->key, ent->keylen);
   });
 
+}
+
+// If debug sections are compressed, their uncompressed contents are
+// gone once compress_debug_sections() returns. This function is called
+// before compressing them to create .gdb_index contents up front, so
+// that we don't have to keep uncompressed copies of entire debug
+// sections in memory until write_gdb_index().
+//
+// Only the sections that we actually read are written to temporary
+// buffers, and they are freed before we start compressing sections.
+template <typename E>
+void create_gdb_index_early(Context<E> &ctx) {
+  Timer t(ctx, "create_gdb_index_early");
+
+  std::vector<Compunit> cus = read_input_compunits(ctx);
+  if (!cus.empty()) {
+    read_names(ctx, cus);
+    create_gdb_index(ctx, cus, ctx.gdb_index->contents);
+    return;
+  }
+
+  Chunk<E> *debug_info = nullptr;
+  std::vector<Chunk<E> *> chunks;
+  std::vector<std::span<u8> *> spans;
+
+  for (Chunk<E> *chunk : ctx.chunks) {
+    std::string_view name = chunk->name;
+    std::span<u8> *span = nullptr;
+
+    if (name == ".debug_info") {
+      span = &ctx.debug_info;
+      debug_info = chunk;
+    }
+    if (name == ".debug_abbrev")
+      span = &ctx.debug_abbrev;
+    if (name == ".debug_ranges")
+      span = &ctx.debug_ranges;
+    if (name == ".debug_addr")
+      span = &ctx.debug_addr;
+    if (name == ".debug_rnglists")
+      span = &ctx.debug_rnglists;
+
+    if (span) {
+      chunks.push_back(chunk);
+      spans.push_back(span);
+    }
+  }
+
+  if (!debug_info)
+    return;
+
+  std::vector<std::vector<u8>> bufs(chunks.size());
+
+  tbb::parallel_for((i64)0, (i64)chunks.size(), [&](i64 i) {
+    bufs[i].resize(chunks[i]->shdr.sh_size);
+    chunks[i]->write_to(ctx, bufs[i].data(), nullptr);
+    *spans[i] = bufs[i];
+  });
+
+  std::vector<std::pair<i64, i64>> shards =
+    get_debug_info_shards(ctx, debug_info);
+  cus = read_compunits(ctx, shards);
+  create_gdb_index(ctx, cus, ctx.gdb_index->contents);
+
+  for (std::span<u8> *span : spans)
+    *span = {};
+}
+
+// Starts creating .gdb_index from input sections in the background,
+// so that it runs in parallel with copy_chunks().
+template <typename E>
+void start_gdb_index(Context<E> &ctx) {
+  // Already created by create_gdb_index_early()
+  if (!ctx.gdb_index->contents.empty())
+    return;
+
+  ctx.gdb_index_tg.run([&] {
+    Timer t(ctx, "create_gdb_index");
+    std::vector<Compunit> cus = read_input_compunits(ctx);
+    if (cus.empty())
+      return;
+    read_names(ctx, cus);
+    create_gdb_index(ctx, cus, ctx.gdb_index->contents);
+  });
+}
+
+template <typename E>
+void write_gdb_index(Context<E> &ctx) {
+  Timer t(ctx, "write_gdb_index");
+
+  std::vector<u8> &buf = ctx.output_file->buf2;
+
+  ctx.gdb_index_tg.wait();
+
+  if (!ctx.gdb_index->contents.empty()) {
+    buf = std::move(ctx.gdb_index->contents);
+  } else {
+    // Find debug info sections
+    Chunk<E> *debug_info = nullptr;
+
+    for (Chunk<E> *chunk : ctx.chunks) {
+      std::string_view name = chunk->name;
+      if (name == ".debug_info") {
+        ctx.debug_info = get_buffer(ctx, chunk);
+        debug_info = chunk;
+      }
+      if (name == ".debug_abbrev")
+        ctx.debug_abbrev = get_buffer(ctx, chunk);
+      if (name == ".debug_ranges")
+        ctx.debug_ranges = get_buffer(ctx, chunk);
+      if (name == ".debug_addr")
+        ctx.debug_addr = get_buffer(ctx, chunk);
+      if (name == ".debug_rnglists")
+        ctx.debug_rnglists = get_buffer(ctx, chunk);
+    }
+
+    if (ctx.debug_info.empty())
+      return;
+
+    // Read debug info
+    std::vector<std::pair<i64, i64>> shards =
+      get_debug_info_shards(ctx, debug_info);
+    std::vector<Compunit> cus = read_compunits(ctx, shards);
+    create_gdb_index(ctx, cus, buf);
+  }
+
   // Update the section size and rewrite the section header
   if (ctx.shdr) {
-    ctx.gdb_index->shdr.sh_size = bufsize;
+    ctx.gdb_index->shdr.sh_size = buf.size();
     ctx.shdr->copy_buf(ctx);
   }
 }
 
+// .debug_names is the DWARF 5 successor of .gdb_index. It is an on-disk
+// hash table from names to debug info entries (DIEs), and both LLDB and
+// gdb use it to avoid scanning the whole .debug_info at startup.
+//
+// If given `--debug-names`, we create a single .debug_names section for
+// the whole output. Names are read from per-file .debug_names input
+// sections (usually created by Clang's `-gpubnames`) or, if an input file
+// doesn't have one, synthesized from .debug_gnu_pubnames and
+// .debug_gnu_pubtypes.
+//
+// Unlike .gdb_index, .debug_names refers to names by offsets into
+// .debug_str. Strings in input .debug_gnu_pubnames are not in .debug_str,
+// so we have to add them to .debug_str before fixing the output layout.
+// Therefore, we construct .debug_names before computing section sizes
+// from unrelocated input sections. That's possible because all we need
+// are offsets within compunits and offsets of compunits and strings,
+// which are known once the layout is fixed.
+//
+// We create only one abbreviation for each (DW_TAG, linkage) pair. Each
+// entry has a compunit index, a DIE offset, and a DW_IDX_GNU_internal flag
+// for a static name. Type units and DW_IDX_parent are not supported, and
+// entries referring to type units in input .debug_names are dropped.
+//
+// This page explains the format of .debug_names:
+// https://dwarfstd.org/doc/DWARF5.pdf (Section 6.1.1)
+
+template <typename E>
+struct DebugNamesHdr {
+  U32<E> unit_length;
+  U16<E> version;
+  U16<E> padding;
+  U32<E> comp_unit_count;
+  U32<E> local_type_unit_count;
+  U32<E> foreign_type_unit_count;
+  U32<E> bucket_count;
+  U32<E> name_count;
+  U32<E> abbrev_table_size;
+  U32<E> augmentation_string_size;
+};
+
+// The hash function for .debug_names. This is the same as the one for
+// .gnu.hash.
+static u32 djb_hash(std::string_view name) {
+  u32 h = 5381;
+  for (u8 c : name)
+    h = (h << 5) + h + c;
+  return h;
+}
+
+template <typename E>
+struct DebugNamesValue {
+  SectionFragment<E> *frag = nullptr;
+  i64 frag_offset = 0;
+  u32 hash = 0;
+  u32 idx = 0;
+  Atomic<u32> count;
+  Atomic<u32> cursor;
+};
+
+template <typename E>
+struct NameRecord {
+  std::string_view name;
+  u64 hash;
+  SectionFragment<E> *frag;
+  i64 frag_offset;
+  typename DebugNamesSection<E>::Entry ent;
+  DebugNamesValue<E> *value;
+};
+
+template <typename E>
+struct DebugNamesInput {
+  struct Unit {
+    i64 offset;
+    i64 size;
+    u8 *abbrev_offset;
+    bool is_dwarf64;
+    std::vector<u32> tags;
+  };
+
+  std::vector<Unit> units;
+  std::vector<NameRecord<E>> names;
+  std::vector<std::string_view> augmentations;
+  bool has_pubnames = false;
+};
+
+// Returns a relocation at a given offset of a section.
+template <typename E>
+static const ElfRel<E> *
+find_rel(std::span<const ElfRel<E>> rels, u64 offset) {
+  auto it = std::lower_bound(rels.begin(), rels.end(), offset,
+                             [](const ElfRel<E> &rel, u64 offset) {
+    return rel.r_offset < offset;
+  });
+
+  if (it != rels.end() && it->r_offset == offset)
+    return &*it;
+
+  // Relocations are usually sorted, but that's not guaranteed.
+  for (const ElfRel<E> &rel : rels)
+    if (rel.r_offset == offset)
+      return &rel;
+  return nullptr;
+}
+
+// Since we read debug sections before applying relocations, we need
+// to compute a relocated value of a section offset ourselves. This
+// function returns an offset from the beginning of the referenced
+// input section.
+template <typename E, typename Offset>
+static u64 read_section_offset(InputSection<E> &isec,
+                               std::span<const ElfRel<E>> rels, u8 *loc) {
+  i64 offset = loc - (u8 *)isec.contents.data();
+  if (const ElfRel<E> *rel = find_rel(rels, offset))
+    return isec.file.elf_syms[rel->r_sym].st_value + get_addend(isec, *rel);
+  return *(Offset *)loc;
+}
+
+// Read compunits in a .debug_info input section. Type units are
+// skipped because they can't be in a compunit list.
+template <typename E>
+static void read_units(Context<E> &ctx, DebugNamesInput<E> &in,
+                       InputSection<E> &isec) {
+  u8 *begin = (u8 *)isec.contents.data();
+  u8 *end = begin + isec.contents.size();
+
+  for (u8 *p = begin; p < end;) {
+    bool is_dwarf64 = (*(U32<E> *)p == 0xffff'ffff);
+    u8 *hdr = p + (is_dwarf64 ? 12 : 4);
+    i64 size = is_dwarf64 ? *(U64<E> *)(p + 4) + 12 : *(U32<E> *)p + 4;
+
+    i64 version = *(U16<E> *)hdr;
+    if (version < 2 || 5 < version)
+      Fatal(ctx) << isec << ": --debug-names: DWARF version " << version
+                 << " is not supported";
+
+    if (version == 5) {
+      u8 unit_type = hdr[2];
+      if (unit_type != DW_UT_type && unit_type != DW_UT_split_type)
+        in.units.push_back({p - begin, size, hdr + 4, is_dwarf64});
+    } else {
+      in.units.push_back({p - begin, size, hdr + 2, is_dwarf64});
+    }
+    p += size;
+  }
+}
+
+// Returns a map from abbreviation codes to DW_TAG values for a compunit.
+template <typename E>
+static std::vector<u32> read_tags(Context<E> &ctx, ObjectFile<E> &file,
+                                  typename DebugNamesInput<E>::Unit &unit) {
+  InputSection<E> &info = *file.debug_info;
+  InputSection<E> *abbrev_sec = file.debug_abbrev;
+  if (!abbrev_sec)
+    Fatal(ctx) << file << ": --debug-names: .debug_abbrev is missing";
+
+  abbrev_sec->uncompress(ctx);
+
+  std::span<const ElfRel<E>> rels = info.get_rels(ctx);
+  u64 offset;
+  if (unit.is_dwarf64)
+    offset = read_section_offset<E, U64<E>>(info, rels, unit.abbrev_offset);
+  else
+    offset = read_section_offset<E, U32<E>>(info, rels, unit.abbrev_offset);
+
+  if (offset >= abbrev_sec->contents.size())
+    Fatal(ctx) << file << ": --debug-names: corrupted abbrev offset";
+
+  std::vector<u32> tags;
+  u8 *p = (u8 *)abbrev_sec->contents.data() + offset;
+
+  for (;;) {
+    u64 code = read_uleb(&p);
+    if (code == 0)
+      break;
+    if (code >= 1'000'000)
+      Fatal(ctx) << file << ": --debug-names: abbrev code too large";
+
+    if (tags.size() <= code)
+      tags.resize(code + 1);
+    tags[code] = read_uleb(&p);
+    p++; // has_children byte
+
+    for (;;) {
+      u64 name = read_uleb(&p);
+      u64 form = read_uleb(&p);
+      if (name == 0 && form == 0)
+        break;
+      if (form == DW_FORM_implicit_const)
+        read_uleb(&p);
+    }
+  }
+  return tags;
+}
+
+template <typename E, typename PubnamesHdr>
+static i64 read_pubnames_names(Context<E> &ctx, DebugNamesInput<E> &in,
+                               ObjectFile<E> &file, InputSection<E> &isec,
+                               const PubnamesHdr &hdr) {
+  using Offset = decltype(hdr.size);
+
+  i64 size = hdr.size + offsetof(PubnamesHdr, size) + sizeof(hdr.size);
+  u8 *p = (u8 *)&hdr + sizeof(hdr);
+  u8 *end = (u8 *)&hdr + size;
+
+  u64 cu_offset = read_section_offset<E, Offset>(
+    isec, isec.get_rels(ctx), (u8 *)&hdr.debug_info_offset);
+
+  auto it = std::lower_bound(in.units.begin(), in.units.end(), cu_offset,
+                             [](auto &unit, u64 offset) {
+    return unit.offset < offset;
+  });
+
+  if (it == in.units.end() || it->offset != cu_offset)
+    Fatal(ctx) << file << ": corrupted debug_info_offset";
+
+  if (it->tags.empty())
+    it->tags = read_tags(ctx, file, *it);
+
+  u8 *info = (u8 *)file.debug_info->contents.data() + it->offset;
+  u32 cu_idx = it - in.units.begin();
+
+  while (p < end) {
+    u64 die_offset = *(Offset *)p;
+    if (die_offset == 0)
+      break;
+    p += sizeof(Offset);
+
+    u8 type = *p++;
+    std::string_view name = (char *)p;
+    p += name.size() + 1;
+
+    // Find the DW_TAG of the DIE. If the DIE is not in this compunit
+    // (e.g. it's in a .dwo file), we can't index it.
+    if (it->size <= die_offset)
+      continue;
+
+    u8 *die = info + die_offset;
+    u64 code = read_uleb(&die);
+    if (code == 0 || it->tags.size() <= code || it->tags[code] == 0)
+      continue;
+
+    // The most significant bit of the type is set for a static name.
+    typename DebugNamesSection<E>::Entry ent = {
+      cu_idx, (u32)die_offset, it->tags[code], (u32)(type >> 7),
+    };
+
+    std::string_view data(name.data(), name.size() + 1);
+    in.names.push_back({name, hash_string(data), nullptr, 0, ent});
+  }
+
+  return size;
+}
+
+// Reads names from .debug_gnu_pubnames and .debug_gnu_pubtypes.
+template <typename E>
+static void read_pubnames(Context<E> &ctx, DebugNamesInput<E> &in,
+                          ObjectFile<E> &file) {
+  for (InputSection<E> *isec : { file.debug_pubnames, file.debug_pubtypes }) {
+    if (!isec)
+      continue;
+
+    isec->uncompress(ctx);
+    if (isec->contents.empty())
+      continue;
+
+    in.has_pubnames = true;
+
+    u8 *p = (u8 *)&isec->contents[0];
+    u8 *end = p + isec->contents.size();
+
+    while (p < end) {
+      if (*(U32<E> *)p == 0xffff'ffff)
+        p += read_pubnames_names(ctx, in, file, *isec, *(PubnamesHdr64<E> *)p);
+      else
+        p += read_pubnames_names(ctx, in, file, *isec, *(PubnamesHdr32<E> *)p);
+    }
+  }
+}
+
+// Reads names from an input .debug_names.
+template <typename E>
+static void read_debug_names(Context<E> &ctx, DebugNamesInput<E> &in,
+                             ObjectFile<E> &file, MergedSection<E> *debug_str) {
+  InputSection<E> &isec = *file.debug_names;
+  isec.uncompress(ctx);
+
+  std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+  u8 *begin = (u8 *)isec.contents.data();
+  u8 *end = begin + isec.contents.size();
+
+  struct Abbrev {
+    u64 tag;
+    std::vector<std::pair<u64, u64>> attrs;
+  };
+
+  // A .debug_names section may contain more than one name index.
+  for (u8 *p = begin; p < end;) {
+    DebugNamesHdr<E> &hdr = *(DebugNamesHdr<E> *)p;
+    if (hdr.unit_length == 0xffff'ffff)
+      Fatal(ctx) << isec << ": --debug-names: DWARF64 is not supported";
+    if (hdr.version != 5)
+      Fatal(ctx) << isec << ": --debug-names: unknown version: "
+                 << hdr.version;
+
+    u8 *next = p + hdr.unit_length + 4;
+    u8 *aug = p + sizeof(hdr);
+    std::string_view augmentation((char *)aug, hdr.augmentation_string_size);
+    in.augmentations.push_back(augmentation.substr(0, augmentation.find('\0')));
+
+    // Read a compunit list and convert them to indices of compunits
+    // in the input .debug_info.
+    U32<E> *cu_list = (U32<E> *)(aug + hdr.augmentation_string_size);
+    std::vector<i64> cu_map;
+
+    for (i64 i = 0; i < hdr.comp_unit_count; i++) {
+      u64 offset = read_section_offset<E, U32<E>>(isec, rels, (u8 *)(cu_list + i));
+      auto it = std::lower_bound(in.units.begin(), in.units.end(), offset,
+                                 [](auto &unit, u64 offset) {
+        return unit.offset < offset;
+      });
+
+      if (it == in.units.end() || it->offset != offset)
+        Fatal(ctx) << isec << ": --debug-names: corrupted compunit offset";
+      cu_map.push_back(it - in.units.begin());
+    }
+
+    U32<E> *hashes = cu_list + hdr.comp_unit_count + hdr.local_type_unit_count +
+                     hdr.foreign_type_unit_count * 2 + hdr.bucket_count;
+    U32<E> *str_offsets = hashes + (hdr.bucket_count ? (u32)hdr.name_count : 0);
+    U32<E> *entry_offsets = str_offsets + hdr.name_count;
+
+    // Read an abbreviation table.
+    u8 *abbrev = (u8 *)(entry_offsets + hdr.name_count);
+    u8 *entry_pool = abbrev + hdr.abbrev_table_size;
+    std::unordered_map<u64, Abbrev> abbrevs;
+
+    for (;;) {
+      u64 code = read_uleb(&abbrev);
+      if (code == 0)
+        break;
+
+      Abbrev &ab = abbrevs[code];
+      ab.tag = read_uleb(&abbrev);
+      for (;;) {
+        u64 idx = read_uleb(&abbrev);
+        u64 form = read_uleb(&abbrev);
+        if (idx == 0 && form == 0)
+          break;
+        ab.attrs.push_back({idx, form});
+      }
+    }
+
+    // Read names and their entries.
+    for (i64 i = 0; i < hdr.name_count; i++) {
+      const ElfRel<E> *rel = find_rel(rels, (u8 *)(str_offsets + i) - begin);
+      if (!rel)
+        continue;
+
+      const ElfSym<E> &esym = file.elf_syms[rel->r_sym];
+      MergeableSection<E> *m = file.mergeable_sections[file.get_shndx(esym)].get();
+      if (!m || &m->parent != debug_str)
+        continue;
+
+      i64 offset = esym.st_value + get_addend(isec, *rel);
+      std::string_view name = m->get_string(offset);
+
+      SectionFragment<E> *frag;
+      i64 frag_offset;
+      std::tie(frag, frag_offset) = m->get_fragment(offset);
+
+      u8 *q = entry_pool + entry_offsets[i];
+
+      for (;;) {
+        u64 code = read_uleb(&q);
+        if (code == 0)
+          break;
+
+        auto it = abbrevs.find(code);
+        if (it == abbrevs.end())
+          Fatal(ctx) << isec << ": --debug-names: unknown abbrev code: "
+                     << code;
+
+        i64 cu_idx = (hdr.comp_unit_count == 1) ? 0 : -1;
+        i64 die_offset = -1;
+        bool is_type_unit = false;
+        u32 linkage = 0;
+
+        for (std::pair<u64, u64> attr : it->second.attrs) {
+          u64 val = read_scalar<E, U32<E>>(ctx, &q, attr.second);
+
+          switch (attr.first) {
+          case DW_IDX_compile_unit:
+            cu_idx = val;
+            break;
+          case DW_IDX_type_unit:
+            is_type_unit = true;
+            break;
+          case DW_IDX_die_offset:
+            die_offset = val;
+            break;
+          case DW_IDX_GNU_internal:
+            linkage = 1;
+            break;
+          }
+        }
+
+        if (is_type_unit || cu_idx < 0 || cu_map.size() <= cu_idx ||
+            die_offset < 0)
+          continue;
+
+        typename DebugNamesSection<E>::Entry ent = {
+          (u32)cu_map[cu_idx], (u32)die_offset, (u32)it->second.tag, linkage,
+        };
+        in.names.push_back({name, hash_string(name), frag, frag_offset, ent});
+      }
+    }
+
+    p = next;
+  }
+}
+
+template <typename E>
+void DebugNamesSection<E>::construct(Context<E> &ctx) {
+  Timer t(ctx, "construct_debug_names");
+
+  ElfShdr<E> shdr = {};
+  shdr.sh_type = SHT_PROGBITS;
+  shdr.sh_flags = SHF_MERGE | SHF_STRINGS;
+  shdr.sh_entsize = 1;
+  MergedSection<E> *debug_str =
+    MergedSection<E>::get_instance(ctx, ".debug_str", shdr);
+
+  std::vector<DebugNamesInput<E>> inputs(ctx.objs.size());
+
+  // Read compunits and names in .debug_gnu_pubnames and .debug_gnu_pubtypes.
+  // We need to add such names to .debug_str, so estimate the number of
+  // new strings before resolving .debug_str.
+  HyperLogLog estimator;
+
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> &file = *ctx.objs[i];
+    if (!file.debug_info || !file.debug_info->is_alive)
+      return;
+
+    file.debug_info->uncompress(ctx);
+    read_units(ctx, inputs[i], *file.debug_info);
+
+    if (!file.debug_names) {
+      read_pubnames(ctx, inputs[i], file);
+
+      HyperLogLog e;
+      for (NameRecord<E> &rec : inputs[i].names)
+        e.insert(rec.hash);
+      estimator.merge(e);
+    }
+  });
+
+  if (!debug_str->resolved) {
+    debug_str->estimator.merge(estimator);
+    debug_str->resolve(ctx);
+  }
+
+  // Add pubnames strings to .debug_str and read input .debug_names.
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> &file = *ctx.objs[i];
+    DebugNamesInput<E> &in = inputs[i];
+
+    for (NameRecord<E> &rec : in.names) {
+      std::string_view data(rec.name.data(), rec.name.size() + 1);
+      rec.frag = debug_str->insert(ctx, data, rec.hash, 0);
+      rec.hash = hash_string(rec.name);
+    }
+
+    if (file.debug_names && !in.units.empty())
+      read_debug_names(ctx, in, file, debug_str);
+
+    // GCC emits the same names for each comdat group, so uniquify them.
+    sort(in.names, [](const NameRecord<E> &a, const NameRecord<E> &b) {
+      return std::tuple(a.name, a.ent.cu_idx, a.ent.die_offset, a.ent.tag,
+                        a.ent.linkage) <
+             std::tuple(b.name, b.ent.cu_idx, b.ent.die_offset, b.ent.tag,
+                        b.ent.linkage);
+    });
+
+    auto equal = [](const NameRecord<E> &a, const NameRecord<E> &b) {
+      return std::tuple(a.name, a.ent.cu_idx, a.ent.die_offset, a.ent.tag,
+                        a.ent.linkage) ==
+             std::tuple(b.name, b.ent.cu_idx, b.ent.die_offset, b.ent.tag,
+                        b.ent.linkage);
+    };
+    in.names.erase(std::unique(in.names.begin(), in.names.end(), equal),
+                   in.names.end());
+  });
+
+  // Create a compunit list and convert per-file compunit indices to
+  // indices in the list.
+  for (i64 i = 0; i < ctx.objs.size(); i++) {
+    i64 base = cus.size();
+    for (typename DebugNamesInput<E>::Unit &unit : inputs[i].units)
+      cus.push_back({ctx.objs[i], unit.offset});
+    for (NameRecord<E> &rec : inputs[i].names)
+      rec.ent.cu_idx += base;
+  }
+
+  if (cus.size() <= 0x100)
+    cu_idx_size = 1;
+  else if (cus.size() <= 0x10000)
+    cu_idx_size = 2;
+  else
+    cu_idx_size = 4;
+
+  // Uniquify names
+  HyperLogLog estimator2;
+
+  tbb::parallel_for_each(inputs, [&](DebugNamesInput<E> &in) {
+    HyperLogLog e;
+    for (NameRecord<E> &rec : in.names)
+      e.insert(rec.hash);
+    estimator2.merge(e);
+  });
+
+  ConcurrentMap<DebugNamesValue<E>> map(estimator2.get_cardinality() * 3 / 2);
+
+  tbb::parallel_for_each(inputs, [&](DebugNamesInput<E> &in) {
+    for (NameRecord<E> &rec : in.names) {
+      DebugNamesValue<E> *ent;
+      bool inserted;
+      std::tie(ent, inserted) =
+        map.insert(rec.name, rec.hash, {rec.frag, rec.frag_offset});
+
+      if (inserted)
+        ent->hash = djb_hash(rec.name);
+      ent->count++;
+      rec.value = ent;
+    }
+  });
+
+  // Sort names for build reproducibility and then by hash buckets.
+  using MapEntry = typename decltype(map)::Entry;
+  std::vector<MapEntry *> map_entries = map.get_sorted_entries_all();
+
+  // This is the same heuristic as LLVM's.
+  i64 num_names = map_entries.size();
+  if (num_names > 1024)
+    bucket_count = num_names / 4;
+  else if (num_names > 16)
+    bucket_count = num_names / 2;
+  else
+    bucket_count = std::max<i64>(num_names, 1);
+
+  std::stable_sort(map_entries.begin(), map_entries.end(),
+                   [&](MapEntry *a, MapEntry *b) {
+    return a->value.hash % bucket_count < b->value.hash % bucket_count;
+  });
+
+  names.resize(num_names);
+
+  i64 num_entries = 0;
+  for (i64 i = 0; i < num_names; i++) {
+    DebugNamesValue<E> &val = map_entries[i]->value;
+    val.idx = i;
+    names[i].frag = val.frag;
+    names[i].frag_offset = val.frag_offset;
+    names[i].hash = val.hash;
+    names[i].entries_begin = num_entries;
+    num_entries += val.count;
+    names[i].entries_end = num_entries;
+  }
+
+  // Fill entries. Entries of each name are sorted for reproducibility.
+  entries.resize(num_entries);
+
+  tbb::parallel_for_each(inputs, [&](DebugNamesInput<E> &in) {
+    for (NameRecord<E> &rec : in.names)
+      entries[names[rec.value->idx].entries_begin + rec.value->cursor++] = rec.ent;
+  });
+
+  tbb::parallel_for_each(names, [&](Name &name) {
+    std::sort(entries.begin() + name.entries_begin,
+              entries.begin() + name.entries_end,
+              [](const Entry &a, const Entry &b) {
+      return std::tuple(a.cu_idx, a.die_offset, a.tag, a.linkage) <
+             std::tuple(b.cu_idx, b.die_offset, b.tag, b.linkage);
+    });
+  });
+
+  // Create an abbreviation for each (tag, linkage) pair.
+  for (DebugNamesInput<E> &in : inputs)
+    for (NameRecord<E> &rec : in.names)
+      abbrevs.push_back({rec.ent.tag, rec.ent.linkage});
+  sort(abbrevs);
+  remove_duplicates(abbrevs);
+
+  u64 cu_form = (cu_idx_size == 1) ? DW_FORM_data1 :
+                (cu_idx_size == 2) ? DW_FORM_data2 : DW_FORM_data4;
+
+  for (i64 i = 0; i < abbrevs.size(); i++) {
+    encode_uleb(abbrev_table, i + 1);
+    encode_uleb(abbrev_table, abbrevs[i].first);
+    encode_uleb(abbrev_table, DW_IDX_compile_unit);
+    encode_uleb(abbrev_table, cu_form);
+    encode_uleb(abbrev_table, DW_IDX_die_offset);
+    encode_uleb(abbrev_table, DW_FORM_ref4);
+    if (abbrevs[i].second) {
+      encode_uleb(abbrev_table, DW_IDX_GNU_internal);
+      encode_uleb(abbrev_table, DW_FORM_flag_present);
+    }
+    abbrev_table.push_back(0);
+    abbrev_table.push_back(0);
+  }
+  abbrev_table.push_back(0);
+
+  // Compute the entry pool layout.
+  tbb::parallel_for_each(names, [&](Name &name) {
+    i64 size = 1;
+    for (i64 i = name.entries_begin; i < name.entries_end; i++)
+      size += uleb_size(get_abbrev_code(entries[i])) + cu_idx_size + 4;
+    name.entry_offset = size;
+  });
+
+  for (Name &name : names) {
+    i64 size = name.entry_offset;
+    name.entry_offset = entry_pool_size;
+    entry_pool_size += size;
+  }
+
+  // Debuggers use an augmentation string to identify the producer of
+  // an index. We keep input strings if they are all the same. The one
+  // for pubnames is the same as gdb's.
+  std::vector<std::string_view> augs;
+  for (DebugNamesInput<E> &in : inputs) {
+    append(augs, in.augmentations);
+    if (in.has_pubnames)
+      augs.push_back("GDB2");
+  }
+
+  sort(augs);
+  remove_duplicates(augs);
+  if (augs.size() == 1)
+    augmentation = augs[0];
+
+  this->shdr.sh_size = sizeof(DebugNamesHdr<E>) +
+                       align_to(augmentation.size(), 4) + cus.size() * 4 +
+                       bucket_count * 4 + names.size() * 12 +
+                       abbrev_table.size() + entry_pool_size;
+}
+
+template <typename E>
+u64 DebugNamesSection<E>::get_abbrev_code(const Entry &ent) {
+  auto it = std::lower_bound(abbrevs.begin(), abbrevs.end(),
+                             std::pair(ent.tag, ent.linkage));
+  return it - abbrevs.begin() + 1;
+}
+
+template <typename E>
+void DebugNamesSection<E>::copy_buf(Context<E> &ctx) {
+  write_to(ctx, ctx.buf + this->shdr.sh_offset, nullptr);
+}
+
+template <typename E>
+void DebugNamesSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
+  i64 aug_size = align_to(augmentation.size(), 4);
+
+  DebugNamesHdr<E> &hdr = *(DebugNamesHdr<E> *)buf;
+  hdr.unit_length = this->shdr.sh_size - 4;
+  hdr.version = 5;
+  hdr.padding = 0;
+  hdr.comp_unit_count = cus.size();
+  hdr.local_type_unit_count = 0;
+  hdr.foreign_type_unit_count = 0;
+  hdr.bucket_count = bucket_count;
+  hdr.name_count = names.size();
+  hdr.abbrev_table_size = abbrev_table.size();
+  hdr.augmentation_string_size = aug_size;
+
+  u8 *aug = buf + sizeof(hdr);
+  memset(aug, 0, aug_size);
+  memcpy(aug, augmentation.data(), augmentation.size());
+
+  // Write a compunit list
+  U32<E> *cu_list = (U32<E> *)(aug + aug_size);
+  for (i64 i = 0; i < cus.size(); i++) {
+    u64 offset = cus[i].first->debug_info->offset + cus[i].second;
+    if (offset > UINT32_MAX)
+      Fatal(ctx) << "--debug-names: .debug_info too large";
+    cu_list[i] = offset;
+  }
+
+  // Write a hash table
+  U32<E> *buckets = cu_list + cus.size();
+  U32<E> *hashes = buckets + bucket_count;
+  U32<E> *str_offsets = hashes + names.size();
+  U32<E> *entry_offsets = str_offsets + names.size();
+
+  memset(buckets, 0, bucket_count * 4);
+
+  for (i64 i = names.size() - 1; i >= 0; i--)
+    buckets[names[i].hash % bucket_count] = i + 1;
+
+  tbb::parallel_for((i64)0, (i64)names.size(), [&](i64 i) {
+    hashes[i] = names[i].hash;
+    str_offsets[i] = names[i].frag->offset + names[i].frag_offset;
+    entry_offsets[i] = names[i].entry_offset;
+  });
+
+  // Write an abbreviation table
+  u8 *abbrev = (u8 *)(entry_offsets + names.size());
+  write_vector(abbrev, abbrev_table);
+
+  // Write an entry pool
+  u8 *entry_pool = abbrev + abbrev_table.size();
+
+  tbb::parallel_for_each(names, [&](Name &name) {
+    u8 *p = entry_pool + name.entry_offset;
+
+    for (i64 i = name.entries_begin; i < name.entries_end; i++) {
+      Entry &ent = entries[i];
+      p += write_uleb(p, get_abbrev_code(ent));
+
+      if (cu_idx_size == 1)
+        *p = ent.cu_idx;
+      else if (cu_idx_size == 2)
+        *(U16<E> *)p = ent.cu_idx;
+      else
+        *(U32<E> *)p = ent.cu_idx;
+      p += cu_idx_size;
+
+      *(U32<E> *)p = ent.die_offset;
+      p += 4;
+    }
+    *p = 0;
+  });
+}
+
 using E = MOLD_TARGET;
 
+template void create_gdb_index_early(Context<E> &);
+template void start_gdb_index(Context<E> &);
 template void write_gdb_index(Context<E> &);
+template std::span<u8> get_buffer(Context<E> &, Chunk<E> *);
+template u64 read_scalar<E, U32<E>>(Context<E> &, u8 **, u64);
+template class DebugNamesSection<E>;
 
 } // namespace mold
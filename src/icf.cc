@@ -50,7 +50,7 @@
 // put the function they call into the hash by appending the hash of those
 // functions from the previous iteration. This means that the nth iteration
 // hashes call chain up to (n-1) levels deep.
-// We use a cryptographic hash function, so the unique number of hashes will
+// We use a 128-bit hash function, so the unique number of hashes will
 // only monotonically increase as we take into account of deeper trees with
 // iterations (otherwise, that means we have found a hash collision). We stop
 // when the unique number of hashes stop increasing; this is based on the fact
@@ -65,7 +65,6 @@
 // conditions.
 
 #include "mold.h"
-#include "../lib/siphash.h"
 
 #include <array>
 #include <cstdio>
@@ -93,7 +92,80 @@ template <> struct hash<Digest> {
 
 namespace mold {
 
-static u8 hmac_key[16];
+// A hash function for section digests. We don't need a cryptographic
+// hash such as SipHash here because the seed is random and we
+// double-check the resulting equivalence classes in icf_sections().
+// XXH3 is several times faster than SipHash and uses SIMD instructions
+// if available.
+class DigestHasher {
+public:
+  DigestHasher(u64 seed) {
+    XXH3_INITSTATE(&state);
+    XXH3_128bits_reset_withSeed(&state, seed);
+  }
+
+  void update(void *data, i64 size) {
+    XXH3_128bits_update(&state, data, size);
+  }
+
+  void finish(u8 *out) {
+    XXH128_hash_t hash = XXH3_128bits_digest(&state);
+    memcpy(out, &hash.low64, 8);
+    memcpy(out + 8, &hash.high64, 8);
+  }
+
+private:
+  XXH3_state_t state;
+};
+
+static u64 hash_seed;
+
+// ICF-specific state of an input section. We keep it in a side table
+// instead of in InputSection, so that InputSection, which is created
+// for every input section, doesn't pay for it if --icf is not given.
+struct IcfInfo {
+  i32 idx = -1;
+  bool eligible = false;
+  bool leaf = false;
+  Atomic<bool> address_taken = false;
+};
+
+// IcfInfo is indexed by file priority and section index, as is the
+// liveness bitmap in gc-sections.cc.
+template <typename E>
+class IcfTable {
+public:
+  IcfTable(Context<E> &ctx) {
+    min_priority = ctx.objs[0]->priority;
+    i64 max_priority = min_priority;
+    for (ObjectFile<E> *file : ctx.objs) {
+      min_priority = std::min(min_priority, file->priority);
+      max_priority = std::max(max_priority, file->priority);
+    }
+
+    vec.resize(max_priority - min_priority + 1);
+    tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+      vec[file->priority - min_priority].reset(
+        new IcfInfo[file->sections.size()]);
+    });
+  }
+
+  IcfInfo &get(InputSection<E> &isec) {
+    return vec[isec.file.priority - min_priority][isec.shndx];
+  }
+
+private:
+  std::vector<std::unique_ptr<IcfInfo[]>> vec;
+  i64 min_priority = 0;
+};
+
+template <typename E>
+static std::unique_ptr<IcfTable<E>> icf_table;
+
+template <typename E>
+static IcfInfo &get_info(InputSection<E> &isec) {
+  return icf_table<E>->get(isec);
+}
 
 template <typename E>
 static void uniquify_cies(Context<E> &ctx) {
@@ -119,6 +191,138 @@ static void uniquify_cies(Context<E> &ctx) {
   }
 }
 
+// With --icf=safe-thunks, an address-significant section that is
+// identical to another section is replaced with a jump instruction to
+// that section instead of being removed, so that the function keeps its
+// own unique address. This function returns the size of the thunk,
+// which is `jmp rel32` optionally preceded by `endbr64`.
+template <typename E>
+static i64 get_thunk_size(InputSection<E> &isec) {
+  return isec.contents.starts_with("\xf3\x0f\x1e\xfa") ? 9 : 5;
+}
+
+// Compute the "address-taken" bit for each input section.
+//
+// As a space-saving optimization, we want to merge two read-only objects
+// into a single object if their contents are equivalent. That
+// optimization is called the Identical Code Folding or ICF.
+//
+// A catch is that comparing object contents is not enough to determine if
+// two objects can be merged safely; we need to take care of pointer
+// equivalence.
+//
+// In C/C++, two pointers are equivalent if and only if they are taken for
+// the same object. Merging two objects into a single object can break
+// this assumption because two distinctive pointers would become
+// equivalent as a result of merging. We can still merge one object with
+// another if no pointer to the object was taken in code, because without
+// a pointer, comparing its address becomes moot.
+//
+// In mold, each input section has an "address-taken" bit in IcfInfo. If
+// there is a pointer-taking reference to the object, it's set to true. At
+// the ICF stage, we merge only objects whose addresses were not taken.
+//
+// For functions, address-taking relocations are separated from
+// non-address-taking ones. For example, x86-64 uses R_X86_64_PLT32 for
+// direct function calls (e.g., "call foo" to call the function foo) while
+// R_X86_64_PC32 or R_X86_64_GOT32 are used for pointer-taking operations.
+//
+// Unfortunately, for data, we can't distinguish between address-taking
+// relocations and non-address-taking ones. LLVM generates an "address
+// significance" table in the ".llvm_addrsig" section to mark symbols
+// whose addresses are taken in code. If that table is available, we use
+// that information in this function. Otherwise, we conservatively assume
+// that all data items are address-taken, except C++ vtables. The Itanium
+// C++ ABI doesn't give programs a way to take the address of a vtable, so
+// identical vtables (which are common in template-heavy code) can always
+// be merged.
+template <typename E>
+static std::vector<bool> get_vtable_only_sections(ObjectFile<E> &file) {
+  // 0: no symbol, 1: vtables only, 2: has other symbols
+  std::vector<u8> state(file.sections.size());
+
+  for (i64 i = 1; i < file.elf_syms.size(); i++) {
+    const ElfSym<E> &esym = file.elf_syms[i];
+    if (esym.is_undef() || esym.is_abs() || esym.is_common() ||
+        esym.st_type == STT_SECTION || esym.st_type == STT_FILE)
+      continue;
+
+    i64 shndx = file.get_shndx(esym);
+    if (shndx >= state.size())
+      continue;
+
+    // We don't use file.symbols[i] because unused local symbols may
+    // not have been created. See get_used_local_syms().
+    std::string_view name = file.symbol_strtab.data() + esym.st_name;
+    if (name.starts_with("_ZTV")) {
+      if (state[shndx] == 0)
+        state[shndx] = 1;
+    } else {
+      state[shndx] = 2;
+    }
+  }
+
+  std::vector<bool> vec(state.size());
+  for (i64 i = 0; i < state.size(); i++)
+    vec[i] = (state[i] == 1);
+  return vec;
+}
+
+template <typename E>
+static void compute_address_significance(Context<E> &ctx) {
+  Timer t(ctx, "compute_address_significance");
+
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    // If .llvm_addrsig is available, use it.
+    if (InputSection<E> *sec = file->llvm_addrsig.get()) {
+      u8 *p = (u8 *)sec->contents.data();
+      u8 *end = p + sec->contents.size();
+      while (p != end) {
+        Symbol<E> *sym = file->symbols[read_uleb(&p)];
+        if (InputSection<E> *isec = sym->get_input_section())
+          get_info(*isec).address_taken = true;
+      }
+      return;
+    }
+
+    // Otherwise, infer address significance.
+    std::vector<bool> is_vtable = get_vtable_only_sections(*file);
+
+    for (i64 i = 0; i < file->sections.size(); i++) {
+      std::unique_ptr<InputSection<E>> &isec = file->sections[i];
+      if (!isec || !isec->is_alive || !(isec->shdr().sh_flags & SHF_ALLOC))
+        continue;
+
+      if (!(isec->shdr().sh_flags & SHF_EXECINSTR) && !is_vtable[i])
+        get_info(*isec).address_taken = true;
+
+      isec->for_each_ref(ctx, [&](SectionRef<E> ref) {
+        if (!ref.is_func_call())
+          if (InputSection<E> *dst = ref.get_input_section())
+            if (dst->shdr().sh_flags & SHF_EXECINSTR)
+              get_info(*dst).address_taken = true;
+      });
+    }
+  });
+
+  auto mark = [](Symbol<E> *sym) {
+    if (sym)
+      if (InputSection<E> *isec = sym->get_input_section())
+        get_info(*isec).address_taken = true;
+  };
+
+  // Some symbols' pointer values are leaked to the dynamic section.
+  mark(ctx.arg.entry);
+  mark(ctx.arg.init);
+  mark(ctx.arg.fini);
+
+  // Exported symbols are conservatively considered address-taken.
+  if (ctx.dynsym)
+    for (Symbol<E> *sym : ctx.dynsym->symbols)
+      if (sym && sym->is_exported)
+        mark(sym);
+}
+
 template <typename E>
 static bool is_eligible(Context<E> &ctx, InputSection<E> &isec) {
   const ElfShdr<E> &shdr = isec.shdr();
@@ -128,13 +332,21 @@ static bool is_eligible(Context<E> &ctx, InputSection<E> &isec) {
       shdr.sh_type == SHT_NOBITS || is_c_identifier(name))
     return false;
 
-  if (shdr.sh_flags & SHF_EXECINSTR)
-    return (ctx.arg.icf_all || !isec.address_taken) &&
-           name != ".init" && name != ".fini";
+  if (shdr.sh_flags & SHF_EXECINSTR) {
+    if (name == ".init" || name == ".fini")
+      return false;
+    if (ctx.arg.icf_all || !get_info(isec).address_taken)
+      return true;
+
+    // With --icf=safe-thunks, an address-taken function can still be
+    // folded if it is large enough to be replaced with a thunk.
+    return ctx.arg.icf_safe_thunks && isec.sh_size > get_thunk_size(isec);
+  }
 
   bool is_readonly = !(shdr.sh_flags & SHF_WRITE);
   bool is_relro = isec.name().starts_with(".data.rel.ro");
-  return (ctx.arg.ignore_data_address_equality || !isec.address_taken) &&
+  return (ctx.arg.ignore_data_address_equality ||
+          !get_info(isec).address_taken) &&
          (is_readonly || is_relro);
 }
 
@@ -207,20 +419,20 @@ static void merge_leaf_nodes(Context<E> &ctx) {
 
       if (is_leaf(ctx, *isec)) {
         leaf++;
-        isec->icf_leaf = true;
+        get_info(*isec).leaf = true;
         auto [it, inserted] = map.insert({isec.get(), isec.get()});
         if (!inserted && isec->get_priority() < it->second->get_priority())
           it->second = isec.get();
       } else {
         eligible++;
-        isec->icf_eligible = true;
+        get_info(*isec).eligible = true;
       }
     }
   });
 
   tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
     for (std::unique_ptr<InputSection<E>> &isec : ctx.objs[i]->sections) {
-      if (isec && isec->is_alive && isec->icf_leaf) {
+      if (isec && isec->is_alive && get_info(*isec).leaf) {
         auto it = map.find(isec.get());
         assert(it != map.end());
         isec->leader = it->second;
@@ -231,7 +443,7 @@ static void merge_leaf_nodes(Context<E> &ctx) {
 
 template <typename E>
 static Digest compute_digest(Context<E> &ctx, InputSection<E> &isec) {
-  SipHash13_128 hasher(hmac_key);
+  DigestHasher hasher(hash_seed);
 
   auto hash = [&](auto val) {
     hasher.update((u8 *)&val, sizeof(val));
@@ -256,7 +468,7 @@ static Digest compute_digest(Context<E> &ctx, InputSection<E> &isec) {
     } else if (isec->leader) {
       hash('4');
       hash((u64)isec->leader);
-    } else if (isec->icf_eligible) {
+    } else if (get_info(*isec).eligible) {
       hash('5');
     } else {
       hash('6');
@@ -292,7 +504,19 @@ static Digest compute_digest(Context<E> &ctx, InputSection<E> &isec) {
     hash(rel.r_offset);
     hash(rel.r_type);
     hash(get_addend(isec, rel));
-    hash_symbol(*isec.file.symbols[rel.r_sym]);
+
+    // If address-taken functions can be folded (into thunks), taking
+    // the address of two identical functions doesn't yield the same
+    // value, so such references need to be distinguished.
+    Symbol<E> &sym = *isec.file.symbols[rel.r_sym];
+    if (ctx.arg.icf_safe_thunks && !is_func_call_rel(rel)) {
+      InputSection<E> *dst = sym.get_input_section();
+      if (dst && get_info(*dst).address_taken) {
+        hash('7');
+        hash((u64)dst);
+      }
+    }
+    hash_symbol(sym);
   }
 
   Digest digest;
@@ -300,6 +524,26 @@ static Digest compute_digest(Context<E> &ctx, InputSection<E> &isec) {
   return digest;
 }
 
+template <typename E>
+static bool is_same_shape(Context<E> &ctx, InputSection<E> &a,
+                          InputSection<E> &b) {
+  if (a.contents != b.contents ||
+      a.shdr().sh_flags != b.shdr().sh_flags ||
+      a.get_fdes().size() != b.get_fdes().size())
+    return false;
+
+  std::span<const ElfRel<E>> x = a.get_rels(ctx);
+  std::span<const ElfRel<E>> y = b.get_rels(ctx);
+  if (x.size() != y.size())
+    return false;
+
+  for (i64 i = 0; i < x.size(); i++)
+    if (x[i].r_offset != y[i].r_offset || x[i].r_type != y[i].r_type ||
+        get_addend(a, x[i]) != get_addend(b, y[i]))
+      return false;
+  return true;
+}
+
 template <typename E>
 static std::vector<InputSection<E> *> gather_sections(Context<E> &ctx) {
   Timer t(ctx, "gather_sections");
@@ -309,7 +553,7 @@ static std::vector<InputSection<E> *> gather_sections(Context<E> &ctx) {
 
   tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
     for (std::unique_ptr<InputSection<E>> &isec : ctx.objs[i]->sections)
-      if (isec && isec->is_alive && isec->icf_eligible)
+      if (isec && isec->is_alive && get_info(*isec).eligible)
         num_sections[i]++;
   });
 
@@ -324,12 +568,12 @@ static std::vector<InputSection<E> *> gather_sections(Context<E> &ctx) {
   tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
     i64 idx = section_indices[i];
     for (std::unique_ptr<InputSection<E>> &isec : ctx.objs[i]->sections)
-      if (isec && isec->is_alive && isec->icf_eligible)
+      if (isec && isec->is_alive && get_info(*isec).eligible)
         sections[idx++] = isec.get();
   });
 
   tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
-    sections[i]->icf_idx = i;
+    get_info(*sections[i]).idx = i;
   });
 
   return sections;
@@ -365,16 +609,13 @@ static void gather_edges(Context<E> &ctx,
 
   tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
     InputSection<E> &isec = *sections[i];
-    assert(isec.icf_eligible);
-
-    for (i64 j = 0; j < isec.get_rels(ctx).size(); j++) {
-      const ElfRel<E> &rel = isec.get_rels(ctx)[j];
-      Symbol<E> &sym = *isec.file.symbols[rel.r_sym];
-      if (!sym.get_frag())
-        if (InputSection<E> *isec = sym.get_input_section())
-          if (isec->icf_eligible)
-            num_edges[i]++;
-    }
+    assert(get_info(isec).eligible);
+
+    isec.for_each_ref(ctx, [&](SectionRef<E> ref) {
+      if (InputSection<E> *dst = ref.get_input_section())
+        if (get_info(*dst).eligible)
+          num_edges[i]++;
+    });
   });
 
   for (i64 i = 0; i < num_edges.size() - 1; i++)
@@ -386,66 +627,230 @@ static void gather_edges(Context<E> &ctx,
     InputSection<E> &isec = *sections[i];
     i64 idx = edge_indices[i];
 
-    for (ElfRel<E> &rel : isec.get_rels(ctx)) {
-      Symbol<E> &sym = *isec.file.symbols[rel.r_sym];
-      if (InputSection<E> *isec = sym.get_input_section())
-        if (isec->icf_eligible)
-          edges[idx++] = isec->icf_idx;
-  }
+    isec.for_each_ref(ctx, [&](SectionRef<E> ref) {
+      if (InputSection<E> *dst = ref.get_input_section())
+        if (get_info(*dst).eligible)
+          edges[idx++] = get_info(*dst).idx;
+    });
+  });
+}
+
+// Build the reverse graph of the one built by gather_edges(). The
+// predecessors of vertex i are rev_edges[rev_edge_indices[i]..].
+template <typename E>
+static void gather_reverse_edges(Context<E> &ctx, std::span<u32> edges,
+                                 std::span<u32> edge_indices,
+                                 std::vector<u32> &rev_edges,
+                                 std::vector<u32> &rev_edge_indices) {
+  Timer t(ctx, "gather_reverse_edges");
+
+  i64 num_nodes = edge_indices.size();
+  if (num_nodes == 0)
+    return;
+
+  auto get_edges = [&](i64 i) {
+    i64 begin = edge_indices[i];
+    i64 end = (i + 1 == num_nodes) ? edges.size() : edge_indices[i + 1];
+    return edges.subspan(begin, end - begin);
+  };
+
+  std::vector<Atomic<u32>> cursor(num_nodes);
+
+  tbb::parallel_for((i64)0, num_nodes, [&](i64 i) {
+    for (u32 j : get_edges(i))
+      cursor[j]++;
+  });
+
+  rev_edge_indices.resize(num_nodes);
+  for (i64 i = 0; i < num_nodes - 1; i++)
+    rev_edge_indices[i + 1] = rev_edge_indices[i] + cursor[i];
+
+  for (i64 i = 0; i < num_nodes; i++)
+    cursor[i] = rev_edge_indices[i];
+
+  rev_edges.resize(edges.size());
+
+  tbb::parallel_for((i64)0, num_nodes, [&](i64 i) {
+    for (u32 j : get_edges(i))
+      rev_edges[cursor[j]++] = i;
   });
 }
 
+// Computes new tree hashes for vertices in `active`.
+//
+// A tree hash of a vertex changes only if a tree hash of one of its
+// successors changed in the previous round. So, instead of visiting all
+// vertices in each round, we recompute only the vertices whose successors
+// have changed, which we keep in `active`. This makes late rounds, in
+// which most vertices have already converged, much cheaper.
 template <typename E>
 static i64 propagate(std::span<std::vector<Digest>> digests,
                      std::span<u32> edges, std::span<u32> edge_indices,
-                     bool &slot, std::span<u8> converged,
-                     tbb::affinity_partitioner &ap) {
+                     std::span<u32> rev_edges, std::span<u32> rev_edge_indices,
+                     std::vector<u32> &active, bool &slot,
+                     std::span<u8> converged, std::span<Atomic<u8>> dirty) {
   static Counter round("icf_round");
   round++;
 
   i64 num_digests = digests[0].size();
-  tbb::enumerable_thread_specific<i64> changed;
 
-  tbb::parallel_for((i64)0, num_digests, [&](i64 i) {
-    if (converged[i])
-      return;
+  auto get_range = [&](std::span<u32> vec, std::span<u32> indices, i64 i) {
+    i64 begin = indices[i];
+    i64 end = (i + 1 == num_digests) ? vec.size() : indices[i + 1];
+    return vec.subspan(begin, end - begin);
+  };
 
-    SipHash13_128 hasher(hmac_key);
-    hasher.update(digests[2][i].data(), HASH_SIZE);
+  tbb::enumerable_thread_specific<std::vector<u32>> changed_ets;
+  tbb::enumerable_thread_specific<std::vector<Digest>> buf_ets;
 
-    i64 begin = edge_indices[i];
-    i64 end = (i + 1 == num_digests) ? edges.size() : edge_indices[i + 1];
+  tbb::parallel_for((i64)0, (i64)active.size(), [&](i64 k) {
+    u32 i = active[k];
 
-    for (i64 j : edges.subspan(begin, end - begin))
-      hasher.update(digests[slot][j].data(), HASH_SIZE);
+    // Hashing a contiguous buffer at once is faster than feeding
+    // digests one by one to a streaming hasher.
+    std::vector<Digest> &buf = buf_ets.local();
+    buf.clear();
+    buf.push_back(digests[2][i]);
+    for (i64 j : get_range(edges, edge_indices, i))
+      buf.push_back(digests[slot][j]);
 
-    hasher.finish(digests[!slot][i].data());
+    XXH128_hash_t hash =
+      XXH3_128bits_withSeed(buf.data(), buf.size() * HASH_SIZE, hash_seed);
+    memcpy(digests[!slot][i].data(), &hash.low64, 8);
+    memcpy(digests[!slot][i].data() + 8, &hash.high64, 8);
 
     if (digests[slot][i] == digests[!slot][i]) {
       // This node has converged. Skip further iterations as it will
       // yield the same hash.
       converged[i] = true;
     } else {
-      changed.local()++;
+      changed_ets.local().push_back(i);
     }
-  }, ap);
+  });
 
   slot = !slot;
-  return changed.combine(std::plus());
+
+  std::vector<u32> changed;
+  for (std::vector<u32> &vec : changed_ets)
+    append(changed, vec);
+
+  // Vertices to be recomputed in the next round are the predecessors
+  // of the vertices that changed in this round.
+  tbb::enumerable_thread_specific<std::vector<u32>> next_ets;
+
+  tbb::parallel_for((i64)0, (i64)changed.size(), [&](i64 k) {
+    for (u32 i : get_range(rev_edges, rev_edge_indices, changed[k]))
+      if (!converged[i] && !dirty[i].test_and_set())
+        next_ets.local().push_back(i);
+  });
+
+  // A vertex that changed in this round but won't be recomputed in the
+  // next round has converged. Copy its hash to the other slot, as it
+  // would have been by recomputing the same hash.
+  tbb::parallel_for((i64)0, (i64)changed.size(), [&](i64 k) {
+    u32 i = changed[k];
+    if (!dirty[i]) {
+      converged[i] = true;
+      digests[!slot][i] = digests[slot][i];
+    }
+  });
+
+  active.clear();
+  for (std::vector<u32> &vec : next_ets)
+    append(active, vec);
+
+  tbb::parallel_for((i64)0, (i64)active.size(), [&](i64 k) {
+    dirty[active[k]] = 0;
+  });
+
+  return changed.size();
 }
 
+// Counts the number of distinct digests. We do this repeatedly to check
+// for convergence, so instead of sorting a copy of all digests on each
+// call, we insert digest indices into an open-addressing hash table that
+// is allocated only once. Each slot is tagged with a generation number,
+// so that we don't need to clear the table between calls.
+class DigestCounter {
+public:
+  DigestCounter(i64 num_digests) : slots(bit_ceil(num_digests * 2 + 1)) {}
+
+  i64 count(std::span<Digest> digests) {
+    u64 gen = ++cur_gen;
+    u64 mask = slots.size() - 1;
+    tbb::enumerable_thread_specific<i64> num_classes;
+
+    tbb::parallel_for((i64)0, (i64)digests.size(), [&](i64 i) {
+      u64 hash;
+      memcpy(&hash, digests[i].data(), sizeof(hash));
+
+      for (u64 j = hash & mask;; j = (j + 1) & mask) {
+        u64 val = slots[j].load(std::memory_order_acquire);
+
+        if ((val >> 32) != gen &&
+            slots[j].compare_exchange_strong(val, (gen << 32) | i,
+                                             std::memory_order_acq_rel)) {
+          num_classes.local()++;
+          return;
+        }
+
+        // If the CAS failed, `val` has been updated to the value
+        // stored by another thread in this generation.
+        if (digests[(u32)val] == digests[i])
+          return;
+      }
+    }, ap);
+
+    return num_classes.combine(std::plus());
+  }
+
+private:
+  std::vector<std::atomic<u64>> slots;
+  u64 cur_gen = 0;
+  tbb::affinity_partitioner ap;
+};
+
+// Replace address-taken sections that were merged with other sections
+// with thunks. A section that cannot be replaced with a thunk (e.g.
+// because it has a symbol in the middle of it) is kept as is.
 template <typename E>
-static i64 count_num_classes(std::span<Digest> digests,
-                             tbb::affinity_partitioner &ap) {
-  std::vector<Digest> vec(digests.begin(), digests.end());
-  tbb::parallel_sort(vec);
-
-  tbb::enumerable_thread_specific<i64> num_classes;
-  tbb::parallel_for((i64)0, (i64)vec.size() - 1, [&](i64 i) {
-    if (vec[i] != vec[i + 1])
-      num_classes.local()++;
-  }, ap);
-  return num_classes.combine(std::plus());
+static void create_thunks(Context<E> &ctx) {
+  Timer t(ctx, "create_thunks");
+  static Counter num_thunks("icf_thunks");
+
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    std::vector<bool> has_inner_sym(file->sections.size());
+
+    for (i64 i = 1; i < file->elf_syms.size(); i++) {
+      const ElfSym<E> &esym = file->elf_syms[i];
+      if (!esym.is_undef() && !esym.is_abs() && !esym.is_common() &&
+          esym.st_type != STT_SECTION && esym.st_value != 0)
+        if (i64 shndx = file->get_shndx(esym); shndx < has_inner_sym.size())
+          has_inner_sym[shndx] = true;
+    }
+
+    for (i64 i = 0; i < file->sections.size(); i++) {
+      InputSection<E> *isec = file->sections[i].get();
+      if (!isec || !isec->is_alive || !isec->icf_removed() ||
+          !get_info(*isec).address_taken ||
+          !(isec->shdr().sh_flags & SHF_EXECINSTR))
+        continue;
+
+      if (has_inner_sym[i]) {
+        isec->leader = isec;
+        continue;
+      }
+
+      // A thunk is a tail jump, so it never appears as a caller's frame
+      // on the stack, and we don't give it an FDE. Only an asynchronous
+      // unwinder that stops right at the jump would miss one.
+      isec->icf_thunk = true;
+      isec->sh_size = get_thunk_size(*isec);
+      for (FdeRecord<E> &fde : isec->get_fdes())
+        fde.is_alive = false;
+      num_thunks++;
+    }
+  });
 }
 
 template <typename E>
@@ -478,12 +883,16 @@ static void print_icf_sections(Context<E> &ctx) {
 
     Out(ctx) << "selected section " << *leader;
 
-    i64 n = 0;
     for (auto it = begin; it != end; it++) {
-      Out(ctx) << "  removing identical section " << *it->second;
-      n++;
+      InputSection<E> &isec = *it->second;
+      if (isec.icf_thunk) {
+        Out(ctx) << "  replacing identical section " << isec << " with a thunk";
+        saved_bytes += leader->contents.size() - isec.sh_size;
+      } else {
+        Out(ctx) << "  removing identical section " << isec;
+        saved_bytes += leader->contents.size();
+      }
     }
-    saved_bytes += leader->contents.size() * n;
   }
 
   Out(ctx) << "ICF saved " << saved_bytes << " bytes";
@@ -495,8 +904,12 @@ void icf_sections(Context<E> &ctx) {
   if (ctx.objs.empty())
     return;
 
-  get_random_bytes(hmac_key, sizeof(hmac_key));
+  i64 start = now_nsec();
+
+  get_random_bytes((u8 *)&hash_seed, sizeof(hash_seed));
 
+  icf_table<E>.reset(new IcfTable<E>(ctx));
+  compute_address_significance(ctx);
   uniquify_cies(ctx);
   merge_leaf_nodes(ctx);
 
@@ -516,18 +929,51 @@ void icf_sections(Context<E> &ctx) {
   digests[0] = compute_digests<E>(ctx, sections);
   digests[1].resize(digests[0].size());
   digests[2] = digests[0];
+  ctx.icf_digest_bytes = digests[0].size() * sizeof(Digest) * 3;
 
   std::vector<u32> edges;
   std::vector<u32> edge_indices;
   gather_edges<E>(ctx, sections, edges, edge_indices);
 
+  std::vector<u32> rev_edges;
+  std::vector<u32> rev_edge_indices;
+  gather_reverse_edges<E>(ctx, edges, edge_indices, rev_edges,
+                          rev_edge_indices);
+
   std::vector<u8> converged(digests[0].size());
+  std::vector<Atomic<u8>> dirty(digests[0].size());
   bool slot = 0;
 
+  // In the first round, all vertices need to be computed.
+  std::vector<u32> active(digests[0].size());
+  for (i64 i = 0; i < active.size(); i++)
+    active[i] = i;
+
+  auto run_round = [&] {
+    return propagate<E>(digests, edges, edge_indices, rev_edges,
+                        rev_edge_indices, active, slot, converged, dirty);
+  };
+
+  // With --icf-max-rounds or --icf-time-budget, we may give up before
+  // convergence. In that case, we merge only sections whose digests have
+  // converged, as they are proven to be identical to the sections with
+  // the same digests.
+  i64 num_rounds = 0;
+  bool truncated = false;
+
+  auto out_of_budget = [&] {
+    if (ctx.arg.icf_max_rounds != -1 && num_rounds >= ctx.arg.icf_max_rounds)
+      truncated = true;
+    if (ctx.arg.icf_time_budget != -1 &&
+        now_nsec() - start >= ctx.arg.icf_time_budget * 1'000'000)
+      truncated = true;
+    num_rounds++;
+    return truncated;
+  };
+
   // Execute the propagation rounds until convergence is obtained.
   {
     Timer t(ctx, "propagate");
-    tbb::affinity_partitioner ap;
 
     // A cheap test that the graph hasn't converged yet.
     // The loop after this one uses a strict condition, but it's expensive
@@ -541,8 +987,8 @@ void icf_sections(Context<E> &ctx) {
     // Here, we test whether we have reached sufficient depth for the latter,
     // which is a necessary (but not sufficient) condition for convergence.
     i64 num_changed = -1;
-    for (;;) {
-      i64 n = propagate<E>(digests, edges, edge_indices, slot, converged, ap);
+    while (!out_of_budget()) {
+      i64 n = run_round();
       if (n == num_changed)
         break;
       num_changed = n;
@@ -550,14 +996,18 @@ void icf_sections(Context<E> &ctx) {
 
     // Run the pass until the unique number of hashes stop increasing, at which
     // point we have achieved convergence (proof omitted for brevity).
+    DigestCounter counter(digests[0].size());
     i64 num_classes = -1;
-    for (;;) {
-      // count_num_classes requires sorting which is O(n log n), so do a little
-      // more work beforehand to amortize that log factor.
-      for (i64 i = 0; i < 10; i++)
-        propagate<E>(digests, edges, edge_indices, slot, converged, ap);
 
-      i64 n = count_num_classes<E>(digests[slot], ap);
+    while (!truncated) {
+      // Counting classes requires a pass over all digests, so do a little
+      // more work beforehand to amortize that cost.
+      for (i64 i = 0; i < 10 && !out_of_budget(); i++)
+        run_round();
+      if (truncated)
+        break;
+
+      i64 n = counter.count(digests[slot]);
       if (n == num_classes)
         break;
       num_classes = n;
@@ -571,23 +1021,67 @@ void icf_sections(Context<E> &ctx) {
     auto *map = new tbb::concurrent_unordered_map<Digest, InputSection<E> *>;
     std::span<Digest> digest = digests[slot];
 
+    auto is_mergeable = [&](i64 i) { return !truncated || converged[i]; };
+
     tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
+      if (!is_mergeable(i))
+        return;
       InputSection<E> *isec = sections[i];
       auto [it, inserted] = map->insert({digest[i], isec});
       if (!inserted && isec->get_priority() < it->second->get_priority())
         it->second = isec;
     });
 
+    static Counter collisions("icf_digest_collisions");
+
     tbb::parallel_for((i64)0, (i64)sections.size(), [&](i64 i) {
+      if (!is_mergeable(i)) {
+        sections[i]->leader = sections[i];
+        return;
+      }
+
       auto it = map->find(digest[i]);
       assert(it != map->end());
-      sections[i]->leader = it->second;
+
+      // Make sure that the contents and relocations of sections whose
+      // digests are the same are actually identical, so that a hash
+      // collision doesn't merge unrelated sections. Comparing the
+      // sections referenced by relocations would be as expensive as ICF
+      // itself, so we don't do that.
+      InputSection<E> *isec = sections[i];
+      if (it->second == isec || is_same_shape(ctx, *isec, *it->second)) {
+        isec->leader = it->second;
+      } else {
+        isec->leader = isec;
+        collisions++;
+      }
     });
 
     // Since free'ing the map is slow, postpone it.
     ctx.on_exit.push_back([=] { delete map; });
+
+    // If we gave up early, report how many sections could have been
+    // merged. Sections that share a digest at this point are candidates.
+    if (truncated && ctx.arg.stats) {
+      static Counter unconverged("icf_unconverged_sections");
+      static Counter forgone("icf_forgone_folds");
+
+      std::vector<Digest> vec;
+      for (i64 i = 0; i < sections.size(); i++)
+        if (!converged[i])
+          vec.push_back(digest[i]);
+
+      sort(vec);
+      unconverged += vec.size();
+      for (i64 i = 1; i < vec.size(); i++)
+        if (vec[i] == vec[i - 1])
+          forgone++;
+    }
   }
 
+  if (ctx.arg.icf_safe_thunks)
+    create_thunks(ctx);
+
   if (ctx.arg.print_icf_sections)
     print_icf_sections(ctx);
 
@@ -599,13 +1093,16 @@ void icf_sections(Context<E> &ctx) {
     static Counter eliminated("icf_eliminated");
     tbb::parallel_for_each(ctx.objs, [](ObjectFile<E> *file) {
       for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
-        if (isec && isec->is_alive && isec->icf_removed()) {
+        if (isec && isec->is_alive && isec->icf_removed() && !isec->icf_thunk) {
           isec->kill();
+          file->num_icf_removed++;
           eliminated++;
         }
       }
     });
   }
+
+  icf_table<E>.reset();
 }
 
 using E = MOLD_TARGET;
@@ -2,6 +2,7 @@
 
 #include <bit>
 #include <cstring>
+#include <tbb/parallel_for_each.h>
 #include <tbb/parallel_sort.h>
 
 #ifndef _WIN32
@@ -16,9 +17,8 @@ namespace mold {
 template <typename E>
 Symbol<E> *get_symbol(Context<E> &ctx, std::string_view key,
                       std::string_view name) {
-  typename decltype(ctx.symbol_map)::const_accessor acc;
-  ctx.symbol_map.insert(acc, {key, Symbol<E>(name, ctx.arg.demangle)});
-  return const_cast<Symbol<E> *>(&acc->second);
+  return ctx.symbol_map.insert(key, hash_string(key),
+                               Symbol<E>(name, ctx.arg.demangle)).first;
 }
 
 template <typename E>
@@ -111,8 +111,8 @@ ElfShdr<E> *InputFile<E>::find_section(i64 type) {
 template <typename E>
 std::string_view InputFile<E>::get_source_name() const {
   for (i64 i = 0; i < first_global; i++)
-    if (Symbol<E> *sym = symbols[i]; sym->get_type() == STT_FILE)
-      return sym->name();
+    if (elf_syms[i].st_type == STT_FILE)
+      return symbols[i]->name();
   return "";
 }
 
@@ -245,17 +245,48 @@ static bool is_known_section_type(const ElfShdr<E> &shdr) {
 
 template <typename E>
 void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
+  bool strip_debug = ctx.arg.strip_all || ctx.arg.strip_debug;
+
+  // Returns true if a given section is a debug section or a relocation
+  // section for a debug section.
+  auto is_debug = [&](const ElfShdr<E> &shdr) {
+    if (shdr.sh_type != (E::is_rela ? SHT_RELA : SHT_REL))
+      return is_debug_section(shdr, this->shstrtab.data() + shdr.sh_name);
+    if (shdr.sh_info >= this->elf_sections.size())
+      return false;
+    const ElfShdr<E> &target = this->elf_sections[shdr.sh_info];
+    return is_debug_section(target, this->shstrtab.data() + target.sh_name);
+  };
+
   // Read sections
   for (i64 i = 0; i < this->elf_sections.size(); i++) {
     const ElfShdr<E> &shdr = this->elf_sections[i];
     std::string_view name = this->shstrtab.data() + shdr.sh_name;
 
+    // If --strip-all or --strip-debug is given, we don't even look at
+    // debug sections and their relocation sections. They tend to be the
+    // bulk of an object file, so we also give their pages back to the
+    // kernel as we are never going to read them.
+    if (strip_debug && is_debug(shdr)) {
+      if (shdr.sh_type != SHT_NOBITS)
+        this->mf->release(shdr.sh_offset, shdr.sh_size);
+      continue;
+    }
+
     if ((shdr.sh_flags & SHF_EXCLUDE) &&
         name.starts_with(".gnu.offload_lto_.symtab.")) {
       this->is_gcc_offload_obj = true;
       continue;
     }
 
+    // Save .llvm.call-graph-profile for --call-graph-profile-sort. It
+    // refers to symbols, so we read it after name resolution.
+    if (shdr.sh_type == SHT_LLVM_CALL_GRAPH_PROFILE && !ctx.arg.relocatable) {
+      if (ctx.arg.call_graph_profile_sort)
+        llvm_cg_profile_idx = i;
+      continue;
+    }
+
     if ((shdr.sh_flags & SHF_EXCLUDE) && !(shdr.sh_flags & SHF_ALLOC) &&
         shdr.sh_type != SHT_LLVM_ADDRSIG && !ctx.arg.relocatable)
       continue;
@@ -301,9 +332,9 @@ void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
       if (entries[0] != GRP_COMDAT)
         Fatal(ctx) << *this << ": unsupported SHT_GROUP format";
 
-      typename decltype(ctx.comdat_groups)::const_accessor acc;
-      ctx.comdat_groups.insert(acc, {signature, ComdatGroup()});
-      ComdatGroup *group = const_cast<ComdatGroup *>(&acc->second);
+      ComdatGroup *group =
+        ctx.comdat_groups.insert(signature, hash_string(signature),
+                                 ComdatGroup()).first;
       comdat_groups.push_back({group, (i32)i, entries.subspan(1)});
       break;
     }
@@ -355,11 +386,6 @@ void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
       if (name == ".gnu.linkonce.d.DW.ref.__gxx_personality_v0")
         continue;
 
-      // Ignore debug sections if --strip-all or --strip-debug is given.
-      if ((ctx.arg.strip_all || ctx.arg.strip_debug) &&
-          is_debug_section(shdr, name))
-        continue;
-
       if (name == ".comment" &&
           this->get_string(ctx, shdr).starts_with("rustc "))
         this->is_rust_obj = true;
@@ -395,20 +421,36 @@ void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
       if (name == ".eh_frame")
         eh_frame_sections.push_back(this->sections[i].get());
 
+      // .sframe sections are merged into a single synthetic section
+      // instead of being copied as opaque bytes.
+      if (name == ".sframe" && !ctx.arg.relocatable) {
+        sframe_sections.push_back(this->sections[i].get());
+        this->sections[i]->is_alive = false;
+      }
+
       if constexpr (is_ppc32<E>)
         if (name == ".got2")
           extra.got2 = this->sections[i].get();
 
-      // Save debug sections for --gdb-index.
-      if (ctx.arg.gdb_index) {
+      if constexpr (is_ppc64v2<E>) {
+        if (name == ".toc") {
+          extra.toc = this->sections[i].get();
+          extra.toc_no_relax.resize(shdr.sh_size / 8);
+        }
+      }
+
+      // Save debug sections for --gdb-index and --debug-names.
+      if (ctx.arg.gdb_index || ctx.arg.debug_names) {
         InputSection<E> *isec = this->sections[i].get();
 
         if (name == ".debug_info")
           debug_info = isec;
+        if (name == ".debug_abbrev")
+          debug_abbrev = isec;
 
-        // If --gdb-index is given, contents of .debug_gnu_pubnames and
-        // .debug_gnu_pubtypes are copied to .gdb_index, so keeping them
-        // in an output file is just a waste of space.
+        // Contents of .debug_gnu_pubnames and .debug_gnu_pubtypes are
+        // copied to .gdb_index or .debug_names, so keeping them in an
+        // output file is just a waste of space.
         if (name == ".debug_gnu_pubnames") {
           debug_pubnames = isec;
           isec->is_alive = false;
@@ -419,12 +461,18 @@ void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
           isec->is_alive = false;
         }
 
+        // Input .debug_names are merged into a single index.
+        if (ctx.arg.debug_names && name == ".debug_names") {
+          debug_names = isec;
+          isec->is_alive = false;
+        }
+
         // .debug_types is similar to .debug_info but contains type info
         // only. It exists only in DWARF 4, has been removed in DWARF 5 and
         // neither GCC nor Clang generate it by default
         // (-fdebug-types-section is needed). As such there is probably
         // little need to support it.
-        if (name == ".debug_types")
+        if (ctx.arg.gdb_index && name == ".debug_types")
           Fatal(ctx) << *this << ": mold's --gdb-index is not compatible"
             " with .debug_types; to fix this error, remove"
             " -fdebug-types-section and recompile";
@@ -484,8 +532,11 @@ void ObjectFile<E>::initialize_sections(Context<E> &ctx) {
 // This function parses an input .eh_frame section.
 template <typename E>
 void ObjectFile<E>::parse_ehframe(Context<E> &ctx) {
+  // The input section each FDE describes, in the same order as `fdes`.
+  std::vector<InputSection<E> *> fde_isecs;
+
   for (InputSection<E> *isec : eh_frame_sections) {
-    std::span<ElfRel<E>> rels = isec->get_rels(ctx);
+    std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
     i64 cies_begin = cies.size();
     i64 fdes_begin = fdes.size();
 
@@ -524,15 +575,26 @@ void ObjectFile<E>::parse_ehframe(Context<E> &ctx) {
           Fatal(ctx) << *isec << ": FDE's first relocation should have offset 8";
 
         fdes.emplace_back(begin_offset, rel_begin);
+        fde_isecs.push_back(get_section(this->elf_syms[rels[rel_begin].r_sym]));
       }
     }
 
-    // Associate CIEs to FDEs.
-    auto find_cie = [&](i64 offset) {
-      for (i64 i = cies_begin; i < cies.size(); i++)
-        if (cies[i].input_offset == offset)
-          return i;
-      Fatal(ctx) << *isec << ": bad FDE pointer";
+    // Associate CIEs to FDEs. CIEs are sorted by offset, and consecutive
+    // FDEs usually share the same CIE.
+    i64 last_cie = -1;
+
+    auto find_cie = [&](i64 offset) -> i64 {
+      if (last_cie != -1 && cies[last_cie].input_offset == offset)
+        return last_cie;
+
+      auto it = std::lower_bound(cies.begin() + cies_begin, cies.end(), offset,
+                                 [](const CieRecord<E> &cie, i64 offset) {
+        return cie.input_offset < offset;
+      });
+
+      if (it == cies.end() || it->input_offset != offset)
+        Fatal(ctx) << *isec << ": bad FDE pointer";
+      return last_cie = it - cies.begin();
     };
 
     for (i64 i = fdes_begin; i < fdes.size(); i++) {
@@ -541,24 +603,45 @@ void ObjectFile<E>::parse_ehframe(Context<E> &ctx) {
     }
   }
 
-  auto get_isec = [&](const FdeRecord<E> &fde) {
-    return get_section(this->elf_syms[fde.get_rels(*this)[0].r_sym]);
+  // We assume that FDEs for the same input sections are contiguous
+  // in `fdes` vector. Compilers usually emit FDEs in the same order as
+  // functions, so we need to sort them only if they aren't sorted yet.
+  auto less = [&](i64 a, i64 b) {
+    return fde_isecs[a]->get_priority() < fde_isecs[b]->get_priority();
   };
 
-  // We assume that FDEs for the same input sections are contiguous
-  // in `fdes` vector.
-  sort(fdes, [&](const FdeRecord<E> &a, const FdeRecord<E> &b) {
-    return get_isec(a)->get_priority() < get_isec(b)->get_priority();
-  });
+  bool sorted = true;
+  for (i64 i = 1; i < fdes.size() && sorted; i++)
+    if (less(i, i - 1))
+      sorted = false;
+
+  if (!sorted) {
+    std::vector<i64> indices(fdes.size());
+    for (i64 i = 0; i < fdes.size(); i++)
+      indices[i] = i;
+    std::stable_sort(indices.begin(), indices.end(), less);
+
+    std::vector<FdeRecord<E>> fdes2;
+    std::vector<InputSection<E> *> fde_isecs2;
+    fdes2.reserve(fdes.size());
+    fde_isecs2.reserve(fdes.size());
+
+    for (i64 i : indices) {
+      fdes2.push_back(fdes[i]);
+      fde_isecs2.push_back(fde_isecs[i]);
+    }
+    fdes = std::move(fdes2);
+    fde_isecs = std::move(fde_isecs2);
+  }
 
   // Associate FDEs to input sections.
   for (i64 i = 0; i < fdes.size();) {
-    InputSection<E> *isec = get_isec(fdes[i]);
+    InputSection<E> *isec = fde_isecs[i];
     assert(isec->fde_begin == -1);
 
     if (isec->is_alive) {
       isec->fde_begin = i++;
-      while (i < fdes.size() && isec == get_isec(fdes[i]))
+      while (i < fdes.size() && isec == fde_isecs[i])
         i++;
       isec->fde_end = i;
     } else {
@@ -567,31 +650,88 @@ void ObjectFile<E>::parse_ehframe(Context<E> &ctx) {
   }
 }
 
+// Local symbols are never written to the output symbol table if
+// --strip-all or --discard-all is given. In that case, we need only the
+// ones that are referred to by relocations or .llvm_addrsig, plus
+// section and file symbols, and they are typically a minority of local
+// symbols. This function returns a bitmap of local symbols we need to
+// create, or an empty vector if we need all of them.
+template <typename E>
+std::vector<bool> ObjectFile<E>::get_used_local_syms(Context<E> &ctx) {
+  if (!ctx.arg.strip_all && !ctx.arg.discard_all)
+    return {};
+
+  // These features refer to local symbols without relocations.
+  if (ctx.arg.relocatable || ctx.arg.emit_relocs || ctx.arg.print_map ||
+      !ctx.arg.symbol_ordering_file.empty() || !ctx.arg.hot_text_file.empty() ||
+      is_ppc64v1<E>)
+    return {};
+
+  std::vector<bool> vec(this->first_global);
+  vec[0] = true;
+
+  for (i64 i = 1; i < this->first_global; i++)
+    if (u32 ty = this->elf_syms[i].st_type; ty == STT_SECTION || ty == STT_FILE)
+      vec[i] = true;
+
+  for (const ElfShdr<E> &shdr : this->elf_sections)
+    if (shdr.sh_type == (E::is_rela ? SHT_RELA : SHT_REL))
+      for (const ElfRel<E> &r : this->template get_data<ElfRel<E>>(ctx, shdr))
+        if (r.r_sym < this->first_global)
+          vec[r.r_sym] = true;
+
+  if (llvm_addrsig) {
+    u8 *p = (u8 *)llvm_addrsig->contents.data();
+    u8 *end = p + llvm_addrsig->contents.size();
+    while (p < end)
+      if (u64 idx = read_uleb(&p); idx < this->first_global)
+        vec[idx] = true;
+  }
+  return vec;
+}
+
 template <typename E>
 void ObjectFile<E>::initialize_symbols(Context<E> &ctx) {
   if (this->elf_syms.empty())
     return;
 
   static Counter counter("all_syms");
+  static Counter dropped_counter("dropped_local_syms");
   counter += this->elf_syms.size();
 
-  // Initialize local symbols
-  this->local_syms.resize(this->first_global);
+  std::vector<bool> used = get_used_local_syms(ctx);
+  this->symbols.resize(this->elf_syms.size());
+
+  // Initialize local symbols. Unused ones share a single dummy symbol
+  // which doesn't belong to any file.
+  if (used.empty()) {
+    this->local_syms.resize(this->first_global);
+  } else {
+    this->local_syms.resize(std::count(used.begin(), used.end(), true));
+    dropped_counter += this->first_global - this->local_syms.size();
+  }
+
   this->local_syms[0].file = this;
   this->local_syms[0].sym_idx = 0;
+  this->symbols[0] = &this->local_syms[0];
 
-  for (i64 i = 1; i < this->first_global; i++) {
+  for (i64 i = 1, j = 1; i < this->first_global; i++) {
     const ElfSym<E> &esym = this->elf_syms[i];
     if (esym.is_common())
       Fatal(ctx) << *this << ": common local symbol?";
 
+    if (!used.empty() && !used[i]) {
+      this->symbols[i] = &this->unused_local_sym;
+      continue;
+    }
+
     std::string_view name;
     if (esym.st_type == STT_SECTION)
       name = this->shstrtab.data() + this->elf_sections[get_shndx(esym)].sh_name;
     else
       name = this->symbol_strtab.data() + esym.st_name;
 
-    Symbol<E> &sym = this->local_syms[i];
+    Symbol<E> &sym = this->local_syms[j++];
     sym.set_name(name);
     sym.file = this;
     sym.value = esym.st_value;
@@ -599,16 +739,12 @@ void ObjectFile<E>::initialize_symbols(Context<E> &ctx) {
 
     if (!esym.is_abs())
       sym.set_input_section(sections[get_shndx(esym)].get());
+    this->symbols[i] = &sym;
   }
 
-  this->symbols.resize(this->elf_syms.size());
-
   i64 num_globals = this->elf_syms.size() - this->first_global;
   has_symver.resize(num_globals);
 
-  for (i64 i = 0; i < this->first_global; i++)
-    this->symbols[i] = &this->local_syms[i];
-
   // Initialize global symbols
   for (i64 i = this->first_global; i < this->elf_syms.size(); i++) {
     const ElfSym<E> &esym = this->elf_syms[i];
@@ -665,9 +801,11 @@ void ObjectFile<E>::sort_relocations(Context<E> &ctx) {
       if (!isec || !isec->is_alive || !(isec->shdr().sh_flags & SHF_ALLOC))
         continue;
 
-      std::span<ElfRel<E>> rels = isec->get_rels(ctx);
-      if (!std::is_sorted(rels.begin(), rels.end(), less))
-        sort(rels, less);
+      std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
+      if (!std::is_sorted(rels.begin(), rels.end(), less)) {
+        std::span<ElfRel<E>> copy = isec->get_mutable_rels(ctx);
+        sort(copy, less);
+      }
     }
   }
 }
@@ -770,7 +908,7 @@ void ObjectFile<E>::reattach_section_pieces(Context<E> &ctx) {
   i64 nfrag_syms = 0;
   for (std::unique_ptr<InputSection<E>> &isec : sections)
     if (isec && (isec->shdr().sh_flags & SHF_ALLOC))
-      for (ElfRel<E> &r : isec->get_rels(ctx))
+      for (const ElfRel<E> &r : isec->get_rels(ctx))
         if (const ElfSym<E> &esym = this->elf_syms[r.r_sym];
             esym.st_type == STT_SECTION)
           if (mergeable_sections[get_shndx(esym)])
@@ -784,7 +922,11 @@ void ObjectFile<E>::reattach_section_pieces(Context<E> &ctx) {
   i64 idx = 0;
   for (std::unique_ptr<InputSection<E>> &isec : sections) {
     if (isec && (isec->shdr().sh_flags & SHF_ALLOC)) {
-      for (ElfRel<E> &r : isec->get_rels(ctx)) {
+      std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
+      std::span<ElfRel<E>> copy;
+
+      for (i64 i = 0; i < rels.size(); i++) {
+        const ElfRel<E> &r = rels[i];
         const ElfSym<E> &esym = this->elf_syms[r.r_sym];
         if (esym.st_type != STT_SECTION)
           continue;
@@ -811,9 +953,18 @@ void ObjectFile<E>::reattach_section_pieces(Context<E> &ctx) {
         sym.visibility = STV_HIDDEN;
         sym.set_frag(frag);
         sym.value = in_frag_offset - r_addend;
-        r.r_sym = this->elf_syms.size() + idx;
+
+        if (copy.empty())
+          copy = isec->get_mutable_rels(ctx);
+        copy[i].r_sym = this->elf_syms.size() + idx;
         idx++;
       }
+
+      // CIE records refer to relocations of .eh_frame.
+      if (!copy.empty())
+        for (CieRecord<E> &cie : cies)
+          if (&cie.input_section == isec.get())
+            cie.rels = copy;
     }
   }
 
@@ -827,6 +978,7 @@ template <typename E>
 void ObjectFile<E>::parse(Context<E> &ctx) {
   sections.resize(this->elf_sections.size());
   mergeable_sections.resize(sections.size());
+  rel_copies.resize(sections.size());
 
   symtab_sec = this->find_section(SHT_SYMTAB);
 
@@ -843,17 +995,52 @@ void ObjectFile<E>::parse(Context<E> &ctx) {
 
   initialize_sections(ctx);
   initialize_symbols(ctx);
+
+  // Most archive members are never extracted, so for them we do only
+  // what symbol resolution needs and defer the rest until we know
+  // that the file is included in the output.
+  if (!is_in_lib)
+    parse_sections(ctx);
+}
+
+// This function does the part of parsing that touches section contents
+// and relocations. It is called for each object file that is included
+// in the output file.
+template <typename E>
+void ObjectFile<E>::parse_sections(Context<E> &ctx) {
   sort_relocations(ctx);
 
+  // Sections may have been compressed. We usually uncompress them
+  // directly into the mmap'ed output file, but we want to uncompress
+  // early for REL-type ELF types to read relocation addends from
+  // section contents. For RELA-type, we don't need to do this because
+  // addends are in relocations.
+  //
+  // SH-4 stores addends to sections despite being RELA, which is a
+  // special (and buggy) case.
+  //
+  // Relocations for non-SHF_ALLOC sections read addends from the output
+  // buffer, so we don't uncompress such sections here unless we copy
+  // relocations to the output file.
+  if constexpr (!E::is_rela || is_sh4<E>)
+    for (std::unique_ptr<InputSection<E>> &isec : sections)
+      if (isec && isec->is_alive &&
+          ((isec->shdr().sh_flags & SHF_ALLOC) || ctx.arg.relocatable ||
+           ctx.arg.emit_relocs))
+        isec->uncompress(ctx);
+
   // R_ARM_TARGET1 is typically used for entries in .init_array and may
   // be interpreted as REL32 or ABS32 depending on the target.
   // All targets we support handle it as if it were a ABS32.
   if constexpr (is_arm32<E>)
-    for (std::unique_ptr<InputSection<E>> &isec : sections)
-      if (isec && isec->is_alive)
-        for (ElfRel<E> &r : isec->get_rels(ctx))
-          if (r.r_type == R_ARM_TARGET1)
-            r.r_type = R_ARM_ABS32;
+    for (std::unique_ptr<InputSection<E>> &isec : sections) {
+      if (isec && isec->is_alive) {
+        std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
+        for (i64 i = 0; i < rels.size(); i++)
+          if (rels[i].r_type == R_ARM_TARGET1)
+            isec->get_mutable_rels(ctx)[i].r_type = R_ARM_ABS32;
+      }
+    }
 }
 
 // Symbols with higher priorities overwrites symbols with lower priorities.
@@ -935,12 +1122,12 @@ static void print_trace_symbol(Context<E> &ctx, InputFile<E> &file,
 }
 
 template <typename E>
-void ObjectFile<E>::resolve_symbols(Context<E> &ctx) {
+void ObjectFile<E>::resolve_symbols(Context<E> &ctx, bool pending_only) {
   for (i64 i = this->first_global; i < this->elf_syms.size(); i++) {
     Symbol<E> &sym = *this->symbols[i];
     const ElfSym<E> &esym = this->elf_syms[i];
 
-    if (esym.is_undef())
+    if (esym.is_undef() || (pending_only && !sym.needs_resolve))
       continue;
 
     InputSection<E> *isec = nullptr;
@@ -996,14 +1183,23 @@ ObjectFile<E>::mark_live_objects(Context<E> &ctx,
 
 template <typename E>
 void ObjectFile<E>::scan_relocations(Context<E> &ctx) {
-  // Scan relocations against seciton contents
-  for (std::unique_ptr<InputSection<E>> &isec : sections)
-    if (isec && isec->is_alive && (isec->shdr().sh_flags & SHF_ALLOC))
+  // Scan relocations against seciton contents. Sections of a large file
+  // are scanned in parallel so that the file doesn't become a straggler.
+  auto scan = [&](std::unique_ptr<InputSection<E>> &isec) {
+    if (isec && isec->is_alive && !isec->icf_thunk &&
+        (isec->shdr().sh_flags & SHF_ALLOC))
       isec->scan_relocations(ctx);
+  };
+
+  if (!this->mf || this->mf->size < 16 * 1024 * 1024)
+    for (std::unique_ptr<InputSection<E>> &isec : sections)
+      scan(isec);
+  else
+    tbb::parallel_for_each(sections, scan);
 
   // Scan relocations against exception frames
   for (CieRecord<E> &cie : cies) {
-    for (ElfRel<E> &rel : cie.get_rels()) {
+    for (const ElfRel<E> &rel : cie.get_rels()) {
       Symbol<E> &sym = *this->symbols[rel.r_sym];
 
       if (ctx.arg.pic && rel.r_type == E::R_ABS)
@@ -1152,13 +1348,20 @@ void ObjectFile<E>::populate_symtab(Context<E> &ctx) {
   u8 *strtab_base = ctx.buf + ctx.strtab->shdr.sh_offset;
   i64 strtab_off = this->strtab_offset;
 
+  i64 name_idx = 0;
+
   auto write_sym = [&](Symbol<E> &sym, i64 idx) {
     U32<E> *xindex = nullptr;
     if (ctx.symtab_shndx)
       xindex = (U32<E> *)(ctx.buf + ctx.symtab_shndx->shdr.sh_offset) + idx;
 
-    symtab_base[idx] = to_output_esym(ctx, sym, strtab_off, xindex);
-    strtab_off += write_string(strtab_base + strtab_off, sym.name());
+    if (ctx.arg.tail_merge_strtab) {
+      i64 st_name = this->strtab_offset + this->strtab_name_offsets[name_idx++];
+      symtab_base[idx] = to_output_esym(ctx, sym, st_name, xindex);
+    } else {
+      symtab_base[idx] = to_output_esym(ctx, sym, strtab_off, xindex);
+      strtab_off += write_string(strtab_base + strtab_off, sym.name());
+    }
   };
 
   i64 local_idx = this->local_symtab_idx;
@@ -1220,28 +1423,73 @@ void SharedFile<E>::parse(Context<E> &ctx) {
   if (ElfShdr<E> *sec = this->find_section(SHT_GNU_VERSYM))
     vers = this->template get_data<U16<E>>(ctx, *sec);
 
-  for (i64 i = symtab_sec->sh_info; i < esyms.size(); i++) {
-    u16 ver;
+  auto get_ver = [&](i64 i) -> u16 {
     if (vers.empty() || esyms[i].is_undef())
-      ver = VER_NDX_GLOBAL;
-    else
-      ver = (vers[i] & ~VERSYM_HIDDEN);
+      return VER_NDX_GLOBAL;
+    return vers[i] & ~VERSYM_HIDDEN;
+  };
+
+  auto is_default = [&](i64 i) {
+    return vers.empty() || !(vers[i] & VERSYM_HIDDEN);
+  };
+
+  // We build names of non-default versioned symbols in a single buffer
+  // rather than allocating each of them separately, as a DSO may have
+  // many of them.
+  i64 num_syms = 0;
+  i64 bufsize = 0;
 
+  for (i64 i = symtab_sec->sh_info; i < esyms.size(); i++) {
+    u16 ver = get_ver(i);
+    if (ver == VER_NDX_LOCAL)
+      continue;
+
+    num_syms++;
+    if (!is_default(i))
+      bufsize += strlen(this->symbol_strtab.data() + esyms[i].st_name) +
+                 version_strings[ver].size() + 2;
+  }
+
+  this->elf_syms2.reserve(num_syms);
+  this->versyms.reserve(num_syms);
+  this->symbols.reserve(num_syms);
+  if (ctx.arg.lazy_dso_symbols)
+    lazy_keys.resize(num_syms);
+
+  char *buf = nullptr;
+  if (bufsize) {
+    buf = (char *)new u8[bufsize];
+    ctx.string_pool.push_back(std::unique_ptr<u8[]>((u8 *)buf));
+    ctx.string_pool_bytes += bufsize;
+  }
+
+  for (i64 i = symtab_sec->sh_info; i < esyms.size(); i++) {
+    u16 ver = get_ver(i);
     if (ver == VER_NDX_LOCAL)
       continue;
 
     std::string_view name = this->symbol_strtab.data() + esyms[i].st_name;
-    bool is_default = vers.empty() || !(vers[i] & VERSYM_HIDDEN);
 
     this->elf_syms2.push_back(esyms[i]);
     this->versyms.push_back(ver);
 
-    if (is_default) {
-      this->symbols.push_back(get_symbol(ctx, name));
+    // Non-default versioned symbols are named `foo@VERSION`.
+    std::string_view key = name;
+    if (!is_default(i)) {
+      std::string_view verstr = version_strings[ver];
+      memcpy(buf, name.data(), name.size());
+      buf[name.size()] = '@';
+      memcpy(buf + name.size() + 1, verstr.data(), verstr.size());
+      buf[name.size() + verstr.size() + 1] = '\0';
+      key = {buf, name.size() + verstr.size() + 1};
+      buf += key.size() + 1;
+    }
+
+    if (ctx.arg.lazy_dso_symbols && !esyms[i].is_undef()) {
+      lazy_keys[this->symbols.size()] = key;
+      this->symbols.push_back(nullptr);
     } else {
-      std::string_view mangled_name = save_string(
-        ctx, std::string(name) + "@" + std::string(version_strings[ver]));
-      this->symbols.push_back(get_symbol(ctx, mangled_name, name));
+      this->symbols.push_back(get_symbol(ctx, key, name));
     }
   }
 
@@ -1252,6 +1500,60 @@ void SharedFile<E>::parse(Context<E> &ctx) {
   counter += this->elf_syms.size();
 }
 
+// With --lazy-dso-symbols, defined symbols of a DSO are not inserted to
+// the symbol table when the DSO is parsed. Instead, after all input files
+// are parsed, we look up the symbol table for them and keep only the ones
+// that already exist, as other symbols are not referenced by any file.
+template <typename E>
+void SharedFile<E>::find_lazy_symbols(Context<E> &ctx, bool intern_all) {
+  for (i64 i = 0; i < lazy_keys.size(); i++) {
+    std::string_view key = lazy_keys[i];
+    if (key.data()) {
+      if (intern_all)
+        this->symbols[i] = get_symbol(ctx, key);
+      else
+        this->symbols[i] = ctx.symbol_map.get(key, hash_string(key));
+    }
+  }
+}
+
+// This function is called after find_lazy_symbols() is called for all
+// DSOs. A symbol we keep may be copied to an executable with a copy
+// relocation, in which case all its aliases need to be copied too. So
+// we also keep symbols at the same address as the ones we keep.
+template <typename E>
+void SharedFile<E>::intern_lazy_symbols(Context<E> &ctx) {
+  if (lazy_keys.empty())
+    return;
+
+  std::unordered_set<u64> addrs;
+  for (i64 i = 0; i < lazy_keys.size(); i++)
+    if (lazy_keys[i].data() && this->symbols[i])
+      addrs.insert(elf_syms2[i].st_value);
+
+  for (i64 i = 0; i < lazy_keys.size(); i++)
+    if (lazy_keys[i].data() && !this->symbols[i] &&
+        addrs.contains(elf_syms2[i].st_value))
+      this->symbols[i] = get_symbol(ctx, lazy_keys[i]);
+
+  // Remove symbols that we don't keep.
+  i64 j = 0;
+  for (i64 i = 0; i < this->symbols.size(); i++) {
+    if (this->symbols[i]) {
+      elf_syms2[j] = elf_syms2[i];
+      versyms[j] = versyms[i];
+      this->symbols[j] = this->symbols[i];
+      j++;
+    }
+  }
+
+  elf_syms2.resize(j);
+  versyms.resize(j);
+  this->symbols.resize(j);
+  this->elf_syms = elf_syms2;
+  lazy_keys = {};
+}
+
 template <typename E>
 std::vector<std::string_view> SharedFile<E>::get_dt_needed(Context<E> &ctx) {
   // Get the contents of the dynamic segment
@@ -1338,13 +1640,15 @@ std::vector<std::string_view> SharedFile<E>::read_verdef(Context<E> &ctx) {
 }
 
 template <typename E>
-void SharedFile<E>::resolve_symbols(Context<E> &ctx) {
+void SharedFile<E>::resolve_symbols(Context<E> &ctx, bool pending_only) {
   for (i64 i = 0; i < this->symbols.size(); i++) {
     Symbol<E> &sym = *this->symbols[i];
     const ElfSym<E> &esym = this->elf_syms[i];
 
     if (esym.is_undef() || sym.skip_dso)
       continue;
+    if (pending_only && !sym.needs_resolve)
+      continue;
 
     std::scoped_lock lock(sym.mu);
 
@@ -1468,8 +1772,13 @@ void SharedFile<E>::populate_symtab(Context<E> &ctx) {
       xindex = (U32<E> *)(ctx.buf + ctx.symtab_shndx->shdr.sh_offset) +
                this->global_symtab_idx + i;
 
-    *symtab++ = to_output_esym(ctx, *sym, strtab_off, xindex);
-    strtab_off += write_string(strtab + strtab_off, sym->name());
+    if (ctx.arg.tail_merge_strtab) {
+      i64 st_name = this->strtab_offset + this->strtab_name_offsets[i];
+      *symtab++ = to_output_esym(ctx, *sym, st_name, xindex);
+    } else {
+      *symtab++ = to_output_esym(ctx, *sym, strtab_off, xindex);
+      strtab_off += write_string(strtab + strtab_off, sym->name());
+    }
     i++;
   }
 }
@@ -1,6 +1,7 @@
 #include "mold.h"
 
 #include <limits>
+#include <tbb/parallel_for_each.h>
 #include <zlib.h>
 #include <zstd.h>
 
@@ -45,17 +46,6 @@ InputSection<E>::InputSection(Context<E> &ctx, ObjectFile<E> &file, i64 shndx)
     sh_size = shdr().sh_size;
     p2align = to_p2align(shdr().sh_addralign);
   }
-
-  // Sections may have been compressed. We usually uncompress them
-  // directly into the mmap'ed output file, but we want to uncompress
-  // early for REL-type ELF types to read relocation addends from
-  // section contents. For RELA-type, we don't need to do this because
-  // addends are in relocations.
-  //
-  // SH-4 stores addends to sections despite being RELA, which is a
-  // special (and buggy) case.
-  if constexpr (!E::is_rela || is_sh4<E>)
-    uncompress(ctx);
 }
 
 template <typename E>
@@ -67,9 +57,50 @@ void InputSection<E>::uncompress(Context<E> &ctx) {
   copy_contents(ctx, buf);
   contents = std::string_view((char *)buf, sh_size);
   ctx.string_pool.emplace_back(buf);
+  ctx.string_pool_bytes += sh_size;
   uncompressed = true;
 }
 
+// Zstd-compressed data may consist of multiple frames. For example,
+// mold itself compresses a large section as a sequence of independent
+// frames. If all frames record their uncompressed sizes, we can
+// decompress them in parallel.
+static bool decompress_zstd(u8 *buf, i64 size, std::string_view data) {
+  struct Frame {
+    std::string_view in;
+    u8 *out;
+    i64 size;
+  };
+
+  std::vector<Frame> frames;
+  i64 offset = 0;
+
+  for (std::string_view rest = data; !rest.empty();) {
+    size_t n = ZSTD_findFrameCompressedSize(rest.data(), rest.size());
+    unsigned long long m = ZSTD_getFrameContentSize(rest.data(), rest.size());
+
+    if (ZSTD_isError(n) || m == ZSTD_CONTENTSIZE_UNKNOWN ||
+        m == ZSTD_CONTENTSIZE_ERROR || offset + m > size) {
+      frames.clear();
+      break;
+    }
+
+    frames.push_back({rest.substr(0, n), buf + offset, (i64)m});
+    offset += m;
+    rest = rest.substr(n);
+  }
+
+  if (frames.size() < 2 || offset != size)
+    return ZSTD_decompress(buf, size, data.data(), data.size()) == size;
+
+  Atomic<bool> ok = true;
+  tbb::parallel_for_each(frames, [&](const Frame &f) {
+    if (ZSTD_decompress(f.out, f.size, f.in.data(), f.in.size()) != f.size)
+      ok = false;
+  });
+  return ok;
+}
+
 template <typename E>
 void InputSection<E>::copy_contents(Context<E> &ctx, u8 *buf) {
   if (!(shdr().sh_flags & SHF_COMPRESSED) || uncompressed) {
@@ -92,7 +123,7 @@ void InputSection<E>::copy_contents(Context<E> &ctx, u8 *buf) {
     break;
   }
   case ELFCOMPRESS_ZSTD:
-    if (ZSTD_decompress(buf, sh_size, (u8 *)data.data(), data.size()) != sh_size)
+    if (!decompress_zstd(buf, sh_size, data))
       Fatal(ctx) << *this << ": ZSTD_decompress failed";
     break;
   default:
@@ -149,40 +180,48 @@ static inline i64 get_sym_type(Symbol<E> &sym) {
   return 3;
 }
 
-template <typename E>
-void InputSection<E>::scan_pcrel(Context<E> &ctx, Symbol<E> &sym,
-                                 const ElfRel<E> &rel) {
+// Decision tables for relocations that cannot be promoted to dynamic
+// relocations, indexed by [relocation class][output type][symbol type].
+// They don't depend on the target, so one table serves all backends.
+enum : u8 { PCREL, ABSREL };
+
+static constexpr Action action_table[][3][4] = {
   // This is for PC-relative relocations (e.g. R_X86_64_PC32).
   // We cannot promote them to dynamic relocations because the dynamic
   // linker generally does not support PC-relative relocations.
-  static Action table[][4] = {
+  {
     // Absolute  Local    Imported data  Imported code
     {  ERROR,    NONE,    ERROR,         PLT    },  // Shared object
     {  ERROR,    NONE,    COPYREL,       CPLT   },  // Position-independent exec
     {  NONE,     NONE,    COPYREL,       CPLT   },  // Position-dependent exec
-  };
-
-  Action action = table[get_output_type(ctx)][get_sym_type(sym)];
-  do_action(ctx, action, *this, sym, rel);
-}
+  },
 
-template <typename E>
-void InputSection<E>::scan_absrel(Context<E> &ctx, Symbol<E> &sym,
-                                  const ElfRel<E> &rel) {
-  // This is a decision table for absolute relocations that is smaller
-  // than the pointer size (e.g. R_X86_64_32). Since the dynamic linker
-  // generally does not support dynamic relocations smaller than the
-  // pointer size, we need to report an error if a relocation cannot be
-  // resolved at link-time.
-  static Action table[][4] = {
+  // This is for absolute relocations that is smaller than the pointer
+  // size (e.g. R_X86_64_32). Since the dynamic linker generally does not
+  // support dynamic relocations smaller than the pointer size, we need to
+  // report an error if a relocation cannot be resolved at link-time.
+  {
     // Absolute  Local    Imported data  Imported code
     {  NONE,     ERROR,   ERROR,         ERROR },  // Shared object
     {  NONE,     ERROR,   ERROR,         ERROR },  // Position-independent exec
     {  NONE,     NONE,    COPYREL,       CPLT  },  // Position-dependent exec
-  };
+  },
+};
 
-  Action action = table[get_output_type(ctx)][get_sym_type(sym)];
-  do_action(ctx, action, *this, sym, rel);
+template <typename E>
+void InputSection<E>::scan_pcrel(Context<E> &ctx, Symbol<E> &sym,
+                                 const ElfRel<E> &rel) {
+  Action action = action_table[PCREL][get_output_type(ctx)][get_sym_type(sym)];
+  if (action != NONE)
+    do_action(ctx, action, *this, sym, rel);
+}
+
+template <typename E>
+void InputSection<E>::scan_absrel(Context<E> &ctx, Symbol<E> &sym,
+                                  const ElfRel<E> &rel) {
+  Action action = action_table[ABSREL][get_output_type(ctx)][get_sym_type(sym)];
+  if (action != NONE)
+    do_action(ctx, action, *this, sym, rel);
 }
 
 template <typename E>
@@ -218,7 +257,35 @@ void InputSection<E>::check_tlsle(Context<E> &ctx, Symbol<E> &sym,
 
 template <typename E>
 void InputSection<E>::write_to(Context<E> &ctx, u8 *buf) {
-  if (shdr().sh_type == SHT_NOBITS || sh_size == 0)
+  if (shdr().sh_type == SHT_NOBITS || sh_size == 0 || copied_verbatim)
+    return;
+
+  // A section folded by --icf=safe-thunks is just a jump to its leader.
+  if constexpr (is_x86_64<E>) {
+    if (icf_thunk) {
+      u8 *loc = buf;
+      if (contents.starts_with("\xf3\x0f\x1e\xfa")) {
+        if (!extra.endbr.empty() && extra.endbr[0].first == 0 &&
+            !extra.endbr[0].second)
+          memcpy(loc, "\x0f\x1f\x40\x00", 4); // nop
+        else
+          memcpy(loc, "\xf3\x0f\x1e\xfa", 4); // endbr64
+        loc += 4;
+      }
+      loc[0] = 0xe9; // jmp rel32
+      *(ul32 *)(loc + 1) = leader->get_addr() - (get_addr() + sh_size);
+      return;
+    }
+  }
+
+  if (is_large_nonalloc()) {
+    write_large_nonalloc(ctx, buf);
+    return;
+  }
+
+  if (!(shdr().sh_flags & SHF_ALLOC) && (shdr().sh_flags & SHF_COMPRESSED) &&
+      !uncompressed && !ctx.arg.relocatable &&
+      write_compressed_nonalloc(ctx, buf))
     return;
 
   // Copy data. In RISC-V and LoongArch object files, sections are not
@@ -252,28 +319,231 @@ void InputSection<E>::write_to(Context<E> &ctx, u8 *buf) {
     copy_contents(ctx, buf);
   }
 
+  // With -z rewrite-endbr, replace endbr64s that are not needed with nops.
+  // See arch-x86-64.cc for details.
+  if constexpr (is_x86_64<E>)
+    for (std::pair<u32, Atomic<bool>> &p : extra.endbr)
+      if (!p.second)
+        memcpy(buf + p.first, "\x0f\x1f\x40\x00", 4);
+
   // Apply relocations
   if (!ctx.arg.relocatable) {
+    i64 start = ctx.arg.input_stats.empty() ? 0 : now_nsec();
+
     if (shdr().sh_flags & SHF_ALLOC)
       apply_reloc_alloc(ctx, buf);
     else
       apply_reloc_nonalloc(ctx, buf);
+
+    if (!ctx.arg.input_stats.empty())
+      file.apply_nsec += now_nsec() - start;
   }
 }
 
+// A single input section can be huge. For example, an object file
+// created by a unity build may contain a 500 MB .debug_info. Writing it
+// with one thread would be a long serial tail of copy_chunks, so we
+// first copy a large non-SHF_ALLOC section in blocks in parallel, and
+// then apply its relocations in parallel.
+//
+// Relocations for a non-SHF_ALLOC section are independent of each other
+// except ones for the same location, such as RISC-V's SET_ULEB128 and
+// SUB_ULEB128 pairs, which must be applied in order. So we split the
+// relocation list only between relocations at different offsets.
+//
+// We don't do this for SHF_ALLOC sections because relocations for code
+// often depend on neighboring ones (e.g. TLS instruction sequences on
+// x86-64 or HI20/LO12 pairs on RISC-V).
+template <typename E>
+void InputSection<E>::write_large_nonalloc(Context<E> &ctx, u8 *buf) {
+  constexpr i64 BLOCK_SIZE = 1024 * 1024;
+  i64 num_blocks = align_to(sh_size, BLOCK_SIZE) / BLOCK_SIZE;
+
+  tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+    i64 offset = i * BLOCK_SIZE;
+    memcpy(buf + offset, contents.data() + offset,
+           std::min<i64>(BLOCK_SIZE, sh_size - offset));
+  });
+
+  if (ctx.arg.relocatable)
+    return;
+
+  i64 start = ctx.arg.input_stats.empty() ? 0 : now_nsec();
+
+  std::span<const ElfRel<E>> rels = get_rels(ctx);
+  constexpr i64 RELS_PER_TASK = 64 * 1024;
+
+  std::vector<i64> bounds = {0};
+  for (i64 i = RELS_PER_TASK; i < rels.size(); i += RELS_PER_TASK) {
+    while (i < rels.size() && rels[i].r_offset == rels[i - 1].r_offset)
+      i++;
+    if (i < rels.size())
+      bounds.push_back(i);
+  }
+  bounds.push_back(rels.size());
+
+  tbb::parallel_for((i64)0, (i64)bounds.size() - 1, [&](i64 i) {
+    apply_reloc_nonalloc(ctx, buf,
+                         rels.subspan(bounds[i], bounds[i + 1] - bounds[i]));
+  });
+
+  if (!ctx.arg.input_stats.empty())
+    file.apply_nsec += now_nsec() - start;
+}
+
+// Compressed debug sections are decompressed in small blocks, and
+// relocations in each block are applied as soon as the block is
+// decompressed, while it is still in cache. This is faster than
+// decompressing an entire section first and then reading it again for
+// relocation. REL-type targets read addends from decompressed bytes.
+//
+// Returns false if a section is a zstd-compressed one consisting of
+// multiple frames, which copy_contents() can decompress in parallel.
+template <typename E>
+bool InputSection<E>::write_compressed_nonalloc(Context<E> &ctx, u8 *buf) {
+  constexpr i64 BLOCK_SIZE = 64 * 1024;
+
+  if (contents.size() < sizeof(ElfChdr<E>))
+    Fatal(ctx) << *this << ": corrupted compressed section";
+
+  ElfChdr<E> &hdr = *(ElfChdr<E> *)&contents[0];
+  std::string_view data = contents.substr(sizeof(ElfChdr<E>));
+
+  if (hdr.ch_type != ELFCOMPRESS_ZLIB && hdr.ch_type != ELFCOMPRESS_ZSTD)
+    return false;
+  if (hdr.ch_type == ELFCOMPRESS_ZSTD &&
+      ZSTD_findFrameCompressedSize(data.data(), data.size()) != data.size())
+    return false;
+
+  // Applies relocations whose locations are within the first `size`
+  // bytes. A relocated field is at most 10 bytes long (a ULEB128 value),
+  // so we leave a margin.
+  std::span<const ElfRel<E>> rels = get_rels(ctx);
+  i64 num_applied = 0;
+
+  auto apply = [&](i64 size) {
+    i64 end = num_applied;
+    while (end < rels.size() && rels[end].r_offset + 16 <= size)
+      end++;
+
+    if (num_applied < end) {
+      i64 start = ctx.arg.input_stats.empty() ? 0 : now_nsec();
+      apply_reloc_nonalloc(ctx, buf, rels.subspan(num_applied,
+                                                  end - num_applied));
+      if (!ctx.arg.input_stats.empty())
+        file.apply_nsec += now_nsec() - start;
+      num_applied = end;
+    }
+  };
+
+  i64 pos = 0;
+
+  if (hdr.ch_type == ELFCOMPRESS_ZLIB) {
+    z_stream zs = {};
+    if (inflateInit(&zs) != Z_OK)
+      Fatal(ctx) << *this << ": inflateInit failed";
+
+    zs.next_in = (u8 *)data.data();
+    zs.avail_in = data.size();
+
+    for (;;) {
+      zs.next_out = buf + pos;
+      zs.avail_out = std::min<i64>(BLOCK_SIZE, sh_size - pos);
+
+      int r = inflate(&zs, Z_NO_FLUSH);
+      if (r != Z_OK && r != Z_STREAM_END)
+        Fatal(ctx) << *this << ": uncompress failed";
+
+      pos = zs.next_out - buf;
+      apply(pos);
+      if (r == Z_STREAM_END)
+        break;
+    }
+    inflateEnd(&zs);
+  } else {
+    ZSTD_DStream *ds = ZSTD_createDStream();
+    ZSTD_inBuffer in = {data.data(), data.size(), 0};
+
+    for (;;) {
+      i64 end = std::min<i64>(pos + BLOCK_SIZE, sh_size);
+      ZSTD_outBuffer out = {buf, (size_t)end, (size_t)pos};
+      size_t in_pos = in.pos;
+
+      size_t r = ZSTD_decompressStream(ds, &out, &in);
+      if (ZSTD_isError(r) || (in.pos == in_pos && out.pos == pos))
+        Fatal(ctx) << *this << ": ZSTD_decompress failed";
+
+      pos = out.pos;
+      apply(pos);
+      if (r == 0)
+        break;
+    }
+    ZSTD_freeDStream(ds);
+  }
+
+  if (pos != sh_size)
+    Fatal(ctx) << *this << ": uncompressed size mismatch";
+
+  apply(INT64_MAX);
+  return true;
+}
+
 // Get the name of a function containin a given offset.
+//
+// This function is called for each reference to an undefined symbol,
+// which can be millions for a badly broken link, so we look up a
+// function in a per-file list of functions sorted by section index and
+// address instead of scanning all symbols.
 template <typename E>
 std::string_view
 InputSection<E>::get_func_name(Context<E> &ctx, i64 offset) const {
-  for (Symbol<E> *sym : file.symbols) {
-    if (sym->file == &file) {
-      const ElfSym<E> &esym = sym->esym();
-      if (esym.st_shndx == shndx && esym.st_type == STT_FUNC &&
-          esym.st_value <= offset && offset < esym.st_value + esym.st_size) {
-        if (ctx.arg.demangle)
-          return demangle(*sym);
-        return sym->name();
-      }
+  // We read ELF symbols instead of Symbol objects because unused local
+  // symbols may not have been created with --strip-all or --discard-all.
+  // See ObjectFile::get_used_local_syms().
+  std::call_once(file.init_func_syms, [&] {
+    for (i64 i = 1; i < file.elf_syms.size(); i++)
+      if (file.elf_syms[i].st_type == STT_FUNC &&
+          (i < file.first_global || file.symbols[i]->file == &file))
+        file.func_syms.push_back(i);
+
+    sort(file.func_syms, [&](u32 a, u32 b) {
+      const ElfSym<E> &x = file.elf_syms[a];
+      const ElfSym<E> &y = file.elf_syms[b];
+      return std::tuple{x.st_shndx, x.st_value, a} <
+             std::tuple{y.st_shndx, y.st_value, b};
+    });
+  });
+
+  std::vector<u32> &syms = file.func_syms;
+
+  // Find the last function that starts at or before `offset`. There may
+  // be aliases starting at the same address with different sizes.
+  auto it = std::upper_bound(syms.begin(), syms.end(), offset,
+                             [&](i64 offset, u32 idx) {
+    const ElfSym<E> &esym = file.elf_syms[idx];
+    return std::tuple{(i64)shndx, offset} <
+           std::tuple{(i64)esym.st_shndx, (i64)esym.st_value};
+  });
+
+  if (it == syms.begin())
+    return "";
+  u64 addr = file.elf_syms[it[-1]].st_value;
+
+  while (it != syms.begin()) {
+    const ElfSym<E> &esym = file.elf_syms[*--it];
+    if (esym.st_shndx != shndx || esym.st_value != addr)
+      break;
+
+    if (offset < esym.st_value + esym.st_size) {
+      std::string_view name = file.symbol_strtab.data() + esym.st_name;
+      if (!ctx.arg.demangle)
+        return name;
+
+      // demangle() returns either a thread-local buffer or `name`
+      // itself, so it's safe to use a temporary Symbol.
+      Symbol<E> sym(name, false);
+      sym.file = &file;
+      return demangle(sym);
     }
   }
   return "";
@@ -300,7 +570,15 @@ bool InputSection<E>::record_undef_error(Context<E> &ctx, const ElfRel<E> &rel)
     return true;
   }
 
+  // We format only the first few references to each undefined symbol
+  // because the others are not printed anyway.
   auto record = [&] {
+    std::shared_lock lock(ctx.undef_errors_mu);
+    typename decltype(ctx.undef_errors)::accessor acc;
+    ctx.undef_errors.insert(acc, {&sym, {}});
+    if (acc->second.count++ >= ctx.MAX_UNDEF_ERROR_REFS)
+      return;
+
     std::stringstream ss;
     if (std::string_view source = file.get_source_name(); !source.empty())
       ss << ">>> referenced by " << source << "\n";
@@ -311,10 +589,7 @@ bool InputSection<E>::record_undef_error(Context<E> &ctx, const ElfRel<E> &rel)
     if (std::string_view func = get_func_name(ctx, rel.r_offset); !func.empty())
       ss << ":(" << func << ")";
     ss << '\n';
-
-    typename decltype(ctx.undef_errors)::accessor acc;
-    ctx.undef_errors.insert(acc, {&sym, {}});
-    acc->second.push_back(ss.str());
+    acc->second.refs.push_back(ss.str());
   };
 
   // A non-weak undefined symbol must be promoted to an imported symbol
@@ -360,6 +635,46 @@ static size_t find_null(std::string_view data, i64 pos, i64 entsize) {
   return data.npos;
 }
 
+// Splits a section consisting of null-terminated 1-byte-char strings
+// and calls `fn(pos, len)` for each string including its terminator.
+// This is equivalent to calling find_null() repeatedly, but it examines
+// 8 bytes at a time and finds all null bytes in each word at once.
+// String sections such as .debug_str consist of many short strings,
+// so this is much faster than calling memchr() for each string.
+//
+// Returns false if the last string is not null-terminated.
+template <typename Fn>
+static bool split_strings(std::string_view data, Fn fn) {
+  constexpr u64 lo = 0x7f7f'7f7f'7f7f'7f7f;
+
+  const u8 *p = (const u8 *)data.data();
+  i64 size = data.size();
+  i64 start = 0;
+  i64 i = 0;
+
+  for (; i + 8 <= size; i += 8) {
+    // The most significant bit of each byte in `mask` is set if and
+    // only if the corresponding byte in `x` is zero.
+    u64 x = *(ul64 *)(p + i);
+    u64 mask = ~(((x & lo) + lo) | x | lo);
+
+    while (mask) {
+      i64 end = i + std::countr_zero(mask) / 8;
+      fn(start, end + 1 - start);
+      start = end + 1;
+      mask &= mask - 1;
+    }
+  }
+
+  for (; i < size; i++) {
+    if (p[i] == '\0') {
+      fn(start, i + 1 - start);
+      start = i + 1;
+    }
+  }
+  return start == size;
+}
+
 // Mergeable sections (sections with SHF_MERGE bit) typically contain
 // string literals. Linker is expected to split the section contents
 // into null-terminated strings, merge them with mergeable strings
@@ -385,33 +700,37 @@ void MergeableSection<E>::split_contents(Context<E> &ctx) {
                << ": mergeable section too large";
 
   i64 entsize = parent.shdr.sh_entsize;
+  HyperLogLog estimator;
 
-  // Split sections
-  if (parent.shdr.sh_flags & SHF_STRINGS) {
+  // Split section contents and compute hashes for section pieces.
+  // We hash each piece right after finding its end so that we don't
+  // have to scan the entire section twice.
+  auto add = [&](i64 pos, i64 len) {
+    u64 hash = hash_string(data.substr(pos, len));
+    frag_offsets.push_back(pos);
+    hashes.push_back(hash);
+    estimator.insert(hash);
+  };
+
+  if ((parent.shdr.sh_flags & SHF_STRINGS) && entsize == 1) {
+    if (!split_strings(data, add))
+      Fatal(ctx) << *section << ": string is not null terminated";
+  } else if (parent.shdr.sh_flags & SHF_STRINGS) {
     for (i64 pos = 0; pos < data.size();) {
-      frag_offsets.push_back(pos);
       size_t end = find_null(data, pos, entsize);
       if (end == data.npos)
         Fatal(ctx) << *section << ": string is not null terminated";
+      add(pos, end + entsize - pos);
       pos = end + entsize;
     }
   } else {
     if (data.size() % entsize)
       Fatal(ctx) << *section << ": section size is not multiple of sh_entsize";
     frag_offsets.reserve(data.size() / entsize);
+    hashes.reserve(data.size() / entsize);
 
     for (i64 pos = 0; pos < data.size(); pos += entsize)
-      frag_offsets.push_back(pos);
-  }
-
-  // Compute hashes for section pieces
-  HyperLogLog estimator;
-  hashes.reserve(frag_offsets.size());
-
-  for (i64 i = 0; i < frag_offsets.size(); i++) {
-    u64 hash = hash_string(get_contents(i));
-    hashes.push_back(hash);
-    estimator.insert(hash);
+      add(pos, entsize);
   }
 
   parent.estimator.merge(estimator);
@@ -421,10 +740,14 @@ void MergeableSection<E>::split_contents(Context<E> &ctx) {
 }
 
 template <typename E>
-void MergeableSection<E>::resolve_contents(Context<E> &ctx) {
+void MergeableSection<E>::resolve_contents(Context<E> &ctx, i64 rank) {
   fragments.reserve(frag_offsets.size());
-  for (i64 i = 0; i < frag_offsets.size(); i++)
-    fragments.push_back(parent.insert(ctx, get_contents(i), hashes[i], p2align));
+  for (i64 i = 0; i < frag_offsets.size(); i++) {
+    SectionFragment<E> *frag =
+      parent.insert(ctx, get_contents(i), hashes[i], p2align,
+                    (rank == -1) ? -1 : rank + i);
+    fragments.push_back(parent.get_handle(frag));
+  }
 
   // Reclaim memory as we'll never use this vector again
   hashes.clear();
@@ -45,52 +45,68 @@ void Script<E>::error(std::string_view pos, std::string msg) {
              << std::string(indent + column, ' ') << "^ " << msg;
 }
 
+// Returns true if `c` can be part of an unquoted token. Version scripts
+// can be tens of megabytes long, so we use a table instead of
+// std::string_view::find_first_not_of, which checks each character
+// against the entire set one by one.
+static bool is_token_char(u8 c) {
+  static const std::array<bool, 256> table = [] {
+    std::array<bool, 256> arr = {};
+    std::string_view chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+      "0123456789_.$/\\~=+[]*?-!^:";
+    for (char c : chars)
+      arr[(u8)c] = true;
+    return arr;
+  }();
+  return table[c];
+}
+
 template <typename E>
 void Script<E>::tokenize() {
   std::string_view input = mf->get_contents();
+  i64 i = 0;
 
-  while (!input.empty()) {
-    if (isspace(input[0])) {
-      input = input.substr(1);
+  while (i < input.size()) {
+    u8 c = input[i];
+
+    if (isspace(c)) {
+      i++;
       continue;
     }
 
-    if (input.starts_with("/*")) {
-      i64 pos = input.find("*/", 2);
+    if (c == '/' && input.substr(i).starts_with("/*")) {
+      i64 pos = input.find("*/", i + 2);
       if (pos == std::string_view::npos)
-        error(input, "unclosed comment");
-      input = input.substr(pos + 2);
+        error(input.substr(i), "unclosed comment");
+      i = pos + 2;
       continue;
     }
 
-    if (input[0] == '#') {
-      i64 pos = input.find("\n", 1);
+    if (c == '#') {
+      i64 pos = input.find("\n", i + 1);
       if (pos == std::string_view::npos)
         break;
-      input = input.substr(pos + 1);
+      i = pos + 1;
       continue;
     }
 
-    if (input[0] == '"') {
-      i64 pos = input.find('"', 1);
+    if (c == '"') {
+      i64 pos = input.find('"', i + 1);
       if (pos == std::string_view::npos)
-        error(input, "unclosed string literal");
-      tokens.push_back(input.substr(0, pos + 1));
-      input = input.substr(pos + 1);
+        error(input.substr(i), "unclosed string literal");
+      tokens.push_back(input.substr(i, pos + 1 - i));
+      i = pos + 1;
       continue;
     }
 
-    i64 pos = input.find_first_not_of(
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
-      "0123456789_.$/\\~=+[]*?-!^:");
-
-    if (pos == 0)
-      pos = 1;
-    else if (pos == input.npos)
-      pos = input.size();
+    i64 j = i + 1;
+    if (is_token_char(c))
+      while (j < input.size() && is_token_char(input[j]))
+        j++;
 
-    tokens.push_back(input.substr(0, pos));
-    input = input.substr(pos);
+    tokens.push_back(input.substr(i, j - i));
+    i = j;
   }
 }
 
@@ -252,8 +268,10 @@ std::string_view Script<E>::get_script_output_type() {
   return "";
 }
 
-static bool read_label(std::span<std::string_view> &tok, std::string label) {
-  if (tok.size() >= 1 && tok[0] == label + ":") {
+static bool read_label(std::span<std::string_view> &tok,
+                       std::string_view label) {
+  if (tok.size() >= 1 && tok[0].size() == label.size() + 1 &&
+      tok[0].starts_with(label) && tok[0].ends_with(':')) {
     tok = tok.subspan(1);
     return true;
   }
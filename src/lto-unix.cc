@@ -80,14 +80,23 @@
 
 #include "mold.h"
 #include "lto.h"
+#include "blake3.h"
 
 #include <cstdarg>
 #include <cstring>
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <condition_variable>
+#include <spawn.h>
 #include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #include <unistd.h>
+#include <unordered_set>
 
 #if 0
 # define LOG std::cerr
@@ -184,8 +193,12 @@ static PluginStatus add_input_file(const char *path) {
 
   file->priority = file_priority++;
   file->is_alive = true;
+  hash_input_file(ctx, file);
   file->parse(ctx);
   file->resolve_symbols(ctx);
+
+  if (ctx.progress)
+    ctx.progress->num_lto_objects++;
   return LDPS_OK;
 }
 
@@ -596,36 +609,22 @@ create_plugin_input_file(Context<E> &ctx, MappedFile *mf) {
   return file;
 }
 
+// Passes a given IR object to the LTO plugin and returns its symbol
+// table and string table.
 template <typename E>
-ObjectFile<E> *read_lto_object(Context<E> &ctx, MappedFile *mf) {
-  load_lto_plugin(ctx);
-
+static std::pair<std::vector<ElfSym<E>>, std::string>
+claim_file(Context<E> &ctx, ObjectFile<E> &obj) {
   // V0 API's claim_file is not thread-safe.
   static std::mutex mu;
   std::unique_lock lock(mu, std::defer_lock);
   if (!is_gcc_linker_api_v1)
     lock.lock();
 
-  if (ctx.arg.plugin.empty())
-    Fatal(ctx) << mf->name << ": don't know how to handle this LTO object file "
-               << "because no -plugin option was given. Please make sure you "
-               << "added -flto not only for creating object files but also for "
-               << "creating the final executable.";
-
-  // Create mold's object instance
-  ObjectFile<E> *obj = new ObjectFile<E>;
-  ctx.obj_pool.emplace_back(obj);
-
-  obj->filename = mf->name;
-  obj->symbols.push_back(new Symbol<E>);
-  obj->first_global = 1;
-  obj->is_lto_obj = true;
-  obj->mf = mf;
-  obj->archive_name = mf->parent ? mf->parent->name : "";
+  MappedFile *mf = obj.mf;
 
   // Create plugin's object instance
   PluginInputFile file = create_plugin_input_file(ctx, mf);
-  file.handle = (void *)obj;
+  file.handle = (void *)&obj;
 
   LOG << "read_lto_symbols: "<< mf->name << "\n";
 
@@ -652,34 +651,454 @@ ObjectFile<E> *read_lto_object(Context<E> &ctx, MappedFile *mf) {
   std::string strtab(strtab_size, '\0');
 
   // Initialize esyms
-  obj->lto_elf_syms.resize(plugin_symbols.size() + 1);
+  std::vector<ElfSym<E>> esyms(plugin_symbols.size() + 1);
   i64 strtab_offset = 1;
 
   for (i64 i = 0; i < plugin_symbols.size(); i++) {
     PluginSymbol &psym = plugin_symbols[i];
-    obj->lto_elf_syms[i + 1] = to_elf_sym<E>(psym);
-    obj->lto_elf_syms[i + 1].st_name = strtab_offset;
+    esyms[i + 1] = to_elf_sym<E>(psym);
+    esyms[i + 1].st_name = strtab_offset;
 
     i64 len = strlen(psym.name);
     memcpy(strtab.data() + strtab_offset, psym.name, len);
     strtab_offset += len + 1;
   }
 
-  obj->symbol_strtab = save_string(ctx, strtab);
+  plugin_symbols.clear();
+  return {std::move(esyms), std::move(strtab)};
+}
+
+// --lto-symbol-cache saves the symbol tables of IR objects to files so
+// that we don't need to call claim_file_hook() for IR objects that we
+// have seen before. Such objects are claimed in run_lto_plugin() once
+// we know that they are part of the link.
+//
+// A cache file consists of the following header, an array of ElfSym
+// and a string table. The file name is a hash of the IR object's
+// contents and the plugin's identity, as the symbol table depends on
+// both.
+struct LtoSymbolCacheHeader {
+  char magic[8];
+  u64 nsyms;
+  u64 strtab_size;
+};
+
+static constexpr char LTO_SYMBOL_CACHE_MAGIC[8] = {
+  'M', 'O', 'L', 'D', 'S', 'Y', 'M', '1',
+};
+
+template <typename E> static std::vector<ObjectFile<E> *> unclaimed_objects;
+static std::mutex unclaimed_objects_mu;
+
+template <typename E>
+static std::string get_symbol_cache_path(Context<E> &ctx, MappedFile *mf) {
+  static std::string plugin_id = [&] {
+    std::string id = std::string(E::name) + ":" + ctx.arg.plugin;
+    struct stat st;
+    if (stat(ctx.arg.plugin.c_str(), &st) == 0)
+      id += ":" + std::to_string(st.st_size) + ":" +
+            std::to_string(st.st_mtime);
+    return id;
+  }();
+
+  u8 digest[16];
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  blake3_hasher_update(&hasher, plugin_id.data(), plugin_id.size());
+  blake3_hasher_update(&hasher, mf->data, mf->size);
+  blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+
+  std::string path = ctx.arg.lto_symbol_cache + "/";
+  for (u8 c : digest) {
+    path += "0123456789abcdef"[c >> 4];
+    path += "0123456789abcdef"[c & 0xf];
+  }
+  return path;
+}
+
+template <typename E>
+static std::string
+serialize_symbol_table(std::span<ElfSym<E>> esyms, std::string_view strtab) {
+  LtoSymbolCacheHeader hdr;
+  memcpy(hdr.magic, LTO_SYMBOL_CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.nsyms = esyms.size();
+  hdr.strtab_size = strtab.size();
+
+  std::string buf;
+  buf.append((char *)&hdr, sizeof(hdr));
+  buf.append((char *)esyms.data(), esyms.size() * sizeof(ElfSym<E>));
+  buf.append(strtab);
+  return buf;
+}
+
+template <typename E>
+static bool deserialize_symbol_table(Context<E> &ctx, ObjectFile<E> &obj,
+                                     std::string_view buf) {
+  LtoSymbolCacheHeader hdr;
+  if (buf.size() < sizeof(hdr))
+    return false;
+  memcpy(&hdr, buf.data(), sizeof(hdr));
+
+  if (memcmp(hdr.magic, LTO_SYMBOL_CACHE_MAGIC, sizeof(hdr.magic)) ||
+      hdr.nsyms == 0 || hdr.strtab_size == 0 ||
+      buf.size() != sizeof(hdr) + hdr.nsyms * sizeof(ElfSym<E>) +
+                    hdr.strtab_size)
+    return false;
+
+  obj.lto_elf_syms.resize(hdr.nsyms);
+  memcpy(obj.lto_elf_syms.data(), buf.data() + sizeof(hdr),
+         hdr.nsyms * sizeof(ElfSym<E>));
+
+  std::string_view strtab = buf.substr(buf.size() - hdr.strtab_size);
+  if (strtab.back() != '\0')
+    return false;
+  for (ElfSym<E> &esym : obj.lto_elf_syms)
+    if (strtab.size() <= esym.st_name)
+      return false;
+
+  obj.symbol_strtab = save_string(ctx, std::string(strtab));
+  return true;
+}
+
+template <typename E>
+static bool read_symbol_cache(Context<E> &ctx, ObjectFile<E> &obj,
+                              const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+
+  std::string buf{std::istreambuf_iterator<char>(in), {}};
+  return deserialize_symbol_table(ctx, obj, buf);
+}
+
+template <typename E>
+static void write_symbol_cache(Context<E> &ctx, ObjectFile<E> &obj,
+                               const std::string &path) {
+  static std::once_flag flag;
+  std::call_once(flag, [&] {
+    std::error_code ec;
+    std::filesystem::create_directories(ctx.arg.lto_symbol_cache, ec);
+  });
+
+  // Write to a temporary file first so that other processes never see
+  // a partially-written cache file.
+  static std::atomic_int counter;
+  std::string tmp = path + "." + std::to_string(getpid()) + "." +
+                    std::to_string(counter++) + ".tmp";
+
+  std::string buf =
+    serialize_symbol_table<E>(obj.lto_elf_syms, obj.symbol_strtab);
+
+  std::ofstream out(tmp, std::ios::binary);
+  out.write(buf.data(), buf.size());
+  out.close();
+
+  // The cache is just an optimization, so we ignore errors.
+  if (!out || rename(tmp.c_str(), path.c_str()))
+    unlink(tmp.c_str());
+}
+
+// --lto-claim-helpers=N runs claim_file_hook() in N helper processes.
+// GCC's plugins that predate the linker API v1 are not thread-safe, so
+// we otherwise have to call claim_file_hook() for one IR object at a
+// time. Each helper is a copy of mold started with the same command
+// line plus `--:lto-claim-helper`. It loads its own instance of the
+// plugin, reads a file name, an offset and a size from stdin, and
+// writes back the symbol table in the same format as the symbol cache.
+//
+// The symbol tables are used only for symbol resolution. Live IR
+// objects are claimed by the plugin in this process in run_lto_plugin(),
+// just like IR objects whose symbol tables were read from the cache.
+struct LtoClaimHelper {
+  pid_t pid = -1;
+  int in = -1;
+  int out = -1;
+};
+
+static std::vector<LtoClaimHelper> claim_helpers;
+static std::vector<LtoClaimHelper *> idle_claim_helpers;
+static std::mutex claim_helpers_mu;
+static std::condition_variable claim_helpers_cv;
+
+static bool read_exact(int fd, void *buf, i64 size) {
+  for (i64 i = 0; i < size;) {
+    ssize_t n = read(fd, (char *)buf + i, size - i);
+    if (n <= 0)
+      return false;
+    i += n;
+  }
+  return true;
+}
+
+static bool write_exact(int fd, const void *buf, i64 size) {
+  for (i64 i = 0; i < size;) {
+    ssize_t n = write(fd, (char *)buf + i, size - i);
+    if (n <= 0)
+      return false;
+    i += n;
+  }
+  return true;
+}
+
+template <typename E>
+static bool use_claim_helpers(Context<E> &ctx) {
+  return ctx.arg.lto_claim_helpers > 0 && !ctx.arg.lto_claim_helper &&
+         !is_gcc_linker_api_v1 && !is_llvm(ctx);
+}
+
+template <typename E>
+static void spawn_claim_helpers(Context<E> &ctx) {
+  std::vector<const char *> args;
+  for (std::string_view arg : ctx.cmdline_args)
+    args.push_back(save_string(ctx, std::string(arg)).data());
+  args.push_back("--:lto-claim-helper");
+  args.push_back(nullptr);
+
+  std::string self = get_self_path();
+  claim_helpers.resize(ctx.arg.lto_claim_helpers);
+
+  for (LtoClaimHelper &helper : claim_helpers) {
+    // All pipe ends must be close-on-exec. Otherwise, a helper would
+    // inherit the other helpers' stdin and they would never see EOF.
+    // macOS doesn't have pipe2(2).
+    int req[2];
+    int resp[2];
+#ifdef __APPLE__
+    if (pipe(req) == -1 || pipe(resp) == -1)
+      Fatal(ctx) << "pipe failed: " << errno_string();
+    for (int fd : {req[0], req[1], resp[0], resp[1]})
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+#else
+    if (pipe2(req, O_CLOEXEC) == -1 || pipe2(resp, O_CLOEXEC) == -1)
+      Fatal(ctx) << "pipe2 failed: " << errno_string();
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, req[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, resp[1], STDOUT_FILENO);
+
+    if (int err = posix_spawn(&helper.pid, self.c_str(), &actions, nullptr,
+                              (char * const *)args.data(), environ))
+      Fatal(ctx) << "--lto-claim-helpers: cannot start a helper process: "
+                 << strerror(err);
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(req[0]);
+    close(resp[1]);
+    helper.in = req[1];
+    helper.out = resp[0];
+    idle_claim_helpers.push_back(&helper);
+  }
+}
+
+// Asks one of the helper processes to read the symbol table of a given
+// IR object.
+template <typename E>
+static void claim_file_in_helper(Context<E> &ctx, ObjectFile<E> &obj) {
+  static std::once_flag flag;
+  std::call_once(flag, [&] { spawn_claim_helpers(ctx); });
+
+  LtoClaimHelper *helper;
+  {
+    std::unique_lock lock(claim_helpers_mu);
+    claim_helpers_cv.wait(lock, [] { return !idle_claim_helpers.empty(); });
+    helper = idle_claim_helpers.back();
+    idle_claim_helpers.pop_back();
+  }
+
+  MappedFile *mf = obj.mf;
+  MappedFile *mf2 = mf->parent ? mf->parent : mf;
+  u64 req[] = {mf2->name.size(), (u64)mf->get_offset(), (u64)mf->size};
+  u64 len = 0;
+  std::string buf;
+
+  bool ok = write_exact(helper->in, req, sizeof(req)) &&
+            write_exact(helper->in, mf2->name.data(), mf2->name.size()) &&
+            read_exact(helper->out, &len, sizeof(len));
+
+  if (ok) {
+    buf.resize(len);
+    ok = read_exact(helper->out, buf.data(), len);
+  }
+
+  {
+    std::scoped_lock lock(claim_helpers_mu);
+    idle_claim_helpers.push_back(helper);
+  }
+  claim_helpers_cv.notify_one();
+
+  if (!ok)
+    Fatal(ctx) << mf->name << ": LTO claim helper process exited unexpectedly";
+  if (!deserialize_symbol_table(ctx, obj, buf))
+    Fatal(ctx) << mf->name << ": corrupted response from LTO claim helper";
+}
+
+template <typename E>
+static void stop_claim_helpers(Context<E> &ctx) {
+  for (LtoClaimHelper &helper : claim_helpers) {
+    close(helper.in);
+    close(helper.out);
+    waitpid(helper.pid, nullptr, 0);
+  }
+  claim_helpers.clear();
+  idle_claim_helpers.clear();
+}
+
+// The main loop of a helper process. This function does not return.
+template <typename E>
+void run_lto_claim_helper(Context<E> &ctx) {
+  // Anything the plugin prints must not get mixed into responses.
+  int out = dup(STDOUT_FILENO);
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  load_lto_plugin(ctx);
+
+  for (;;) {
+    u64 req[3];
+    if (!read_exact(STDIN_FILENO, req, sizeof(req)))
+      _exit(0);
+
+    std::string path(req[0], '\0');
+    if (!read_exact(STDIN_FILENO, path.data(), path.size()))
+      _exit(1);
+
+    MappedFile *mf = must_open_file(ctx, path);
+    if (req[1] != 0 || req[2] != mf->size)
+      mf = mf->slice(ctx, path, req[1], req[2]);
+
+    ObjectFile<E> *obj = new ObjectFile<E>;
+    ctx.obj_pool.emplace_back(obj);
+    obj->filename = mf->name;
+    obj->is_lto_obj = true;
+    obj->mf = mf;
+
+    auto [esyms, strtab] = claim_file(ctx, *obj);
+    std::string buf = serialize_symbol_table<E>(esyms, strtab);
+    u64 len = buf.size();
+
+    if (!write_exact(out, &len, sizeof(len)) ||
+        !write_exact(out, buf.data(), buf.size()))
+      _exit(1);
+  }
+}
+
+template <typename E>
+ObjectFile<E> *read_lto_object(Context<E> &ctx, MappedFile *mf) {
+  load_lto_plugin(ctx);
+
+  if (ctx.arg.plugin.empty())
+    Fatal(ctx) << mf->name << ": don't know how to handle this LTO object file "
+               << "because no -plugin option was given. Please make sure you "
+               << "added -flto not only for creating object files but also for "
+               << "creating the final executable.";
+
+  // Create mold's object instance
+  ObjectFile<E> *obj = new ObjectFile<E>;
+  ctx.obj_pool.emplace_back(obj);
+
+  obj->filename = mf->name;
+  obj->symbols.push_back(new Symbol<E>);
+  obj->first_global = 1;
+  obj->is_lto_obj = true;
+  obj->mf = mf;
+  obj->archive_name = mf->parent ? mf->parent->name : "";
+
+  std::string cache_path;
+  if (!ctx.arg.lto_symbol_cache.empty())
+    cache_path = get_symbol_cache_path(ctx, mf);
+
+  if (!cache_path.empty() && read_symbol_cache(ctx, *obj, cache_path)) {
+    std::scoped_lock lock(unclaimed_objects_mu);
+    unclaimed_objects<E>.push_back(obj);
+  } else if (use_claim_helpers(ctx)) {
+    claim_file_in_helper(ctx, *obj);
+
+    if (!cache_path.empty())
+      write_symbol_cache(ctx, *obj, cache_path);
+
+    std::scoped_lock lock(unclaimed_objects_mu);
+    unclaimed_objects<E>.push_back(obj);
+  } else {
+    std::string strtab;
+    std::tie(obj->lto_elf_syms, strtab) = claim_file(ctx, *obj);
+    obj->symbol_strtab = save_string(ctx, strtab);
+
+    if (!cache_path.empty())
+      write_symbol_cache(ctx, *obj, cache_path);
+  }
+
   obj->elf_syms = obj->lto_elf_syms;
   obj->initialize_symbols(ctx);
-  plugin_symbols.clear();
   return obj;
 }
 
+// Passes live IR objects whose symbol tables were read from the cache
+// or by helper processes to the plugin. Returns the IR objects that are
+// never claimed.
+template <typename E>
+static std::unordered_set<ObjectFile<E> *>
+claim_cached_objects(Context<E> &ctx) {
+  Timer t(ctx, "claim_cached_objects");
+
+  std::vector<ObjectFile<E> *> &objs = unclaimed_objects<E>;
+  sort(objs, [](ObjectFile<E> *a, ObjectFile<E> *b) {
+    return a->priority < b->priority;
+  });
+
+  std::unordered_set<ObjectFile<E> *> unclaimed;
+
+  for (ObjectFile<E> *file : objs) {
+    if (!file->is_alive) {
+      unclaimed.insert(file);
+      continue;
+    }
+
+    // The plugin must return the same symbol table as before because
+    // we have already resolved symbols using it.
+    auto [esyms, strtab] = claim_file(ctx, *file);
+    if (esyms.size() != file->lto_elf_syms.size() ||
+        memcmp(esyms.data(), file->lto_elf_syms.data(),
+               esyms.size() * sizeof(ElfSym<E>)) ||
+        strtab != file->symbol_strtab) {
+      if (ctx.arg.lto_symbol_cache.empty())
+        Fatal(ctx) << *file << ": the LTO plugin returned an inconsistent"
+                   << " symbol table";
+      Fatal(ctx) << *file << ": stale entry in --lto-symbol-cache; "
+                 << "please remove " << ctx.arg.lto_symbol_cache;
+    }
+  }
+
+  objs.clear();
+  return unclaimed;
+}
+
 // Entry point
 template <typename E>
 std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &ctx) {
   Timer t(ctx, "run_lto_plugin");
   load_lto_plugin(ctx);
 
-  if (!ctx.arg.lto_pass2 && !supports_v3_api(ctx))
-    restart_process(ctx);
+  if (use_claim_helpers(ctx))
+    stop_claim_helpers(ctx);
+
+  std::unordered_set<ObjectFile<E> *> unclaimed = claim_cached_objects(ctx);
+
+  // With a pre-v3 plugin, we have to restart only if we have passed an
+  // IR object to claim_file_hook() and then decided not to link it. If
+  // all claimed IR objects are alive, which is the case if they are
+  // given directly on the command line and is likely if archive members
+  // are read lazily, the plugin already has an accurate view of the
+  // inputs.
+  if (!ctx.arg.lto_pass2 && !supports_v3_api(ctx)) {
+    bool has_dead_ir_file = false;
+    for (std::unique_ptr<ObjectFile<E>> &file : ctx.obj_pool)
+      if (file->is_lto_obj && !file->is_alive && !unclaimed.count(file.get()))
+        has_dead_ir_file = true;
+
+    if (has_dead_ir_file)
+      restart_process(ctx);
+  }
 
   assert(phase == 1);
   phase = 2;
@@ -733,6 +1152,102 @@ std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &ctx) {
   return lto_objects<E>;
 }
 
+// Runs a given command and returns its exit status.
+static int run_command(const std::vector<std::string> &args) {
+  std::vector<const char *> argv;
+  for (const std::string &arg : args)
+    argv.push_back(arg.c_str());
+  argv.push_back(nullptr);
+
+  pid_t pid;
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr,
+                   (char * const *)argv.data(), environ))
+    return -1;
+
+  int status;
+  if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status))
+    return -1;
+  return WEXITSTATUS(status);
+}
+
+// --thinlto-distributor=COMMAND lets an external command run ThinLTO
+// backend compilations, so that a build system can distribute them to
+// remote machines. This works in three steps:
+//
+//  1. We run ourselves with `--thinlto-index-only` to let the LLVM
+//     plugin write per-module summary index and import files. The plugin
+//     also writes the list of bitcode files that are part of the link.
+//
+//  2. For each bitcode file, we run `COMMAND <bitcode> <index> <output>`
+//     in parallel. COMMAND is expected to compile the bitcode file to a
+//     native object file at <output> using the given index, e.g. with
+//     `clang -c -fthinlto-index=<index> -x ir <bitcode> -o <output>`,
+//     either locally or remotely.
+//
+//  3. We then link the resulting native object files in place of the
+//     bitcode files without running the LTO plugin.
+template <typename E>
+void run_thinlto_distributor(Context<E> &ctx) {
+  Timer t(ctx, "run_thinlto_distributor");
+
+  if (ctx.arg.plugin.empty() || !is_llvm(ctx))
+    Fatal(ctx) << "--thinlto-distributor: LLVM's LTO plugin is required";
+
+  std::string dir = ctx.arg.output + ".thinlto.d";
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec)
+    Fatal(ctx) << "--thinlto-distributor: cannot create " << dir << ": "
+               << ec.message();
+
+  // Step 1: write index files
+  std::string list = dir + "/objects";
+  std::vector<std::string> args(ctx.cmdline_args.begin(),
+                                ctx.cmdline_args.end());
+  args[0] = get_self_path();
+  append(args, std::vector<std::string>{
+    "--thinlto-index-only=" + list, "--thinlto-emit-imports-files",
+    "-o", dir + "/index.out", "--no-fork", "--:thinlto-index-pass",
+  });
+
+  if (run_command(args) != 0)
+    Fatal(ctx) << "--thinlto-distributor: failed to write ThinLTO index files";
+
+  std::vector<std::string> modules;
+  std::ifstream in(list);
+  if (!in)
+    Fatal(ctx) << "--thinlto-distributor: cannot open " << list;
+  for (std::string line; std::getline(in, line);)
+    if (!line.empty())
+      modules.push_back(line);
+
+  // Step 2: run backend jobs
+  std::vector<std::string> outputs(modules.size());
+
+  tbb::parallel_for((i64)0, (i64)modules.size(), [&](i64 i) {
+    if (!std::filesystem::is_regular_file(modules[i]))
+      Fatal(ctx) << "--thinlto-distributor: " << modules[i]
+                 << ": bitcode files in archives are not supported";
+
+    outputs[i] = dir + "/" + std::to_string(i) + ".o";
+    std::string index = modules[i] + ".thinlto.bc";
+
+    std::vector<std::string> args = {
+      "/bin/sh", "-c", ctx.arg.thinlto_distributor + " \"$@\"", "sh",
+      modules[i], index, outputs[i],
+    };
+
+    if (run_command(args) != 0)
+      Fatal(ctx) << "--thinlto-distributor: backend job failed for "
+                 << modules[i];
+  });
+
+  // Step 3: remember the native object files. Bitcode files are
+  // replaced with them in read_input_files().
+  for (i64 i = 0; i < modules.size(); i++)
+    ctx.thinlto_native_objects[modules[i]] = outputs[i];
+}
+
 template <typename E>
 void lto_cleanup(Context<E> &ctx) {
   Timer t(ctx, "lto_cleanup");
@@ -743,6 +1258,8 @@ void lto_cleanup(Context<E> &ctx) {
 using E = MOLD_TARGET;
 
 template ObjectFile<E> *read_lto_object(Context<E> &, MappedFile *);
+template void run_lto_claim_helper(Context<E> &);
+template void run_thinlto_distributor(Context<E> &);
 template std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &);
 template void lto_cleanup(Context<E> &);
 
@@ -13,6 +13,16 @@ std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &ctx) {
   return {};
 }
 
+template <typename E>
+void run_lto_claim_helper(Context<E> &ctx) {
+  Fatal(ctx) << "LTO is not supported on Windows";
+}
+
+template <typename E>
+void run_thinlto_distributor(Context<E> &ctx) {
+  Fatal(ctx) << "LTO is not supported on Windows";
+}
+
 template <typename E>
 void lto_cleanup(Context<E> &ctx) {}
 
@@ -20,6 +30,8 @@ using E = MOLD_TARGET;
 
 template ObjectFile<E> *read_lto_object(Context<E> &, MappedFile *);
 template std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &);
+template void run_lto_claim_helper(Context<E> &);
+template void run_thinlto_distributor(Context<E> &);
 template void lto_cleanup(Context<E> &);
 
 } // namespace mold
@@ -2,6 +2,7 @@
 #include "../lib/archive-file.h"
 
 #include <cstring>
+#include <filesystem>
 #include <functional>
 #include <iomanip>
 #include <map>
@@ -10,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #include <unordered_set>
 
@@ -20,7 +22,7 @@
 # include <unistd.h>
 #endif
 
-#ifdef MOLD_X86_64
+#if defined(MOLD_X86_64) && !defined(MOLD_NO_MAIN)
 int main(int argc, char **argv) {
   mold::set_mimalloc_options();
   return mold::mold_main<mold::X86_64>(argc, argv);
@@ -39,25 +41,45 @@ check_file_compatibility(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
 }
 
 template <typename E>
-static ObjectFile<E> *new_object_file(Context<E> &ctx, ReaderContext &rctx,
-                                      MappedFile *mf, std::string archive_name) {
+static ObjectFile<E> *
+new_object_file(Context<E> &ctx, tbb::task_group &tg, MappedFile *mf,
+                std::string archive_name, bool in_lib, i64 priority) {
   static Counter count("parsed_objs");
   count++;
 
-  check_file_compatibility(ctx, rctx, mf);
-
-  bool in_lib = rctx.in_lib || (!archive_name.empty() && !rctx.whole_archive);
-
   ObjectFile<E> *file = new ObjectFile<E>(ctx, mf, archive_name, in_lib);
   ctx.obj_pool.emplace_back(file);
-  file->priority = ctx.file_priority++;
+  file->priority = priority;
+
+  tg.run([file, &ctx] {
+    hash_input_file(ctx, file);
+
+    if (ctx.arg.input_stats.empty()) {
+      file->parse(ctx);
+    } else {
+      i64 start = now_nsec();
+      file->parse(ctx);
+      file->parse_nsec = now_nsec() - start;
+    }
+
+    if (ctx.progress)
+      ctx.progress->num_files++;
+  });
 
-  rctx.tg->run([file, &ctx] { file->parse(ctx); });
   if (ctx.arg.trace)
     Out(ctx) << "trace: " << *file;
   return file;
 }
 
+template <typename E>
+static ObjectFile<E> *new_object_file(Context<E> &ctx, ReaderContext &rctx,
+                                      MappedFile *mf, std::string archive_name) {
+  check_file_compatibility(ctx, rctx, mf);
+  bool in_lib = rctx.in_lib || (!archive_name.empty() && !rctx.whole_archive);
+  return new_object_file(ctx, *rctx.tg, mf, archive_name, in_lib,
+                         ctx.file_priority++);
+}
+
 template <typename E>
 static ObjectFile<E> *new_lto_obj(Context<E> &ctx, ReaderContext &rctx,
                                   MappedFile *mf, std::string archive_name) {
@@ -67,7 +89,20 @@ static ObjectFile<E> *new_lto_obj(Context<E> &ctx, ReaderContext &rctx,
   if (ctx.arg.ignore_ir_file.count(mf->get_identifier()))
     return nullptr;
 
+  // With --thinlto-distributor, a bitcode file is replaced with a native
+  // object file compiled by the distributor command.
+  if (!ctx.arg.thinlto_distributor.empty() && !ctx.arg.thinlto_index_pass) {
+    auto it = ctx.thinlto_native_objects.find(mf->name);
+    if (it == ctx.thinlto_native_objects.end())
+      return nullptr;
+    return new_object_file(ctx, rctx, must_open_file(ctx, it->second),
+                           archive_name);
+  }
+
   ObjectFile<E> *file = read_lto_object(ctx, mf);
+  hash_input_file(ctx, file);
+  if (ctx.progress)
+    ctx.progress->num_files++;
   file->priority = ctx.file_priority++;
   file->archive_name = archive_name;
   file->is_in_lib = rctx.in_lib || (!archive_name.empty() && !rctx.whole_archive);
@@ -87,15 +122,134 @@ new_shared_file(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
   file->priority = ctx.file_priority++;
   file->is_alive = !rctx.as_needed;
 
-  rctx.tg->run([file, &ctx] { file->parse(ctx); });
+  rctx.tg->run([file, &ctx] {
+    hash_input_file(ctx, file);
+    file->parse(ctx);
+    if (ctx.progress)
+      ctx.progress->num_files++;
+  });
   if (ctx.arg.trace)
     Out(ctx) << "trace: " << *file;
   return file;
 }
 
+// Detecting the file type of an archive member touches its first page,
+// which costs a major page fault if the page cache is cold, so we do
+// that for all members in parallel instead of one at a time.
+template <typename E>
+static std::vector<FileType>
+get_member_types(Context<E> &ctx, std::span<MappedFile *> members,
+                 bool prefetch) {
+  std::vector<FileType> types(members.size());
+  tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
+    if (ctx.arg.huge_page_inputs)
+      members[i]->use_huge_pages();
+    if (prefetch)
+      members[i]->prefetch();
+    types[i] = get_file_type(ctx, members[i]);
+  });
+  return types;
+}
+
+// With --lazy-archive-members, we don't parse archive members when
+// reading an archive. Instead, we register them to the lookup table
+// keyed by the symbol names in the archive symbol table, so that they
+// can be parsed later only if they are referenced.
+//
+// Returns false if the archive doesn't have a symbol table.
+template <typename E>
+static bool
+defer_archive_members(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
+  std::unordered_map<u64, std::vector<std::string_view>> names;
+  for (auto [name, offset] : read_archive_symtab(ctx, mf))
+    names[offset].push_back(name);
+
+  if (names.empty())
+    return false;
+
+  // Members of a thin archive are opened only when they are loaded, so
+  // that we don't touch files that are not needed for the link.
+  if (mf->get_contents().starts_with("!<thin>\n")) {
+    for (auto &[path, offset] : read_thin_archive_paths(ctx, mf)) {
+      auto it = names.find(offset);
+      if (it == names.end())
+        continue;
+
+      LazyArchiveMember *m = new LazyArchiveMember;
+      ctx.lazy_members.emplace_back(m);
+      m->path = path;
+      m->thin_parent = mf;
+      m->rctx = rctx;
+      m->rctx.tg = nullptr;
+      m->archive_name = mf->name;
+      m->priority = ctx.file_priority++;
+
+      for (std::string_view name : it->second)
+        ctx.lazy_member_map[name].push_back(m);
+    }
+    return true;
+  }
+
+  std::vector<MappedFile *> children = read_archive_members(ctx, mf);
+  std::vector<FileType> types = get_member_types(ctx, children, false);
+
+  for (i64 i = 0; i < children.size(); i++) {
+    MappedFile *child = children[i];
+
+    switch (types[i]) {
+    case FileType::ELF_OBJ: {
+      // A member not listed in the symbol table can never be pulled
+      // out of the archive, so we don't even keep it.
+      auto it = names.find(child->data - mf->data - sizeof(ArHdr));
+      if (it == names.end())
+        break;
+
+      check_file_compatibility(ctx, rctx, child);
+
+      LazyArchiveMember *m = new LazyArchiveMember;
+      ctx.lazy_members.emplace_back(m);
+      m->mf = child;
+      m->archive_name = mf->name;
+      m->priority = ctx.file_priority++;
+
+      for (std::string_view name : it->second)
+        ctx.lazy_member_map[name].push_back(m);
+      break;
+    }
+    case FileType::GCC_LTO_OBJ:
+    case FileType::LLVM_BITCODE:
+      if (ObjectFile<E> *file = new_lto_obj(ctx, rctx, child, mf->name))
+        ctx.objs.push_back(file);
+      break;
+    case FileType::ELF_DSO:
+      Warn(ctx) << mf->name << "(" << child->name
+                << "): shared object file in an archive is ignored";
+      break;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
 template <typename E>
 void read_file(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
-  switch (get_file_type(ctx, mf)) {
+  FileType type = get_file_type(ctx, mf);
+
+  if ((type == FileType::AR || type == FileType::THIN_AR) &&
+      ctx.arg.lazy_archive_members && !rctx.whole_archive &&
+      defer_archive_members(ctx, rctx, mf))
+    return;
+
+  // We are going to read the entire file, so start reading it now.
+  // Members of a thin archive are separate files, so we prefetch them
+  // individually below.
+  if (ctx.arg.huge_page_inputs)
+    mf->use_huge_pages();
+  if (ctx.arg.prefetch_inputs)
+    mf->prefetch();
+
+  switch (type) {
   case FileType::ELF_OBJ:
     ctx.objs.push_back(new_object_file(ctx, rctx, mf, ""));
     return;
@@ -103,9 +257,15 @@ void read_file(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
     ctx.dsos.push_back(new_shared_file(ctx, rctx, mf));
     return;
   case FileType::AR:
-  case FileType::THIN_AR:
-    for (MappedFile *child : read_archive_members(ctx, mf)) {
-      switch (get_file_type(ctx, child)) {
+  case FileType::THIN_AR: {
+    std::vector<MappedFile *> children = read_archive_members(ctx, mf);
+    std::vector<FileType> types =
+      get_member_types(ctx, children, ctx.arg.prefetch_inputs);
+
+    for (i64 i = 0; i < children.size(); i++) {
+      MappedFile *child = children[i];
+
+      switch (types[i]) {
       case FileType::ELF_OBJ:
         ctx.objs.push_back(new_object_file(ctx, rctx, child, mf->name));
         break;
@@ -123,6 +283,7 @@ void read_file(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf) {
       }
     }
     return;
+  }
   case FileType::TEXT:
     Script(ctx, rctx, mf).parse_linker_script();
     return;
@@ -171,8 +332,65 @@ detect_machine_type(Context<E> &ctx, std::vector<std::string> args) {
   Fatal(ctx) << "-m option is missing";
 }
 
+// Searching libraries tries to open lib<name>.so and lib<name>.a in
+// each library directory, which results in many failing open(2) calls
+// for a command line with many -L and -l options. That is slow on
+// network file systems. We instead read each library directory once to
+// answer most of the lookups from memory.
+template <typename E>
+static void list_library_dirs(Context<E> &ctx) {
+  Timer t(ctx, "list_library_dirs");
+
+  std::vector<std::string_view> dirs;
+  for (std::string_view dir : ctx.arg.library_paths)
+    if (!ctx.library_dir_entries.contains(dir))
+      dirs.push_back(dir);
+
+  std::vector<std::optional<std::unordered_set<std::string>>>
+    entries(dirs.size());
+
+  tbb::parallel_for((i64)0, (i64)dirs.size(), [&](i64 i) {
+    std::string path(dirs[i]);
+    if (path.starts_with('/') && !ctx.arg.chroot.empty())
+      path = ctx.arg.chroot + "/" + path_clean(path);
+
+    std::error_code ec;
+    std::unordered_set<std::string> names;
+    for (std::filesystem::directory_iterator it(path, ec), end;
+         !ec && it != end; it.increment(ec))
+      names.insert(it->path().filename().string());
+    if (!ec)
+      entries[i] = std::move(names);
+  });
+
+  // A directory we failed to read is not cached.
+  for (i64 i = 0; i < dirs.size(); i++)
+    if (entries[i])
+      ctx.library_dir_entries[dirs[i]] = std::move(*entries[i]);
+}
+
+// Returns false if a given file is known not to exist.
+template <typename E>
+static bool may_exist_in_library_dir(Context<E> &ctx, std::string_view path) {
+  // Files given to link_in_memory() don't exist in the filesystem.
+  if (ctx.memory_link && ctx.memory_link->inputs.contains(std::string(path)))
+    return true;
+
+  size_t pos = path.find_last_of('/');
+  if (pos == path.npos)
+    return true;
+
+  auto it = ctx.library_dir_entries.find(path.substr(0, pos));
+  if (it == ctx.library_dir_entries.end())
+    return true;
+  return it->second.contains(std::string(path.substr(pos + 1)));
+}
+
 template <typename E>
 MappedFile *open_library(Context<E> &ctx, ReaderContext &rctx, std::string path) {
+  if (!may_exist_in_library_dir(ctx, path))
+    return nullptr;
+
   MappedFile *mf = open_file(ctx, path);
   if (!mf)
     return nullptr;
@@ -208,6 +426,237 @@ MappedFile *find_library(Context<E> &ctx, ReaderContext &rctx, std::string name)
   Fatal(ctx) << "library not found: " << name;
 }
 
+// Opening input files and searching library directories for -l options
+// involve many system calls, which take a long time for a command line
+// with tens of thousands of inputs if done one by one. This function opens
+// files given on the command line in parallel beforehand, so that
+// read_input_files() can start parsing files as soon as possible.
+//
+// Library search is done quietly. If we cannot find a library or we have
+// to skip an incompatible file, we leave it to find_library() so that it
+// reports errors and warnings in the command line order. The result of a
+// search is final because the library paths don't change after command
+// line parsing; we don't support SEARCH_DIR in linker scripts.
+template <typename E>
+static std::unordered_map<std::string, MappedFile *>
+open_input_files(Context<E> &ctx, std::span<std::string> args) {
+  Timer t(ctx, "open_input_files");
+
+  struct Input {
+    std::string arg;
+    bool static_;
+    bool incompatible = false;
+    MappedFile *mf = nullptr;
+  };
+
+  std::vector<Input> inputs;
+  std::unordered_set<std::string_view> seen;
+  std::vector<bool> stack;
+  bool static_ = false;
+
+  for (std::string_view arg : args) {
+    if (arg == "--Bstatic")
+      static_ = true;
+    else if (arg == "--Bdynamic")
+      static_ = false;
+    else if (arg == "--push-state")
+      stack.push_back(static_);
+    else if (arg == "--pop-state" && !stack.empty())
+      static_ = stack.back(), stack.pop_back();
+    else if (!arg.starts_with('-') || arg.starts_with("-l"))
+      if (seen.insert(arg).second)
+        inputs.push_back({std::string(arg), static_});
+  }
+
+  auto open_lib = [&](Input &in, ReaderContext &rctx, std::string path) {
+    if (!may_exist_in_library_dir(ctx, path))
+      return false;
+    MappedFile *mf = open_file(ctx, path);
+    if (!mf)
+      return false;
+    std::string_view target = get_machine_type(ctx, rctx, mf);
+    if (!target.empty() && target != E::name)
+      in.incompatible = true;
+    else
+      in.mf = mf;
+    return true;
+  };
+
+  auto find_lib = [&](Input &in) {
+    ReaderContext rctx;
+    rctx.static_ = in.static_;
+    std::string name = in.arg.substr(2);
+
+    for (std::string_view dir : ctx.arg.library_paths) {
+      if (name.starts_with(':')) {
+        if (open_lib(in, rctx, std::string(dir) + "/" + name.substr(1)))
+          return;
+      } else {
+        std::string stem = std::string(dir) + "/lib" + name;
+        if (!rctx.static_ && open_lib(in, rctx, stem + ".so"))
+          return;
+        if (open_lib(in, rctx, stem + ".a"))
+          return;
+      }
+    }
+  };
+
+  // We also detect the type of each file here even though we don't use
+  // the result, so that its first page is faulted in in parallel rather
+  // than when read_input_files() reaches the file.
+  tbb::parallel_for_each(inputs, [&](Input &in) {
+    if (in.arg.starts_with("-l")) {
+      find_lib(in);
+    } else {
+      in.mf = open_file(ctx, in.arg);
+      if (in.mf)
+        get_file_type(ctx, in.mf);
+    }
+  });
+
+  std::unordered_map<std::string, MappedFile *> map;
+  for (Input &in : inputs)
+    if (in.mf && !in.incompatible)
+      map[in.arg] = in.mf;
+  return map;
+}
+
+// Parse archive members deferred by --lazy-archive-members. We parse
+// members that define symbols referenced by already-parsed files, and
+// repeat it until no more members are pulled in. The resulting set of
+// files is a superset of the one that mark_live_objects() would keep,
+// so it doesn't change the result of symbol resolution.
+template <typename E>
+static void load_lazy_archive_members(Context<E> &ctx, tbb::task_group &tg) {
+  Timer t(ctx, "load_lazy_archive_members");
+
+  std::vector<InputFile<E> *> added;
+  std::vector<LazyArchiveMember *> pending;
+  bool found_lto = false;
+
+  auto load = [&](LazyArchiveMember *m) {
+    if (!m->is_loaded) {
+      m->is_loaded = true;
+      pending.push_back(m);
+    }
+  };
+
+  // Thin archive members are opened and checked here in parallel because
+  // opening tens of thousands of files one by one can take seconds on a
+  // network filesystem.
+  auto flush = [&] {
+    std::vector<FileType> types(pending.size(), FileType::ELF_OBJ);
+
+    tbb::parallel_for((i64)0, (i64)pending.size(), [&](i64 i) {
+      LazyArchiveMember *m = pending[i];
+      if (m->mf)
+        return;
+
+      m->mf = must_open_file(ctx, m->path);
+      m->mf->thin_parent = m->thin_parent;
+      types[i] = get_file_type(ctx, m->mf);
+      if (types[i] == FileType::ELF_OBJ)
+        check_file_compatibility(ctx, m->rctx, m->mf);
+    });
+
+    for (i64 i = 0; i < pending.size(); i++) {
+      LazyArchiveMember *m = pending[i];
+
+      switch (types[i]) {
+      case FileType::ELF_OBJ: {
+        ObjectFile<E> *file =
+          new_object_file(ctx, tg, m->mf, m->archive_name, true, m->priority);
+        ctx.objs.push_back(file);
+        added.push_back(file);
+        break;
+      }
+      case FileType::GCC_LTO_OBJ:
+      case FileType::LLVM_BITCODE: {
+        ReaderContext rctx = m->rctx;
+        rctx.tg = &tg;
+        ObjectFile<E> *file = new_lto_obj(ctx, rctx, m->mf, m->archive_name);
+        if (file) {
+          file->priority = m->priority;
+          ctx.objs.push_back(file);
+          added.push_back(file);
+          found_lto = true;
+        }
+        break;
+      }
+      case FileType::ELF_DSO:
+        Warn(ctx) << m->archive_name << "(" << m->mf->name
+                  << "): shared object file in an archive is ignored";
+        break;
+      default:
+        break;
+      }
+    }
+    pending.clear();
+  };
+
+  auto load_by_name = [&](std::string_view name) {
+    if (auto it = ctx.lazy_member_map.find(name);
+        it != ctx.lazy_member_map.end())
+      for (LazyArchiveMember *m : it->second)
+        load(m);
+  };
+
+  // Compiled LTO objects may refer to library functions that don't
+  // appear in IR symbol tables, and --undefined-glob may match any
+  // defined symbol. In these cases, we need all members.
+  bool load_all = !ctx.arg.undefined_glob.empty() ||
+                  std::any_of(ctx.objs.begin(), ctx.objs.end(),
+                              [](ObjectFile<E> *file) {
+    return file->is_lto_obj || file->is_gcc_offload_obj;
+  });
+
+  if (load_all) {
+    for (std::unique_ptr<LazyArchiveMember> &m : ctx.lazy_members)
+      load(m.get());
+    flush();
+    tg.wait();
+  } else {
+    for (Symbol<E> *sym : ctx.arg.undefined)
+      load_by_name(sym->name());
+    for (Symbol<E> *sym : ctx.arg.require_defined)
+      load_by_name(sym->name());
+
+    std::vector<InputFile<E> *> files;
+    append(files, ctx.objs);
+    append(files, ctx.dsos);
+
+    while (!files.empty()) {
+      for (InputFile<E> *file : files) {
+        for (i64 i = file->first_global; i < file->elf_syms.size(); i++) {
+          const ElfSym<E> &esym = file->elf_syms[i];
+          if (esym.is_undef() || esym.is_common())
+            load_by_name(file->symbols[i]->name());
+        }
+      }
+
+      flush();
+
+      // A thin archive member may turn out to be an LTO object only after
+      // it is opened. We need all members in that case as well.
+      if (found_lto) {
+        for (std::unique_ptr<LazyArchiveMember> &m : ctx.lazy_members)
+          load(m.get());
+        flush();
+        found_lto = false;
+      }
+
+      tg.wait();
+      files = std::move(added);
+      added.clear();
+    }
+  }
+
+  // Members were appended out of order. Restore the command line order.
+  sort(ctx.objs, [](ObjectFile<E> *a, ObjectFile<E> *b) {
+    return a->priority < b->priority;
+  });
+}
+
 template <typename E>
 static void read_input_files(Context<E> &ctx, std::span<std::string> args) {
   Timer t(ctx, "read_input_files");
@@ -219,6 +668,21 @@ static void read_input_files(Context<E> &ctx, std::span<std::string> args) {
   tbb::task_group tg;
   rctx.tg = &tg;
 
+  list_library_dirs(ctx);
+
+  std::unordered_map<std::string, MappedFile *> opened =
+    open_input_files(ctx, args);
+
+  // Each file opened in advance is used only for its first occurrence.
+  auto take = [&](std::string_view arg) -> MappedFile * {
+    auto it = opened.find(std::string(arg));
+    if (it == opened.end())
+      return nullptr;
+    MappedFile *mf = it->second;
+    opened.erase(it);
+    return mf;
+  };
+
   while (!args.empty()) {
     std::string_view arg = args[0];
     args = args.subspan(1);
@@ -247,23 +711,38 @@ static void read_input_files(Context<E> &ctx, std::span<std::string> args) {
       rctx = stack.back();
       stack.pop_back();
     } else if (arg.starts_with("-l")) {
+      MappedFile *mf = take(arg);
       arg = arg.substr(2);
       if (visited.contains(arg))
         continue;
       visited.insert(arg);
 
-      MappedFile *mf = find_library(ctx, rctx, std::string(arg));
+      if (!mf)
+        mf = find_library(ctx, rctx, std::string(arg));
       mf->given_fullpath = false;
       read_file(ctx, rctx, mf);
     } else {
-      read_file(ctx, rctx, must_open_file(ctx, std::string(arg)));
+      MappedFile *mf = take(arg);
+      if (!mf)
+        mf = must_open_file(ctx, std::string(arg));
+      read_file(ctx, rctx, mf);
     }
   }
 
-  if (ctx.objs.empty())
+  if (ctx.objs.empty() && ctx.lazy_members.empty())
     Fatal(ctx) << "no input files";
 
   tg.wait();
+
+  if (!ctx.lazy_members.empty())
+    load_lazy_archive_members(ctx, tg);
+}
+
+template <typename E>
+static void begin_phase(Context<E> &ctx, std::string_view name) {
+  sample_memory_usage(ctx, name);
+  if (ctx.progress)
+    ctx.progress->begin_phase(name);
 }
 
 template <typename E>
@@ -274,9 +753,65 @@ static bool has_lto_obj(Context<E> &ctx) {
   return false;
 }
 
+// The common exit path of a successful link. -r and --dry-run-layout
+// return early through this function too, so that the global lock,
+// which holds jobserver tokens, and the LTO plugin's temporary files
+// are always released.
+template <typename E>
+static int finish_link(Context<E> &ctx) {
+  if (ctx.progress)
+    ctx.progress->finish();
+
+  // Show stats numbers
+  if (ctx.arg.stats)
+    show_stats(ctx);
+
+  if (!ctx.arg.input_stats.empty())
+    write_input_stats(ctx);
+
+  if (ctx.arg.perf)
+    print_timer_records(ctx.timer_records);
+
+  if (!ctx.arg.perf_trace.empty())
+    write_perf_trace(ctx);
+
+  std::cout << std::flush;
+  std::cerr << std::flush;
+
+  // Handle --repro
+  if (ctx.arg.repro)
+    wait_repro_file(ctx);
+
+  // If we forked, the parent process exits here, so the build system
+  // considers linking done. Only work that doesn't affect output files
+  // may follow.
+  notify_parent();
+  release_global_lock();
+
+  // The LTO plugin removes its temporary files.
+  if (!ctx.arg.plugin.empty())
+    lto_cleanup(ctx);
+
+  if (ctx.arg.quick_exit)
+    _exit(0);
+
+  for (std::function<void()> &fn : ctx.on_exit)
+    fn();
+  ctx.checkpoint();
+  return 0;
+}
+
 template <typename E>
-int mold_main(int argc, char **argv) {
+int mold_main(int argc, char **argv, MemoryLink *memory_link) {
   Context<E> ctx;
+  ctx.memory_link = memory_link;
+
+  // Counters and timers are process-global. Don't carry them over from
+  // a previous link_in_memory() call.
+  if (ctx.memory_link) {
+    Counter::reset();
+    TimerRecord::enabled = false;
+  }
 
   // Process -run option first. process_run_subcommand() does not return.
   if (argc >= 2 && (argv[1] == "-run"sv || argv[1] == "--run"sv))
@@ -286,6 +821,14 @@ int mold_main(int argc, char **argv) {
   ctx.cmdline_args = expand_response_files(ctx, argv);
   std::vector<std::string> file_args = parse_nonpositional_args(ctx);
 
+  // If we are called as a library, we must return to the caller in the
+  // same process, and the output cache would read and write files.
+  if (ctx.memory_link) {
+    ctx.arg.fork = false;
+    ctx.arg.quick_exit = false;
+    ctx.arg.output_cache.clear();
+  }
+
   // If no -m option is given, deduce it from input files.
   if (ctx.arg.emulation.empty())
     ctx.arg.emulation = detect_machine_type(ctx, file_args);
@@ -295,24 +838,61 @@ int mold_main(int argc, char **argv) {
     if (ctx.arg.emulation != X86_64::name)
       return redo_main(ctx, argc, argv);
 
+  // Act as a helper process for --lto-claim-helpers. This needs to be
+  // done before -C because the parent has already changed directory.
+  if (ctx.arg.lto_claim_helper)
+    run_lto_claim_helper(ctx);
+
   Timer t_all(ctx, "all");
 
   install_signal_handler();
 
-  if (!ctx.arg.directory.empty())
+  // The index pass of --thinlto-distributor is spawned by a process that
+  // has already changed directory.
+  if (!ctx.arg.directory.empty() && !ctx.arg.thinlto_index_pass)
     if (chdir(ctx.arg.directory.c_str()) == -1)
       Fatal(ctx) << "chdir failed: " << ctx.arg.directory
                  << ": " << errno_string();
 
+  // Handle --output-cache. If the same link has been done before, we
+  // just copy the output files from the cache.
+  if (read_output_cache(ctx))
+    return 0;
+
+  // Run ThinLTO backends with an external command. This needs to be
+  // done before acquire_global_lock() because we run ourselves as a
+  // subprocess.
+  if (!ctx.arg.thinlto_distributor.empty() && !ctx.arg.thinlto_index_pass)
+    run_thinlto_distributor(ctx);
+
   // Fork a subprocess unless --no-fork is given.
   if (ctx.arg.fork)
     fork_child();
 
+  // Handle --progress-fd. This has to be done after fork_child()
+  // because the reporter runs in its own thread.
+  if (ctx.arg.progress_fd != -1)
+    ctx.progress.reset(new ProgressReporter<E>(ctx, ctx.arg.progress_fd));
+
+  begin_phase(ctx, "acquire_lock");
   acquire_global_lock();
 
+  // If we are invoked by a build system with a jobserver, we use only as
+  // many threads as job slots we have.
+  if (i64 n = acquire_job_tokens(ctx.arg.thread_count - 1); n != -1)
+    ctx.arg.thread_count = n + 1;
+
   tbb::global_control tbb_cont(tbb::global_control::max_allowed_parallelism,
                                ctx.arg.thread_count);
 
+  // Handle --perf=hw. This has to be done after fork_child() because
+  // hardware counters are per thread.
+  if (ctx.arg.perf_hw && !enable_hw_counters())
+    Warn(ctx) << "--perf=hw: hardware performance counters are not available";
+
+  if (ctx.arg.perf_threads)
+    enable_thread_utilization();
+
   // Handle --wrap options if any.
   for (std::string_view name : ctx.arg.wrap)
     get_symbol(ctx, name)->is_wrapped = true;
@@ -326,6 +906,7 @@ int mold_main(int argc, char **argv) {
     get_symbol(ctx, arg)->is_traced = true;
 
   // Parse input files
+  begin_phase(ctx, "read_input_files");
   read_input_files(ctx, file_args);
 
   // Uniquify shared object files by soname
@@ -338,9 +919,16 @@ int mold_main(int argc, char **argv) {
 
   Timer t_before_copy(ctx, "before_copy");
 
+  // Handle --lazy-dso-symbols
+  if (ctx.arg.lazy_dso_symbols)
+    intern_dso_symbols(ctx);
+
   // Apply -exclude-libs
   apply_exclude_libs(ctx);
 
+  // Handle --Bsymbolic-auto
+  read_interposed_symbols(ctx);
+
   // Create a dummy file containing linker-synthesized symbols.
   if (!ctx.arg.relocatable)
     create_internal_file(ctx);
@@ -348,18 +936,54 @@ int mold_main(int argc, char **argv) {
   // Resolve symbols by choosing the most appropriate file for each
   // symbol. This pass also removes redundant comdat sections (e.g.
   // duplicate inline functions).
+  begin_phase(ctx, "resolve_symbols");
   resolve_symbols(ctx);
 
+  if (ctx.progress)
+    tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+      if (file->is_alive)
+        ctx.progress->num_symbols += std::count_if(
+          file->get_global_syms().begin(), file->get_global_syms().end(),
+          [&](Symbol<E> *sym) { return sym->file == file; });
+    });
+
   // If there's an object file compiled with -flto, do link-time
   // optimization.
-  if (has_lto_obj(ctx))
+  if (has_lto_obj(ctx)) {
+    begin_phase(ctx, "lto");
     do_lto(ctx);
+  }
+
+  // Compute a build ID from the input files if --build-id=inputs. LTO
+  // may pull more archive members into the link, so this needs to be
+  // done after LTO.
+  compute_input_build_id(ctx);
+
+  begin_phase(ctx, "passes");
 
   // Now that we know which object files are to be included to the
-  // final output, we can remove unnecessary files.
+  // final output, we can remove unnecessary files. We also give the pages
+  // of unused archive members back to the kernel to reduce our RSS.
+  // The mappings stay valid because symbols may still refer to names in
+  // their string tables.
+  tbb::parallel_for_each(ctx.objs, [](ObjectFile<E> *file) {
+    if (!file->is_alive)
+      file->mf->release();
+  });
+
   std::erase_if(ctx.objs, [](InputFile<E> *file) { return !file->is_alive; });
   std::erase_if(ctx.dsos, [](InputFile<E> *file) { return !file->is_alive; });
 
+  // Archive members were only partially parsed. Finish parsing them
+  // now that we know which ones have been extracted.
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    if (file->is_in_lib && !file->is_preprocessed)
+      file->parse_sections(ctx);
+  });
+
+  // Symbol resolution and LTO leave a lot of freed memory behind.
+  release_free_memory();
+
   // Parse .eh_frame section contents.
   parse_eh_frame_sections(ctx);
 
@@ -371,7 +995,7 @@ int mold_main(int argc, char **argv) {
   // to a separate file.
   if (ctx.arg.relocatable) {
     combine_objects(ctx);
-    return 0;
+    return finish_link(ctx);
   }
 
   // Create .bss sections for common symbols.
@@ -386,9 +1010,9 @@ int mold_main(int argc, char **argv) {
   // Set is_imported and is_exported bits for each symbol.
   compute_import_export(ctx);
 
-  // Set "address-taken" bits for input sections.
-  if (ctx.arg.icf)
-    compute_address_significance(ctx);
+  // Both --gc-sections and --icf need the section reference graph.
+  if (ctx.arg.gc_sections && ctx.arg.icf)
+    build_section_refs(ctx);
 
   // Garbage-collect unreachable sections.
   if (ctx.arg.gc_sections)
@@ -398,22 +1022,29 @@ int mold_main(int argc, char **argv) {
   if (ctx.arg.icf)
     icf_sections(ctx);
 
-  // Create linker-synthesized sections such as .got or .plt.
-  create_synthetic_sections(ctx);
+  if (ctx.arg.gc_sections && ctx.arg.icf)
+    release_section_refs(ctx);
 
-  // Make sure that there's no duplicate symbol
-  if (!ctx.arg.allow_multiple_definition)
-    check_duplicate_symbols(ctx);
+  // Remove .debug_aranges tuples for sections removed above.
+  if (ctx.arg.prune_debug_aranges && !ctx.arg.relocatable &&
+      !ctx.arg.emit_relocs && (ctx.arg.gc_sections || ctx.arg.icf))
+    prune_debug_aranges(ctx);
 
-  if (!ctx.arg.allow_shlib_undefined)
-    check_shlib_undefined(ctx);
+  // Create linker-synthesized sections such as .got or .plt.
+  create_synthetic_sections(ctx);
 
-  // Warn if symbols with different types are defined under the same name.
-  check_symbol_types(ctx);
+  // Report duplicate symbols, unresolved symbols in shared libraries
+  // and symbols with different types defined under the same name.
+  check_symbols(ctx);
 
   if constexpr (is_ppc64v1<E>)
     ppc64v1_rewrite_opd(ctx);
 
+  // Create .debug_names. This may add new strings to .debug_str, so
+  // this needs to be done before .debug_str is added to the output.
+  if (ctx.debug_names)
+    ctx.debug_names->construct(ctx);
+
   // Bin input sections into output sections.
   create_output_sections(ctx);
 
@@ -480,6 +1111,15 @@ int mold_main(int argc, char **argv) {
   // Handle --shuffle-sections
   if (ctx.arg.shuffle_sections != SHUFFLE_SECTIONS_NONE)
     shuffle_sections(ctx);
+  else if (!ctx.arg.symbol_ordering_file.empty())
+    sort_sections_by_symbol_order(ctx);
+  else if (ctx.arg.call_graph_profile_sort)
+    sort_sections_by_call_graph_profile(ctx);
+
+  // Handle --hot-text-file and --hot-text-align
+  if (!ctx.arg.hot_text_file.empty() &&
+      ctx.arg.shuffle_sections == SHUFFLE_SECTIONS_NONE)
+    partition_hot_cold_text(ctx);
 
   // Copy string referred by .dynamic to .dynstr.
   for (SharedFile<E> *file : ctx.dsos)
@@ -503,6 +1143,10 @@ int mold_main(int argc, char **argv) {
   // Compute the is_weak bit for each imported symbol.
   compute_imported_symbol_weakness(ctx);
 
+  // Handle --group-relocated-data
+  if (ctx.arg.group_relocated_data)
+    group_relocated_data(ctx);
+
   // Sort sections by section attributes so that we'll have to
   // create as few segments as possible.
   sort_output_sections(ctx);
@@ -510,6 +1154,9 @@ int mold_main(int argc, char **argv) {
   if (!ctx.arg.separate_debug_file.empty())
     separate_debug_sections(ctx);
 
+  if (!ctx.arg.stable_layout.empty())
+    read_stable_layout(ctx);
+
   // Compute sizes of output sections while assigning offsets
   // within an output section to input sections.
   compute_section_sizes(ctx);
@@ -525,26 +1172,41 @@ int mold_main(int argc, char **argv) {
   // be added to .dynsym.
   sort_dynsyms(ctx);
 
-  // Print reports about undefined symbols, if needed.
-  if (ctx.arg.unresolved_symbols == UNRESOLVED_ERROR)
-    report_undef_errors(ctx);
+  // The following passes don't depend on each other, so we run them
+  // concurrently. Each of them is too small to keep all cores busy by
+  // itself, so this reduces the time that threads spend idle waiting
+  // for the end of a pass.
+  {
+    tbb::task_group tg;
+
+    // Print reports about undefined symbols, if needed.
+    if (ctx.arg.unresolved_symbols == UNRESOLVED_ERROR)
+      tg.run([&] { report_undef_errors(ctx); });
+
+    // Fill .gnu.version_d and .gnu.version_r section contents. They are
+    // constructed sequentially because both write to .gnu.version.
+    tg.run([&] {
+      if (ctx.verdef)
+        ctx.verdef->construct(ctx);
+      ctx.verneed->construct(ctx);
+    });
 
-  // Fill .gnu.version_d section contents.
-  if (ctx.verdef)
-    ctx.verdef->construct(ctx);
+    // Compute .symtab and .strtab sizes for each file.
+    if (!ctx.arg.strip_all)
+      tg.run([&] { create_output_symtab(ctx); });
 
-  // Fill .gnu.version_r section contents.
-  ctx.verneed->construct(ctx);
+    // .eh_frame is a special section from the linker's point of view,
+    // as its contents are parsed and reconstructed by the linker,
+    // unlike other sections that are regarded as opaque bytes.
+    // Here, we construct output .eh_frame contents.
+    tg.run([&] { ctx.eh_frame->construct(ctx); });
 
-  // Compute .symtab and .strtab sizes for each file.
-  if (!ctx.arg.strip_all)
-    create_output_symtab(ctx);
+    // Likewise, input .sframe sections are merged into a single table.
+    if (ctx.sframe)
+      tg.run([&] { ctx.sframe->construct(ctx); });
 
-  // .eh_frame is a special section from the linker's point of view,
-  // as its contents are parsed and reconstructed by the linker,
-  // unlike other sections that are regarded as opaque bytes.
-  // Here, we construct output .eh_frame contents.
-  ctx.eh_frame->construct(ctx);
+    tg.wait();
+  }
 
   // If --emit-relocs is given, we'll copy relocation sections from input
   // files to an output file.
@@ -581,9 +1243,16 @@ int mold_main(int argc, char **argv) {
   // Beyond this, you can assume that symbol addresses including their
   // GOT or PLT addresses have a correct final value.
 
-  // If --compress-debug-sections is given, compress .debug_* sections
-  // using zlib.
-  if (ctx.arg.compress_debug_sections != COMPRESS_NONE) {
+  // Handle --dry-run-layout. We don't create an output file.
+  if (!ctx.arg.dry_run_layout.empty()) {
+    write_dry_run_layout(ctx);
+    return finish_link(ctx);
+  }
+
+  // If --compress-debug-sections is given, compress .debug_* sections.
+  // --compress-sections compresses other non-allocated sections too.
+  if (ctx.arg.compress_debug_sections != COMPRESS_NONE ||
+      !ctx.arg.compress_sections.empty()) {
     compress_debug_sections(ctx);
     filesize = set_osec_offsets(ctx);
   }
@@ -592,26 +1261,48 @@ int mold_main(int argc, char **argv) {
 
   t_before_copy.stop();
 
+  if (!ctx.arg.emit_delta.empty())
+    open_delta_base(ctx);
+
   // Create an output file
   ctx.output_file = OutputFile<E>::open(ctx, ctx.arg.output, filesize, 0777);
   ctx.buf = ctx.output_file->buf;
 
   Timer t_copy(ctx, "copy");
+  begin_phase(ctx, "copy");
+
+  // With --async-debug-file, relocate debug sections for a separate
+  // debug info file concurrently with the main output file.
+  if (ctx.arg.async_debug_file && !ctx.arg.separate_debug_file.empty())
+    start_separate_debug_file(ctx);
+
+  // If possible, create .gdb_index from input sections while
+  // copy_chunks() is running.
+  if (ctx.gdb_index && ctx.arg.separate_debug_file.empty())
+    start_gdb_index(ctx);
 
   // Copy input sections to the output file and apply relocations.
   copy_chunks(ctx);
+  release_free_memory();
 
-  if constexpr (is_x86_64<E>)
-    if (ctx.arg.z_rewrite_endbr)
-      rewrite_endbr(ctx);
+  // With --dwp, package .dwo files referenced by skeleton compunits
+  // in the background.
+  if (!ctx.arg.dwp.empty() && ctx.arg.separate_debug_file.empty())
+    start_dwp(ctx);
+
+  // Start computing a build-id hash for the parts of the output that
+  // are not going to change anymore.
+  if (ctx.buildid)
+    start_build_id(ctx);
 
   // Dynamic linker works better with sorted .rela.dyn section,
   // so we sort them.
   ctx.reldyn->sort(ctx);
 
   // .gdb_index's contents cannot be constructed before applying
-  // relocations to other debug sections. We have relocated debug
-  // sections now, so write the .gdb_index section.
+  // relocations to other debug sections unless start_gdb_index()
+  // created it from input sections. We have relocated debug sections
+  // now, so write the .gdb_index section.
   if (ctx.gdb_index && ctx.arg.separate_debug_file.empty())
     write_gdb_index(ctx);
 
@@ -624,19 +1315,20 @@ int mold_main(int argc, char **argv) {
   if (!ctx.arg.separate_debug_file.empty())
     write_gnu_debuglink(ctx);
 
+  if (!ctx.arg.emit_delta.empty())
+    write_delta(ctx);
+
   t_copy.stop();
   ctx.checkpoint();
 
   // Close the output file. This is the end of the linker's main job.
+  begin_phase(ctx, "close");
   ctx.output_file->close(ctx);
 
   // Handle --dependency-file
   if (!ctx.arg.dependency_file.empty())
     write_dependency_file(ctx);
 
-  if (!ctx.arg.plugin.empty())
-    lto_cleanup(ctx);
-
   t_all.stop();
 
   if (ctx.arg.print_map)
@@ -645,30 +1337,37 @@ int mold_main(int argc, char **argv) {
   if (!ctx.arg.separate_debug_file.empty())
     write_separate_debug_file(ctx);
 
-  // Show stats numbers
-  if (ctx.arg.stats)
-    show_stats(ctx);
-
-  if (ctx.arg.perf)
-    print_timer_records(ctx.timer_records);
-
-  std::cout << std::flush;
-  std::cerr << std::flush;
-
-  notify_parent();
-  release_global_lock();
+  if (!ctx.arg.dwp.empty())
+    write_dwp(ctx);
 
-  if (ctx.arg.quick_exit)
-    _exit(0);
+  if (!ctx.arg.output_cache.empty())
+    write_output_cache(ctx);
 
-  for (std::function<void()> &fn : ctx.on_exit)
-    fn();
-  ctx.checkpoint();
-  return 0;
+  return finish_link(ctx);
 }
 
 using E = MOLD_TARGET;
 
-template int mold_main<E>(int, char **);
+template int mold_main<E>(int, char **, MemoryLink *);
+
+#ifdef MOLD_X86_64
+// Links in the same process as the caller. `args` are command line
+// arguments to mold without the program name. Input files whose
+// pathnames are keys of `link.inputs` are read from memory, and the
+// output file is stored to `link.output`. Since the thread pool and the
+// mapped input buffers are reused, this is much cheaper than spawning a
+// mold process for each of many small links.
+//
+// Note that errors are still fatal; they terminate the process as they
+// do in the command line tool.
+int link_in_memory(std::span<const std::string> args, MemoryLink &link) {
+  std::vector<char *> argv;
+  argv.push_back((char *)"mold");
+  for (const std::string &arg : args)
+    argv.push_back((char *)arg.c_str());
+  argv.push_back(nullptr);
+  return mold_main<X86_64>(argv.size() - 1, argv.data(), &link);
+}
+#endif
 
 } // namespace mold
@@ -1,114 +1,300 @@
+// This file implements -M, --Map, --dry-run-layout and --stable-layout.
+// A map file lists output sections, their input sections and the
+// symbols defined in them. If a --Map filename ends with ".json", it's
+// written in JSON so that other tools can read it without parsing text.
+//
+// Since a map file for a large program can be hundreds of megabytes,
+// each output section's part is formatted in parallel, and the result
+// is written out with a single write.
+
 #include "mold.h"
 
-#include <fstream>
-#include <iomanip>
-#include <ios>
 #include <sstream>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #include <unordered_map>
 
 namespace mold {
 
+// Symbols defined by an object file, indexed by section index and
+// sorted by address.
+template <typename E>
+struct MapFileInfo {
+  std::string name;
+  std::vector<std::vector<Symbol<E> *>> syms;
+};
+
 template <typename E>
-using Map =
-  tbb::concurrent_hash_map<InputSection<E> *, std::vector<Symbol<E> *>>;
+using Map = std::unordered_map<const InputFile<E> *, MapFileInfo<E>>;
 
 template <typename E>
 static Map<E> get_map(Context<E> &ctx) {
+  // Insert all keys first so that the map can be filled in parallel.
   Map<E> map;
+  for (ObjectFile<E> *file : ctx.objs)
+    map[file];
 
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    MapFileInfo<E> &info = map.find(file)->second;
+
+    std::ostringstream ss;
+    ss << *file;
+    info.name = ss.str();
+    info.syms.resize(file->sections.size());
+
     for (Symbol<E> *sym : file->symbols) {
       if (sym->file != file || sym->get_type() == STT_SECTION)
         continue;
 
       if (InputSection<E> *isec = sym->get_input_section()) {
         assert(file == &isec->file);
-        typename Map<E>::accessor acc;
-        map.insert(acc, {isec, {}});
-        acc->second.push_back(sym);
+        info.syms[isec->shndx].push_back(sym);
       }
     }
-  });
-
-  if (map.size() <= 1)
-    return map;
 
-  tbb::parallel_for(map.range(), [](const typename Map<E>::range_type &range) {
-    for (auto it = range.begin(); it != range.end(); it++) {
-      std::vector<Symbol<E> *> &vec = it->second;
+    for (std::vector<Symbol<E> *> &vec : info.syms)
       sort(vec, [](Symbol<E> *a, Symbol<E> *b) { return a->value < b->value; });
-    }
   });
   return map;
 }
 
+template <typename... Args>
+static void append(std::string &buf, const char *fmt, Args... args) {
+  char tmp[128];
+  i64 len = snprintf(tmp, sizeof(tmp), fmt, args...);
+  buf.append(tmp, std::min<i64>(len, sizeof(tmp) - 1));
+}
+
 template <typename E>
-void print_map(Context<E> &ctx) {
-  Timer t(ctx, "print_map");
+static std::string_view get_name(Symbol<E> &sym) {
+  return sym.demangle ? demangle(sym) : sym.name();
+}
+
+template <typename E>
+static std::string
+format_member(Context<E> &ctx, Map<E> &map, OutputSection<E> &osec,
+              InputSection<E> &mem, bool json) {
+  u64 addr = 0;
+  if (osec.shdr.sh_flags & SHF_ALLOC)
+    addr = osec.shdr.sh_addr + mem.offset;
 
-  std::ostream *out = &std::cout;
-  std::ofstream file;
+  std::span<Symbol<E> *> syms;
+  std::string filename;
 
-  if (!ctx.arg.Map.empty()) {
-    file.open(ctx.arg.Map);
-    if (!file.is_open())
-      Fatal(ctx) << "cannot open " << ctx.arg.Map << ": " << errno_string();
-    out = &file;
+  if (auto it = map.find(&mem.file); it != map.end()) {
+    filename = it->second.name;
+    if (mem.shndx < it->second.syms.size())
+      syms = it->second.syms[mem.shndx];
+  } else {
+    std::ostringstream ss;
+    ss << mem.file;
+    filename = ss.str();
   }
 
-  // Construct a section-to-symbol map.
-  Map<E> map = get_map(ctx);
+  std::string buf;
 
-  // Print a mapfile.
-  *out << "               VMA       Size Align Out     In      Symbol\n";
+  if (json) {
+    buf = "{\"file\":\"" + json_escape(filename) + "\",\"section\":\"" +
+          json_escape(mem.name()) + "\"";
+    append(buf, ",\"addr\":%llu,\"size\":%llu,\"align\":%llu,\"symbols\":[",
+           (unsigned long long)addr, (unsigned long long)mem.sh_size,
+           (unsigned long long)1 << mem.p2align);
 
-  for (Chunk<E> *chunk : ctx.chunks) {
-    *out << std::showbase
-         << std::setw(18) << std::hex << (u64)chunk->shdr.sh_addr << std::dec
-         << std::setw(11) << (u64)chunk->shdr.sh_size
-         << std::setw(6) << (u64)chunk->shdr.sh_addralign
-         << " " << chunk->name << "\n";
+    for (i64 i = 0; i < syms.size(); i++) {
+      buf += (i == 0) ? "{\"name\":\"" : ",{\"name\":\"";
+      buf += json_escape(get_name(*syms[i]));
+      append(buf, "\",\"addr\":%llu}",
+             (unsigned long long)syms[i]->get_addr(ctx));
+    }
+    buf += "]}";
+    return buf;
+  }
 
-    OutputSection<E> *osec = chunk->to_osec();
-    if (!osec)
-      continue;
+  append(buf, "%#18llx%11llu%6llu         ", (unsigned long long)addr,
+         (unsigned long long)mem.sh_size, (unsigned long long)1 << mem.p2align);
+  buf += filename + ":(" + std::string(mem.name()) + ")\n";
 
+  for (Symbol<E> *sym : syms) {
+    append(buf, "%#18llx          0     0                 ",
+           (unsigned long long)sym->get_addr(ctx));
+    buf += get_name(*sym);
+    buf += '\n';
+  }
+  return buf;
+}
+
+template <typename E>
+static std::string format_chunk(Context<E> &ctx, Map<E> &map,
+                                Chunk<E> &chunk, bool json) {
+  std::string buf;
+
+  if (json) {
+    buf = "{\"name\":\"" + json_escape(chunk.name) + "\"";
+    append(buf, ",\"addr\":%llu,\"size\":%llu,\"align\":%llu,\"inputs\":[",
+           (unsigned long long)chunk.shdr.sh_addr,
+           (unsigned long long)chunk.shdr.sh_size,
+           (unsigned long long)chunk.shdr.sh_addralign);
+  } else {
+    append(buf, "%#18llx%11llu%6llu ",
+           (unsigned long long)chunk.shdr.sh_addr,
+           (unsigned long long)chunk.shdr.sh_size,
+           (unsigned long long)chunk.shdr.sh_addralign);
+    buf += chunk.name;
+    buf += '\n';
+  }
+
+  if (OutputSection<E> *osec = chunk.to_osec()) {
     std::span<InputSection<E> *> members = osec->members;
     std::vector<std::string> bufs(members.size());
 
     tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
-      InputSection<E> *mem = members[i];
-      std::ostringstream ss;
-
-      u64 addr = 0;
-      if (osec->shdr.sh_flags & SHF_ALLOC)
-        addr = osec->shdr.sh_addr + mem->offset;
-
-      ss << std::showbase
-         << std::setw(18) << std::hex << addr << std::dec
-         << std::setw(11) << (u64)mem->sh_size
-         << std::setw(6) << (1 << mem->p2align)
-         << "         " << *mem << "\n";
-
-      typename Map<E>::const_accessor acc;
-      if (map.find(acc, mem))
-        for (Symbol<E> *sym : acc->second)
-          ss << std::showbase
-             << std::setw(18) << std::hex << sym->get_addr(ctx) << std::dec
-             << "          0     0                 "
-             << *sym << "\n";
-
-      bufs[i] = ss.str();
+      bufs[i] = format_member(ctx, map, *osec, *members[i], json);
     });
 
-    for (std::string &str : bufs)
-      *out << str;
+    for (i64 i = 0; i < bufs.size(); i++) {
+      if (json)
+        buf += (i == 0) ? "\n    " : ",\n    ";
+      buf += bufs[i];
+    }
+  }
+
+  if (json)
+    buf += "]}";
+  return buf;
+}
+
+// Writes a map file to `path`, or to stdout if `path` is empty.
+template <typename E>
+static void write_map(Context<E> &ctx, const std::string &path, bool json) {
+  // Construct a section-to-symbol map.
+  Map<E> map = get_map(ctx);
+
+  // Format each output section in parallel.
+  std::vector<std::string> bufs(ctx.chunks.size());
+
+  tbb::parallel_for((i64)0, (i64)ctx.chunks.size(), [&](i64 i) {
+    bufs[i] = format_chunk(ctx, map, *ctx.chunks[i], json);
+  });
+
+  // Concatenate them.
+  std::string header;
+  std::string footer;
+  std::string sep;
+
+  if (json) {
+    header = "{\"sections\":[\n  ";
+    footer = "\n]}\n";
+    sep = ",\n  ";
+  } else {
+    header = "               VMA       Size Align Out     In      Symbol\n";
+  }
+
+  std::vector<i64> offsets(bufs.size() + 1);
+  offsets[0] = header.size();
+  for (i64 i = 0; i < bufs.size(); i++)
+    offsets[i + 1] = offsets[i] + bufs[i].size() + (i ? sep.size() : 0);
+
+  std::string out(offsets.back() + footer.size(), '\0');
+  memcpy(out.data(), header.data(), header.size());
+  memcpy(out.data() + offsets.back(), footer.data(), footer.size());
+
+  tbb::parallel_for((i64)0, (i64)bufs.size(), [&](i64 i) {
+    char *p = out.data() + offsets[i];
+    if (i) {
+      memcpy(p, sep.data(), sep.size());
+      p += sep.size();
+    }
+    memcpy(p, bufs[i].data(), bufs[i].size());
+  });
+
+  // Write it out.
+  if (path.empty()) {
+    std::cout.write(out.data(), out.size());
+    return;
+  }
+
+  FILE *fp = fopen(path.c_str(), "w");
+  if (!fp)
+    Fatal(ctx) << "cannot open " << path << ": " << errno_string();
+  fwrite(out.data(), out.size(), 1, fp);
+  fclose(fp);
+}
+
+template <typename E>
+void print_map(Context<E> &ctx) {
+  Timer t(ctx, "print_map");
+  write_map(ctx, ctx.arg.Map, ctx.arg.Map.ends_with(".json"));
+}
+
+// Handles --dry-run-layout.
+template <typename E>
+void write_dry_run_layout(Context<E> &ctx) {
+  Timer t(ctx, "write_dry_run_layout");
+  write_map(ctx, ctx.arg.dry_run_layout, true);
+}
+
+// Returns the name of an input section as it appears in a map file.
+template <typename E>
+std::string get_map_name(InputSection<E> &isec) {
+  std::ostringstream ss;
+  ss << isec.file << ":(" << isec.name() << ")";
+  return ss.str();
+}
+
+// Handles --stable-layout. We read the addresses of output sections
+// and input sections from a text map file written by a previous link.
+// compute_section_size() and set_osec_offsets() use them to place
+// sections at the same addresses as before.
+template <typename E>
+void read_stable_layout(Context<E> &ctx) {
+  Timer t(ctx, "read_stable_layout");
+
+  MappedFile *mf = must_open_file(ctx, ctx.arg.stable_layout);
+  std::string_view data = mf->get_contents();
+
+  // A name that appears more than once is ambiguous, so we don't use it.
+  auto insert = [](std::unordered_map<std::string, u64> &map,
+                   std::string_view name, u64 addr) {
+    auto [it, inserted] = map.insert({std::string(name), addr});
+    if (!inserted)
+      it->second = -1;
+  };
+
+  // Each line starts with an 18-column address, an 11-column size and a
+  // 6-column alignment. They are followed by one space and an output
+  // section name, or nine spaces and an input section name. Symbol
+  // lines are indented deeper.
+  while (!data.empty()) {
+    size_t pos = data.find('\n');
+    std::string_view line = data.substr(0, pos);
+    data = (pos == data.npos) ? "" : data.substr(pos + 1);
+
+    if (line.size() < 37)
+      continue;
+
+    std::string field(line.substr(0, 18));
+    char *end;
+    u64 addr = strtoull(field.c_str(), &end, 16);
+    if (*end)
+      continue;
+
+    std::string_view rest = line.substr(35);
+    if (rest[0] != ' ')
+      continue;
+
+    if (rest[1] != ' ')
+      insert(ctx.stable_chunk_addrs, rest.substr(1), addr);
+    else if (rest.size() > 9 && rest.substr(0, 9) == "         " &&
+             rest[9] != ' ')
+      insert(ctx.stable_isec_addrs, rest.substr(9), addr);
   }
 }
 
 using E = MOLD_TARGET;
 
 template void print_map(Context<E> &ctx);
+template void write_dry_run_layout(Context<E> &ctx);
+template std::string get_map_name(InputSection<E> &);
+template void read_stable_layout(Context<E> &ctx);
 
 } // namespace mold
@@ -6,6 +6,7 @@
 #include <atomic>
 #include <bitset>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <fstream>
 #include <functional>
@@ -14,15 +15,18 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tbb/concurrent_hash_map.h>
 #include <tbb/concurrent_unordered_map.h>
 #include <tbb/concurrent_vector.h>
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/spin_mutex.h>
+#include <tbb/task_arena.h>
 #include <tbb/task_group.h>
 #include <type_traits>
 #include <unordered_map>
@@ -50,6 +54,7 @@ template <typename E> struct FdeRecord;
 template <typename E> class MergeableSection;
 template <typename E> class RelocSection;
 
+struct MemoryLink;
 struct ReaderContext;
 
 template <typename E>
@@ -61,21 +66,47 @@ std::string get_mold_version();
 // Mergeable section fragments
 //
 
+// We create tens of millions of fragments for large programs with debug
+// info, and each of them is embedded in a hash table entry, so this
+// class is packed into 8 bytes. Instead of a pointer to the output
+// section, it holds an index into ctx.merged_sections.
 template <typename E>
 struct __attribute__((aligned(4))) SectionFragment {
   SectionFragment(MergedSection<E> *sec, bool is_alive)
-    : output_section(*sec), is_alive(is_alive) {}
+    : output_section_idx(sec->idx), is_alive(is_alive) {}
+
+  MergedSection<E> &get_output_section(Context<E> &ctx) const {
+    return *ctx.merged_sections[output_section_idx];
+  }
 
   u64 get_addr(Context<E> &ctx) const {
-    return output_section.shdr.sh_addr + offset;
+    return get_output_section(ctx).shdr.sh_addr + offset;
   }
 
-  MergedSection<E> &output_section;
+  // Until the section is laid out, this holds the smallest rank among
+  // the occurrences of this fragment. See MergedSection::resolve().
   u32 offset = -1;
+
+  u16 output_section_idx : 15;
+
+  // True if this string is stored as a suffix of another fragment.
+  u16 is_tail : 1 = false;
+
   Atomic<u8> p2align = 0;
   Atomic<bool> is_alive = false;
 };
 
+// A relocated section often refers to the same or the next fragment
+// of a mergeable section as its previous relocation did. For example,
+// relocations in .debug_info refer to strings in .debug_str mostly in
+// increasing order. get_fragment() remembers the last fragment it found
+// here to skip a binary search in such cases.
+template <typename E>
+struct FragmentCache {
+  MergeableSection<E> *sec = nullptr;
+  i64 idx = 0;
+};
+
 // Additional class members for dynamic symbols. Because most symbols
 // don't need them and we allocate tens of millions of symbol objects
 // for large programs, we separate them from `Symbol` class to save
@@ -167,7 +198,7 @@ struct ThunkRef {
 template <typename E>
 struct CieRecord {
   CieRecord(Context<E> &ctx, ObjectFile<E> &file, InputSection<E> &isec,
-            u32 input_offset, std::span<ElfRel<E>> rels, u32 rel_idx)
+            u32 input_offset, std::span<const ElfRel<E>> rels, u32 rel_idx)
     : file(file), input_section(isec), input_offset(input_offset),
       rel_idx(rel_idx), rels(rels), contents(file.get_string(ctx, isec.shdr())) {}
 
@@ -179,7 +210,7 @@ struct CieRecord {
     return contents.substr(input_offset, size());
   }
 
-  std::span<ElfRel<E>> get_rels() const {
+  std::span<const ElfRel<E>> get_rels() const {
     i64 end = input_offset + size();
     i64 i = rel_idx;
     while (i < rels.size() && rels[i].r_offset < end)
@@ -193,8 +224,9 @@ struct CieRecord {
   u32 output_offset = -1;
   u32 rel_idx = -1;
   u32 icf_idx = -1;
+  bool is_alive = false;
   bool is_leader = false;
-  std::span<ElfRel<E>> rels;
+  std::span<const ElfRel<E>> rels;
   std::string_view contents;
 };
 
@@ -214,8 +246,8 @@ struct FdeRecord {
     return file.cies[cie_idx].contents.substr(input_offset, size(file));
   }
 
-  std::span<ElfRel<E>> get_rels(ObjectFile<E> &file) const {
-    std::span<ElfRel<E>> rels = file.cies[cie_idx].rels;
+  std::span<const ElfRel<E>> get_rels(ObjectFile<E> &file) const {
+    std::span<const ElfRel<E>> rels = file.cies[cie_idx].rels;
     i64 end = input_offset + size(file);
     i64 i = rel_idx;
     while (i < rels.size() && rels[i].r_offset < end)
@@ -239,9 +271,55 @@ struct InputSectionExtras<E> {
   std::vector<ThunkRef> thunk_refs;
 };
 
+template <typename E> requires is_x86_64<E>
+struct InputSectionExtras<E> {
+  // For -z rewrite-endbr. Offsets of endbr64s at the beginning of global
+  // functions and whether their addresses are taken.
+  std::vector<std::pair<u32, Atomic<bool>>> endbr;
+};
+
 template <typename E> requires is_riscv<E> || is_loongarch<E>
 struct InputSectionExtras<E> {
   std::vector<i32> r_deltas;
+  std::vector<i32> prev_r_deltas;
+
+  // For --iterative-relax. The maximum number of bytes each relocation
+  // may remove, or empty if no relocation has been capped.
+  std::vector<u8> relax_caps;
+};
+
+// A reference from a section to another section or to a section
+// fragment by a relocation. See build_section_refs() in passes.cc.
+template <typename E>
+class SectionRef {
+public:
+  SectionRef(InputSection<E> *isec, bool is_func_call)
+    : val((uintptr_t)isec | (is_func_call ? (uintptr_t)TAG_FUNC_CALL : 0)) {}
+
+  SectionRef(SectionFragment<E> *frag) : val((uintptr_t)frag | TAG_FRAG) {}
+
+  InputSection<E> *get_input_section() const {
+    if (val & TAG_FRAG)
+      return nullptr;
+    return (InputSection<E> *)(val & ~TAG_MASK);
+  }
+
+  SectionFragment<E> *get_frag() const {
+    if (val & TAG_FRAG)
+      return (SectionFragment<E> *)(val & ~TAG_MASK);
+    return nullptr;
+  }
+
+  bool is_func_call() const { return val & TAG_FUNC_CALL; }
+
+private:
+  enum : uintptr_t {
+    TAG_FUNC_CALL = 0b01,
+    TAG_FRAG      = 0b10,
+    TAG_MASK      = 0b11,
+  };
+
+  uintptr_t val;
 };
 
 // InputSection represents a section in an input object file.
@@ -250,19 +328,43 @@ class __attribute__((aligned(4))) InputSection {
 public:
   InputSection(Context<E> &ctx, ObjectFile<E> &file, i64 shndx);
 
+  // We create millions of input sections for large programs, and
+  // they are never freed until the end of a process.
+  static void *operator new(size_t size) {
+    return arena_alloc(size, alignof(InputSection));
+  }
+
+  static void operator delete(void *) {}
+
   void uncompress(Context<E> &ctx);
   void copy_contents(Context<E> &ctx, u8 *buf);
   void scan_relocations(Context<E> &ctx);
   void write_to(Context<E> &ctx, u8 *buf);
   void apply_reloc_alloc(Context<E> &ctx, u8 *base);
-  void apply_reloc_nonalloc(Context<E> &ctx, u8 *base);
+  void apply_reloc_nonalloc(Context<E> &ctx, u8 *base,
+                            std::span<const ElfRel<E>> rels);
   void kill();
 
+  void apply_reloc_nonalloc(Context<E> &ctx, u8 *base) {
+    apply_reloc_nonalloc(ctx, base, get_rels(ctx));
+  }
+
+  // Non-SHF_ALLOC sections larger than this are written by multiple
+  // threads. See write_large_nonalloc().
+  static constexpr i64 PARALLEL_WRITE_SIZE = 4 * 1024 * 1024;
+
+  bool is_large_nonalloc() const {
+    return !(shdr().sh_flags & SHF_ALLOC) && shdr().sh_type != SHT_NOBITS &&
+           (!(shdr().sh_flags & SHF_COMPRESSED) || uncompressed) &&
+           contents.size() == sh_size && sh_size >= PARALLEL_WRITE_SIZE;
+  }
+
   std::string_view name() const;
   i64 get_priority() const;
   u64 get_addr() const;
   const ElfShdr<E> &shdr() const;
-  std::span<ElfRel<E>> get_rels(Context<E> &ctx) const;
+  std::span<const ElfRel<E>> get_rels(Context<E> &ctx) const;
+  std::span<ElfRel<E>> get_mutable_rels(Context<E> &ctx);
   std::span<FdeRecord<E>> get_fdes() const;
   std::string_view get_func_name(Context<E> &ctx, i64 offset) const;
   bool is_relr_reloc(Context<E> &ctx, const ElfRel<E> &rel) const;
@@ -270,7 +372,14 @@ public:
   bool record_undef_error(Context<E> &ctx, const ElfRel<E> &rel);
 
   std::pair<SectionFragment<E> *, i64>
-  get_fragment(Context<E> &ctx, const ElfRel<E> &rel);
+  get_fragment(Context<E> &ctx, const ElfRel<E> &rel,
+               FragmentCache<E> *cache = nullptr);
+
+  std::pair<SectionFragment<E> *, i64>
+  get_fragment(Context<E> &ctx, const ElfRel<E> &rel, i64 addend,
+               FragmentCache<E> *cache = nullptr);
+
+  template <typename Fn> void for_each_ref(Context<E> &ctx, Fn fn);
 
   ObjectFile<E> &file;
   OutputSection<E> *output_section = nullptr;
@@ -292,11 +401,14 @@ public:
   Atomic<bool> is_alive = true;
   u8 p2align = 0;
 
-  // For ICF
-  Atomic<bool> address_taken = false;
+  // True if this section's contents have been replaced with a jump to
+  // `leader` by --icf=safe-thunks.
+  bool icf_thunk : 1 = false;
 
-  // For garbage collection
-  Atomic<bool> is_visited = false;
+  // True if this section's contents have been copied to the output file
+  // by copy_verbatim_sections(). This is written only in a pass in which
+  // icf_thunk is read-only, so the two can share a byte.
+  bool copied_verbatim : 1 = false;
 
   // For ICF
   //
@@ -305,10 +417,9 @@ public:
   // - `leader == nullptr`: This section was not eligible for ICF.
   // - `leader == this`: This section was retained.
   // - `leader != this`: This section was merged with another identical section.
+  //
+  // Other ICF-only states are in a side table in icf.cc.
   InputSection<E> *leader = nullptr;
-  i32 icf_idx = -1;
-  bool icf_eligible = false;
-  bool icf_leaf = false;
 
   [[no_unique_address]] InputSectionExtras<E> extra;
 
@@ -327,6 +438,10 @@ private:
   u64 get_thunk_addr(i64 idx);
 
   std::optional<u64> get_tombstone(Symbol<E> &sym, SectionFragment<E> *frag);
+  std::optional<u64> get_section_sym_value(const ElfRel<E> &rel);
+
+  void write_large_nonalloc(Context<E> &ctx, u8 *buf);
+  bool write_compressed_nonalloc(Context<E> &ctx, u8 *buf);
 };
 
 //
@@ -506,6 +621,10 @@ struct AbsRel {
   Symbol<E> *sym = nullptr;
   i64 addend = 0;
   AbsRelKind kind = ABS_REL_NONE;
+
+  // Index of the dynamic relocation for this entry within the output
+  // section's slice of .rela.dyn, if the entry needs one
+  u32 rel_idx = 0;
 };
 
 // Sections
@@ -529,6 +648,7 @@ public:
 
   void scan_abs_relocations(Context<E> &ctx);
   void create_range_extension_thunks(Context<E> &ctx);
+  void compute_stable_section_size(Context<E> &ctx, u64 base);
 
   std::vector<InputSection<E> *> members;
   std::vector<std::unique_ptr<Thunk<E>>> thunks;
@@ -694,11 +814,17 @@ public:
 
   void update_shdr(Context<E> &ctx) override;
   void copy_buf(Context<E> &ctx) override;
+  void tail_merge_strings(Context<E> &ctx);
 
   // Offsets in .strtab for ARM32 mapping symbols
   static constexpr i64 ARM = 1;
   static constexpr i64 THUMB = 4;
   static constexpr i64 DATA = 7;
+
+  // For --tail-merge-strtab
+  std::vector<std::pair<std::string_view, i64>> merged_strings;
+  i64 merged_size = 0;
+  i64 merged_offset = 0;
 };
 
 template <typename E>
@@ -799,6 +925,9 @@ public:
   void copy_buf(Context<E> &ctx) override;
 
   std::vector<Symbol<E> *> symbols;
+
+  // .dynstr offsets of symbol names, computed by sort_dynsyms()
+  std::vector<u32> name_offsets;
 };
 
 template <typename E>
@@ -845,7 +974,7 @@ public:
   get_instance(Context<E> &ctx, std::string_view name, const ElfShdr<E> &shdr);
 
   SectionFragment<E> *insert(Context<E> &ctx, std::string_view data,
-                             u64 hash, i64 p2align);
+                             u64 hash, i64 p2align, u32 rank = -1);
 
   void resolve(Context<E> &ctx);
   void compute_section_size(Context<E> &ctx) override;
@@ -853,17 +982,53 @@ public:
   void write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) override;
   void print_stats(Context<E> &ctx);
 
+  // Input sections refer to fragments with 32-bit handles instead of
+  // pointers to halve the memory for the references. A handle is an
+  // index into the hash table or, for the rare fragments that didn't
+  // fit in the table, into `overflow_frags` after the table.
+  u32 get_handle(SectionFragment<E> *frag) {
+    if (i64 idx = map.get_idx(frag); 0 <= idx && idx < map.nbuckets)
+      return idx;
+    return map.nbuckets + overflow_frags.push_back(frag) -
+           overflow_frags.begin();
+  }
+
+  SectionFragment<E> *get_fragment(u32 handle) {
+    if (handle < map.nbuckets)
+      return &map.entries[handle].value;
+    return overflow_frags[handle - map.nbuckets];
+  }
+
   std::vector<MergeableSection<E> *> members;
   std::mutex mu;
 
   ConcurrentMap<SectionFragment<E>> map;
   HyperLogLog estimator;
+  i64 idx = -1;
   bool resolved = false;
 
 private:
+  tbb::concurrent_vector<SectionFragment<E> *> overflow_frags;
   MergedSection(std::string_view name, i64 flags, i64 type, i64 entsize);
 
+  struct TailFragment {
+    SectionFragment<E> *frag;
+    SectionFragment<E> *host;
+    i64 offset;
+  };
+
+  std::vector<TailFragment> tail_merge_strings(Context<E> &ctx);
+
+  // A run of live fragments that are adjacent both in an input file and
+  // in the output. `offset` is relative to the beginning of the shard.
+  struct CopyRange {
+    const char *src;
+    u32 offset;
+    u32 size;
+  };
+
   std::vector<i64> shard_offsets;
+  std::vector<std::vector<CopyRange>> copy_ranges;
 };
 
 template <typename E>
@@ -881,6 +1046,44 @@ public:
   void copy_buf(Context<E> &ctx) override;
 };
 
+// .sframe contains compact stack trace info for profilers. See
+// output-chunks.cc for details.
+template <typename E>
+class SFrameSection : public Chunk<E> {
+public:
+  SFrameSection() {
+    this->name = ".sframe";
+    this->shdr.sh_type = SHT_PROGBITS;
+    this->shdr.sh_flags = SHF_ALLOC;
+    this->shdr.sh_addralign = 8;
+  }
+
+  void construct(Context<E> &ctx);
+  void copy_buf(Context<E> &ctx) override;
+
+private:
+  struct FdeRef {
+    u32 idx;
+    u32 rel_idx;
+    u32 fre_offset;
+    u32 fre_size;
+  };
+
+  struct Member {
+    InputSection<E> *isec;
+    std::vector<FdeRef> fdes;
+    i64 num_fres = 0;
+    i64 fde_idx = 0;
+    i64 fre_offset = 0;
+  };
+
+  std::vector<Member> members;
+  i64 num_fdes = 0;
+  i64 num_fres = 0;
+  i64 fre_size = 0;
+  u8 flags = 0;
+};
+
 template <typename E>
 class EhFrameHdrSection : public Chunk<E> {
 public:
@@ -1070,12 +1273,61 @@ public:
     this->shdr.sh_type = SHT_PROGBITS;
     this->shdr.sh_addralign = 4;
   }
+
+  // Contents created by start_gdb_index()
+  std::vector<u8> contents;
 };
 
+template <typename E>
+class DebugNamesSection : public Chunk<E> {
+public:
+  DebugNamesSection() {
+    this->name = ".debug_names";
+    this->shdr.sh_type = SHT_PROGBITS;
+    this->shdr.sh_addralign = 4;
+  }
+
+  void construct(Context<E> &ctx);
+  void copy_buf(Context<E> &ctx) override;
+  void write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) override;
+
+  struct Entry {
+    u32 cu_idx;
+    u32 die_offset;
+    u32 tag;
+    u32 linkage;
+  };
+
+  struct Name {
+    SectionFragment<E> *frag;
+    i64 frag_offset;
+    u32 hash;
+    u32 entry_offset;
+    i64 entries_begin;
+    i64 entries_end;
+  };
+
+private:
+  u64 get_abbrev_code(const Entry &ent);
+
+  std::vector<std::pair<ObjectFile<E> *, i64>> cus;
+  std::vector<Name> names;
+  std::vector<Entry> entries;
+  std::vector<std::pair<u32, u32>> abbrevs;
+  std::vector<u8> abbrev_table;
+  std::string augmentation;
+  i64 bucket_count = 0;
+  i64 cu_idx_size = 0;
+  i64 entry_pool_size = 0;
+};
+
+typedef enum { COMPRESS_NONE, COMPRESS_ZLIB, COMPRESS_ZSTD } CompressKind;
+
 template <typename E>
 class CompressedSection : public Chunk<E> {
 public:
-  CompressedSection(Context<E> &ctx, Chunk<E> &chunk);
+  CompressedSection(Context<E> &ctx, Chunk<E> &chunk, CompressKind kind,
+                    i64 level);
   void copy_buf(Context<E> &ctx) override;
 
 private:
@@ -1089,6 +1341,7 @@ public:
   RelocSection(Context<E> &ctx, OutputSection<E> &osec);
   void update_shdr(Context<E> &ctx) override;
   void copy_buf(Context<E> &ctx) override;
+  void write_rels(Context<E> &ctx, i64 idx);
 
 private:
   OutputSection<E> &output_section;
@@ -1144,6 +1397,8 @@ public:
   virtual void close(Context<E> &ctx) = 0;
   virtual ~OutputFile() = default;
 
+  void zero_range(i64 offset, i64 size);
+
   u8 *buf = nullptr;
   std::vector<u8> buf2;
   std::string path;
@@ -1152,6 +1407,9 @@ public:
   bool is_mmapped = false;
   bool is_unmapped = false;
 
+  // True if `buf` is known to be filled with zeros when opened.
+  bool is_zeroed = false;
+
 protected:
   OutputFile(std::string path, i64 filesize, bool is_mmapped)
     : path(path), filesize(filesize), is_mmapped(is_mmapped) {}
@@ -1199,6 +1457,22 @@ private:
   int perm;
 };
 
+// For link_in_memory(). The output file is returned to the caller
+// instead of being written to the filesystem.
+template <typename E>
+class MemoryOutputFile : public MallocOutputFile<E> {
+public:
+  MemoryOutputFile(Context<E> &ctx, std::string path, i64 filesize, int perm)
+    : MallocOutputFile<E>(ctx, path, filesize, perm) {}
+
+  void close(Context<E> &ctx) override {
+    Timer t(ctx, "close_file");
+    std::vector<u8> &vec = ctx.memory_link->output;
+    vec.assign(this->buf, this->buf + this->filesize);
+    vec.insert(vec.end(), this->buf2.begin(), this->buf2.end());
+  }
+};
+
 template <typename E>
 class LockingOutputFile : public OutputFile<E> {
 public:
@@ -1207,12 +1481,70 @@ public:
   void close(Context<E> &ctx) override;
 };
 
+template <typename E> void copy_verbatim_sections(Context<E> &ctx);
+template <typename E> void start_writeback(Context<E> &ctx, Chunk<E> &chunk);
+template <typename E> bool read_output_cache(Context<E> &ctx);
+template <typename E> void write_output_cache(Context<E> &ctx);
+
+//
+// progress.cc
+//
+
+template <typename E>
+class ProgressReporter {
+public:
+  ProgressReporter(Context<E> &ctx, int fd);
+  ~ProgressReporter();
+
+  void begin_phase(std::string_view name);
+  void finish();
+
+  Atomic<i64> num_files = 0;
+  Atomic<i64> num_symbols = 0;
+  Atomic<i64> num_lto_objects = 0;
+  Atomic<i64> bytes_written = 0;
+
+private:
+  std::string get_status();
+  void end_phase();
+  void run();
+
+  int fd;
+  i64 start_time;
+  i64 phase_start = 0;
+  std::string phase;
+  std::string history_path;
+  std::vector<std::pair<std::string, i64>> history;
+  std::vector<std::pair<std::string, i64>> phases;
+
+  std::vector<std::string> queue;
+  std::mutex mu;
+  std::condition_variable cv;
+  bool done = false;
+  std::thread thread;
+};
+
 //
 // gdb-index.cc
 //
 
+template <typename E> void create_gdb_index_early(Context<E> &ctx);
+template <typename E> void start_gdb_index(Context<E> &ctx);
 template <typename E> void write_gdb_index(Context<E> &ctx);
 
+template <typename E>
+std::span<u8> get_buffer(Context<E> &ctx, Chunk<E> *chunk);
+
+template <typename E, typename Offset>
+u64 read_scalar(Context<E> &ctx, u8 **p, u64 form);
+
+//
+// dwp.cc
+//
+
+template <typename E> void start_dwp(Context<E> &ctx);
+template <typename E> void write_dwp(Context<E> &ctx);
+
 //
 // input-files.cc
 //
@@ -1246,13 +1578,27 @@ public:
   MergeableSection(Context<E> &ctx, MergedSection<E> &parent,
                    std::unique_ptr<InputSection<E>> &isec);
 
+  static void *operator new(size_t size) {
+    return arena_alloc(size, alignof(MergeableSection));
+  }
+
+  static void operator delete(void *) {}
+
   void split_contents(Context<E> &ctx);
-  void resolve_contents(Context<E> &ctx);
-  std::pair<SectionFragment<E> *, i64> get_fragment(i64 offset);
+  void resolve_contents(Context<E> &ctx, i64 rank);
+  std::pair<SectionFragment<E> *, i64>
+  get_fragment(i64 offset, FragmentCache<E> *cache = nullptr);
   std::string_view get_contents(i64 idx);
+  std::string_view get_string(i64 offset);
+
+  i64 get_num_fragments() const { return frag_offsets.size(); }
+
+  std::pair<i64, i64> get_priority() const {
+    return {section->file.priority, section->shndx};
+  }
 
   MergedSection<E> &parent;
-  std::vector<SectionFragment<E> *> fragments;
+  std::vector<u32> fragments;
 
 private:
   std::unique_ptr<InputSection<E>> section;
@@ -1284,7 +1630,7 @@ public:
 
   ElfShdr<E> *find_section(i64 type);
 
-  virtual void resolve_symbols(Context<E> &ctx) = 0;
+  virtual void resolve_symbols(Context<E> &ctx, bool pending_only = false) = 0;
 
   virtual void
   mark_live_objects(Context<E> &ctx,
@@ -1304,6 +1650,9 @@ public:
   i64 priority;
   Atomic<bool> is_alive = false;
   std::string_view shstrtab;
+
+  // For --build-id=inputs
+  u8 content_hash[32] = {};
   std::string_view symbol_strtab;
 
   bool has_init_array = false;
@@ -1317,12 +1666,17 @@ public:
   u64 strtab_offset = 0;
   u64 strtab_size = 0;
 
+  // For --tail-merge-strtab. Offsets of symbol names relative to
+  // strtab_offset, in the order the symbols are written to .symtab.
+  std::vector<u32> strtab_name_offsets;
+
   // For --emit-relocs
   std::vector<i32> output_sym_indices;
 
 protected:
   std::vector<Symbol<E>> local_syms;
   std::vector<Symbol<E>> frag_syms;
+  Symbol<E> unused_local_sym;
 };
 
 template <typename E> struct ObjectFileExtras {};
@@ -1339,6 +1693,12 @@ struct ObjectFileExtras<PPC32> {
   InputSection<PPC32> *got2 = nullptr;
 };
 
+template <>
+struct ObjectFileExtras<PPC64V2> {
+  InputSection<PPC64V2> *toc = nullptr;
+  std::vector<Atomic<bool>> toc_no_relax;
+};
+
 // ObjectFile represents an input .o file.
 template <typename E>
 class ObjectFile : public InputFile<E> {
@@ -1349,11 +1709,13 @@ public:
              std::string archive_name, bool is_in_lib);
 
   void parse(Context<E> &ctx);
+  void parse_sections(Context<E> &ctx);
   void initialize_symbols(Context<E> &ctx);
+  std::vector<bool> get_used_local_syms(Context<E> &ctx);
   void parse_ehframe(Context<E> &ctx);
   void convert_mergeable_sections(Context<E> &ctx);
   void reattach_section_pieces(Context<E> &ctx);
-  void resolve_symbols(Context<E> &ctx) override;
+  void resolve_symbols(Context<E> &ctx, bool pending_only = false) override;
   void mark_live_objects(Context<E> &ctx,
                          std::function<void(InputFile<E> *)> feeder) override;
   void convert_undefined_weak_symbols(Context<E> &ctx);
@@ -1367,14 +1729,24 @@ public:
 
   std::string archive_name;
   std::vector<std::unique_ptr<InputSection<E>>> sections;
+
+  // Input files are mapped read-only. If we need to modify relocations
+  // of a section, we copy them to a buffer here. Indexed by the section
+  // index of a relocation section. See InputSection::get_mutable_rels().
+  std::vector<std::unique_ptr<ElfRel<E>[]>> rel_copies;
   std::vector<std::unique_ptr<MergeableSection<E>>> mergeable_sections;
   bool is_in_lib = false;
+
+  // True if sections and .eh_frame have been parsed while the LTO
+  // plugin was running. See do_lto().
+  bool is_preprocessed = false;
   std::vector<ElfShdr<E>> elf_sections2;
   std::vector<CieRecord<E>> cies;
   std::vector<FdeRecord<E>> fdes;
   BitVector has_symver;
   std::vector<ComdatGroupRef<E>> comdat_groups;
   std::vector<InputSection<E> *> eh_frame_sections;
+  std::vector<InputSection<E> *> sframe_sections;
   bool exclude_libs = false;
   std::map<u32, u32> gnu_properties;
   bool needs_executable_stack = false;
@@ -1389,14 +1761,33 @@ public:
   // For ICF
   std::unique_ptr<InputSection<E>> llvm_addrsig;
 
-  // For .gdb_index
+  // For --gc-sections and --icf. See build_section_refs().
+  std::vector<u32> section_ref_indices;
+  std::vector<SectionRef<E>> section_refs;
+
+  // For --call-graph-profile-sort
+  i64 llvm_cg_profile_idx = -1;
+
+  // Used by InputSection::get_func_name()
+  std::once_flag init_func_syms;
+  std::vector<u32> func_syms;
+
+  // For .gdb_index and .debug_names
   InputSection<E> *debug_info = nullptr;
+  InputSection<E> *debug_abbrev = nullptr;
   InputSection<E> *debug_pubnames = nullptr;
   InputSection<E> *debug_pubtypes = nullptr;
+  InputSection<E> *debug_names = nullptr;
 
   // For LTO
   std::vector<ElfSym<E>> lto_elf_syms;
 
+  // For --input-stats
+  i64 parse_nsec = 0;
+  Atomic<i64> apply_nsec = 0;
+  i64 num_gc_removed = 0;
+  i64 num_icf_removed = 0;
+
 private:
   void initialize_sections(Context<E> &ctx);
   void sort_relocations(Context<E> &ctx);
@@ -1423,7 +1814,7 @@ public:
   SharedFile(Context<E> &ctx, MappedFile *mf) : InputFile<E>(ctx, mf) {}
 
   void parse(Context<E> &ctx);
-  void resolve_symbols(Context<E> &ctx) override;
+  void resolve_symbols(Context<E> &ctx, bool pending_only = false) override;
   std::span<Symbol<E> *> get_symbols_at(Symbol<E> *sym);
   i64 get_alignment(Symbol<E> *sym);
   std::vector<std::string_view> get_dt_needed(Context<E> &ctx);
@@ -1435,6 +1826,9 @@ public:
   void compute_symtab_size(Context<E> &ctx);
   void populate_symtab(Context<E> &ctx);
 
+  void find_lazy_symbols(Context<E> &ctx, bool intern_all);
+  void intern_lazy_symbols(Context<E> &ctx);
+
   std::string soname;
   std::vector<std::string_view> version_strings;
   std::vector<ElfSym<E>> elf_syms2;
@@ -1448,6 +1842,10 @@ private:
   std::vector<u16> versyms;
   const ElfShdr<E> *symtab_sec;
 
+  // For --lazy-dso-symbols. Names of defined symbols that are not
+  // inserted to the symbol table yet.
+  std::vector<std::string_view> lazy_keys;
+
   // Used by get_symbols_at()
   std::once_flag init_sorted_syms;
   std::vector<Symbol<E> *> sorted_syms;
@@ -1465,6 +1863,23 @@ struct ReaderContext {
   tbb::task_group *tg = nullptr;
 };
 
+// For --lazy-archive-members. An archive member whose parsing is
+// deferred until a symbol listed for it in the archive symbol table
+// is referenced by other input files.
+struct LazyArchiveMember {
+  MappedFile *mf = nullptr;
+
+  // A member of a thin archive is a separate file, which is not opened
+  // until the member is loaded. `mf` is null until then.
+  std::string path;
+  MappedFile *thin_parent = nullptr;
+  ReaderContext rctx;
+
+  std::string archive_name;
+  i64 priority = 0;
+  bool is_loaded = false;
+};
+
 struct DynamicPattern {
   std::string_view pattern;
   std::string_view source;
@@ -1527,6 +1942,12 @@ ObjectFile<E> *read_lto_object(Context<E> &ctx, MappedFile *mb);
 template <typename E>
 std::vector<ObjectFile<E> *> run_lto_plugin(Context<E> &ctx);
 
+template <typename E>
+[[noreturn]] void run_lto_claim_helper(Context<E> &ctx);
+
+template <typename E>
+void run_thinlto_distributor(Context<E> &ctx);
+
 template <typename E>
 void lto_cleanup(Context<E> &ctx);
 
@@ -1558,6 +1979,13 @@ void gc_sections(Context<E> &ctx);
 template <typename E>
 void icf_sections(Context<E> &ctx);
 
+//
+// call-graph-sort.cc
+//
+
+template <typename E>
+void sort_sections_by_call_graph_profile(Context<E> &ctx);
+
 //
 // relocatable.cc
 //
@@ -1572,6 +2000,15 @@ void combine_objects(Context<E> &ctx);
 template <typename E>
 void print_map(Context<E> &ctx);
 
+template <typename E>
+void write_dry_run_layout(Context<E> &ctx);
+
+template <typename E>
+void read_stable_layout(Context<E> &ctx);
+
+template <typename E>
+std::string get_map_name(InputSection<E> &isec);
+
 //
 // subprocess.cc
 //
@@ -1593,13 +2030,28 @@ std::vector<std::string_view> expand_response_files(Context<E> &ctx, char **argv
 template <typename E>
 std::vector<std::string> parse_nonpositional_args(Context<E> &ctx);
 
+// The compiler driver passes a new temporary file name to the LTO
+// plugin with -plugin-opt=-fresolution= each time, so we ignore it when
+// hashing the command line.
+inline bool is_lto_resolution_arg(std::string_view arg) {
+  arg = arg.substr(std::min(arg.find_first_not_of('-'), arg.size()));
+  return arg.starts_with("plugin-opt=-fresolution=");
+}
+
 //
 // passes.cc
 //
 
+// -z hugepage-text aligns executable segments to this boundary.
+constexpr i64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
 template <typename E> int redo_main(Context<E> &, int argc, char **argv);
+template <typename E>
+void for_each_obj_largest_first(Context<E> &,
+                                std::function<void(ObjectFile<E> *)> fn);
 template <typename E> void create_internal_file(Context<E> &);
 template <typename E> void apply_exclude_libs(Context<E> &);
+template <typename E> void intern_dso_symbols(Context<E> &);
 template <typename E> void create_synthetic_sections(Context<E> &);
 template <typename E> void set_file_priority(Context<E> &);
 template <typename E> void resolve_symbols(Context<E> &);
@@ -1613,18 +2065,21 @@ template <typename E> void apply_section_align(Context<E> &);
 template <typename E> void check_cet_errors(Context<E> &);
 template <typename E> void print_dependencies(Context<E> &);
 template <typename E> void write_repro_file(Context<E> &);
-template <typename E> void check_duplicate_symbols(Context<E> &);
-template <typename E> void check_shlib_undefined(Context<E> &);
-template <typename E> void check_symbol_types(Context<E> &);
+template <typename E> void wait_repro_file(Context<E> &);
+template <typename E> void check_symbols(Context<E> &);
 template <typename E> void sort_init_fini(Context<E> &);
 template <typename E> void sort_ctor_dtor(Context<E> &);
 template <typename E> void fixup_ctors_in_init_array(Context<E> &);
 template <typename E> void shuffle_sections(Context<E> &);
+template <typename E> void sort_sections_by_symbol_order(Context<E> &);
+template <typename E> void partition_hot_cold_text(Context<E> &);
+template <typename E> void prune_debug_aranges(Context<E> &);
 template <typename E> void compute_section_sizes(Context<E> &);
 template <typename E> void sort_output_sections(Context<E> &);
 template <typename E> void claim_unresolved_symbols(Context<E> &);
 template <typename E> void scan_relocations(Context<E> &);
 template <typename E> void compute_imported_symbol_weakness(Context<E> &);
+template <typename E> void group_relocated_data(Context<E> &);
 template <typename E> void construct_relr(Context<E> &);
 template <typename E> void sort_dynsyms(Context<E> &);
 template <typename E> void create_output_symtab(Context<E> &);
@@ -1633,24 +2088,36 @@ template <typename E> void create_reloc_sections(Context<E> &);
 template <typename E> void copy_chunks(Context<E> &);
 template <typename E> void apply_version_script(Context<E> &);
 template <typename E> void parse_symbol_version(Context<E> &);
+template <typename E> void read_interposed_symbols(Context<E> &);
 template <typename E> void compute_import_export(Context<E> &);
-template <typename E> void compute_address_significance(Context<E> &);
+template <typename E> void build_section_refs(Context<E> &);
+template <typename E> void release_section_refs(Context<E> &);
 template <typename E> void separate_debug_sections(Context<E> &);
 template <typename E> void compute_section_headers(Context<E> &);
 template <typename E> i64 set_osec_offsets(Context<E> &);
 template <typename E> void fix_synthetic_symbols(Context<E> &);
 template <typename E> void compress_debug_sections(Context<E> &);
+template <typename E> void hash_input_file(Context<E> &, InputFile<E> *);
+template <typename E> void compute_input_build_id(Context<E> &);
+template <typename E> void start_build_id(Context<E> &);
 template <typename E> void write_build_id(Context<E> &);
 template <typename E> void write_gnu_debuglink(Context<E> &);
+template <typename E> void open_delta_base(Context<E> &);
+template <typename E> void write_delta(Context<E> &);
+template <typename E> void start_separate_debug_file(Context<E> &ctx);
 template <typename E> void write_separate_debug_file(Context<E> &ctx);
 template <typename E> void write_dependency_file(Context<E> &);
+template <typename E> void sample_memory_usage(Context<E> &, std::string_view);
 template <typename E> void show_stats(Context<E> &);
+template <typename E> void write_perf_trace(Context<E> &);
+template <typename E> void write_input_stats(Context<E> &);
 
 //
 // arch-x86-64.cc
 //
 
-void rewrite_endbr(Context<X86_64> &ctx);
+void find_endbr(Context<X86_64> &ctx);
+void keep_endbr(Context<X86_64> &ctx);
 
 //
 // arch-arm32.cc
@@ -1757,6 +2224,7 @@ struct BuildId {
     case HEX:
       return value.size();
     case HASH:
+    case INPUTS:
       return hash_size;
     case UUID:
       return 16;
@@ -1765,13 +2233,11 @@ struct BuildId {
     }
   }
 
-  enum { NONE, HEX, HASH, UUID } kind = NONE;
+  enum { NONE, HEX, HASH, UUID, INPUTS } kind = NONE;
   std::vector<u8> value;
   i64 hash_size = 0;
 };
 
-typedef enum { COMPRESS_NONE, COMPRESS_ZLIB, COMPRESS_ZSTD } CompressKind;
-
 typedef enum {
   UNRESOLVED_ERROR,
   UNRESOLVED_WARN,
@@ -1784,6 +2250,7 @@ typedef enum {
   BSYMBOLIC_FUNCTIONS,
   BSYMBOLIC_NON_WEAK,
   BSYMBOLIC_NON_WEAK_FUNCTIONS,
+  BSYMBOLIC_AUTO,
 } BsymbolicKind;
 
 typedef enum {
@@ -1818,6 +2285,13 @@ struct SectionOrder {
   u64 value = 0;
 };
 
+// For --compress-sections
+struct CompressSectionsPattern {
+  Glob glob;
+  CompressKind kind = COMPRESS_NONE;
+  i64 level = -1;
+};
+
 // Target-specific context members
 template <typename E>
 struct ContextExtras {};
@@ -1900,15 +2374,21 @@ struct Context {
     bool allow_multiple_definition = false;
     bool allow_shlib_undefined = true;
     bool apply_dynamic_relocs = true;
+    bool async_debug_file = false;
+    bool call_graph_profile_sort = true;
     bool color_diagnostics = false;
+    bool copy_file_range = false;
+    bool debug_names = false;
     bool default_symver = false;
     bool demangle = true;
     bool detach = true;
     bool discard_all = false;
     bool discard_locals = false;
     bool dynamic_list_data = false;
+    bool early_writeback = false;
     bool eh_frame_hdr = true;
     bool emit_relocs = false;
+    bool emit_relocs_alloc = false;
     bool enable_new_dtags = true;
     bool execute_only = false;
     bool export_dynamic = false;
@@ -1916,29 +2396,42 @@ struct Context {
     bool fork = true;
     bool gc_sections = false;
     bool gdb_index = false;
+    bool group_relocated_data = false;
     bool hash_style_gnu = true;
     bool hash_style_sysv = true;
+    bool huge_page_inputs = false;
     bool icf = false;
     bool icf_all = false;
+    bool icf_safe_thunks = false;
     bool ignore_data_address_equality = false;
+    bool iterative_relax = false;
+    bool lazy_archive_members = false;
+    bool lazy_dso_symbols = false;
+    bool lto_claim_helper = false;
     bool lto_pass2 = false;
+    bool mmap_output = true;
     bool nmagic = false;
     bool noinhibit_exec = false;
     bool oformat_binary = false;
     bool omagic = false;
     bool pack_dyn_relocs_relr = false;
     bool perf = false;
+    bool perf_hw = false;
+    bool perf_threads = false;
     bool pic = false;
+    bool prefetch_inputs = false;
     bool pie = false;
     bool print_dependencies = false;
     bool print_gc_sections = false;
     bool print_icf_sections = false;
     bool print_map = false;
+    bool prune_debug_aranges = false;
     bool quick_exit = true;
     bool relax = true;
     bool relocatable = false;
     bool relocatable_merge_sections = false;
     bool repro = false;
+    bool repro_zstd = false;
     bool rosegment = true;
     bool shared = false;
     bool start_stop = false;
@@ -1947,10 +2440,14 @@ struct Context {
     bool strip_all = false;
     bool strip_debug = false;
     bool suppress_warnings = false;
+    bool tail_merge_strings = false;
+    bool tail_merge_strtab = false;
+    bool thinlto_index_pass = false;
     bool trace = false;
     bool undefined_version = false;
     bool warn_common = false;
     bool warn_once = false;
+    bool warn_symbol_ordering = true;
     bool warn_textrel = false;
     bool z_copyreloc = true;
     bool z_delete = true;
@@ -1959,6 +2456,7 @@ struct Context {
     bool z_dynamic_undefined_weak = true;
     bool z_execstack = false;
     bool z_execstack_if_needed = false;
+    bool z_hugepage_text = false;
     bool z_ibt = false;
     bool z_initfirst = false;
     bool z_interpose = false;
@@ -1973,7 +2471,16 @@ struct Context {
     bool z_shstk = false;
     bool z_start_stop_visibility_protected = false;
     bool z_text = false;
+    bool zero_data_to_bss = false;
+    bool zstd_seek_table = false;
+    i64 compress_debug_level = -1;
     i64 filler = -1;
+    i64 gnu_hash_bloom_bits = 12;
+    i64 hot_text_align = 0;
+    i64 icf_max_rounds = -1;
+    i64 icf_time_budget = -1;
+    i64 lto_claim_helpers = 0;
+    i64 progress_fd = -1;
     i64 spare_dynamic_tags = 5;
     i64 spare_program_headers = 0;
     i64 thread_count = 0;
@@ -1983,29 +2490,42 @@ struct Context {
     std::string Map;
     std::string chroot;
     std::string dependency_file;
+    std::string dry_run_layout;
     std::string directory;
+    std::string dwp;
     std::string dynamic_linker;
+    std::string emit_delta;
+    std::string input_stats;
+    std::string lto_symbol_cache;
     std::string output = "a.out";
+    std::string output_cache;
     std::string package_metadata;
+    std::string perf_trace;
     std::string plugin;
     std::string rpaths;
     std::string separate_debug_file;
     std::string soname;
+    std::string stable_layout;
     std::string sysroot;
+    std::string thinlto_distributor;
     std::string_view emulation;
     std::optional<std::vector<Symbol<E> *>> retain_symbols_file;
     std::unordered_map<std::string_view, u64> section_align;
     std::unordered_map<std::string_view, u64> section_start;
     std::unordered_set<std::string_view> ignore_ir_file;
     std::unordered_set<std::string_view> wrap;
+    std::vector<CompressSectionsPattern> compress_sections;
     std::vector<SectionOrder> section_order;
+    std::vector<Symbol<E> *> hot_text_file;
     std::vector<Symbol<E> *> require_defined;
+    std::vector<Symbol<E> *> symbol_ordering_file;
     std::vector<Symbol<E> *> undefined;
     std::vector<std::pair<Symbol<E> *, std::variant<Symbol<E> *, u64>>> defsyms;
     std::vector<std::string> library_paths;
     std::vector<std::string> plugin_opt;
     std::vector<std::string> version_definitions;
     std::vector<std::string_view> auxiliary;
+    std::vector<std::string_view> Bsymbolic_auto;
     std::vector<std::string_view> exclude_libs;
     std::vector<std::string_view> filter;
     std::vector<std::string_view> trace_symbol;
@@ -2019,21 +2539,41 @@ struct Context {
   i64 default_version = VER_NDX_UNSPECIFIED;
   i64 page_size = E::page_size;
   bool has_error = false;
+  bool has_warning = false;
 
   // Reader context
   i64 file_priority = 10000;
 
+  // For --lazy-archive-members
+  std::vector<std::unique_ptr<LazyArchiveMember>> lazy_members;
+  std::unordered_map<std::string_view, std::vector<LazyArchiveMember *>>
+    lazy_member_map;
+
+  // For -l. Names of files in library directories. A directory that is
+  // not in this map is searched by opening files directly.
+  std::unordered_map<std::string_view, std::unordered_set<std::string>>
+    library_dir_entries;
+
+  // For --thinlto-distributor. Maps bitcode file paths to native object
+  // files compiled from them by the distributor command.
+  std::unordered_map<std::string, std::string> thinlto_native_objects;
+
   // Symbol table
-  tbb::concurrent_hash_map<std::string_view, Symbol<E>, HashCmp> symbol_map;
-  tbb::concurrent_hash_map<std::string_view, ComdatGroup, HashCmp> comdat_groups;
+  ShardedMap<Symbol<E>> symbol_map;
+  ShardedMap<ComdatGroup> comdat_groups;
   tbb::concurrent_vector<std::unique_ptr<MergedSection<E>>> merged_sections;
 
   tbb::concurrent_vector<std::unique_ptr<TimerRecord>> timer_records;
   tbb::concurrent_vector<std::function<void()>> on_exit;
 
+  // --repro writes a tar file on this thread while we are linking
+  std::thread repro_thread;
+
   tbb::concurrent_vector<std::unique_ptr<ObjectFile<E>>> obj_pool;
   tbb::concurrent_vector<std::unique_ptr<SharedFile<E>>> dso_pool;
   tbb::concurrent_vector<std::unique_ptr<u8[]>> string_pool;
+  Atomic<i64> string_pool_bytes = 0;
+  BumpAllocator string_arena;
   tbb::concurrent_vector<std::unique_ptr<MappedFile>> mf_pool;
   tbb::concurrent_vector<std::unique_ptr<Chunk<E>>> chunk_pool;
   tbb::concurrent_vector<std::unique_ptr<OutputSection<E>>> osec_pool;
@@ -2051,21 +2591,90 @@ struct Context {
   ObjectFile<E> *internal_obj = nullptr;
   std::vector<ElfSym<E>> internal_esyms;
 
+  // For --progress-fd
+  std::unique_ptr<ProgressReporter<E>> progress;
+
+  // Non-null if we are called via link_in_memory()
+  MemoryLink *memory_link = nullptr;
+
+  // For --stats. Bytes held by major data structures, sampled at the
+  // beginning of each phase.
+  struct MemorySample {
+    std::string_view phase;
+    std::vector<std::pair<std::string_view, i64>> bytes;
+  };
+  std::vector<MemorySample> memory_samples;
+  i64 icf_digest_bytes = 0;
+
+  // For --stable-layout. Addresses of output sections and input sections
+  // in the previous link, keyed by names as they appear in a map file.
+  std::unordered_map<std::string, u64> stable_chunk_addrs;
+  std::unordered_map<std::string, u64> stable_isec_addrs;
+
+  // For --Bsymbolic-auto. Names of symbols that the given executables and
+  // shared objects may interpose.
+  std::unordered_set<std::string_view> interposed_syms;
+
   // Output buffer
   std::unique_ptr<OutputFile<E>> output_file;
   u8 *buf = nullptr;
   bool overwrite_output_file = false;
 
+  // For --emit-delta. The previous contents of the output file.
+  std::unique_ptr<MappedFile> delta_base;
+
   std::vector<Chunk<E> *> chunks;
+
+  // The chunks and their sizes and alignments as of the last
+  // set_osec_offsets() call, so that the next call can tell what changed.
+  struct ChunkLayout {
+    Chunk<E> *chunk;
+    u64 size;
+    u64 align;
+  };
+  std::vector<ChunkLayout> last_layout;
+  i64 last_filesize = 0;
+
   Atomic<bool> needs_tlsld = false;
   Atomic<bool> has_textrel = false;
   Atomic<i32> num_ifunc_dynrels = 0;
 
-  tbb::concurrent_hash_map<Symbol<E> *, std::vector<std::string>> undef_errors;
+  // Undefined symbol errors. Only the first few references to each
+  // symbol are formatted and kept. The others are just counted.
+  struct UndefError {
+    std::vector<std::string> refs;
+    i64 count = 0;
+  };
+
+  static constexpr i64 MAX_UNDEF_ERROR_REFS = 3;
+
+  tbb::concurrent_hash_map<Symbol<E> *, UndefError> undef_errors;
+  std::shared_mutex undef_errors_mu;
 
   // For --separate-debug-file
   std::vector<Chunk<E> *> debug_chunks;
 
+  // For --async-debug-file. Contents of debug sections that are relocated
+  // in a low-priority arena while the main output file is being written.
+  tbb::task_arena debug_arena{tbb::task_arena::automatic, 1,
+                              tbb::task_arena::priority::low};
+  tbb::task_group debug_tg;
+  std::unordered_map<Chunk<E> *, std::vector<u8>> debug_contents;
+
+  // For --build-id. Hashes of output shards that are computed in the
+  // background while the passes following copy_chunks() are running.
+  tbb::task_group build_id_tg;
+  std::vector<u8> build_id_hashes;
+  std::vector<u8> build_id_is_deferred;
+
+  // For .gdb_index created from input sections in the background
+  tbb::task_group gdb_index_tg;
+
+  // For --dwp. The contents of a DWARF package file that is created
+  // in the background.
+  tbb::task_group dwp_tg;
+  std::vector<u8> dwp_contents;
+
   // Output chunks
   OutputEhdr<E> *ehdr = nullptr;
   OutputShdr<E> *shdr = nullptr;
@@ -2090,6 +2699,7 @@ struct Context {
   DynsymSection<E> *dynsym = nullptr;
   EhFrameSection<E> *eh_frame = nullptr;
   EhFrameHdrSection<E> *eh_frame_hdr = nullptr;
+  SFrameSection<E> *sframe = nullptr;
   EhFrameRelocSection<E> *eh_frame_reloc = nullptr;
   CopyrelSection<E> *copyrel = nullptr;
   CopyrelSection<E> *copyrel_relro = nullptr;
@@ -2099,6 +2709,7 @@ struct Context {
   BuildIdSection<E> *buildid = nullptr;
   NotePackageSection<E> *note_package = nullptr;
   GdbIndexSection<E> *gdb_index = nullptr;
+  DebugNamesSection<E> *debug_names = nullptr;
   RelroPaddingSection<E> *relro_padding = nullptr;
   MergedSection<E> *comment = nullptr;
 
@@ -2158,8 +2769,18 @@ MappedFile *find_library(Context<E> &ctx, ReaderContext &rctx, std::string path)
 template <typename E>
 void read_file(Context<E> &ctx, ReaderContext &rctx, MappedFile *mf);
 
+// For link_in_memory(). Input files whose pathnames are keys of `inputs`
+// are read from the given buffers instead of the filesystem, and the
+// output file is written to `output` instead of the filesystem.
+struct MemoryLink {
+  std::unordered_map<std::string, std::string_view> inputs;
+  std::vector<u8> output;
+};
+
 template <typename E>
-int mold_main(int argc, char **argv);
+int mold_main(int argc, char **argv, MemoryLink *memory_link = nullptr);
+
+int link_in_memory(std::span<const std::string> args, MemoryLink &link);
 
 template <typename E>
 std::ostream &operator<<(std::ostream &out, const InputFile<E> &file);
@@ -2325,6 +2946,10 @@ public:
   tbb::spin_mutex mu;
   Atomic<u8> visibility = STV_DEFAULT;
 
+  // For symbol resolution. True if this symbol has to be resolved again
+  // from scratch. See resolve_symbols().
+  bool needs_resolve = false;
+
   bool is_weak : 1 = false;
   bool write_to_symtab : 1 = false; // for --strip-all and the like
   bool is_traced : 1 = false;       // for --trace-symbol
@@ -2527,12 +3152,33 @@ inline const ElfShdr<E> &InputSection<E>::shdr() const {
 }
 
 template <typename E>
-inline std::span<ElfRel<E>> InputSection<E>::get_rels(Context<E> &ctx) const {
+inline std::span<const ElfRel<E>>
+InputSection<E>::get_rels(Context<E> &ctx) const {
   if (relsec_idx == -1)
     return {};
+  if (ElfRel<E> *buf = file.rel_copies[relsec_idx].get())
+    return {buf, file.elf_sections[relsec_idx].sh_size / sizeof(ElfRel<E>)};
   return file.template get_data<ElfRel<E>>(ctx, file.elf_sections[relsec_idx]);
 }
 
+template <typename E>
+inline std::span<ElfRel<E>> InputSection<E>::get_mutable_rels(Context<E> &ctx) {
+  static Counter counter("copied_rel_bytes");
+
+  if (relsec_idx == -1)
+    return {};
+
+  std::span<const ElfRel<E>> rels = get_rels(ctx);
+  std::unique_ptr<ElfRel<E>[]> &buf = file.rel_copies[relsec_idx];
+
+  if (!buf) {
+    buf.reset(new ElfRel<E>[rels.size()]);
+    std::copy(rels.begin(), rels.end(), buf.get());
+    counter += rels.size() * sizeof(ElfRel<E>);
+  }
+  return {buf.get(), rels.size()};
+}
+
 template <typename E>
 inline std::span<FdeRecord<E>> InputSection<E>::get_fdes() const {
   if (fde_begin == -1)
@@ -2543,7 +3189,19 @@ inline std::span<FdeRecord<E>> InputSection<E>::get_fdes() const {
 
 template <typename E>
 std::pair<SectionFragment<E> *, i64>
-InputSection<E>::get_fragment(Context<E> &ctx, const ElfRel<E> &rel) {
+InputSection<E>::get_fragment(Context<E> &ctx, const ElfRel<E> &rel,
+                              FragmentCache<E> *cache) {
+  return get_fragment(ctx, rel, get_addend(*this, rel), cache);
+}
+
+// Same as above except that this version takes an addend. REL-type
+// targets use this to pass an addend read from the output buffer,
+// because compressed debug sections are not uncompressed in memory on
+// those targets.
+template <typename E>
+inline std::pair<SectionFragment<E> *, i64>
+InputSection<E>::get_fragment(Context<E> &ctx, const ElfRel<E> &rel,
+                              i64 addend, FragmentCache<E> *cache) {
   assert(!(shdr().sh_flags & SHF_ALLOC));
 
   const ElfSym<E> &esym = file.elf_syms[rel.r_sym];
@@ -2556,10 +3214,59 @@ InputSection<E>::get_fragment(Context<E> &ctx, const ElfRel<E> &rel) {
     return {nullptr, 0};
 
   if (esym.st_type == STT_SECTION)
-    return m->get_fragment(esym.st_value + get_addend(*this, rel));
+    return m->get_fragment(esym.st_value + addend, cache);
+
+  std::pair<SectionFragment<E> *, i64> p =
+    m->get_fragment(esym.st_value, cache);
+  return {p.first, p.second + addend};
+}
+
+// Calls `fn` with a SectionRef for each relocation of this section
+// that refers to an input section or a section fragment.
+template <typename E>
+template <typename Fn>
+inline void InputSection<E>::for_each_ref(Context<E> &ctx, Fn fn) {
+  if (!file.section_ref_indices.empty()) {
+    u32 end = file.section_ref_indices[shndx + 1];
+    for (u32 i = file.section_ref_indices[shndx]; i < end; i++)
+      fn(file.section_refs[i]);
+    return;
+  }
+
+  for (const ElfRel<E> &rel : get_rels(ctx)) {
+    Symbol<E> &sym = *file.symbols[rel.r_sym];
+    if (SectionFragment<E> *frag = sym.get_frag())
+      fn(SectionRef<E>(frag));
+    else if (InputSection<E> *isec = sym.get_input_section())
+      fn(SectionRef<E>(isec, is_func_call_rel(rel)));
+  }
+}
+
+// Most relocations in debug sections refer to other debug sections such
+// as .debug_abbrev or .debug_line via section symbols. If a given
+// relocation refers to a live, non-mergeable section that way, this
+// function returns S + A, so that apply_reloc_nonalloc() can apply it
+// without going through symbol lookup, fragment lookup and tombstone
+// checks. Otherwise, it returns nothing.
+template <typename E>
+inline std::optional<u64>
+InputSection<E>::get_section_sym_value(const ElfRel<E> &rel) {
+  if (rel.r_sym >= file.first_global)
+    return {};
+
+  const ElfSym<E> &esym = file.elf_syms[rel.r_sym];
+  if (esym.st_type != STT_SECTION)
+    return {};
+
+  // Mergeable sections have been replaced with null in file.sections.
+  i64 shndx = file.get_shndx(esym);
+  if (file.sections.size() <= shndx)
+    return {};
 
-  std::pair<SectionFragment<E> *, i64> p = m->get_fragment(esym.st_value);
-  return {p.first, p.second + get_addend(*this, rel)};
+  InputSection<E> *isec = file.sections[shndx].get();
+  if (!isec || !isec->is_alive)
+    return {};
+  return isec->get_addr() + esym.st_value + get_addend(*this, rel);
 }
 
 template <typename E>
@@ -2617,11 +3324,27 @@ inline bool InputSection<E>::icf_removed() const {
 
 template <typename E>
 std::pair<SectionFragment<E> *, i64>
-MergeableSection<E>::get_fragment(i64 offset) {
+MergeableSection<E>::get_fragment(i64 offset, FragmentCache<E> *cache) {
   std::span<u32> vec = frag_offsets;
-  auto it = std::upper_bound(vec.begin(), vec.end(), offset);
-  i64 idx = it - 1 - vec.begin();
-  return {fragments[idx], offset - vec[idx]};
+
+  auto contains = [&](i64 i) {
+    return i < vec.size() && vec[i] <= offset &&
+           (i + 1 == vec.size() || offset < vec[i + 1]);
+  };
+
+  i64 idx;
+  if (cache && cache->sec == this && contains(cache->idx)) {
+    idx = cache->idx;
+  } else if (cache && cache->sec == this && contains(cache->idx + 1)) {
+    idx = cache->idx + 1;
+  } else {
+    auto it = std::upper_bound(vec.begin(), vec.end(), offset);
+    idx = it - 1 - vec.begin();
+  }
+
+  if (cache)
+    *cache = {this, idx};
+  return {parent.get_fragment(fragments[idx]), offset - vec[idx]};
 }
 
 template <typename E>
@@ -2632,6 +3355,17 @@ std::string_view MergeableSection<E>::get_contents(i64 i) {
   return section->contents.substr(cur, frag_offsets[i + 1] - cur);
 }
 
+// Returns a null-terminated string at a given offset without the
+// terminating null.
+template <typename E>
+std::string_view MergeableSection<E>::get_string(i64 offset) {
+  std::span<u32> vec = frag_offsets;
+  auto it = std::upper_bound(vec.begin(), vec.end(), offset);
+  i64 idx = it - 1 - vec.begin();
+  std::string_view str = get_contents(idx).substr(offset - vec[idx]);
+  return str.substr(0, str.find('\0'));
+}
+
 template <typename E>
 template <typename T>
 inline std::span<T>
@@ -3119,10 +3853,9 @@ inline bool is_c_identifier(std::string_view s) {
 
 template <typename E>
 std::string_view save_string(Context<E> &ctx, const std::string &str) {
-  u8 *buf = new u8[str.size() + 1];
+  u8 *buf = ctx.string_arena.allocate(str.size() + 1);
   memcpy(buf, str.data(), str.size());
   buf[str.size()] = '\0';
-  ctx.string_pool.push_back(std::unique_ptr<u8[]>(buf));
   return {(char *)buf, str.size()};
 }
 
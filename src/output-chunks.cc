@@ -23,6 +23,74 @@ static u32 elf_hash(std::string_view name) {
   return h;
 }
 
+// Sorts elements by a given 32-bit key using a parallel LSD radix sort.
+// .eh_frame_hdr and .rela.dyn may contain millions of entries, and radix
+// sort is much faster than a comparison sort for them. Since the sort is
+// stable, the result is deterministic even if there are duplicate keys.
+template <typename T, typename Fn>
+static void radix_sort(std::span<T> vec, Fn key) {
+  constexpr i64 BLOCK_SIZE = 64 * 1024;
+
+  if (vec.size() < BLOCK_SIZE) {
+    std::stable_sort(vec.begin(), vec.end(), [&](const T &a, const T &b) {
+      return key(a) < key(b);
+    });
+    return;
+  }
+
+  i64 num_blocks = align_to(vec.size(), BLOCK_SIZE) / BLOCK_SIZE;
+  std::vector<std::array<i64, 256>> counts(num_blocks);
+  std::vector<T> tmp(vec.size());
+  T *src = vec.data();
+  T *dst = tmp.data();
+
+  for (i64 shift = 0; shift < 32; shift += 8) {
+    auto get_range = [&](i64 i) {
+      return std::pair(src + i * BLOCK_SIZE,
+                       src + std::min<i64>((i + 1) * BLOCK_SIZE, vec.size()));
+    };
+
+    // Count the number of occurrences of each digit in each block.
+    tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+      counts[i].fill(0);
+      auto [begin, end] = get_range(i);
+      for (T *p = begin; p < end; p++)
+        counts[i][(key(*p) >> shift) & 0xff]++;
+    });
+
+    // Compute the start position of each digit in each block.
+    i64 offset = 0;
+    bool is_trivial = false;
+
+    for (i64 digit = 0; digit < 256; digit++) {
+      i64 start = offset;
+      for (i64 i = 0; i < num_blocks; i++) {
+        i64 n = counts[i][digit];
+        counts[i][digit] = offset;
+        offset += n;
+      }
+
+      if (offset - start == vec.size())
+        is_trivial = true;
+    }
+
+    // If all elements have the same digit, this pass is a no-op.
+    if (is_trivial)
+      continue;
+
+    tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+      auto [begin, end] = get_range(i);
+      for (T *p = begin; p < end; p++)
+        dst[counts[i][(key(*p) >> shift) & 0xff]++] = *p;
+    });
+
+    std::swap(src, dst);
+  }
+
+  if (src != vec.data())
+    memcpy(vec.data(), src, vec.size() * sizeof(T));
+}
+
 template <typename E>
 Chunk<E> *find_chunk(Context<E> &ctx, u32 sh_type) {
   for (Chunk<E> *chunk : ctx.chunks)
@@ -235,6 +303,8 @@ static std::vector<ElfPhdr<E>> create_phdr(Context<E> &ctx) {
     i64 flags = to_phdr_flags(ctx, first);
     define(PT_LOAD, flags, first);
     vec.back().p_align = std::max<u64>(ctx.page_size, vec.back().p_align);
+    if (ctx.arg.z_hugepage_text && (flags & PF_X))
+      vec.back().p_align = std::max<u64>(HUGE_PAGE_SIZE, vec.back().p_align);
 
     // Add contiguous ALLOC sections as long as they have the same
     // section flags and there's no on-disk gap in between.
@@ -271,6 +341,10 @@ static std::vector<ElfPhdr<E>> create_phdr(Context<E> &ctx) {
   if (ctx.eh_frame_hdr)
     define(PT_GNU_EH_FRAME, PF_R, ctx.eh_frame_hdr);
 
+  // Add PT_GNU_SFRAME
+  if (ctx.sframe && ctx.sframe->shdr.sh_size)
+    define(PT_GNU_SFRAME, PF_R, ctx.sframe);
+
   // Add PT_GNU_PROPERTY
   if (Chunk<E> *chunk = find_chunk(ctx, ".note.gnu.property"))
     define(PT_GNU_PROPERTY, PF_R, chunk);
@@ -442,9 +516,40 @@ void RelDynSection<E>::sort(Context<E> &ctx) {
   // We group IFUNC relocations at the end of .rel.dyn because we want to
   // apply all the other relocations before running user-supplied ifunc
   // resolver functions.
-  tbb::parallel_sort(begin, end, [&](const ElfRel<E> &a, const ElfRel<E> &b) {
+  auto less = [&](const ElfRel<E> &a, const ElfRel<E> &b) {
     return std::tuple(get_rank(a.r_type), a.r_sym, a.r_offset) <
            std::tuple(get_rank(b.r_type), b.r_sym, b.r_offset);
+  };
+
+  i64 num_syms = ctx.dynsym->symbols.size() + 1;
+  if (num_syms * 3 > UINT32_MAX) {
+    tbb::parallel_sort(begin, end, less);
+    return;
+  }
+
+  // Chunks are laid out in address order, and each chunk writes its
+  // dynamic relocations in ascending r_offset order for the most part.
+  // Therefore, it is usually enough to stably group relocations by
+  // (rank, r_sym) to bring them into their final order. We do that with
+  // a radix sort and then fix up only the groups that are not sorted yet.
+  auto get_key = [&](const ElfRel<E> &rel) -> u32 {
+    return get_rank(rel.r_type) * num_syms + rel.r_sym;
+  };
+
+  radix_sort(std::span(begin, end), get_key);
+
+  std::vector<std::span<ElfRel<E>>> groups;
+  for (ElfRel<E> *p = begin; p < end;) {
+    ElfRel<E> *q = p + 1;
+    while (q < end && get_key(*p) == get_key(*q))
+      q++;
+    groups.push_back({p, q});
+    p = q;
+  }
+
+  tbb::parallel_for_each(groups, [&](std::span<ElfRel<E>> group) {
+    if (!std::is_sorted(group.begin(), group.end(), less))
+      tbb::parallel_sort(group.begin(), group.end(), less);
   });
 }
 
@@ -492,6 +597,11 @@ void StrtabSection<E>::update_shdr(Context<E> &ctx) {
     offset += file->strtab_size;
   }
 
+  // If --tail-merge-strtab is given, the files' own regions are empty,
+  // and their symbol names live in this region instead.
+  merged_offset = offset;
+  offset += merged_size;
+
   this->shdr.sh_size = (offset == 1) ? 0 : offset;
 }
 
@@ -503,6 +613,78 @@ void StrtabSection<E>::copy_buf(Context<E> &ctx) {
   if constexpr (is_arm32<E>)
     if (!ctx.arg.strip_all)
       memcpy(buf + 1, "$a\0$t\0$d", 9);
+
+  tbb::parallel_for_each(merged_strings,
+                         [&](std::pair<std::string_view, i64> p) {
+    write_string(buf + merged_offset + p.second, p.first);
+  });
+}
+
+// If a symbol name is a suffix of another name, it doesn't have to be
+// stored separately; it can point to the tail of the longer one. This is
+// the same optimization that we do for mergeable string sections, and
+// it is effective for C++ programs because mangled names often share
+// suffixes such as argument types.
+//
+// We sort all names by their reversed contents. After sorting, if a name
+// is a suffix of any other name, it is a suffix of its immediate
+// successor, so a single linear scan from the end can merge them.
+template <typename E>
+void StrtabSection<E>::tail_merge_strings(Context<E> &ctx) {
+  Timer t(ctx, "tail_merge_strtab");
+
+  struct Entry {
+    std::string_view name;
+    u32 *offset;
+  };
+
+  std::vector<InputFile<E> *> files;
+  append(files, ctx.objs);
+  append(files, ctx.dsos);
+
+  // Symbols are visited in the same order as populate_symtab() writes them.
+  std::vector<std::vector<Entry>> shards(files.size());
+
+  tbb::parallel_for((i64)0, (i64)files.size(), [&](i64 i) {
+    InputFile<E> *file = files[i];
+    i64 begin = file->is_dso ? file->first_global : 1;
+    i64 n = 0;
+
+    for (i64 j = begin; j < file->symbols.size(); j++)
+      if (Symbol<E> *sym = file->symbols[j];
+          sym->file == file && sym->write_to_symtab)
+        n++;
+
+    file->strtab_name_offsets.resize(n);
+    file->strtab_size = 0;
+
+    for (i64 j = begin, k = 0; j < file->symbols.size(); j++)
+      if (Symbol<E> *sym = file->symbols[j];
+          sym->file == file && sym->write_to_symtab)
+        shards[i].push_back({sym->name(), &file->strtab_name_offsets[k++]});
+  });
+
+  std::vector<Entry> entries = flatten(shards);
+
+  tbb::parallel_sort(entries, [](const Entry &a, const Entry &b) {
+    return std::lexicographical_compare(a.name.rbegin(), a.name.rend(),
+                                        b.name.rbegin(), b.name.rend());
+  });
+
+  merged_strings.clear();
+  merged_size = 0;
+
+  for (i64 i = entries.size() - 1; i >= 0; i--) {
+    Entry &ent = entries[i];
+    if (i + 1 < entries.size() && entries[i + 1].name.ends_with(ent.name)) {
+      Entry &next = entries[i + 1];
+      *ent.offset = *next.offset + next.name.size() - ent.name.size();
+    } else {
+      *ent.offset = merged_size;
+      merged_strings.push_back({ent.name, merged_size});
+      merged_size += ent.name.size() + 1;
+    }
+  }
 }
 
 template <typename E>
@@ -564,10 +746,12 @@ void DynstrSection<E>::copy_buf(Context<E> &ctx) {
   for (std::pair<std::string_view, i64> p : strings)
     write_string(base + p.second, p.first);
 
-  i64 off = dynsym_offset;
-  for (Symbol<E> *sym : ctx.dynsym->symbols)
-    if (sym)
-      off += write_string(base + off, sym->name());
+  std::span<Symbol<E> *> syms = ctx.dynsym->symbols;
+  std::span<u32> offsets = ctx.dynsym->name_offsets;
+
+  tbb::parallel_for((i64)1, (i64)syms.size(), [&](i64 i) {
+    write_string(base + offsets[i], syms[i]->name());
+  });
 }
 
 template <typename E>
@@ -908,6 +1092,17 @@ void OutputSection<E>::compute_section_size(Context<E> &ctx) {
     }
   }
 
+  // With --stable-layout, we keep input sections at the same offsets
+  // as in the previous link if we can. Since an offset depends on all
+  // preceding members, this is done serially.
+  if (!ctx.stable_isec_addrs.empty() && (shdr.sh_flags & SHF_ALLOC)) {
+    auto it = ctx.stable_chunk_addrs.find(std::string(this->name));
+    if (it != ctx.stable_chunk_addrs.end() && it->second != -1) {
+      compute_stable_section_size(ctx, it->second);
+      return;
+    }
+  }
+
   // Since one output section may contain millions of input sections,
   // we first split input sections into groups and assign offsets to
   // groups.
@@ -955,6 +1150,37 @@ void OutputSection<E>::compute_section_size(Context<E> &ctx) {
   });
 }
 
+// Assign offsets to members so that they are at the same addresses as
+// in the previous link relative to `base`, the previous address of this
+// output section. If preceding members have grown, a member is placed
+// right after them as usual.
+template <typename E>
+void OutputSection<E>::compute_stable_section_size(Context<E> &ctx, u64 base) {
+  std::vector<i64> prev(members.size(), -1);
+
+  tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
+    auto it = ctx.stable_isec_addrs.find(get_map_name(*members[i]));
+    if (it != ctx.stable_isec_addrs.end() && it->second != -1 &&
+        base <= it->second)
+      prev[i] = it->second - base;
+  });
+
+  ElfShdr<E> &shdr = this->shdr;
+  i64 offset = 0;
+
+  for (i64 i = 0; i < members.size(); i++) {
+    InputSection<E> &isec = *members[i];
+    offset = align_to(offset, 1 << isec.p2align);
+    if (offset < prev[i] && prev[i] % (1 << isec.p2align) == 0)
+      offset = prev[i];
+
+    isec.offset = offset;
+    offset += isec.sh_size;
+    shdr.sh_addralign = std::max<u32>(shdr.sh_addralign, 1 << isec.p2align);
+  }
+  shdr.sh_size = offset;
+}
+
 template <typename E>
 void OutputSection<E>::copy_buf(Context<E> &ctx) {
   if (this->shdr.sh_type != SHT_NOBITS) {
@@ -969,14 +1195,15 @@ void OutputSection<E>::copy_buf(Context<E> &ctx) {
 
 template <typename E>
 void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
-  // Copy section contents to an output file.
-  tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
+  // We may be writing to a temporary buffer, e.g. to compress the
+  // section contents.
+  bool is_output = ctx.output_file && buf == ctx.buf + this->shdr.sh_offset;
+
+  // Clear trailing padding. We write trap or nop instructions for
+  // an executable segment so that a disassembler wouldn't try to
+  // disassemble garbage as instructions.
+  auto clear_padding = [&](i64 i) {
     InputSection<E> &isec = *members[i];
-    isec.write_to(ctx, buf + isec.offset);
-
-    // Clear trailing padding. We write trap or nop instructions for
-    // an executable segment so that a disassembler wouldn't try to
-    // disassemble garbage as instructions.
     u64 this_end = isec.offset + isec.sh_size;
     u64 next_start;
     if (i + 1 < members.size())
@@ -990,10 +1217,84 @@ void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
     if (this->shdr.sh_flags & SHF_EXECINSTR) {
       for (i64 i = 0; i + sizeof(E::filler) <= size; i += sizeof(E::filler))
         memcpy(loc + i, E::filler, sizeof(E::filler));
+    } else if (is_output) {
+      ctx.output_file->zero_range(loc - ctx.buf, size);
     } else {
       memset(loc, 0, size);
     }
-  });
+  };
+
+  if (this->shdr.sh_flags & SHF_ALLOC) {
+    // With --emit-relocs=alloc, we write out relocations for a member
+    // while its relocations are still hot in cache rather than reading
+    // them again in RelocSection::copy_buf(). We do that only when we
+    // are writing to the output file.
+    RelocSection<E> *relsec = nullptr;
+    if (ctx.arg.emit_relocs_alloc && is_output)
+      relsec = reloc_sec.get();
+
+    // Copy section contents to an output file.
+    tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
+      members[i]->write_to(ctx, buf + members[i]->offset);
+      clear_padding(i);
+      if (relsec)
+        relsec->write_rels(ctx, i);
+    });
+  } else {
+    // Non-allocated sections are mostly debug info sections, which tend
+    // to be large. Consecutive members that are contiguous both in the
+    // same input file and in the output are copied with a single memcpy,
+    // and then relocations are applied to each member. Members already
+    // copied by copy_verbatim_sections() are left alone.
+    auto is_plain = [](InputSection<E> &isec) {
+      return !isec.copied_verbatim &&
+             isec.shdr().sh_type != SHT_NOBITS &&
+             !(isec.shdr().sh_flags & SHF_COMPRESSED) &&
+             isec.contents.size() == isec.sh_size;
+    };
+
+    // A large member is written by multiple threads by itself, so it
+    // doesn't join a run.
+    auto is_contiguous = [&](InputSection<E> &a, InputSection<E> &b) {
+      return &a.file == &b.file && is_plain(a) && is_plain(b) &&
+             !a.is_large_nonalloc() && !b.is_large_nonalloc() &&
+             a.contents.data() + a.contents.size() == b.contents.data() &&
+             a.offset + a.sh_size == b.offset;
+    };
+
+    std::vector<i64> runs;
+    for (i64 i = 0; i < members.size(); i++)
+      if (i == 0 || !is_contiguous(*members[i - 1], *members[i]))
+        runs.push_back(i);
+    runs.push_back(members.size());
+
+    tbb::parallel_for((i64)0, (i64)runs.size() - 1, [&](i64 i) {
+      i64 begin = runs[i];
+      i64 end = runs[i + 1];
+
+      if (end - begin == 1) {
+        members[begin]->write_to(ctx, buf + members[begin]->offset);
+      } else {
+        InputSection<E> &first = *members[begin];
+        InputSection<E> &last = *members[end - 1];
+        memcpy(buf + first.offset, first.contents.data(),
+               last.offset + last.sh_size - first.offset);
+
+        if (!ctx.arg.relocatable) {
+          i64 start = ctx.arg.input_stats.empty() ? 0 : now_nsec();
+
+          for (i64 j = begin; j < end; j++)
+            if (members[j]->sh_size)
+              members[j]->apply_reloc_nonalloc(ctx, buf + members[j]->offset);
+
+          // All members of a run belong to the same file.
+          if (!ctx.arg.input_stats.empty())
+            first.file.apply_nsec += now_nsec() - start;
+        }
+      }
+      clear_padding(end - 1);
+    });
+  }
 
   // Emit range extension thunks.
   if constexpr (needs_thunk<E>) {
@@ -1002,8 +1303,9 @@ void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
     });
   }
 
-  // Emit dynamic relocations.
-  for (AbsRel<E> &r : abs_rels) {
+  // Emit dynamic relocations. Since the position of each relocation has
+  // been computed by scan_abs_relocations(), we can do this in parallel.
+  tbb::parallel_for_each(abs_rels, [&](AbsRel<E> &r) {
     Word<E> *loc = (Word<E> *)(buf + r.isec->offset + r.offset);
     u64 addr = this->shdr.sh_addr + r.isec->offset + r.offset;
     Symbol<E> &sym = *r.sym;
@@ -1015,7 +1317,7 @@ void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
       break;
     case ABS_REL_BASEREL: {
       u64 val = sym.get_addr(ctx) + r.addend;
-      *rel++ = ElfRel<E>(addr, E::R_RELATIVE, 0, val);
+      rel[r.rel_idx] = ElfRel<E>(addr, E::R_RELATIVE, 0, val);
       if (ctx.arg.apply_dynamic_relocs)
         *loc = val;
       break;
@@ -1023,18 +1325,19 @@ void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
     case ABS_REL_IFUNC:
       if constexpr (supports_ifunc<E>) {
         u64 val = sym.get_addr(ctx, NO_PLT) + r.addend;
-        *rel++ = ElfRel<E>(addr, E::R_IRELATIVE, 0, val);
+        rel[r.rel_idx] = ElfRel<E>(addr, E::R_IRELATIVE, 0, val);
         if (ctx.arg.apply_dynamic_relocs)
           *loc = val;
       }
       break;
     case ABS_REL_DYNREL:
-      *rel++ = ElfRel<E>(addr, E::R_ABS, sym.get_dynsym_idx(ctx), r.addend);
+      rel[r.rel_idx] = ElfRel<E>(addr, E::R_ABS, sym.get_dynsym_idx(ctx),
+                                 r.addend);
       if (ctx.arg.apply_dynamic_relocs)
         *loc = r.addend;
       break;
     }
-  }
+  });
 }
 
 // .relr.dyn contains base relocations encoded in a space-efficient form.
@@ -1055,12 +1358,7 @@ void OutputSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
 // representable in this encoding and such relocation must be stored to
 // the .rel.dyn section). A bitmap has LSB 1.
 template <typename E>
-static std::vector<u64> encode_relr(std::span<u64> pos) {
-  for (i64 i = 0; i < pos.size(); i++) {
-    assert(pos[i] % sizeof(Word<E>) == 0);
-    assert(i == 0 || pos[i - 1] < pos[i]);
-  }
-
+static std::vector<u64> encode_relr_serial(std::span<u64> pos) {
   std::vector<u64> vec;
   i64 num_bits = E::is_64 ? 63 : 31;
   i64 max_delta = sizeof(Word<E>) * num_bits;
@@ -1085,6 +1383,32 @@ static std::vector<u64> encode_relr(std::span<u64> pos) {
   return vec;
 }
 
+// A large section may contain millions of base relocations. We split the
+// positions into fixed-size blocks and encode them in parallel. Each block
+// starts with an address entry, which costs at most one extra word per
+// block, and the output doesn't depend on the number of threads.
+template <typename E>
+static std::vector<u64> encode_relr(std::span<u64> pos) {
+  for (i64 i = 0; i < pos.size(); i++) {
+    assert(pos[i] % sizeof(Word<E>) == 0);
+    assert(i == 0 || pos[i - 1] < pos[i]);
+  }
+
+  constexpr i64 BLOCK_SIZE = 64 * 1024;
+  if (pos.size() <= BLOCK_SIZE)
+    return encode_relr_serial<E>(pos);
+
+  i64 num_blocks = align_to(pos.size(), BLOCK_SIZE) / BLOCK_SIZE;
+  std::vector<std::vector<u64>> vec(num_blocks);
+
+  tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+    i64 begin = i * BLOCK_SIZE;
+    i64 end = std::min<i64>(begin + BLOCK_SIZE, pos.size());
+    vec[i] = encode_relr_serial<E>(pos.subspan(begin, end - begin));
+  });
+  return flatten(vec);
+}
+
 template <typename E>
 static AbsRelKind get_abs_rel_kind(Context<E> &ctx, Symbol<E> &sym) {
   if (sym.is_ifunc())
@@ -1155,6 +1479,28 @@ void OutputSection<E>::scan_abs_relocations(Context<E> &ctx) {
           r.isec->shdr().sh_addralign % sizeof(Word<E>) == 0 &&
           r.offset % sizeof(Word<E>) == 0)
         r.kind = ABS_REL_RELR;
+
+  // Assign each dynamic relocation its position within this section's
+  // part of .rela.dyn, so that write_to() can emit them in parallel.
+  auto needs_rel = [](AbsRel<E> &r) {
+    if (r.kind == ABS_REL_IFUNC)
+      return supports_ifunc<E>;
+    return r.kind == ABS_REL_BASEREL || r.kind == ABS_REL_DYNREL;
+  };
+
+  auto scan = [&](const tbb::blocked_range<i64> &r, i64 sum, bool is_final) {
+    for (i64 i = r.begin(); i < r.end(); i++) {
+      if (needs_rel(abs_rels[i])) {
+        if (is_final)
+          abs_rels[i].rel_idx = sum;
+        sum++;
+      }
+    }
+    return sum;
+  };
+
+  tbb::parallel_scan(tbb::blocked_range<i64>(0, abs_rels.size()), (i64)0,
+                     scan, std::plus());
 }
 
 template <typename E>
@@ -1767,6 +2113,12 @@ ElfSym<E> to_output_esym(Context<E> &ctx, Symbol<E> &sym, u32 st_name,
   esym.st_type = sym.get_type();
   esym.st_size = sym.esym().st_size;
 
+  // A function folded by --icf=safe-thunks is now a thunk jumping to
+  // its leader, so it's only as large as the thunk.
+  if (InputSection<E> *isec = sym.get_input_section())
+    if (isec->icf_thunk)
+      esym.st_size = std::min<u64>(esym.st_size, isec->sh_size);
+
   if (sym.is_local(ctx))
     esym.st_bind = STB_LOCAL;
   else if (sym.is_weak)
@@ -1788,7 +2140,7 @@ ElfSym<E> to_output_esym(Context<E> &ctx, Symbol<E> &sym, u32 st_name,
   auto get_st_shndx = [&](Symbol<E> &sym) -> u32 {
     if (SectionFragment<E> *frag = sym.get_frag())
       if (frag->is_alive)
-        return frag->output_section.shndx;
+        return frag->get_output_section(ctx).shndx;
 
     if constexpr (is_ppc64v1<E>)
       if (sym.has_opd(ctx))
@@ -1823,7 +2175,7 @@ ElfSym<E> to_output_esym(Context<E> &ctx, Symbol<E> &sym, u32 st_name,
     esym.st_value = sym.get_addr(ctx);
   } else if (SectionFragment<E> *frag = sym.get_frag()) {
     // Section fragment
-    shndx = frag->output_section.shndx;
+    shndx = frag->get_output_section(ctx).shndx;
     esym.st_value = sym.get_addr(ctx);
   } else if (!isec) {
     // Absolute symbol
@@ -1897,17 +2249,15 @@ template <typename E>
 void DynsymSection<E>::copy_buf(Context<E> &ctx) {
   u8 *base = ctx.buf + this->shdr.sh_offset;
   memset(base, 0, sizeof(ElfSym<E>));
-  i64 name_offset = ctx.dynstr->dynsym_offset;
 
-  for (i64 i = 1; i < symbols.size(); i++) {
+  tbb::parallel_for((i64)1, (i64)symbols.size(), [&](i64 i) {
     Symbol<E> &sym = *symbols[i];
     ElfSym<E> &esym =
       *(ElfSym<E> *)(base + sym.get_dynsym_idx(ctx) * sizeof(ElfSym<E>));
 
-    esym = to_output_esym(ctx, sym, name_offset, nullptr);
-    name_offset += sym.name().size() + 1;
+    esym = to_output_esym(ctx, sym, name_offsets[i], nullptr);
     assert(esym.st_bind != STB_LOCAL || i < this->shdr.sh_info);
-  }
+  });
 }
 
 template <typename E>
@@ -1950,8 +2300,9 @@ void GnuHashSection<E>::update_shdr(Context<E> &ctx) {
   if (ctx.dynsym->symbols.empty())
     return;
 
-  // We allocate 12 bits for each symbol in the bloom filter.
-  num_bloom = bit_ceil((num_exported * 12) / (sizeof(Word<E>) * 8));
+  // By default, we allocate 12 bits for each symbol in the bloom filter.
+  num_bloom = bit_ceil((num_exported * ctx.arg.gnu_hash_bloom_bits) /
+                       (sizeof(Word<E>) * 8));
 
   this->shdr.sh_size = HEADER_SIZE;                  // Header
   this->shdr.sh_size += num_bloom * sizeof(Word<E>); // Bloom filter
@@ -1971,46 +2322,51 @@ void GnuHashSection<E>::copy_buf(Context<E> &ctx) {
   std::span<Symbol<E> *> syms = ctx.dynsym->symbols;
   syms = syms.subspan(first_exported);
 
-  std::vector<u32> indices(num_exported);
-
   *(U32<E> *)base = num_buckets;
   *(U32<E> *)(base + 4) = first_exported;
   *(U32<E> *)(base + 8) = num_bloom;
   *(U32<E> *)(base + 12) = BLOOM_SHIFT;
 
-  // Write a bloom filter
-  Word<E> *bloom = (Word<E> *)(base + HEADER_SIZE);
+  std::vector<u32> hashes(num_exported);
+  tbb::parallel_for((i64)0, num_exported, [&](i64 i) {
+    hashes[i] = syms[i]->get_djb_hash(ctx);
+  });
 
-  for (i64 i = 0; i < syms.size(); i++) {
-    constexpr i64 word_bits = sizeof(Word<E>) * 8;
+  // Write a bloom filter. Symbols setting bits in the same word may be
+  // handled by different threads, so we build it with atomic ORs first.
+  constexpr i64 word_bits = sizeof(Word<E>) * 8;
+  std::vector<Atomic<u64>> words(num_bloom);
 
-    u32 h = syms[i]->get_djb_hash(ctx);
-    indices[i] = h % num_buckets;
+  tbb::parallel_for((i64)0, num_exported, [&](i64 i) {
+    u32 h = hashes[i];
+    words[(h / word_bits) % num_bloom] |=
+      (1LL << (h % word_bits)) | (1LL << ((h >> BLOOM_SHIFT) % word_bits));
+  });
 
-    i64 idx = (h / word_bits) % num_bloom;
-    bloom[idx] |= 1LL << (h % word_bits);
-    bloom[idx] |= 1LL << ((h >> BLOOM_SHIFT) % word_bits);
-  }
+  Word<E> *bloom = (Word<E> *)(base + HEADER_SIZE);
+  tbb::parallel_for((i64)0, num_bloom, [&](i64 i) {
+    bloom[i] = words[i];
+  });
 
-  // Write hash bucket indices
+  // Symbols have been sorted by bucket index. A bucket points to the
+  // first symbol of its chain, and the last entry in a chain must be
+  // terminated with an entry with least-significant bit 1. Every entry
+  // can be computed independently from its neighbors.
   U32<E> *buckets = (U32<E> *)(bloom + num_bloom);
+  U32<E> *table = buckets + num_buckets;
 
-  for (i64 i = 0; i < syms.size(); i++)
-    if (!buckets[indices[i]])
-      buckets[indices[i]] = i + first_exported;
+  tbb::parallel_for((i64)0, num_exported, [&](i64 i) {
+    u32 h = hashes[i];
+    u32 idx = h % num_buckets;
 
-  // Write a hash table
-  U32<E> *table = buckets + num_buckets;
+    if (i == 0 || hashes[i - 1] % num_buckets != idx)
+      buckets[idx] = i + first_exported;
 
-  for (i64 i = 0; i < syms.size(); i++) {
-    // The last entry in a chain must be terminated with an entry with
-    // least-significant bit 1.
-    u32 h = syms[i]->get_djb_hash(ctx);
-    if (i == syms.size() - 1 || indices[i] != indices[i + 1])
+    if (i == num_exported - 1 || hashes[i + 1] % num_buckets != idx)
       table[i] = h | 1;
     else
       table[i] = h & ~1;
-  }
+  });
 }
 
 template <typename E>
@@ -2084,7 +2440,12 @@ MergedSection<E>::get_instance(Context<E> &ctx, std::string_view name,
   if (MergedSection *osec = find())
     return osec;
 
+  // SectionFragment refers to its output section with a 15-bit index.
+  if (ctx.merged_sections.size() == 1 << 15)
+    Fatal(ctx) << "too many mergeable output sections";
+
   MergedSection *osec = new MergedSection(name, flags, shdr.sh_type, entsize);
+  osec->idx = ctx.merged_sections.size();
   ctx.merged_sections.emplace_back(osec);
   return osec;
 }
@@ -2092,7 +2453,9 @@ MergedSection<E>::get_instance(Context<E> &ctx, std::string_view name,
 template <typename E>
 SectionFragment<E> *
 MergedSection<E>::insert(Context<E> &ctx, std::string_view data, u64 hash,
-                         i64 p2align) {
+                         i64 p2align, u32 rank) {
+  static_assert(sizeof(SectionFragment<E>) == 8);
+
   // Even if GC is enabled, we garbage-collect only memory-mapped strings.
   // Non-memory-allocated strings are typically identifiers used by debug info.
   // To remove such strings, use the `strip` command.
@@ -2101,6 +2464,11 @@ MergedSection<E>::insert(Context<E> &ctx, std::string_view data, u64 hash,
   SectionFragment<E> *frag =
     map.insert(data, hash, SectionFragment(this, is_alive)).first;
   update_maximum(frag->p2align, p2align);
+
+  std::atomic_ref<u32> ref(frag->offset);
+  u32 val = ref.load(std::memory_order_relaxed);
+  while (rank < val &&
+         !ref.compare_exchange_weak(val, rank, std::memory_order_relaxed));
   return frag;
 }
 
@@ -2140,8 +2508,33 @@ void MergedSection<E>::resolve(Context<E> &ctx) {
   // We aim 2/3 occupation ratio
   map.resize(estimator.get_cardinality() * 3 / 2);
 
-  tbb::parallel_for_each(members, [&](MergeableSection<E> *sec) {
-    sec->resolve_contents(ctx);
+  // Fragment handles are 32 bits. See get_handle().
+  if (map.nbuckets > (1LL << 31))
+    Fatal(ctx) << this->name << ": too many strings";
+
+  // The order of fragments in the output has to be deterministic. We
+  // give each fragment a rank that is its index in the concatenation
+  // of all members in the input file order. A fragment that appears
+  // more than once keeps its smallest rank, which doesn't depend on
+  // the order of insertion. compute_section_size() uses it as a sort
+  // key. If there are too many fragments to rank, we sort by contents.
+  sort(members, [](MergeableSection<E> *a, MergeableSection<E> *b) {
+    return a->get_priority() < b->get_priority();
+  });
+
+  std::vector<i64> ranks(members.size(), -1);
+  i64 total = 0;
+  for (MergeableSection<E> *sec : members)
+    total += sec->get_num_fragments();
+
+  if (total < UINT32_MAX)
+    for (i64 i = 0, rank = 0; i < members.size(); i++) {
+      ranks[i] = rank;
+      rank += members[i]->get_num_fragments();
+    }
+
+  tbb::parallel_for((i64)0, (i64)members.size(), [&](i64 i) {
+    members[i]->resolve_contents(ctx, ranks[i]);
   });
 
   if (this == ctx.comment)
@@ -2149,28 +2542,124 @@ void MergedSection<E>::resolve(Context<E> &ctx) {
   resolved = true;
 }
 
+// If a string is a suffix of another string, it doesn't have to be
+// stored separately; it can point to the tail of the longer one. For
+// example, "bar" can be represented as the last four bytes of "foobar"
+// (including the terminating NUL).
+//
+// We sort strings by their reversed contents, so that if a string is a
+// suffix of any other string, it is a suffix of its immediate successor.
+// Since map entries are unique, the result of sorting is deterministic.
+template <typename E>
+std::vector<typename MergedSection<E>::TailFragment>
+MergedSection<E>::tail_merge_strings(Context<E> &ctx) {
+  Timer t(ctx, "tail_merge_strings");
+  using Entry = typename decltype(map)::Entry;
+
+  std::vector<std::vector<Entry *>> shards(map.NUM_SHARDS);
+
+  tbb::parallel_for((i64)0, map.NUM_SHARDS, [&](i64 i) {
+    map.for_each_entry(i, [&](Entry &ent) {
+      ent.value.is_tail = false;
+      if (ent.value.is_alive)
+        shards[i].push_back(&ent);
+    });
+  });
+
+  std::vector<Entry *> entries = flatten(shards);
+
+  auto get_key = [](Entry *ent) {
+    return std::string_view(ent->key, ent->keylen);
+  };
+
+  tbb::parallel_sort(entries, [&](Entry *a, Entry *b) {
+    std::string_view x = get_key(a);
+    std::string_view y = get_key(b);
+    return std::lexicographical_compare(x.rbegin(), x.rend(),
+                                        y.rbegin(), y.rend());
+  });
+
+  // A suffix of a multibyte-char string is valid only if it starts at
+  // a character boundary, and a fragment has to stay aligned.
+  i64 entsize = std::max<i64>(this->shdr.sh_entsize, 1);
+  std::vector<TailFragment> tails;
+  Entry *host = nullptr;
+
+  for (i64 i = entries.size() - 1; i >= 0; i--) {
+    Entry *ent = entries[i];
+    SectionFragment<E> &frag = ent->value;
+
+    if (host && get_key(host).ends_with(get_key(ent))) {
+      i64 offset = host->keylen - ent->keylen;
+      if (offset % entsize == 0 && offset % (1 << frag.p2align) == 0 &&
+          frag.p2align <= host->value.p2align) {
+        frag.is_tail = true;
+        tails.push_back({&frag, &host->value, offset});
+        continue;
+      }
+    }
+    host = ent;
+  }
+
+  static Counter counter("tail_merged_strings");
+  counter += tails.size();
+  return tails;
+}
+
 template <typename E>
 void MergedSection<E>::compute_section_size(Context<E> &ctx) {
   if (!resolved)
     resolve(ctx);
 
+  std::vector<TailFragment> tails;
+  if (ctx.arg.tail_merge_strings && (this->shdr.sh_flags & SHF_STRINGS))
+    tails = tail_merge_strings(ctx);
+
   std::vector<i64> sizes(map.NUM_SHARDS);
   Atomic<i64> alignment = 1;
+  copy_ranges.clear();
+  copy_ranges.resize(map.NUM_SHARDS);
 
   tbb::parallel_for((i64)0, map.NUM_SHARDS, [&](i64 i) {
     using Entry = typename decltype(map)::Entry;
-    std::vector<Entry *> entries = map.get_sorted_entries(i);
+
+    // Fragments without a rank, such as ones added by the linker,
+    // are ordered by contents.
+    std::vector<Entry *> entries =
+      map.get_sorted_entries(i, [](Entry *a, Entry *b) {
+        if (a->value.offset != b->value.offset)
+          return a->value.offset < b->value.offset;
+        if (a->keylen != b->keylen)
+          return a->keylen < b->keylen;
+        return memcmp(a->key, b->key, a->keylen) < 0;
+      });
 
     i64 offset = 0;
     i64 p2align = 0;
+    std::vector<CopyRange> &ranges = copy_ranges[i];
 
     for (Entry *ent : entries) {
       SectionFragment<E> &frag = ent->value;
+      if (frag.is_tail)
+        continue;
+
       if (frag.is_alive) {
         offset = align_to(offset, 1 << frag.p2align);
         frag.offset = offset;
+
+        // Fragments that are laid out in the same order as in an input
+        // file can be copied with a single memcpy.
+        CopyRange *last = ranges.empty() ? nullptr : &ranges.back();
+        if (last && last->src + last->size == ent->key &&
+            last->offset + last->size == offset)
+          last->size += ent->keylen;
+        else
+          ranges.push_back({ent->key, (u32)offset, ent->keylen});
+
         offset += ent->keylen;
         p2align = std::max<i64>(p2align, frag.p2align);
+      } else {
+        frag.offset = -1;
       }
     }
 
@@ -2181,7 +2670,6 @@ void MergedSection<E>::compute_section_size(Context<E> &ctx) {
     merged_strings += entries.size();
   });
 
-  i64 shard_size = map.nbuckets / map.NUM_SHARDS;
   shard_offsets.resize(map.NUM_SHARDS + 1);
 
   for (i64 i = 1; i < map.NUM_SHARDS + 1; i++)
@@ -2189,11 +2677,14 @@ void MergedSection<E>::compute_section_size(Context<E> &ctx) {
       align_to(shard_offsets[i - 1] + sizes[i - 1], alignment);
 
   tbb::parallel_for((i64)1, map.NUM_SHARDS, [&](i64 i) {
-    for (i64 j = shard_size * i; j < shard_size * (i + 1); j++) {
-      SectionFragment<E> &frag = map.entries[j].value;
-      if (frag.is_alive)
-        frag.offset += shard_offsets[i];
-    }
+    map.for_each_entry(i, [&](auto &ent) {
+      if (ent.value.is_alive && !ent.value.is_tail)
+        ent.value.offset += shard_offsets[i];
+    });
+  });
+
+  tbb::parallel_for_each(tails, [](TailFragment &t) {
+    t.frag->offset = t.host->offset + t.offset;
   });
 
   this->shdr.sh_size = shard_offsets[map.NUM_SHARDS];
@@ -2210,32 +2701,49 @@ void MergedSection<E>::copy_buf(Context<E> &ctx) {
 
 template <typename E>
 void MergedSection<E>::write_to(Context<E> &ctx, u8 *buf, ElfRel<E> *rel) {
-  i64 shard_size = map.nbuckets / map.NUM_SHARDS;
-
+  // Copy strings using the ranges computed by compute_section_size().
+  // Walking the ranges is much faster than walking the hash table
+  // because the output is written sequentially and adjacent fragments
+  // are copied at once.
   tbb::parallel_for((i64)0, map.NUM_SHARDS, [&](i64 i) {
-    // There might be gaps between strings to satisfy alignment requirements.
-    // If that's the case, we need to zero-clear them.
-    if (this->shdr.sh_addralign > 1)
-      memset(buf + shard_offsets[i], 0, shard_offsets[i + 1] - shard_offsets[i]);
-
-    // Copy strings
-    for (i64 j = shard_size * i; j < shard_size * (i + 1); j++)
-      if (const char *key = map.entries[j].key)
-        if (SectionFragment<E> &frag = map.entries[j].value; frag.is_alive)
-          memcpy(buf + frag.offset, key, map.entries[j].keylen);
+    std::vector<CopyRange> &ranges = copy_ranges[i];
+    u8 *base = buf + shard_offsets[i];
+    i64 shard_size = shard_offsets[i + 1] - shard_offsets[i];
+
+    // There might be gaps between strings to satisfy alignment
+    // requirements, so we need to zero-clear them.
+    auto gap_end = [&](i64 j) -> i64 {
+      return (j < ranges.size()) ? ranges[j].offset : shard_size;
+    };
+
+    memset(base, 0, gap_end(0));
+
+    tbb::parallel_for(tbb::blocked_range<i64>(0, ranges.size(), 4096),
+                      [&](const tbb::blocked_range<i64> &r) {
+      for (i64 j = r.begin(); j < r.end(); j++) {
+        if (j + 16 < ranges.size())
+          __builtin_prefetch(ranges[j + 16].src);
+
+        CopyRange &range = ranges[j];
+        memcpy(base + range.offset, range.src, range.size);
+
+        i64 end = range.offset + range.size;
+        memset(base + end, 0, gap_end(j + 1) - end);
+      }
+    });
   });
 }
 
 template <typename E>
 void MergedSection<E>::print_stats(Context<E> &ctx) {
   i64 used = 0;
-  for (i64 i = 0; i < map.nbuckets; i++)
-    if (map.entries[i].key)
-      used++;
+  for (i64 i = 0; i < map.NUM_SHARDS; i++)
+    map.for_each_entry(i, [&](auto &ent) { used++; });
 
   Out(ctx) << this->name
            << " estimation=" << estimator.get_cardinality()
-           << " actual=" << used;
+           << " actual=" << used
+           << " map_bytes=" << map.nbuckets * sizeof(*map.entries);
 }
 
 template <typename E>
@@ -2243,37 +2751,67 @@ void EhFrameSection<E>::construct(Context<E> &ctx) {
   Timer t(ctx, "eh_frame");
 
   // Remove dead FDEs and assign them offsets within their corresponding
-  // CIE group.
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+  // CIE group. A CIE is alive only if it is referenced by a live FDE;
+  // CIEs of functions removed by --gc-sections or ICF are discarded.
+  for_each_obj_largest_first<E>(ctx, [&](ObjectFile<E> *file) {
     std::erase_if(file->fdes, [](FdeRecord<E> &fde) { return !fde.is_alive; });
 
     i64 offset = 0;
     for (FdeRecord<E> &fde : file->fdes) {
       fde.output_offset = offset;
       offset += fde.size(*file);
+      file->cies[fde.cie_idx].is_alive = true;
     }
     file->fde_size = offset;
   });
 
-  // Uniquify CIEs and assign offsets to them.
-  std::vector<CieRecord<E> *> leaders;
-  auto find_leader = [&](CieRecord<E> &cie) -> CieRecord<E> * {
-    for (CieRecord<E> *leader : leaders)
-      if (cie_equals(*leader, cie))
-        return leader;
-    return nullptr;
-  };
+  // Uniquify CIEs and assign offsets to them. Hash values of CIEs are
+  // computed in parallel first, so that we can find a leader for each
+  // CIE by a hash table lookup. Leaders are then chosen sequentially in
+  // file order to make the output deterministic.
+  std::vector<std::vector<u64>> hashes(ctx.objs.size());
 
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> &file = *ctx.objs[i];
+    hashes[i].resize(file.cies.size());
+
+    for (i64 j = 0; j < file.cies.size(); j++) {
+      CieRecord<E> &cie = file.cies[j];
+      if (!cie.is_alive)
+        continue;
+
+      u64 h = hash_string(cie.get_contents());
+      for (const ElfRel<E> &rel : cie.get_rels()) {
+        h = combine_hash(h, rel.r_offset - cie.input_offset);
+        h = combine_hash(h, rel.r_type);
+        h = combine_hash(h, (u64)file.symbols[rel.r_sym]);
+        h = combine_hash(h, get_addend(cie.input_section, rel));
+      }
+      hashes[i][j] = h;
+    }
+  });
+
+  std::unordered_map<u64, std::vector<CieRecord<E> *>> leaders;
   i64 offset = 0;
-  for (ObjectFile<E> *file : ctx.objs) {
-    for (CieRecord<E> &cie : file->cies) {
-      if (CieRecord<E> *leader = find_leader(cie)) {
-        cie.output_offset = leader->output_offset;
+
+  for (i64 i = 0; i < ctx.objs.size(); i++) {
+    for (i64 j = 0; j < ctx.objs[i]->cies.size(); j++) {
+      CieRecord<E> &cie = ctx.objs[i]->cies[j];
+      if (!cie.is_alive)
+        continue;
+
+      std::vector<CieRecord<E> *> &vec = leaders[hashes[i][j]];
+      auto it = std::find_if(vec.begin(), vec.end(), [&](CieRecord<E> *x) {
+        return cie_equals(*x, cie);
+      });
+
+      if (it != vec.end()) {
+        cie.output_offset = (*it)->output_offset;
       } else {
         cie.output_offset = offset;
         cie.is_leader = true;
         offset += cie.size();
-        leaders.push_back(&cie);
+        vec.push_back(&cie);
       }
     }
   }
@@ -2332,7 +2870,7 @@ void EhFrameSection<E>::copy_buf(Context<E> &ctx) {
     // Copy FDEs.
     for (i64 i = 0; i < file->fdes.size(); i++) {
       FdeRecord<E> &fde = file->fdes[i];
-      std::span<ElfRel<E>> rels = fde.get_rels(*file);
+      std::span<const ElfRel<E>> rels = fde.get_rels(*file);
       i64 offset = file->fde_offset + fde.output_offset;
 
       std::string_view contents = fde.get_contents(*file);
@@ -2369,13 +2907,13 @@ void EhFrameSection<E>::copy_buf(Context<E> &ctx) {
   // Write a terminator.
   *(U32<E> *)(base + this->shdr.sh_size - 4) = 0;
 
-  // Sort .eh_frame_hdr contents.
-  if (eh_hdr) {
-    tbb::parallel_sort(eh_hdr, eh_hdr + ctx.eh_frame_hdr->num_fdes,
-                      [](const HdrEntry &a, const HdrEntry &b) {
-      return a.init_addr < b.init_addr;
+  // Sort .eh_frame_hdr contents. init_addr is a signed value, so we flip
+  // the sign bit to make the keys sortable as unsigned integers.
+  if (eh_hdr)
+    radix_sort(std::span(eh_hdr, ctx.eh_frame_hdr->num_fdes),
+               [](const HdrEntry &ent) {
+      return (u32)(i32)ent.init_addr ^ 0x8000'0000;
     });
-  }
 }
 
 template <typename E>
@@ -2400,6 +2938,256 @@ void EhFrameHdrSection<E>::copy_buf(Context<E> &ctx) {
   *(U32<E> *)(base + 8) = num_fdes;
 }
 
+// SFrame is a compact format describing how to find the CFA, the frame
+// pointer and the return address at each instruction. Unlike .eh_frame,
+// it can be interpreted without a DWARF expression evaluator, so
+// profilers use it to unwind stacks in the kernel or in a signal
+// handler. GNU as emits it if -Wa,--gsframe is given.
+//
+// An .sframe section consists of a header, an array of function
+// descriptor entries (FDEs) and a list of frame row entries (FREs). An
+// FDE refers to its function with a relocated 32-bit offset and to its
+// FREs with an offset into the FRE list. FREs are relative to their
+// function and don't need relocation.
+//
+// We merge input .sframe sections by concatenating their FREs and
+// sorting all FDEs by function address, so that the runtime can look up
+// an FDE with binary search. FDEs for functions removed by
+// --gc-sections or ICF are discarded along with their FREs.
+template <typename E>
+struct SFrameHdr {
+  U16<E> magic;
+  u8 version;
+  u8 flags;
+  u8 abi_arch;
+  i8 cfa_fixed_fp_offset;
+  i8 cfa_fixed_ra_offset;
+  u8 auxhdr_len;
+  U32<E> num_fdes;
+  U32<E> num_fres;
+  U32<E> fre_len;
+  U32<E> fdeoff;
+  U32<E> freoff;
+};
+
+// This is a version 2 FDE. A version 1 FDE lacks the last two members.
+template <typename E>
+struct SFrameFde {
+  I32<E> func_start_addr;
+  U32<E> func_size;
+  U32<E> func_start_fre_off;
+  U32<E> func_num_fres;
+  u8 func_info;
+  u8 func_rep_size;
+  U16<E> padding;
+};
+
+static constexpr u16 SFRAME_MAGIC = 0xdee2;
+static constexpr u8 SFRAME_F_FDE_SORTED = 1;
+static constexpr u8 SFRAME_F_FRAME_POINTER = 2;
+static constexpr u8 SFRAME_F_FDE_FUNC_START_PCREL = 4;
+
+static i64 get_sframe_fde_size(u8 version) {
+  return (version == 1) ? 17 : 20;
+}
+
+template <typename E>
+void SFrameSection<E>::construct(Context<E> &ctx) {
+  Timer t(ctx, "sframe");
+
+  for (ObjectFile<E> *file : ctx.objs)
+    for (InputSection<E> *isec : file->sframe_sections)
+      members.push_back({isec});
+
+  if (members.empty())
+    return;
+
+  // All input sections must agree on the format version, the target
+  // and the other per-section parameters. Otherwise, we can't merge
+  // them into a single section, and we don't create .sframe.
+  //
+  // SFRAME_F_FRAME_POINTER is an exception. It says that all functions
+  // in the section preserve the frame pointer, so the output has it only
+  // if all inputs have it.
+  auto get_hdr = [&](InputSection<E> *isec) -> SFrameHdr<E> & {
+    std::string_view contents = isec->contents;
+    SFrameHdr<E> &hdr = *(SFrameHdr<E> *)contents.data();
+
+    if (contents.size() < sizeof(hdr) || hdr.magic != SFRAME_MAGIC ||
+        (hdr.version != 1 && hdr.version != 2))
+      Fatal(ctx) << *isec << ": corrupted or unsupported .sframe section";
+    return hdr;
+  };
+
+  SFrameHdr<E> &first = get_hdr(members[0].isec);
+  u8 mask = (u8)~(SFRAME_F_FDE_SORTED | SFRAME_F_FRAME_POINTER);
+  flags = first.flags | SFRAME_F_FDE_SORTED;
+
+  for (Member &m : members) {
+    SFrameHdr<E> &hdr = get_hdr(m.isec);
+    if (hdr.version != first.version || hdr.abi_arch != first.abi_arch ||
+        (hdr.flags & mask) != (first.flags & mask) ||
+        hdr.cfa_fixed_fp_offset != first.cfa_fixed_fp_offset ||
+        hdr.cfa_fixed_ra_offset != first.cfa_fixed_ra_offset) {
+      Warn(ctx) << *m.isec << ": .sframe section is incompatible with "
+                << *members[0].isec << "; .sframe is not created";
+      members.clear();
+      return;
+    }
+    flags &= hdr.flags | ~SFRAME_F_FRAME_POINTER;
+  }
+
+  i64 fde_size = get_sframe_fde_size(first.version);
+
+  // Find live FDEs and the sizes of their FREs.
+  tbb::parallel_for_each(members, [&](Member &m) {
+    InputSection<E> &isec = *m.isec;
+    std::string_view contents = isec.contents;
+    SFrameHdr<E> &hdr = *(SFrameHdr<E> *)contents.data();
+    std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+
+    i64 fde_begin = sizeof(hdr) + hdr.auxhdr_len + hdr.fdeoff;
+    i64 fre_begin = sizeof(hdr) + hdr.auxhdr_len + hdr.freoff;
+
+    if (contents.size() < fde_begin + hdr.num_fdes * fde_size ||
+        contents.size() < fre_begin + hdr.fre_len)
+      Fatal(ctx) << isec << ": corrupted .sframe section";
+
+    u8 *fre_end = (u8 *)contents.data() + fre_begin + hdr.fre_len;
+    i64 j = 0;
+
+    for (i64 i = 0; i < hdr.num_fdes; i++) {
+      i64 offset = fde_begin + i * fde_size;
+      SFrameFde<E> &fde = *(SFrameFde<E> *)(contents.data() + offset);
+
+      // Find the relocation for the function start address. Relocations
+      // are sorted by offset, and so are FDEs.
+      while (j < rels.size() && rels[j].r_offset < offset)
+        j++;
+      if (j == rels.size() || rels[j].r_offset != offset)
+        Fatal(ctx) << isec << ": .sframe FDE without a relocation";
+
+      Symbol<E> &sym = *isec.file.symbols[rels[j].r_sym];
+      InputSection<E> *target = sym.get_input_section();
+      if (!target || !target->is_alive || target->icf_thunk)
+        continue;
+
+      // Compute the size of the FREs. Each FRE consists of a start
+      // address, an info byte and stack offsets, whose sizes are encoded
+      // in the FDE's and the FRE's info bytes.
+      u8 *begin = (u8 *)contents.data() + fre_begin +
+                  fde.func_start_fre_off;
+      i64 addr_size = 1 << (fde.func_info & 0xf);
+      u8 *p = begin;
+
+      for (i64 k = 0; k < fde.func_num_fres && p < fre_end; k++) {
+        u8 info = p[addr_size];
+        i64 num_offsets = (info >> 1) & 0xf;
+        i64 offset_size = 1 << ((info >> 5) & 0b11);
+        p += addr_size + 1 + num_offsets * offset_size;
+      }
+
+      if (fre_end < p)
+        Fatal(ctx) << isec << ": corrupted .sframe section";
+
+      m.fdes.push_back({(u32)i, (u32)j,
+                        (u32)(begin - (u8 *)contents.data()),
+                        (u32)(p - begin)});
+      m.num_fres += fde.func_num_fres;
+    }
+  });
+
+  // Assign FDE indices and FRE offsets in the output.
+  for (Member &m : members) {
+    m.fde_idx = num_fdes;
+    m.fre_offset = fre_size;
+    num_fdes += m.fdes.size();
+    num_fres += m.num_fres;
+    for (FdeRef &ref : m.fdes)
+      fre_size += ref.fre_size;
+  }
+
+  if (num_fdes)
+    this->shdr.sh_size =
+      sizeof(SFrameHdr<E>) + num_fdes * fde_size + fre_size;
+}
+
+template <typename E>
+void SFrameSection<E>::copy_buf(Context<E> &ctx) {
+  u8 *base = ctx.buf + this->shdr.sh_offset;
+  SFrameHdr<E> &first = *(SFrameHdr<E> *)members[0].isec->contents.data();
+  i64 fde_size = get_sframe_fde_size(first.version);
+
+  u8 *fde_base = base + sizeof(SFrameHdr<E>);
+  u8 *fre_base = fde_base + num_fdes * fde_size;
+
+  struct Entry {
+    i64 addr;
+    u32 fre_offset;
+    SFrameFde<E> *fde;
+  };
+
+  std::vector<Entry> entries(num_fdes);
+
+  // Copy FREs and compute the function address of each FDE.
+  tbb::parallel_for_each(members, [&](Member &m) {
+    InputSection<E> &isec = *m.isec;
+    u8 *contents = (u8 *)isec.contents.data();
+    SFrameHdr<E> &hdr = *(SFrameHdr<E> *)contents;
+    std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+    i64 fre_offset = m.fre_offset;
+
+    for (i64 i = 0; i < m.fdes.size(); i++) {
+      FdeRef &ref = m.fdes[i];
+      const ElfRel<E> &rel = rels[ref.rel_idx];
+      Symbol<E> &sym = *isec.file.symbols[rel.r_sym];
+
+      i64 offset = sizeof(hdr) + hdr.auxhdr_len + hdr.fdeoff +
+                   ref.idx * fde_size;
+      entries[m.fde_idx + i] = {
+        (i64)sym.get_addr(ctx) + get_addend(isec, rel),
+        (u32)fre_offset,
+        (SFrameFde<E> *)(contents + offset),
+      };
+
+      memcpy(fre_base + fre_offset, contents + ref.fre_offset, ref.fre_size);
+      fre_offset += ref.fre_size;
+    }
+  });
+
+  tbb::parallel_sort(entries, [](const Entry &a, const Entry &b) {
+    return std::tuple(a.addr, a.fre_offset) <
+           std::tuple(b.addr, b.fre_offset);
+  });
+
+  // Write FDEs. A function address is relative to the beginning of the
+  // section or, if SFRAME_F_FDE_FUNC_START_PCREL is set, to itself.
+  tbb::parallel_for((i64)0, num_fdes, [&](i64 i) {
+    Entry &ent = entries[i];
+    u8 *loc = fde_base + i * fde_size;
+    memcpy(loc, ent.fde, fde_size);
+
+    u64 P = this->shdr.sh_addr;
+    if (first.flags & SFRAME_F_FDE_FUNC_START_PCREL)
+      P += loc - base;
+
+    SFrameFde<E> &fde = *(SFrameFde<E> *)loc;
+    fde.func_start_addr = ent.addr - P;
+    fde.func_start_fre_off = ent.fre_offset;
+  });
+
+  // Write the header.
+  SFrameHdr<E> &hdr = *(SFrameHdr<E> *)base;
+  hdr = first;
+  hdr.flags = flags;
+  hdr.auxhdr_len = 0;
+  hdr.num_fdes = num_fdes;
+  hdr.num_fres = num_fres;
+  hdr.fre_len = fre_size;
+  hdr.fdeoff = 0;
+  hdr.freoff = num_fdes * fde_size;
+}
+
 template <typename E>
 void EhFrameRelocSection<E>::update_shdr(Context<E> &ctx) {
   tbb::enumerable_thread_specific<i64> count;
@@ -2837,24 +3625,74 @@ void NotePropertySection<E>::copy_buf(Context<E> &ctx) {
 }
 
 template <typename E>
-CompressedSection<E>::CompressedSection(Context<E> &ctx, Chunk<E> &chunk) {
-  assert(chunk.name.starts_with(".debug"));
+CompressedSection<E>::CompressedSection(Context<E> &ctx, Chunk<E> &chunk,
+                                        CompressKind kind, i64 level) {
   this->name = chunk.name;
   this->is_compressed = true;
 
-  this->uncompressed_data.resize(chunk.shdr.sh_size);
-  u8 *buf = this->uncompressed_data.data();
+  // Split the section into groups of members. Each group is relocated
+  // and compressed independently, and its uncompressed contents are
+  // discarded as soon as it is compressed. This way, we don't have to
+  // keep an entire uncompressed section in memory, and relocation and
+  // compression of different groups can run in parallel.
+  //
+  // If --dwp is given, we need the entire uncompressed contents later,
+  // so we write the whole section to a buffer first. (.gdb_index has
+  // already been created by create_gdb_index_early() at this point.)
+  std::vector<i64> groups = {0};
+  CompressorInput input;
+  bool keep_data = chunk.name.starts_with(".debug") && !ctx.arg.dwp.empty();
+
+  if (OutputSection<E> *osec = chunk.to_osec(); osec && !keep_data) {
+    constexpr i64 GROUP_SIZE = 4 * 1024 * 1024;
+    std::vector<InputSection<E> *> &members = osec->members;
+
+    i64 start = 0;
+    for (i64 i = 0; i < members.size(); i++) {
+      if (members[i]->offset - start >= GROUP_SIZE) {
+        groups.push_back(i);
+        start = members[i]->offset;
+      }
+    }
+    groups.push_back(members.size());
+
+    input = [&ctx, &chunk, osec, &groups](i64 idx, std::vector<u8> &buf) {
+      std::vector<InputSection<E> *> &members = osec->members;
+      i64 begin = groups[idx];
+      i64 end = groups[idx + 1];
+      i64 start = (idx == 0) ? 0 : members[begin]->offset;
+      i64 stop =
+        (end == members.size()) ? (i64)chunk.shdr.sh_size : members[end]->offset;
+
+      // Paddings between members are zero-filled by resize().
+      buf.resize(stop - start);
+      tbb::parallel_for(begin, end, [&](i64 i) {
+        members[i]->write_to(ctx, buf.data() + members[i]->offset - start);
+      });
+      return std::string_view((char *)buf.data(), buf.size());
+    };
+  } else {
+    this->uncompressed_data.resize(chunk.shdr.sh_size);
+    chunk.write_to(ctx, this->uncompressed_data.data(), nullptr);
+    groups.push_back(1);
 
-  chunk.write_to(ctx, buf, nullptr);
+    input = [this](i64 idx, std::vector<u8> &buf) {
+      return std::string_view((char *)this->uncompressed_data.data(),
+                              this->uncompressed_data.size());
+    };
+  }
 
-  switch (ctx.arg.compress_debug_sections) {
+  switch (kind) {
   case COMPRESS_ZLIB:
     chdr.ch_type = ELFCOMPRESS_ZLIB;
-    compressor.reset(new ZlibCompressor(buf, chunk.shdr.sh_size));
+    compressor.reset(new ZlibCompressor(groups.size() - 1, input,
+                                        (level == -1) ? 1 : level));
     break;
   case COMPRESS_ZSTD:
     chdr.ch_type = ELFCOMPRESS_ZSTD;
-    compressor.reset(new ZstdCompressor(buf, chunk.shdr.sh_size));
+    compressor.reset(new ZstdCompressor(groups.size() - 1, input,
+                                        (level == -1) ? 3 : level,
+                                        ctx.arg.zstd_seek_table));
     break;
   default:
     unreachable();
@@ -2869,8 +3707,8 @@ CompressedSection<E>::CompressedSection(Context<E> &ctx, Chunk<E> &chunk) {
   this->shdr.sh_size = sizeof(chdr) + compressor->compressed_size;
   this->shndx = chunk.shndx;
 
-  // We don't need to keep the original data unless --gdb-index is given.
-  if (!ctx.arg.gdb_index) {
+  // We don't need to keep the original data unless --dwp is given.
+  if (!keep_data) {
     this->uncompressed_data.clear();
     this->uncompressed_data.shrink_to_fit();
   }
@@ -2923,8 +3761,9 @@ void RelocSection<E>::update_shdr(Context<E> &ctx) {
   this->shdr.sh_info = output_section.shndx;
 }
 
+// Writes relocations for the idx'th member of the output section.
 template <typename E>
-void RelocSection<E>::copy_buf(Context<E> &ctx) {
+void RelocSection<E>::write_rels(Context<E> &ctx, i64 idx) {
   auto get_symidx_addend = [&](InputSection<E> &isec, const ElfRel<E> &rel)
       -> std::pair<i64, i64> {
     Symbol<E> &sym = *isec.file.symbols[rel.r_sym];
@@ -2934,12 +3773,12 @@ void RelocSection<E>::copy_buf(Context<E> &ctx) {
       i64 frag_addend;
       std::tie(frag, frag_addend) = isec.get_fragment(ctx, rel);
       if (frag)
-        return {frag->output_section.shndx, frag->offset + frag_addend};
+        return {frag->get_output_section(ctx).shndx, frag->offset + frag_addend};
     }
 
     if (sym.esym().st_type == STT_SECTION) {
       if (SectionFragment<E> *frag = sym.get_frag())
-        return {frag->output_section.shndx,
+        return {frag->get_output_section(ctx).shndx,
                 frag->offset + sym.value + get_addend(isec, rel)};
 
       InputSection<E> *isec2 = sym.get_input_section();
@@ -2970,13 +3809,23 @@ void RelocSection<E>::copy_buf(Context<E> &ctx) {
     }
   };
 
-  tbb::parallel_for((i64)0, (i64)output_section.members.size(), [&](i64 i) {
-    ElfRel<E> *buf = (ElfRel<E> *)(ctx.buf + this->shdr.sh_offset) + offsets[i];
-    InputSection<E> &isec = *output_section.members[i];
-    std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+  ElfRel<E> *buf = (ElfRel<E> *)(ctx.buf + this->shdr.sh_offset) + offsets[idx];
+  InputSection<E> &isec = *output_section.members[idx];
+  std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
 
-    for (i64 j = 0; j < rels.size(); j++)
-      write(buf[j], isec, rels[j]);
+  for (i64 j = 0; j < rels.size(); j++)
+    write(buf[j], isec, rels[j]);
+}
+
+template <typename E>
+void RelocSection<E>::copy_buf(Context<E> &ctx) {
+  // With --emit-relocs=alloc, relocations have already been written by
+  // OutputSection::write_to().
+  if (ctx.arg.emit_relocs_alloc)
+    return;
+
+  tbb::parallel_for((i64)0, (i64)output_section.members.size(), [&](i64 i) {
+    write_rels(ctx, i);
   });
 }
 
@@ -3039,6 +3888,7 @@ template class GnuHashSection<E>;
 template class MergedSection<E>;
 template class EhFrameSection<E>;
 template class EhFrameHdrSection<E>;
+template class SFrameSection<E>;
 template class EhFrameRelocSection<E>;
 template class CopyrelSection<E>;
 template class VersymSection<E>;
@@ -1,11 +1,27 @@
 #include "mold.h"
+#include "blake3.h"
 
 #include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <unordered_set>
+
+#ifdef __linux__
+# include <sys/ioctl.h>
+#endif
+
+// Defined in <linux/fs.h>, which we don't include because it defines
+// macros such as BLOCK_SIZE that conflict with our identifiers.
+#if defined(__linux__) && !defined(FICLONE)
+# define FICLONE _IOW(0x94, 9, int)
+#endif
 
 namespace mold {
 
@@ -18,20 +34,23 @@ static u32 get_umask() {
 template <typename E>
 static int
 open_or_create_file(Context<E> &ctx, std::string path, std::string tmpfile,
-                    int perm) {
+                    int perm, bool &is_new) {
   // Reuse an existing file if exists and writable because on Linux,
   // writing to an existing file is much faster than creating a fresh
   // file and writing to it.
   if (ctx.overwrite_output_file && rename(path.c_str(), tmpfile.c_str()) == 0) {
     i64 fd = ::open(tmpfile.c_str(), O_RDWR | O_CREAT, perm);
-    if (fd != -1)
+    if (fd != -1) {
+      is_new = false;
       return fd;
+    }
     unlink(tmpfile.c_str());
   }
 
-  i64 fd = ::open(tmpfile.c_str(), O_RDWR | O_CREAT, perm);
+  i64 fd = ::open(tmpfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, perm);
   if (fd == -1)
     Fatal(ctx) << "cannot open " << tmpfile << ": " << errno_string();
+  is_new = true;
   return fd;
 }
 
@@ -44,7 +63,7 @@ public:
     std::string tmpfile =
       path_dirname(path) / ("." + path_filename(path) + "." + pid);
 
-    this->fd = open_or_create_file(ctx, path, tmpfile, perm);
+    this->fd = open_or_create_file(ctx, path, tmpfile, perm, this->is_zeroed);
 
     if (fchmod(this->fd, perm & ~get_umask()) == -1)
       Fatal(ctx) << "fchmod failed: " << errno_string();
@@ -103,11 +122,114 @@ private:
   int fd2 = -1;
 };
 
+// BufferedOutputFile is for --no-mmap-output. It builds the output image
+// in anonymous memory and writes it to a temporary file with pwrite(2)
+// at the end. Large writes are issued from multiple threads to keep the
+// storage busy.
+template <typename E>
+class BufferedOutputFile : public OutputFile<E> {
+public:
+  BufferedOutputFile(Context<E> &ctx, std::string path, i64 filesize, int perm)
+    : OutputFile<E>(path, filesize, false) {
+    std::string pid = std::to_string(getpid());
+    std::string tmpfile =
+      path_dirname(path) / ("." + path_filename(path) + "." + pid);
+
+    bool is_new;
+    this->fd = open_or_create_file(ctx, path, tmpfile, perm, is_new);
+
+    if (fchmod(this->fd, perm & ~get_umask()) == -1)
+      Fatal(ctx) << "fchmod failed: " << errno_string();
+
+    if (ftruncate(this->fd, filesize) == -1)
+      Fatal(ctx) << "ftruncate failed: " << errno_string();
+
+    output_tmpfile = (char *)save_string(ctx, tmpfile).data();
+
+#ifdef __linux__
+    fallocate(this->fd, 0, 0, filesize);
+#endif
+
+    // Unlike file-backed mappings, anonymous memory can be backed by
+    // transparent huge pages on any file system. We align the buffer to
+    // a huge page boundary so that OutputFile::open()'s MADV_HUGEPAGE
+    // covers as much of it as possible. That reduces the number of page
+    // faults and TLB misses while writing the output image.
+    map_size = filesize + HUGE_PAGE_SIZE;
+    map = (u8 *)mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+      Fatal(ctx) << path << ": mmap failed: " << errno_string();
+    interleave_memory(map, map_size);
+
+    this->buf = map + align_to((uintptr_t)map, HUGE_PAGE_SIZE) - (uintptr_t)map;
+    this->is_zeroed = true;
+  }
+
+  ~BufferedOutputFile() {
+    if (fd2 != -1)
+      ::close(fd2);
+  }
+
+  void close(Context<E> &ctx) override {
+    Timer t(ctx, "close_file");
+
+    {
+      Timer t2(ctx, "flush_output_file", &t);
+      constexpr i64 BLOCK_SIZE = 16 * 1024 * 1024;
+      i64 num_blocks = align_to(this->filesize, BLOCK_SIZE) / BLOCK_SIZE;
+
+      tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+        i64 offset = i * BLOCK_SIZE;
+        i64 size = std::min<i64>(BLOCK_SIZE, this->filesize - offset);
+        write_fully(ctx, this->buf + offset, size, offset);
+      });
+
+      if (!this->buf2.empty())
+        write_fully(ctx, this->buf2.data(), this->buf2.size(), this->filesize);
+    }
+
+    munmap(map, map_size);
+    ::close(this->fd);
+
+    // See MemoryMappedOutputFile::close() for why we do this.
+    fd2 = ::open(this->path.c_str(), O_RDONLY);
+    if (fd2 != -1)
+      unlink(this->path.c_str());
+
+    if (rename(output_tmpfile, this->path.c_str()) == -1)
+      Fatal(ctx) << this->path << ": rename failed: " << errno_string();
+    output_tmpfile = nullptr;
+  }
+
+private:
+  void write_fully(Context<E> &ctx, u8 *data, i64 size, i64 offset) {
+    while (size > 0) {
+      ssize_t n = pwrite(this->fd, data, size, offset);
+      if (n == -1 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        Fatal(ctx) << this->path << ": pwrite failed: " << errno_string();
+      data += n;
+      size -= n;
+      offset += n;
+    }
+  }
+
+  static constexpr i64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  u8 *map = nullptr;
+  i64 map_size = 0;
+  int fd2 = -1;
+};
+
 template <typename E>
 std::unique_ptr<OutputFile<E>>
 OutputFile<E>::open(Context<E> &ctx, std::string path, i64 filesize, int perm) {
   Timer t(ctx, "open_file");
 
+  bool to_memory = ctx.memory_link && path == ctx.arg.output;
+
   if (path.starts_with('/') && !ctx.arg.chroot.empty())
     path = ctx.arg.chroot + "/" + path_clean(path);
 
@@ -121,8 +243,12 @@ OutputFile<E>::open(Context<E> &ctx, std::string path, i64 filesize, int perm) {
   }
 
   OutputFile<E> *file;
-  if (is_special)
+  if (to_memory)
+    file = new MemoryOutputFile(ctx, path, filesize, perm);
+  else if (is_special)
     file = new MallocOutputFile(ctx, path, filesize, perm);
+  else if (!ctx.arg.mmap_output)
+    file = new BufferedOutputFile(ctx, path, filesize, perm);
   else
     file = new MemoryMappedOutputFile(ctx, path, filesize, perm);
 
@@ -139,11 +265,41 @@ OutputFile<E>::open(Context<E> &ctx, std::string path, i64 filesize, int perm) {
   madvise(file->buf, filesize, MADV_HUGEPAGE);
 #endif
 
-  if (ctx.arg.filler != -1)
+  if (ctx.arg.filler != -1) {
     memset(file->buf, ctx.arg.filler, filesize);
+    file->is_zeroed = false;
+  }
   return std::unique_ptr<OutputFile>(file);
 }
 
+// Clears a given range of the output buffer. If the buffer is known to
+// be zero, there's nothing to do. Otherwise, we are overwriting an
+// existing file, and instead of dirtying pages only to write zeros, we
+// punch a hole in the file for large ranges, which makes the kernel
+// discard the pages and read them back as zeros.
+template <typename E>
+void OutputFile<E>::zero_range(i64 offset, i64 size) {
+  if (size <= 0 || is_zeroed)
+    return;
+
+#ifdef __linux__
+  if (is_mmapped && fd != -1 && size >= 1024 * 1024) {
+    i64 page_size = sysconf(_SC_PAGESIZE);
+    i64 begin = align_to(offset, page_size);
+    i64 end = align_down(offset + size, page_size);
+
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  begin, end - begin) == 0) {
+      memset(buf + offset, 0, begin - offset);
+      memset(buf + end, 0, offset + size - end);
+      return;
+    }
+  }
+#endif
+
+  memset(buf + offset, 0, size);
+}
+
 // LockingOutputFile is similar to MemoryMappedOutputFile, but it doesn't
 // rename output files and instead acquires file lock using flock().
 template <typename E>
@@ -192,9 +348,495 @@ void LockingOutputFile<E>::close(Context<E> &ctx) {
   ::close(this->fd);
 }
 
+#ifdef __linux__
+static bool copy_range(int in_fd, i64 in_offset, int out_fd, i64 out_offset,
+                       i64 size) {
+  loff_t off_in = in_offset;
+  loff_t off_out = out_offset;
+
+  while (size > 0) {
+    ssize_t n = ::copy_file_range(in_fd, &off_in, out_fd, &off_out, size, 0);
+    if (n <= 0)
+      return false;
+    size -= n;
+  }
+  return true;
+}
+#endif
+
+// With --copy-file-range, large input sections that don't need to be
+// relocated are copied directly from input files to the output file
+// using copy_file_range(2) instead of through the output memory map.
+// The kernel copies data without moving it through userspace, and on
+// filesystems supporting reflinks (e.g. btrfs or XFS), it may even share
+// disk blocks between the input and the output.
+//
+// If copy_file_range(2) fails for any reason, a section is copied by
+// InputSection::write_to() as usual.
+template <typename E>
+void copy_verbatim_sections(Context<E> &ctx) {
+  Timer t(ctx, "copy_verbatim_sections");
+
+#ifdef __linux__
+  // Copying a small section isn't worth a system call.
+  constexpr i64 MIN_SIZE = 64 * 1024;
+
+  OutputFile<E> &out = *ctx.output_file;
+  bool enabled = out.is_mmapped && out.fd != -1 && ctx.buf == out.buf;
+
+  // Only output sections in ctx.chunks are written to the output buffer.
+  // (e.g. compressed debug sections are not.)
+  std::unordered_set<OutputSection<E> *> osecs;
+  for (Chunk<E> *chunk : ctx.chunks)
+    if (OutputSection<E> *osec = chunk->to_osec())
+      osecs.insert(osec);
+
+  auto is_eligible = [&](MappedFile *mf, InputSection<E> &isec) {
+    // A section whose endbr64s are rewritten with nops has to be copied
+    // by write_to().
+    if constexpr (is_x86_64<E>)
+      if (!isec.extra.endbr.empty())
+        return false;
+
+    return isec.is_alive &&
+           isec.shdr().sh_type != SHT_NOBITS &&
+           isec.output_section->shdr.sh_type != SHT_NOBITS &&
+           !(isec.shdr().sh_flags & SHF_COMPRESSED) &&
+           !isec.icf_thunk &&
+           isec.sh_size >= MIN_SIZE &&
+           isec.contents.size() == isec.sh_size &&
+           isec.get_rels(ctx).empty() &&
+           (u8 *)isec.contents.data() >= mf->data &&
+           (u8 *)isec.contents.data() + isec.sh_size <= mf->data + mf->size;
+  };
+
+  static Counter counter("copied_verbatim_bytes");
+
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    MappedFile *mf = file->mf;
+    int fd = -1;
+    bool open_failed = false;
+
+    for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+      // Leave other sections untouched, as debug sections may be being
+      // relocated in background for --async-debug-file.
+      if (!isec || !isec->output_section ||
+          !osecs.contains(isec->output_section))
+        continue;
+
+      isec->copied_verbatim = false;
+      if (!enabled || !mf || open_failed || !is_eligible(mf, *isec))
+        continue;
+
+      if (fd == -1) {
+        MappedFile *root = mf;
+        while (root->parent)
+          root = root->parent;
+
+        fd = ::open(root->name.c_str(), O_RDONLY);
+        if (fd == -1) {
+          open_failed = true;
+          continue;
+        }
+      }
+
+      i64 in_offset =
+        mf->get_offset() + ((u8 *)isec->contents.data() - mf->data);
+      i64 out_offset = isec->output_section->shdr.sh_offset + isec->offset;
+
+      if (copy_range(fd, in_offset, out.fd, out_offset, isec->sh_size)) {
+        isec->copied_verbatim = true;
+        counter += isec->sh_size;
+      }
+    }
+
+    if (fd != -1)
+      ::close(fd);
+  });
+#endif
+}
+
+// --early-writeback starts writeback of the file range of each chunk as
+// soon as the chunk is copied to the output buffer. Otherwise, the kernel
+// flushes most dirty pages of the output file only after mold exits.
+// sync_file_range(2) with just SYNC_FILE_RANGE_WRITE doesn't wait for
+// I/O, and pages modified again later (e.g. for a build ID) are simply
+// written again.
+template <typename E>
+void start_writeback(Context<E> &ctx, Chunk<E> &chunk) {
+#ifdef __linux__
+  OutputFile<E> &out = *ctx.output_file;
+  if (!out.is_mmapped || out.fd == -1 || ctx.buf != out.buf ||
+      chunk.shdr.sh_type == SHT_NOBITS || chunk.shdr.sh_size == 0)
+    return;
+
+  sync_file_range(out.fd, chunk.shdr.sh_offset, chunk.shdr.sh_size,
+                  SYNC_FILE_RANGE_WRITE);
+#endif
+}
+
+// --output-cache=DIR saves the output file to DIR when linking is done,
+// so that a later link with the same command line and the same input
+// files can just copy it instead of linking again.
+//
+// A cache entry consists of <key>.out, <key>.debug (for
+// --separate-debug-file), <key>.d (for --dependency-file) and
+// <key>.manifest, where the key is a hash of the current directory, the
+// fully-expanded command line and the identity of the mold executable.
+// The manifest lists the input files we read along with their stat(2)
+// results and content hashes. On lookup, a file whose stat(2) result
+// still matches is assumed to be unchanged, so a cache hit usually costs
+// only one stat(2) per input file. Otherwise, we compare content hashes.
+//
+// The manifest also records the modification times of the library
+// search directories, because adding a file to one of them can change
+// the result of a -l lookup without touching any of the files we read.
+// Its first line is the time at which the link that created it started.
+
+static constexpr i64 OUTPUT_CACHE_HASH_SIZE = 16;
+
+// Files modified within this many nanoseconds before the link that
+// created a manifest started may have been modified again within the
+// same timestamp granularity after it read them, so we don't trust
+// their stat(2) results.
+static constexpr i64 RACY_WINDOW = 2'000'000'000;
+
+static i64 link_start_time;
+
+static i64 get_mtime(const struct stat &st) {
+#ifdef __APPLE__
+  return (i64)st.st_mtimespec.tv_sec * 1'000'000'000 + st.st_mtimespec.tv_nsec;
+#else
+  return (i64)st.st_mtim.tv_sec * 1'000'000'000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+static std::string to_hex(u8 *buf, i64 size) {
+  std::string str;
+  for (i64 i = 0; i < size; i++) {
+    str += "0123456789abcdef"[buf[i] >> 4];
+    str += "0123456789abcdef"[buf[i] & 0xf];
+  }
+  return str;
+}
+
+static std::string hash_contents(u8 *data, i64 size) {
+  u8 digest[OUTPUT_CACHE_HASH_SIZE];
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  blake3_hasher_update(&hasher, data, size);
+  blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+  return to_hex(digest, sizeof(digest));
+}
+
+// Returns false if caching the output is not possible or not worth it
+// given the command line options.
+template <typename E>
+static bool is_cacheable(Context<E> &ctx) {
+  return !ctx.arg.output_cache.empty() &&
+         ctx.arg.output != "-" &&
+         ctx.arg.build_id.kind != BuildId::UUID &&
+         !ctx.arg.async_debug_file &&
+         !ctx.arg.lto_claim_helper &&
+         !ctx.arg.print_dependencies &&
+         !ctx.arg.print_gc_sections &&
+         !ctx.arg.print_icf_sections &&
+         !ctx.arg.print_map &&
+         !ctx.arg.perf &&
+         !ctx.arg.repro &&
+         !ctx.arg.stats &&
+         !ctx.arg.thinlto_index_pass &&
+         !ctx.arg.trace &&
+         ctx.arg.Map.empty() &&
+         ctx.arg.dry_run_layout.empty() &&
+         ctx.arg.dwp.empty() &&
+         ctx.arg.emit_delta.empty() &&
+         ctx.arg.input_stats.empty() &&
+         ctx.arg.perf_trace.empty() &&
+         ctx.arg.thinlto_distributor.empty() &&
+         ctx.arg.trace_symbol.empty();
+}
+
+template <typename E>
+static std::string get_output_cache_path(Context<E> &ctx) {
+  std::string key = "mold output cache v1\0"s + get_mold_version() + "\0"s +
+                    std::string(E::name) + "\0"s +
+                    std::filesystem::current_path().string();
+
+  // We can ignore the LTO resolution file name because we don't cache
+  // the output of LTO.
+  for (std::string_view arg : ctx.cmdline_args)
+    if (!is_lto_resolution_arg(arg))
+      key += "\0"s + std::string(arg);
+
+  // MOLD_DEBUG affects the contents of .comment.
+  if (char *env = getenv("MOLD_DEBUG"); env && env[0])
+    key += "\0MOLD_DEBUG\0"s + env;
+
+  // A rebuilt mold may produce a different output.
+  struct stat st;
+  if (stat("/proc/self/exe", &st) == 0)
+    key += "\0"s + std::to_string(st.st_dev) + ":" +
+           std::to_string(st.st_ino) + ":" + std::to_string(st.st_size) +
+           ":" + std::to_string(get_mtime(st));
+
+  return ctx.arg.output_cache + "/" +
+         hash_contents((u8 *)key.data(), key.size());
+}
+
+// Copies a file. On file systems that support reflinks, the new file
+// shares disk blocks with the original one. We don't use hard links
+// because the output file may be modified in place later (e.g. by
+// strip(1) or by mold itself), which would corrupt the cache.
+static bool copy_file(const std::string &from, const std::string &to,
+                      mode_t mode) {
+  int in = ::open(from.c_str(), O_RDONLY);
+  if (in == -1)
+    return false;
+
+  struct stat st;
+  if (fstat(in, &st) == -1) {
+    ::close(in);
+    return false;
+  }
+
+  int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if (out == -1) {
+    ::close(in);
+    return false;
+  }
+
+  bool ok = false;
+#ifdef __linux__
+  ok = ioctl(out, FICLONE, in) == 0 || copy_range(in, 0, out, 0, st.st_size);
+#endif
+
+  if (!ok) {
+    std::vector<char> buf(1024 * 1024);
+    ok = true;
+    for (;;) {
+      ssize_t n = ::read(in, buf.data(), buf.size());
+      if (n == 0)
+        break;
+      if (n < 0 || ::write(out, buf.data(), n) != n) {
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  ::close(in);
+  if (::close(out) == -1)
+    ok = false;
+  return ok;
+}
+
+// Copies a file to a temporary file and renames it so that other
+// processes never see a partially-written file.
+static bool install_file(const std::string &from, const std::string &to,
+                         mode_t mode) {
+  static std::atomic_int counter;
+  std::string tmp = to + "." + std::to_string(getpid()) + "." +
+                    std::to_string(counter++) + ".tmp";
+
+  if (copy_file(from, tmp, mode) && rename(tmp.c_str(), to.c_str()) == 0)
+    return true;
+  unlink(tmp.c_str());
+  return false;
+}
+
+// Returns true if a file listed in a manifest is unchanged. `created` is
+// the start time of the link that wrote the manifest.
+static bool is_unchanged(std::string_view line, i64 created) {
+  std::istringstream in{std::string(line)};
+  std::string kind;
+  in >> kind;
+
+  if (kind == "D") {
+    i64 mtime;
+    in >> mtime;
+    in.get();
+    std::string path;
+    std::getline(in, path);
+    if (in.fail())
+      return false;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1)
+      return mtime == -1;
+    return get_mtime(st) == mtime;
+  }
+
+  if (kind == "F") {
+    u64 dev, ino;
+    i64 size, mtime;
+    std::string hash, path;
+    in >> dev >> ino >> size >> mtime >> hash;
+    in.get();
+    std::getline(in, path);
+    if (in.fail())
+      return false;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1 || st.st_size != size)
+      return false;
+
+    if (st.st_dev == dev && st.st_ino == ino && get_mtime(st) == mtime &&
+        mtime < created - RACY_WINDOW)
+      return true;
+
+    std::string error;
+    std::unique_ptr<MappedFile> mf(open_file_impl(path, error));
+    return mf && hash_contents(mf->data, mf->size) == hash;
+  }
+
+  return false;
+}
+
+// Looks up the output cache and copies the cached output files if
+// found. Returns true on a cache hit.
+template <typename E>
+bool read_output_cache(Context<E> &ctx) {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  link_start_time = (i64)ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
+
+  if (!is_cacheable(ctx))
+    return false;
+
+  Timer t(ctx, "read_output_cache");
+  std::string path = get_output_cache_path(ctx);
+
+  std::ifstream in(path + ".manifest");
+  if (!in)
+    return false;
+
+  std::string kind;
+  i64 created;
+  in >> kind >> created;
+  in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  if (in.fail() || kind != "T")
+    return false;
+
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(in, line);)
+    lines.push_back(line);
+  if (lines.empty())
+    return false;
+
+  std::atomic_bool ok = true;
+  tbb::parallel_for((i64)0, (i64)lines.size(), [&](i64 i) {
+    if (ok && !is_unchanged(lines[i], created))
+      ok = false;
+  });
+  if (!ok)
+    return false;
+
+  struct stat st;
+  if (stat((path + ".out").c_str(), &st) == -1 ||
+      !install_file(path + ".out", ctx.arg.output, st.st_mode & 0777))
+    return false;
+
+  if (!ctx.arg.separate_debug_file.empty() &&
+      !install_file(path + ".debug", ctx.arg.separate_debug_file, 0666))
+    return false;
+
+  if (!ctx.arg.dependency_file.empty() &&
+      !install_file(path + ".d", ctx.arg.dependency_file, 0666))
+    return false;
+  return true;
+}
+
+// Saves the output files to the output cache.
+template <typename E>
+void write_output_cache(Context<E> &ctx) {
+  if (!is_cacheable(ctx) || ctx.has_error || ctx.has_warning)
+    return;
+
+  // LTO depends on the compiler that is not part of the cache key.
+  for (std::unique_ptr<ObjectFile<E>> &file : ctx.obj_pool)
+    if (file->is_lto_obj || file->is_gcc_offload_obj)
+      return;
+
+  Timer t(ctx, "write_output_cache");
+
+  std::vector<MappedFile *> files;
+  for (std::unique_ptr<MappedFile> &mf : ctx.mf_pool)
+    if (!mf->parent)
+      files.push_back(mf.get());
+
+  // Our manifest format is line-oriented.
+  for (MappedFile *mf : files)
+    if (mf->name.find('\n') != mf->name.npos)
+      return;
+  for (std::string &dir : ctx.arg.library_paths)
+    if (dir.find('\n') != dir.npos)
+      return;
+
+  std::vector<std::string> lines(files.size());
+  std::atomic_bool ok = true;
+
+  tbb::parallel_for((i64)0, (i64)files.size(), [&](i64 i) {
+    MappedFile *mf = files[i];
+    struct stat st;
+    if (stat(mf->name.c_str(), &st) == -1 || st.st_size != mf->size) {
+      ok = false;
+      return;
+    }
+
+    lines[i] = "F " + std::to_string(st.st_dev) + " " +
+               std::to_string(st.st_ino) + " " + std::to_string(st.st_size) +
+               " " + std::to_string(get_mtime(st)) + " " +
+               hash_contents(mf->data, mf->size) + " " + mf->name;
+  });
+
+  if (!ok)
+    return;
+
+  for (std::string &dir : ctx.arg.library_paths) {
+    struct stat st;
+    i64 mtime = (stat(dir.c_str(), &st) == 0) ? get_mtime(st) : -1;
+    lines.push_back("D " + std::to_string(mtime) + " " + dir);
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(ctx.arg.output_cache, ec);
+
+  std::string path = get_output_cache_path(ctx);
+
+  // The cache is just an optimization, so we ignore errors. The manifest
+  // is written last, so an entry without a manifest is never used.
+  struct stat st;
+  if (stat(ctx.arg.output.c_str(), &st) == -1 ||
+      !install_file(ctx.arg.output, path + ".out", st.st_mode & 0777))
+    return;
+
+  if (!ctx.arg.separate_debug_file.empty() &&
+      !install_file(ctx.arg.separate_debug_file, path + ".debug", 0666))
+    return;
+
+  if (!ctx.arg.dependency_file.empty() &&
+      !install_file(ctx.arg.dependency_file, path + ".d", 0666))
+    return;
+
+  std::string tmp = path + ".manifest." + std::to_string(getpid()) + ".tmp";
+  std::ofstream out(tmp);
+  out << "T " << link_start_time << '\n';
+  for (std::string &line : lines)
+    out << line << '\n';
+  out.close();
+
+  if (!out || rename(tmp.c_str(), (path + ".manifest").c_str()))
+    unlink(tmp.c_str());
+}
+
 using E = MOLD_TARGET;
 
 template class OutputFile<E>;
 template class LockingOutputFile<E>;
+template void copy_verbatim_sections(Context<E> &);
+template void start_writeback(Context<E> &, Chunk<E> &);
+template bool read_output_cache(Context<E> &);
+template void write_output_cache(Context<E> &);
 
 } // namespace mold
@@ -31,6 +31,9 @@ public:
 
     CloseHandle(map);
 
+    // CREATE_ALWAYS truncates an existing file.
+    this->is_zeroed = true;
+
     mold::output_buffer_start = this->buf;
     mold::output_buffer_end = this->buf + filesize;
   }
@@ -69,6 +72,8 @@ std::unique_ptr<OutputFile<E>>
 OutputFile<E>::open(Context<E> &ctx, std::string path, i64 filesize, int perm) {
   Timer t(ctx, "open_file");
 
+  bool to_memory = ctx.memory_link && path == ctx.arg.output;
+
   if (path.starts_with('/') && !ctx.arg.chroot.empty())
     path = ctx.arg.chroot + "/" + path_clean(path);
 
@@ -87,16 +92,26 @@ OutputFile<E>::open(Context<E> &ctx, std::string path, i64 filesize, int perm) {
   }
 
   OutputFile<E> *file;
-  if (is_special)
+  if (to_memory)
+    file = new MemoryOutputFile(ctx, path, filesize, perm);
+  else if (is_special)
     file = new MallocOutputFile(ctx, path, filesize, perm);
   else
     file = new MemoryMappedOutputFile(ctx, path, filesize, perm);
 
-  if (ctx.arg.filler != -1)
+  if (ctx.arg.filler != -1) {
     memset(file->buf, ctx.arg.filler, filesize);
+    file->is_zeroed = false;
+  }
   return std::unique_ptr<OutputFile<E>>(file);
 }
 
+template <typename E>
+void OutputFile<E>::zero_range(i64 offset, i64 size) {
+  if (size > 0 && !is_zeroed)
+    memset(buf + offset, 0, size);
+}
+
 template <typename E>
 LockingOutputFile<E>::LockingOutputFile(Context<E> &ctx, std::string path,
                                         int perm)
@@ -110,9 +125,27 @@ void LockingOutputFile<E>::resize(Context<E> &ctx, i64 filesize) {}
 template <typename E>
 void LockingOutputFile<E>::close(Context<E> &ctx) {}
 
+template <typename E>
+void copy_verbatim_sections(Context<E> &ctx) {}
+
+template <typename E>
+void start_writeback(Context<E> &ctx, Chunk<E> &chunk) {}
+
+template <typename E>
+bool read_output_cache(Context<E> &ctx) {
+  return false;
+}
+
+template <typename E>
+void write_output_cache(Context<E> &ctx) {}
+
 using E = MOLD_TARGET;
 
 template class OutputFile<E>;
 template class LockingOutputFile<E>;
+template void copy_verbatim_sections(Context<E> &);
+template void start_writeback(Context<E> &, Chunk<E> &);
+template bool read_output_cache(Context<E> &);
+template void write_output_cache(Context<E> &);
 
 } // namespace mold
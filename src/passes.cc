@@ -3,11 +3,14 @@
 
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <map>
 #include <optional>
 #include <regex>
 #include <shared_mutex>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
+#include <tbb/parallel_scan.h>
 #include <tbb/parallel_sort.h>
 #include <tbb/partitioner.h>
 #include <unordered_set>
@@ -22,44 +25,72 @@ int redo_main(Context<E> &ctx, int argc, char **argv) {
   std::string_view target = ctx.arg.emulation;
 
   if (target == I386::name)
-    return mold_main<I386>(argc, argv);
+    return mold_main<I386>(argc, argv, ctx.memory_link);
   if (target == ARM64LE::name)
-    return mold_main<ARM64LE>(argc, argv);
+    return mold_main<ARM64LE>(argc, argv, ctx.memory_link);
   if (target == ARM64BE::name)
-    return mold_main<ARM64BE>(argc, argv);
+    return mold_main<ARM64BE>(argc, argv, ctx.memory_link);
   if (target == ARM32::name)
-    return mold_main<ARM32>(argc, argv);
+    return mold_main<ARM32>(argc, argv, ctx.memory_link);
   if (target == RV64LE::name)
-    return mold_main<RV64LE>(argc, argv);
+    return mold_main<RV64LE>(argc, argv, ctx.memory_link);
   if (target == RV64BE::name)
-    return mold_main<RV64BE>(argc, argv);
+    return mold_main<RV64BE>(argc, argv, ctx.memory_link);
   if (target == RV32LE::name)
-    return mold_main<RV32LE>(argc, argv);
+    return mold_main<RV32LE>(argc, argv, ctx.memory_link);
   if (target == RV32BE::name)
-    return mold_main<RV32BE>(argc, argv);
+    return mold_main<RV32BE>(argc, argv, ctx.memory_link);
   if (target == PPC32::name)
-    return mold_main<PPC32>(argc, argv);
+    return mold_main<PPC32>(argc, argv, ctx.memory_link);
   if (target == PPC64V1::name)
-    return mold_main<PPC64V1>(argc, argv);
+    return mold_main<PPC64V1>(argc, argv, ctx.memory_link);
   if (target == PPC64V2::name)
-    return mold_main<PPC64V2>(argc, argv);
+    return mold_main<PPC64V2>(argc, argv, ctx.memory_link);
   if (target == S390X::name)
-    return mold_main<S390X>(argc, argv);
+    return mold_main<S390X>(argc, argv, ctx.memory_link);
   if (target == SPARC64::name)
-    return mold_main<SPARC64>(argc, argv);
+    return mold_main<SPARC64>(argc, argv, ctx.memory_link);
   if (target == M68K::name)
-    return mold_main<M68K>(argc, argv);
+    return mold_main<M68K>(argc, argv, ctx.memory_link);
   if (target == SH4LE::name)
-    return mold_main<SH4LE>(argc, argv);
+    return mold_main<SH4LE>(argc, argv, ctx.memory_link);
   if (target == SH4BE::name)
-    return mold_main<SH4BE>(argc, argv);
+    return mold_main<SH4BE>(argc, argv, ctx.memory_link);
   if (target == LOONGARCH32::name)
-    return mold_main<LOONGARCH32>(argc, argv);
+    return mold_main<LOONGARCH32>(argc, argv, ctx.memory_link);
   if (target == LOONGARCH64::name)
-    return mold_main<LOONGARCH64>(argc, argv);
+    return mold_main<LOONGARCH64>(argc, argv, ctx.memory_link);
   unreachable();
 }
 
+// Calls a given function for each object file in parallel, starting from
+// the largest one. tbb::parallel_for_each splits a vector into ranges,
+// so a huge file in the middle of ctx.objs may start late and become a
+// straggler that every other thread waits for at the end of a pass.
+// Here, worker tasks instead take files one by one from a shared counter
+// in descending order of size.
+template <typename E>
+void for_each_obj_largest_first(Context<E> &ctx,
+                                std::function<void(ObjectFile<E> *)> fn) {
+  auto get_size = [](ObjectFile<E> *file) -> i64 {
+    return file->mf ? file->mf->size : 0;
+  };
+
+  std::vector<ObjectFile<E> *> files = ctx.objs;
+  sort(files, [&](ObjectFile<E> *a, ObjectFile<E> *b) {
+    return get_size(a) > get_size(b);
+  });
+
+  i64 num_tasks = std::min<i64>(files.size(),
+                                tbb::this_task_arena::max_concurrency());
+  Atomic<i64> next = 0;
+
+  tbb::parallel_for((i64)0, num_tasks, [&](i64) {
+    for (i64 i = next++; i < files.size(); i = next++)
+      fn(files[i]);
+  }, tbb::simple_partitioner());
+}
+
 template <typename E>
 void apply_exclude_libs(Context<E> &ctx) {
   Timer t(ctx, "apply_exclude_libs");
@@ -80,6 +111,35 @@ void apply_exclude_libs(Context<E> &ctx) {
         file->exclude_libs = true;
 }
 
+// Insert symbols defined by DSOs to the symbol table for
+// --lazy-dso-symbols. See SharedFile::find_lazy_symbols().
+template <typename E>
+void intern_dso_symbols(Context<E> &ctx) {
+  Timer t(ctx, "intern_dso_symbols");
+
+  // Compiled LTO objects may refer to library functions that don't
+  // appear in IR symbol tables, so we need all symbols in that case.
+  bool intern_all = std::any_of(ctx.objs.begin(), ctx.objs.end(),
+                                [](ObjectFile<E> *file) {
+    return file->is_lto_obj || file->is_gcc_offload_obj;
+  });
+
+  // Version scripts may assign versions to symbols by name. Such
+  // symbols need to be found even if they are defined only by DSOs,
+  // so that we don't report them as missing.
+  for (VersionPattern &v : ctx.version_patterns)
+    if (!v.is_cpp && v.pattern.find_first_of("*?[") == v.pattern.npos)
+      get_symbol(ctx, v.pattern);
+
+  tbb::parallel_for_each(ctx.dsos, [&](SharedFile<E> *file) {
+    file->find_lazy_symbols(ctx, intern_all);
+  });
+
+  tbb::parallel_for_each(ctx.dsos, [&](SharedFile<E> *file) {
+    file->intern_lazy_symbols(ctx);
+  });
+}
+
 template <typename E>
 static bool has_debug_info_section(Context<E> &ctx) {
   for (ObjectFile<E> *file : ctx.objs)
@@ -88,6 +148,14 @@ static bool has_debug_info_section(Context<E> &ctx) {
   return false;
 }
 
+template <typename E>
+static bool has_sframe_section(Context<E> &ctx) {
+  for (ObjectFile<E> *file : ctx.objs)
+    if (!file->sframe_sections.empty())
+      return true;
+  return false;
+}
+
 template <typename E>
 void create_synthetic_sections(Context<E> &ctx) {
   auto push = [&](auto *x) {
@@ -144,12 +212,18 @@ void create_synthetic_sections(Context<E> &ctx) {
 
   if (!ctx.arg.dynamic_linker.empty())
     ctx.interp = push(new InterpSection<E>);
-  if (ctx.arg.build_id.kind != BuildId::NONE)
+  if (ctx.arg.build_id.kind != BuildId::NONE) {
     ctx.buildid = push(new BuildIdSection<E>);
+    ctx.buildid->contents = ctx.arg.build_id.value;
+  }
   if (ctx.arg.eh_frame_hdr)
     ctx.eh_frame_hdr = push(new EhFrameHdrSection<E>);
+  if (has_sframe_section(ctx))
+    ctx.sframe = push(new SFrameSection<E>);
   if (ctx.arg.gdb_index && has_debug_info_section(ctx))
     ctx.gdb_index = push(new GdbIndexSection<E>);
+  if (ctx.arg.debug_names && has_debug_info_section(ctx))
+    ctx.debug_names = push(new DebugNamesSection<E>);
   if (ctx.arg.z_relro && ctx.arg.section_order.empty() &&
       ctx.arg.z_separate_code != SEPARATE_LOADABLE_SEGMENTS)
     ctx.relro_padding = push(new RelroPaddingSection<E>);
@@ -237,6 +311,18 @@ static void mark_live_objects(Context<E> &ctx) {
   });
 }
 
+template <typename E>
+static void clear_symbol(Symbol<E> &sym) {
+  sym.origin = 0;
+  sym.value = -1;
+  sym.sym_idx = -1;
+  sym.ver_idx = VER_NDX_UNSPECIFIED;
+  sym.is_weak = false;
+  sym.is_imported = false;
+  sym.is_exported = false;
+  __atomic_store_n(&sym.file, nullptr, __ATOMIC_RELEASE);
+}
+
 template <typename E>
 static void clear_symbols(Context<E> &ctx) {
   std::vector<InputFile<E> *> files;
@@ -244,21 +330,22 @@ static void clear_symbols(Context<E> &ctx) {
   append(files, ctx.dsos);
 
   tbb::parallel_for_each(files, [](InputFile<E> *file) {
-    for (Symbol<E> *sym : file->get_global_syms()) {
-      if (__atomic_load_n(&sym->file, __ATOMIC_ACQUIRE) == file) {
-        sym->origin = 0;
-        sym->value = -1;
-        sym->sym_idx = -1;
-        sym->ver_idx = VER_NDX_UNSPECIFIED;
-        sym->is_weak = false;
-        sym->is_imported = false;
-        sym->is_exported = false;
-        __atomic_store_n(&sym->file, nullptr, __ATOMIC_RELEASE);
-      }
-    }
+    for (Symbol<E> *sym : file->get_global_syms())
+      if (__atomic_load_n(&sym->file, __ATOMIC_ACQUIRE) == file)
+        clear_symbol(*sym);
   });
 }
 
+// Returns true if a symbol's definition has been removed from the
+// output since it was resolved.
+template <typename E>
+static bool is_removed_definition(InputFile<E> *file, Symbol<E> &sym) {
+  if (!file->is_alive)
+    return true;
+  InputSection<E> *isec = sym.get_input_section();
+  return isec && !isec->is_alive;
+}
+
 template <typename E>
 void resolve_symbols(Context<E> &ctx) {
   Timer t(ctx, "resolve_symbols");
@@ -275,15 +362,11 @@ void resolve_symbols(Context<E> &ctx) {
       file->resolve_symbols(ctx);
     });
 
-    mark_live_objects(ctx);
+    std::vector<u8> was_alive(files.size());
+    for (i64 i = 0; i < files.size(); i++)
+      was_alive[i] = files[i]->is_alive;
 
-    // Now that we know the exact set of input files that are to be
-    // included in the output file, we want to redo symbol resolution.
-    // This is because symbols defined by object files in archive files
-    // may have risen as a result of mark_live_objects().
-    //
-    // To redo symbol resolution, we want to clear the state first.
-    clear_symbols(ctx);
+    mark_live_objects(ctx);
 
     // COMDAT elimination needs to happen exactly here.
     //
@@ -309,10 +392,39 @@ void resolve_symbols(Context<E> &ctx) {
                 isec->is_alive = false;
     });
 
-    // Redo symbol resolution
-    tbb::parallel_for_each(files, [&](InputFile<E> *file) {
-      if (file->is_alive)
-        file->resolve_symbols(ctx);
+    // Now that we know the exact set of input files that are to be
+    // included in the output file, we want to redo symbol resolution.
+    // This is because symbols defined by object files in archive files
+    // may have risen as a result of mark_live_objects().
+    //
+    // We don't need to redo it from scratch, though. A symbol's rank can
+    // only improve when its file was extracted from an archive. So, we
+    // re-resolve all symbols of newly-extracted files without clearing
+    // the current state. Only symbols that were resolved to files or
+    // sections that have been removed since then need to be cleared and
+    // resolved again with all the remaining files.
+    std::vector<std::vector<Symbol<E> *>> cleared(files.size());
+
+    tbb::parallel_for((i64)0, (i64)files.size(), [&](i64 i) {
+      InputFile<E> *file = files[i];
+      for (Symbol<E> *sym : file->get_global_syms()) {
+        if (__atomic_load_n(&sym->file, __ATOMIC_ACQUIRE) == file &&
+            is_removed_definition(file, *sym)) {
+          clear_symbol(*sym);
+          sym->needs_resolve = true;
+          cleared[i].push_back(sym);
+        }
+      }
+    });
+
+    tbb::parallel_for((i64)0, (i64)files.size(), [&](i64 i) {
+      if (files[i]->is_alive)
+        files[i]->resolve_symbols(ctx, was_alive[i]);
+    });
+
+    tbb::parallel_for_each(cleared, [](std::vector<Symbol<E> *> &syms) {
+      for (Symbol<E> *sym : syms)
+        sym->needs_resolve = false;
     });
 
     // Symbols with hidden visibility need to be resolved within the
@@ -353,9 +465,34 @@ void do_lto(Context<E> &ctx) {
   parse_symbol_version(ctx);
   compute_import_export(ctx);
 
+  // Native object files that are already known to be included in the
+  // output don't depend on the result of LTO, so we parse their sections
+  // and .eh_frame on worker threads while the main thread is blocked in
+  // the LTO plugin. Symbols are not resolved again until the plugin
+  // returns, so we only read input files and their own sections here.
+  std::vector<ObjectFile<E> *> native_objs;
+  for (ObjectFile<E> *file : ctx.objs)
+    if (file->is_alive && !file->is_lto_obj)
+      native_objs.push_back(file);
+
+  tbb::task_group tg;
+  tg.run([&] {
+    Timer t(ctx, "preprocess_native_objects");
+    tbb::parallel_for_each(native_objs, [&](ObjectFile<E> *file) {
+      if (file->is_in_lib)
+        file->parse_sections(ctx);
+
+      file->parse_ehframe(ctx);
+      for (InputSection<E> *isec : file->eh_frame_sections)
+        isec->is_alive = false;
+      file->is_preprocessed = true;
+    });
+  });
+
   // Invoke the LTO plugin. This step compiles IR object files into a few
   // big ELF files.
   std::vector<ObjectFile<E> *> lto_objs = run_lto_plugin(ctx);
+  tg.wait();
   append(ctx.objs, lto_objs);
 
   // Redo name resolution.
@@ -376,6 +513,16 @@ void parse_eh_frame_sections(Context<E> &ctx) {
   Timer t(ctx, "parse_eh_frame_sections");
 
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    // If .eh_frame was parsed during LTO, sections may have been removed
+    // by comdat elimination since then. Remove their FDEs.
+    if (file->is_preprocessed) {
+      for (std::unique_ptr<InputSection<E>> &isec : file->sections)
+        if (isec && !isec->is_alive)
+          for (FdeRecord<E> &fde : isec->get_fdes())
+            fde.is_alive = false;
+      return;
+    }
+
     file->parse_ehframe(ctx);
 
     for (InputSection<E> *isec : file->eh_frame_sections)
@@ -489,6 +636,13 @@ get_output_name(Context<E> &ctx, std::string_view name, u64 flags) {
     }
   }
 
+  // This function is called for each input section, and with
+  // -ffunction-sections, there can be tens of millions of them. To avoid
+  // comparing a name with all prefixes, we group prefixes by their
+  // second character (the one after the leading '.') and try only the
+  // ones in the group for the name. Prefixes keep their relative order
+  // within a group, so the result is the same as trying all of them in
+  // order.
   static std::string_view prefixes[] = {
     ".text.", ".data.rel.ro.", ".data.", ".rodata.", ".bss.rel.ro.", ".bss.",
     ".init_array.", ".fini_array.", ".tbss.", ".tdata.", ".gcc_except_table.",
@@ -496,7 +650,17 @@ get_output_name(Context<E> &ctx, std::string_view name, u64 flags) {
     ".sdata.", ".sbss.", ".srodata", ".gnu.build.attributes.",
   };
 
-  for (std::string_view prefix : prefixes) {
+  static std::array<std::vector<std::string_view>, 256> groups = [] {
+    std::array<std::vector<std::string_view>, 256> arr;
+    for (std::string_view prefix : prefixes)
+      arr[(u8)prefix[1]].push_back(prefix);
+    return arr;
+  }();
+
+  if (name.size() < 2 || name[0] != '.')
+    return name;
+
+  for (std::string_view prefix : groups[(u8)name[1]]) {
     std::string_view stem = prefix.substr(0, prefix.size() - 1);
     if (name == stem || name.starts_with(prefix))
       return stem;
@@ -505,6 +669,28 @@ get_output_name(Context<E> &ctx, std::string_view name, u64 flags) {
   return name;
 }
 
+// Returns true if a given section contains only zeros and doesn't have
+// relocations, so that it can be placed into .bss for
+// --zero-data-to-bss. Such sections are created for zero-initialized
+// variables if the compiler is told not to use .bss (e.g. with GCC's
+// -fno-zero-initialized-in-bss) or by code generators that emit data in
+// assembly.
+template <typename E>
+static bool is_zero_data(Context<E> &ctx, InputSection<E> &isec) {
+  const ElfShdr<E> &shdr = isec.shdr();
+  if (ctx.arg.relocatable || shdr.sh_type != SHT_PROGBITS ||
+      (shdr.sh_flags & (SHF_TLS | SHF_EXECINSTR)) ||
+      !(shdr.sh_flags & SHF_WRITE) || !isec.get_rels(ctx).empty() ||
+      isec.contents.size() != isec.sh_size)
+    return false;
+
+  // A buffer is all zeros if its first byte is zero and it's equal to
+  // itself shifted by one byte. memcmp() is much faster than a loop.
+  std::string_view str = isec.contents;
+  return str.empty() ||
+         (str[0] == 0 && memcmp(str.data(), str.data() + 1, str.size() - 1) == 0);
+}
+
 template <typename E>
 static OutputSectionKey
 get_output_section_key(Context<E> &ctx, InputSection<E> &isec,
@@ -527,6 +713,10 @@ get_output_section_key(Context<E> &ctx, InputSection<E> &isec,
 
   const ElfShdr<E> &shdr = isec.shdr();
   std::string_view name = get_output_name(ctx, isec.name(), shdr.sh_flags);
+
+  if (ctx.arg.zero_data_to_bss && name == ".data" && is_zero_data(ctx, isec))
+    return {".bss", SHT_NOBITS};
+
   u64 type = canonicalize_type<E>(name, shdr.sh_type);
   return {name, type};
 }
@@ -567,15 +757,15 @@ void create_output_sections(Context<E> &ctx) {
   i64 size = ctx.osec_pool.size();
   bool ctors_in_init_array = has_ctors_and_init_array(ctx);
 
+  // Each thread has a cache of the main map to avoid lock contention.
+  // It makes a noticeable difference if we have millions of input
+  // sections. There are only a few hundred distinct keys at most, so
+  // a thread-local cache soon contains all of them.
+  tbb::enumerable_thread_specific<MapType> caches;
+
   // Instantiate output sections
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    // Make a per-thread cache of the main map to avoid lock contention.
-    // It makes a noticeable difference if we have millions of input sections.
-    MapType cache;
-    {
-      std::shared_lock lock(mu);
-      cache = map;
-    }
+    MapType &cache = caches.local();
 
     for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
       if (!isec || !isec->is_alive)
@@ -993,73 +1183,126 @@ static std::string create_response_file(Context<E> &ctx) {
   return out.str();
 }
 
+// Writes `<output>.repro.tar` or, with --repro=zstd,
+// `<output>.repro.tar.zst`. Since input files can be gigabytes in total,
+// the file is written on a background thread so that it doesn't block the
+// main linker pass. wait_repro_file() waits for it to finish.
 template <typename E>
 void write_repro_file(Context<E> &ctx) {
   std::string path = ctx.arg.output + ".repro.tar";
+  if (ctx.arg.repro_zstd)
+    path += ".zst";
 
-  std::unique_ptr<TarWriter> tar =
-    TarWriter::open(path, path_filename(ctx.arg.output) + ".repro");
-  if (!tar)
-    Fatal(ctx) << "cannot open " << path << ": " << errno_string();
+  std::string basedir = path_filename(ctx.arg.output) + ".repro";
+
+  // If `path` is not empty, the contents are read from that file.
+  struct Member {
+    std::string name;
+    std::string path;
+    std::string contents;
+  };
 
-  tar->append("response.txt", create_response_file(ctx));
-  tar->append("version.txt", get_mold_version() + "\n");
+  std::vector<Member> members;
+  members.push_back({"response.txt", "", create_response_file(ctx)});
+  members.push_back({"version.txt", "", get_mold_version() + "\n"});
 
   std::unordered_set<std::string_view> seen;
+  for (std::unique_ptr<MappedFile> &mf : ctx.mf_pool)
+    if (!mf->parent && seen.insert(mf->name).second)
+      members.push_back({std::filesystem::absolute(mf->name).string(),
+                         mf->name, ""});
+
+  // This runs on the background thread, so it doesn't use ctx.mf_pool.
+  auto open = [&ctx](const std::string &path) {
+    std::string error;
+    std::unique_ptr<MappedFile> mf(open_file_impl(path, error));
+    if (!error.empty())
+      Fatal(ctx) << error;
+    if (!mf)
+      Fatal(ctx) << "cannot open " << path << ": " << errno_string();
+    return mf;
+  };
 
-  for (std::unique_ptr<MappedFile> &mf : ctx.mf_pool) {
-    if (!mf->parent && seen.insert(mf->name).second) {
-      // We reopen a file because we may have modified the contents of mf
-      // in memory, which is mapped with PROT_WRITE and MAP_PRIVATE.
-      MappedFile *mf2 = must_open_file(ctx, mf->name);
-      tar->append(std::filesystem::absolute(mf->name).string(),
-                  mf2->get_contents());
-      mf2->unmap();
-    }
-  }
-}
+  auto write_uncompressed = [&ctx, path, basedir, members, open] {
+    std::unique_ptr<TarWriter> tar = TarWriter::open(path, basedir);
+    if (!tar)
+      Fatal(ctx) << "cannot open " << path << ": " << errno_string();
 
-template <typename E>
-void check_duplicate_symbols(Context<E> &ctx) {
-  Timer t(ctx, "check_duplicate_symbols");
+    for (const Member &m : members) {
+      if (m.path.empty())
+        tar->append(m.name, m.contents);
+      else
+        tar->append(m.name, open(m.path)->get_contents());
+    }
+  };
 
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    for (i64 i = file->first_global; i < file->elf_syms.size(); i++) {
-      const ElfSym<E> &esym = file->elf_syms[i];
-      Symbol<E> &sym = *file->symbols[i];
+  // Each tar member is compressed as a separate group, so that members
+  // are compressed in parallel and only a few of them are in memory at
+  // once. The last group is the two empty blocks that end a tar file.
+  auto write_zstd = [&ctx, path, basedir, members, open] {
+    constexpr i64 BLOCK_SIZE = TarWriter::BLOCK_SIZE;
 
-      // Skip if our symbol is undef or weak
-      if (sym.file == file || sym.file == ctx.internal_obj ||
-          esym.is_undef() || esym.is_common() || (esym.st_bind == STB_WEAK))
-        continue;
+    auto get_member = [&](i64 i, std::vector<u8> &buf) {
+      if (i == members.size()) {
+        buf.resize(BLOCK_SIZE * 2);
+        return std::string_view((char *)buf.data(), buf.size());
+      }
 
-      // Skip if our symbol is in a dead section. In most cases, the
-      // section has been eliminated due to comdat deduplication.
-      if (!esym.is_abs()) {
-        InputSection<E> *isec = file->get_section(esym);
-        if (!isec || !isec->is_alive)
-          continue;
+      const Member &m = members[i];
+      std::unique_ptr<MappedFile> mf;
+      std::string_view data = m.contents;
+      if (!m.path.empty()) {
+        mf = open(m.path);
+        data = mf->get_contents();
       }
 
-      Error(ctx) << "duplicate symbol: " << *file << ": " << *sym.file
-                 << ": " << sym;
-    }
-  });
+      std::string hdr = TarWriter::encode_header(basedir, m.name, data.size());
+      buf.resize(hdr.size() + align_to(data.size(), BLOCK_SIZE));
+      memcpy(buf.data(), hdr.data(), hdr.size());
+      memcpy(buf.data() + hdr.size(), data.data(), data.size());
+      return std::string_view((char *)buf.data(), buf.size());
+    };
 
-  ctx.checkpoint();
+    ZstdCompressor zstd(members.size() + 1, get_member);
+    std::vector<u8> buf(zstd.compressed_size);
+    zstd.write_to(buf.data());
+
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out)
+      Fatal(ctx) << "cannot open " << path << ": " << errno_string();
+    fwrite(buf.data(), buf.size(), 1, out);
+    fclose(out);
+  };
+
+  if (ctx.arg.repro_zstd)
+    ctx.repro_thread = std::thread(write_zstd);
+  else
+    ctx.repro_thread = std::thread(write_uncompressed);
+}
+
+template <typename E>
+void wait_repro_file(Context<E> &ctx) {
+  Timer t(ctx, "wait_repro_file");
+  if (ctx.repro_thread.joinable())
+    ctx.repro_thread.join();
 }
 
-// If --no-allow-shlib-undefined is specified, we report errors on
-// unresolved symbols in shared libraries. This is useful when you are
-// creating a final executable and want to make sure that all symbols
-// including ones in shared libraries have been resolved.
+// This function verifies the symbol resolution result. It reports
+// duplicate definitions, undefined symbols in shared libraries if
+// --no-allow-shlib-undefined is given, and symbols defined under the
+// same name with different types.
+//
+// These checks used to be separate passes, each of which visited all
+// symbols of all input files. Since there can be tens of millions of
+// symbols, we do all of them in a single parallel pass so that we read
+// each symbol only once.
 //
 // If you do not pass --no-allow-shlib-undefined, undefined symbols in
 // shared libraries will be reported as run-time error by the dynamic
 // linker.
 template <typename E>
-void check_shlib_undefined(Context<E> &ctx) {
-  Timer t(ctx, "check_shlib_undefined");
+void check_symbols(Context<E> &ctx) {
+  Timer t(ctx, "check_symbols");
 
   auto is_sparc_register = [](const ElfSym<E> &esym) {
     // Dynamic symbol table for SPARC contains bogus entries which
@@ -1069,38 +1312,6 @@ void check_shlib_undefined(Context<E> &ctx) {
     return false;
   };
 
-  // Obtain a list of known shared library names.
-  std::unordered_set<std::string_view> sonames;
-  for (SharedFile<E> *file : ctx.dsos)
-    sonames.insert(file->soname);
-
-  tbb::parallel_for_each(ctx.dsos, [&](SharedFile<E> *file) {
-    // Skip the file if it depends on a file that we know nothing about.
-    // This is because missing symbols may be provided by that unknown file.
-    for (std::string_view needed : file->get_dt_needed(ctx))
-      if (sonames.count(needed) == 0)
-        return;
-
-    // Check if all undefined symbols have been resolved.
-    for (i64 i = 0; i < file->elf_syms.size(); i++) {
-      const ElfSym<E> &esym = file->elf_syms[i];
-      Symbol<E> &sym = *file->symbols[i];
-      if (esym.is_undef() && !esym.is_weak() && !sym.file &&
-          !is_sparc_register(esym))
-        Error(ctx) << *file << ": --no-allow-shlib-undefined: undefined symbol: "
-                   << sym;
-    }
-  });
-}
-
-template <typename E>
-void check_symbol_types(Context<E> &ctx) {
-  Timer t(ctx, "check_symbol_types");
-
-  std::vector<InputFile<E> *> files;
-  append(files, ctx.objs);
-  append(files, ctx.dsos);
-
   auto canonicalize = [](u32 ty) -> u32 {
     if (ty == STT_GNU_IFUNC)
       return STT_FUNC;
@@ -1109,25 +1320,84 @@ void check_symbol_types(Context<E> &ctx) {
     return ty;
   };
 
-  tbb::parallel_for_each(files.begin(), files.end(), [&](InputFile<E> *file) {
+  // Obtain a list of known shared library names.
+  std::unordered_set<std::string_view> sonames;
+  if (!ctx.arg.allow_shlib_undefined)
+    for (SharedFile<E> *file : ctx.dsos)
+      sonames.insert(file->soname);
+
+  // Returns true if we should report undefined symbols in a given DSO.
+  // We skip a file if it depends on a file that we know nothing about,
+  // as missing symbols may be provided by that unknown file.
+  auto should_check_undefs = [&](SharedFile<E> *file) {
+    if (ctx.arg.allow_shlib_undefined)
+      return false;
+    for (std::string_view needed : file->get_dt_needed(ctx))
+      if (sonames.count(needed) == 0)
+        return false;
+    return true;
+  };
+
+  auto check_type = [&](InputFile<E> *file, Symbol<E> &sym, i64 i) {
+    const ElfSym<E> &esym1 = sym.esym();
+    const ElfSym<E> &esym2 = file->elf_syms[i];
+
+    if (esym1.st_type != STT_NOTYPE && esym2.st_type != STT_NOTYPE &&
+        canonicalize(esym1.st_type) != canonicalize(esym2.st_type)) {
+      Warn(ctx) << "symbol type mismatch: " << sym << '\n'
+                << ">>> defined in " << *sym.file << " as "
+                << stt_to_string<E>(esym1.st_type) << '\n'
+                << ">>> defined in " << *file << " as "
+                << stt_to_string<E>(esym2.st_type);
+    }
+  };
+
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
     for (i64 i = file->first_global; i < file->elf_syms.size(); i++) {
+      const ElfSym<E> &esym = file->elf_syms[i];
       Symbol<E> &sym = *file->symbols[i];
       if (!sym.file || sym.file == file)
         continue;
 
-      const ElfSym<E> &esym1 = sym.esym();
-      const ElfSym<E> &esym2 = file->elf_syms[i];
+      check_type(file, sym, i);
+
+      // Skip if our symbol is undef or weak
+      if (ctx.arg.allow_multiple_definition || sym.file == ctx.internal_obj ||
+          esym.is_undef() || esym.is_common() || (esym.st_bind == STB_WEAK))
+        continue;
+
+      // Skip if our symbol is in a dead section. In most cases, the
+      // section has been eliminated due to comdat deduplication.
+      if (!esym.is_abs()) {
+        InputSection<E> *isec = file->get_section(esym);
+        if (!isec || !isec->is_alive)
+          continue;
+      }
+
+      Error(ctx) << "duplicate symbol: " << *file << ": " << *sym.file
+                 << ": " << sym;
+    }
+  });
+
+  tbb::parallel_for_each(ctx.dsos, [&](SharedFile<E> *file) {
+    bool check_undefs = should_check_undefs(file);
 
-      if (esym1.st_type != STT_NOTYPE && esym2.st_type != STT_NOTYPE &&
-          canonicalize(esym1.st_type) != canonicalize(esym2.st_type)) {
-        Warn(ctx) << "symbol type mismatch: " << sym << '\n'
-                  << ">>> defined in " << *sym.file << " as "
-                  << stt_to_string<E>(esym1.st_type) << '\n'
-                  << ">>> defined in " << *file << " as "
-                  << stt_to_string<E>(esym2.st_type);
+    for (i64 i = 0; i < file->elf_syms.size(); i++) {
+      const ElfSym<E> &esym = file->elf_syms[i];
+      Symbol<E> &sym = *file->symbols[i];
+
+      if (sym.file) {
+        if (sym.file != file)
+          check_type(file, sym, i);
+      } else if (check_undefs && esym.is_undef() && !esym.is_weak() &&
+                 !is_sparc_register(esym)) {
+        Error(ctx) << *file << ": --no-allow-shlib-undefined: undefined symbol: "
+                   << sym;
       }
     }
   });
+
+  ctx.checkpoint();
 }
 
 template <typename E>
@@ -1243,10 +1513,17 @@ void fixup_ctors_in_init_array(Context<E> &ctx) {
     if (isec.sh_size % sizeof(Word<E>))
       Fatal(ctx) << isec << ": section corrupted";
 
-    u8 *buf = (u8 *)isec.contents.data();
+    // Input files are mapped read-only, so we need a copy.
+    u8 *buf = new u8[isec.sh_size];
+    ctx.string_pool.emplace_back(buf);
+    ctx.string_pool_bytes += isec.sh_size;
+    isec.copy_contents(ctx, buf);
+    isec.contents = {(char *)buf, (size_t)isec.sh_size};
+    isec.uncompressed = true;
+
     std::reverse((Word<E> *)buf, (Word<E> *)(buf + isec.sh_size));
 
-    std::span<ElfRel<E>> rels = isec.get_rels(ctx);
+    std::span<ElfRel<E>> rels = isec.get_mutable_rels(ctx);
     for (ElfRel<E> &r : rels)
       r.r_offset = isec.sh_size - r.r_offset - sizeof(Word<E>);
     std::reverse(rels.begin(), rels.end());
@@ -1291,25 +1568,28 @@ static void shuffle(std::vector<T> &vec, u64 seed) {
     std::swap(vec[i], vec[i + rand() % (vec.size() - i)]);
 }
 
+// Returns true if we can freely change the order of input sections in
+// a given output section.
+template <typename E>
+static bool is_reorderable(OutputSection<E> *osec) {
+  if (osec) {
+    std::string_view name = osec->name;
+    return name != ".init" && name != ".fini" &&
+           name != ".ctors" && name != ".dtors" &&
+           name != ".init_array" && name != ".preinit_array" &&
+           name != ".fini_array";
+  }
+  return false;
+}
+
 template <typename E>
 void shuffle_sections(Context<E> &ctx) {
   Timer t(ctx, "shuffle_sections");
 
-  auto is_eligible = [](OutputSection<E> *osec) {
-    if (osec) {
-      std::string_view name = osec->name;
-      return name != ".init" && name != ".fini" &&
-             name != ".ctors" && name != ".dtors" &&
-             name != ".init_array" && name != ".preinit_array" &&
-             name != ".fini_array";
-    }
-    return false;
-  };
-
   switch (ctx.arg.shuffle_sections) {
   case SHUFFLE_SECTIONS_SHUFFLE: {
     tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
-      if (OutputSection<E> *osec = chunk->to_osec(); is_eligible(osec)) {
+      if (OutputSection<E> *osec = chunk->to_osec(); is_reorderable(osec)) {
         u64 seed = ctx.arg.shuffle_sections_seed + hash_string(osec->name);
         shuffle(osec->members, seed);
       }
@@ -1318,7 +1598,7 @@ void shuffle_sections(Context<E> &ctx) {
   }
   case SHUFFLE_SECTIONS_REVERSE:
     tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
-      if (OutputSection<E> *osec = chunk->to_osec(); is_eligible(osec))
+      if (OutputSection<E> *osec = chunk->to_osec(); is_reorderable(osec))
         std::reverse(osec->members.begin(), osec->members.end());
     });
     break;
@@ -1327,6 +1607,325 @@ void shuffle_sections(Context<E> &ctx) {
   }
 }
 
+// Maps each of given symbols to the input section that defines it and
+// returns the sections with the index of the first symbol each one
+// contains. Locally-defined symbols are matched by name. `opt` is the
+// option name for warnings about unknown symbols.
+template <typename E>
+static std::unordered_map<InputSection<E> *, i64>
+get_section_ranks(Context<E> &ctx, std::span<Symbol<E> *> syms,
+                  std::string_view opt, bool warn) {
+  auto get_section = [](Symbol<E> &sym) -> InputSection<E> * {
+    InputSection<E> *isec = sym.get_input_section();
+    if (isec && isec->icf_removed())
+      isec = isec->leader;
+    if (isec && isec->is_alive && is_reorderable(isec->output_section))
+      return isec;
+    return nullptr;
+  };
+
+  // Global symbols have already been resolved through the symbol table.
+  std::vector<InputSection<E> *> global_secs(syms.size());
+  std::vector<Atomic<bool>> found(syms.size());
+
+  tbb::parallel_for((i64)0, (i64)syms.size(), [&](i64 i) {
+    if (syms[i]->file) {
+      found[i] = true;
+      global_secs[i] = get_section(*syms[i]);
+    }
+  });
+
+  // Local symbols are not in the symbol table, so look them up by name.
+  std::unordered_map<std::string_view, i64> indices;
+  indices.reserve(syms.size());
+  for (i64 i = 0; i < syms.size(); i++)
+    indices.insert({syms[i]->name(), i});
+
+  std::vector<std::vector<std::pair<InputSection<E> *, i64>>>
+    local_secs(ctx.objs.size());
+
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> *file = ctx.objs[i];
+    for (i64 j = 1; j < file->first_global; j++) {
+      Symbol<E> &sym = *file->symbols[j];
+      if (sym.file != file || sym.get_type() == STT_SECTION ||
+          sym.get_type() == STT_FILE)
+        continue;
+
+      if (auto it = indices.find(sym.name()); it != indices.end()) {
+        found[it->second] = true;
+        if (InputSection<E> *isec = get_section(sym))
+          local_secs[i].push_back({isec, it->second});
+      }
+    }
+  });
+
+  if (warn)
+    for (i64 i = 0; i < syms.size(); i++)
+      if (!found[i])
+        Warn(ctx) << opt << ": no such symbol: " << *syms[i];
+
+  std::unordered_map<InputSection<E> *, i64> ranks;
+  for (i64 i = 0; i < syms.size(); i++)
+    if (global_secs[i])
+      ranks.insert({global_secs[i], i});
+
+  for (std::vector<std::pair<InputSection<E> *, i64>> &vec : local_secs) {
+    for (auto [isec, rank] : vec) {
+      auto [it, inserted] = ranks.insert({isec, rank});
+      if (!inserted)
+        it->second = std::min(it->second, rank);
+    }
+  }
+  return ranks;
+}
+
+// Handles --symbol-ordering-file. Sections containing the listed symbols
+// are moved to the beginning of their output sections in the order of
+// the symbols.
+template <typename E>
+void sort_sections_by_symbol_order(Context<E> &ctx) {
+  Timer t(ctx, "sort_sections_by_symbol_order");
+
+  std::unordered_map<InputSection<E> *, i64> ranks =
+    get_section_ranks(ctx, std::span(ctx.arg.symbol_ordering_file),
+                      "--symbol-ordering-file", ctx.arg.warn_symbol_ordering);
+  if (ranks.empty())
+    return;
+
+  auto get_rank = [&](InputSection<E> *isec) {
+    auto it = ranks.find(isec);
+    return (it == ranks.end()) ? INT64_MAX : it->second;
+  };
+
+  tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
+    if (OutputSection<E> *osec = chunk->to_osec(); is_reorderable(osec))
+      sort(osec->members, [&](InputSection<E> *a, InputSection<E> *b) {
+        return get_rank(a) < get_rank(b);
+      });
+  });
+}
+
+// Handles --hot-text-file. Executable sections are divided into three
+// groups, which are laid out in the following order:
+//
+//  1. Sections defining a symbol listed in the profile (hot)
+//  2. Sections with no profile information
+//  3. Sections the compiler has marked cold, i.e. .text.unlikely.* and
+//     .text.cold.*
+//
+// The relative order within each group is preserved, so the hot group
+// can be ordered further by --symbol-ordering-file or
+// --call-graph-profile-sort.
+//
+// With --hot-text-align, we also raise the alignment of hot sections so
+// that a hot function doesn't straddle a cache line or a uop cache
+// window boundary. Unlike -falign-functions, this doesn't waste space
+// on cold code.
+template <typename E>
+void partition_hot_cold_text(Context<E> &ctx) {
+  Timer t(ctx, "partition_hot_cold_text");
+
+  std::unordered_map<InputSection<E> *, i64> hot =
+    get_section_ranks(ctx, std::span(ctx.arg.hot_text_file),
+                      "--hot-text-file", false);
+
+  if (ctx.arg.hot_text_align) {
+    u8 p2align = std::countr_zero((u64)ctx.arg.hot_text_align);
+    for (auto [isec, rank] : hot)
+      if (isec->shdr().sh_flags & SHF_EXECINSTR)
+        isec->p2align = std::max(isec->p2align, p2align);
+  }
+
+  auto get_temperature = [&](InputSection<E> *isec) {
+    if (hot.contains(isec))
+      return 0;
+    std::string_view name = isec->name();
+    if (name == ".text.unlikely" || name.starts_with(".text.unlikely.") ||
+        name == ".text.cold" || name.starts_with(".text.cold."))
+      return 2;
+    return 1;
+  };
+
+  tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
+    OutputSection<E> *osec = chunk->to_osec();
+    if (is_reorderable(osec) && (osec->shdr.sh_flags & SHF_EXECINSTR))
+      sort(osec->members, [&](InputSection<E> *a, InputSection<E> *b) {
+        return get_temperature(a) < get_temperature(b);
+      });
+  });
+}
+
+// Handles --prune-debug-aranges. .debug_aranges maps address ranges to
+// compilation units. An address tuple for a function in a section that
+// was removed by --gc-sections or --icf would be resolved to a tombstone
+// value, so it would just be noise to debuggers and symbolizers. This
+// function removes such tuples from input .debug_aranges sections, and
+// removes a set altogether if it has no live tuples.
+//
+// Unlike the other DWARF sections, nothing refers to offsets inside
+// .debug_aranges, so we can remove bytes from it without rewriting other
+// sections. Relocations for removed bytes are turned into R_NONE, and
+// the offsets of the remaining relocations are adjusted.
+template <typename E>
+static void prune_debug_aranges(Context<E> &ctx, InputSection<E> &isec) {
+  isec.uncompress(ctx);
+
+  std::string_view data = isec.contents;
+  std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+
+  if (!std::is_sorted(rels.begin(), rels.end(),
+                      [](const ElfRel<E> &a, const ElfRel<E> &b) {
+                        return a.r_offset < b.r_offset;
+                      }))
+    return;
+
+  auto is_dead = [&](const ElfRel<E> &r) {
+    if (r.r_type == R_NONE || r.r_sym >= isec.file.symbols.size())
+      return false;
+    InputSection<E> *sec = isec.file.symbols[r.r_sym]->get_input_section();
+    return sec && !sec->is_alive;
+  };
+
+  // A piece of the section to copy or to remove. If `unit_size` is not
+  // -1, the piece is the header of a set, and the set's length field at
+  // the beginning of the piece is updated to `unit_size`.
+  struct Piece {
+    i64 begin;
+    i64 end;
+    bool keep;
+    i64 unit_size = -1;
+  };
+
+  std::vector<Piece> pieces;
+  i64 r = 0;
+  bool changed = false;
+
+  for (i64 off = 0; off < data.size();) {
+    if (data.size() - off < 4)
+      return;
+
+    i64 hdr_size = 4;
+    i64 len = *(U32<E> *)(data.data() + off);
+    if (len == 0xffff'ffff) {
+      if (data.size() - off < 12)
+        return;
+      hdr_size = 12;
+      len = *(U64<E> *)(data.data() + off + 4);
+    }
+
+    i64 end = off + hdr_size + len;
+    if (len < 0 || data.size() < end)
+      return;
+
+    // We handle only version 2 with no segment selectors, which is what
+    // compilers emit. Other sets are copied as-is.
+    i64 info_off_size = (hdr_size == 12) ? 8 : 4;
+    i64 tuple_size = sizeof(Word<E>) * 2;
+    i64 first = off + align_to(hdr_size + 2 + info_off_size + 2, tuple_size);
+    u8 *p = (u8 *)data.data() + off + hdr_size;
+
+    if (end < first || *(U16<E> *)p != 2 ||
+        p[2 + info_off_size] != sizeof(Word<E>) || p[3 + info_off_size] != 0) {
+      pieces.push_back({off, end, true});
+      off = end;
+      continue;
+    }
+
+    // Find dead tuples. A tuple is dead if its address refers to a dead
+    // section.
+    i64 ntuples = (end - first) / tuple_size;
+    std::vector<bool> dead(ntuples);
+    i64 num_dead = 0;
+    i64 num_live = 0;
+
+    while (r < rels.size() && rels[r].r_offset < first)
+      r++;
+
+    for (i64 i = 0; i < ntuples; i++) {
+      i64 begin = first + i * tuple_size;
+      bool has_rel = false;
+      for (; r < rels.size() && rels[r].r_offset < begin + tuple_size; r++) {
+        has_rel = true;
+        if (rels[r].r_offset < begin + tuple_size / 2 && is_dead(rels[r]))
+          dead[i] = true;
+      }
+
+      if (dead[i])
+        num_dead++;
+      else if (has_rel)
+        num_live++;
+    }
+
+    if (num_dead == 0) {
+      pieces.push_back({off, end, true});
+    } else if (num_live == 0) {
+      pieces.push_back({off, end, false});
+    } else {
+      i64 size = end - off - hdr_size - num_dead * tuple_size;
+      pieces.push_back({off, first, true, size});
+      for (i64 i = 0; i < ntuples; i++) {
+        i64 begin = first + i * tuple_size;
+        pieces.push_back({begin, begin + tuple_size, !dead[i]});
+      }
+      pieces.push_back({first + ntuples * tuple_size, end, true});
+    }
+
+    changed |= (num_dead > 0);
+    off = end;
+  }
+
+  if (!changed)
+    return;
+
+  // Rewrite the section contents and relocations.
+  u8 *buf = new u8[data.size()];
+  ctx.string_pool.emplace_back(buf);
+  ctx.string_pool_bytes += data.size();
+
+  std::span<ElfRel<E>> rels2 = isec.get_mutable_rels(ctx);
+  i64 size = 0;
+  r = 0;
+
+  for (Piece &piece : pieces) {
+    i64 delta = piece.begin - size;
+
+    for (; r < rels2.size() && rels2[r].r_offset < piece.end; r++) {
+      if (piece.keep)
+        rels2[r].r_offset = rels2[r].r_offset - delta;
+      else
+        rels2[r].r_type = R_NONE;
+    }
+
+    if (!piece.keep)
+      continue;
+
+    memcpy(buf + size, data.data() + piece.begin, piece.end - piece.begin);
+
+    if (piece.unit_size != -1) {
+      if (*(U32<E> *)(buf + size) == 0xffff'ffff)
+        *(U64<E> *)(buf + size + 4) = piece.unit_size;
+      else
+        *(U32<E> *)(buf + size) = piece.unit_size;
+    }
+    size += piece.end - piece.begin;
+  }
+
+  isec.contents = std::string_view((char *)buf, size);
+  isec.sh_size = size;
+}
+
+template <typename E>
+void prune_debug_aranges(Context<E> &ctx) {
+  Timer t(ctx, "prune_debug_aranges");
+
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    for (std::unique_ptr<InputSection<E>> &isec : file->sections)
+      if (isec && isec->is_alive && isec->name() == ".debug_aranges")
+        prune_debug_aranges(ctx, *isec);
+  });
+}
+
 template <typename E>
 void compute_section_sizes(Context<E> &ctx) {
   Timer t(ctx, "compute_section_sizes");
@@ -1445,12 +2044,246 @@ void claim_unresolved_symbols(Context<E> &ctx) {
   });
 }
 
+// When we are creating a dlopen'able DSO, the TP-relative address of a
+// TLV is in general not known until runtime, so the relocation scanner
+// leaves General Dynamic and TLSDESC accesses as they are. However, if
+// the output uses the Initial Exec model for some TLV, that TLV's
+// TP-relative address must be fixed at load-time, or the output would
+// fail to load in the first place. Moreover, the output's own TLS block
+// is then allocated in the static TLS area as a whole (DF_STATIC_TLS),
+// so the same goes for all TLVs defined and not preemptible in the
+// output. For such TLVs, we relax GD and TLSDESC to IE, which saves
+// GOT slots and calls to __tls_get_addr.
+template <typename E>
+static void relax_tls_models(Context<E> &ctx, std::span<Symbol<E> *> syms) {
+  if (!ctx.arg.relax || !ctx.arg.shared || !ctx.arg.z_dlopen)
+    return;
+
+  // GD-to-IE code rewriting is implemented only for these targets.
+  constexpr bool can_relax_gd = is_x86_64<E> || is_s390x<E> || is_sparc64<E>;
+
+  // TLVs imported from other DSOs may be in dynamically-allocated TLS
+  // blocks, so they are out of scope.
+  auto is_own = [](Symbol<E> *sym) {
+    return !sym->is_imported && !sym->file->is_dso;
+  };
+
+  auto uses_ie = [&](Symbol<E> *sym) {
+    return is_own(sym) && (sym->flags & NEEDS_GOTTP);
+  };
+
+  if (std::none_of(syms.begin(), syms.end(), uses_ie))
+    return;
+
+  tbb::parallel_for_each(syms, [&](Symbol<E> *sym) {
+    if (!is_own(sym))
+      return;
+
+    u8 flags = sym->flags;
+
+    u8 mask = NEEDS_TLSDESC;
+    if (can_relax_gd)
+      mask |= NEEDS_TLSGD;
+
+    if (flags & mask)
+      sym->flags = (flags & ~mask) | NEEDS_GOTTP;
+  });
+}
+
+// Assigns GOT, PLT and .dynsym slots to symbols in parallel, in the same
+// order as if we called add_aux(), DynsymSection::add_symbol() and so on
+// for each symbol in `syms` in order. We first count the number of slots
+// each block of symbols needs, compute their prefix sums and then fill
+// the slots.
+//
+// Returns false without doing anything if a symbol needs a copy
+// relocation.
+template <typename E>
+static bool
+assign_dynamic_slots(Context<E> &ctx, std::span<Symbol<E> *> syms) {
+  struct Slots {
+    Slots operator+(const Slots &x) const {
+      return {aux + x.aux, dynsym + x.dynsym, got_words + x.got_words,
+              got + x.got, gottp + x.gottp, tlsgd + x.tlsgd,
+              tlsdesc + x.tlsdesc, plt + x.plt, pltgot + x.pltgot};
+    }
+
+    i64 aux = 0;
+    i64 dynsym = 0;
+    i64 got_words = 0;
+    i64 got = 0;
+    i64 gottp = 0;
+    i64 tlsgd = 0;
+    i64 tlsdesc = 0;
+    i64 plt = 0;
+    i64 pltgot = 0;
+  };
+
+  auto is_plt = [](Symbol<E> *sym) {
+    return (sym->flags & NEEDS_CPLT) ||
+           ((sym->flags & NEEDS_PLT) && !(sym->flags & NEEDS_GOT));
+  };
+
+  auto is_pltgot = [](Symbol<E> *sym) {
+    return !(sym->flags & NEEDS_CPLT) && (sym->flags & NEEDS_PLT) &&
+           (sym->flags & NEEDS_GOT);
+  };
+
+  auto get_slots = [&](Symbol<E> *sym) {
+    Slots x;
+    x.aux = (sym->aux_idx == -1);
+    x.dynsym = (sym->is_imported || sym->is_exported || is_plt(sym)) &&
+               sym->get_dynsym_idx(ctx) == -1;
+
+    if (sym->flags & NEEDS_GOT) {
+      x.got = 1;
+      x.got_words += sym->is_pde_ifunc(ctx) ? 2 : 1;
+    }
+    if (sym->flags & NEEDS_GOTTP) {
+      x.gottp = 1;
+      x.got_words += 1;
+    }
+    if (sym->flags & NEEDS_TLSGD) {
+      x.tlsgd = 1;
+      x.got_words += 2;
+    }
+    if (sym->flags & NEEDS_TLSDESC) {
+      x.tlsdesc = 1;
+      x.got_words += 2;
+    }
+
+    x.plt = is_plt(sym);
+    x.pltgot = is_pltgot(sym);
+    return x;
+  };
+
+  constexpr i64 BLOCK_SIZE = 10000;
+  i64 num_blocks = (syms.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  std::vector<Slots> counts(num_blocks + 1);
+  Atomic<bool> has_copyrel = false;
+
+  tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+    i64 end = std::min<i64>((i + 1) * BLOCK_SIZE, syms.size());
+    for (i64 j = i * BLOCK_SIZE; j < end; j++) {
+      if (syms[j]->flags & NEEDS_COPYREL)
+        has_copyrel = true;
+      counts[i + 1] = counts[i + 1] + get_slots(syms[j]);
+    }
+  });
+
+  if (has_copyrel)
+    return false;
+
+  for (i64 i = 0; i < num_blocks; i++)
+    counts[i + 1] = counts[i] + counts[i + 1];
+
+  // Resize tables
+  Slots &total = counts[num_blocks];
+  GotSection<E> &got = *ctx.got;
+
+  Slots base;
+  base.aux = ctx.symbol_aux.size();
+  base.got_words = got.shdr.sh_size / sizeof(Word<E>);
+  base.got = got.got_syms.size();
+  base.gottp = got.gottp_syms.size();
+  base.tlsgd = got.tlsgd_syms.size();
+  base.tlsdesc = got.tlsdesc_syms.size();
+  base.plt = ctx.plt->symbols.size();
+  base.pltgot = ctx.pltgot->symbols.size();
+
+  ctx.symbol_aux.resize(base.aux + total.aux);
+  got.got_syms.resize(base.got + total.got);
+  got.gottp_syms.resize(base.gottp + total.gottp);
+  got.tlsgd_syms.resize(base.tlsgd + total.tlsgd);
+  got.tlsdesc_syms.resize(base.tlsdesc + total.tlsdesc);
+  got.shdr.sh_size += total.got_words * sizeof(Word<E>);
+  ctx.plt->symbols.resize(base.plt + total.plt);
+  ctx.pltgot->symbols.resize(base.pltgot + total.pltgot);
+
+  if (total.pltgot)
+    ctx.pltgot->shdr.sh_size = ctx.pltgot->symbols.size() * E::pltgot_size;
+
+  if (total.dynsym) {
+    if (ctx.dynsym->symbols.empty())
+      ctx.dynsym->symbols.resize(1);
+    base.dynsym = ctx.dynsym->symbols.size();
+    ctx.dynsym->symbols.resize(base.dynsym + total.dynsym);
+  }
+
+  // Fill the tables
+  tbb::parallel_for((i64)0, num_blocks, [&](i64 i) {
+    Slots cur = base + counts[i];
+    i64 end = std::min<i64>((i + 1) * BLOCK_SIZE, syms.size());
+
+    for (i64 j = i * BLOCK_SIZE; j < end; j++) {
+      Symbol<E> *sym = syms[j];
+      Slots x = get_slots(sym);
+
+      if (x.aux)
+        sym->aux_idx = cur.aux;
+
+      if (x.dynsym) {
+        sym->set_dynsym_idx(ctx, -2);
+        ctx.dynsym->symbols[cur.dynsym] = sym;
+      }
+
+      i64 idx = cur.got_words;
+      if (x.got) {
+        sym->set_got_idx(ctx, idx);
+        got.got_syms[cur.got] = sym;
+        idx += sym->is_pde_ifunc(ctx) ? 2 : 1;
+      }
+      if (x.gottp) {
+        sym->set_gottp_idx(ctx, idx);
+        got.gottp_syms[cur.gottp] = sym;
+        idx += 1;
+      }
+      if (x.tlsgd) {
+        sym->set_tlsgd_idx(ctx, idx);
+        got.tlsgd_syms[cur.tlsgd] = sym;
+        idx += 2;
+      }
+      if (x.tlsdesc) {
+        assert(supports_tlsdesc<E>);
+        assert(!ctx.arg.static_);
+        sym->set_tlsdesc_idx(ctx, idx);
+        got.tlsdesc_syms[cur.tlsdesc] = sym;
+      }
+
+      if (sym->flags & NEEDS_CPLT) {
+        // See the comment in scan_relocations() for canonical PLTs.
+        sym->is_canonical = true;
+        sym->is_exported = true;
+      }
+
+      if (x.plt) {
+        sym->set_plt_idx(ctx, cur.plt);
+        ctx.plt->symbols[cur.plt] = sym;
+      }
+
+      if (x.pltgot) {
+        assert(sym->has_got(ctx));
+        sym->set_pltgot_idx(ctx, cur.pltgot);
+        ctx.pltgot->symbols[cur.pltgot] = sym;
+      }
+
+      sym->flags = 0;
+      cur = cur + x;
+    }
+  });
+  return true;
+}
+
 template <typename E>
 void scan_relocations(Context<E> &ctx) {
   Timer t(ctx, "scan_relocations");
 
+  if constexpr (is_x86_64<E>)
+    if (ctx.arg.z_rewrite_endbr)
+      find_endbr(ctx);
+
   // Scan relocations to find dynamic symbols.
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+  for_each_obj_largest_first<E>(ctx, [&](ObjectFile<E> *file) {
     file->scan_relocations(ctx);
   });
 
@@ -1477,64 +2310,87 @@ void scan_relocations(Context<E> &ctx) {
       if (sym->file == files[i])
         if (sym->flags || sym->is_imported || sym->is_exported)
           vec[i].push_back(sym);
+
+    // A file may refer to the same symbol more than once (e.g. as `foo`
+    // and `foo@@VER`). assign_dynamic_slots() assumes that each symbol
+    // appears only once, so remove duplicates, keeping the first one.
+    std::vector<Symbol<E> *> sorted = vec[i];
+    sort(sorted);
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+      std::unordered_set<Symbol<E> *> seen;
+      std::erase_if(vec[i], [&](Symbol<E> *sym) {
+        return !seen.insert(sym).second;
+      });
+    }
   });
 
   std::vector<Symbol<E> *> syms = flatten(vec);
   ctx.symbol_aux.reserve(syms.size());
 
+  relax_tls_models(ctx, std::span(syms));
+
   if (ctx.needs_tlsld)
     ctx.got->add_tlsld(ctx);
 
-  // Assign offsets in additional tables for each dynamic symbol.
-  for (Symbol<E> *sym : syms) {
-    sym->add_aux(ctx);
+  // Assign offsets in additional tables for each dynamic symbol. A copy
+  // relocation creates dynamic symbols for other symbols as well, so if
+  // there's any, we do that one symbol at a time. Otherwise, we do that
+  // in parallel.
+  if (is_ppc64v1<E> || !assign_dynamic_slots(ctx, std::span(syms))) {
+    for (Symbol<E> *sym : syms) {
+      sym->add_aux(ctx);
 
-    if (sym->is_imported || sym->is_exported)
-      ctx.dynsym->add_symbol(ctx, sym);
+      if (sym->is_imported || sym->is_exported)
+        ctx.dynsym->add_symbol(ctx, sym);
 
-    if (sym->flags & NEEDS_GOT)
-      ctx.got->add_got_symbol(ctx, sym);
+      if (sym->flags & NEEDS_GOT)
+        ctx.got->add_got_symbol(ctx, sym);
 
-    if (sym->flags & NEEDS_CPLT) {
-      sym->is_canonical = true;
+      if (sym->flags & NEEDS_CPLT) {
+        sym->is_canonical = true;
 
-      // A canonical PLT needs to be visible from DSOs.
-      sym->is_exported = true;
+        // A canonical PLT needs to be visible from DSOs.
+        sym->is_exported = true;
 
-      // We can't use .plt.got for a canonical PLT because otherwise
-      // .plt.got and .got would refer to each other, resulting in an
-      // infinite loop at runtime.
-      ctx.plt->add_symbol(ctx, sym);
-    } else if (sym->flags & NEEDS_PLT) {
-      if (sym->flags & NEEDS_GOT)
-        ctx.pltgot->add_symbol(ctx, sym);
-      else
+        // We can't use .plt.got for a canonical PLT because otherwise
+        // .plt.got and .got would refer to each other, resulting in an
+        // infinite loop at runtime.
         ctx.plt->add_symbol(ctx, sym);
-    }
+      } else if (sym->flags & NEEDS_PLT) {
+        if (sym->flags & NEEDS_GOT)
+          ctx.pltgot->add_symbol(ctx, sym);
+        else
+          ctx.plt->add_symbol(ctx, sym);
+      }
 
-    if (sym->flags & NEEDS_GOTTP)
-      ctx.got->add_gottp_symbol(ctx, sym);
+      if (sym->flags & NEEDS_GOTTP)
+        ctx.got->add_gottp_symbol(ctx, sym);
 
-    if (sym->flags & NEEDS_TLSGD)
-      ctx.got->add_tlsgd_symbol(ctx, sym);
+      if (sym->flags & NEEDS_TLSGD)
+        ctx.got->add_tlsgd_symbol(ctx, sym);
 
-    if (sym->flags & NEEDS_TLSDESC)
-      ctx.got->add_tlsdesc_symbol(ctx, sym);
+      if (sym->flags & NEEDS_TLSDESC)
+        ctx.got->add_tlsdesc_symbol(ctx, sym);
 
-    if (sym->flags & NEEDS_COPYREL) {
-      if (ctx.arg.z_relro && ((SharedFile<E> *)sym->file)->is_readonly(sym))
-        ctx.copyrel_relro->add_symbol(ctx, sym);
-      else
-        ctx.copyrel->add_symbol(ctx, sym);
-    }
+      if (sym->flags & NEEDS_COPYREL) {
+        if (ctx.arg.z_relro && ((SharedFile<E> *)sym->file)->is_readonly(sym))
+          ctx.copyrel_relro->add_symbol(ctx, sym);
+        else
+          ctx.copyrel->add_symbol(ctx, sym);
+      }
 
-    if constexpr (is_ppc64v1<E>)
-      if (sym->flags & NEEDS_PPC_OPD)
-        ctx.extra.opd->add_symbol(ctx, sym);
+      if constexpr (is_ppc64v1<E>)
+        if (sym->flags & NEEDS_PPC_OPD)
+          ctx.extra.opd->add_symbol(ctx, sym);
 
-    sym->flags = 0;
+      sym->flags = 0;
+    }
   }
 
+  if constexpr (is_x86_64<E>)
+    if (ctx.arg.z_rewrite_endbr)
+      keep_endbr(ctx);
+
   if (ctx.has_textrel && ctx.arg.warn_textrel)
     Warn(ctx) << "creating a DT_TEXTREL in an output file";
 }
@@ -1560,33 +2416,83 @@ void compute_imported_symbol_weakness(Context<E> &ctx) {
   });
 }
 
+// The dynamic loader writes to every page that contains a dynamic
+// relocation, which turns the page from a shared, file-backed one into a
+// private copy for each process. To reduce the number of such pages, we
+// move input sections with dynamic relocations to the beginning of each
+// writable output section, next to preceding sections such as .got that
+// are written by the loader anyway. Sections without dynamic relocations
+// follow, so their pages stay clean.
+template <typename E>
+void group_relocated_data(Context<E> &ctx) {
+  Timer t(ctx, "group_relocated_data");
+
+  tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
+    OutputSection<E> *osec = chunk->to_osec();
+    if (!is_reorderable(osec) || osec->shdr.sh_type == SHT_NOBITS ||
+        !(osec->shdr.sh_flags & SHF_ALLOC) || !(osec->shdr.sh_flags & SHF_WRITE))
+      return;
+
+    std::unordered_set<InputSection<E> *> set;
+    for (AbsRel<E> &r : osec->abs_rels)
+      if (r.kind != ABS_REL_NONE)
+        set.insert(r.isec);
+
+    if (set.empty())
+      return;
+
+    std::stable_partition(osec->members.begin(), osec->members.end(),
+                          [&](InputSection<E> *isec) {
+      return set.contains(isec);
+    });
+
+    // abs_rels are expected to be sorted in the member order.
+    std::stable_partition(osec->abs_rels.begin(), osec->abs_rels.end(),
+                          [&](AbsRel<E> &r) { return set.contains(r.isec); });
+  });
+}
+
 // Report all undefined symbols, grouped by symbol.
 template <typename E>
 void report_undef_errors(Context<E> &ctx) {
-  constexpr i64 MAX_ERRORS = 3;
-
   if (ctx.arg.unresolved_symbols == UNRESOLVED_IGNORE)
     return;
 
-  for (auto &pair : ctx.undef_errors) {
-    Symbol<E> *sym = pair.first;
-    std::span<std::string> errors = pair.second;
+  // Debug sections may be being relocated in background, so prevent
+  // them from adding new errors while we are traversing the table.
+  std::unique_lock lock(ctx.undef_errors_mu);
+
+  using UndefError = typename Context<E>::UndefError;
+  std::vector<std::pair<Symbol<E> *, UndefError *>> vec;
+  for (auto &pair : ctx.undef_errors)
+    vec.push_back({pair.first, &pair.second});
+
+  // Demangling and formatting can take a while if there are many
+  // undefined symbols, so we create messages in parallel.
+  std::vector<std::string> msgs(vec.size());
+
+  tbb::parallel_for((i64)0, (i64)vec.size(), [&](i64 i) {
+    Symbol<E> *sym = vec[i].first;
+    UndefError &err = *vec[i].second;
 
     std::stringstream ss;
     ss << "undefined symbol: "
        << (ctx.arg.demangle ? demangle(*sym) : sym->name())
        << "\n";
 
-    for (i64 i = 0; i < errors.size() && i < MAX_ERRORS; i++)
-      ss << errors[i];
+    for (std::string &ref : err.refs)
+      ss << ref;
 
-    if (MAX_ERRORS < errors.size())
-      ss << ">>> referenced " << (errors.size() - MAX_ERRORS) << " more times\n";
+    if (err.refs.size() < err.count)
+      ss << ">>> referenced " << (err.count - err.refs.size())
+         << " more times\n";
 
     // Remove the trailing '\n' because Error/Warn adds it automatically
-    std::string msg = ss.str();
-    msg.pop_back();
+    msgs[i] = ss.str();
+    msgs[i].pop_back();
+  });
 
+  for (std::string &msg : msgs) {
     if (ctx.arg.unresolved_symbols == UNRESOLVED_ERROR)
       Error(ctx) << msg;
     else
@@ -1600,10 +2506,13 @@ template <typename E>
 void create_reloc_sections(Context<E> &ctx) {
   Timer t(ctx, "create_reloc_sections");
 
-  // Create .rela.* sections
+  // Create .rela.* sections. With --emit-relocs=alloc, we don't create
+  // them for non-allocated sections such as debug info sections, which
+  // post-link optimizers don't need but tend to have most relocations.
   tbb::parallel_for((i64)0, (i64)ctx.chunks.size(), [&](i64 i) {
     if (OutputSection<E> *osec = ctx.chunks[i]->to_osec())
-      osec->reloc_sec.reset(new RelocSection<E>(ctx, *osec));
+      if (!ctx.arg.emit_relocs_alloc || (osec->shdr.sh_flags & SHF_ALLOC))
+        osec->reloc_sec.reset(new RelocSection<E>(ctx, *osec));
   });
 
   for (i64 i = 0, end = ctx.chunks.size(); i < end; i++)
@@ -1617,10 +2526,19 @@ template <typename E>
 void copy_chunks(Context<E> &ctx) {
   Timer t(ctx, "copy_chunks");
 
+  if (ctx.arg.copy_file_range)
+    copy_verbatim_sections(ctx);
+
   auto copy = [&](Chunk<E> &chunk) {
-    std::string name = chunk.name.empty() ? "(header)" : std::string(chunk.name);
+    std::string_view name = chunk.name.empty() ? "(header)" : chunk.name;
     Timer t2(ctx, name, &t);
     chunk.copy_buf(ctx);
+
+    if (ctx.progress && chunk.shdr.sh_type != SHT_NOBITS)
+      ctx.progress->bytes_written += chunk.shdr.sh_size;
+
+    if (ctx.arg.early_writeback)
+      start_writeback(ctx, chunk);
   };
 
   // For --relocatable and --emit-relocs, we want to copy non-relocation
@@ -1634,13 +2552,60 @@ void copy_chunks(Context<E> &ctx) {
            (is_sh4<E> && chunk.shdr.sh_type == SHT_RELA);
   };
 
-  tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
+  // A REL-type relocation section for an output section depends only on
+  // that section, so it is started as soon as that section is written.
+  // Other REL-type chunks are written after all the others.
+  auto get_rel_chunk = [&](Chunk<E> *chunk) -> Chunk<E> * {
+    if (OutputSection<E> *osec = chunk->to_osec())
+      if (Chunk<E> *relsec = osec->reloc_sec.get(); relsec && is_rel(*relsec))
+        return relsec;
+    return nullptr;
+  };
+
+  std::vector<Chunk<E> *> chunks;
+  std::unordered_set<Chunk<E> *> dependent;
+
+  for (Chunk<E> *chunk : ctx.chunks) {
     if (!is_rel(*chunk))
-      copy(*chunk);
+      chunks.push_back(chunk);
+    if (Chunk<E> *relsec = get_rel_chunk(chunk))
+      dependent.insert(relsec);
+  }
+
+  // A huge chunk such as .debug_info or .text can take much longer to
+  // copy than the others. If it started late, all threads but one would
+  // wait for it at the end, so we start chunks in the order of their
+  // estimated costs, largest first. Applying a relocation is assumed to
+  // cost as much as copying 32 bytes.
+  std::vector<i64> costs(chunks.size());
+
+  tbb::parallel_for((i64)0, (i64)chunks.size(), [&](i64 i) {
+    if (chunks[i]->shdr.sh_type != SHT_NOBITS)
+      costs[i] = chunks[i]->shdr.sh_size;
+    if (OutputSection<E> *osec = chunks[i]->to_osec())
+      for (InputSection<E> *isec : osec->members)
+        costs[i] += isec->get_rels(ctx).size() * 32;
+  });
+
+  std::vector<i64> order(chunks.size());
+  for (i64 i = 0; i < chunks.size(); i++)
+    order[i] = i;
+
+  sort(order, [&](i64 a, i64 b) { return costs[a] > costs[b]; });
+
+  std::vector<Chunk<E> *> sorted;
+  for (i64 i : order)
+    sorted.push_back(chunks[i]);
+
+  tbb::parallel_for_each(sorted,
+                         [&](Chunk<E> *chunk, tbb::feeder<Chunk<E> *> &feeder) {
+    copy(*chunk);
+    if (Chunk<E> *relsec = get_rel_chunk(chunk))
+      feeder.add(relsec);
   });
 
   tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
-    if (is_rel(*chunk))
+    if (is_rel(*chunk) && !dependent.contains(chunk))
       copy(*chunk);
   });
 
@@ -1653,10 +2618,10 @@ void copy_chunks(Context<E> &ctx) {
   // Zero-clear paddings between chunks
   auto zero = [&](Chunk<E> *chunk, i64 next_start) {
     i64 pos = chunk->shdr.sh_offset + chunk->shdr.sh_size;
-    memset(ctx.buf + pos, 0, next_start - pos);
+    ctx.output_file->zero_range(pos, next_start - pos);
   };
 
-  std::vector<Chunk<E> *> chunks = ctx.chunks;
+  chunks = ctx.chunks;
 
   std::erase_if(chunks, [](Chunk<E> *chunk) {
     return chunk->shdr.sh_type == SHT_NOBITS;
@@ -1724,16 +2689,27 @@ void sort_dynsyms(Context<E> &ctx) {
     ctx.gnu_hash->num_exported = num_exported;
   }
 
-  // Compute .dynstr size
+  // Assign a .dynstr offset to each symbol name using a parallel prefix
+  // sum, so that .dynsym and .dynstr can be written in parallel. A DSO
+  // may export millions of symbols.
   ctx.dynstr->dynsym_offset = ctx.dynstr->shdr.sh_size;
 
-  tbb::enumerable_thread_specific<i64> size;
-  tbb::parallel_for((i64)1, (i64)syms.size(), [&](i64 i) {
-    syms[i]->set_dynsym_idx(ctx, i);
-    size.local() += syms[i]->name().size() + 1;
-  });
+  std::vector<u32> &offsets = ctx.dynsym->name_offsets;
+  offsets.resize(syms.size());
 
-  ctx.dynstr->shdr.sh_size += size.combine(std::plus());
+  auto scan = [&](const tbb::blocked_range<i64> &r, i64 sum, bool is_final) {
+    for (i64 i = r.begin(); i < r.end(); i++) {
+      if (is_final) {
+        syms[i]->set_dynsym_idx(ctx, i);
+        offsets[i] = ctx.dynstr->dynsym_offset + sum;
+      }
+      sum += syms[i]->name().size() + 1;
+    }
+    return sum;
+  };
+
+  ctx.dynstr->shdr.sh_size = ctx.dynstr->dynsym_offset + tbb::parallel_scan(
+    tbb::blocked_range<i64>(1, syms.size()), (i64)0, scan, std::plus());
 
   // ELF's symbol table sh_info holds the offset of the first global symbol.
   ctx.dynsym->shdr.sh_info = first_global - syms.begin();
@@ -1747,13 +2723,88 @@ void create_output_symtab(Context<E> &ctx) {
     chunk->compute_symtab_size(ctx);
   });
 
-  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+  for_each_obj_largest_first<E>(ctx, [&](ObjectFile<E> *file) {
     file->compute_symtab_size(ctx);
   });
 
   tbb::parallel_for_each(ctx.dsos, [&](SharedFile<E> *file) {
     file->compute_symtab_size(ctx);
   });
+
+  if (ctx.arg.tail_merge_strtab)
+    ctx.strtab->tail_merge_strings(ctx);
+}
+
+// Demangling every global symbol to match it against `extern "C++"`
+// version patterns is expensive. This function returns an identifier in
+// a given C++ pattern that must appear verbatim in a mangled name if the
+// demangled name matches the pattern, so that we can skip demangling
+// symbols that don't contain the identifier.
+//
+// In the Itanium mangling scheme, user-defined identifiers are copied
+// verbatim to mangled names. Others, such as type names, keywords and
+// std:: names, are encoded with short abbreviations, so we don't use
+// identifiers that can be a part of a word generated by the demangler.
+static std::optional<std::string_view>
+get_cpp_pattern_keyword(std::string_view pat) {
+  static const std::string_view reserved[] = {
+    "__bf16", "__cxa", "__float128", "__int128", "__restrict", "_Accum",
+    "_Complex", "_Float128", "_Float16", "_Float32", "_Float64", "_Fract",
+    "_Sat", "TLS", "VTT", "abi", "alias", "alignof", "allocator",
+    "anonymous", "arg", "auto", "basic_iostream", "basic_istream",
+    "basic_ostream", "basic_string", "binding", "bool", "char16_t",
+    "char32_t", "char8_t", "char_traits", "clone", "co_await", "const_cast",
+    "construction", "constructors", "covariant", "decimal", "decltype",
+    "default", "delete", "destructors", "double", "dynamic_cast",
+    "expansion", "false", "float", "fn", "for", "function", "global",
+    "guard", "half", "hidden", "init", "initializer", "iostream", "istream",
+    "java", "keyed", "lambda", "literal", "long", "namespace", "new",
+    "noexcept", "non", "nullptr_t",
+    "operator", "ostream", "pack", "parameter", "reference",
+    "reinterpret_cast", "requires", "resource", "restrict", "return",
+    "short", "signed", "sizeof", "static_cast", "std", "string",
+    "structured", "template", "temporary", "throw", "thunk", "to",
+    "transaction", "true", "type", "typeid", "typeinfo", "unnamed",
+    "unsigned", "variable", "virtual", "void", "volatile", "vtable",
+    "wchar_t", "wrapper",
+  };
+
+  auto is_reserved = [&](std::string_view tok) {
+    for (std::string_view word : reserved)
+      if (word.find(tok) != word.npos)
+        return true;
+    return false;
+  };
+
+  auto is_ident_char = [](char c) {
+    return isalnum((u8)c) || c == '_';
+  };
+
+  std::optional<std::string_view> best;
+
+  for (i64 i = 0; i < pat.size();) {
+    if (pat[i] == '\\') {
+      i += 2;
+    } else if (pat[i] == '[') {
+      i = pat.find(']', i + 1);
+      if (i == pat.npos)
+        return {};
+      i++;
+    } else if (is_ident_char(pat[i])) {
+      i64 j = i;
+      while (j < pat.size() && is_ident_char(pat[j]))
+        j++;
+
+      std::string_view tok = pat.substr(i, j - i);
+      if (!isdigit((u8)tok[0]) && !is_reserved(tok) &&
+          (!best || best->size() < tok.size()))
+        best = tok;
+      i = j;
+    } else {
+      i++;
+    }
+  }
+  return best;
 }
 
 template <typename E>
@@ -1783,11 +2834,23 @@ void apply_version_script(Context<E> &ctx) {
     return str.find_first_of("*?[") != str.npos;
   };
 
+  // A mangled name needs to be demangled only if it contains a keyword
+  // of a C++ pattern. If there is a C++ pattern without a keyword, all
+  // mangled names need to be demangled.
+  MultiGlob cpp_filter;
+  bool use_cpp_filter = true;
+
   for (i64 i = 0; i < patterns.size(); i++) {
     VersionPattern &v = patterns[i];
     if (v.is_cpp) {
       if (!cpp_matcher.add(v.pattern, i))
         Fatal(ctx) << "invalid version pattern: " << v.pattern;
+
+      std::optional<std::string_view> kw = get_cpp_pattern_keyword(v.pattern);
+      if (kw)
+        cpp_filter.add("*" + std::string(*kw) + "*", 0);
+      else
+        use_cpp_filter = false;
     } else if (has_wildcard(v.pattern)) {
       if (!matcher.add(v.pattern, i))
         Fatal(ctx) << "invalid version pattern: " << v.pattern;
@@ -1808,7 +2871,9 @@ void apply_version_script(Context<E> &ctx) {
 
         // Match non-mangled symbols against the C++ pattern as well.
         // Weird, but required to match other linkers' behavior.
-        if (!cpp_matcher.empty()) {
+        if (!cpp_matcher.empty() &&
+            (!use_cpp_filter || !name.starts_with("_Z") ||
+             cpp_filter.find(name))) {
           if (std::optional<std::string_view> s = demangle_cpp(name))
             name = *s;
           if (std::optional<i64> idx = cpp_matcher.find(name))
@@ -1824,10 +2889,21 @@ void apply_version_script(Context<E> &ctx) {
   // Next, assign versions to symbols specified by exact name.
   // In other words, exact matches have higher precedence over
   // wildcard or `extern "C++"` patterns.
-  for (VersionPattern &v : patterns) {
-    if (!v.is_cpp && !has_wildcard(v.pattern)) {
-      Symbol<E> *sym = get_symbol(ctx, v.pattern);
+  //
+  // A generated version script may list hundreds of thousands of names,
+  // so we look them up in parallel first. The versions are assigned in
+  // order below because the last pattern for the same name wins.
+  std::vector<Symbol<E> *> syms(patterns.size());
+
+  tbb::parallel_for((i64)0, (i64)patterns.size(), [&](i64 i) {
+    VersionPattern &v = patterns[i];
+    if (!v.is_cpp && !has_wildcard(v.pattern))
+      syms[i] = get_symbol(ctx, v.pattern);
+  });
 
+  for (i64 i = 0; i < patterns.size(); i++) {
+    VersionPattern &v = patterns[i];
+    if (Symbol<E> *sym = syms[i]) {
       if (!sym->file && !ctx.arg.undefined_version)
         Warn(ctx) << v.source << ": cannot assign version `" << v.ver_str
                   << "` to symbol `" << *sym << "`: symbol not found";
@@ -1916,6 +2992,77 @@ static bool should_export(Context<E> &ctx, Symbol<E> &sym) {
   }
 };
 
+// For --Bsymbolic-auto. We are given all executables and shared objects
+// that will load the shared object we are creating. A symbol needs to
+// stay preemptible only if one of them defines a symbol of the same name,
+// or if an executable refers to it via a canonical PLT entry, whose
+// address becomes the function's address in the entire process. All the
+// other symbols can be bound locally.
+//
+// This is called once before symbol resolution, because
+// compute_import_export() runs again after LTO.
+template <typename E>
+void read_interposed_symbols(Context<E> &ctx) {
+  if (!ctx.arg.shared || ctx.arg.Bsymbolic != BSYMBOLIC_AUTO)
+    return;
+
+  Timer t(ctx, "read_interposed_symbols");
+
+  for (std::string_view path : ctx.arg.Bsymbolic_auto) {
+    MappedFile *mf = must_open_file(ctx, std::string(path));
+    if (mf->size < sizeof(ElfEhdr<E>) ||
+        memcmp(mf->data, "\177ELF", 4) != 0)
+      Fatal(ctx) << path << ": --Bsymbolic-auto: not an ELF file";
+
+    // Check the class and the byte order before we read the header as E's.
+    if (mf->data[EI_CLASS] != (E::is_64 ? ELFCLASS64 : ELFCLASS32) ||
+        mf->data[EI_DATA] != (E::is_le ? ELFDATA2LSB : ELFDATA2MSB))
+      Fatal(ctx) << path << ": --Bsymbolic-auto: incompatible file type";
+
+    ElfEhdr<E> &ehdr = *(ElfEhdr<E> *)mf->data;
+    if (ehdr.e_machine != E::e_machine)
+      Fatal(ctx) << path << ": --Bsymbolic-auto: incompatible file type";
+    if ((ehdr.e_type != ET_EXEC && ehdr.e_type != ET_DYN) ||
+        mf->size < ehdr.e_shoff + ehdr.e_shnum * sizeof(ElfShdr<E>))
+      Fatal(ctx) << path << ": --Bsymbolic-auto: not an executable "
+                 << "or a shared object";
+
+    std::span<ElfShdr<E>> shdrs{(ElfShdr<E> *)(mf->data + ehdr.e_shoff),
+                                (size_t)ehdr.e_shnum};
+
+    for (ElfShdr<E> &shdr : shdrs) {
+      if (shdr.sh_type != SHT_DYNSYM)
+        continue;
+
+      if (shdr.sh_link >= shdrs.size() ||
+          mf->size < shdr.sh_offset + shdr.sh_size ||
+          mf->size < shdrs[shdr.sh_link].sh_offset +
+                     shdrs[shdr.sh_link].sh_size)
+        Fatal(ctx) << path << ": --Bsymbolic-auto: corrupted dynamic "
+                   << "symbol table";
+
+      ElfShdr<E> &strsec = shdrs[shdr.sh_link];
+
+      std::span<ElfSym<E>> syms{(ElfSym<E> *)(mf->data + shdr.sh_offset),
+                                (size_t)(shdr.sh_size / sizeof(ElfSym<E>))};
+      std::string_view strtab{(char *)mf->data + strsec.sh_offset,
+                              (size_t)strsec.sh_size};
+
+      for (i64 i = 1; i < syms.size(); i++) {
+        ElfSym<E> &esym = syms[i];
+        if (esym.st_bind == STB_LOCAL || esym.st_name >= strtab.size())
+          continue;
+
+        bool interposes = !esym.is_undef() &&
+                          esym.st_visibility == STV_DEFAULT;
+        bool canonical_plt = esym.is_undef() && esym.st_value;
+        if (interposes || canonical_plt)
+          ctx.interposed_syms.insert(strtab.data() + esym.st_name);
+      }
+    }
+  }
+}
+
 template <typename E>
 static bool is_protected(Context<E> &ctx, Symbol<E> &sym) {
   if (sym.visibility == STV_PROTECTED)
@@ -1932,6 +3079,8 @@ static bool is_protected(Context<E> &ctx, Symbol<E> &sym) {
     return !sym.is_weak;
   case BSYMBOLIC_NON_WEAK_FUNCTIONS:
     return !sym.is_weak && sym.get_type() == STT_FUNC;
+  case BSYMBOLIC_AUTO:
+    return !ctx.interposed_syms.contains(sym.name());
   default:
     unreachable();
   }
@@ -2044,88 +3193,44 @@ void compute_import_export(Context<E> &ctx) {
   }
 }
 
-// Compute the "address-taken" bit for each input section.
-//
-// As a space-saving optimization, we want to merge two read-only objects
-// into a single object if their contents are equivalent. That
-// optimization is called the Identical Code Folding or ICF.
-//
-// A catch is that comparing object contents is not enough to determine if
-// two objects can be merged safely; we need to take care of pointer
-// equivalence.
-//
-// In C/C++, two pointers are equivalent if and only if they are taken for
-// the same object. Merging two objects into a single object can break
-// this assumption because two distinctive pointers would become
-// equivalent as a result of merging. We can still merge one object with
-// another if no pointer to the object was taken in code, because without
-// a pointer, comparing its address becomes moot.
-//
-// In mold, each input section has an "address-taken" bit. If there is a
-// pointer-taking reference to the object, it's set to true. At the ICF
-// stage, we merge only objects whose addresses were not taken.
-//
-// For functions, address-taking relocations are separated from
-// non-address-taking ones. For example, x86-64 uses R_X86_64_PLT32 for
-// direct function calls (e.g., "call foo" to call the function foo) while
-// R_X86_64_PC32 or R_X86_64_GOT32 are used for pointer-taking operations.
-//
-// Unfortunately, for data, we can't distinguish between address-taking
-// relocations and non-address-taking ones. LLVM generates an "address
-// significance" table in the ".llvm_addrsig" section to mark symbols
-// whose addresses are taken in code. If that table is available, we use
-// that information in this function. Otherwise, we conservatively assume
-// that all data items are address-taken.
+// --gc-sections and --icf both need to know which sections refer to
+// which. Walking relocations and looking up their symbols is not cheap
+// for large programs, so if both are enabled, we do that only once and
+// save the result as a compact per-file array. InputSection::for_each_ref()
+// uses the array if available.
 template <typename E>
-void compute_address_significance(Context<E> &ctx) {
-  Timer t(ctx, "compute_address_significance");
+void build_section_refs(Context<E> &ctx) {
+  Timer t(ctx, "build_section_refs");
 
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
-    // If .llvm_addrsig is available, use it.
-    if (InputSection<E> *sec = file->llvm_addrsig.get()) {
-      u8 *p = (u8 *)sec->contents.data();
-      u8 *end = p + sec->contents.size();
-      while (p != end) {
-        Symbol<E> *sym = file->symbols[read_uleb(&p)];
-        if (InputSection<E> *isec = sym->get_input_section())
-          isec->address_taken = true;
-      }
-      return;
-    }
+    file->section_ref_indices.resize(file->sections.size() + 1);
 
-    // Otherwise, infer address significance.
-    for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+    for (i64 i = 0; i < file->sections.size(); i++) {
+      file->section_ref_indices[i] = file->section_refs.size();
+
+      InputSection<E> *isec = file->sections[i].get();
       if (!isec || !isec->is_alive || !(isec->shdr().sh_flags & SHF_ALLOC))
         continue;
 
-      if (!(isec->shdr().sh_flags & SHF_EXECINSTR))
-        isec->address_taken = true;
-
-      for (const ElfRel<E> &r : isec->get_rels(ctx))
-        if (!is_func_call_rel(r))
-          if (Symbol<E> *sym = file->symbols[r.r_sym];
-              InputSection<E> *dst = sym->get_input_section())
-            if (dst->shdr().sh_flags & SHF_EXECINSTR)
-              dst->address_taken = true;
+      for (const ElfRel<E> &rel : isec->get_rels(ctx)) {
+        Symbol<E> &sym = *file->symbols[rel.r_sym];
+        if (SectionFragment<E> *frag = sym.get_frag())
+          file->section_refs.push_back(frag);
+        else if (InputSection<E> *dst = sym.get_input_section())
+          file->section_refs.push_back({dst, is_func_call_rel(rel)});
+      }
     }
-  });
-
-  auto mark = [](Symbol<E> *sym) {
-    if (sym)
-      if (InputSection<E> *isec = sym->get_input_section())
-        isec->address_taken = true;
-  };
 
-  // Some symbols' pointer values are leaked to the dynamic section.
-  mark(ctx.arg.entry);
-  mark(ctx.arg.init);
-  mark(ctx.arg.fini);
+    file->section_ref_indices.back() = file->section_refs.size();
+  });
+}
 
-  // Exported symbols are conservatively considered address-taken.
-  if (ctx.dynsym)
-    for (Symbol<E> *sym : ctx.dynsym->symbols)
-      if (sym && sym->is_exported)
-        mark(sym);
+template <typename E>
+void release_section_refs(Context<E> &ctx) {
+  tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+    file->section_ref_indices = {};
+    file->section_refs = {};
+  });
 }
 
 // We want to sort output chunks in the following order.
@@ -2440,6 +3545,18 @@ static void set_virtual_addresses_regular(Context<E> &ctx) {
       }
     }
 
+    // -z hugepage-text aligns the beginning and the end of executable
+    // segments to huge page boundaries, so that the runtime can remap
+    // the code onto huge pages without sharing one with other segments.
+    // We don't pad the end on disk; set_file_offsets() takes care of
+    // the beginning.
+    if (ctx.arg.z_hugepage_text && !ctx.arg.nmagic) {
+      bool x1 = (i > 0) && (to_phdr_flags(ctx, chunks[i - 1]) & PF_X);
+      bool x2 = to_phdr_flags(ctx, chunks[i]) & PF_X;
+      if (x1 != x2)
+        addr = align_to(addr, HUGE_PAGE_SIZE);
+    }
+
     // TLS BSS sections are laid out so that they overlap with the
     // subsequent non-tbss sections. Overlapping is fine because a STT_TLS
     // segment contains an initialization image for newly-created threads,
@@ -2464,6 +3581,14 @@ static void set_virtual_addresses_regular(Context<E> &ctx) {
     }
 
     addr = align_to(addr, alignment(chunks[i]));
+
+    // With --stable-layout, we move a chunk forward to its previous
+    // address if the preceding chunks haven't grown.
+    if (auto it = ctx.stable_chunk_addrs.find(std::string(chunks[i]->name));
+        it != ctx.stable_chunk_addrs.end() && it->second != -1 &&
+        addr < it->second && it->second % alignment(chunks[i]) == 0)
+      addr = it->second;
+
     chunks[i]->shdr.sh_addr = addr;
     addr += chunks[i]->shdr.sh_size;
   }
@@ -2553,6 +3678,10 @@ static i64 set_file_offsets(Context<E> &ctx) {
   u64 fileoff = 0;
   i64 i = 0;
 
+  auto is_exec = [&](Chunk<E> *chunk) {
+    return to_phdr_flags(ctx, chunk) & PF_X;
+  };
+
   while (i < chunks.size()) {
     Chunk<E> &first = *chunks[i];
 
@@ -2572,6 +3701,8 @@ static i64 set_file_offsets(Context<E> &ctx) {
 
     if (first.shdr.sh_addralign > ctx.page_size)
       fileoff = align_to(fileoff, first.shdr.sh_addralign);
+    else if (ctx.arg.z_hugepage_text && is_exec(&first))
+      fileoff = align_with_skew(fileoff, HUGE_PAGE_SIZE, first.shdr.sh_addr);
     else
       fileoff = align_with_skew(fileoff, ctx.page_size, first.shdr.sh_addr);
 
@@ -2592,6 +3723,12 @@ static i64 set_file_offsets(Context<E> &ctx) {
       if (chunks[i]->shdr.sh_addr < first.shdr.sh_addr)
         break;
 
+      // An executable segment has to start at a new file offset that is
+      // congruent to its address modulo the huge page size.
+      if (ctx.arg.z_hugepage_text && is_exec(chunks[i]) &&
+          !is_exec(chunks[i - 1]))
+        break;
+
       i64 gap_size = chunks[i]->shdr.sh_addr - chunks[i - 1]->shdr.sh_addr -
                      chunks[i - 1]->shdr.sh_size;
 
@@ -2674,10 +3811,50 @@ void compute_section_headers(Context<E> &ctx) {
   }
 }
 
-// Assign virtual addresses and file offsets to output sections.
+// If only non-alloc chunks have changed since the last layout, which
+// is the case for debug section compression, we don't need to assign
+// virtual addresses again. We just need to assign new file offsets to
+// the chunks at or after the first changed one. Returns -1 if the layout
+// has to be computed from scratch.
 template <typename E>
-i64 set_osec_offsets(Context<E> &ctx) {
-  Timer t(ctx, "set_osec_offsets");
+static i64 update_file_offsets(Context<E> &ctx) {
+  std::vector<Chunk<E> *> &chunks = ctx.chunks;
+  auto &last = ctx.last_layout;
+
+  i64 i = 0;
+  while (i < chunks.size() && i < last.size() && chunks[i] == last[i].chunk &&
+         chunks[i]->shdr.sh_size == last[i].size &&
+         chunks[i]->shdr.sh_addralign == last[i].align)
+    i++;
+
+  if (i == chunks.size() && i == last.size())
+    return ctx.last_filesize;
+
+  for (i64 j = i; j < chunks.size(); j++)
+    if (chunks[j]->shdr.sh_flags & SHF_ALLOC)
+      return -1;
+
+  u64 fileoff = 0;
+  if (i > 0) {
+    ElfShdr<E> &shdr = chunks[i - 1]->shdr;
+    fileoff = shdr.sh_offset;
+    if (!(shdr.sh_flags & SHF_ALLOC) || shdr.sh_type != SHT_NOBITS)
+      fileoff += shdr.sh_size;
+  }
+
+  for (; i < chunks.size(); i++) {
+    fileoff = align_to(fileoff, chunks[i]->shdr.sh_addralign);
+    chunks[i]->shdr.sh_offset = fileoff;
+    fileoff += chunks[i]->shdr.sh_size;
+  }
+  return fileoff;
+}
+
+template <typename E>
+static i64 do_set_osec_offsets(Context<E> &ctx) {
+  if (!ctx.last_layout.empty())
+    if (i64 fileoff = update_file_offsets(ctx); fileoff != -1)
+      return fileoff;
 
   for (;;) {
     if (ctx.arg.section_order.empty())
@@ -2700,6 +3877,21 @@ i64 set_osec_offsets(Context<E> &ctx) {
   }
 }
 
+// Assign virtual addresses and file offsets to output sections.
+template <typename E>
+i64 set_osec_offsets(Context<E> &ctx) {
+  Timer t(ctx, "set_osec_offsets");
+
+  i64 fileoff = do_set_osec_offsets(ctx);
+
+  ctx.last_layout.clear();
+  for (Chunk<E> *chunk : ctx.chunks)
+    ctx.last_layout.push_back({chunk, chunk->shdr.sh_size,
+                               chunk->shdr.sh_addralign});
+  ctx.last_filesize = fileoff;
+  return fileoff;
+}
+
 template <typename E>
 static i64 get_num_irelative_relocs(Context<E> &ctx) {
   i64 n = std::count_if(ctx.got->got_syms.begin(), ctx.got->got_syms.end(),
@@ -2930,14 +4122,45 @@ template <typename E>
 void compress_debug_sections(Context<E> &ctx) {
   Timer t(ctx, "compress_debug_sections");
 
+  // Sections that the loader, the linker or other tools need to read
+  // as-is cannot be compressed.
+  auto is_compressible = [](Chunk<E> &chunk) {
+    u32 type = chunk.shdr.sh_type;
+    return !(chunk.shdr.sh_flags & SHF_ALLOC) && chunk.shdr.sh_size &&
+           type != SHT_NOBITS && type != SHT_SYMTAB && type != SHT_STRTAB &&
+           type != SHT_SYMTAB_SHNDX && type != SHT_REL && type != SHT_RELA &&
+           type != SHT_GROUP;
+  };
+
+  // --compress-sections takes precedence over --compress-debug-sections,
+  // and a later --compress-sections takes precedence over earlier ones.
+  auto get_kind = [&](Chunk<E> &chunk) -> std::pair<CompressKind, i64> {
+    std::vector<CompressSectionsPattern> &vec = ctx.arg.compress_sections;
+    for (i64 i = vec.size() - 1; i >= 0; i--)
+      if (vec[i].glob.match(chunk.name))
+        return {vec[i].kind, vec[i].level};
+
+    if (chunk.name.starts_with(".debug"))
+      return {ctx.arg.compress_debug_sections, ctx.arg.compress_debug_level};
+    return {COMPRESS_NONE, -1};
+  };
+
+  // .gdb_index is created from relocated debug sections. Create it now
+  // so that CompressedSection doesn't have to keep their uncompressed
+  // contents.
+  if (ctx.gdb_index)
+    create_gdb_index_early(ctx);
+
   tbb::parallel_for((i64)0, (i64)ctx.chunks.size(), [&](i64 i) {
     Chunk<E> &chunk = *ctx.chunks[i];
+    if (!is_compressible(chunk))
+      return;
 
-    if ((chunk.shdr.sh_flags & SHF_ALLOC) || chunk.shdr.sh_size == 0 ||
-        !chunk.name.starts_with(".debug"))
+    auto [kind, level] = get_kind(chunk);
+    if (kind == COMPRESS_NONE)
       return;
 
-    Chunk<E> *comp = new CompressedSection<E>(ctx, chunk);
+    Chunk<E> *comp = new CompressedSection<E>(ctx, chunk, kind, level);
     ctx.chunk_pool.emplace_back(comp);
     ctx.chunks[i] = comp;
   });
@@ -2960,9 +4183,11 @@ static void blake3_hash(u8 *buf, i64 size, u8 *out) {
   blake3_hasher_finalize(&hasher, out, BLAKE3_OUT_LEN);
 }
 
+static constexpr i64 BUILD_ID_SHARD_SIZE = 4 * 1024 * 1024; // 4 MiB
+
 template <typename E>
 std::vector<std::span<u8>> get_shards(Context<E> &ctx) {
-  constexpr i64 shard_size = 4 * 1024 * 1024; // 4 MiB
+  constexpr i64 shard_size = BUILD_ID_SHARD_SIZE;
   std::span<u8> buf = {ctx.buf, (size_t)ctx.output_file->filesize};
   std::vector<std::span<u8>> vec;
 
@@ -2974,32 +4199,158 @@ std::vector<std::span<u8>> get_shards(Context<E> &ctx) {
   return vec;
 }
 
+template <typename E>
+static void hash_shard(Context<E> &ctx, std::span<u8> shard, i64 i) {
+  blake3_hash(shard.data(), shard.size(),
+              ctx.build_id_hashes.data() + i * BLAKE3_OUT_LEN);
+
+#ifdef HAVE_MADVISE
+  // Make the kernel page out the file contents we've just written
+  // so that subsequent close(2) call will become quicker.
+  if (i > 0 && ctx.output_file->is_mmapped)
+    madvise(shard.data(), shard.size(), MADV_DONTNEED);
+#endif
+}
+
+// --build-id=inputs derives a build ID from the contents of the input
+// files, the command line and the mold version instead of the output
+// file. Since it's known before we write the output, we don't need to
+// read the output file back.
+//
+// Each file is hashed before it's parsed, because parsing may rewrite
+// relocations in the mmap'ed buffer in place.
+template <typename E>
+void hash_input_file(Context<E> &ctx, InputFile<E> *file) {
+  if (ctx.arg.build_id.kind == BuildId::INPUTS)
+    blake3_hash(file->mf->data, file->mf->size, file->content_hash);
+}
+
+template <typename E>
+void compute_input_build_id(Context<E> &ctx) {
+  if (ctx.arg.build_id.kind != BuildId::INPUTS)
+    return;
+
+  Timer t(ctx, "compute_input_build_id");
+
+  // Only the files that are included in the output contribute. IR
+  // object files have been replaced with the object files the LTO
+  // plugin compiled them into.
+  std::vector<InputFile<E> *> files;
+  for (ObjectFile<E> *file : ctx.objs)
+    if (file->is_alive && file->mf)
+      files.push_back(file);
+  for (SharedFile<E> *file : ctx.dsos)
+    if (file->is_alive)
+      files.push_back(file);
+
+  sort(files, [](InputFile<E> *a, InputFile<E> *b) {
+    return a->priority < b->priority;
+  });
+
+  // Linker scripts, version scripts and such are text files. They are
+  // never modified, so we can hash them here.
+  std::vector<MappedFile *> scripts;
+  for (std::unique_ptr<MappedFile> &mf : ctx.mf_pool)
+    if (!mf->parent && get_file_type(ctx, mf.get()) == FileType::TEXT)
+      scripts.push_back(mf.get());
+
+  sort(scripts, [](MappedFile *a, MappedFile *b) { return a->name < b->name; });
+  scripts.erase(std::unique(scripts.begin(), scripts.end(),
+                            [](MappedFile *a, MappedFile *b) {
+                              return a->name == b->name;
+                            }),
+                scripts.end());
+
+  std::vector<u8> buf((files.size() + scripts.size()) * BLAKE3_OUT_LEN);
+
+  for (i64 i = 0; i < files.size(); i++)
+    memcpy(buf.data() + i * BLAKE3_OUT_LEN, files[i]->content_hash,
+           BLAKE3_OUT_LEN);
+
+  tbb::parallel_for((i64)0, (i64)scripts.size(), [&](i64 i) {
+    blake3_hash(scripts[i]->data, scripts[i]->size,
+                buf.data() + (files.size() + i) * BLAKE3_OUT_LEN);
+  });
+
+  std::string str = get_mold_version();
+  for (std::string_view arg : ctx.cmdline_args)
+    if (!is_lto_resolution_arg(arg))
+      str += "\0"s + std::string(arg);
+  buf.insert(buf.end(), str.begin(), str.end());
+
+  u8 digest[BLAKE3_OUT_LEN];
+  blake3_hash(buf.data(), buf.size(), digest);
+
+  assert(ctx.arg.build_id.size() <= BLAKE3_OUT_LEN);
+  ctx.arg.build_id.value = {digest, digest + ctx.arg.build_id.size()};
+}
+
+// Computing a build-id hash requires reading the entire output file.
+// To take it off the critical path, this function starts hashing the
+// shards that no pass modifies after copy_chunks() in the background.
+// The remaining shards are hashed by write_build_id().
+template <typename E>
+void start_build_id(Context<E> &ctx) {
+  if (ctx.arg.build_id.kind != BuildId::HASH)
+    return;
+
+  Timer t(ctx, "start_build_id");
+
+  std::vector<std::span<u8>> shards = get_shards(ctx);
+  ctx.build_id_hashes.resize(shards.size() * BLAKE3_OUT_LEN);
+  ctx.build_id_is_deferred.resize(shards.size());
+
+  auto defer = [&](Chunk<E> *chunk) {
+    if (!chunk || chunk->shdr.sh_type == SHT_NOBITS || chunk->shdr.sh_size == 0)
+      return;
+    i64 begin = chunk->shdr.sh_offset / BUILD_ID_SHARD_SIZE;
+    i64 end = align_to(chunk->shdr.sh_offset + chunk->shdr.sh_size,
+                       BUILD_ID_SHARD_SIZE) / BUILD_ID_SHARD_SIZE;
+    for (i64 i = begin; i < end && i < shards.size(); i++)
+      ctx.build_id_is_deferred[i] = true;
+  };
+
+  // These are the chunks modified by the passes between copy_chunks()
+  // and write_build_id() in mold_main().
+  defer(ctx.reldyn);
+
+  if (ctx.gdb_index && ctx.arg.separate_debug_file.empty())
+    defer(ctx.shdr);
+
+  for (i64 i = 0; i < shards.size(); i++)
+    if (!ctx.build_id_is_deferred[i])
+      ctx.build_id_tg.run([&ctx, shard = shards[i], i] {
+        hash_shard(ctx, shard, i);
+      });
+}
+
 template <typename E>
 void write_build_id(Context<E> &ctx) {
   Timer t(ctx, "write_build_id");
 
   switch (ctx.arg.build_id.kind) {
   case BuildId::HEX:
-    ctx.buildid->contents = ctx.arg.build_id.value;
-    break;
+  case BuildId::INPUTS:
+    // The build ID was known before copy_chunks() and has been written.
+    return;
   case BuildId::HASH: {
     std::vector<std::span<u8>> shards = get_shards(ctx);
-    std::vector<u8> hashes(shards.size() * BLAKE3_OUT_LEN);
 
-    tbb::parallel_for((i64)0, (i64)shards.size(), [&](i64 i) {
-      blake3_hash(shards[i].data(), shards[i].size(),
-                  hashes.data() + i * BLAKE3_OUT_LEN);
+    // If start_build_id() has not been called, hash everything here.
+    if (ctx.build_id_is_deferred.empty()) {
+      ctx.build_id_hashes.resize(shards.size() * BLAKE3_OUT_LEN);
+      ctx.build_id_is_deferred.resize(shards.size(), true);
+    }
 
-#ifdef HAVE_MADVISE
-      // Make the kernel page out the file contents we've just written
-      // so that subsequent close(2) call will become quicker.
-      if (i > 0 && ctx.output_file->is_mmapped)
-        madvise(shards[i].data(), shards[i].size(), MADV_DONTNEED);
-#endif
+    tbb::parallel_for((i64)0, (i64)shards.size(), [&](i64 i) {
+      if (ctx.build_id_is_deferred[i])
+        hash_shard(ctx, shards[i], i);
     });
 
+    ctx.build_id_tg.wait();
+
     u8 buf[BLAKE3_OUT_LEN];
-    blake3_hash(hashes.data(), hashes.size(), buf);
+    blake3_hash(ctx.build_id_hashes.data(), ctx.build_id_hashes.size(), buf);
 
     assert(ctx.arg.build_id.size() <= BLAKE3_OUT_LEN);
     ctx.buildid->contents = {buf, buf + ctx.arg.build_id.size()};
@@ -3059,6 +4410,157 @@ void write_gnu_debuglink(Context<E> &ctx) {
   ctx.gnu_debuglink->copy_buf(ctx);
 }
 
+// --emit-delta=FILE writes a patch that turns the previous output file
+// into the new one, so that a deployment pipeline doesn't have to read
+// both files again to diff them. We map the previous file before
+// creating a new output file. Since the new file is written to a
+// temporary file and renamed at the end, the old contents are intact
+// until then.
+template <typename E>
+void open_delta_base(Context<E> &ctx) {
+  std::string path = ctx.arg.output;
+  if (path.starts_with('/') && !ctx.arg.chroot.empty())
+    path = ctx.arg.chroot + "/" + path_clean(path);
+
+  std::string error;
+  ctx.delta_base.reset(open_file_impl(path, error));
+}
+
+// A patch file starts with a magic string "MOLDDLT1" followed by the
+// sizes of the new file and the previous file. It is followed by
+// records, each of which consists of an offset, a size and that many
+// bytes of the new file. All integers are 64-bit little-endian.
+//
+// We compare the two images in 4 KiB blocks, and consecutive blocks
+// that differ are merged into one record.
+template <typename E>
+void write_delta(Context<E> &ctx) {
+  Timer t(ctx, "write_delta");
+
+  constexpr i64 BLOCK_SIZE = 4096;
+  constexpr i64 REGION_SIZE = 1024 * 1024;
+
+  u8 *buf = ctx.buf;
+  i64 size = ctx.output_file->filesize;
+  u8 *old = ctx.delta_base ? ctx.delta_base->data : nullptr;
+  i64 old_size = ctx.delta_base ? ctx.delta_base->size : 0;
+
+  struct Record {
+    i64 offset;
+    i64 size;
+  };
+
+  i64 num_regions = align_to(size, REGION_SIZE) / REGION_SIZE;
+  std::vector<std::vector<Record>> records(num_regions);
+
+  tbb::parallel_for((i64)0, num_regions, [&](i64 i) {
+    i64 end = std::min<i64>(size, (i + 1) * REGION_SIZE);
+
+    for (i64 off = i * REGION_SIZE; off < end; off += BLOCK_SIZE) {
+      i64 len = std::min<i64>(BLOCK_SIZE, end - off);
+      if (off + len <= old_size && memcmp(buf + off, old + off, len) == 0)
+        continue;
+
+      std::vector<Record> &vec = records[i];
+      if (!vec.empty() && vec.back().offset + vec.back().size == off)
+        vec.back().size += len;
+      else
+        vec.push_back({off, len});
+    }
+  });
+
+  // Data appended to the end of the output file at close.
+  std::vector<u8> &buf2 = ctx.output_file->buf2;
+
+  FILE *fp = fopen(ctx.arg.emit_delta.c_str(), "w");
+  if (!fp)
+    Fatal(ctx) << "cannot open " << ctx.arg.emit_delta << ": "
+               << errno_string();
+
+  auto write_u64 = [&](u64 val) {
+    ul64 x = val;
+    fwrite(&x, sizeof(x), 1, fp);
+  };
+
+  fwrite("MOLDDLT1", 8, 1, fp);
+  write_u64(size + buf2.size());
+  write_u64(old_size);
+
+  i64 total = 0;
+  for (std::vector<Record> &vec : records) {
+    for (Record &rec : vec) {
+      write_u64(rec.offset);
+      write_u64(rec.size);
+      fwrite(buf + rec.offset, rec.size, 1, fp);
+      total += rec.size;
+    }
+  }
+
+  if (!buf2.empty()) {
+    write_u64(size);
+    write_u64(buf2.size());
+    fwrite(buf2.data(), buf2.size(), 1, fp);
+    total += buf2.size();
+  }
+
+  if (fclose(fp))
+    Fatal(ctx) << ctx.arg.emit_delta << ": write failed: " << errno_string();
+
+  static Counter counter("delta_bytes");
+  counter += total;
+}
+
+// A debug section whose contents have already been written to a buffer
+// by start_separate_debug_file().
+template <typename E>
+class PrewrittenSection : public Chunk<E> {
+public:
+  PrewrittenSection(Chunk<E> &chunk, std::vector<u8> contents)
+    : contents(std::move(contents)) {
+    this->name = chunk.name;
+    this->shdr = chunk.shdr;
+    this->shndx = chunk.shndx;
+  }
+
+  void copy_buf(Context<E> &ctx) override {
+    write_vector(ctx.buf + this->shdr.sh_offset, contents);
+  }
+
+private:
+  std::vector<u8> contents;
+};
+
+// Relocating .debug_* sections is usually the most expensive part of
+// creating a debug info file. Unlike other parts, it doesn't depend on
+// the main output file's contents, so with --async-debug-file, we start
+// doing that into separate buffers in a low-priority arena so that it
+// runs concurrently with copy_chunks() for the main file while giving
+// way to it.
+template <typename E>
+void start_separate_debug_file(Context<E> &ctx) {
+  for (Chunk<E> *chunk : ctx.debug_chunks)
+    if (chunk->name.starts_with(".debug_"))
+      ctx.debug_contents[chunk];
+
+  ctx.debug_arena.execute([&] {
+    ctx.debug_tg.run([&] {
+      Timer t(ctx, "relocate_debug_sections");
+
+      // Debug sections refer to each other, so all input section offsets
+      // have to be fixed before we apply relocations to any of them.
+      tbb::parallel_for_each(ctx.debug_contents, [&](auto &kv) {
+        kv.first->compute_section_size(ctx);
+      });
+
+      tbb::parallel_for_each(ctx.debug_contents, [&](auto &kv) {
+        Chunk<E> *chunk = kv.first;
+        kv.second.resize(chunk->shdr.sh_size);
+        chunk->write_to(ctx, kv.second.data(), nullptr);
+      });
+    });
+  });
+}
+
 // Write a separate debug file. This function is called after we finish
 // writing to the usual output file.
 template <typename E>
@@ -3092,8 +4594,12 @@ void write_separate_debug_file(Context<E> &ctx) {
 
   // Restore debug info sections that had been set aside while we were
   // creating the main file.
+  if (ctx.arg.async_debug_file)
+    ctx.debug_arena.execute([&] { ctx.debug_tg.wait(); });
+
   tbb::parallel_for_each(ctx.debug_chunks, [&](Chunk<E> *chunk) {
-    chunk->compute_section_size(ctx);
+    if (!ctx.debug_contents.contains(chunk))
+      chunk->compute_section_size(ctx);
   });
 
   append(ctx.chunks, ctx.debug_chunks);
@@ -3102,11 +4608,23 @@ void write_separate_debug_file(Context<E> &ctx) {
   compute_section_headers(ctx);
   file->resize(ctx, set_osec_offsets(ctx));
 
+  // Sections that have already been relocated just need to be copied.
+  for (Chunk<E> *&chunk : ctx.chunks) {
+    if (auto it = ctx.debug_contents.find(chunk); it != ctx.debug_contents.end()) {
+      Chunk<E> *sec = new PrewrittenSection<E>(*chunk, std::move(it->second));
+      ctx.chunk_pool.emplace_back(sec);
+      chunk = sec;
+    }
+  }
+
   ctx.output_file.reset(file);
   ctx.buf = ctx.output_file->buf;
 
   copy_chunks(ctx);
 
+  if (!ctx.arg.dwp.empty())
+    start_dwp(ctx);
+
   if (ctx.gdb_index)
     write_gdb_index(ctx);
 
@@ -3152,6 +4670,83 @@ void write_dependency_file(Context<E> &ctx) {
   out.close();
 }
 
+// For --stats. Records the number of bytes held by each major data
+// structure so that we can tell which one is responsible for memory usage.
+// This is called at the beginning of each phase. The numbers are
+// estimates that don't include allocator overhead.
+template <typename E>
+void sample_memory_usage(Context<E> &ctx, std::string_view phase) {
+  if (!ctx.arg.stats)
+    return;
+
+  i64 objs = 0;
+  for (std::unique_ptr<ObjectFile<E>> &file : ctx.obj_pool) {
+    objs += sizeof(ObjectFile<E>) +
+            file->sections.capacity() * sizeof(file->sections[0]) +
+            file->symbols.capacity() * sizeof(Symbol<E> *) +
+            file->mergeable_sections.capacity() * sizeof(void *) +
+            file->cies.capacity() * sizeof(CieRecord<E>) +
+            file->fdes.capacity() * sizeof(FdeRecord<E>);
+
+    for (std::unique_ptr<InputSection<E>> &isec : file->sections)
+      if (isec)
+        objs += sizeof(InputSection<E>);
+  }
+
+  i64 mapped = 0;
+  i64 resident = 0;
+  for (std::unique_ptr<MappedFile> &mf : ctx.mf_pool) {
+    if (!mf->parent && mf->data) {
+      mapped += mf->size;
+      resident += mf->get_resident_size();
+    }
+  }
+
+  i64 merged = 0;
+  for (std::unique_ptr<MergedSection<E>> &sec : ctx.merged_sections)
+    merged += sec->map.nbuckets * sizeof(*sec->map.entries);
+
+  i64 compressed = 0;
+  for (Chunk<E> *chunk : ctx.chunks)
+    if (chunk->shdr.sh_flags & SHF_COMPRESSED)
+      compressed += chunk->shdr.sh_size;
+
+  // Linker-synthesized strings are allocated from string_arena.
+  i64 strings = ctx.string_pool_bytes + ctx.string_arena.get_allocated_size();
+
+  ctx.memory_samples.push_back({phase, {
+    {"obj_pool", objs},
+    {"string_pool", strings},
+    {"mf_pool_mapped", mapped},
+    {"mf_pool_resident", resident},
+    {"symbol_map", ctx.symbol_map.get_memory_usage()},
+    {"symbol_aux", (i64)(ctx.symbol_aux.capacity() * sizeof(SymbolAux<E>))},
+    {"merged_section_maps", merged},
+    {"icf_digests", ctx.icf_digest_bytes},
+    {"compressed_sections", compressed},
+  }});
+}
+
+template <typename E>
+static void print_memory_samples(Context<E> &ctx) {
+  std::vector<typename Context<E>::MemorySample> &vec = ctx.memory_samples;
+  if (vec.empty())
+    return;
+
+  std::cout << std::setw(20) << std::right << "memory (KiB)";
+  for (typename Context<E>::MemorySample &sample : vec)
+    std::cout << " " << std::setw(16) << std::right << sample.phase;
+  std::cout << "\n";
+
+  for (i64 i = 0; i < vec[0].bytes.size(); i++) {
+    std::cout << std::setw(20) << std::right << vec[0].bytes[i].first;
+    for (typename Context<E>::MemorySample &sample : vec)
+      std::cout << " " << std::setw(16) << std::right
+                << sample.bytes[i].second / 1024;
+    std::cout << "\n";
+  }
+}
+
 template <typename E>
 void show_stats(Context<E> &ctx) {
   for (ObjectFile<E> *obj : ctx.objs) {
@@ -3178,9 +4773,13 @@ void show_stats(Context<E> &ctx) {
     comdats += obj->comdat_groups.size();
 
     static Counter removed_comdats("removed_comdat_mem");
-    for (ComdatGroupRef<E> &ref : obj->comdat_groups)
-      if (ref.group->owner != obj->priority)
+    static Counter dedup_comdats("deduplicated_comdats");
+    for (ComdatGroupRef<E> &ref : obj->comdat_groups) {
+      if (ref.group->owner != obj->priority) {
         removed_comdats += ref.members.size();
+        dedup_comdats++;
+      }
+    }
 
     static Counter num_cies("num_cies");
     num_cies += obj->cies.size();
@@ -3202,9 +4801,20 @@ void show_stats(Context<E> &ctx) {
   for (ObjectFile<E> *file : ctx.objs)
     num_input_sections += file->sections.size();
 
-  static Counter num_output_chunks("output_chunks", ctx.chunks.size());
-  static Counter num_objs("num_objs", ctx.objs.size());
-  static Counter num_dsos("num_dsos", ctx.dsos.size());
+  static Counter isec_size("input_section_object_size",
+                           sizeof(InputSection<E>));
+
+  static Counter num_output_chunks("output_chunks");
+  static Counter num_objs("num_objs");
+  static Counter num_dsos("num_dsos");
+  num_output_chunks += ctx.chunks.size();
+  num_objs += ctx.objs.size();
+  num_dsos += ctx.dsos.size();
+
+  static Counter malloc_commit("malloc_commit");
+  static Counter malloc_peak("malloc_peak_commit");
+  malloc_commit += get_mimalloc_commit();
+  malloc_peak += get_mimalloc_peak_commit();
 
   if constexpr (needs_thunk<E>) {
     static Counter thunk_bytes("thunk_bytes");
@@ -3216,15 +4826,122 @@ void show_stats(Context<E> &ctx) {
 
   Counter::print();
 
+  sample_memory_usage(ctx, "end");
+  print_memory_samples(ctx);
+
   for (std::unique_ptr<MergedSection<E>> &sec : ctx.merged_sections)
     sec->print_stats(ctx);
 }
 
+// Handles --perf=trace:<file>
+template <typename E>
+void write_perf_trace(Context<E> &ctx) {
+  std::ofstream out;
+  out.open(ctx.arg.perf_trace);
+  if (out.fail())
+    Fatal(ctx) << "--perf=trace: cannot open " << ctx.arg.perf_trace
+               << ": " << errno_string();
+  write_timer_trace(ctx.timer_records, out);
+}
+
+// Handles --input-stats. It writes how much each input file contributes
+// to the output and to the link time, so that we can find input files
+// that are disproportionately expensive to link. The output is in CSV,
+// or in JSON if a given filename ends with ".json".
+template <typename E>
+void write_input_stats(Context<E> &ctx) {
+  struct InputStats {
+    std::string name;
+    i64 bytes = 0;
+    i64 sections = 0;
+    i64 relocs = 0;
+    i64 fragments = 0;
+  };
+
+  std::vector<InputStats> vec(ctx.objs.size());
+
+  tbb::parallel_for((i64)0, (i64)ctx.objs.size(), [&](i64 i) {
+    ObjectFile<E> *file = ctx.objs[i];
+    InputStats &stats = vec[i];
+
+    std::stringstream ss;
+    ss << *file;
+    stats.name = ss.str();
+
+    for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+      if (isec && isec->is_alive && isec->output_section) {
+        stats.bytes += isec->sh_size;
+        stats.sections++;
+        stats.relocs += isec->get_rels(ctx).size();
+      }
+    }
+
+    for (std::unique_ptr<MergeableSection<E>> &m : file->mergeable_sections)
+      if (m)
+        stats.fragments += m->fragments.size();
+  });
+
+  std::ofstream out;
+  out.open(ctx.arg.input_stats);
+  if (out.fail())
+    Fatal(ctx) << "--input-stats: cannot open " << ctx.arg.input_stats
+               << ": " << errno_string();
+
+  auto to_msec = [](i64 nsec) { return (double)nsec / 1'000'000; };
+  out << std::fixed << std::setprecision(3);
+
+  if (ctx.arg.input_stats.ends_with(".json")) {
+    out << "[\n";
+    for (i64 i = 0; i < vec.size(); i++) {
+      ObjectFile<E> *file = ctx.objs[i];
+      InputStats &stats = vec[i];
+      out << "  {\"file\":\"" << json_escape(stats.name) << "\""
+          << ",\"bytes\":" << stats.bytes
+          << ",\"sections\":" << stats.sections
+          << ",\"relocs\":" << stats.relocs
+          << ",\"fragments\":" << stats.fragments
+          << ",\"parse_ms\":" << to_msec(file->parse_nsec)
+          << ",\"apply_ms\":" << to_msec(file->apply_nsec)
+          << ",\"gc_removed\":" << file->num_gc_removed
+          << ",\"icf_removed\":" << file->num_icf_removed << "}"
+          << (i + 1 < vec.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return;
+  }
+
+  // In CSV, a double quote in a quoted field is escaped by doubling it.
+  auto quote = [](std::string_view str) {
+    std::string buf = "\"";
+    for (char c : str) {
+      if (c == '"')
+        buf += '"';
+      buf += c;
+    }
+    return buf + "\"";
+  };
+
+  out << "file,bytes,sections,relocs,fragments,parse_ms,apply_ms,"
+      << "gc_removed,icf_removed\n";
+
+  for (i64 i = 0; i < vec.size(); i++) {
+    ObjectFile<E> *file = ctx.objs[i];
+    InputStats &stats = vec[i];
+    out << quote(stats.name) << "," << stats.bytes << "," << stats.sections
+        << "," << stats.relocs << "," << stats.fragments << ","
+        << to_msec(file->parse_nsec) << "," << to_msec(file->apply_nsec) << ","
+        << file->num_gc_removed << "," << file->num_icf_removed << "\n";
+  }
+}
+
 using E = MOLD_TARGET;
 
 template int redo_main(Context<E> &, int, char **);
+template void
+for_each_obj_largest_first(Context<E> &, std::function<void(ObjectFile<E> *)>);
 template void create_internal_file(Context<E> &);
 template void apply_exclude_libs(Context<E> &);
+template void intern_dso_symbols(Context<E> &);
 template void create_synthetic_sections(Context<E> &);
 template void resolve_symbols(Context<E> &);
 template void do_lto(Context<E> &);
@@ -3237,17 +4954,20 @@ template void check_cet_errors(Context<E> &);
 template void apply_section_align(Context<E> &);
 template void print_dependencies(Context<E> &);
 template void write_repro_file(Context<E> &);
-template void check_duplicate_symbols(Context<E> &);
-template void check_shlib_undefined(Context<E> &);
-template void check_symbol_types(Context<E> &);
+template void wait_repro_file(Context<E> &);
+template void check_symbols(Context<E> &);
 template void sort_init_fini(Context<E> &);
 template void sort_ctor_dtor(Context<E> &);
 template void fixup_ctors_in_init_array(Context<E> &);
 template void shuffle_sections(Context<E> &);
+template void sort_sections_by_symbol_order(Context<E> &);
+template void partition_hot_cold_text(Context<E> &);
+template void prune_debug_aranges(Context<E> &);
 template void compute_section_sizes(Context<E> &);
 template void sort_output_sections(Context<E> &);
 template void claim_unresolved_symbols(Context<E> &);
 template void compute_imported_symbol_weakness(Context<E> &);
+template void group_relocated_data(Context<E> &);
 template void scan_relocations(Context<E> &);
 template void report_undef_errors(Context<E> &);
 template void create_reloc_sections(Context<E> &);
@@ -3257,17 +4977,28 @@ template void sort_dynsyms(Context<E> &);
 template void create_output_symtab(Context<E> &);
 template void apply_version_script(Context<E> &);
 template void parse_symbol_version(Context<E> &);
+template void read_interposed_symbols(Context<E> &);
 template void compute_import_export(Context<E> &);
-template void compute_address_significance(Context<E> &);
+template void build_section_refs(Context<E> &);
+template void release_section_refs(Context<E> &);
 template void separate_debug_sections(Context<E> &);
 template void compute_section_headers(Context<E> &);
 template i64 set_osec_offsets(Context<E> &);
 template void fix_synthetic_symbols(Context<E> &);
 template void compress_debug_sections(Context<E> &);
+template void hash_input_file(Context<E> &, InputFile<E> *);
+template void compute_input_build_id(Context<E> &);
+template void start_build_id(Context<E> &);
 template void write_build_id(Context<E> &);
+template void open_delta_base(Context<E> &);
+template void write_delta(Context<E> &);
 template void write_gnu_debuglink(Context<E> &);
+template void start_separate_debug_file(Context<E> &);
 template void write_separate_debug_file(Context<E> &);
 template void write_dependency_file(Context<E> &);
+template void sample_memory_usage(Context<E> &, std::string_view);
 template void show_stats(Context<E> &);
+template void write_perf_trace(Context<E> &);
+template void write_input_stats(Context<E> &);
 
 } // namespace mold
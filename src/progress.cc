@@ -0,0 +1,215 @@
+// --progress-fd=N makes mold report its progress to file descriptor N
+// as JSON lines, so that a build system can tell a long-running link
+// from a hung one. Every line is a JSON object with an "event" key,
+// which is one of the following:
+//
+//   "begin"     a top-level phase of the linker has started
+//   "end"       the phase has finished
+//   "heartbeat" written every second while a phase is running
+//   "done"      the link has finished
+//
+// Each line also contains the phase name, the elapsed time since the
+// start of the link, and counters that tell how much work has been
+// done so far, e.g.
+//
+//   {"event":"heartbeat","phase":"lto","elapsed_ms":61234,"files":1520,
+//    "symbols":0,"lto_objects":12,"bytes_written":0,"eta_ms":2345678}
+//
+// "eta_ms" is an estimate of the remaining time. It is computed from
+// how long each phase took the last time we created the same output
+// file, so it's present only if we have done the same link before on
+// this machine. The phase durations are saved to a small file under
+// $XDG_CACHE_HOME/mold/progress (or ~/.cache/mold/progress).
+//
+// All writes are done by a background thread, so that a slow reader
+// never blocks the linker and a closed pipe doesn't kill mold with
+// SIGPIPE.
+
+#include "mold.h"
+
+#include <filesystem>
+#include <fstream>
+
+#ifndef _WIN32
+# include <signal.h>
+#endif
+
+namespace mold {
+
+static std::string get_history_dir() {
+  if (const char *dir = getenv("XDG_CACHE_HOME"); dir && *dir)
+    return std::string(dir) + "/mold/progress";
+  if (const char *home = getenv("HOME"); home && *home)
+    return std::string(home) + "/.cache/mold/progress";
+  return "";
+}
+
+template <typename E>
+ProgressReporter<E>::ProgressReporter(Context<E> &ctx, int fd)
+  : fd(fd), start_time(now_nsec()) {
+  // Read the phase durations of the previous link of the same output.
+  if (std::string dir = get_history_dir(); !dir.empty()) {
+    std::error_code ec;
+    std::string output =
+      std::filesystem::absolute(ctx.arg.output.c_str(), ec).string();
+
+    u64 hash = hash_string(output + "\0"s + std::string(E::name));
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    history_path = dir + "/" + buf;
+
+    std::ifstream in(history_path);
+    std::string name;
+    i64 msec;
+    while (in >> name >> msec)
+      history.push_back({name, msec});
+  }
+
+  thread = std::thread([this] { run(); });
+}
+
+template <typename E>
+ProgressReporter<E>::~ProgressReporter() {
+  if (thread.joinable()) {
+    {
+      std::scoped_lock lock(mu);
+      done = true;
+    }
+    cv.notify_one();
+    thread.join();
+  }
+}
+
+// Returns the JSON fields common to all lines. `mu` must be held.
+template <typename E>
+std::string ProgressReporter<E>::get_status() {
+  i64 now = now_nsec();
+  i64 elapsed = (now - start_time) / 1'000'000;
+
+  std::string s = "\"phase\":\"" + phase + "\"" +
+                  ",\"elapsed_ms\":" + std::to_string(elapsed) +
+                  ",\"files\":" + std::to_string(num_files) +
+                  ",\"symbols\":" + std::to_string(num_symbols) +
+                  ",\"lto_objects\":" + std::to_string(num_lto_objects) +
+                  ",\"bytes_written\":" + std::to_string(bytes_written);
+
+  // The remaining time is the expected time of the current phase minus
+  // the time we've already spent in it, plus the expected times of the
+  // phases that we haven't started yet.
+  if (history.empty())
+    return s;
+
+  i64 eta = 0;
+  for (std::pair<std::string, i64> &hist : history) {
+    auto it = std::find_if(phases.begin(), phases.end(),
+                           [&](std::pair<std::string, i64> &p) {
+      return p.first == hist.first;
+    });
+
+    if (it == phases.end())
+      eta += hist.second;
+    else if (it + 1 == phases.end() && !phase.empty())
+      eta += std::max<i64>(0, hist.second - (now - phase_start) / 1'000'000);
+  }
+  return s + ",\"eta_ms\":" + std::to_string(eta);
+}
+
+template <typename E>
+void ProgressReporter<E>::begin_phase(std::string_view name) {
+  {
+    std::scoped_lock lock(mu);
+    end_phase();
+    phase = name;
+    phase_start = now_nsec();
+    phases.push_back({phase, 0});
+    queue.push_back("{\"event\":\"begin\"," + get_status() + "}\n");
+  }
+  cv.notify_one();
+}
+
+// Closes the current phase if any. `mu` must be held.
+template <typename E>
+void ProgressReporter<E>::end_phase() {
+  if (phases.empty() || phase.empty())
+    return;
+  phases.back().second = (now_nsec() - phase_start) / 1'000'000;
+  queue.push_back("{\"event\":\"end\"," + get_status() + "}\n");
+  phase = "";
+}
+
+// Reports the end of the link, saves phase durations for the next link
+// and waits for the background thread to write everything out.
+template <typename E>
+void ProgressReporter<E>::finish() {
+  {
+    std::scoped_lock lock(mu);
+    end_phase();
+    queue.push_back("{\"event\":\"done\"," + get_status() + "}\n");
+    done = true;
+  }
+  cv.notify_one();
+  thread.join();
+
+  if (history_path.empty())
+    return;
+
+  // Write to a temporary file first so that a concurrent link never
+  // sees a partially-written file.
+  std::error_code ec;
+  std::filesystem::path path = history_path;
+  std::filesystem::create_directories(path.parent_path(), ec);
+
+  std::string tmp = history_path + ".tmp" + std::to_string(start_time);
+  std::ofstream out(tmp);
+  for (std::pair<std::string, i64> &p : phases)
+    out << p.first << " " << p.second << "\n";
+  out.close();
+
+  if (!out || rename(tmp.c_str(), history_path.c_str()))
+    std::filesystem::remove(tmp, ec);
+}
+
+template <typename E>
+void ProgressReporter<E>::run() {
+#ifndef _WIN32
+  // If the reader has gone away, we want write(2) to fail with EPIPE
+  // instead of getting killed by SIGPIPE.
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+#endif
+
+  std::unique_lock lock(mu);
+
+  for (;;) {
+    bool ok = cv.wait_for(lock, std::chrono::seconds(1), [&] {
+      return done || !queue.empty();
+    });
+
+    if (!ok && !phase.empty())
+      queue.push_back("{\"event\":\"heartbeat\"," + get_status() + "}\n");
+
+    std::vector<std::string> lines = std::move(queue);
+    queue.clear();
+    lock.unlock();
+
+    for (std::string &line : lines) {
+#ifdef _WIN32
+      (void)!_write(fd, line.data(), line.size());
+#else
+      (void)!write(fd, line.data(), line.size());
+#endif
+    }
+
+    lock.lock();
+    if (done && queue.empty())
+      return;
+  }
+}
+
+using E = MOLD_TARGET;
+
+template class ProgressReporter<E>;
+
+} // namespace mold
@@ -160,9 +160,13 @@ void combine_objects(Context<E> &ctx) {
 
   sort_output_sections(ctx);
 
-  create_output_symtab(ctx);
-
-  ctx.eh_frame->construct(ctx);
+  // These two passes are independent of each other.
+  {
+    tbb::task_group tg;
+    tg.run([&] { create_output_symtab(ctx); });
+    tg.run([&] { ctx.eh_frame->construct(ctx); });
+    tg.wait();
+  }
 
   create_reloc_sections(ctx);
 
@@ -187,6 +191,9 @@ void combine_objects(Context<E> &ctx) {
   if (ctx.arg.perf)
     print_timer_records(ctx.timer_records);
 
+  if (!ctx.arg.perf_trace.empty())
+    write_perf_trace(ctx);
+
   if (ctx.arg.quick_exit)
     _exit(0);
 }
@@ -54,6 +54,20 @@
 // as the compiler always emits the longest instruction sequence. This
 // makes the linker implementation a bit simpler because we don't need to
 // worry about oscillation.
+//
+// If `--iterative-relax` is given, we repeat the scan until no section
+// shrinks any further. In each pass, distances are computed using the
+// addresses assigned in the previous pass, which `prev_r_deltas` allows
+// us to reconstruct without mutating symbol values. A relocation that has
+// been relaxed in a pass stays relaxed in the following passes, so the
+// number of removed bytes usually only grows and the process converges.
+//
+// The exception is a relaxed instruction that no longer reaches its
+// target because alignment padding between them has grown. Such a
+// relocation is relaxed less in the next pass and can never be relaxed
+// more again, so each relocation changes direction at most once. Since
+// we stop only when a pass changes nothing, every relaxation is valid in
+// the final layout.
 
 #if MOLD_RV64LE || MOLD_RV64BE || MOLD_RV32LE || MOLD_RV32BE || \
     MOLD_LOONGARCH64 || MOLD_LOONGARCH32
@@ -71,6 +85,20 @@ static bool is_resizable(InputSection<E> *isec) {
          (isec->shdr().sh_flags & SHF_EXECINSTR);
 }
 
+// Returns the number of bytes removed before a given section offset.
+static i64 get_delta(Context<E> &ctx, InputSection<E> &isec,
+                     std::span<i32> deltas, u64 offset) {
+  if (deltas.empty())
+    return 0;
+
+  std::span<const ElfRel<E>> rels = isec.get_rels(ctx);
+  auto it = std::lower_bound(rels.begin(), rels.end(), offset,
+                             [&](const ElfRel<E> &r, u64 val) {
+    return r.r_offset < val;
+  });
+  return deltas[it - rels.begin()];
+}
+
 template <>
 void shrink_sections<E>(Context<E> &ctx) {
   Timer t(ctx, "shrink_sections");
@@ -81,6 +109,13 @@ void shrink_sections<E>(Context<E> &ctx) {
   if constexpr (is_riscv<E>)
     use_rvc = get_eflags(ctx) & EF_RISCV_RVC;
 
+  auto recompute_section_sizes = [&] {
+    tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
+      if (chunk->to_osec() && (chunk->shdr.sh_flags & SHF_EXECINSTR))
+        chunk->compute_section_size(ctx);
+    });
+  };
+
   // Find all relaxable relocations and record how many bytes we can save
   // into r_deltas.
   //
@@ -89,39 +124,82 @@ void shrink_sections<E>(Context<E> &ctx) {
   // its target may decrease as a result of relaxation. That said, the
   // number of such relocations is negligible (I tried to self-host mold
   // on RISC-V as an experiment and found that the mold-built .text is
-  // only ~0.04% larger than that of GNU ld), so we don't bother to handle
-  // them. We scan relocations only once here.
+  // only ~0.04% larger than that of GNU ld), so by default we scan
+  // relocations only once here.
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
     for (std::unique_ptr<InputSection<E>> &isec : file->sections)
       if (is_resizable(isec.get()))
         shrink_section(ctx, *isec, use_rvc);
   });
 
+  // If requested, repeat the scan until we reach a fixed point. We
+  // re-assign addresses so that the next pass sees distances in the
+  // shrunk layout. We cap the number of passes just in case.
+  //
+  // The result of the last pass is valid only if it was computed in the
+  // layout it produces, i.e. if the last pass didn't change anything. If
+  // we hit the cap, we run one more pass to verify the final layout and
+  // give up if it still changes.
+  if (ctx.arg.iterative_relax && ctx.arg.relax) {
+    constexpr i64 MAX_PASSES = 10;
+
+    // Returns true if any section shrank further.
+    auto run_pass = [&] {
+      recompute_section_sizes();
+      set_osec_offsets(ctx);
+
+      tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+        for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+          if (is_resizable(isec.get())) {
+            isec->sh_size += isec->extra.r_deltas.back();
+            std::swap(isec->extra.r_deltas, isec->extra.prev_r_deltas);
+          }
+        }
+      });
+
+      std::atomic_bool updated = false;
+
+      tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+        for (std::unique_ptr<InputSection<E>> &isec : file->sections) {
+          if (is_resizable(isec.get())) {
+            shrink_section(ctx, *isec, use_rvc);
+            if (isec->extra.r_deltas != isec->extra.prev_r_deltas)
+              updated = true;
+          }
+        }
+      });
+      return (bool)updated;
+    };
+
+    bool changed = true;
+    for (i64 pass = 1; pass < MAX_PASSES && changed; pass++)
+      changed = run_pass();
+
+    if (changed && run_pass())
+      Fatal(ctx) << "--iterative-relax: relaxation did not converge";
+
+    tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
+      for (std::unique_ptr<InputSection<E>> &isec : file->sections)
+        if (is_resizable(isec.get())) {
+          isec->extra.prev_r_deltas = {};
+          isec->extra.relax_caps = {};
+        }
+    });
+  }
+
   // Fix symbol values.
   tbb::parallel_for_each(ctx.objs, [&](ObjectFile<E> *file) {
     for (Symbol<E> *sym : file->symbols) {
       if (sym->file != file)
         continue;
 
-      InputSection<E> *isec = sym->get_input_section();
-      if (!isec || isec->extra.r_deltas.empty())
-        continue;
-
-      std::span<const ElfRel<E>> rels = isec->get_rels(ctx);
-      auto it = std::lower_bound(rels.begin(), rels.end(), sym->value,
-                                 [&](const ElfRel<E> &r, u64 val) {
-        return r.r_offset < val;
-      });
-
-      sym->value -= isec->extra.r_deltas[it - rels.begin()];
+      if (InputSection<E> *isec = sym->get_input_section())
+        sym->value -= get_delta(ctx, *isec, isec->extra.r_deltas, sym->value);
     }
   });
 
   // Recompute sizes of executable sections
-  tbb::parallel_for_each(ctx.chunks, [&](Chunk<E> *chunk) {
-    if (chunk->to_osec() && (chunk->shdr.sh_flags & SHF_EXECINSTR))
-      chunk->compute_section_size(ctx);
-  });
+  recompute_section_sizes();
 }
 
 // Returns the distance between a relocated place and a symbol.
@@ -143,6 +221,19 @@ i64 compute_distance<E>(Context<E> &ctx, Symbol<E> &sym,
   i64 S = sym.get_addr(ctx);
   i64 A = rel.r_addend;
   i64 P = isec.get_addr() + rel.r_offset;
+
+  // In the second or later pass of iterative relaxation, sections have
+  // already been shrunk but neither relocation offsets nor symbol values
+  // have been adjusted yet. Compute the addresses in the layout that the
+  // previous pass produced.
+  if (!isec.extra.prev_r_deltas.empty()) {
+    P -= isec.extra.prev_r_deltas[&rel - isec.get_rels(ctx).data()];
+
+    if (InputSection<E> *target = sym.get_input_section();
+        target && S == target->get_addr() + sym.value)
+      S -= get_delta(ctx, *target, target->extra.prev_r_deltas, sym.value);
+  }
+
   return S + A - P;
 }
 
@@ -245,9 +245,14 @@ void OutputSection<E>::create_range_extension_thunks(Context<E> &ctx) {
     thunks.emplace_back(thunk);
 
     // Scan relocations between B and C to collect symbols that need
-    // entries in the new thunk.
-    for (i64 i = b; i < c; i++)
+    // entries in the new thunk. A batch may contain thousands of input
+    // sections in a large executable, so we do this in parallel.
+    // scan_rels() only reads thunk indices assigned by previous
+    // iterations, and the symbols are sorted below, so the result is
+    // deterministic.
+    tbb::parallel_for(b, c, [&](i64 i) {
       scan_rels(ctx, *m[i], *thunk, thunk_idx);
+    });
 
     // Now that we know the number of symbols in the thunk, we can compute
     // the thunk's size.
@@ -267,7 +272,7 @@ void OutputSection<E>::create_range_extension_thunks(Context<E> &ctx) {
     }
 
     // Scan relocations again to fix symbol offsets in the last thunk.
-    for (i64 i = b; i < c; i++) {
+    tbb::parallel_for(b, c, [&](i64 i) {
       std::span<Symbol<E> *> syms = m[i]->file.symbols;
       std::span<const ElfRel<E>> rels = m[i]->get_rels(ctx);
       std::span<ThunkRef> thunk_refs = m[i]->extra.thunk_refs;
@@ -275,7 +280,7 @@ void OutputSection<E>::create_range_extension_thunks(Context<E> &ctx) {
       for (i64 j = 0; j < rels.size(); j++)
         if (thunk_refs[j].thunk_idx == thunk_idx)
           thunk_refs[j].sym_idx = syms[rels[j].r_sym]->extra.thunk_sym_idx;
-    }
+    });
 
     // Move B forward to point to the begining of the next batch.
     b = c;
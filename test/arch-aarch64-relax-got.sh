@@ -0,0 +1,50 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.globl get_foo, get_bar, foo, bar
+.hidden foo, bar
+
+.section .text.get_foo,"ax",@progbits
+get_foo:
+  adrp x0, :got:foo
+  ldr x0, [x0, :got_lo12:foo]
+  ret
+
+.section .text.get_bar,"ax",@progbits
+get_bar:
+  adrp x0, :got:bar
+  ldr x0, [x0, :got_lo12:bar]
+  ret
+
+.data
+foo:
+  .word 3
+
+.section .far,"aw",@progbits
+bar:
+  .word 5
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -xc -
+#include <stdio.h>
+int *get_foo();
+int *get_bar();
+int main() { printf("%d %d\n", *get_foo(), *get_bar()); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o $t/b.o -pie -Wl,--section-start=.far=0x40000000
+$QEMU $t/exe | grep -q '^3 5$'
+
+# A nearby symbol is materialized by ADR, and a far one by ADRP+ADD.
+$OBJDUMP -d $t/exe | grep -A3 '<get_foo>:' > $t/log1
+grep -Eq 'nop' $t/log1
+grep -Eq 'adr\s+x0' $t/log1
+
+$OBJDUMP -d $t/exe | grep -A3 '<get_bar>:' > $t/log2
+grep -Eq 'adrp\s+x0' $t/log2
+grep -Eq 'add\s+x0, x0' $t/log2
+
+$CC -B. -o $t/exe $t/a.o $t/b.o -pie -Wl,--no-relax
+$QEMU $t/exe | grep -q '^3 5$'
+$OBJDUMP -d $t/exe | grep -A3 '<get_foo>:' | grep -Eq 'ldr\s+x0'
@@ -0,0 +1,34 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.globl get_foo
+get_foo:
+  addis 3, 2, .LC0@toc@ha
+  ld 3, .LC0@toc@l(3)
+  blr
+
+.section .toc,"aw"
+.LC0:
+  .quad foo
+
+.data
+foo:
+  .word 3
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -xc -
+#include <stdio.h>
+int *get_foo();
+int main() { printf("%d\n", *get_foo()); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o
+$QEMU $t/exe1 | grep -q '^3$'
+$OBJDUMP -d $t/exe1 | grep -A2 '<get_foo>:' > $t/log1
+grep -Eq 'addi\s' $t/log1
+! grep -Eq 'ld\s' $t/log1 || false
+
+$CC -B. -o $t/exe2 $t/a.o $t/b.o -Wl,--no-relax
+$QEMU $t/exe2 | grep -q '^3$'
+$OBJDUMP -d $t/exe2 | grep -A2 '<get_foo>:' | grep -Eq 'ld\s'
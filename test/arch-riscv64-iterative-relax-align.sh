@@ -0,0 +1,37 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# `call far` comes within reach of JAL in the second pass. However,
+# `call bar` before it is relaxed in the same pass, and the alignment
+# padding that follows grows to absorb the removed bytes, so `far` ends
+# up exactly 1 MiB away. The relaxation of `call far` must be undone
+# rather than writing a JAL with a truncated displacement.
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.option norvc
+.globl bar, baz, far, call1, call2
+.hidden bar, baz, far, call1, call2
+bar:
+  ret
+  .rept 32
+  call bar
+  .endr
+  .space 0x100000 - 244
+call1:
+  call bar
+call2:
+  call far
+  .balign 16
+baz:
+  ret
+  .rept 32
+  call baz
+  .endr
+  .space 0x100000 - 144
+far:
+  ret
+EOF
+
+$CC -B. -o $t/b.so -shared -nostdlib $t/a.o -Wl,--iterative-relax
+$OBJDUMP -d $t/b.so > $t/log
+grep -A1 '<call1>:' $t/log | grep -Eq 'jal\s'
+grep -A1 '<call2>:' $t/log | grep -Eq 'auipc\s'
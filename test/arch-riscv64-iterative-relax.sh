@@ -0,0 +1,23 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# The first call is 8 bytes too far for JAL before relaxation, but it
+# comes within reach once the 32 calls that follow it are shrunk.
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.globl foo
+.hidden foo
+foo:
+  call far
+  .rept 32
+  call foo
+  .endr
+  .space 0x100000 - 0x100
+far:
+  ret
+EOF
+
+$CC -B. -o $t/b.so -shared -nostdlib $t/a.o
+$OBJDUMP -d $t/b.so | grep -A1 '<foo>:' | grep -Eq 'auipc\s'
+
+$CC -B. -o $t/c.so -shared -nostdlib $t/a.o -Wl,--iterative-relax
+$OBJDUMP -d $t/c.so | grep -A1 '<foo>:' | grep -Eq 'jal\s'
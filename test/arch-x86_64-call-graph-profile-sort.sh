@@ -0,0 +1,39 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -xassembler -
+.section .text.fn1,"ax",@progbits
+.globl fn1
+fn1:
+  ret
+.section .text.fn2,"ax",@progbits
+.globl fn2
+fn2:
+  ret
+.section .text.fn3,"ax",@progbits
+.globl fn3
+fn3:
+  ret
+.section .llvm.call-graph-profile,"e",@0x6fff4c09
+.reloc 0, R_X86_64_NONE, fn3
+.reloc 4, R_X86_64_NONE, fn1
+.quad 1000
+EOF
+
+get_addr() {
+  nm $t/exe | grep " $1$" | cut -d' ' -f1
+}
+
+$CC -B. -o $t/exe $t/a.o $t/b.o
+$QEMU $t/exe | grep -q 'Hello world'
+[[ $(get_addr fn3) < $(get_addr fn1) ]]
+[[ $(get_addr fn1) < $(get_addr fn2) ]]
+
+$CC -B. -o $t/exe $t/a.o $t/b.o -Wl,--no-call-graph-profile-sort
+[[ $(get_addr fn1) < $(get_addr fn2) ]]
+[[ $(get_addr fn2) < $(get_addr fn3) ]]
@@ -0,0 +1,63 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+test_cflags -gdwarf-5 -g || skip
+
+cat <<EOF | $CC -S -o $t/a.s -xc - -gdwarf-5 -g
+void fn2();
+void fn1() { fn2(); }
+EOF
+
+cat <<EOF >> $t/a.s
+.section .debug_str,"MS",@progbits,1
+.Lname: .string "fn1"
+
+.section .debug_names,"",@progbits
+  .long .Lend - .Lstart
+.Lstart:
+  .value 5                      # version
+  .value 0                      # padding
+  .long 1                       # compunit count
+  .long 0                       # local type unit count
+  .long 0                       # foreign type unit count
+  .long 1                       # bucket count
+  .long 1                       # name count
+  .long .Labbrev_end - .Labbrev # abbrev table size
+  .long 4                       # augmentation string size
+  .ascii "TEST"
+  .long .Ldebug_info0           # compunit list
+  .long 1                       # buckets
+  .long 0x0b886e0f              # hashes
+  .long .Lname                  # string offsets
+  .long 0                       # entry offsets
+.Labbrev:
+  .uleb128 1                    # abbrev code
+  .uleb128 0x2e                 # DW_TAG_subprogram
+  .uleb128 3                    # DW_IDX_die_offset
+  .uleb128 0x13                 # DW_FORM_ref4
+  .uleb128 0
+  .uleb128 0
+  .byte 0
+.Labbrev_end:
+  .uleb128 1
+  .long 0x2a
+  .byte 0
+.Lend:
+EOF
+
+$CC -c -o $t/a.o $t/a.s
+
+cat <<EOF | $CC -c -o $t/b.o -xc - -g -ggnu-pubnames
+#include <stdio.h>
+void fn2() {}
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o $t/b.o -Wl,--debug-names
+$QEMU $t/exe | grep -q 'Hello world'
+
+readelf --debug-dump=gdb_index $t/exe > $t/log
+grep -Eq 'fn1: <[0-9]+> DW_TAG_subprogram DW_IDX_compile_unit=<?0>? DW_IDX_die_offset=<0x2a>' $t/log
+grep -Eq 'fn2: .*DW_TAG_subprogram DW_IDX_compile_unit=<?1>?' $t/log
+grep -Fq 'Augmentation string: ' $t/log
+! grep -Fq TEST $t/log || false
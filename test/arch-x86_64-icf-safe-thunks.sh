@@ -0,0 +1,44 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -ffunction-sections -fdata-sections -O2 -xc -
+int bar(int x) {
+  return x * 5;
+}
+
+int foo1(int x) {
+  return bar(x) + bar(x + 1) + x * 3;
+}
+
+int foo2(int x) {
+  return bar(x) + bar(x + 1) + x * 3;
+}
+
+int foo3(int x) {
+  return bar(x) + bar(x + 1) + x * 3;
+}
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -ffunction-sections -fdata-sections -xc -
+#include <stdio.h>
+
+int foo1(int);
+int foo2(int);
+int foo3(int);
+
+int main() {
+  int (*volatile fn2)(int) = foo2;
+  int (*volatile fn3)(int) = foo3;
+  printf("%d %d %d %d %d\n", foo1 == foo2, foo2 == foo3,
+         foo1(1), fn2(2), fn3(3));
+}
+EOF
+
+$CC -B. -o $t/exe1 -Wl,-icf=safe-thunks,-print-icf-sections \
+  $t/a.o $t/b.o > $t/log1
+$QEMU $t/exe1 | grep -q '^0 0 18 31 44$'
+grep -q 'with a thunk' $t/log1
+
+# A thunk's symbol is as large as the thunk
+readelf -sW $t/exe1 > $t/log2
+grep -Eq ' (5|9) FUNC .* foo[123]$' $t/log2
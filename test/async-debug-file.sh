@@ -0,0 +1,22 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF > $t/a.c
+#include <stdio.h>
+int main() {
+  printf("Hello world\n");
+}
+EOF
+
+$CC -c -o $t/a.o $t/a.c -g
+mkdir -p $t/x $t/y
+
+$CC -B. -o $t/x/exe $t/a.o -Wl,--separate-debug-file,--no-detach
+$CC -B. -o $t/y/exe $t/a.o -Wl,--separate-debug-file,--no-detach \
+  -Wl,--async-debug-file
+
+$QEMU $t/y/exe | grep -q 'Hello world'
+readelf -SW $t/y/exe.dbg | grep -Fq .debug_info
+
+cmp $t/x/exe $t/y/exe
+cmp $t/x/exe.dbg $t/y/exe.dbg
@@ -0,0 +1,35 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -fPIC -xc -
+int bar() { return 1; }
+int baz() { return 2; }
+int foo() { return bar() * 10 + baz(); }
+EOF
+
+$CC -B. -shared -o $t/b.so $t/a.o
+
+cat <<EOF | $CC -c -o $t/c.o -xc -
+#include <stdio.h>
+int foo();
+int bar() { return 3; }
+int main() { printf("%d\n", foo()); }
+EOF
+
+$CC -B. -o $t/exe $t/c.o $t/b.so
+$QEMU $t/exe | grep -q '^32$'
+
+# `bar` is interposed by the executable, but `baz` is not.
+$CC -B. -shared -o $t/b.so $t/a.o -Wl,--Bsymbolic-auto=$t/exe
+$QEMU $t/exe | grep -q '^32$'
+
+readelf -rW $t/b.so > $t/log
+grep -Fqw bar $t/log
+! grep -Fqw baz $t/log || false
+
+# A file of a different ELF class is rejected before it's parsed.
+cp $t/exe $t/exe2
+printf '\003' | dd of=$t/exe2 bs=1 seek=4 conv=notrunc 2> /dev/null
+! $CC -B. -shared -o $t/b.so $t/a.o -Wl,--Bsymbolic-auto=$t/exe2 \
+  2> $t/log || false
+grep -q 'incompatible file type' $t/log
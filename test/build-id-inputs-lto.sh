@@ -0,0 +1,28 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+echo 'int main() {}' | $GCC -B. -flto -o /dev/null -xc - >& /dev/null \
+  || skip
+
+cat <<EOF | $GCC -flto -O2 -c -o $t/a.o -xc -
+int main() { return 1; }
+EOF
+
+cat <<EOF | $GCC -flto -O2 -c -o $t/b.o -xc -
+int main() { return 2; }
+EOF
+
+# The LTO plugin writes its output to temporary files with random names,
+# which must not affect the build ID.
+$GCC -B. -flto -o $t/exe $t/a.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep 'Build ID' > $t/log1
+
+$GCC -B. -flto -o $t/exe $t/a.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep 'Build ID' > $t/log2
+diff -q $t/log1 $t/log2
+
+# The object files the plugin compiled are hashed as inputs.
+cp $t/b.o $t/a.o
+$GCC -B. -flto -o $t/exe $t/a.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep 'Build ID' > $t/log3
+! diff -q $t/log1 $t/log3 > /dev/null || false
@@ -0,0 +1,22 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+int main() { return 0; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+int main() { return 1; }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep -q 'GNU.*0x00000014.*NT_GNU_BUILD_ID'
+readelf -n $t/exe | grep 'Build ID' > $t/log1
+
+$CC -B. -o $t/exe $t/a.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep 'Build ID' > $t/log2
+diff -q $t/log1 $t/log2
+
+$CC -B. -o $t/exe $t/b.o -Wl,-build-id=inputs
+readelf -n $t/exe | grep 'Build ID' > $t/log3
+! diff -q $t/log1 $t/log3 || false
@@ -0,0 +1,30 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# arm-linux-gnueabihf-objcopy crashes on x86-64
+[ $MACHINE = arm ] && skip
+[ $MACHINE = riscv32 ] && skip
+
+command -v zstdcat >& /dev/null || skip
+
+cat <<EOF | $CC -c -g -o $t/a.o -xc -
+#include <stdio.h>
+
+int main() {
+  printf("Hello world\n");
+  return 0;
+}
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o -Wl,--compress-debug-sections=zstd:19
+$QEMU $t/exe1 | grep -q 'Hello world'
+$OBJCOPY --dump-section .debug_info=$t/debug_info $t/exe1
+dd if=$t/debug_info of=$t/debug_info.zstd bs=24 skip=1 status=none
+zstdcat $t/debug_info.zstd > /dev/null
+
+$CC -B. -o $t/exe2 $t/a.o -Wl,--compress-debug-sections=zlib:9
+readelf -WS $t/exe2 | grep -Eq '\.debug_info .* C '
+
+! $CC -B. -o $t/exe3 $t/a.o -Wl,--compress-debug-sections=zlib:10 \
+  2> $t/log || false
+grep -q 'compression level must be between 1 and 9' $t/log
@@ -0,0 +1,23 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.globl _start
+_start:
+.section .profile_data,"",%progbits
+.rept 1000
+.ascii "abcdefgh"
+.endr
+EOF
+
+$CC -B. -nostdlib -o $t/exe1 $t/a.o -Wl,--compress-sections='.profile_*=zstd:19'
+readelf -WS $t/exe1 | grep -Eq '\.profile_data .* C '
+
+$CC -B. -nostdlib -o $t/exe2 $t/a.o -Wl,--compress-sections='.profile_*=zlib' \
+  -Wl,--compress-sections='.profile_data=none'
+! readelf -WS $t/exe2 | grep -Eq '\.profile_data .* C ' || false
+readelf -p .profile_data $t/exe2 | grep -q abcdefgh
+
+$CC -B. -nostdlib -o $t/exe3 $t/a.o -Wl,--compress-sections='.profile_*=zlib:9'
+readelf -WS $t/exe3 | grep -Eq '\.profile_data .* C '
+readelf -zp .profile_data $t/exe3 | grep -q abcdefgh
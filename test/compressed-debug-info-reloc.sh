@@ -0,0 +1,41 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# arm-linux-gnueabihf-objcopy crashes on x86-64
+[ $MACHINE = arm ] && skip
+[ $MACHINE = riscv32 ] && skip
+
+# Compressed debug sections are decompressed in 64 KiB blocks, and
+# relocations are applied as we go. The relocated fields below are not
+# aligned, so some of them straddle block boundaries. The output must
+# be the same as if the input were not compressed.
+cat <<EOF | $CC -o $t/a.o -c -xassembler -
+.globl _start
+.text
+_start:
+  .space 16
+foo:
+  .space 16
+
+.section .debug_foo,"",@progbits
+  .byte 0, 0, 0
+  .rept 30000
+  .dc.a _start
+  .dc.a foo + 3
+  .endr
+EOF
+
+$OBJCOPY --compress-debug-sections=zlib $t/a.o $t/b.o
+readelf -S $t/b.o | grep -A1 '\.debug_foo' | grep -Eq ' C '
+
+$CC -B. -o $t/exe1 $t/a.o -nostdlib -static
+$CC -B. -o $t/exe2 $t/b.o -nostdlib -static
+
+$OBJCOPY --dump-section .debug_foo=$t/debug_foo1 $t/exe1
+$OBJCOPY --dump-section .debug_foo=$t/debug_foo2 $t/exe2
+cmp $t/debug_foo1 $t/debug_foo2
+
+$OBJCOPY --compress-debug-sections=zstd $t/a.o $t/c.o 2> /dev/null || exit 0
+$CC -B. -o $t/exe3 $t/c.o -nostdlib -static
+$OBJCOPY --dump-section .debug_foo=$t/debug_foo3 $t/exe3
+cmp $t/debug_foo1 $t/debug_foo3
@@ -0,0 +1,21 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+
+__attribute__((section(".rodata.blob")))
+const int blob[256 * 256] = { [0 ... 256 * 256 - 1] = 42 };
+
+int main() {
+  long sum = 0;
+  for (int i = 0; i < 256 * 256; i++)
+    sum += blob[i];
+  printf("%ld\n", sum);
+}
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o
+$CC -B. -o $t/exe2 $t/a.o -Wl,--copy-file-range
+$QEMU $t/exe2 | grep -q '^2752512$'
+cmp $t/exe1 $t/exe2
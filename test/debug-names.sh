@@ -0,0 +1,32 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+test_cflags -ggnu-pubnames || skip
+
+cat <<EOF > $t/a.c
+void fn2();
+static int var1;
+void fn1() { var1++; fn2(); }
+EOF
+
+cat <<EOF > $t/b.c
+#include <stdio.h>
+void fn1();
+void fn2() {}
+int main() { fn1(); printf("Hello world\n"); }
+EOF
+
+$CC -c -o $t/a.o $t/a.c -g -ggnu-pubnames
+$CC -c -o $t/b.o $t/b.c -g -ggnu-pubnames
+$CC -B. -o $t/exe $t/a.o $t/b.o -Wl,--debug-names
+$QEMU $t/exe | grep -q 'Hello world'
+
+readelf -WS $t/exe > $t/log
+grep -Fq .debug_names $t/log
+! grep -Fq .debug_gnu_pubnames $t/log || false
+
+readelf --debug-dump=gdb_index $t/exe > $t/log2
+grep -Eq 'fn1: .*DW_TAG_subprogram' $t/log2
+grep -Eq 'fn2: .*DW_TAG_subprogram' $t/log2
+grep -Eq 'main: .*DW_TAG_subprogram' $t/log2
+grep -Eq 'var1: .*DW_TAG_variable' $t/log2
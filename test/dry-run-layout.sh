@@ -0,0 +1,17 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+void hello() { printf("Hello world\n"); }
+int main() { hello(); }
+EOF
+
+rm -f $t/exe
+$CC -B. -o $t/exe $t/a.o -Wl,--dry-run-layout=$t/layout.json
+! [ -f $t/exe ] || false
+
+grep -Fq '{"sections":[' $t/layout.json
+grep -Eq '^  \{"name":".text","addr":[0-9]+,"size":[1-9][0-9]*,' $t/layout.json
+grep -Fq "{\"file\":\"$t/a.o\",\"section\":\".text.hello\",\"addr\":" $t/layout.json
+grep -Eq '"symbols":\[\{"name":"hello","addr":[1-9][0-9]*\}\]' $t/layout.json
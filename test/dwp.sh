@@ -0,0 +1,47 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+test_cflags -gsplit-dwarf -gdwarf-5 || skip
+
+cat <<EOF > $t/a.c
+struct Foo { int x; };
+int fn1(struct Foo *foo) { return foo->x; }
+EOF
+
+cat <<EOF > $t/b.c
+#include <stdio.h>
+struct Foo { int x; };
+int fn1(struct Foo *foo);
+int main() { struct Foo foo = {3}; printf("Hello world %d\n", fn1(&foo)); }
+EOF
+
+(cd $t && $CC -c -o a.o a.c -gsplit-dwarf -gdwarf-5)
+(cd $t && $CC -c -o b.o b.c -gsplit-dwarf -gdwarf-5)
+[ -f $t/a.dwo ] || skip
+
+$CC -B. -o $t/exe $t/a.o $t/b.o -Wl,--dwp=$t/exe.dwp
+$QEMU $t/exe | grep -q 'Hello world 3'
+
+readelf -WS $t/exe.dwp > $t/log
+grep -Fq .debug_info.dwo $t/log
+grep -Fq .debug_str.dwo $t/log
+grep -Fq .debug_cu_index $t/log
+
+readelf --debug-dump=cu_index $t/exe.dwp > $t/log2
+grep -Eq 'Number of used entries: +2' $t/log2
+
+readelf --debug-dump=info $t/exe.dwp > $t/log3
+grep -Eq 'DW_AT_name +: fn1$' $t/log3
+
+# Older readelf can't use a version 5 index, so it decodes the second
+# unit with the first unit's tables. Use llvm-dwarfdump instead.
+if ! grep -q 'Unsupported version' $t/log2; then
+  grep -Eq 'DW_AT_name +: (\(indexed string: 0x[0-9a-f]+\): )?main$' $t/log3
+elif command -v llvm-dwarfdump >& /dev/null; then
+  llvm-dwarfdump --debug-info $t/exe.dwp > $t/log5
+  grep -Fq 'DW_AT_name	("main")' $t/log5
+  llvm-dwarfdump --verify $t/exe.dwp > $t/log6
+fi
+
+readelf -p .debug_str.dwo $t/exe.dwp > $t/log4
+grep -Eq '\] +main$' $t/log4
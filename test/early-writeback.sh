@@ -0,0 +1,12 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o
+$CC -B. -o $t/exe2 $t/a.o -Wl,--early-writeback
+$QEMU $t/exe2 | grep -q 'Hello world'
+cmp $t/exe1 $t/exe2
@@ -0,0 +1,20 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+# If there's no previous output, the patch contains the entire file.
+rm -f $t/exe
+$CC -B. -o $t/exe $t/a.o -Wl,--emit-delta=$t/delta1
+$QEMU $t/exe | grep -q 'Hello world'
+
+[ "$(head -c 8 $t/delta1)" = MOLDDLT1 ]
+[ $(wc -c < $t/delta1) -eq $(( $(wc -c < $t/exe) + 40 )) ]
+
+# Relinking the same inputs yields an empty patch.
+$CC -B. -o $t/exe $t/a.o -Wl,--emit-delta=$t/delta2
+$QEMU $t/exe | grep -q 'Hello world'
+[ $(wc -c < $t/delta2) -eq 24 ]
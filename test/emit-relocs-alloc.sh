@@ -0,0 +1,28 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -fPIC -g -xc -
+#include <stdio.h>
+int main() {
+  puts("Hello world");
+}
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o -Wl,--emit-relocs
+readelf -WS $t/exe1 > $t/log1
+grep -Eq 'rela?\.debug_info' $t/log1
+
+$CC -B. -o $t/exe2 $t/a.o -Wl,--emit-relocs=alloc
+$QEMU $t/exe2 | grep -q 'Hello world'
+
+readelf -WS $t/exe2 > $t/log2
+grep -Eq 'rela?\.text' $t/log2
+! grep -Eq 'rela?\.debug_' $t/log2 || false
+
+# Both modes must emit the same relocations for .text. Symbol indices
+# differ because section symbols for debug sections are omitted.
+readelf -W --relocs $t/exe1 | sed -n "/'\.rela\{0,1\}\.text'/,/^$/p" |
+  grep -v '^Relocation' | awk '{ $2 = ""; print }' > $t/log3
+readelf -W --relocs $t/exe2 | sed -n "/'\.rela\{0,1\}\.text'/,/^$/p" |
+  grep -v '^Relocation' | awk '{ $2 = ""; print }' > $t/log4
+diff -q $t/log3 $t/log4
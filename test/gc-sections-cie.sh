@@ -0,0 +1,25 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -ffunction-sections -fexceptions -xc -
+void ext() {}
+void cleanup(int *p) {}
+
+void unused() {
+  int x __attribute__((cleanup(cleanup))) = 0;
+  ext();
+}
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+#include <stdio.h>
+int main() { printf("Hello\n"); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o
+readelf --debug-dump=frames $t/exe1 | grep -q 'Augmentation:.*"zPR'
+
+$CC -B. -o $t/exe2 $t/a.o $t/b.o -Wl,-gc-sections
+$QEMU $t/exe2 | grep -q Hello
+readelf --debug-dump=frames $t/exe2 > $t/log2
+! grep -q 'Augmentation:.*"zPR' $t/log2 || false
@@ -0,0 +1,34 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# mold creates .gdb_index from input sections unless input debug
+# sections are compressed. Both should give the same result.
+test_cflags -gz=zlib -ggnu-pubnames || skip
+
+cat <<EOF > $t/a.c
+void fn2();
+static int var1;
+void fn1() { var1++; fn2(); }
+EOF
+
+cat <<EOF > $t/b.c
+#include <stdio.h>
+void fn1();
+void fn2() {}
+int main() { fn1(); printf("Hello world\n"); }
+EOF
+
+$CC -c -o $t/a.o $t/a.c -g -ggnu-pubnames
+$CC -c -o $t/b.o $t/b.c -g -ggnu-pubnames
+$CC -c -o $t/c.o $t/a.c -g -ggnu-pubnames -gz=zlib
+$CC -c -o $t/d.o $t/b.c -g -ggnu-pubnames -gz=zlib
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o -Wl,--gdb-index
+$CC -B. -o $t/exe2 $t/c.o $t/d.o -Wl,--gdb-index
+$QEMU $t/exe1 | grep -q 'Hello world'
+
+readelf -WS $t/exe1 | grep -Fq .gdb_index
+readelf --debug-dump=gdb_index $t/exe1 > $t/log1
+readelf --debug-dump=gdb_index $t/exe2 > $t/log2
+grep -Fq fn1 $t/log1
+diff $t/log1 $t/log2
@@ -0,0 +1,29 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -fPIC -o $t/a.o -xc -
+int foo1() { return 1; }
+int foo2() { return 2; }
+int foo3() { return 3; }
+int foo4() { return 4; }
+int foo5() { return 5; }
+EOF
+
+$CC -B. -o $t/b.so $t/a.o -shared -Wl,-hash-style=gnu
+$CC -B. -o $t/c.so $t/a.o -shared -Wl,-hash-style=gnu,-gnu-hash-bloom-bits=512
+
+cat <<EOF | $CC -c -o $t/d.o -xc -
+#include <stdio.h>
+int foo1(); int foo2(); int foo3(); int foo4(); int foo5();
+int main() { printf("%d\n", foo1() + foo2() + foo3() + foo4() + foo5()); }
+EOF
+
+$CC -B. -o $t/exe $t/d.o $t/c.so -Wl,-rpath=$t
+$QEMU $t/exe | grep -q '^15$'
+
+readelf -WS $t/b.so | grep -F ' .gnu.hash' > $t/log1
+readelf -WS $t/c.so | grep -F ' .gnu.hash' > $t/log2
+! cmp -s $t/log1 $t/log2 || false
+
+! $CC -B. -o $t/e.so $t/a.o -shared -Wl,-gnu-hash-bloom-bits=0 2> $t/log3 || false
+grep -q 'expected a positive number' $t/log3
@@ -0,0 +1,27 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -fPIC -fdata-sections
+#include <stdio.h>
+int foo1 = 1;
+int *ptr1 = &foo1;
+int foo2 = 2;
+int *ptr2 = &foo2;
+int main() { printf("Hello world %d %d\n", *ptr1, *ptr2); }
+EOF
+
+get_addr() {
+  nm $t/exe | grep " $1$" | cut -d' ' -f1
+}
+
+$CC -B. -o $t/exe $t/a.o -pie -Wl,--group-relocated-data
+$QEMU $t/exe | grep -q 'Hello world 1 2'
+
+[[ $(get_addr ptr1) < $(get_addr foo1) ]]
+[[ $(get_addr ptr2) < $(get_addr foo1) ]]
+[[ $(get_addr ptr1) < $(get_addr foo2) ]]
+[[ $(get_addr ptr2) < $(get_addr foo2) ]]
+
+# .relr.dyn entries must still be sorted by address.
+$CC -B. -o $t/exe $t/a.o -pie -Wl,--group-relocated-data -Wl,-z,pack-relative-relocs
+readelf -WS $t/exe | grep -Fq .relr.dyn
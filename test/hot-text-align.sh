@@ -0,0 +1,33 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections -falign-functions=1
+#include <stdio.h>
+void fn1() {}
+void fn2() {}
+void fn3() {}
+int main() { printf("Hello world\n"); }
+EOF
+
+cat <<EOF > $t/hot
+fn1
+fn3
+EOF
+
+get_addr() {
+  nm $t/exe | grep " $1$" | cut -d' ' -f1
+}
+
+$CC -B. -o $t/exe $t/a.o -Wl,--hot-text-file=$t/hot -Wl,--hot-text-align=64
+$QEMU $t/exe | grep -q 'Hello world'
+
+[ $(( 0x$(get_addr fn1) % 64 )) = 0 ]
+[ $(( 0x$(get_addr fn3) % 64 )) = 0 ]
+
+! $CC -B. -o $t/exe $t/a.o -Wl,--hot-text-file=$t/hot \
+  -Wl,--hot-text-align=48 2> $t/log || false
+grep -Fq 'value must be a power of 2' $t/log
+
+! $CC -B. -o $t/exe $t/a.o -Wl,--hot-text-file=$t/hot \
+  -Wl,--hot-text-align=64 -Wl,--shuffle-sections 2> $t/log || false
+grep -Fq -- '--hot-text-align may not be used with --shuffle-sections' $t/log
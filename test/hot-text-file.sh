@@ -0,0 +1,36 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+__attribute__((section(".text.unlikely.fn1"))) void fn1() {}
+void fn2() {}
+void fn3() {}
+static void fn4() {}
+void fn5() { fn4(); }
+int main() { printf("Hello world\n"); }
+EOF
+
+cat <<EOF > $t/hot
+# symbol samples
+fn5 100
+fn4 20
+fn3 0
+EOF
+
+get_addr() {
+  nm $t/exe | grep " $1$" | cut -d' ' -f1
+}
+
+$CC -B. -o $t/exe $t/a.o -Wl,--hot-text-file=$t/hot
+$QEMU $t/exe | grep -q 'Hello world'
+
+[[ $(get_addr fn4) < $(get_addr fn2) ]]
+[[ $(get_addr fn5) < $(get_addr fn2) ]]
+[[ $(get_addr fn2) < $(get_addr fn3) ]]
+[[ $(get_addr fn3) < $(get_addr fn1) ]]
+[[ $(get_addr main) < $(get_addr fn1) ]]
+
+echo 'fn2 x' > $t/hot2
+! $CC -B. -o $t/exe $t/a.o -Wl,--hot-text-file=$t/hot2 2> $t/log || false
+grep -Fq 'invalid line: fn2 x' $t/log
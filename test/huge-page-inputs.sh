@@ -0,0 +1,35 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+int foo() { return 3; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+#include <stdio.h>
+int foo();
+int main() { printf("%d\n", foo()); }
+EOF
+
+rm -f $t/c.a
+ar rcsT $t/c.a $t/a.o
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o -Wl,--huge-page-inputs
+$QEMU $t/exe1 | grep -q '^3$'
+
+$CC -B. -o $t/exe2 $t/b.o $t/c.a -Wl,--huge-page-inputs
+$QEMU $t/exe2 | grep -q '^3$'
+
+# An input larger than a huge page is remapped at an aligned address.
+cat <<EOF | $CC -c -o $t/d.o -xc -
+char big[3 * 1024 * 1024] = {1, [3 * 1024 * 1024 - 1] = 2};
+EOF
+
+cat <<EOF | $CC -c -o $t/e.o -xc -
+#include <stdio.h>
+extern char big[];
+int main() { printf("%d\n", big[0] + big[3 * 1024 * 1024 - 1]); }
+EOF
+
+$CC -B. -o $t/exe3 $t/d.o $t/e.o -Wl,--huge-page-inputs
+$QEMU $t/exe3 | grep -q '^3$'
@@ -0,0 +1,37 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = ppc64 ] && skip
+
+cat <<EOF | $CC -c -o $t/a.o -ffunction-sections -fdata-sections -xc -
+#include <stdio.h>
+
+int bar() {
+  return 5;
+}
+
+int foo1(int x) {
+  return bar() + x;
+}
+
+int foo2(int x) {
+  return bar() + x;
+}
+
+int main() {
+  printf("%d\n", (long)foo1 == (long)foo2);
+  return 0;
+}
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o -Wl,-icf=all,--icf-max-rounds=100
+$QEMU $t/exe1 | grep -q '^1$'
+
+# foo1 and foo2 call other functions, so they can't be proven identical
+# without propagation rounds.
+$CC -B. -o $t/exe2 $t/a.o -Wl,-icf=all,--icf-max-rounds=0,--stats > $t/log
+$QEMU $t/exe2 | grep -q '^0$'
+grep -Eq 'icf_forgone_folds=[1-9]' $t/log
+
+$CC -B. -o $t/exe3 $t/a.o -Wl,-icf=all,--icf-time-budget=0
+$QEMU $t/exe3 | grep -q '^0$'
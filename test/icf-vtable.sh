@@ -0,0 +1,25 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CXX -c -o $t/a.o -ffunction-sections -fdata-sections -fno-rtti -xc++ -
+#include <stdio.h>
+
+struct Base {
+  virtual int get() { return 42; }
+};
+
+template <typename T>
+struct Derived : Base {
+  T x;
+};
+
+int main() {
+  Base *a = new Derived<int>;
+  Base *b = new Derived<long>;
+  printf("%d %d\n", a->get(), b->get());
+}
+EOF
+
+$CXX -B. -o $t/exe $t/a.o -Wl,-icf=safe,-print-icf-sections > $t/log
+$QEMU $t/exe | grep -q '^42 42$'
+grep -q '_ZTV7DerivedI' $t/log
@@ -0,0 +1,17 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+void unused() {}
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--gc-sections -Wl,--input-stats=$t/stats.csv
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -Fq 'file,bytes,sections,relocs,fragments,parse_ms,apply_ms,gc_removed,icf_removed' $t/stats.csv
+grep -Eq "^\"$t/a.o\",[1-9][0-9]*,[1-9][0-9]*,[1-9][0-9]*,[0-9]+,[0-9.]+,[0-9.]+,[1-9][0-9]*,0$" $t/stats.csv
+
+$CC -B. -o $t/exe $t/a.o -Wl,--input-stats=$t/stats.json
+grep -Fq "{\"file\":\"$t/a.o\",\"bytes\":" $t/stats.json
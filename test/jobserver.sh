@@ -0,0 +1,30 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+rm -f $t/fifo
+mkfifo $t/fifo
+exec 3<>$t/fifo
+printf '++' >&3
+
+MAKEFLAGS="-j3 --jobserver-auth=fifo:$t/fifo" $CC -B. -o $t/exe1 $t/a.o
+$QEMU $t/exe1 | grep -q 'Hello world'
+
+# mold must have returned all tokens it took.
+[ "$(timeout 10 head -c 2 <&3)" = '++' ]
+exec 3>&-
+
+MOLD_JOBS=2 $CC -B. -o $t/exe2 $t/a.o
+$QEMU $t/exe2 | grep -q 'Hello world'
+
+# File descriptors that are not pipes are not a jobserver.
+echo abc > $t/notpipe
+exec 4>>$t/notpipe
+MAKEFLAGS="-j3 --jobserver-auth=4,4" $CC -B. -o $t/exe3 $t/a.o -Wl,--threads=4
+exec 4>&-
+$QEMU $t/exe3 | grep -q 'Hello world'
+[ "$(cat $t/notpipe)" = abc ]
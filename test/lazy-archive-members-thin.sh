@@ -0,0 +1,26 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int fn1();
+int main() { printf("%d\n", fn1()); }
+EOF
+
+echo 'int fn2(); int fn1() { return fn2() + 1; }' | $CC -o $t/b.o -c -xc -
+echo 'int fn2() { return 41; }' | $CC -o $t/c.o -c -xc -
+echo 'int fn3() { return 3; }' | $CC -o $t/d.o -c -xc -
+
+rm -f $t/e.a
+ar crsT $t/e.a $t/b.o $t/c.o $t/d.o
+
+$CC -B. -o $t/exe1 $t/a.o $t/e.a -Wl,--lazy-archive-members
+$QEMU $t/exe1 | grep -q '^42$'
+readelf --symbols $t/exe1 > $t/log1
+grep -q fn2 $t/log1
+! grep -q fn3 $t/log1 || false
+
+# Unneeded members of a thin archive are never opened.
+rm $t/d.o
+$CC -B. -o $t/exe2 $t/a.o $t/e.a -Wl,--lazy-archive-members
+$QEMU $t/exe2 | grep -q '^42$'
@@ -0,0 +1,33 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = ppc64 ] && skip
+[ $MACHINE = ppc64le ] && skip
+[[ $MACHINE = loongarch* ]] && skip
+
+cat <<EOF | $CC -fPIC -shared -o $t/a.so -xc -
+int foo = 3;
+extern int bar __attribute__((alias("foo")));
+int get_bar() { return bar; }
+void unused1() {}
+int unused2 = 5;
+EOF
+
+cat <<EOF | $CC -fno-PIE -o $t/b.o -c -xc -
+#include <stdio.h>
+extern int foo;
+int get_bar();
+int main() {
+  foo = 42;
+  printf("%d %d\n", foo, get_bar());
+}
+EOF
+
+$CC -B. -o $t/exe $t/b.o $t/a.so -no-pie -Wl,--lazy-dso-symbols
+$QEMU $t/exe | grep -q '^42 42$'
+
+# An alias of a copy-relocated symbol is exported from the executable too.
+readelf --dyn-syms $t/exe > $t/log
+grep -Eq ' foo$' $t/log
+grep -Eq ' bar$' $t/log
+! grep -q unused $t/log || false
@@ -0,0 +1,28 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = x86_64 ] || skip
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+int foo() { return 3; }
+EOF
+
+mkdir -p $t/real
+rm -f $t/real/libfoo.a $t/libfoo.a $t/exe
+ar rcs $t/real/libfoo.a $t/a.o
+
+cat <<EOF | $CC -o $t/b.o -c -xc -
+#include <stdio.h>
+int foo();
+int main() { printf("%d\n", foo()); }
+EOF
+
+mkdir -p $t/bin
+ln -sf $PWD/mold-link-in-memory $t/bin/ld
+
+# libfoo.a exists only in memory, so it must be found by -lfoo even
+# though it's not in the library directory.
+MOLD_MEMORY_INPUTS=$t/libfoo.a=$t/real/libfoo.a MOLD_MEMORY_OUTPUT=$t/exe \
+  $CC -B$t/bin/ -o $t/exe $t/b.o -L$t -lfoo
+chmod 755 $t/exe
+$QEMU $t/exe | grep -q '^3$'
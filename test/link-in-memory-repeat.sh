@@ -0,0 +1,26 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = x86_64 ] || skip
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+__thread int x = 5;
+int foo();
+int main() { printf("%d %d\n", x, foo()); }
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -xc -
+int foo() { return 3; }
+EOF
+
+mkdir -p $t/bin
+ln -sf $PWD/mold-link-in-memory $t/bin/ld
+
+# Link three times back-to-back in the same process. The driver fails
+# if the second or third output differs from the first one.
+MOLD_MEMORY_INPUTS=$t/c.o=$t/b.o MOLD_MEMORY_OUTPUT=$t/exe \
+  MOLD_MEMORY_REPEAT=3 \
+  $CC -B$t/bin/ -o $t/exe $t/a.o $t/c.o -Wl,--build-id -Wl,--stats
+chmod 755 $t/exe
+$QEMU $t/exe | grep -q '^5 3$'
@@ -0,0 +1,78 @@
+// A driver to test link_in_memory() from shell scripts. A symlink named
+// `ld` to this program can be passed to the compiler driver with -B.
+//
+// MOLD_MEMORY_INPUTS is a colon-separated list of VIRTUAL=REAL pairs.
+// REAL files are read into memory and passed to link_in_memory() as
+// VIRTUAL, and the output is written to MOLD_MEMORY_OUTPUT.
+//
+// If MOLD_MEMORY_REPEAT is set to N, the same link is done N times
+// back-to-back in this process, and all outputs must be identical.
+// That catches state left behind by a previous link.
+
+#include "../src/mold.h"
+
+#include <fstream>
+#include <iostream>
+#include <list>
+
+using namespace mold;
+
+int main(int argc, char **argv) {
+  std::list<std::string> bufs;
+  std::unordered_map<std::string, std::string_view> inputs;
+
+  char *env = getenv("MOLD_MEMORY_INPUTS");
+  for (std::string_view str = env ? env : ""; !str.empty();) {
+    std::string_view pair = str.substr(0, str.find(':'));
+    str = str.substr(std::min(str.size(), pair.size() + 1));
+
+    size_t pos = pair.find('=');
+    if (pos == pair.npos) {
+      std::cerr << "MOLD_MEMORY_INPUTS: malformed entry: " << pair << "\n";
+      return 1;
+    }
+
+    std::string path(pair.substr(pos + 1));
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      std::cerr << "MOLD_MEMORY_INPUTS: cannot open " << path << "\n";
+      return 1;
+    }
+
+    std::string &buf = bufs.emplace_back(std::istreambuf_iterator<char>(in),
+                                         std::istreambuf_iterator<char>());
+    inputs[std::string(pair.substr(0, pos))] = buf;
+  }
+
+  i64 repeat = 1;
+  if (char *env = getenv("MOLD_MEMORY_REPEAT"))
+    repeat = std::stoi(env);
+
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::vector<u8> output;
+
+  for (i64 i = 0; i < repeat; i++) {
+    MemoryLink link;
+    link.inputs = inputs;
+
+    if (int status = link_in_memory(args, link); status != 0)
+      return status;
+
+    if (i == 0) {
+      output = std::move(link.output);
+    } else if (link.output != output) {
+      std::cerr << "link #" << (i + 1) << " differs from the first one\n";
+      return 1;
+    }
+  }
+
+  if (char *path = getenv("MOLD_MEMORY_OUTPUT")) {
+    std::ofstream out{path, std::ios::binary};
+    out.write((char *)output.data(), output.size());
+    if (!out) {
+      std::cerr << "MOLD_MEMORY_OUTPUT: cannot write " << path << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ "$CC" = cc ] || skip
+test_cflags -flto || skip
+
+cat <<EOF | $CC -o $t/a.o -c -flto -xc -
+#include <stdio.h>
+void hello() {
+  printf("Hello world\n");
+}
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -flto -xc -
+#include <stdio.h>
+void howdy() {
+  printf("Hello world\n");
+}
+EOF
+
+rm -f $t/c.a
+ar rc $t/c.a $t/a.o $t/b.o
+
+cat <<EOF | $CC -o $t/d.o -c -flto -xc -
+void hello();
+int main() {
+  hello();
+}
+EOF
+
+$CC -B. -o $t/exe1 -flto $t/d.o $t/c.a -Wl,--lto-claim-helpers=2
+$QEMU $t/exe1 | grep -q 'Hello world'
+
+nm $t/exe1 > $t/log
+grep -q hello $t/log
+! grep -q howdy $t/log || false
+
+$CC -B. -o $t/exe2 -flto $t/d.o $t/c.a -Wl,--lto-claim-helpers=2 \
+  -Wl,--lto-symbol-cache=$t/cache
+$QEMU $t/exe2 | grep -q 'Hello world'
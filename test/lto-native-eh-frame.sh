@@ -0,0 +1,66 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ "$CC" = cc ] || skip
+test_cflags -flto || skip
+
+# Native objects' .eh_frame is parsed while the LTO plugin is running,
+# before comdat elimination. The inline function below is defined in both
+# the IR object and the native objects, so copies in native objects are
+# discarded afterwards, and their FDEs must be discarded with them.
+cat <<EOF > $t/a.h
+#include <stdexcept>
+inline int thrower(int x) {
+  if (x)
+    throw std::runtime_error("foo");
+  return 0;
+}
+EOF
+
+cat <<EOF | $CXX -o $t/b.o -c -flto -xc++ -I$t -
+#include "a.h"
+int lto_fn(int x) { return thrower(x); }
+EOF
+
+cat <<EOF | $CXX -o $t/c.o -c -xc++ -I$t -
+#include "a.h"
+int native_fn(int x) { return thrower(x); }
+EOF
+
+cat <<EOF | $CXX -o $t/d.o -c -xc++ -I$t -
+#include "a.h"
+int archive_fn(int x) { return thrower(x) + 1; }
+EOF
+
+rm -f $t/e.a
+ar rc $t/e.a $t/d.o
+
+cat <<EOF | $CXX -o $t/f.o -c -xc++ -
+#include <stdio.h>
+#include <stdexcept>
+
+int lto_fn(int);
+int native_fn(int);
+int archive_fn(int);
+
+int main() {
+  int n = 0;
+  for (int (*fn)(int) : {lto_fn, native_fn, archive_fn}) {
+    try {
+      fn(1);
+    } catch (std::runtime_error &e) {
+      n++;
+    }
+  }
+  printf("%d\n", n);
+}
+EOF
+
+$CXX -B. -o $t/exe -flto $t/b.o $t/c.o $t/f.o $t/e.a
+$QEMU $t/exe | grep -q '^3$'
+
+$CXX -B. -o $t/exe -flto $t/c.o $t/b.o $t/f.o $t/e.a
+$QEMU $t/exe | grep -q '^3$'
+
+$CXX -B. -o $t/exe -flto $t/b.o $t/c.o $t/f.o $t/e.a -Wl,--perf > $t/log
+grep -q preprocess_native_objects $t/log
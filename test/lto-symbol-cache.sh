@@ -0,0 +1,42 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ "$CC" = cc ] || skip
+test_cflags -flto || skip
+
+cat <<EOF | $CC -o $t/a.o -c -flto -xc -
+#include <stdio.h>
+void hello() {
+  printf("Hello world\n");
+}
+EOF
+
+cat <<EOF | $CC -o $t/b.o -c -flto -xc -
+#include <stdio.h>
+void howdy() {
+  printf("Hello world\n");
+}
+EOF
+
+rm -f $t/c.a
+ar rc $t/c.a $t/a.o $t/b.o
+
+cat <<EOF | $CC -o $t/d.o -c -flto -xc -
+void hello();
+int main() {
+  hello();
+}
+EOF
+
+rm -rf $t/cache
+$CC -B. -o $t/exe1 -flto $t/d.o $t/c.a -Wl,--lto-symbol-cache=$t/cache
+$QEMU $t/exe1 | grep -q 'Hello world'
+[ $(ls $t/cache | wc -l) = 3 ]
+
+# The second link reads symbol tables from the cache.
+$CC -B. -o $t/exe2 -flto $t/d.o $t/c.a -Wl,--lto-symbol-cache=$t/cache
+$QEMU $t/exe2 | grep -q 'Hello world'
+
+nm $t/exe2 > $t/log
+grep -q hello $t/log
+! grep -q howdy $t/log || false
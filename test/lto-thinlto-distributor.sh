@@ -0,0 +1,31 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = $(uname -m) ] || skip
+
+echo 'int main() {}' | clang -B. -flto=thin -o /dev/null -xc - >& /dev/null \
+  || skip
+
+cat <<EOF | clang -flto=thin -c -o $t/a.o -xc -
+void hello();
+int main() { hello(); }
+EOF
+
+cat <<EOF | clang -flto=thin -c -o $t/b.o -xc -
+#include <stdio.h>
+void hello() { printf("Hello world\n"); }
+EOF
+
+cat <<EOF > $t/backend.sh
+#!/bin/sh
+echo \$1 >> $t/log
+exec clang -c -fthinlto-index=\$2 -x ir \$1 -o \$3
+EOF
+chmod 755 $t/backend.sh
+
+clang -B. -o $t/exe -flto=thin $t/a.o $t/b.o \
+  -Wl,--thinlto-distributor=$t/backend.sh
+$t/exe | grep -q 'Hello world'
+
+grep -q "$t/a.o" $t/log
+grep -q "$t/b.o" $t/log
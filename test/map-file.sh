@@ -0,0 +1,26 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+void hello() { printf("Hello world\n"); }
+int main() { hello(); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,-Map=$t/map
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -Eq '^ +VMA +Size Align Out +In +Symbol$' $t/map
+grep -Eq '^ +0x[0-9a-f]+ +[0-9]+ +[0-9]+ \.text$' $t/map
+grep -Eq "^ +0x[0-9a-f]+ +[0-9]+ +[0-9]+ +$t/a.o:\(\.text\.hello\)$" $t/map
+grep -Eq '^ +0x[0-9a-f]+ +0 +0 +hello$' $t/map
+
+$CC -B. -o $t/exe $t/a.o -Wl,-Map=$t/map.json
+grep -Fq '{"sections":[' $t/map.json
+grep -Eq '^  \{"name":".text","addr":[0-9]+,"size":[0-9]+,"align":[0-9]+,"inputs":\[' $t/map.json
+grep -Fq "{\"file\":\"$t/a.o\",\"section\":\".text.hello\",\"addr\":" $t/map.json
+grep -Eq '"symbols":\[\{"name":"hello","addr":[0-9]+\}\]' $t/map.json
+
+if command -v python3 >& /dev/null; then
+  python3 -c 'import json, sys; json.load(open(sys.argv[1]))' $t/map.json
+fi
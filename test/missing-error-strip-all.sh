@@ -0,0 +1,21 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# With --strip-all, unused local symbols are not created, but the name
+# of a static function referring to an undefined symbol should still be
+# reported.
+cat <<EOF | $CC -o $t/a.o -c -xc -
+int foo();
+
+static __attribute__((noinline)) int bar() {
+  return foo();
+}
+
+int main() {
+  bar();
+}
+EOF
+
+! ./mold -o $t/exe $t/a.o --strip-all 2> $t/log || false
+grep -q 'undefined symbol: foo' $t/log
+grep -q '>>> .*a\.o:(bar)' $t/log
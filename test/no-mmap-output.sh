@@ -0,0 +1,16 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o -Wl,--build-id
+$CC -B. -o $t/exe2 $t/a.o -Wl,--build-id,--no-mmap-output
+$QEMU $t/exe2 | grep -q 'Hello world'
+cmp $t/exe1 $t/exe2
+
+# Overwrite an existing file
+$CC -B. -o $t/exe2 $t/a.o -Wl,--build-id,--no-mmap-output
+cmp $t/exe1 $t/exe2
@@ -0,0 +1,37 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = x86_64 ] || skip
+
+# A non-SHF_ALLOC section larger than 4 MiB with many relocations is
+# copied and relocated by multiple threads.
+cat <<EOF | $CC -c -o $t/a.o -xassembler -
+.globl foo
+.text
+foo:
+  ret
+
+.macro q
+.quad foo + \@
+.endm
+
+.section .mydata,"",@progbits
+.rept 600000
+q
+.endr
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+int main() { return 0; }
+EOF
+
+$CC -B. -o $t/exe $t/a.o $t/b.o
+$QEMU $t/exe
+
+objcopy --dump-section .mydata=$t/mydata $t/exe
+base=$((0x$(nm $t/exe | grep ' [tT] foo$' | cut -d' ' -f1)))
+
+od -An -tu8 -v $t/mydata |
+  awk -v base=$base '
+    { for (i = 1; i <= NF; i++) if ($i != base + n++) bad = 1 }
+    END { exit bad || n != 600000 }'
@@ -0,0 +1,30 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a1.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello\n"); }
+EOF
+
+cat <<EOF | $CC -o $t/a2.o -c -xc -
+#include <stdio.h>
+int main() { printf("World\n"); }
+EOF
+
+[ $(stat -c %s $t/a1.o) = $(stat -c %s $t/a2.o) ] || skip
+
+rm -rf $t/cache
+cp $t/a1.o $t/a.o
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache
+$QEMU $t/exe | grep -q Hello
+
+# a.o was modified just before the cache entry was created, so it may
+# have been modified again without changing its stat(2) result. Such a
+# file must be compared by contents however late the cache is looked up.
+touch -r $t/a.o $t/ref
+cat $t/a2.o > $t/a.o
+touch -r $t/ref $t/a.o
+sleep 3
+
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache
+$QEMU $t/exe | grep -q World
@@ -0,0 +1,31 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello\n"); }
+EOF
+
+rm -rf $t/cache
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache
+$QEMU $t/exe | grep -q Hello
+ls $t/cache | grep -q '\.manifest$'
+
+# Replace the cached output to see if it is used.
+cp $t/exe $t/exe.orig
+echo foo > $t/cache/*.out
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache
+grep -q foo $t/exe
+
+# Changing an input file invalidates the cache.
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("World\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache
+$QEMU $t/exe | grep -q World
+
+# So does changing the command line.
+$CC -B. -o $t/exe $t/a.o -Wl,--output-cache=$t/cache -Wl,-z,now
+$QEMU $t/exe | grep -q World
@@ -0,0 +1,15 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--perf=hw > $t/log 2> $t/log2
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -Fq 'hardware performance counters are not available' $t/log2 && skip
+
+grep -Eq 'MinFlt +Cycles +Insns +IPC +LLCMiss +dTLBMiss +Name' $t/log
+grep -Eq ' copy_chunks$' $t/log
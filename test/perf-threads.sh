@@ -0,0 +1,16 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--perf=threads > $t/log
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -Eq 'MinFlt +Busy +Effic +Serial +Name' $t/log
+grep -Eq ' copy_chunks$' $t/log
+
+$CC -B. -o $t/exe $t/a.o -Wl,--perf=threads,--perf=trace:$t/trace.json > /dev/null
+grep -Eq '"busy_ms":[0-9.]+,"efficiency":[0-9.]+,"serial_ms":[0-9.]+' $t/trace.json
@@ -0,0 +1,21 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--perf=trace:$t/trace.json
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -Fq '{"traceEvents":[' $t/trace.json
+grep -Fq '"name":"copy_chunks","ph":"X"' $t/trace.json
+grep -Fq '"name":"thread_name","ph":"M"' $t/trace.json
+grep -Eq '"majflt":[0-9]+,"minflt":[0-9]+' $t/trace.json
+
+$CC -B. -o $t/exe $t/a.o -Wl,--perf > $t/log2
+grep -Eq 'MaxRSS +\+RSS +\+Commit +MajFlt +MinFlt +Name' $t/log2
+
+! $CC -B. -o $t/exe $t/a.o -Wl,--perf=foo 2> $t/log || false
+grep -Fq 'unknown --perf argument: foo' $t/log
@@ -0,0 +1,24 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+int foo() { return 3; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+int bar() { return 4; }
+EOF
+
+cat <<EOF | $CC -c -o $t/c.o -xc -
+#include <stdio.h>
+int foo();
+int bar();
+int main() { printf("%d\n", foo() + bar()); }
+EOF
+
+rm -f $t/d.a $t/e.a
+ar rcs $t/d.a $t/a.o
+ar rcsT $t/e.a $t/b.o
+
+$CC -B. -o $t/exe $t/c.o $t/d.a $t/e.a -Wl,--prefetch-inputs
+$QEMU $t/exe | grep -q '^7$'
@@ -0,0 +1,21 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+export XDG_CACHE_HOME=$t/cache
+rm -rf $t/cache
+
+$CC -B. -o $t/exe $t/a.o -Wl,--progress-fd=3 3> $t/log1
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -q '^{"event":"begin","phase":"read_input_files",' $t/log1
+grep -q '^{"event":"end","phase":"copy",' $t/log1
+tail -1 $t/log1 | grep -Eq '^{"event":"done",.*"files":[1-9]'
+! grep -q eta_ms $t/log1 || false
+
+$CC -B. -o $t/exe $t/a.o -Wl,--progress-fd=3 3> $t/log2
+grep -q '^{"event":"begin","phase":"copy",.*"eta_ms":' $t/log2
@@ -0,0 +1,22 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -g -xc - -ffunction-sections
+#include <stdio.h>
+void unused1() { printf("unused1\n"); }
+void unused2() { printf("unused2\n"); }
+void hello() { printf("Hello world\n"); }
+int main() { hello(); }
+EOF
+
+count_tuples() {
+  readelf --debug-dump=aranges $1 | grep -Ec '^ +[0-9a-f]{8,} +[0-9a-f]{8,}$'
+}
+
+$CC -B. -o $t/exe1 $t/a.o -Wl,--gc-sections
+$QEMU $t/exe1 | grep -q 'Hello world'
+
+$CC -B. -o $t/exe2 $t/a.o -Wl,--gc-sections -Wl,--prune-debug-aranges
+$QEMU $t/exe2 | grep -q 'Hello world'
+
+[ $(count_tuples $t/exe2) -eq $(( $(count_tuples $t/exe1) - 2 )) ]
@@ -0,0 +1,26 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+command -v zstd >& /dev/null || skip
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+
+int main() {
+  printf("Hello world\n");
+  return 0;
+}
+EOF
+
+rm -rf $t/exe.repro $t/exe.repro.tar $t/exe.repro.tar.zst
+
+$CC -B. -o $t/exe $t/a.o -Wl,--repro=zstd
+$QEMU $t/exe | grep -q 'Hello world'
+! [ -f $t/exe.repro.tar ] || false
+
+zstd -dq $t/exe.repro.tar.zst
+tar -C $t -tvf $t/exe.repro.tar | grep -q ' exe.repro/.*/a.o'
+tar -C $t -xf $t/exe.repro.tar
+grep -q /a.o  $t/exe.repro/response.txt
+grep -q mold $t/exe.repro/version.txt
+cmp $t/a.o $(find $t/exe.repro -name a.o)
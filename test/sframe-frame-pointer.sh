@@ -0,0 +1,44 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = x86_64 -o $MACHINE = aarch64 ] || skip
+test_cflags -Wa,--gsframe || skip
+
+cat <<EOF | $CC -c -o $t/a.o -Wa,--gsframe -xc -
+int foo(int x) { return x + 1; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -Wa,--gsframe -xc -
+#include <stdio.h>
+int foo(int x);
+int main() { printf("%d\n", foo(1)); }
+EOF
+
+# Set SFRAME_F_FRAME_POINTER in the .sframe header of a given file.
+set_frame_pointer() {
+  off=$((0x$(readelf -SW $1 | grep ' \.sframe ' |
+              sed 's/.*PROGBITS *//' | awk '{ print $2 }')))
+  flags=$(od -An -tu1 -j $((off + 3)) -N1 $1)
+  printf "\\$(printf %o $((flags | 2)))" |
+    dd of=$1 bs=1 seek=$((off + 3)) conv=notrunc status=none
+}
+
+cp $t/a.o $t/c.o
+cp $t/b.o $t/d.o
+set_frame_pointer $t/c.o
+set_frame_pointer $t/d.o
+readelf --sframe $t/c.o | grep -q SFRAME_F_FRAME_POINTER || skip
+
+# The flag is kept only if all inputs have it, and inputs that differ
+# only in the flag can still be merged.
+$CC -B. -o $t/exe1 $t/c.o $t/d.o
+$QEMU $t/exe1 | grep -q '^2$'
+readelf --sframe $t/exe1 > $t/log1
+grep -q 'Num FDEs: 2' $t/log1
+grep -q SFRAME_F_FRAME_POINTER $t/log1
+
+$CC -B. -o $t/exe2 $t/c.o $t/b.o
+$QEMU $t/exe2 | grep -q '^2$'
+readelf --sframe $t/exe2 > $t/log2
+grep -q 'Num FDEs: 2' $t/log2
+! grep -q SFRAME_F_FRAME_POINTER $t/log2 || false
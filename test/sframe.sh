@@ -0,0 +1,30 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+[ $MACHINE = x86_64 -o $MACHINE = aarch64 ] || skip
+test_cflags -Wa,--gsframe || skip
+
+cat <<EOF | $CC -c -o $t/a.o -ffunction-sections -Wa,--gsframe -xc -
+int foo(int x) { return x + 1; }
+int bar(int x) { return x + 2; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -ffunction-sections -Wa,--gsframe -xc -
+#include <stdio.h>
+int foo(int x);
+int main() { printf("%d\n", foo(1)); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o
+$QEMU $t/exe1 | grep -q '^2$'
+
+readelf -lW $t/exe1 | grep -q GNU_SFRAME
+readelf --sframe $t/exe1 > $t/log1
+grep -q 'Num FDEs: 3' $t/log1
+grep -q 'SFRAME_F_FDE_SORTED' $t/log1
+
+addr=$(nm $t/exe1 | grep ' [tT] foo$' | cut -d' ' -f1 | sed 's/^0*//')
+grep -q "pc = 0x$addr," $t/log1
+
+$CC -B. -o $t/exe2 $t/a.o $t/b.o -Wl,--gc-sections
+readelf --sframe $t/exe2 | grep -q 'Num FDEs: 2'
@@ -0,0 +1,33 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+int foo(int x) { return x * 3; }
+int foo2(int x) { return x * x * x + foo(x) * 5 - 7; }
+int foo3(int x) { return foo2(x) * foo2(x + 1) - 11; }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+#include <stdio.h>
+int foo(int x);
+int bar(int x) { return foo(x) + 1; }
+int main() { printf("%d\n", bar(2)); }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o -Wl,-Map=$t/map
+$QEMU $t/exe1 | grep -q '^7$'
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+int foo(int x) { return x * 3; }
+EOF
+
+$CC -B. -o $t/exe2 $t/a.o $t/b.o
+$CC -B. -o $t/exe3 $t/a.o $t/b.o -Wl,--stable-layout=$t/map
+$QEMU $t/exe3 | grep -q '^7$'
+
+addr1=$(readelf -sW $t/exe1 | grep ' bar$' | awk '{ print $2 }')
+addr2=$(readelf -sW $t/exe2 | grep ' bar$' | awk '{ print $2 }')
+addr3=$(readelf -sW $t/exe3 | grep ' bar$' | awk '{ print $2 }')
+
+[ $addr1 != $addr2 ]
+[ $addr1 = $addr3 ]
@@ -0,0 +1,14 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,--stats > $t/log
+$QEMU $t/exe | grep -q 'Hello world'
+
+grep -q 'memory (KiB).*read_input_files.*end' $t/log
+grep -Eq 'symbol_map +[0-9]' $t/log
+grep -Eq 'mf_pool_mapped +[0-9]' $t/log
@@ -0,0 +1,20 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+void fn1() {}
+static void fn2() {}
+int main() { printf("%d\n", (long)fn2 < (long)fn1); }
+EOF
+
+cat <<EOF > $t/order
+fn2
+fn1
+EOF
+
+# Local symbols must be kept for --symbol-ordering-file even if they
+# are going to be stripped from the output.
+$CC -B. -o $t/exe $t/a.o -s -Wl,--symbol-ordering-file=$t/order 2> $t/log
+$QEMU $t/exe | grep -q '^1$'
+! grep -Fq 'no such symbol' $t/log || false
@@ -0,0 +1,35 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -ffunction-sections
+#include <stdio.h>
+void fn1() {}
+void fn2() {}
+static void fn3() {}
+void fn4() { fn3(); }
+int main() { printf("Hello world\n"); }
+EOF
+
+cat <<EOF > $t/order
+fn4
+fn3
+fn2
+no_such_symbol
+fn4
+EOF
+
+get_addr() {
+  nm $t/exe | grep " $1$" | cut -d' ' -f1
+}
+
+$CC -B. -o $t/exe $t/a.o -Wl,--symbol-ordering-file=$t/order 2> $t/log
+$QEMU $t/exe | grep -q 'Hello world'
+grep -Fq -- '--symbol-ordering-file: no such symbol: no_such_symbol' $t/log
+
+[[ $(get_addr fn4) < $(get_addr fn3) ]]
+[[ $(get_addr fn3) < $(get_addr fn2) ]]
+[[ $(get_addr fn2) < $(get_addr fn1) ]]
+
+$CC -B. -o $t/exe $t/a.o -Wl,--symbol-ordering-file=$t/order \
+  -Wl,--no-warn-symbol-ordering 2> $t/log
+! grep -Fq 'no such symbol' $t/log || false
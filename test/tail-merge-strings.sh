@@ -0,0 +1,38 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc - -O2
+#include <stdio.h>
+const char *foo() { return "foo_bar_baz"; }
+int main() { printf("%s\n", foo()); }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc - -O2
+const char *bar() { return "bar_baz"; }
+const char *baz() { return "baz"; }
+EOF
+
+cat <<EOF | $CC -c -o $t/c.o -xc - -O2
+#include <stdio.h>
+const char *bar();
+const char *baz();
+void print() { printf("%s %s\n", bar(), baz()); }
+EOF
+
+cat <<EOF | $CC -c -o $t/d.o -xc - -O2
+void print();
+int main() { print(); }
+EOF
+
+$CC -B. -o $t/exe1 $t/b.o $t/c.o $t/d.o
+$QEMU $t/exe1 | grep -q '^bar_baz baz$'
+readelf -p .rodata.str1.1 $t/exe1 | grep -Eq '\]  baz$'
+
+$CC -B. -o $t/exe2 $t/b.o $t/c.o $t/d.o -Wl,-O2
+$QEMU $t/exe2 | grep -q '^bar_baz baz$'
+readelf -p .rodata.str1.1 $t/exe2 > $t/log
+grep -Eq '\]  bar_baz$' $t/log
+! grep -Eq '\]  baz$' $t/log || false
+
+$CC -B. -o $t/exe3 $t/a.o $t/b.o -Wl,-O2
+$QEMU $t/exe3 | grep -q '^foo_bar_baz$'
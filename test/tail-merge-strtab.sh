@@ -0,0 +1,31 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -c -o $t/a.o -xc -
+#include <stdio.h>
+int foo_bar_baz = 1;
+int bar_baz = 2;
+int baz = 3;
+static int local_baz = 4;
+int main() { printf("%d %d %d %d\n", foo_bar_baz, bar_baz, baz, local_baz); }
+EOF
+
+cat <<EOF | $CC -c -o $t/b.o -xc -
+static int local_baz = 5;
+int get_local_baz() { return local_baz; }
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o $t/b.o
+$CC -B. -o $t/exe2 $t/a.o $t/b.o -Wl,--tail-merge-strtab
+$QEMU $t/exe2 | grep -q '^1 2 3 4$'
+
+readelf -sW $t/exe2 > $t/log2
+grep -Eq ' foo_bar_baz$' $t/log2
+grep -Eq ' bar_baz$' $t/log2
+grep -Eq ' baz$' $t/log2
+[ "$(grep -c ' local_baz$' $t/log2)" = 2 ]
+
+readelf -p .strtab $t/exe1 | grep -Eq '\]  baz$'
+readelf -p .strtab $t/exe2 > $t/log3
+grep -Eq '\]  foo_bar_baz$' $t/log3
+! grep -Eq '\]  (bar_)?baz$' $t/log3 || false
@@ -0,0 +1,55 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# GD and TLSDESC accesses can be relaxed to IE in a dlopen'able DSO only
+# if the DSO already uses IE, i.e. if its TLS block is in static TLS.
+# GD can be relaxed only on some targets, so use TLSDESC elsewhere.
+if [ $MACHINE = x86_64 -o $MACHINE = s390x -o $MACHINE = sparc64 ]; then
+  opt=
+elif supports_tlsdesc; then
+  opt=$tlsdesc_opt
+else
+  skip
+fi
+
+cat <<EOF | $GCC -fPIC $opt -c -o $t/a.o -xc -
+__attribute__((tls_model("global-dynamic"), visibility("hidden")))
+_Thread_local int x1 = 1;
+
+__attribute__((tls_model("global-dynamic"), visibility("hidden")))
+_Thread_local int x2 = 2;
+
+int get_x1() { return x1; }
+int get_x2() { return x2; }
+EOF
+
+cat <<EOF | $GCC -fPIC -c -o $t/b.o -xc -
+__attribute__((tls_model("initial-exec"), visibility("hidden")))
+extern _Thread_local int x1;
+
+int get_x1_ie() { return x1; }
+EOF
+
+cat <<EOF | $CC -c -o $t/c.o -xc -
+#include <stdio.h>
+int get_x1();
+int get_x2();
+int get_x1_ie();
+int main() { printf("%d %d %d\n", get_x1(), get_x2(), get_x1_ie()); }
+EOF
+
+$CC -B. -shared -o $t/d.so $t/a.o
+readelf -rW $t/d.so | grep -Eq 'DTPMOD|TLSDESC|TLS_DESC'
+
+$CC -B. -shared -o $t/e.so $t/a.o $t/b.o
+readelf -rW $t/e.so > $t/log
+! grep -Eq 'DTPMOD|TLSDESC|TLS_DESC' $t/log || false
+
+$CC -B. -o $t/exe1 $t/c.o $t/e.so
+$QEMU $t/exe1 | grep -q '1 2 1'
+
+$CC -B. -shared -o $t/f.so $t/a.o $t/b.o -Wl,--no-relax
+readelf -rW $t/f.so | grep -Eq 'DTPMOD|TLSDESC|TLS_DESC'
+
+$CC -B. -o $t/exe2 $t/c.o $t/f.so
+$QEMU $t/exe2 | grep -q '1 2 1'
@@ -0,0 +1,55 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# GD and TLSDESC accesses to TLVs imported from other DSOs must not be
+# relaxed to IE even if the output also uses IE for them.
+if [ $MACHINE = x86_64 -o $MACHINE = s390x -o $MACHINE = sparc64 ]; then
+  opt=
+elif supports_tlsdesc; then
+  opt=$tlsdesc_opt
+else
+  skip
+fi
+
+cat <<EOF | $GCC -fPIC -c -o $t/a.o -xc -
+_Thread_local int y = 5;
+EOF
+
+$CC -B. -shared -o $t/b.so $t/a.o
+
+cat <<EOF | $GCC -fPIC $opt -c -o $t/c.o -xc -
+__attribute__((tls_model("global-dynamic"), visibility("hidden")))
+_Thread_local int x = 1;
+
+__attribute__((tls_model("global-dynamic")))
+extern _Thread_local int y;
+
+int get_x() { return x; }
+int get_y() { return y; }
+EOF
+
+cat <<EOF | $GCC -fPIC -c -o $t/d.o -xc -
+__attribute__((tls_model("initial-exec"), visibility("hidden")))
+extern _Thread_local int x;
+
+__attribute__((tls_model("initial-exec")))
+extern _Thread_local int y;
+
+int get_x_ie() { return x; }
+int get_y_ie() { return y; }
+EOF
+
+cat <<EOF | $CC -c -o $t/e.o -xc -
+#include <stdio.h>
+int get_x();
+int get_y();
+int get_x_ie();
+int main() { printf("%d %d %d\n", get_x(), get_y(), get_x_ie()); }
+EOF
+
+$CC -B. -shared -o $t/f.so $t/c.o $t/d.o $t/b.so
+readelf -rW $t/f.so > $t/log
+grep -Eq '(DTPMOD|TLSDESC|TLS_DESC).* y( |$)' $t/log
+
+$CC -B. -o $t/exe $t/e.o $t/f.so $t/b.so
+$QEMU $t/exe | grep -q '1 5 1'
@@ -0,0 +1,34 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<'EOF' > $t/a.ver
+VER1 { extern "C++" { "mylib::get(int)"; }; };
+VER2 { extern "C++" { "mylib::Widget<std::*basic_string<char*"; }; };
+VER3 { extern "C++" { "operator new*"; }; };
+VER4 { extern "C++" { "cx(double _Complex)"; }; };
+EOF
+
+cat <<EOF | $CXX -fPIC -c -o $t/b.o -xc++ -
+#include <stdlib.h>
+#include <string>
+namespace mylib {
+int get(int x) { return x; }
+int get(long x) { return x; }
+template <typename T> struct Widget { void run(); };
+template <typename T> void Widget<T>::run() {}
+template struct Widget<std::string>;
+}
+void *operator new(size_t n) { return malloc(n); }
+double cx(_Complex double x) { return __real__ x; }
+EOF
+
+$CC -B. -shared -Wl,--version-script=$t/a.ver -o $t/c.so $t/b.o
+readelf --dyn-syms -W $t/c.so > $t/log
+
+grep -q '_ZN5mylib3getEi@@VER1' $t/log
+grep -q 'WidgetINSt7__cxx1112basic_string.*@@VER2' $t/log
+! grep -q '_ZN5mylib3getEl@@' $t/log || false
+
+# "new" and "_Complex" appear only in demangled names.
+grep -q '_Znw[jm]@@VER3' $t/log
+grep -q '_Z2cxCd@@VER4' $t/log
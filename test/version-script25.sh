@@ -0,0 +1,21 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+# The literal parts of these patterns overlap, so a suffix link in the
+# literal trie must be computed after the suffix link of its parent's
+# suffix. zabxy contains "x" only as a suffix of "abx".
+cat <<'EOF' > $t/a.ver
+VER1 { abx*?; };
+VER2 { bq*?; };
+VER3 { *x*?; };
+EOF
+
+cat <<EOF | $CC -fPIC -c -o $t/b.o -xc -
+void zabxy() {}
+void bqz() {}
+EOF
+
+$CC -B. -shared -Wl,--version-script=$t/a.ver -o $t/c.so $t/b.o
+readelf -W --dyn-syms $t/c.so > $t/log
+grep -Fq 'zabxy@@VER3' $t/log
+grep -Fq 'bqz@@VER2' $t/log
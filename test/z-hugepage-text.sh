@@ -0,0 +1,23 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc -
+#include <stdio.h>
+int main() { printf("Hello world\n"); }
+EOF
+
+$CC -B. -o $t/exe $t/a.o -Wl,-z,hugepage-text
+$QEMU $t/exe | grep -q 'Hello world'
+
+readelf -W --segments $t/exe | grep -E '^ +LOAD .* R E ' > $t/log
+[ $(wc -l < $t/log) = 1 ]
+
+read _ offset vaddr _ _ _ _ _ align < $t/log
+[ $((offset % 0x200000)) = 0 ]
+[ $((vaddr % 0x200000)) = 0 ]
+[ $((align)) = $((0x200000)) ]
+
+# Non-executable segments are not aligned to huge pages.
+readelf -W --segments $t/exe | grep -E '^ +LOAD .* RW ' > $t/log2
+read _ _ _ _ _ _ _ align < $t/log2
+[ $((align)) -lt $((0x200000)) ]
@@ -0,0 +1,17 @@
+#!/bin/bash
+. $(dirname $0)/common.inc
+
+cat <<EOF | $CC -o $t/a.o -c -xc - -fno-zero-initialized-in-bss
+#include <stdio.h>
+char buf[1024 * 1024] = {0};
+int main() {
+  buf[5] = 3;
+  printf("%d\n", buf[5] + buf[100]);
+}
+EOF
+
+$CC -B. -o $t/exe1 $t/a.o
+$CC -B. -o $t/exe2 $t/a.o -Wl,--zero-data-to-bss
+$QEMU $t/exe2 | grep -q '^3$'
+
+[ $(wc -c < $t/exe2) -lt $(( $(wc -c < $t/exe1) - 1000000 )) ]